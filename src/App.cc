@@ -15,7 +15,9 @@
 #include "GossOption.hh"
 #include "Logger.hh"
 #include "PhysicalFileFactory.hh"
+#include "ThreadPlacement.hh"
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <stdint.h>
@@ -76,6 +78,23 @@ namespace { // anonymous
         }
     }
 
+    // Replace "auto" as the number of threads with the number of
+    // processors the process may use. This is done to the parsed
+    // options, before their values are converted, so it doesn't matter
+    // how the option was spelt on the command line.
+    void
+    resolveAutoThreads(parsed_options& pOpts)
+    {
+        for (uint64_t i = 0; i < pOpts.options.size(); ++i)
+        {
+            basic_option<char>& o(pOpts.options[i]);
+            if (o.string_key == "num-threads" && o.value.size() == 1 && o.value[0] == "auto")
+            {
+                o.value[0] = lexical_cast<string>(ThreadPlacement::process().processors());
+            }
+        }
+    }
+
     bool
     validOptions(const GossOptions& pCommonOpts)
     {
@@ -145,6 +164,12 @@ App::logger()
     return *theLogger;
 }
 
+MemoryBudget&
+App::memoryBudget()
+{
+    return MemoryBudget::process();
+}
+
 void
 App::help(bool pExit)
 {
@@ -252,6 +277,7 @@ App::main(int argc, char* argv[])
 
             parsed_options parsed_opts = command_line_parser(argc - argsToSkip, argv + argsToSkip).
                                                             options(opts).allow_unregistered().run();
+            resolveAutoThreads(parsed_opts);
             for (vector<basic_option<char> >::const_iterator
                  j  = parsed_opts.options.begin();
                  j != parsed_opts.options.end();
@@ -288,6 +314,69 @@ App::main(int argc, char* argv[])
         }
         theFileFactory = FileFactoryPtr(new PhysicalFileFactory(tmp[0]));
 
+        // set up the mapping policies
+        {
+            FileFactory::MappingPolicy data;
+            if (optsMap.count("map-access"))
+            {
+                string acc = optsMap["map-access"].as<string>();
+                if (acc == "sequential")
+                {
+                    data.access = FileFactory::SequentialAccess;
+                }
+                else if (acc == "random")
+                {
+                    data.access = FileFactory::RandomAccess;
+                }
+                else if (acc != "normal")
+                {
+                    BOOST_THROW_EXCEPTION(
+                        Gossamer::error()
+                            << Gossamer::usage_info("map-access must be one of normal, sequential or random\n"));
+                }
+            }
+            if (optsMap.count("map-interleave"))
+            {
+                data.placement = FileFactory::InterleavedPlacement;
+            }
+            if (optsMap.count("no-huge-pages"))
+            {
+                data.hugePages = false;
+            }
+            FileFactory::MappingPolicy index(data);
+            index.access = FileFactory::NormalAccess;
+            // Data maps are left to fault in as they are read, except
+            // when interleaved: then the factory still populates them,
+            // since pages faulted in by the workers are placed locally.
+            if (optsMap.count("map-warm-up"))
+            {
+                data.populate = false;
+                index.populate = false;
+                index.warmUp = true;
+            }
+            theFileFactory->mappingPolicy(FileFactory::DataMap, data);
+            theFileFactory->mappingPolicy(FileFactory::IndexMap, index);
+        }
+
+        // compress output on as many threads as the command may use
+        if (optsMap.count("num-threads"))
+        {
+            theFileFactory->outputThreads(std::max<uint64_t>(1, optsMap["num-threads"].as<uint64_t>()));
+        }
+
+        // set up the memory budget
+        if (optsMap.count("max-memory"))
+        {
+            double m = optsMap["max-memory"].as<double>();
+            if (m <= 0)
+            {
+                BOOST_THROW_EXCEPTION(
+                    Gossamer::error()
+                        << Gossamer::usage_info("max-memory must be greater than zero\n"));
+            }
+            memoryBudget().limit(m * 1024.0 * 1024.0 * 1024.0);
+        }
+
         // set up logging
         Severity sev(optsMap.count("verbose") ? info : warning);
         if (optsMap.count("log-file") == 0)
@@ -312,9 +401,61 @@ App::main(int argc, char* argv[])
             }
         }
 
+        // say if mapped files can't be interleaved as asked
+        if (optsMap.count("map-interleave"))
+        {
+            if (Gossamer::interleaveMemory(true))
+            {
+                Gossamer::interleaveMemory(false);
+            }
+            else
+            {
+                logger()(warning, "cannot interleave memory across nodes; mapped files will be placed locally");
+            }
+        }
+
+        // place worker threads
+        {
+            ThreadPlacement& placement(ThreadPlacement::process());
+            placement.pinning(optsMap.count("pin-threads"));
+            string qs = optsMap.count("queues") ? optsMap["queues"].as<string>() : string("auto");
+            if (qs == "locked")
+            {
+                placement.ringQueues(false);
+            }
+            else if (qs == "ring")
+            {
+                placement.ringQueues(true);
+            }
+            else if (qs == "auto")
+            {
+                placement.ringQueues(placement.processors() > ThreadPlacement::ringProcessors);
+            }
+            else
+            {
+                BOOST_THROW_EXCEPTION(
+                    Gossamer::error()
+                        << Gossamer::usage_info("queues must be one of locked, ring or auto\n"));
+            }
+            logger()(info, placement.describe());
+            if (placement.pinning() && optsMap.count("num-threads"))
+            {
+                const uint64_t t = std::max<uint64_t>(1, optsMap["num-threads"].as<uint64_t>());
+                logger()(info, "pinning threads: " + placement.describe(t));
+            }
+            else if (placement.pinning())
+            {
+                logger()(info, "pinning threads to processors in turn across nodes");
+            }
+            if (placement.ringQueues())
+            {
+                logger()(info, "passing work between threads through lock-free rings");
+            }
+        }
+
         cmd = i->second->create(*this, optsMap);
 
-        GossCmdContext cxt(fileFactory(), logger(), cmdName, optsMap);
+        GossCmdContext cxt(fileFactory(), logger(), cmdName, optsMap, memoryBudget());
         try
         {
             (*cmd)(cxt);
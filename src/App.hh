@@ -37,6 +37,8 @@ public:
 
     Logger& logger();
 
+    MemoryBudget& memoryBudget();
+
     void help(bool pExit = true);
 
     virtual int main(int argc, char* argv[]);
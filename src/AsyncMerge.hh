@@ -21,11 +21,12 @@
 class AsyncMerge
 {
 public:
-    template <typename Kind>
+    // Any trailing arguments are passed on to the constructor of Kind::Builder.
+    template <typename Kind, typename... BuilderArgs>
     static void merge(const std::vector<std::string>& pParts, const std::vector<uint64_t>& pSizes,
                       const std::string& pGraphName,
                       uint64_t pK, uint64_t pN, uint64_t pNumThreads, uint64_t pBufferSize,
-                      FileFactory& pFactory);
+                      FileFactory& pFactory, BuilderArgs... pBuilderArgs);
 };
 
 #include "AsyncMerge.tcc"
@@ -285,10 +285,11 @@ namespace // anonymous
         return ptrs.front();
     }
 
-    template <typename T>
-    void do_merge(JobManager& pMgr, ElemPtr& pRoot, const string& pBaseName, uint64_t pK, uint64_t pN, FileFactory& pFactory)
+    template <typename T, typename... BuilderArgs>
+    void do_merge(JobManager& pMgr, ElemPtr& pRoot, const string& pBaseName, uint64_t pK, uint64_t pN, FileFactory& pFactory,
+                  BuilderArgs... pBuilderArgs)
     {
-        typename T::Builder bld(pK, pBaseName, pFactory, pN);
+        typename T::Builder bld(pK, pBaseName, pFactory, pN, pBuilderArgs...);
         while (true)
         {
             JobManager::Token t = pMgr.enqueue(std::bind(&Elem::fill, pRoot.get()), pRoot->deps());
@@ -310,15 +311,16 @@ namespace // anonymous
 }
 // namespace anonymous
 
-template <typename T>
+template <typename T, typename... BuilderArgs>
 void
 AsyncMerge::merge(const vector<string>& pParts, const vector<uint64_t>& pSizes, const string& pGraphName,
-                  uint64_t pK, uint64_t pN, uint64_t pNumThreads, uint64_t pBufferSize, FileFactory& pFactory)
+                  uint64_t pK, uint64_t pN, uint64_t pNumThreads, uint64_t pBufferSize, FileFactory& pFactory,
+                  BuilderArgs... pBuilderArgs)
 {
     {
         JobManager mgr(pNumThreads);
         ElemPtr r = build(pParts, pSizes, pFactory, pBufferSize, mgr);
-        do_merge<T>(mgr, r, pGraphName, pK, pN, pFactory);
+        do_merge<T>(mgr, r, pGraphName, pK, pN, pFactory, pBuilderArgs...);
         mgr.wait();
     }
 }
@@ -13,6 +13,11 @@
 #include "BoundedQueue.hh"
 #endif
 
+#ifndef STD_ATOMIC
+#include <atomic>
+#define STD_ATOMIC
+#endif
+
 #ifndef THREADGROUP_HH
 #include "ThreadGroup.hh"
 #endif
@@ -23,6 +28,11 @@ class BackgroundMultiConsumer
 public:
     typedef T value_type;
 
+    // The consumers take their items in batches of up to an even share
+    // of those waiting, so cheap items don't cost a trip through the
+    // queue each, and expensive ones are still spread about. A lone
+    // consumer has no one to share the lock with, and takes them one at
+    // a time.
     class Holder
     {
     public:
@@ -37,20 +47,41 @@ public:
         void operator()()
         {
             T itm;
-            while (mQueue.get(itm))
+            std::vector<T> itms;
+            while (true)
             {
-                mCons.push_back(itm);
+                const uint64_t n = mNumConsumers.load(std::memory_order_relaxed);
+                if (n == 1)
+                {
+                    if (!mQueue.get(itm))
+                    {
+                        break;
+                    }
+                    mCons.push_back(itm);
+                    continue;
+                }
+                if (!mQueue.get(itms, n))
+                {
+                    break;
+                }
+                for (uint64_t i = 0; i < itms.size(); ++i)
+                {
+                    mCons.push_back(itms[i]);
+                }
+                itms.clear();
             }
         }
 
-        PushBackConsHolder(BoundedQueue<T,true>& pQueue, Consumer& pCons)
-            : mQueue(pQueue), mCons(pCons)
+        PushBackConsHolder(BoundedQueue<T,true>& pQueue, Consumer& pCons,
+                           const std::atomic<uint64_t>& pNumConsumers)
+            : mQueue(pQueue), mCons(pCons), mNumConsumers(pNumConsumers)
         {
         }
 
     private:
         BoundedQueue<T,true>& mQueue;
         Consumer& mCons;
+        const std::atomic<uint64_t>& mNumConsumers;
     };
 
     template <typename Consumer>
@@ -60,20 +91,41 @@ public:
         void operator()()
         {
             T itm;
-            while (mQueue.get(itm))
+            std::vector<T> itms;
+            while (true)
             {
-                mCons(itm);
+                const uint64_t n = mNumConsumers.load(std::memory_order_relaxed);
+                if (n == 1)
+                {
+                    if (!mQueue.get(itm))
+                    {
+                        break;
+                    }
+                    mCons(itm);
+                    continue;
+                }
+                if (!mQueue.get(itms, n))
+                {
+                    break;
+                }
+                for (uint64_t i = 0; i < itms.size(); ++i)
+                {
+                    mCons(itms[i]);
+                }
+                itms.clear();
             }
         }
 
-        ApplyConsHolder(BoundedQueue<T,true>& pQueue, Consumer& pCons)
-            : mQueue(pQueue), mCons(pCons)
+        ApplyConsHolder(BoundedQueue<T,true>& pQueue, Consumer& pCons,
+                        const std::atomic<uint64_t>& pNumConsumers)
+            : mQueue(pQueue), mCons(pCons), mNumConsumers(pNumConsumers)
         {
         }
 
     private:
         BoundedQueue<T,true>& mQueue;
         Consumer& mCons;
+        const std::atomic<uint64_t>& mNumConsumers;
     };
 
     void push_back(const value_type& pItem)
@@ -81,6 +133,11 @@ public:
         mQueue.put(pItem);
     }
 
+    void push_back(const value_type* pBegin, const value_type* pEnd)
+    {
+        mQueue.put(pBegin, pEnd);
+    }
+
     void end()
     {
         mFinished = true;
@@ -103,17 +160,19 @@ public:
     template <typename Consumer>
     void addPushBack(Consumer& pCons)
     {
-        HolderPtr h(new PushBackConsHolder<Consumer>(mQueue, pCons));
+        HolderPtr h(new PushBackConsHolder<Consumer>(mQueue, pCons, mNumConsumers));
         mHolders.push_back(h);
-        mThreads.create(static_cast<PushBackConsHolder<Consumer>&>(*h));
+        const uint64_t w = mNumConsumers++;
+        mThreads.create(static_cast<PushBackConsHolder<Consumer>&>(*h), w, 0);
     }
 
     template <typename Consumer>
     void addApply(Consumer& pCons)
     {
-        HolderPtr h(new ApplyConsHolder<Consumer>(mQueue, pCons));
+        HolderPtr h(new ApplyConsHolder<Consumer>(mQueue, pCons, mNumConsumers));
         mHolders.push_back(h);
-        mThreads.create(static_cast<ApplyConsHolder<Consumer>&>(*h));
+        const uint64_t w = mNumConsumers++;
+        mThreads.create(static_cast<ApplyConsHolder<Consumer>&>(*h), w, 0);
     }
     
     void sync(uint64_t pNumConsumers)
@@ -121,8 +180,9 @@ public:
         mQueue.sync(pNumConsumers);
     }
 
-    BackgroundMultiConsumer(uint64_t pNumBufItems)
-        : mQueue(pNumBufItems), mFinished(false), mJoined(false)
+    // pRing picks the kind of queue, as for BoundedQueue.
+    BackgroundMultiConsumer(uint64_t pNumBufItems, bool pRing = ThreadPlacement::process().ringQueues())
+        : mQueue(pNumBufItems, pRing), mNumConsumers(0), mFinished(false), mJoined(false)
     {
     }
 
@@ -142,6 +202,7 @@ private:
     BoundedQueue<value_type,true> mQueue;
     ThreadGroup mThreads;
     std::vector<HolderPtr> mHolders;
+    std::atomic<uint64_t> mNumConsumers;
     bool mFinished;
     bool mJoined;
 };
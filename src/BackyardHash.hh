@@ -407,6 +407,15 @@ public:
         return b;
     }
 
+    /**
+     * The approximate number of bytes required to hold a table with the given
+     * number of slots, plus two permutation vectors.
+     */
+    static uint64_t estimatedSizeForSlots(uint64_t pNumSlots)
+    {
+        return pNumSlots * (1.5 * sizeof(uint32_t) + sizeof(value_type));
+    }
+
     /**
      * The maximum number of slot bits available in a table (plus space for
      * two permutation vectors) not exceeding the given number of bytes.
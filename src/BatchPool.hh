@@ -0,0 +1,96 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef BATCHPOOL_HH
+#define BATCHPOOL_HH
+
+#ifndef STD_MEMORY
+#include <memory>
+#define STD_MEMORY
+#endif
+
+#ifndef STD_MUTEX
+#include <mutex>
+#define STD_MUTEX
+#endif
+
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
+#ifndef BOOST_NONCOPYABLE_HPP
+#include <boost/noncopyable.hpp>
+#define BOOST_NONCOPYABLE_HPP
+#endif
+
+// A pool of batches of reads. Batches go back to the pool when the last
+// reference is dropped, so once a pipeline is primed their storage is
+// reused and filling a batch does no allocation. Batches may outlive the
+// pool, in which case they are freed when released.
+//
+// Batch must be constructible from a capacity, and have clear().
+//
+template <typename Batch>
+class BatchPool : private boost::noncopyable
+{
+public:
+    typedef std::shared_ptr<Batch> BatchPtr;
+
+    // An empty batch, which returns to the pool when released.
+    BatchPtr get()
+    {
+        Batch* b = 0;
+        {
+            std::unique_lock<std::mutex> lk(mState->mutex);
+            if (!mState->free.empty())
+            {
+                b = mState->free.back();
+                mState->free.pop_back();
+            }
+        }
+        if (!b)
+        {
+            b = new Batch(mCapacity);
+        }
+        b->clear();
+        std::shared_ptr<State> st(mState);
+        return BatchPtr(b, [st] (Batch* pBatch) { st->put(pBatch); });
+    }
+
+    explicit BatchPool(uint64_t pCapacity = Batch::defaultCapacity)
+        : mCapacity(pCapacity), mState(std::make_shared<State>())
+    {
+    }
+
+private:
+    struct State
+    {
+        std::mutex mutex;
+        std::vector<Batch*> free;
+
+        void put(Batch* pBatch)
+        {
+            std::unique_lock<std::mutex> lk(mutex);
+            free.push_back(pBatch);
+        }
+
+        ~State()
+        {
+            for (auto b : free)
+            {
+                delete b;
+            }
+        }
+    };
+
+    const uint64_t mCapacity;
+    std::shared_ptr<State> mState;
+};
+
+#endif // BATCHPOOL_HH
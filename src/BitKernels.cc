@@ -0,0 +1,406 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "BitKernels.hh"
+#include "GossamerException.hh"
+#include "Utils.hh"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+// Compiled per function with target attributes, so that the rest of
+// the build needn't assume the extensions.
+#define GOSS_BIT_KERNELS_X86
+#include <immintrin.h>
+#define GOSS_TARGET(t) __attribute__((target(t)))
+#endif
+
+using namespace std;
+
+namespace // anonymous
+{
+    // The loop bodies are shared by the portable and POPCNT kernels;
+    // inlined into a function compiled for POPCNT, __builtin_popcountl
+    // becomes the instruction rather than a library call.
+
+    inline __attribute__((always_inline))
+    uint64_t popcountLoop(const uint64_t* pWords, uint64_t pNumWords)
+    {
+        uint64_t c0 = 0;
+        uint64_t c1 = 0;
+        uint64_t i = 0;
+        for (; i + 2 <= pNumWords; i += 2)
+        {
+            c0 += Gossamer::popcnt(pWords[i]);
+            c1 += Gossamer::popcnt(pWords[i + 1]);
+        }
+        if (i < pNumWords)
+        {
+            c0 += Gossamer::popcnt(pWords[i]);
+        }
+        return c0 + c1;
+    }
+
+    inline __attribute__((always_inline))
+    uint64_t selectWordLoop(const uint64_t* pWords, uint64_t pNumWords, bool pInvert, uint64_t& pRank)
+    {
+        const uint64_t m = pInvert ? ~uint64_t(0) : uint64_t(0);
+        for (uint64_t i = 0; i < pNumWords; ++i)
+        {
+            const uint64_t p = Gossamer::popcnt(pWords[i] ^ m);
+            if (pRank < p)
+            {
+                return i;
+            }
+            pRank -= p;
+        }
+        return pNumWords;
+    }
+
+    template <typename T>
+    inline __attribute__((always_inline))
+    uint64_t countLessLoop(const T* pItems, uint64_t pNumItems, T pValue)
+    {
+        uint64_t n = 0;
+        for (uint64_t i = 0; i < pNumItems; ++i)
+        {
+            n += pItems[i] < pValue;
+        }
+        return n;
+    }
+
+    inline __attribute__((always_inline))
+    uint64_t greaterMaskLoop(const uint8_t* pItems, uint64_t pNumItems, uint8_t pValue)
+    {
+        uint64_t m = 0;
+        for (uint64_t i = 0; i < pNumItems; ++i)
+        {
+            m |= uint64_t(pItems[i] > pValue) << i;
+        }
+        return m;
+    }
+
+    uint64_t popcountPortable(const uint64_t* pWords, uint64_t pNumWords)
+    {
+        return popcountLoop(pWords, pNumWords);
+    }
+
+    uint64_t selectWordPortable(const uint64_t* pWords, uint64_t pNumWords, bool pInvert, uint64_t& pRank)
+    {
+        return selectWordLoop(pWords, pNumWords, pInvert, pRank);
+    }
+
+    uint64_t countLess32Portable(const uint32_t* pItems, uint64_t pNumItems, uint32_t pValue)
+    {
+        return countLessLoop(pItems, pNumItems, pValue);
+    }
+
+    uint64_t countLess64Portable(const uint64_t* pItems, uint64_t pNumItems, uint64_t pValue)
+    {
+        return countLessLoop(pItems, pNumItems, pValue);
+    }
+
+    uint64_t greaterMask8Portable(const uint8_t* pItems, uint64_t pNumItems, uint8_t pValue)
+    {
+        return greaterMaskLoop(pItems, pNumItems, pValue);
+    }
+
+#ifdef GOSS_BIT_KERNELS_X86
+
+    GOSS_TARGET("popcnt")
+    uint64_t popcountPopcnt(const uint64_t* pWords, uint64_t pNumWords)
+    {
+        return popcountLoop(pWords, pNumWords);
+    }
+
+    GOSS_TARGET("popcnt")
+    uint64_t selectWordPopcnt(const uint64_t* pWords, uint64_t pNumWords, bool pInvert, uint64_t& pRank)
+    {
+        return selectWordLoop(pWords, pNumWords, pInvert, pRank);
+    }
+
+    // Deposit a single bit at the position of the pRank'th 1 of pWord.
+    GOSS_TARGET("bmi,bmi2")
+    uint64_t selectBmi2(uint64_t pWord, uint64_t pRank)
+    {
+        return _tzcnt_u64(_pdep_u64(uint64_t(1) << pRank, pWord));
+    }
+
+    // Count the bits of each nibble by table lookup (PSHUFB), adding up
+    // the byte counts (at most 8 per block of 4 words) for up to 31
+    // blocks before they could overflow.
+    GOSS_TARGET("avx2,popcnt")
+    uint64_t popcountAvx2(const uint64_t* pWords, uint64_t pNumWords)
+    {
+        const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                             0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i lowNibbles = _mm256_set1_epi8(0x0f);
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i acc = zero;
+        uint64_t i = 0;
+        while (i + 4 <= pNumWords)
+        {
+            const uint64_t e = std::min(pNumWords, i + 4 * 31);
+            __m256i bytes = zero;
+            for (; i + 4 <= e; i += 4)
+            {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pWords + i));
+                const __m256i lo = _mm256_and_si256(v, lowNibbles);
+                const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowNibbles);
+                bytes = _mm256_add_epi8(bytes, _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo),
+                                                               _mm256_shuffle_epi8(lut, hi)));
+            }
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(bytes, zero));
+        }
+        uint64_t c = _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1)
+                   + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+        for (; i < pNumWords; ++i)
+        {
+            c += _mm_popcnt_u64(pWords[i]);
+        }
+        return c;
+    }
+
+    // Unsigned comparisons, by flipping the sign bits.
+    GOSS_TARGET("avx2,popcnt")
+    uint64_t countLess32Avx2(const uint32_t* pItems, uint64_t pNumItems, uint32_t pValue)
+    {
+        const __m256i sign = _mm256_set1_epi32(int32_t(0x80000000));
+        const __m256i v = _mm256_xor_si256(_mm256_set1_epi32(int32_t(pValue)), sign);
+        uint64_t n = 0;
+        uint64_t i = 0;
+        for (; i + 8 <= pNumItems; i += 8)
+        {
+            const __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pItems + i)), sign);
+            n += _mm_popcnt_u32(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, x))));
+        }
+        for (; i < pNumItems; ++i)
+        {
+            n += pItems[i] < pValue;
+        }
+        return n;
+    }
+
+    GOSS_TARGET("avx2,popcnt")
+    uint64_t countLess64Avx2(const uint64_t* pItems, uint64_t pNumItems, uint64_t pValue)
+    {
+        const __m256i sign = _mm256_set1_epi64x(int64_t(0x8000000000000000ULL));
+        const __m256i v = _mm256_xor_si256(_mm256_set1_epi64x(int64_t(pValue)), sign);
+        uint64_t n = 0;
+        uint64_t i = 0;
+        for (; i + 4 <= pNumItems; i += 4)
+        {
+            const __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pItems + i)), sign);
+            n += _mm_popcnt_u32(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, x))));
+        }
+        for (; i < pNumItems; ++i)
+        {
+            n += pItems[i] < pValue;
+        }
+        return n;
+    }
+
+    // Two loads of 32 bytes for a full block of 64 items, which is the
+    // usual case; a short block is finished item by item.
+    GOSS_TARGET("avx2,popcnt")
+    uint64_t greaterMask8Avx2(const uint8_t* pItems, uint64_t pNumItems, uint8_t pValue)
+    {
+        const __m256i sign = _mm256_set1_epi8(int8_t(0x80));
+        const __m256i v = _mm256_xor_si256(_mm256_set1_epi8(int8_t(pValue)), sign);
+        uint64_t m = 0;
+        uint64_t i = 0;
+        for (; i + 32 <= pNumItems; i += 32)
+        {
+            const __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pItems + i)), sign);
+            m |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpgt_epi8(x, v)))) << i;
+        }
+        if (i < pNumItems)
+        {
+            m |= greaterMaskLoop(pItems + i, pNumItems - i, pValue) << i;
+        }
+        return m;
+    }
+
+    // The sum of the eight lanes, added by hand: GCC 12's
+    // _mm512_reduce_add_epi64 and _mm512_extracti64x4_epi64 set off
+    // -Wmaybe-uninitialized.
+    GOSS_TARGET("avx512f")
+    uint64_t sumLanesAvx512(__m512i pX)
+    {
+        uint64_t ls[8];
+        _mm512_storeu_si512(ls, pX);
+        return ls[0] + ls[1] + ls[2] + ls[3] + ls[4] + ls[5] + ls[6] + ls[7];
+    }
+
+    GOSS_TARGET("avx512f,avx512vpopcntdq,popcnt")
+    uint64_t popcountAvx512(const uint64_t* pWords, uint64_t pNumWords)
+    {
+        __m512i acc = _mm512_setzero_si512();
+        uint64_t i = 0;
+        for (; i + 8 <= pNumWords; i += 8)
+        {
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_loadu_si512(pWords + i)));
+        }
+        if (i < pNumWords)
+        {
+            const __mmask8 m = (1u << (pNumWords - i)) - 1;
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(m, pWords + i)));
+        }
+        return sumLanesAvx512(acc);
+    }
+
+    // Skip whole blocks of 8 words, then finish word by word.
+    GOSS_TARGET("avx512f,avx512vpopcntdq,popcnt")
+    uint64_t selectWordAvx512(const uint64_t* pWords, uint64_t pNumWords, bool pInvert, uint64_t& pRank)
+    {
+        const __m512i m = _mm512_set1_epi64(pInvert ? -1 : 0);
+        uint64_t i = 0;
+        for (; i + 8 <= pNumWords; i += 8)
+        {
+            const __m512i x = _mm512_xor_si512(_mm512_loadu_si512(pWords + i), m);
+            const uint64_t p = sumLanesAvx512(_mm512_popcnt_epi64(x));
+            if (pRank < p)
+            {
+                break;
+            }
+            pRank -= p;
+        }
+        return i + selectWordLoop(pWords + i, std::min<uint64_t>(pNumWords - i, 8), pInvert, pRank);
+    }
+
+    GOSS_TARGET("avx512f,popcnt")
+    uint64_t countLess32Avx512(const uint32_t* pItems, uint64_t pNumItems, uint32_t pValue)
+    {
+        const __m512i v = _mm512_set1_epi32(int32_t(pValue));
+        uint64_t n = 0;
+        uint64_t i = 0;
+        for (; i + 16 <= pNumItems; i += 16)
+        {
+            n += _mm_popcnt_u32(_mm512_cmplt_epu32_mask(_mm512_loadu_si512(pItems + i), v));
+        }
+        if (i < pNumItems)
+        {
+            const __mmask16 m = (1u << (pNumItems - i)) - 1;
+            n += _mm_popcnt_u32(_mm512_mask_cmplt_epu32_mask(m, _mm512_maskz_loadu_epi32(m, pItems + i), v));
+        }
+        return n;
+    }
+
+    GOSS_TARGET("avx512f,popcnt")
+    uint64_t countLess64Avx512(const uint64_t* pItems, uint64_t pNumItems, uint64_t pValue)
+    {
+        const __m512i v = _mm512_set1_epi64(int64_t(pValue));
+        uint64_t n = 0;
+        uint64_t i = 0;
+        for (; i + 8 <= pNumItems; i += 8)
+        {
+            n += _mm_popcnt_u32(_mm512_cmplt_epu64_mask(_mm512_loadu_si512(pItems + i), v));
+        }
+        if (i < pNumItems)
+        {
+            const __mmask8 m = (1u << (pNumItems - i)) - 1;
+            n += _mm_popcnt_u32(_mm512_mask_cmplt_epu64_mask(m, _mm512_maskz_loadu_epi64(m, pItems + i), v));
+        }
+        return n;
+    }
+
+#endif // GOSS_BIT_KERNELS_X86
+
+} // namespace anonymous
+
+BitKernels::Kernels BitKernels::sKernels = {
+    &popcountPortable,
+    0,
+    &selectWordPortable,
+    &countLess32Portable,
+    &countLess64Portable,
+    &greaterMask8Portable,
+    BitKernels::Portable
+};
+
+bool
+BitKernels::supported(Level pLevel)
+{
+    using namespace Gossamer;
+    switch (pLevel)
+    {
+        case Portable:
+            return true;
+#ifdef GOSS_BIT_KERNELS_X86
+        case Popcnt:
+            return cpuHas(kCpuPopcnt);
+        case Bmi2:
+            return supported(Popcnt) && cpuHas(kCpuBmi1) && cpuHas(kCpuBmi2);
+        case Avx2:
+            return supported(Bmi2) && cpuHas(kCpuAvx2);
+        case Avx512:
+            return supported(Avx2) && cpuHas(kCpuAvx512f) && cpuHas(kCpuAvx512Vpopcntdq);
+#endif
+        default:
+            return false;
+    }
+}
+
+BitKernels::Level
+BitKernels::best()
+{
+    Level l = Portable;
+    while (l + 1 < NumLevels && supported(Level(l + 1)))
+    {
+        l = Level(l + 1);
+    }
+    return l;
+}
+
+const char*
+BitKernels::name(Level pLevel)
+{
+    static const char* names[] = { "portable", "popcnt", "bmi2", "avx2", "avx512" };
+    return pLevel < NumLevels ? names[pLevel] : "unknown";
+}
+
+void
+BitKernels::use(Level pLevel)
+{
+    if (!supported(pLevel))
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << Gossamer::general_error_info(std::string("bit kernels for ")
+                                                    + name(pLevel) + " aren't supported on this machine."));
+    }
+
+    Kernels k = { &popcountPortable, 0, &selectWordPortable,
+                  &countLess32Portable, &countLess64Portable, &greaterMask8Portable, pLevel };
+#ifdef GOSS_BIT_KERNELS_X86
+    if (pLevel >= Popcnt)
+    {
+        k.popcount = &popcountPopcnt;
+        k.selectWord = &selectWordPopcnt;
+    }
+    if (pLevel >= Bmi2 && Gossamer::cpuHas(Gossamer::kCpuFastPdep))
+    {
+        k.select = &selectBmi2;
+    }
+    if (pLevel >= Avx2)
+    {
+        k.popcount = &popcountAvx2;
+        k.countLess32 = &countLess32Avx2;
+        k.countLess64 = &countLess64Avx2;
+        k.greaterMask8 = &greaterMask8Avx2;
+    }
+    if (pLevel >= Avx512)
+    {
+        k.popcount = &popcountAvx512;
+        k.selectWord = &selectWordAvx512;
+        k.countLess32 = &countLess32Avx512;
+        k.countLess64 = &countLess64Avx512;
+    }
+#endif
+    sKernels = k;
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef BITKERNELS_HH
+#define BITKERNELS_HH
+
+#ifndef STDINT_H
+#include <stdint.h>
+#define STDINT_H
+#endif
+
+#ifndef UTILS_HH
+#include "Utils.hh"
+#endif
+
+// The inner loops of rank, select and the sparse array search, with
+// versions for several instruction set extensions. The build targets
+// baseline x86-64, so the extensions are used through kernels compiled
+// for them separately, one of which is chosen for each operation when
+// the machine is set up (see MachineAutoSetup).
+//
+// Each level includes the kernels of the levels below it; the portable
+// kernels are used until setup() is called.
+//
+class BitKernels
+{
+public:
+    enum Level
+    {
+        Portable = 0,
+        Popcnt,             // POPCNT
+        Bmi2,               // and BMI1/BMI2: in-word select by PDEP/TZCNT,
+                            // where PDEP is fast (see kCpuFastPdep)
+        Avx2,               // and AVX2: range popcounts and searches
+        Avx512,             // and AVX-512F/VPOPCNTDQ
+        NumLevels
+    };
+
+    // The number of 1 bits in pWords[0..pNumWords).
+    static uint64_t popcount(const uint64_t* pWords, uint64_t pNumWords)
+    {
+        return sKernels.popcount(pWords, pNumWords);
+    }
+
+    // The position of the 1 bit of rank pRank (from 0) in pWord,
+    // which must have more than pRank 1 bits. Unless PDEP is in use,
+    // this is the portable select, inlined.
+    static uint64_t select(uint64_t pWord, uint64_t pRank)
+    {
+        if (sKernels.select)
+        {
+            return sKernels.select(pWord, pRank);
+        }
+        return Gossamer::select1(pWord, pRank);
+    }
+
+    // The index of the word in pWords[0..pNumWords) holding the 1 bit
+    // of rank pRank, counting 0 bits instead if pInvert is true.
+    // pRank is left as the rank within that word. If there are too
+    // few bits, returns pNumWords.
+    static uint64_t selectWord(const uint64_t* pWords, uint64_t pNumWords, bool pInvert, uint64_t& pRank)
+    {
+        return sKernels.selectWord(pWords, pNumWords, pInvert, pRank);
+    }
+
+    // The number of items in pItems[0..pNumItems) less than pValue.
+    // For sorted items, this is the offset of the lower bound.
+    static uint64_t countLess(const uint32_t* pItems, uint64_t pNumItems, uint32_t pValue)
+    {
+        return sKernels.countLess32(pItems, pNumItems, pValue);
+    }
+
+    static uint64_t countLess(const uint64_t* pItems, uint64_t pNumItems, uint64_t pValue)
+    {
+        return sKernels.countLess64(pItems, pNumItems, pValue);
+    }
+
+    // Bit i is set if pItems[i] is greater than pValue, for the items
+    // pItems[0..pNumItems), of which there may be at most 64.
+    static uint64_t greaterMask(const uint8_t* pItems, uint64_t pNumItems, uint8_t pValue)
+    {
+        return sKernels.greaterMask8(pItems, pNumItems, pValue);
+    }
+
+    // True if this machine can run the kernels of pLevel.
+    static bool supported(Level pLevel);
+
+    // The highest level this machine can run.
+    static Level best();
+
+    // The level in use.
+    static Level level()
+    {
+        return sKernels.level;
+    }
+
+    static const char* name(Level pLevel);
+
+    // Use the kernels of pLevel, which must be supported. This is not
+    // thread safe, and is meant for startup and tests.
+    static void use(Level pLevel);
+
+    // Use the best kernels for this machine.
+    static void setup()
+    {
+        use(best());
+    }
+
+private:
+    struct Kernels
+    {
+        uint64_t (*popcount)(const uint64_t*, uint64_t);
+        uint64_t (*select)(uint64_t, uint64_t);         // 0 for the inline one
+        uint64_t (*selectWord)(const uint64_t*, uint64_t, bool, uint64_t&);
+        uint64_t (*countLess32)(const uint32_t*, uint64_t, uint32_t);
+        uint64_t (*countLess64)(const uint64_t*, uint64_t, uint64_t);
+        uint64_t (*greaterMask8)(const uint8_t*, uint64_t, uint8_t);
+        Level level;
+    };
+
+    static Kernels sKernels;
+};
+
+#endif // BITKERNELS_HH
@@ -0,0 +1,295 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "BlockWriter.hh"
+
+#include "GossamerException.hh"
+
+#include <string.h>
+#include <bzlib.h>
+#include <zlib.h>
+
+using namespace std;
+using namespace boost;
+
+const uint64_t BlockWriter::gzipBlockSize;
+const uint64_t BlockWriter::bzip2BlockSize;
+
+namespace // anonymous
+{
+    // The fixed part of a BGZF block header: a gzip header with a
+    // 6 byte extra field holding the "BC" subfield.
+    const uint64_t gzipHeaderSize = 18;
+    const uint64_t gzipFooterSize = 8;
+
+    void put16(char* pOut, uint64_t pVal)
+    {
+        pOut[0] = static_cast<char>(pVal & 0xff);
+        pOut[1] = static_cast<char>((pVal >> 8) & 0xff);
+    }
+
+    void put32(char* pOut, uint64_t pVal)
+    {
+        put16(pOut, pVal & 0xffff);
+        put16(pOut + 2, (pVal >> 16) & 0xffff);
+    }
+
+    void gzipHeader(char* pOut, uint64_t pBlockSize)
+    {
+        static const unsigned char hdr[gzipHeaderSize - 2] = {
+            0x1f, 0x8b, 8, 4,   // magic, deflate, FEXTRA
+            0, 0, 0, 0,         // no mtime
+            0, 0xff,            // no extra flags, unknown OS
+            6, 0,               // XLEN
+            'B', 'C', 2, 0      // the BGZF subfield, of length 2
+        };
+        memcpy(pOut, hdr, sizeof(hdr));
+        put16(pOut + sizeof(hdr), pBlockSize - 1);
+    }
+
+    void gzipBlock(const string& pIn, string& pOut)
+    {
+        z_stream z;
+        memset(&z, 0, sizeof(z));
+        if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            BOOST_THROW_EXCEPTION(
+                Gossamer::error()
+                    << Gossamer::general_error_info("unable to initialise gzip compression"));
+        }
+        const uint64_t bound = deflateBound(&z, pIn.size());
+        pOut.resize(gzipHeaderSize + bound + gzipFooterSize);
+        z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pIn.data()));
+        z.avail_in = pIn.size();
+        z.next_out = reinterpret_cast<Bytef*>(&pOut[gzipHeaderSize]);
+        z.avail_out = bound;
+        const int r = deflate(&z, Z_FINISH);
+        const uint64_t n = z.total_out;
+        deflateEnd(&z);
+        if (r != Z_STREAM_END)
+        {
+            BOOST_THROW_EXCEPTION(
+                Gossamer::error()
+                    << Gossamer::general_error_info("gzip compression failed"));
+        }
+
+        const uint64_t z0 = gzipHeaderSize + n + gzipFooterSize;
+        pOut.resize(z0);
+        gzipHeader(&pOut[0], z0);
+        const uLong crc = crc32(crc32(0, Z_NULL, 0),
+                                reinterpret_cast<const Bytef*>(pIn.data()), pIn.size());
+        put32(&pOut[gzipHeaderSize + n], crc);
+        put32(&pOut[gzipHeaderSize + n + 4], pIn.size());
+    }
+
+    void bzip2Block(const string& pIn, string& pOut)
+    {
+        unsigned int len = pIn.size() + pIn.size() / 100 + 600;
+        pOut.resize(len);
+        const int r = BZ2_bzBuffToBuffCompress(&pOut[0], &len, const_cast<char*>(pIn.data()),
+                                               pIn.size(), 9, 0, 0);
+        if (r != BZ_OK)
+        {
+            BOOST_THROW_EXCEPTION(
+                Gossamer::error()
+                    << Gossamer::general_error_info("bzip2 compression failed"));
+        }
+        pOut.resize(len);
+    }
+} // namespace anonymous
+
+void
+BlockWriter::compress(Codec pCodec, const string& pIn, string& pOut)
+{
+    switch (pCodec)
+    {
+        case Gzip:
+        {
+            gzipBlock(pIn, pOut);
+            break;
+        }
+        case Bzip2:
+        {
+            bzip2Block(pIn, pOut);
+            break;
+        }
+    }
+}
+
+const string&
+BlockWriter::gzipEof()
+{
+    static const string eof = [] () {
+        string s;
+        gzipBlock(string(), s);
+        return s;
+    }();
+    return eof;
+}
+
+BlockWriter::BlockWriter(const string& pFileName, FileFactory::FileMode pMode,
+                         Codec pCodec, uint64_t pNumThreads)
+    : mFileName(pFileName), mCodec(pCodec),
+      mFile(mFileName.c_str(), (pMode == FileFactory::TruncMode ? ios::trunc : ios::app) | ios::binary),
+      mQueue(2 * std::max<uint64_t>(1, pNumThreads)),
+      mNextToWrite(0), mWriting(false),
+      mBuf(*this, pCodec == Gzip ? gzipBlockSize : bzip2BlockSize),
+      mStream(&mBuf)
+{
+    if (!mFile.good())
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << errinfo_errno(errno)
+                << errinfo_file_name(mFileName));
+    }
+    mFile.exceptions(std::ofstream::badbit);
+    mStream.exceptions(std::ostream::badbit);
+
+    for (uint64_t i = 0; i < std::max<uint64_t>(1, pNumThreads); ++i)
+    {
+        mThreads.create([this] () { compressor(); });
+    }
+}
+
+BlockWriter::~BlockWriter()
+{
+    // As with an ofstream, errors from here on are lost.
+    try
+    {
+        mBuf.cut();
+    }
+    catch (...)
+    {
+    }
+    mQueue.finish();
+    mThreads.join();
+    if (!mError && mCodec == Gzip)
+    {
+        try
+        {
+            mFile << gzipEof();
+        }
+        catch (...)
+        {
+        }
+    }
+}
+
+bool
+BlockWriter::failed()
+{
+    unique_lock<mutex> lk(mMutex);
+    return static_cast<bool>(mError);
+}
+
+void
+BlockWriter::compressor()
+{
+    BlockPtr b;
+    string out;
+    while (mQueue.get(b))
+    {
+        try
+        {
+            compress(mCodec, b->data, out);
+            b->data.swap(out);
+        }
+        catch (...)
+        {
+            unique_lock<mutex> lk(mMutex);
+            mError = std::current_exception();
+        }
+
+        unique_lock<mutex> lk(mMutex);
+        if (mError)
+        {
+            mDone.clear();
+            continue;
+        }
+        mDone[b->seq] = b;
+        b.reset();
+
+        // Whichever thread finds the next block ready writes it, and any
+        // which are ready after it.
+        if (mWriting)
+        {
+            continue;
+        }
+        mWriting = true;
+        while (!mError && !mDone.empty() && mDone.begin()->first == mNextToWrite)
+        {
+            BlockPtr w(mDone.begin()->second);
+            mDone.erase(mDone.begin());
+            ++mNextToWrite;
+            lk.unlock();
+            try
+            {
+                mFile.write(w->data.data(), w->data.size());
+            }
+            catch (...)
+            {
+                lk.lock();
+                mError = std::current_exception();
+                lk.unlock();
+            }
+            lk.lock();
+        }
+        mWriting = false;
+    }
+}
+
+BlockWriter::Buf::Buf(BlockWriter& pWriter, uint64_t pBlockSize)
+    : mWriter(pWriter), mBlockSize(pBlockSize), mNext(0)
+{
+    reset();
+}
+
+void
+BlockWriter::Buf::cut()
+{
+    const uint64_t n = pptr() - pbase();
+    if (n == 0)
+    {
+        return;
+    }
+    mBlock->data.resize(n);
+    mWriter.mQueue.put(mBlock);
+    reset();
+}
+
+BlockWriter::Buf::int_type
+BlockWriter::Buf::overflow(int_type pCh)
+{
+    if (mWriter.failed())
+    {
+        return traits_type::eof();
+    }
+    cut();
+    if (!traits_type::eq_int_type(pCh, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(pCh);
+        pbump(1);
+    }
+    return traits_type::not_eof(pCh);
+}
+
+int
+BlockWriter::Buf::sync()
+{
+    return mWriter.failed() ? -1 : 0;
+}
+
+void
+BlockWriter::Buf::reset()
+{
+    mBlock = std::make_shared<Block>();
+    mBlock->seq = mNext++;
+    mBlock->data.resize(mBlockSize);
+    setp(&mBlock->data[0], &mBlock->data[0] + mBlockSize);
+}
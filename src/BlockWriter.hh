@@ -0,0 +1,142 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef BLOCKWRITER_HH
+#define BLOCKWRITER_HH
+
+#ifndef BOUNDEDQUEUE_HH
+#include "BoundedQueue.hh"
+#endif
+
+#ifndef FILEFACTORY_HH
+#include "FileFactory.hh"
+#endif
+
+#ifndef THREADGROUP_HH
+#include "ThreadGroup.hh"
+#endif
+
+#ifndef STD_EXCEPTION
+#include <exception>
+#define STD_EXCEPTION
+#endif
+
+#ifndef STD_FSTREAM
+#include <fstream>
+#define STD_FSTREAM
+#endif
+
+#ifndef STD_MAP
+#include <map>
+#define STD_MAP
+#endif
+
+#ifndef STD_STRING
+#include <string>
+#define STD_STRING
+#endif
+
+#ifndef BOOST_NONCOPYABLE_HPP
+#include <boost/noncopyable.hpp>
+#define BOOST_NONCOPYABLE_HPP
+#endif
+
+// An output stream whose bytes are cut into blocks, which are compressed
+// and written to the file on background threads, so that the threads
+// producing the output only ever copy it into a buffer.
+//
+// Each block is compressed independently, and the compressed blocks are
+// written in order. For gzip, the blocks are BGZF blocks (as written by
+// bgzip), and for bzip2 each block is a complete bzip2 stream; in either
+// case the file is an ordinary multi-member file which any decompressor
+// reads.
+//
+// Flushing the stream does not cut a block, so frequent std::endl's do
+// not spoil the compression. Everything is written by the time the
+// writer is destroyed.
+//
+class BlockWriter : public FileFactory::OutHolder, private boost::noncopyable
+{
+public:
+    enum Codec { Gzip, Bzip2 };
+
+    // The largest amount of input BGZF allows in one block.
+    static const uint64_t gzipBlockSize = 65280;
+
+    static const uint64_t bzip2BlockSize = 900000;
+
+    virtual std::ostream& operator*()
+    {
+        return mStream;
+    }
+
+    // Compress a block on its own, as it would be written.
+    static void compress(Codec pCodec, const std::string& pIn, std::string& pOut);
+
+    // The BGZF end-of-file marker: an empty block.
+    static const std::string& gzipEof();
+
+    // Compress blocks on pNumThreads threads.
+    BlockWriter(const std::string& pFileName, FileFactory::FileMode pMode,
+                Codec pCodec, uint64_t pNumThreads);
+
+    ~BlockWriter();
+
+private:
+    struct Block
+    {
+        uint64_t seq;
+        std::string data;
+    };
+    typedef std::shared_ptr<Block> BlockPtr;
+
+    class Buf : public std::streambuf
+    {
+    public:
+        Buf(BlockWriter& pWriter, uint64_t pBlockSize);
+
+        // Hand over what has been written so far as a block.
+        void cut();
+
+    protected:
+        virtual int_type overflow(int_type pCh);
+
+        virtual int sync();
+
+    private:
+        void reset();
+
+        BlockWriter& mWriter;
+        const uint64_t mBlockSize;
+        BlockPtr mBlock;
+        uint64_t mNext;
+    };
+
+    bool failed();
+
+    void compressor();
+
+    const std::string mFileName;
+    const Codec mCodec;
+    std::ofstream mFile;
+
+    BoundedQueue<BlockPtr> mQueue;
+
+    // Compressed blocks waiting for the ones before them.
+    std::mutex mMutex;
+    std::map<uint64_t,BlockPtr> mDone;
+    uint64_t mNextToWrite;
+    bool mWriting;
+    std::exception_ptr mError;
+
+    ThreadGroup mThreads;
+    Buf mBuf;
+    std::ostream mStream;
+};
+
+#endif // BLOCKWRITER_HH
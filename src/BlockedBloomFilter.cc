@@ -0,0 +1,100 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "BlockedBloomFilter.hh"
+
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+constexpr uint64_t BlockedBloomFilter::version;
+const uint64_t BlockedBloomFilter::BlockWords;
+const uint64_t BlockedBloomFilter::MaxHashes;
+
+void
+BlockedBloomFilter::Builder::end()
+{
+    {
+        FileFactory::OutHolderPtr op(mFactory.out(mBaseName + ".header"));
+        (**op).write(reinterpret_cast<const char*>(&mHeader), sizeof(mHeader));
+    }
+    {
+        FileFactory::OutHolderPtr op(mFactory.out(mBaseName));
+        (**op).write(reinterpret_cast<const char*>(mBlocks.data()),
+                     mBlocks.size() * sizeof(Block));
+    }
+    vector<Block>().swap(mBlocks);
+}
+
+BlockedBloomFilter::Builder::Builder(const string& pBaseName, FileFactory& pFactory,
+                                     uint64_t pNumItems, uint64_t pBitsPerItem,
+                                     uint64_t pFingerprint)
+    : mBaseName(pBaseName), mFactory(pFactory)
+{
+    const uint64_t blockBits = BlockWords * 64;
+    pBitsPerItem = max<uint64_t>(pBitsPerItem, 1);
+
+    mHeader.version = version;
+    mHeader.numBlocks = max<uint64_t>(1, (pNumItems * pBitsPerItem + blockBits - 1) / blockBits);
+    // The usual optimum of ln 2 hashes per bit per item is a little high
+    // for blocked filters, whose blocks fill unevenly.
+    mHeader.numHashes = min<uint64_t>(MaxHashes, max<uint64_t>(1, floor(pBitsPerItem * 0.6)));
+    mHeader.count = 0;
+    mHeader.fingerprint = pFingerprint;
+
+    Block zero;
+    fill(zero.words, zero.words + BlockWords, 0);
+    mBlocks.resize(mHeader.numBlocks, zero);
+}
+
+PropertyTree
+BlockedBloomFilter::stat() const
+{
+    PropertyTree t;
+    t.putProp("count", count());
+    t.putProp("hashes", mHeader.numHashes);
+    t.putProp("storage", sizeof(Header) + mBlocks.size() * sizeof(Block));
+    return t;
+}
+
+void
+BlockedBloomFilter::remove(const string& pBaseName, FileFactory& pFactory)
+{
+    pFactory.remove(pBaseName + ".header");
+    pFactory.remove(pBaseName);
+}
+
+BlockedBloomFilter::Header
+BlockedBloomFilter::readHeader(const string& pBaseName, FileFactory& pFactory)
+{
+    Header h;
+    FileFactory::InHolderPtr ip(pFactory.in(pBaseName + ".header"));
+    (**ip).read(reinterpret_cast<char*>(&h), sizeof(h));
+    if (h.version != version)
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << boost::errinfo_file_name(pBaseName + ".header")
+                << Gossamer::version_mismatch_info(make_pair(version, h.version)));
+    }
+    return h;
+}
+
+BlockedBloomFilter::BlockedBloomFilter(const string& pBaseName, FileFactory& pFactory)
+    : mHeader(readHeader(pBaseName, pFactory)),
+      mBlocks(pBaseName, pFactory)
+{
+    if (mBlocks.size() != mHeader.numBlocks)
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << boost::errinfo_file_name(pBaseName)
+                << Gossamer::general_error_info("Bloom filter is the wrong size."));
+    }
+}
@@ -0,0 +1,161 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef BLOCKEDBLOOMFILTER_HH
+#define BLOCKEDBLOOMFILTER_HH
+
+#ifndef GOSSAMEREXCEPTION_HH
+#include "GossamerException.hh"
+#endif
+
+#ifndef MAPPEDARRAY_HH
+#include "MappedArray.hh"
+#endif
+
+#ifndef RANKSELECT_HH
+#include "RankSelect.hh"
+#endif
+
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
+// A Bloom filter over k-mers in which all the bits for a k-mer fall in
+// one 64 byte block, so that a query touches a single cache line. It is
+// used as a prefilter in front of a SparseArray, where most queries are
+// expected to miss: a negative answer is definite, a positive answer
+// means the k-mer must be looked up properly.
+//
+class BlockedBloomFilter
+{
+public:
+    static constexpr uint64_t version = 2016112101ULL;
+    // Version history
+    // 2016112101   - initial version
+
+    static const uint64_t BlockWords = 8;
+    static const uint64_t MaxHashes = 7;
+
+    struct Header
+    {
+        uint64_t version;
+        uint64_t numBlocks;
+        uint64_t numHashes;
+        uint64_t count;
+        uint64_t fingerprint;
+    };
+
+    struct Block
+    {
+        uint64_t words[BlockWords];
+    };
+
+    class Builder
+    {
+    public:
+        void push_back(const Gossamer::position_type& pItem)
+        {
+            const uint64_t h = hash(pItem);
+            Block& b(mBlocks[block(h, mHeader.numBlocks)]);
+            uint64_t g = bits(h);
+            for (uint64_t i = 0; i < mHeader.numHashes; ++i, g >>= 9)
+            {
+                b.words[(g >> 6) & 7] |= 1ULL << (g & 63);
+            }
+            ++mHeader.count;
+        }
+
+        void end();
+
+        // Build a filter for about pNumItems items, using pBitsPerItem
+        // bits for each. pFingerprint identifies the set the filter is
+        // for, so that it can be checked when the filter is opened.
+        Builder(const std::string& pBaseName, FileFactory& pFactory,
+                uint64_t pNumItems, uint64_t pBitsPerItem, uint64_t pFingerprint);
+
+    private:
+        const std::string mBaseName;
+        FileFactory& mFactory;
+        Header mHeader;
+        std::vector<Block> mBlocks;
+    };
+
+    // Returns false if pItem is definitely not in the set.
+    bool mayContain(const Gossamer::position_type& pItem) const
+    {
+        const uint64_t h = hash(pItem);
+        const Block& b(mBlocks[block(h, mHeader.numBlocks)]);
+        uint64_t g = bits(h);
+        for (uint64_t i = 0; i < mHeader.numHashes; ++i, g >>= 9)
+        {
+            if (!(b.words[(g >> 6) & 7] & (1ULL << (g & 63))))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The number of items added to the filter.
+    uint64_t count() const
+    {
+        return mHeader.count;
+    }
+
+    // The fingerprint of the set the filter was built for.
+    uint64_t fingerprint() const
+    {
+        return mHeader.fingerprint;
+    }
+
+    PropertyTree stat() const;
+
+    static bool exists(const std::string& pBaseName, FileFactory& pFactory)
+    {
+        return pFactory.exists(pBaseName + ".header");
+    }
+
+    static void remove(const std::string& pBaseName, FileFactory& pFactory);
+
+    BlockedBloomFilter(const std::string& pBaseName, FileFactory& pFactory);
+
+private:
+    static uint64_t hash(const Gossamer::position_type& pItem)
+    {
+        const Gossamer::position_type::value_type v(pItem.value());
+        std::pair<const uint64_t*,const uint64_t*> w(v.words());
+        uint64_t h = 0x9e3779b97f4a7c13ULL;
+        for (const uint64_t* i = w.first; i != w.second; ++i)
+        {
+            h = (h ^ *i) * 0xff51afd7ed558ccdULL;
+            h ^= h >> 32;
+        }
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 29;
+        return h;
+    }
+
+    static uint64_t block(uint64_t pHash, uint64_t pNumBlocks)
+    {
+        return (pHash >> 32) % pNumBlocks;
+    }
+
+    // Nine bits (a position in a 512 bit block) for each hash function.
+    static uint64_t bits(uint64_t pHash)
+    {
+        return pHash * 0x9e3779b97f4a7c13ULL;
+    }
+
+    static Header readHeader(const std::string& pBaseName, FileFactory& pFactory);
+
+    const Header mHeader;
+    MappedArray<Block> mBlocks;
+};
+
+#endif // BLOCKEDBLOOMFILTER_HH
@@ -39,6 +39,11 @@
 #define STD_ALGORITHM
 #endif
 
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
 #ifndef DEQUE_HH
 #include "Deque.hh"
 #endif
@@ -51,6 +56,24 @@
 #include "Profile.hh"
 #endif
 
+#ifndef RINGQUEUE_HH
+#include "RingQueue.hh"
+#endif
+
+#ifndef THREADPLACEMENT_HH
+#include "ThreadPlacement.hh"
+#endif
+
+// A queue of at most a fixed number of items, guarded by a mutex.
+// Producers and consumers which can move several items at a time should
+// use the batched put and get, which take the lock once per batch.
+//
+// If it is made with pRing set, which by default it is on machines
+// with many processors (see ThreadPlacement::ringQueues), the items go
+// through a lock-free RingQueue instead, and the mutex is not used.
+// The ring holds the maximum number of items rounded up to a power of
+// two.
+//
 template <typename T, bool W = false>
 class BoundedQueue
 {
@@ -61,6 +84,11 @@ public:
      */
     void put(const T& pItem)
     {
+        if (mRing)
+        {
+            mRing->put(pItem);
+            return;
+        }
         Profile::Context pc("BoundedQueue::put");
         {
             std::unique_lock<std::mutex> lock(mMutex);
@@ -68,7 +96,9 @@ public:
             {
                 Profile::Context pc("BoundedQueue::put::wait");
                 mFullWaits++;
+                ++mFullWaiters;
                 mFullCond.wait(lock);
+                --mFullWaiters;
             }
             mItems.push_back(pItem);
             if (mWaiters > 0)
@@ -78,6 +108,41 @@ public:
         }
     }
 
+    /**
+     * Put the items [pBegin, pEnd) on to the shared queue, in order,
+     * as many at a time as there is room for.
+     */
+    void put(const T* pBegin, const T* pEnd)
+    {
+        if (mRing)
+        {
+            mRing->put(pBegin, pEnd);
+            return;
+        }
+        Profile::Context pc("BoundedQueue::put");
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (pBegin < pEnd)
+        {
+            while (mItems.size() == mMaxItems)
+            {
+                Profile::Context pc("BoundedQueue::put::wait");
+                mFullWaits++;
+                ++mFullWaiters;
+                mFullCond.wait(lock);
+                --mFullWaiters;
+            }
+            const uint64_t n = std::min<uint64_t>(pEnd - pBegin, mMaxItems - mItems.size());
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                mItems.push_back(*pBegin++);
+            }
+            if (mWaiters > 0)
+            {
+                mEmptyCond.notify_all();
+            }
+        }
+    }
+
     /**
      * Get an item from the shared queue.
      * If there are no items, then wait for an item to arrive.
@@ -86,6 +151,10 @@ public:
      */
     bool get(T& pItem)
     {
+        if (mRing)
+        {
+            return mRing->get(pItem);
+        }
         Profile::Context pc("BoundedQueue::get");
         std::unique_lock<std::mutex> lock(mMutex);
         while (mItems.size() == 0 && !mFinished)
@@ -106,7 +175,7 @@ public:
             return false;
         }
         BOOST_ASSERT(mItems.size());
-        if (mItems.size() == mMaxItems)
+        if (mFullWaiters > 0)
         {
             mFullCond.notify_one();
         }
@@ -115,24 +184,79 @@ public:
         return true;
     }
 
+    /**
+     * Get some items from the shared queue: no more than a pShare'th
+     * of those waiting, but at least one. Otherwise as get().
+     */
+    bool get(std::vector<T>& pItems, uint64_t pShare)
+    {
+        if (mRing)
+        {
+            return mRing->get(pItems, pShare);
+        }
+        Profile::Context pc("BoundedQueue::get");
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (mItems.size() == 0 && !mFinished)
+        {
+            Profile::Context pc("BoundedQueue::get::wait");
+            mEmptyWaits++;
+            ++mWaiters;
+            if (W)
+            {
+                mWaitersCond.notify_one();
+            }
+            mEmptyCond.wait(lock);
+            --mWaiters;
+        }
+        if (mItems.size() == 0)
+        {
+            BOOST_ASSERT(mFinished);
+            return false;
+        }
+        const uint64_t n = std::max<uint64_t>(1, mItems.size() / std::max<uint64_t>(1, pShare));
+        pItems.resize(n);
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            std::swap(pItems[i], mItems.front());
+            mItems.pop_front();
+        }
+        if (mFullWaiters > 0)
+        {
+            mFullCond.notify_all();
+        }
+        return true;
+    }
+
     /**
      * Indicate there are no more items coming.
      */
     void finish()
     {
+        if (mRing)
+        {
+            mRing->finish();
+            return;
+        }
         std::unique_lock<std::mutex> lock(mMutex);
         mFinished = true;
         mEmptyCond.notify_all();
     }
 
     /**
-     * Block until pNumConsumers are blocked waiting for input.
+     * Block until pNumConsumers are blocked waiting for input, and
+     * there is none. (A consumer which has been woken for an item is
+     * still counted until it takes it.)
      */
     void sync(uint64_t pNumConsumers)
     {
         BOOST_ASSERT(W);
+        if (mRing)
+        {
+            mRing->sync(pNumConsumers);
+            return;
+        }
         std::unique_lock<std::mutex> lock(mMutex);
-        while (mWaiters < pNumConsumers)
+        while (mItems.size() > 0 || mWaiters < pNumConsumers)
         {
             mWaitersCond.wait(lock);
         }
@@ -143,15 +267,26 @@ public:
      */
     PropertyTree stat() const
     {
+        if (mRing)
+        {
+            return mRing->stat();
+        }
         PropertyTree t;
         t.putProp("empty-waits", mEmptyWaits);
         t.putProp("full-waits", mFullWaits);
         return t;
     }
 
-    BoundedQueue(uint64_t pMaxItems)
-        : mMaxItems(pMaxItems), mFinished(false), mFullWaits(0), mEmptyWaits(0), mWaiters(0)
+    BoundedQueue(uint64_t pMaxItems, bool pRing = ThreadPlacement::process().ringQueues())
+        : mMaxItems(pMaxItems), mFinished(false), mFullWaits(0), mEmptyWaits(0), mWaiters(0),
+          mFullWaiters(0), mRing(pRing ? new RingQueue<T,W>(pMaxItems) : 0)
+    {
+    }
+
+    // True iff the items go through a lock-free ring.
+    bool ring() const
     {
+        return mRing != nullptr;
     }
 
 private:
@@ -165,6 +300,8 @@ private:
     uint64_t mFullWaits;
     uint64_t mEmptyWaits;
     uint64_t mWaiters;
+    uint64_t mFullWaiters;
+    const std::unique_ptr<RingQueue<T,W> > mRing;
 };
 
 #endif // BOUNDEDQUEUE_HH
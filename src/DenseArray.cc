@@ -37,7 +37,7 @@ DenseSelect::DenseSelect(const WordyBitVector& pBitVector,
             const string& pBaseName, FileFactory& pFactory,
             bool pInvertSense)
     : mBitVector(pBitVector),
-      mFileHolder(pFactory.map(pBaseName)),
+      mFileHolder(pFactory.mapIndex(pBaseName)),
       mHeader(pInvertSense)
 {
     mData = reinterpret_cast<const uint8_t*>(mFileHolder->data());
@@ -781,7 +781,7 @@ DenseRank::Builder::flush()
 DenseRank::DenseRank(const WordyBitVector& pBitVector,
                      const string& pBaseName, FileFactory& pFactory)
     : mBitVector(pBitVector),
-      mFileHolder(pFactory.map(pBaseName))
+      mFileHolder(pFactory.mapIndex(pBaseName))
 {
     mData = reinterpret_cast<const uint8_t*>(mFileHolder->data());
     mHeader = *reinterpret_cast<const Header*>(mData);
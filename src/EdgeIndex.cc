@@ -6,14 +6,17 @@
 // you may not use this file except in compliance with the License.
 // Please see the file LICENSE, included with this distribution.
 //
-#include "BackgroundMultiConsumer.hh"
 #include "EdgeIndex.hh"
-#include "FixedWidthBitArray.hh"
+#include "ThreadGroup.hh"
+
+#include <atomic>
+#include <boost/lexical_cast.hpp>
 
 using namespace boost;
 using namespace std;
 
 constexpr uint64_t EdgeIndex::version;
+const EdgeIndex::PathId EdgeIndex::multiPath;
 
 namespace { // anonymous
     class EdgeCollector
@@ -34,23 +37,29 @@ namespace { // anonymous
         vector<uint64_t>& mRanks;
     };
 
+    // Index the linear segments whose entry edges have ranks in a range.
+    // Each segment's edges have distinct ranks, so indexers working on
+    // different ranges never write to the same element.
     class SegmentIndexer
     {
     public:
         
-        void push_back(uint64_t pRank)
+        void operator()(uint64_t pBegin, uint64_t pEnd)
         {
-            mRanks.clear();
-            Graph::Edge e(mEntryEdges.select(pRank).value());
-            EdgeCollector vis(mRanks);
-            mGraph.linearPath(e, vis);
-            for (uint64_t i = 0; i < mRanks.size(); ++i)
+            for (uint64_t seg = pBegin; seg < pEnd; ++seg)
             {
-                uint64_t r(mRanks[i]);
-                if (!(r & mMask))
+                mRanks.clear();
+                Graph::Edge e(mEntryEdges.select(seg).value());
+                EdgeCollector vis(mRanks);
+                mGraph.linearPath(e, vis);
+                for (uint64_t i = 0; i < mRanks.size(); ++i)
                 {
-                    BOOST_ASSERT((r >> mDiv) < mSegmentIndex.size());
-                    mSegmentIndex[r >> mDiv] = EdgeIndex::SegmentAndOffset(pRank, i);
+                    uint64_t r(mRanks[i]);
+                    if (!(r & mMask))
+                    {
+                        BOOST_ASSERT((r >> mDiv) < mSegmentIndex.size());
+                        mSegmentIndex[r >> mDiv] = EdgeIndex::SegmentAndOffset(seg, i);
+                    }
                 }
             }
         }
@@ -74,7 +83,17 @@ namespace { // anonymous
         vector<uint64_t> mRanks;
     };
 
-    typedef std::shared_ptr<SegmentIndexer> SegmentIndexerPtr;
+    const uint64_t segmentChunkSize = 4096;
+    bool readHeader(const string& pName, FileFactory& pFactory, EdgeIndex::Header& pHeader)
+    {
+        if (!pFactory.exists(pName + ".header"))
+        {
+            return false;
+        }
+        FileFactory::InHolderPtr ip(pFactory.in(pName + ".header"));
+        (**ip).read(reinterpret_cast<char*>(&pHeader), sizeof(pHeader));
+        return (**ip).good();
+    }
 
 } // namespace anonymous
 
@@ -90,34 +109,23 @@ EdgeIndex::write(const std::string& pBaseName, FileFactory& pFactory) const
         Header h;
         h.version = version;
         h.div = mDiv;
+        h.graphFingerprint = mGraphFingerprint;
+        h.superGraphFingerprint = mSuperGraphFingerprint;
         o.write(reinterpret_cast<const char*>(&h), sizeof(h));
     }
 
     // mSegmentIndex
     {
-        MappedArray<uint64_t>::Builder segArr(name + ".segs", pFactory);
-        for (SegmentIndex::const_iterator
-             i = mSegmentIndex.begin(); i != mSegmentIndex.end(); ++i)
-        {
-            segArr.push_back(i->first);
-            segArr.push_back(i->second);
-        }
-        segArr.end();
+        FileFactory::OutHolderPtr op(pFactory.out(name + ".segs"));
+        (**op).write(reinterpret_cast<const char*>(mSegmentIndex),
+                     (1 + (mGraph.count() >> mDiv)) * sizeof(SegmentAndOffset));
     }
 
     // mPathIndex
     {
-        MappedArray<uint32_t>::Builder pathArr(name + ".paths", pFactory);
-        FixedWidthBitArray<1>::Builder multiArr(name + ".multi", pFactory);
-        for (uint64_t i = 0; i < mPathIndex.size(); ++i)
-        {
-            const PathIdAndOffset& x(mPathIndex[i]);
-            pathArr.push_back(x.first);
-            pathArr.push_back(x.second);
-            multiArr.push_back(mMulti[i]);
-        }
-        pathArr.end();
-        multiArr.end();
+        FileFactory::OutHolderPtr op(pFactory.out(name + ".paths"));
+        (**op).write(reinterpret_cast<const char*>(mPathIndex),
+                     mNumPaths * sizeof(PathIdAndOffset));
     }
 }
 
@@ -128,66 +136,65 @@ EdgeIndex::read(const std::string& pBaseName, FileFactory& pFactory, const Graph
 
     // mHeader
     Header h;
+    if (!readHeader(name, pFactory, h))
     {
-        FileFactory::InHolderPtr ip;
-        try 
-        {
-            ip = pFactory.in(name + ".header");
-        }
-        catch (...)
-        {
-            BOOST_THROW_EXCEPTION(
-                Gossamer::error()
-                    << Gossamer::general_error_info("No edge index header file found.")
-                    << Gossamer::version_mismatch_info(make_pair(SuperGraph::version, 0)));
-        }
-        (**ip).read(reinterpret_cast<char*>(&h), sizeof(h));
-        if (h.version != EdgeIndex::version)
-        {
-            BOOST_THROW_EXCEPTION(
-                Gossamer::error()
-                    << boost::errinfo_file_name(name + ".header")
-                    << Gossamer::version_mismatch_info(make_pair(EdgeIndex::version, h.version)));
-        }
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << Gossamer::general_error_info("No edge index header file found.")
+                << Gossamer::version_mismatch_info(make_pair(EdgeIndex::version, 0)));
+    }
+    if (h.version != EdgeIndex::version)
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << boost::errinfo_file_name(name + ".header")
+                << Gossamer::version_mismatch_info(make_pair(EdgeIndex::version, h.version)));
     }
     
     unique_ptr<EdgeIndex> ix(new EdgeIndex(pGraph, h.div));
+    ix->mGraphFingerprint = h.graphFingerprint;
+    ix->mSuperGraphFingerprint = h.superGraphFingerprint;
+    ix->mapSegmentIndex(name, pFactory);
+    ix->mapPathIndex(name, pFactory);
+    return ix;
+}
 
-    // mSegmentIndex
+unique_ptr<EdgeIndex>
+EdgeIndex::open(const std::string& pBaseName, FileFactory& pFactory,
+                const Graph& pGraph, const EntryEdgeSet& pEntryEdges,
+                const SuperGraph& pSuper, uint64_t pDiv,
+                uint64_t pNumThreads, Logger& pLog)
+{
+    string name = pBaseName + "-edge-index";
+
+    Header h;
+    if (!readHeader(name, pFactory, h))
     {
-        
-        MappedArray<uint64_t>::LazyIterator segItr(name + ".segs", pFactory);
-        while (segItr.valid())
-        {
-            SegmentAndOffset so;
-            so.first = *segItr;
-            ++segItr;
-            so.second = *segItr;
-            ++segItr;
-            ix->mSegmentIndex.push_back(so);
-        }
+        return create(pGraph, pEntryEdges, pSuper, pDiv, pNumThreads, pLog);
     }
 
-    // mPathIndex
+    const uint64_t gfp = fingerprint(pGraph, pEntryEdges);
+    if (h.version != version || h.div != pDiv || h.graphFingerprint != gfp)
     {
-        MappedArray<uint32_t>::LazyIterator pathItr(name + ".paths", pFactory);
-        FixedWidthBitArray<1>::LazyIterator multiItr(FixedWidthBitArray<1>::lazyIterator(name + ".multi", pFactory));
-        const uint64_t sz(pathItr.size());
-        uint64_t i = 0;
-        ix->mPathIndex.resize(sz, PathIdAndOffset(0, 0));
-        ix->mMulti.resize(sz);
-        while (pathItr.valid())
-        {
-            PathId id(*pathItr);
-            ++pathItr;
-            SegmentOffset ofs(*pathItr);
-            ++pathItr;
-            ix->mPathIndex[i] = PathIdAndOffset(id, ofs);
-            ix->mMulti[i] = *multiItr;
-            ++multiItr;
-        }
+        LOG(pLog, info) << "saved edge index does not match the graph";
+        return create(pGraph, pEntryEdges, pSuper, pDiv, pNumThreads, pLog);
     }
 
+    unique_ptr<EdgeIndex> ix(new EdgeIndex(pGraph, pDiv));
+    ix->mGraphFingerprint = gfp;
+    ix->mSuperGraphFingerprint = fingerprint(pSuper);
+    LOG(pLog, info) << "mapping saved segment index";
+    ix->mapSegmentIndex(name, pFactory);
+    if (h.superGraphFingerprint == ix->mSuperGraphFingerprint)
+    {
+        LOG(pLog, info) << "mapping saved path index";
+        ix->mapPathIndex(name, pFactory);
+    }
+    else
+    {
+        LOG(pLog, info) << "supergraph has changed; constructing path index";
+        ix->buildPathIndex(pEntryEdges, pSuper);
+    }
     return ix;
 }
 
@@ -199,31 +206,97 @@ EdgeIndex::create(const Graph& pGraph, const EntryEdgeSet& pEntryEdges,
     BOOST_ASSERT(pEntryEdges.count() < numeric_limits<SegmentRank>::max());
 
     unique_ptr<EdgeIndex> ix(new EdgeIndex(pGraph, pDiv));
-    uint64_t numEdges = 1 + (pGraph.count() >> pDiv);
-    ix->mSegmentIndex.resize(numEdges);
+    ix->mGraphFingerprint = fingerprint(pGraph, pEntryEdges);
+    ix->mSuperGraphFingerprint = fingerprint(pSuper);
 
-    // Construct the segment index.
     LOG(pLog, info) << "constructing segment index";
+    ix->buildSegmentIndex(pEntryEdges, pNumThreads);
 
-    BackgroundMultiConsumer<uint64_t> grp(128);
-    vector<SegmentIndexerPtr> indexers;
-    for (uint64_t i = 0; i < pNumThreads; ++i) 
-    {       
-        indexers.push_back(SegmentIndexerPtr(
-                            new SegmentIndexer(pGraph, ix->mSegmentIndex, pEntryEdges, pDiv)));
-        grp.add(*indexers.back());
-    }               
+    LOG(pLog, info) << "constructing path index";
+    ix->buildPathIndex(pEntryEdges, pSuper);
 
-    for (uint64_t seg = 0; seg < pEntryEdges.count(); ++seg)
+    LOG(pLog, info) << "completed edge index construction";
+
+    return ix;
+}
+
+uint64_t
+EdgeIndex::fingerprint(const Graph& pGraph, const EntryEdgeSet& pEntryEdges)
+{
+    Fingerprint f;
+    f.push_back(pGraph.fingerprint());
+    f.push_back(pEntryEdges.fingerprint());
+    return f.value();
+}
+
+uint64_t
+EdgeIndex::fingerprint(const SuperGraph& pSuper)
+{
+    // The paths are all in memory, so this costs no more than reading
+    // them did.
+    const uint64_t n = pSuper.size();
+    Fingerprint f;
+    f.push_back(n);
+    f.push_back(pSuper.count());
+    for (uint64_t id = 0; id < n; ++id)
     {
-        grp.push_back(seg);
+        const SuperPathId i(id);
+        if (!pSuper.valid(i))
+        {
+            continue;
+        }
+        f.push_back(id);
+        const vector<SuperPath::Segment>& seg(pSuper[i].segments());
+        for (uint64_t j = 0; j < seg.size(); ++j)
+        {
+            f.push_back(static_cast<uint64_t>(seg[j]));
+        }
     }
-    grp.wait();
+    return f.value();
+}
+
+void
+EdgeIndex::buildSegmentIndex(const EntryEdgeSet& pEntryEdges, uint64_t pNumThreads)
+{
+    const uint64_t numEdges = 1 + (mGraph.count() >> mDiv);
+    mSegmentVec.resize(numEdges);
 
-    // Construct the path index.
+    // Hand out chunks of consecutive segments to the threads.
+    const uint64_t numSegs = pEntryEdges.count();
+    atomic<uint64_t> next(0);
+    auto worker = [&] () {
+        SegmentIndexer indexer(mGraph, mSegmentVec, pEntryEdges, mDiv);
+        uint64_t b;
+        while ((b = next.fetch_add(segmentChunkSize)) < numSegs)
+        {
+            indexer(b, min(b + segmentChunkSize, numSegs));
+        }
+    };
+    ThreadGroup threads;
+    for (uint64_t i = 1; i < pNumThreads; ++i)
+    {
+        threads.create(worker);
+    }
+    worker();
+    threads.join();
+
+    mSegmentArr.reset();
+    mSegmentIndex = mSegmentVec.data();
+}
+
+void
+EdgeIndex::buildPathIndex(const EntryEdgeSet& pEntryEdges, const SuperGraph& pSuper)
+{
+    // The path ids must fit in a PathId, short of the reserved multiPath.
+    if (pSuper.size() > multiPath)
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << Gossamer::general_error_info("Too many super paths for the edge index: "
+                        + lexical_cast<string>(pSuper.size())));
+    }
 
     // First, we count the number of times each segment is referenced.
-    LOG(pLog, info) << "counting segments";
     const uint64_t numEntryEdges(pEntryEdges.count());
     vector<uint32_t> segCounts(numEntryEdges, 0);
     for (SuperGraph::PathIterator i(pSuper); i.valid(); ++i)
@@ -240,9 +313,8 @@ EdgeIndex::create(const Graph& pGraph, const EntryEdgeSet& pEntryEdges,
     }
 
     // Using the segment use counts, we can index those that are unique
-    LOG(pLog, info) << "constructing path index";
-    ix->mPathIndex.resize(numEntryEdges);
-    ix->mMulti.resize(numEntryEdges);
+    mPathVec.clear();
+    mPathVec.resize(numEntryEdges, PathIdAndOffset(0, 0));
     for (SuperGraph::PathIterator i(pSuper); i.valid(); ++i)
     {
         const SuperPath p = pSuper[*i];
@@ -255,12 +327,11 @@ EdgeIndex::create(const Graph& pGraph, const EntryEdgeSet& pEntryEdges,
             {
                 if (segCounts[s] != 1)
                 {
-                    ix->mMulti[s] = true;
+                    mPathVec[s] = PathIdAndOffset(multiPath, 0);
                 }
                 else
                 {
-                    ix->mPathIndex[s] = PathIdAndOffset((*i).value(), l);
-                    // cerr << (*i).value() << '\t' << l << '\n';
+                    mPathVec[s] = PathIdAndOffset((*i).value(), l);
                 }
             }
             else if (s.isGap())
@@ -277,12 +348,40 @@ EdgeIndex::create(const Graph& pGraph, const EntryEdgeSet& pEntryEdges,
         }
     }
 
-    LOG(pLog, info) << "completed edge index construction";
+    mPathArr.reset();
+    mPathIndex = mPathVec.data();
+    mNumPaths = mPathVec.size();
+}
 
-    return ix;
+void
+EdgeIndex::mapSegmentIndex(const std::string& pName, FileFactory& pFactory)
+{
+    mSegmentArr = unique_ptr<MappedArray<SegmentAndOffset> >(
+                        new MappedArray<SegmentAndOffset>(pName + ".segs", pFactory));
+    if (mSegmentArr->size() != 1 + (mGraph.count() >> mDiv))
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << boost::errinfo_file_name(pName + ".segs")
+                << Gossamer::general_error_info("Edge index does not match the graph."));
+    }
+    SegmentIndex().swap(mSegmentVec);
+    mSegmentIndex = mSegmentArr->begin();
+}
+
+void
+EdgeIndex::mapPathIndex(const std::string& pName, FileFactory& pFactory)
+{
+    mPathArr = unique_ptr<MappedArray<PathIdAndOffset> >(
+                        new MappedArray<PathIdAndOffset>(pName + ".paths", pFactory));
+    PathIndex().swap(mPathVec);
+    mPathIndex = mPathArr->begin();
+    mNumPaths = mPathArr->size();
 }
 
 EdgeIndex::EdgeIndex(const Graph& pGraph, uint64_t pDiv)
-    : mDiv(pDiv), mGraph(pGraph), mSegmentIndex(), mPathIndex(), mMulti()
+    : mDiv(pDiv), mGraph(pGraph), mGraphFingerprint(0), mSuperGraphFingerprint(0),
+      mSegmentVec(), mSegmentArr(), mSegmentIndex(0),
+      mPathVec(), mPathArr(), mPathIndex(0), mNumPaths(0)
 {
 }
@@ -13,27 +13,36 @@
 #include "Graph.hh"
 #endif
 
+#ifndef MAPPEDARRAY_HH
+#include "MappedArray.hh"
+#endif
+
 #ifndef SUPERGRAPH_HH
 #include "SuperGraph.hh"
 #endif
 
-#ifndef BOOST_UNORDERED_MAP_HPP
-#include <boost/unordered_map.hpp>
-#define BOOST_UNORDERED_MAP_HPP
+#ifndef STD_MEMORY
+#include <memory>
+#define STD_MEMORY
 #endif
 
 class EdgeIndex
 {
 public:
-    static constexpr uint64_t version = 2011092301ULL;
+    static constexpr uint64_t version = 2016111501ULL;
     // Version history
     // 2011082901   - first readable/writable version
     // 2011092301   - changed PathIndex to a dense array
+    // 2016111501   - mappable segment and path indexes, with multiply
+    //                used segments marked in the path index; the header
+    //                records fingerprints of the graph and supergraph.
 
     struct Header
     {
         uint64_t version;
         uint64_t div;
+        uint64_t graphFingerprint;
+        uint64_t superGraphFingerprint;
     };
 
     typedef uint32_t PathId;
@@ -46,6 +55,11 @@ public:
     typedef std::pair<SuperPathId,SegmentOffset> SuperPathIdAndOffset;
     typedef std::vector<PathIdAndOffset> PathIndex;
 
+    // The path id recorded for segments used by more than one super path.
+    // It is reserved: supergraphs with paths of this id or higher can't
+    // be indexed.
+    static const PathId multiPath = ~PathId(0);
+
     /**
      * Iff pEdge is an edge in the graph, then bind pSegRank to the rank of
      * containing linear segment, bind offset to the distance from the start of the
@@ -95,13 +109,13 @@ public:
      */
     bool superpath(const uint64_t& pSegRank, SuperPathIdAndOffset& pInfo) const
     {
-        BOOST_ASSERT(pSegRank < mMulti.size());
-        if (mMulti[pSegRank])
+        BOOST_ASSERT(pSegRank < mNumPaths);
+        const PathIdAndOffset& x(mPathIndex[pSegRank]);
+        if (x.first == multiPath)
         {
             return false;
         }
 
-        const PathIdAndOffset& x(mPathIndex[pSegRank]);
         pInfo = std::make_pair(SuperPathId(x.first), x.second);
         return true;
     }
@@ -111,22 +125,62 @@ public:
      */
     void write(const std::string& pBaseName, FileFactory& pFactory) const;
 
+    /**
+     * Map a previously saved EdgeIndex.
+     */
     static std::unique_ptr<EdgeIndex> read(const std::string& pBaseName, FileFactory& pFactory,
                                          const Graph& pGraph);
 
+    /**
+     * Map the saved EdgeIndex for the given graph if there is one that
+     * matches the graph, supergraph and division, otherwise build it.
+     * If only the supergraph has changed, the segment index is mapped
+     * and just the path index is rebuilt.
+     */
+    static std::unique_ptr<EdgeIndex> open(const std::string& pBaseName, FileFactory& pFactory,
+                                         const Graph& pGraph, const EntryEdgeSet& pEntryEdges,
+                                         const SuperGraph& pSuper, uint64_t pDiv,
+                                         uint64_t pNumThreads, Logger& pLog);
+
     static std::unique_ptr<EdgeIndex> create(const Graph& pGraph, const EntryEdgeSet& pEntryEdges,
                                            const SuperGraph& pSuper, uint64_t pDiv, 
                                            uint64_t pNumThreads, Logger& pLog);
 
+    /**
+     * Fingerprints used to check that a saved index is still valid:
+     * one of the graph and its entry edges (see Graph::fingerprint()
+     * and EntryEdgeSet::fingerprint()), and one of all the supergraph's
+     * paths.
+     */
+    static uint64_t fingerprint(const Graph& pGraph, const EntryEdgeSet& pEntryEdges);
+    static uint64_t fingerprint(const SuperGraph& pSuper);
+
 private:
 
     EdgeIndex(const Graph& pGraph, uint64_t pDiv);
 
+    void buildSegmentIndex(const EntryEdgeSet& pEntryEdges, uint64_t pNumThreads);
+
+    void buildPathIndex(const EntryEdgeSet& pEntryEdges, const SuperGraph& pSuper);
+
+    void mapSegmentIndex(const std::string& pName, FileFactory& pFactory);
+
+    void mapPathIndex(const std::string& pName, FileFactory& pFactory);
+
     const uint64_t mDiv;
     const Graph& mGraph;
-    SegmentIndex mSegmentIndex;
-    PathIndex mPathIndex;
-    boost::dynamic_bitset<> mMulti;
+    uint64_t mGraphFingerprint;
+    uint64_t mSuperGraphFingerprint;
+
+    // The indexes are either built in memory or mapped from a file.
+    SegmentIndex mSegmentVec;
+    std::unique_ptr<MappedArray<SegmentAndOffset> > mSegmentArr;
+    const SegmentAndOffset* mSegmentIndex;
+
+    PathIndex mPathVec;
+    std::unique_ptr<MappedArray<PathIdAndOffset> > mPathArr;
+    const PathIdAndOffset* mPathIndex;
+    uint64_t mNumPaths;
 };
 
 #endif // EDGEINDEX_HH
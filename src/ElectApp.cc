@@ -89,13 +89,14 @@ namespace // anonymous
             const uint64_t N = M / (1.5 * sizeof(uint32_t) + sizeof(BackyardHash::value_type));
 
             log(info, "building reference kmer set");
-            GossCmdBuildKmerSet(mK, S, N, mT, mOut, mRefFastas, strings(), strings())(pCxt);
+            GossCmdBuildKmerSet(mK, S, N, mT, mOut, mRefFastas, strings(), strings(), mPrefilterBits)(pCxt);
 
             log(info, "total elapsed time: " + lexical_cast<string>(t.check()));
         }
 
-        ElectCmdIndex(const strings& pRefFasta, const string& pOut, uint64_t pK, double pM, uint64_t pT)
-            : mRefFastas(pRefFasta), mOut(pOut), mK(pK), mM(pM), mT(pT)
+        ElectCmdIndex(const strings& pRefFasta, const string& pOut, uint64_t pK, double pM, uint64_t pT,
+                      uint64_t pPrefilterBits)
+            : mRefFastas(pRefFasta), mOut(pOut), mK(pK), mM(pM), mT(pT), mPrefilterBits(pPrefilterBits)
         {
         }
 
@@ -105,6 +106,7 @@ namespace // anonymous
         const uint64_t mK;
         const double mM;
         const uint64_t mT;
+        const uint64_t mPrefilterBits;
     };
 
     class ElectCmdFactoryIndex : public GossCmdFactory
@@ -131,9 +133,12 @@ namespace // anonymous
             uint64_t T = 4;
             chk.getOptional("num-threads", T);
 
+            uint64_t prefilterBits = 0;
+            chk.getOptional("prefilter-bits", prefilterBits);
+
             chk.throwIfNecessary(pApp);
 
-            return GossCmdPtr(new ElectCmdIndex(refs, out, K, M, T));
+            return GossCmdPtr(new ElectCmdIndex(refs, out, K, M, T, prefilterBits));
         }
 
         ElectCmdFactoryIndex()
@@ -142,6 +147,7 @@ namespace // anonymous
             mCommonOptions.insert("ref-fasta");
             mCommonOptions.insert("max-memory");
             mCommonOptions.insert("kmer-size");
+            mCommonOptions.insert("prefilter-bits");
             mSpecificOptions.addOpt<string>("prefix", "P", "reference output prefix");
         }
     };
@@ -183,6 +189,7 @@ namespace // anonymous
                 GossCmdBuildKmerSet cmd(mK, S, N, pNumThreads, name);
                 GossRead::Iterator src(pRead, mK);
                 cmd(pCxt, src);
+                buildPrefilter(pCxt, name);
                 
                 KmerSetPtr kmerSetPtr = std::make_shared<KmerSet>(name, pCxt.fac);
                 if (mKmerSets.size() < (uint64_t(pId) + 1))
@@ -213,6 +220,7 @@ namespace // anonymous
 
                 GossCmdBuildKmerSet cmd(mK, S, N, pNumThreads, name);
                 cmd(pCxt, src);
+                buildPrefilter(pCxt, name);
                 
                 KmerSetPtr kmerSetPtr(new KmerSet(name, pCxt.fac));
                 if (mKmerSets.size() < (uint64_t(pId) + 1))
@@ -235,8 +243,8 @@ namespace // anonymous
                 mKmerSets[pId] = kmerSetPtr;
             }
 
-            KmerMap(const uint64_t pK)
-                : mK(pK), mKmerSets()
+            KmerMap(const uint64_t pK, uint64_t pPrefilterBits)
+                : mK(pK), mPrefilterBits(pPrefilterBits), mKmerSets()
             {
                 mKmerSets.reserve(64);
             }
@@ -244,7 +252,18 @@ namespace // anonymous
         private:
 
             // TODO: This ought to be a multimap from k to the sets at that k!
+            // Most k-mers of a read are missing from most references,
+            // so the references built here get a prefilter if asked.
+            void buildPrefilter(GossCmdContext& pCxt, const string& pName)
+            {
+                if (mPrefilterBits)
+                {
+                    KmerSet::buildPrefilter(pName, pCxt.fac, mPrefilterBits);
+                }
+            }
+
             const uint64_t mK;
+            const uint64_t mPrefilterBits;
             vector<KmerSetPtr> mKmerSets;
         };
 
@@ -608,7 +627,7 @@ namespace // anonymous
             GossCmdContext refCxt(*strFacPtr, pCxt.log, pCxt.cmdName, pCxt.opts);
 
             vector<string> refNames;
-            KmerMap kmerMap(mK);
+            KmerMap kmerMap(mK, mPrefilterBits);
             RefCompiler refCompiler(refCxt, mK, kmerMap, mNumThreads);
     
             refNames.reserve(mRefFastas.size());
@@ -673,13 +692,14 @@ namespace // anonymous
                       const strings& pFastas, const strings& pFastqs, const strings& pLines,
                       bool pPairs, double pMaxMemory, uint64_t pNumThreads,
                       const string& pMatchPrefix, const string& pNonmatchPrefix,
-                      bool pPreserveReadOrder, bool pSingleSeqRefs)
+                      bool pPreserveReadOrder, bool pSingleSeqRefs, uint64_t pPrefilterBits)
             : mK(pK), mRefThreshold(pRefThreshold == -1ULL ? pRefFastas.size() + pRefIndexes.size() : pRefThreshold),
               mRefFastas(pRefFastas), mRefIndexes(pRefIndexes),
               mFastas(pFastas), mFastqs(pFastqs), mLines(pLines), 
               mPairs(pPairs), mMaxMemory(pMaxMemory), mNumThreads(pNumThreads),
               mMatchPrefix(pMatchPrefix), mNonmatchPrefix(pNonmatchPrefix),
-              mPreserveReadOrder(pPreserveReadOrder), mSingleSeqRefs(pSingleSeqRefs)
+              mPreserveReadOrder(pPreserveReadOrder), mSingleSeqRefs(pSingleSeqRefs),
+              mPrefilterBits(pPrefilterBits)
         {
         }
 
@@ -698,6 +718,7 @@ namespace // anonymous
         const string mNonmatchPrefix;
         const bool mPreserveReadOrder;
         const bool mSingleSeqRefs;
+        const uint64_t mPrefilterBits;
     };
 
     class ElectCmdFactoryGroup : public GossCmdFactory
@@ -751,10 +772,13 @@ namespace // anonymous
             bool singleSeqRefs = false;
             chk.getOptional("single-sequence-refs", singleSeqRefs);
 
+            uint64_t prefilterBits = 0;
+            chk.getOptional("prefilter-bits", prefilterBits);
+
             chk.throwIfNecessary(pApp);
 
             return GossCmdPtr(new ElectCmdGroup(K, refThresh, fastaRefs, indexRefs, fastas, fastqs, lines, pairs, maxMem, T, 
-                                                match, nonmatch, ord, singleSeqRefs));
+                                                match, nonmatch, ord, singleSeqRefs, prefilterBits));
         }
 
         ElectCmdFactoryGroup()
@@ -766,6 +790,7 @@ namespace // anonymous
             mCommonOptions.insert("line-in");
             mCommonOptions.insert("max-memory");
             mCommonOptions.insert("kmer-size");
+            mCommonOptions.insert("prefilter-bits");
             
             mSpecificOptions.addOpt<bool>("pairs", "",
                     "treat reads as pairs");
@@ -808,7 +833,13 @@ ElectApp::ElectApp()
     globalOpts.addOpt<bool>("help", "h", "show a help message");
     globalOpts.addOpt<string>("log-file", "l", "place to write messages");
     globalOpts.addOpt<strings>("tmp-dir", "", "a directory to use for temporary files (default /tmp)");
-    globalOpts.addOpt<uint64_t>("num-threads", "T", "maximum number of worker threads to use, where possible");
+    globalOpts.addOpt<uint64_t>("num-threads", "T", "maximum number of worker threads to use, where possible, or 'auto' for one per processor");
+    globalOpts.addOpt<string>("map-access", "", "expected access pattern for mapped files: normal, sequential or random");
+    globalOpts.addOpt<bool>("map-interleave", "", "interleave mapped files across memory nodes");
+    globalOpts.addOpt<bool>("map-warm-up", "", "map files lazily, pre-faulting rank/select indexes in the background");
+    globalOpts.addOpt<bool>("no-huge-pages", "", "don't ask for huge pages for mapped files");
+    globalOpts.addOpt<bool>("pin-threads", "", "pin worker threads to processors, spreading them across memory nodes");
+    globalOpts.addOpt<string>("queues", "", "how threads pass work: locked, ring (lock-free) or auto (ring with more than 16 processors)");
     globalOpts.addOpt<bool>("verbose", "v", "show progress messages");
     globalOpts.addOpt<bool>("version", "V", "show the software version");
 
@@ -818,4 +849,6 @@ ElectApp::ElectApp()
     commonOpts.addOpt<strings>("line-in", "", "input file with one sequence per line");
     commonOpts.addOpt<double>("max-memory", "M", "maximum memory (in GB) to use");
     commonOpts.addOpt<uint64_t>("kmer-size", "K", "kmer size to use (default 25)");
+    commonOpts.addOpt<uint64_t>("prefilter-bits", "",
+            "build a Bloom filter using this many bits per k-mer for each reference, to speed up lookups of absent k-mers");
 }
@@ -11,6 +11,7 @@
 #include "Debug.hh"
 #include "GossamerException.hh"
 #include "ProgressMonitor.hh"
+#include "UnitigIndex.hh"
 #include "WorkQueue.hh"
 
 #include <boost/lambda/bind.hpp>
@@ -71,24 +72,36 @@ struct BatchBuilder
 
     void operator()()
     {
-        for (uint64_t r = mBegin; r != mEnd; ++r)
+        if (mUnitigs)
         {
-            Graph::Edge e = mGraph.select(r);
-            Graph::Node f = mGraph.from(e);
-            if (mGraph.inDegree(f) != 1 || mGraph.outDegree(f) != 1)
+            // The entry edges are the first edges of the unitigs.
+            for (uint64_t u = mBegin; u != mEnd; ++u)
             {
-                mEdges[r - mBegin] = true;
-
-                // Find the number of edges in the path, and its mean count.
-                PathVisitor vis(mGraph);
-                Graph::Edge x = mGraph.linearPath(e, vis);
-                uint32_t l = vis.length();
-                uint32_t c = (uint32_t) boost::math::round(vis.meanCount());
-                uint64_t rc = mGraph.rank(mGraph.reverseComplement(x));
-                mLengths.push_back(l);
-                mCounts.push_back(c);
-                mRCs.push_back(rc);
-                mHist[c]++;
+                const uint64_t b = mUnitigs->begin(u);
+                const uint64_t e = mUnitigs->end(u);
+                uint64_t countSum = 0;
+                for (uint64_t p = b; p != e; ++p)
+                {
+                    countSum += mGraph.multiplicity(mUnitigs->edge(p));
+                }
+                Graph::Edge x = mGraph.select(mUnitigs->edge(e - 1));
+                add(mUnitigs->edge(b), e - b, double(countSum) / double(e - b),
+                    mGraph.rank(mGraph.reverseComplement(x)));
+            }
+        }
+        else
+        {
+            for (uint64_t r = mBegin; r != mEnd; ++r)
+            {
+                Graph::Edge e = mGraph.select(r);
+                Graph::Node f = mGraph.from(e);
+                if (mGraph.inDegree(f) != 1 || mGraph.outDegree(f) != 1)
+                {
+                    // Find the number of edges in the path, and its mean count.
+                    PathVisitor vis(mGraph);
+                    Graph::Edge x = mGraph.linearPath(e, vis);
+                    add(r, vis.length(), vis.meanCount(), mGraph.rank(mGraph.reverseComplement(x)));
+                }
             }
         }
         
@@ -97,9 +110,14 @@ struct BatchBuilder
         mCond.notify_one();
     }
 
-    uint64_t size() const
+    void add(uint64_t pRank, uint32_t pLength, double pMeanCount, uint64_t pRcRank)
     {
-        return mEnd - mBegin;
+        uint32_t c = (uint32_t) boost::math::round(pMeanCount);
+        mRanks.push_back(pRank);
+        mLengths.push_back(pLength);
+        mCounts.push_back(c);
+        mRCs.push_back(pRcRank);
+        mHist[c]++;
     }
 
     uint64_t count() const
@@ -107,18 +125,20 @@ struct BatchBuilder
         return mCounts.size();
     }
 
-    BatchBuilder(const Graph& pGraph, uint64_t pBegin, uint64_t pEnd,
+    // pBegin and pEnd are edge ranks, or unitig numbers if pUnitigs is given.
+    BatchBuilder(const Graph& pGraph, const UnitigIndex* pUnitigs, uint64_t pBegin, uint64_t pEnd,
                  std::mutex& pMutex, std::condition_variable& pCond, uint64_t& pNumDone)
-        : mGraph(pGraph), mBegin(pBegin), mEnd(pEnd),
-          mEdges(pEnd - pBegin), mCounts(), mLengths(), mRCs(), mHist(),
+        : mGraph(pGraph), mUnitigs(pUnitigs), mBegin(pBegin), mEnd(pEnd),
+          mRanks(), mCounts(), mLengths(), mRCs(), mHist(),
           mNumDone(pNumDone), mMutex(pMutex), mCond(pCond)
     {
     }
  
     const Graph& mGraph;
+    const UnitigIndex* mUnitigs;
     const uint64_t mBegin;
     const uint64_t mEnd;
-    dynamic_bitset<> mEdges;
+    vector<uint64_t> mRanks;
     vector<uint32_t> mCounts;
     vector<uint32_t> mLengths;
     vector<uint64_t> mRCs;
@@ -140,8 +160,16 @@ EntryEdgeSet::Header::Header(const string& pFileName, FileFactory& pFactory)
 {
     FileFactory::InHolderPtr ip(pFactory.in(pFileName));
     istream& i(**ip);
-    i.read(reinterpret_cast<char*>(this), sizeof(Header));
-    if (version != EntryEdgeSet::version)
+    i.read(reinterpret_cast<char*>(this), sizeof(Header) - sizeof(fingerprint));
+    if (version == EntryEdgeSet::version)
+    {
+        i.read(reinterpret_cast<char*>(&fingerprint), sizeof(fingerprint));
+    }
+    else if (version == EntryEdgeSet::unfingerprintedVersion)
+    {
+        fingerprint = 0;
+    }
+    else
     {
         uint64_t v = EntryEdgeSet::version;
         BOOST_THROW_EXCEPTION(
@@ -153,7 +181,8 @@ EntryEdgeSet::Header::Header(const string& pFileName, FileFactory& pFactory)
 
 void
 EntryEdgeSet::build(const Graph& pGraph, const string& pBaseName, 
-                    FileFactory& pFactory, Logger& pLog, uint64_t pThreads)
+                    FileFactory& pFactory, Logger& pLog, uint64_t pThreads,
+                    const UnitigIndex* pUnitigs)
 {
     Logger& log(pLog);
     std::mutex mtx;
@@ -161,15 +190,16 @@ EntryEdgeSet::build(const Graph& pGraph, const string& pBaseName,
 
     LOG(log, info) << "Locating entry edges";
     const uint64_t numBatches(64 * pThreads);
-    const uint64_t batchSize = pGraph.count() / numBatches;
+    const uint64_t numItems = pUnitigs ? pUnitigs->count() - pUnitigs->cycles() : pGraph.count();
+    const uint64_t batchSize = numItems / numBatches;
     uint64_t numDone = 0;
     WorkQueue q(pThreads);
     vector<BatchBuilderPtr> batches;
     for (uint64_t i = 0; i < numBatches; ++i)
     {
         uint64_t begin = i * batchSize;
-        uint64_t end = i == (numBatches - 1) ? pGraph.count() : (i + 1) * batchSize;
-        batches.push_back(BatchBuilderPtr(new BatchBuilder(pGraph, begin, end, mtx, cnd, numDone)));
+        uint64_t end = i == (numBatches - 1) ? numItems : (i + 1) * batchSize;
+        batches.push_back(BatchBuilderPtr(new BatchBuilder(pGraph, pUnitigs, begin, end, mtx, cnd, numDone)));
         q.push_back(std::bind<void>(std::ref(*batches.back())));
     }
 
@@ -202,6 +232,9 @@ EntryEdgeSet::build(const Graph& pGraph, const string& pBaseName,
     
     const uint64_t K(pGraph.K());
     const uint64_t rho(K + 1);
+    Fingerprint fp;
+    fp.push_back(K);
+    fp.push_back(n);
     {
         const Gossamer::position_type z = Gossamer::position_type(1) << (2 * rho);
         LOG(log, info) << "Writing entry edges";
@@ -212,19 +245,14 @@ EntryEdgeSet::build(const Graph& pGraph, const string& pBaseName,
         for (uint64_t i = 0; i < batches.size(); ++i)
         {
             const BatchBuilder& b(*batches[i]);
-            uint64_t j = 0;
-            for (uint64_t k = 0; k < b.size(); ++k)
+            for (uint64_t j = 0; j < b.count(); ++j)
             {
-                if (b.mEdges[k])
-                {
-                    uint64_t r = b.mBegin + k;
-                    Graph::Edge e(pGraph.select(r));
+                Graph::Edge e(pGraph.select(b.mRanks[j]));
 
-                    es.push_back(e.value());
-                    cs.push_back(b.mCounts[j]);
-                    ls.push_back(b.mLengths[j]);
-                    j += 1;
-                }
+                es.push_back(e.value());
+                fp.push_back(e.value());
+                cs.push_back(b.mCounts[j]);
+                ls.push_back(b.mLengths[j]);
             }
         }
         es.end(z);
@@ -260,16 +288,11 @@ EntryEdgeSet::build(const Graph& pGraph, const string& pBaseName,
         for (uint64_t i = 0; i < batches.size(); ++i)
         {
             const BatchBuilder& b(*batches[i]);
-            uint64_t j = 0;
-            for (uint64_t k = 0; k < b.size(); ++k)
+            for (uint64_t j = 0; j < b.count(); ++j)
             {
-                if (b.mEdges[k])
-                {
-                    Graph::Edge rc(pGraph.select(b.mRCs[j]));
-                    IntegerArray::value_type x(es.rank(rc.value()));
-                    xs->push_back(x);
-                    j += 1;
-                }
+                Graph::Edge rc(pGraph.select(b.mRCs[j]));
+                IntegerArray::value_type x(es.rank(rc.value()));
+                xs->push_back(x);
             }
         }
         (*xs).end();
@@ -279,6 +302,7 @@ EntryEdgeSet::build(const Graph& pGraph, const string& pBaseName,
         Header h;
         h.version = EntryEdgeSet::version;
         h.K = K;
+        h.fingerprint = fp.value();
 
         FileFactory::OutHolderPtr hoPtr(pFactory.out(pBaseName + ".header"));
         ostream& ho(**hoPtr);
@@ -296,6 +320,26 @@ EntryEdgeSet::remove(const std::string& pBaseName, FileFactory& pFactory)
     IntegerArray::remove(pBaseName + ".ends", pFactory);
 }
 
+uint64_t
+EntryEdgeSet::fingerprint() const
+{
+    if (mHeader.version == version)
+    {
+        return mHeader.fingerprint;
+    }
+
+    // Older sets have none saved, so take it as build would.
+    Fingerprint f;
+    f.push_back(K());
+    const uint64_t n = count();
+    f.push_back(n);
+    for (uint64_t r = 0; r < n; ++r)
+    {
+        f.push_back(select(r).value());
+    }
+    return f.value();
+}
+
 EntryEdgeSet::EntryEdgeSet(const std::string& pBaseName, FileFactory& pFactory)
     : mHeader(pBaseName + ".header", pFactory),
       mEdges(pBaseName + ".edges", pFactory),
@@ -17,18 +17,22 @@
 #include "IntegerArray.hh"
 #endif
 
+class UnitigIndex;
+
 class EntryEdgeSet : public GraphEssentials<EntryEdgeSet>
 {
 public:
-    static const uint64_t version = 2011041901ULL; 
+    static const uint64_t version = 2016122101ULL; 
     // Version history
     // 2011020801   - initial version
     // 2011041901   - add lengths.
+    // 2016122101   - record a fingerprint of the entry edges
 
     struct Header
     {
         uint64_t version;
         uint64_t K;
+        uint64_t fingerprint;
 
         Header()
         {
@@ -37,11 +41,17 @@ public:
         Header(const std::string& pFileName, FileFactory& pFactory);
     };
 
+    // Entry edge sets of this version, which have no fingerprint, can
+    // still be read.
+    static const uint64_t unfingerprintedVersion = 2011041901ULL;
+
     // The maximum number of bits we allow for start edge ranks.
     static const uint64_t RankBits = 40;
 
+    // If pUnitigs is given, the paths are read from it rather than walked.
     static void build(const Graph& pGraph, const std::string& pBaseName, 
-                      FileFactory& pFactory, Logger& pLog, uint64_t pThreads=1);
+                      FileFactory& pFactory, Logger& pLog, uint64_t pThreads=1,
+                      const UnitigIndex* pUnitigs = 0);
 
     // The length of the k-mers used for building the graph.
     //
@@ -50,6 +60,12 @@ public:
         return mHeader.K;
     }
 
+    // A fingerprint of all the entry edges, taken as they were
+    // written, for checking that something derived from them is
+    // still up to date.
+    //
+    uint64_t fingerprint() const;
+
     // The number of edges in the graph.
     //
     Gossamer::rank_type count() const
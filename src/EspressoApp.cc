@@ -1016,7 +1016,14 @@ EspressoApp::EspressoApp()
     globalOpts.addOpt<bool>("help", "h", "show a help message");
     globalOpts.addOpt<string>("log-file", "l", "place to write messages");
     globalOpts.addOpt<strings>("tmp-dir", "", "a directory to use for temporary files (default /tmp)");
-    globalOpts.addOpt<uint64_t>("num-threads", "T", "maximum number of worker threads to use, where possible");
+    globalOpts.addOpt<uint64_t>("num-threads", "T", "maximum number of worker threads to use, where possible, or 'auto' for one per processor");
+    globalOpts.addOpt<string>("map-access", "", "expected access pattern for mapped files: normal, sequential or random");
+    globalOpts.addOpt<bool>("map-interleave", "", "interleave mapped files across memory nodes");
+    globalOpts.addOpt<bool>("map-warm-up", "", "map files lazily, pre-faulting rank/select indexes in the background");
+    globalOpts.addOpt<double>("max-memory", "", "maximum memory (in GB) for buffers and mapped files; buffers are sized to fit");
+    globalOpts.addOpt<bool>("no-huge-pages", "", "don't ask for huge pages for mapped files");
+    globalOpts.addOpt<bool>("pin-threads", "", "pin worker threads to processors, spreading them across memory nodes");
+    globalOpts.addOpt<string>("queues", "", "how threads pass work: locked, ring (lock-free) or auto (ring with more than 16 processors)");
     globalOpts.addOpt<bool>("verbose", "v", "show progress messages");
     globalOpts.addOpt<bool>("version", "V", "show the software version");
 
@@ -0,0 +1,169 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef EVENTCOUNT_HH
+#define EVENTCOUNT_HH
+
+#ifndef STD_ATOMIC
+#include <atomic>
+#define STD_ATOMIC
+#endif
+
+#ifndef STD_MUTEX
+#include <mutex>
+#define STD_MUTEX
+#endif
+
+#ifndef STD_CONDITION_VARIABLE
+#include <condition_variable>
+#define STD_CONDITION_VARIABLE
+#endif
+
+#ifndef STD_THREAD
+#include <thread>
+#define STD_THREAD
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Lets threads wait for a condition that lock-free code makes true,
+// without that code taking a lock unless some thread is asleep.
+//
+// A waiter spins for a while, since the condition is usually made true
+// again soon by a busy producer or consumer, and then parks on a
+// condition variable. The number of spins adapts: it grows when
+// spinning pays off and shrinks when the waiter has to park anyway.
+// On a single processor there is nothing to gain by spinning.
+//
+class EventCount
+{
+public:
+    // Wait until pReady() returns true, which it may be called
+    // repeatedly to find out. Returns true if the thread had to park.
+    template <typename Pred>
+    bool await(Pred pReady)
+    {
+        const uint32_t spins = mSpins.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < spins; ++i)
+        {
+            if (pReady())
+            {
+                if (spins < sMaxSpins)
+                {
+                    mSpins.store(spins + spins / 8 + 1, std::memory_order_relaxed);
+                }
+                return false;
+            }
+            pause();
+        }
+
+        bool parked = false;
+        while (true)
+        {
+            const uint64_t key = prepareWait();
+            if (pReady())
+            {
+                cancelWait();
+                break;
+            }
+            wait(key);
+            parked = true;
+        }
+        if (parked && spins > sMinSpins)
+        {
+            mSpins.store(spins / 2, std::memory_order_relaxed);
+        }
+        return parked;
+    }
+
+    // Wake one parked waiter, if there is one, to look at its
+    // condition again.
+    void notifyOne()
+    {
+        if (bump())
+        {
+            mCond.notify_one();
+        }
+    }
+
+    // Wake all parked waiters.
+    void notifyAll()
+    {
+        if (bump())
+        {
+            mCond.notify_all();
+        }
+    }
+
+    EventCount()
+        : mEpoch(0), mWaiters(0),
+          mSpins(std::thread::hardware_concurrency() > 1 ? sMinSpins : 0)
+    {
+    }
+
+private:
+    static const uint32_t sMinSpins = 64;
+    static const uint32_t sMaxSpins = 16384;
+
+    static void pause()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    // A waiter counts itself before looking at its condition, and the
+    // notifier makes the condition true before looking for waiters,
+    // so either the waiter sees the condition or the notifier sees the
+    // waiter and moves the epoch on.
+    uint64_t prepareWait()
+    {
+        mWaiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return mEpoch.load(std::memory_order_relaxed);
+    }
+
+    void cancelWait()
+    {
+        mWaiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    void wait(uint64_t pKey)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (mEpoch.load(std::memory_order_relaxed) == pKey)
+        {
+            mCond.wait(lock);
+        }
+        mWaiters.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    bool bump()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mWaiters.load(std::memory_order_relaxed) == 0)
+        {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(mMutex);
+        mEpoch.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::atomic<uint64_t> mEpoch;
+    std::atomic<uint64_t> mWaiters;
+    std::atomic<uint32_t> mSpins;
+    std::mutex mMutex;
+    std::condition_variable mCond;
+};
+
+#endif // EVENTCOUNT_HH
@@ -8,11 +8,37 @@
 //
 #include "FileFactory.hh"
 
+#include <atomic>
+
 FileFactory::TmpFileHolder::~TmpFileHolder()
 {
     mFactory.remove(mName);
 }
 
+namespace // anonymous
+{
+    std::atomic<uint64_t> gMappedBytes(0);
+}
+// namespace anonymous
+
+FileFactory::MappedHolder::~MappedHolder()
+{
+    gMappedBytes -= mAccounted;
+}
+
+void
+FileFactory::MappedHolder::account(uint64_t pBytes)
+{
+    gMappedBytes += pBytes;
+    mAccounted += pBytes;
+}
+
+uint64_t
+FileFactory::mappedBytes()
+{
+    return gMappedBytes;
+}
+
 FileFactory::~FileFactory()
 {
 }
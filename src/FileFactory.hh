@@ -82,6 +82,42 @@ class FileFactory
 public:
     enum FileMode { TruncMode, AppendMode };
 
+    // Mapped files come in two kinds: the bulk data of a structure,
+    // and the small, hot indexes (e.g. rank/select directories) which
+    // are consulted on every lookup into it.
+    enum MapKind { DataMap, IndexMap };
+    enum MapAccess { NormalAccess, SequentialAccess, RandomAccess };
+    enum MapPlacement { LocalPlacement, InterleavedPlacement };
+
+    // How a mapped file should be brought into memory.
+    struct MappingPolicy
+    {
+        // Fault in the whole file at map time.
+        bool populate;
+
+        // The expected access pattern, passed on to the OS.
+        MapAccess access;
+
+        // Where to put the pages on a machine with several memory
+        // nodes. Interleaving only affects pages not yet in the cache,
+        // and only those the factory faults in itself, so an
+        // interleaved map which is not warmed up is populated.
+        MapPlacement placement;
+
+        // Ask for huge pages where the OS can provide them.
+        bool hugePages;
+
+        // Fault in the file on a background thread.
+        // See FileFactory::waitForWarmUp().
+        bool warmUp;
+
+        MappingPolicy()
+            : populate(true), access(NormalAccess),
+              placement(LocalPlacement), hugePages(true), warmUp(false)
+        {
+        }
+    };
+
     class InHolder
     {
     public:
@@ -107,10 +143,28 @@ public:
 
         virtual const void* data() const = 0;
 
-        virtual ~MappedHolder() {}
+        // Hint at how the mapping is about to be accessed.
+        virtual void advise(MapAccess pAccess) const {}
+
+        virtual ~MappedHolder();
+
+    protected:
+        // Count pBytes towards mappedBytes() for the life of the holder.
+        void account(uint64_t pBytes);
+
+        MappedHolder()
+            : mAccounted(0)
+        {
+        }
+
+    private:
+        uint64_t mAccounted;
     };
     typedef std::shared_ptr<MappedHolder> MappedHolderPtr;
 
+    // The total size of the files currently mapped by this process.
+    static uint64_t mappedBytes();
+
     class TmpFileHolder
     {
     public:
@@ -141,12 +195,22 @@ public:
     // Map a file.
     virtual MappedHolderPtr map(const std::string& pFileName) const = 0;
 
+    // Map a file holding an index over other mapped data, according
+    // to the IndexMap mapping policy.
+    virtual MappedHolderPtr mapIndex(const std::string& pFileName) const
+    {
+        return map(pFileName);
+    }
+
     // Remove a file.
     virtual void remove(const std::string& pFileName) const = 0;
 
     // Copy a file.
     virtual void copy(const std::string& pFileNameFrom, const std::string& pFileNameTo) const = 0;
 
+    // Rename a file, replacing the target if it exists.
+    virtual void rename(const std::string& pFileNameFrom, const std::string& pFileNameTo) const = 0;
+
     // Return true iff a file exists.
     virtual bool exists(const std::string& pFileName) const = 0;
 
@@ -159,6 +223,24 @@ public:
     // Set the flag to populate mmappings at map time.
     virtual void populate(bool pPopulate) = 0;
 
+    // Set the policy for mapping files of the given kind.
+    virtual void mappingPolicy(MapKind pKind, const MappingPolicy& pPolicy)
+    {
+    }
+
+    // Set the number of threads used to compress each compressed
+    // output file.
+    virtual void outputThreads(uint64_t pNumThreads)
+    {
+    }
+
+    // Wait until any background warm-up of mapped files has finished.
+    // Commands which do lots of random lookups should call this after
+    // opening their structures, and before starting worker threads.
+    virtual void waitForWarmUp() const
+    {
+    }
+
     // virtual Destructor
     virtual ~FileFactory();
 };
@@ -0,0 +1,62 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef FINGERPRINT_HH
+#define FINGERPRINT_HH
+
+#ifndef RANKSELECT_HH
+#include "RankSelect.hh"
+#endif
+
+// A streaming hash of a sequence of words. Graphs and k-mer sets
+// fingerprint everything they are built from, so that the indexes,
+// filters and sketches saved beside them can tell when they have been
+// rebuilt, even with the same size.
+//
+class Fingerprint
+{
+public:
+    static uint64_t mix(uint64_t pH, uint64_t pX)
+    {
+        uint64_t h = (pH ^ pX) * 0x9e3779b97f4a7c13ULL;
+        h ^= h >> 29;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 32;
+        return h;
+    }
+
+    void push_back(uint64_t pX)
+    {
+        mValue = mix(mValue, pX);
+    }
+
+    void push_back(const Gossamer::position_type& pX)
+    {
+        const Gossamer::position_type::value_type v(pX.value());
+        const std::pair<const uint64_t*,const uint64_t*> ws(v.words());
+        for (const uint64_t* w = ws.first; w != ws.second; ++w)
+        {
+            push_back(*w);
+        }
+    }
+
+    uint64_t value() const
+    {
+        return mValue;
+    }
+
+    Fingerprint()
+        : mValue(0)
+    {
+    }
+
+private:
+    uint64_t mValue;
+};
+
+#endif // FINGERPRINT_HH
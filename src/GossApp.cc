@@ -29,6 +29,7 @@
 #include "GossCmdBuildScaffold.hh"
 #include "GossCmdBuildSubgraph.hh"
 #include "GossCmdBuildSupergraph.hh"
+#include "GossCmdBuildUnitigs.hh"
 #include "GossCmdClassifyReads.hh"
 #include "GossCmdClipLinks.hh"
 #include "GossCmdComputeNearKmers.hh"
@@ -43,6 +44,7 @@
 #include "GossCmdExtractReads.hh"
 #include "GossCmdFilterReads.hh"
 #include "GossCmdFixReads.hh"
+#include "GossCmdGraphStats.hh"
 #include "GossCmdGraphToKmerSet.hh"
 #include "GossCmdGroupReads.hh"
 #include "GossCmdHelp.hh"
@@ -61,6 +63,7 @@
 #include "GossCmdThreadReads.hh"
 #include "GossCmdScaffold.hh"
 #include "GossCmdTrimGraph.hh"
+#include "GossCmdUpdateGraph.hh"
 #include "GossCmdTrimPaths.hh"
 
 using namespace boost;
@@ -102,7 +105,9 @@ GossApp::GossApp()
     cmds.push_back(GossCmdReg("build-graph", GossCmdFactoryPtr(new GossCmdFactoryBuildGraph)));
     cmds.push_back(GossCmdReg("build-scaffold", GossCmdFactoryPtr(new GossCmdFactoryBuildScaffold)));
     cmds.push_back(GossCmdReg("build-supergraph", GossCmdFactoryPtr(new GossCmdFactoryBuildSupergraph)));
+    cmds.push_back(GossCmdReg("build-unitigs", GossCmdFactoryPtr(new GossCmdFactoryBuildUnitigs)));
     cmds.push_back(GossCmdReg("dump-graph", GossCmdFactoryPtr(new GossCmdFactoryDumpGraph)));
+    cmds.push_back(GossCmdReg("graph-stats", GossCmdFactoryPtr(new GossCmdFactoryGraphStats)));
     cmds.push_back(GossCmdReg("help", GossCmdFactoryPtr(new GossCmdFactoryHelp(*this))));
     cmds.push_back(GossCmdReg("lint-graph", GossCmdFactoryPtr(new GossCmdFactoryLintGraph)));
     cmds.push_back(GossCmdReg("merge-graphs", GossCmdFactoryPtr(new GossCmdFactoryMergeGraphs)));
@@ -114,6 +119,7 @@ GossApp::GossApp()
     cmds.push_back(GossCmdReg("thread-pairs", GossCmdFactoryPtr(new GossCmdFactoryThreadPairs)));
     cmds.push_back(GossCmdReg("thread-reads", GossCmdFactoryPtr(new GossCmdFactoryThreadReads)));
     cmds.push_back(GossCmdReg("trim-graph", GossCmdFactoryPtr(new GossCmdFactoryTrimGraph)));
+    cmds.push_back(GossCmdReg("update-graph", GossCmdFactoryPtr(new GossCmdFactoryUpdateGraph)));
 
 #ifndef ONLY_RELEASED_COMMANDS
     cmds.push_back(GossCmdReg("annotate-kmers", GossCmdFactoryPtr(new GossCmdFactoryAnnotateKmers)));
@@ -147,7 +153,14 @@ GossApp::GossApp()
     globalOpts.addOpt<bool>("help", "h", "show a help message");
     globalOpts.addOpt<string>("log-file", "l", "place to write messages");
     globalOpts.addOpt<strings>("tmp-dir", "", "a directory to use for temporary files (default /tmp)");
-    globalOpts.addOpt<uint64_t>("num-threads", "T", "maximum number of worker threads to use, where possible");
+    globalOpts.addOpt<uint64_t>("num-threads", "T", "maximum number of worker threads to use, where possible, or 'auto' for one per processor");
+    globalOpts.addOpt<string>("map-access", "", "expected access pattern for mapped files: normal, sequential or random");
+    globalOpts.addOpt<bool>("map-interleave", "", "interleave mapped files across memory nodes");
+    globalOpts.addOpt<bool>("map-warm-up", "", "map files lazily, pre-faulting rank/select indexes in the background");
+    globalOpts.addOpt<double>("max-memory", "M", "maximum memory (in GB) for buffers and mapped files; buffers are sized to fit");
+    globalOpts.addOpt<bool>("no-huge-pages", "", "don't ask for huge pages for mapped files");
+    globalOpts.addOpt<bool>("pin-threads", "", "pin worker threads to processors, spreading them across memory nodes");
+    globalOpts.addOpt<string>("queues", "", "how threads pass work: locked, ring (lock-free) or auto (ring with more than 16 processors)");
     globalOpts.addOpt<bool>("verbose", "v", "show progress messages");
     globalOpts.addOpt<bool>("version", "V", "show the software version");
 
@@ -200,5 +213,7 @@ GossApp::GossApp()
             "The maximum number of graphs to merge at once.");
     commonOpts.addOpt<bool>("delete-scaffold", "",
             "Delete any scaffold files associated with the supergraph before proceeding.");
+    commonOpts.addOpt<uint64_t>("prefilter-bits", "",
+            "also build a Bloom filter using this many bits per k-mer, to speed up lookups of absent k-mers");
 }
 
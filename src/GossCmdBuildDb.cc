@@ -32,8 +32,12 @@
 #include "SuperPathId.hh"
 #include "Timer.hh"
 #include "TrivialVector.hh"
+#include "WorkQueue.hh"
 
 #include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <boost/noncopyable.hpp>
 #include <boost/lexical_cast.hpp>
 #include <thread>
@@ -77,6 +81,12 @@ namespace Sql {
 
         bool tableExists(const string& str);
 
+        // The most parameters a statement may have.
+        uint64_t maxVariables()
+        {
+            return sqlite3_limit(mDb, SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+        }
+
         void exec(const string& str)
         {
             if (sqlite3_exec(mDb, str.c_str(), 0, 0, 0))
@@ -213,6 +223,135 @@ namespace Sql {
         Database& mDb;
     };
 
+    // Insert rows into a table many at a time, through one prepared
+    // multi-row INSERT. The values of each row are pushed in column
+    // order, and buffered until there are enough rows for a statement.
+    class BulkInsert : private boost::noncopyable
+    {
+    public:
+        void push_back(int64_t pVal)
+        {
+            mValues.push_back(Value(pVal));
+            check();
+        }
+
+        void push_back(double pVal)
+        {
+            mValues.push_back(Value(pVal));
+            check();
+        }
+
+        void push_back(const string& pVal)
+        {
+            mValues.push_back(Value(pVal));
+            check();
+        }
+
+        // Write out any buffered rows.
+        void flush()
+        {
+            BOOST_ASSERT(mValues.size() % mCols == 0);
+            const uint64_t rows = mValues.size() / mCols;
+            if (rows == mRows)
+            {
+                write(*mFull);
+            }
+            else if (rows > 0)
+            {
+                Statement part(mDb, insert(rows));
+                write(part);
+            }
+            mValues.clear();
+        }
+
+        BulkInsert(Database& pDb, const string& pTable, uint64_t pCols)
+            : mDb(pDb), mTable(pTable), mCols(pCols),
+              mRows(max<uint64_t>(1, min<uint64_t>(256, pDb.maxVariables() / pCols))),
+              mFull(new Statement(pDb, insert(mRows)))
+        {
+            mValues.reserve(mRows * mCols);
+        }
+
+    private:
+        struct Value
+        {
+            enum Kind { Int, Real, Text };
+
+            explicit Value(int64_t pVal)
+                : kind(Int), i(pVal), d(0)
+            {
+            }
+
+            explicit Value(double pVal)
+                : kind(Real), i(0), d(pVal)
+            {
+            }
+
+            explicit Value(const string& pVal)
+                : kind(Text), i(0), d(0), s(pVal)
+            {
+            }
+
+            Kind kind;
+            int64_t i;
+            double d;
+            string s;
+        };
+
+        void check()
+        {
+            if (mValues.size() == mRows * mCols)
+            {
+                flush();
+            }
+        }
+
+        string insert(uint64_t pRows) const
+        {
+            string row = "(?";
+            for (uint64_t c = 1; c < mCols; ++c)
+            {
+                row += ", ?";
+            }
+            row += ")";
+            string sql = "INSERT INTO " + mTable + " VALUES " + row;
+            for (uint64_t r = 1; r < pRows; ++r)
+            {
+                sql += ", " + row;
+            }
+            return sql + ";";
+        }
+
+        void write(Statement& pStmt)
+        {
+            for (uint64_t i = 0; i < mValues.size(); ++i)
+            {
+                const Value& v(mValues[i]);
+                switch (v.kind)
+                {
+                    case Value::Int:
+                        pStmt.bind(i + 1, v.i);
+                        break;
+                    case Value::Real:
+                        pStmt.bind(i + 1, v.d);
+                        break;
+                    case Value::Text:
+                        pStmt.bind(i + 1, v.s);
+                        break;
+                }
+            }
+            pStmt.step();
+            pStmt.reset();
+        }
+
+        Database& mDb;
+        const string mTable;
+        const uint64_t mCols;
+        const uint64_t mRows;
+        std::unique_ptr<Statement> mFull;
+        vector<Value> mValues;
+    };
+
 
     bool 
     Database::tableExists(const string& str)
@@ -234,6 +373,301 @@ namespace // anonymous
     static const string sequencesTable = "sequences";
     static const string alignmentsTable = "alignments";
 
+    void createIndexes(Sql::Database& pDb)
+    {
+        pDb.exec("CREATE INDEX IF NOT EXISTS index_from ON " + linksTable + " (id_from);");
+        pDb.exec("CREATE INDEX IF NOT EXISTS index_to ON " + linksTable + " (id_to);");
+    }
+} // namespace anonymous
+
+// The tables the rows are written to.
+class GossCmdBuildDb::Tables
+{
+public:
+    virtual void node(int64_t pId, int64_t pRc, double pCovMean, int64_t pLength) = 0;
+
+    virtual void sequence(int64_t pId, const string& pSeq) = 0;
+
+    virtual void link(int64_t pFrom, int64_t pTo, int64_t pGap, int64_t pCount, int64_t pType) = 0;
+
+    // Discard the links written so far.
+    virtual void clearLinks() = 0;
+
+    // Finish writing all the tables.
+    virtual void end() = 0;
+
+    virtual ~Tables()
+    {
+    }
+};
+
+namespace // anonymous
+{
+    // Load the rows in one transaction, many rows per INSERT. The
+    // indexes on a fresh database are built once the links are in.
+    class SqliteTables : public GossCmdBuildDb::Tables
+    {
+    public:
+        void node(int64_t pId, int64_t pRc, double pCovMean, int64_t pLength)
+        {
+            mNodes.push_back(pId);
+            mNodes.push_back(pRc);
+            mNodes.push_back(pCovMean);
+            mNodes.push_back(pLength);
+        }
+
+        void sequence(int64_t pId, const string& pSeq)
+        {
+            mSequences.push_back(pId);
+            mSequences.push_back(pSeq);
+        }
+
+        void link(int64_t pFrom, int64_t pTo, int64_t pGap, int64_t pCount, int64_t pType)
+        {
+            mLinks.push_back(pFrom);
+            mLinks.push_back(pTo);
+            mLinks.push_back(pGap);
+            mLinks.push_back(pCount);
+            mLinks.push_back(pType);
+        }
+
+        void clearLinks()
+        {
+            mLinks.flush();
+            mDb.exec("DELETE FROM " + linksTable + ";");
+        }
+
+        void end()
+        {
+            mNodes.flush();
+            mSequences.flush();
+            mLinks.flush();
+            mTrans.reset();
+            if (mFresh)
+            {
+                createIndexes(mDb);
+            }
+        }
+
+        SqliteTables(Sql::Database& pDb, bool pFresh)
+            : mDb(pDb), mFresh(pFresh), mTrans(new Sql::Transaction(pDb)),
+              mNodes(pDb, nodesTable, 4), mSequences(pDb, sequencesTable, 2), mLinks(pDb, linksTable, 5)
+        {
+        }
+
+    private:
+        Sql::Database& mDb;
+        const bool mFresh;
+        std::unique_ptr<Sql::Transaction> mTrans;
+        Sql::BulkInsert mNodes;
+        Sql::BulkInsert mSequences;
+        Sql::BulkInsert mLinks;
+    };
+
+    // One comma separated file per table, with a header line.
+    class CsvTables : public GossCmdBuildDb::Tables
+    {
+    public:
+        void node(int64_t pId, int64_t pRc, double pCovMean, int64_t pLength)
+        {
+            **mNodes << pId << ',' << pRc << ',' << pCovMean << ',' << pLength << '\n';
+        }
+
+        void sequence(int64_t pId, const string& pSeq)
+        {
+            **mSequences << pId << ',' << pSeq << '\n';
+        }
+
+        void link(int64_t pFrom, int64_t pTo, int64_t pGap, int64_t pCount, int64_t pType)
+        {
+            **mLinks << pFrom << ',' << pTo << ',' << pGap << ',' << pCount << ',' << pType << '\n';
+        }
+
+        void clearLinks()
+        {
+            mLinks = FileFactory::OutHolderPtr();
+            mLinks = open(linksTable, "id_from,id_to,gap,count,type");
+        }
+
+        void end()
+        {
+            mNodes = FileFactory::OutHolderPtr();
+            mSequences = FileFactory::OutHolderPtr();
+            mLinks = FileFactory::OutHolderPtr();
+        }
+
+        CsvTables(const string& pPrefix, FileFactory& pFactory)
+            : mPrefix(pPrefix), mFactory(pFactory),
+              mNodes(open(nodesTable, "id,rc,cov_mean,length")),
+              mSequences(open(sequencesTable, "id,sequence")),
+              mLinks(open(linksTable, "id_from,id_to,gap,count,type"))
+        {
+        }
+
+    private:
+        FileFactory::OutHolderPtr open(const string& pTable, const string& pColumns)
+        {
+            FileFactory::OutHolderPtr op(mFactory.out(mPrefix + "-" + pTable + ".csv"));
+            (**op).precision(std::numeric_limits<double>::max_digits10);
+            **op << pColumns << '\n';
+            return op;
+        }
+
+        const string mPrefix;
+        FileFactory& mFactory;
+        FileFactory::OutHolderPtr mNodes;
+        FileFactory::OutHolderPtr mSequences;
+        FileFactory::OutHolderPtr mLinks;
+    };
+
+    // One file per column, each an array of native 64 bit integers or
+    // doubles which can be mapped directly. The sequences are stored
+    // end to end, with an array of offsets one longer than the table.
+    // A text file, <prefix>.schema, lists the columns and their lengths.
+    class ColumnTables : public GossCmdBuildDb::Tables
+    {
+    public:
+        void node(int64_t pId, int64_t pRc, double pCovMean, int64_t pLength)
+        {
+            mColumns[NodeId].put(pId);
+            mColumns[NodeRc].put(pRc);
+            mColumns[NodeCovMean].put(pCovMean);
+            mColumns[NodeLength].put(pLength);
+        }
+
+        void sequence(int64_t pId, const string& pSeq)
+        {
+            mColumns[SeqId].put(pId);
+            **mColumns[SeqText].out << pSeq;
+            mColumns[SeqText].rows += pSeq.size();
+            mColumns[SeqOffset].put(int64_t(mColumns[SeqText].rows));
+        }
+
+        void link(int64_t pFrom, int64_t pTo, int64_t pGap, int64_t pCount, int64_t pType)
+        {
+            mColumns[LinkFrom].put(pFrom);
+            mColumns[LinkTo].put(pTo);
+            mColumns[LinkGap].put(pGap);
+            mColumns[LinkCount].put(pCount);
+            mColumns[LinkType].put(pType);
+        }
+
+        void clearLinks()
+        {
+            for (uint64_t c = LinkFrom; c <= LinkType; ++c)
+            {
+                mColumns[c].out = FileFactory::OutHolderPtr();
+                open(c);
+            }
+        }
+
+        void end()
+        {
+            FileFactory::OutHolderPtr op(mFactory.out(mPrefix + ".schema"));
+            for (uint64_t c = 0; c < NumColumns; ++c)
+            {
+                mColumns[c].out = FileFactory::OutHolderPtr();
+                **op << mColumns[c].table << '\t' << mColumns[c].name << '\t'
+                     << mColumns[c].type << '\t' << mColumns[c].rows << '\n';
+            }
+        }
+
+        ColumnTables(const string& pPrefix, FileFactory& pFactory)
+            : mPrefix(pPrefix), mFactory(pFactory)
+        {
+            static const char* const cols[NumColumns][3] = {
+                {"nodes", "id", "int64"}, {"nodes", "rc", "int64"},
+                {"nodes", "cov_mean", "double"}, {"nodes", "length", "int64"},
+                {"sequences", "id", "int64"}, {"sequences", "offset", "int64"},
+                {"sequences", "sequence", "char"},
+                {"links", "id_from", "int64"}, {"links", "id_to", "int64"},
+                {"links", "gap", "int64"}, {"links", "count", "int64"},
+                {"links", "type", "int64"}
+            };
+            for (uint64_t c = 0; c < NumColumns; ++c)
+            {
+                mColumns[c].table = cols[c][0];
+                mColumns[c].name = cols[c][1];
+                mColumns[c].type = cols[c][2];
+                open(c);
+            }
+            mColumns[SeqOffset].put(int64_t(0));
+        }
+
+    private:
+        enum
+        {
+            NodeId, NodeRc, NodeCovMean, NodeLength,
+            SeqId, SeqOffset, SeqText,
+            LinkFrom, LinkTo, LinkGap, LinkCount, LinkType,
+            NumColumns
+        };
+
+        struct Column
+        {
+            template <typename T>
+            void put(const T& pVal)
+            {
+                (**out).write(reinterpret_cast<const char*>(&pVal), sizeof(T));
+                ++rows;
+            }
+
+            string table;
+            string name;
+            string type;
+            FileFactory::OutHolderPtr out;
+            uint64_t rows;
+        };
+
+        void open(uint64_t pCol)
+        {
+            Column& c(mColumns[pCol]);
+            c.out = mFactory.out(mPrefix + "-" + c.table + "." + c.name);
+            c.rows = 0;
+        }
+
+        const string mPrefix;
+        FileFactory& mFactory;
+        Column mColumns[NumColumns];
+    };
+
+    // The sequence, reverse complement and coverage of a run of
+    // contigs, computed on a worker thread.
+    class ContigBatch
+    {
+    public:
+        void operator()()
+        {
+            for (uint64_t i = mBegin; i < mEnd; ++i)
+            {
+                SuperPathId rc(0);
+                double covMean = 0;
+                string seq;
+                mSg.contigInfo(mG, mIds[i], seq, rc, covMean);
+                mRcs.push_back(rc);
+                mCovMeans.push_back(covMean);
+                mSeqs.push_back(string());
+                mSeqs.back().swap(seq);
+            }
+        }
+
+        ContigBatch(const Graph& pG, const SuperGraph& pSg, const vector<SuperPathId>& pIds,
+                    uint64_t pBegin, uint64_t pEnd)
+            : mG(pG), mSg(pSg), mIds(pIds), mBegin(pBegin), mEnd(pEnd)
+        {
+        }
+
+        const Graph& mG;
+        const SuperGraph& mSg;
+        const vector<SuperPathId>& mIds;
+        const uint64_t mBegin;
+        const uint64_t mEnd;
+        vector<SuperPathId> mRcs;
+        vector<double> mCovMeans;
+        vector<string> mSeqs;
+    };
+    typedef std::shared_ptr<ContigBatch> ContigBatchPtr;
+
     template <typename Dest>
     class LinkMapCompiler
     {
@@ -376,12 +810,11 @@ namespace // anonymous
             int64_t gap = int64_t(mInsertSize) - len;
             int64_t count = pCount;
 
-            if (!mFresh)
+            int64_t oldGap = 0;
+            int64_t oldCount = 0;
+            if (mRead && read(pLhs, pRhs, oldGap, oldCount))
             {
                 // Combine results.
-                int64_t oldGap = 0;
-                int64_t oldCount = 0;
-                read(pLhs, pRhs, oldGap, oldCount);
                 int64_t sumGap = count * gap + oldCount * oldGap;
                 count = count + oldCount;
                 gap = sumGap / count;
@@ -389,65 +822,56 @@ namespace // anonymous
                 // Remove the old row.
                 erase(pLhs, pRhs);
             }
-            write(pLhs, pRhs, gap, count);
+            mTables.link(pLhs.value(), pRhs.value(), gap, count, PAIR_LINK);
         }
 
         void end()
         {
         }
 
-        LinkWriter(const SuperGraph& pSg, uint64_t pInsertSize, Sql::Database& pDb, bool pFresh)
-            : mSg(pSg), mInsertSize(pInsertSize), mFresh(pFresh),
-              mRead(pDb, "SELECT ALL gap, count FROM " + linksTable + " WHERE id_from=? and id_to=?;"),
-              mWrite(pDb, "INSERT INTO " + linksTable + " VALUES (?, ?, ?, ?, ?);"),
-              mDelete(pDb, "DELETE FROM " + linksTable + " WHERE id_from=? and id_to=?;"),
-              mTrans(pDb)
+        // If pExisting is given, combine the links with the ones
+        // already in it.
+        LinkWriter(const SuperGraph& pSg, uint64_t pInsertSize, GossCmdBuildDb::Tables& pTables,
+                   Sql::Database* pExisting)
+            : mSg(pSg), mInsertSize(pInsertSize), mTables(pTables)
         {
+            if (pExisting)
+            {
+                mRead.reset(new Sql::Statement(*pExisting, "SELECT ALL gap, count FROM " + linksTable + " WHERE id_from=? and id_to=?;"));
+                mDelete.reset(new Sql::Statement(*pExisting, "DELETE FROM " + linksTable + " WHERE id_from=? and id_to=?;"));
+            }
         }
 
     private:
 
         bool read(const SuperPathId& pLhs, const SuperPathId& pRhs, int64_t& pGap, int64_t& pCount)
         {
-            mRead.bind(1, int64_t(pLhs.value()));
-            mRead.bind(2, int64_t(pRhs.value()));
-            if (mRead.step() != SQLITE_ROW)
+            mRead->bind(1, int64_t(pLhs.value()));
+            mRead->bind(2, int64_t(pRhs.value()));
+            if (mRead->step() != SQLITE_ROW)
             {
-                mRead.reset();
+                mRead->reset();
                 return false;
             }
-            pGap = mRead.columnInt64(0);
-            pCount = mRead.columnInt64(1);
-            mRead.reset();
+            pGap = mRead->columnInt64(0);
+            pCount = mRead->columnInt64(1);
+            mRead->reset();
             return true;
         }
 
-        void write(const SuperPathId& pLhs, const SuperPathId& pRhs, int64_t pGap, int64_t pCount)
-        {
-                mWrite.bind(1, int64_t(pLhs.value()));
-                mWrite.bind(2, int64_t(pRhs.value()));
-                mWrite.bind(3, pGap);
-                mWrite.bind(4, int64_t(pCount));
-                mWrite.bind(5, int64_t(PAIR_LINK));
-                mWrite.step();
-                mWrite.reset();
-        }
-
         void erase(const SuperPathId& pLhs, const SuperPathId& pRhs)
         {
-            mDelete.bind(1, int64_t(pLhs.value()));
-            mDelete.bind(2, int64_t(pRhs.value()));
-            mDelete.step();
-            mDelete.reset();
+            mDelete->bind(1, int64_t(pLhs.value()));
+            mDelete->bind(2, int64_t(pRhs.value()));
+            mDelete->step();
+            mDelete->reset();
         }
 
         const SuperGraph& mSg;
         const uint64_t mInsertSize;
-        const bool mFresh;
-        Sql::Statement mRead;
-        Sql::Statement mWrite;
-        Sql::Statement mDelete;
-        Sql::Transaction mTrans;
+        GossCmdBuildDb::Tables& mTables;
+        std::unique_ptr<Sql::Statement> mRead;
+        std::unique_ptr<Sql::Statement> mDelete;
     };
 
 } // namespace anonymous
@@ -461,39 +885,64 @@ GossCmdBuildDb::operator()(const GossCmdContext& pCxt)
 
     Timer t;
 
-    // Open database and optimise for bulk writes.
-    Sql::Database db(mDb, log);
-    db.exec("PRAGMA synchronous = OFF");
-    db.exec("PRAGMA journal_mode = OFF");
-
-    // Check if the database is already populated.
-    bool popd = true;
-    popd = popd && db.tableExists(versionTable);
-    popd = popd && db.tableExists(nodesTable);
-    popd = popd && db.tableExists(linksTable);
-    popd = popd && db.tableExists(sequencesTable);
-    popd = popd && db.tableExists(alignmentsTable);
-    
-    bool fresh = !popd || mResetDb;
-    if (fresh)
+    std::unique_ptr<Sql::Database> db;
+    std::unique_ptr<Tables> tables;
+    bool fresh = true;
+    switch (mFormat)
     {
-        // Create tables.
+        case SQLite:
         {
-            Sql::Transaction tn(db);
-            db.exec("DROP TABLE IF EXISTS " + versionTable + ";");
-            db.exec("DROP TABLE IF EXISTS " + nodesTable + ";");
-            db.exec("DROP TABLE IF EXISTS " + linksTable + ";");
-            db.exec("DROP TABLE IF EXISTS " + sequencesTable + ";");
-            db.exec("DROP TABLE IF EXISTS " + alignmentsTable + ";");
+            // Open database and optimise for bulk writes. The page size
+            // only takes effect on a new database.
+            db.reset(new Sql::Database(mDb, log));
+            db->exec("PRAGMA page_size = 65536");
+            db->exec("PRAGMA synchronous = OFF");
+            db->exec("PRAGMA journal_mode = OFF");
+            db->exec("PRAGMA locking_mode = EXCLUSIVE");
+            db->exec("PRAGMA temp_store = MEMORY");
+            db->exec("PRAGMA cache_size = -262144");
+
+            // Check if the database is already populated.
+            bool popd = true;
+            popd = popd && db->tableExists(versionTable);
+            popd = popd && db->tableExists(nodesTable);
+            popd = popd && db->tableExists(linksTable);
+            popd = popd && db->tableExists(sequencesTable);
+            popd = popd && db->tableExists(alignmentsTable);
+
+            fresh = !popd || mResetDb;
+            if (fresh)
+            {
+                // Create tables.
+                {
+                    Sql::Transaction tn(*db);
+                    db->exec("DROP TABLE IF EXISTS " + versionTable + ";");
+                    db->exec("DROP TABLE IF EXISTS " + nodesTable + ";");
+                    db->exec("DROP TABLE IF EXISTS " + linksTable + ";");
+                    db->exec("DROP TABLE IF EXISTS " + sequencesTable + ";");
+                    db->exec("DROP TABLE IF EXISTS " + alignmentsTable + ";");
+                }
+                db->exec("CREATE TABLE IF NOT EXISTS " + versionTable + " (version INTEGER, description TEXT);");
+                db->exec("CREATE TABLE IF NOT EXISTS " + nodesTable + " (id INTEGER PRIMARY KEY ASC, rc INTEGER, cov_mean REAL, length INTEGER);");
+                db->exec("CREATE TABLE IF NOT EXISTS " + linksTable + " (id_from INTEGER, id_to INTEGER, gap INTEGER, count INTEGER, type INTEGER);");
+                db->exec("CREATE TABLE IF NOT EXISTS " + sequencesTable + " (id INTEGER PRIMARY KEY ASC, sequence TEXT);");
+                db->exec("CREATE TABLE IF NOT EXISTS " + alignmentsTable + " (id INTEGER PRIMARY KEY ASC, name TEXT, start INTEGER, end INTEGER, matchLen INTEGER, dir INTEGER, gene TEXT);");
+            }
+            else
+            {
+                // Merging links with the existing ones needs the indexes.
+                createIndexes(*db);
+            }
+            tables.reset(new SqliteTables(*db, fresh));
+            break;
         }
-        db.exec("CREATE TABLE IF NOT EXISTS " + versionTable + " (version INTEGER, description TEXT);");
-        db.exec("CREATE TABLE IF NOT EXISTS " + nodesTable + " (id INTEGER PRIMARY KEY ASC, rc INTEGER, cov_mean REAL, length INTEGER);");
-        db.exec("CREATE TABLE IF NOT EXISTS " + linksTable + " (id_from INTEGER, id_to INTEGER, gap INTEGER, count INTEGER, type INTEGER);");
-        db.exec("CREATE TABLE IF NOT EXISTS " + sequencesTable + " (id INTEGER PRIMARY KEY ASC, sequence TEXT);");
-        db.exec("CREATE TABLE IF NOT EXISTS " + alignmentsTable + " (id INTEGER PRIMARY KEY ASC, name TEXT, start INTEGER, end INTEGER, matchLen INTEGER, dir INTEGER, gene TEXT);");
+        case CSV:
+            tables.reset(new CsvTables(mDb, fac));
+            break;
+        case Columns:
+            tables.reset(new ColumnTables(mDb, fac));
+            break;
     }
-    db.exec("CREATE INDEX IF NOT EXISTS index_from ON " + linksTable + " (id_from);");
-    db.exec("CREATE INDEX IF NOT EXISTS index_to ON " + linksTable + " (id_to);");
 
     log(info, "loading supergraph");
     auto sgp = SuperGraph::read(mIn, fac);
@@ -511,56 +960,82 @@ GossCmdBuildDb::operator()(const GossCmdContext& pCxt)
 
     if (fresh)
     {
-        storeContigs(pCxt, g, sg, db);
+        storeContigs(pCxt, g, sg, *tables);
     }
     if (mLines.size() || mFastas.size() || mFastqs.size())
     {
-	storeReadLinks(pCxt, g, sg, db, fresh);
+	storeReadLinks(pCxt, g, sg, *tables, fresh ? 0 : db.get());
     }
     if (mIncludeGraphLinks)
     {
-	storeGraphLinks(pCxt, g, sg, db);
+	storeGraphLinks(pCxt, g, sg, *tables);
     }
 
+    log(info, "finishing tables");
+    tables->end();
+
     log(info, "total elapsed time: " + lexical_cast<string>(t.check()));
 }
 
 void
-GossCmdBuildDb::storeContigs(const GossCmdContext& pCxt, const Graph& pG, const SuperGraph& pSg, Sql::Database& pDb)
+GossCmdBuildDb::storeContigs(const GossCmdContext& pCxt, const Graph& pG, const SuperGraph& pSg, Tables& pTables)
 {
     Logger& log(pCxt.log);
-    ProgressMonitorNew mon(log, pSg.count());
-    uint64_t n = 0;
     log(info, "storing contig information");
-    Sql::Transaction tn(pDb);
-    Sql::Statement sNode(pDb, "INSERT INTO " + nodesTable + " VALUES (?, ?, ?, ?);");
-    Sql::Statement sSeq(pDb, "INSERT INTO " + sequencesTable + " VALUES (?, ?);");
+
+    vector<SuperPathId> ids;
     for (SuperGraph::PathIterator itr(pSg); itr.valid(); ++itr)
     {
-        mon.tick(++n);
-        const SuperPathId id = *itr;
-        SuperPathId rc(0);
-        double covMean;
-        string seq;
-        pSg.contigInfo(pG, id, seq, rc, covMean);
-
-        sNode.bind(1, int64_t(id.value()));
-        sNode.bind(2, int64_t(rc.value()));
-        sNode.bind(3, covMean);
-        sNode.bind(4, int64_t(seq.length()));
-        sNode.step();
-        sNode.reset();
-
-        sSeq.bind(1, int64_t(id.value()));
-        sSeq.bind(2, seq);
-        sSeq.step();
-        sSeq.reset();
+        ids.push_back(*itr);
+    }
+
+    // Compute the contigs a round of batches at a time, writing each
+    // round while the next one is computed.
+    const uint64_t batchSize = 1024;
+    const uint64_t roundSize = 4 * max<uint64_t>(mNumThreads, 1) * batchSize;
+    vector<ContigBatchPtr> batches;
+    std::unique_ptr<WorkQueue> q;
+    auto startRound = [&](uint64_t pBegin)
+    {
+        const uint64_t end = min<uint64_t>(ids.size(), pBegin + roundSize);
+        q.reset(new WorkQueue(mNumThreads));
+        for (uint64_t b = pBegin; b < end; b += batchSize)
+        {
+            batches.push_back(ContigBatchPtr(new ContigBatch(pG, pSg, ids, b, min(end, b + batchSize))));
+            q->push_back(std::bind<void>(std::ref(*batches.back())));
+        }
+    };
+
+    ProgressMonitorNew mon(log, ids.size());
+    uint64_t n = 0;
+    startRound(0);
+    for (uint64_t r = 0; r < ids.size(); r += roundSize)
+    {
+        q->wait();
+        vector<ContigBatchPtr> done;
+        done.swap(batches);
+        if (r + roundSize < ids.size())
+        {
+            startRound(r + roundSize);
+        }
+        for (uint64_t i = 0; i < done.size(); ++i)
+        {
+            const ContigBatch& b(*done[i]);
+            for (uint64_t j = 0; j < b.mSeqs.size(); ++j)
+            {
+                const int64_t id = ids[b.mBegin + j].value();
+                pTables.node(id, b.mRcs[j].value(), b.mCovMeans[j], b.mSeqs[j].length());
+                pTables.sequence(id, b.mSeqs[j]);
+            }
+            n += b.mSeqs.size();
+            mon.tick(n);
+        }
     }
 }
 
 void
-GossCmdBuildDb::storeReadLinks(const GossCmdContext& pCxt, const Graph& pG, const SuperGraph& pSg,  
-                               Sql::Database& pDb, bool pFresh)
+GossCmdBuildDb::storeReadLinks(const GossCmdContext& pCxt, const Graph& pG, const SuperGraph& pSg,
+                               Tables& pTables, Sql::Database* pExisting)
 {
     Logger& log(pCxt.log);
     FileFactory& fac(pCxt.fac);
@@ -594,10 +1069,11 @@ GossCmdBuildDb::storeReadLinks(const GossCmdContext& pCxt, const Graph& pG, cons
 
     const EntryEdgeSet& entries(pSg.entries());
     map<int64_t,uint64_t> dist;
-    ExternalBufferSort sorter(1024ULL * 1024ULL * 1024ULL, fac);
+    MemoryBudget::Reservation sortMem(pCxt.mem.reserve(1024ULL * 1024ULL * 1024ULL, 64ULL * 1024ULL * 1024ULL));
+    ExternalBufferSort sorter(sortMem.size(), fac);
     log(info, "constructing edge index");
 
-    auto idxPtr = EdgeIndex::create(pG, entries, pSg, mCacheRate, mNumThreads, log);
+    auto idxPtr = EdgeIndex::open(mIn, fac, pG, entries, pSg, mCacheRate, mNumThreads, log);
     EdgeIndex& idx(*idxPtr);
     const PairAligner alnr(pG, entries, idx);
 
@@ -633,7 +1109,8 @@ GossCmdBuildDb::storeReadLinks(const GossCmdContext& pCxt, const Graph& pG, cons
     log(info, "mapping pairs.");
 
     UniquenessCache ucache(pSg, coverage);
-    BackgroundMultiConsumer<PairLinker::ReadPair> grp(128);
+    ReadPairBatch::Pool pool;
+    BackgroundMultiConsumer<ReadPairBatchPtr> grp(2 * mNumThreads);
     vector<PairLinkerPtr> linkers;
     mutex mut;
     for (uint64_t i = 0; i < mNumThreads; ++i)
@@ -642,38 +1119,38 @@ GossCmdBuildDb::storeReadLinks(const GossCmdContext& pCxt, const Graph& pG, cons
         grp.add(*linkers.back());
     }
 
+    ReadPairBatchPtr batch(pool.get());
     while (reads.valid())
     {
-        grp.push_back(PairLinker::ReadPair(reads.lhs().clone(), reads.rhs().clone()));
+        batch->push_back(reads.lhs(), reads.rhs());
+        if (batch->full())
+        {
+            grp.push_back(batch);
+            batch = pool.get();
+        }
         ++reads;
     }
+    grp.push_back(batch);
+    batch.reset();
     grp.wait();
 
     const double dev = mInsertTolerance * mInsertStdDevFactor * mExpectedInsertSize;
     const uint64_t maxInsertSize = mExpectedInsertSize + dev;
 
-    LinkWriter writer(pSg, mExpectedInsertSize, pDb, pFresh);
+    LinkWriter writer(pSg, mExpectedInsertSize, pTables, pExisting);
     LinkFilter<LinkWriter> filter(writer, maxInsertSize, pSg, entries);
     LinkMapCompiler<LinkFilter<LinkWriter> > compiler(filter);
     sorter.sort(compiler);
 }
 
 void
-GossCmdBuildDb::storeGraphLinks(const GossCmdContext& pCxt, const Graph& pG, const SuperGraph& pSg, Sql::Database& pDb)
+GossCmdBuildDb::storeGraphLinks(const GossCmdContext& pCxt, const Graph& pG, const SuperGraph& pSg, Tables& pTables)
 {
     Logger& log(pCxt.log);
     ProgressMonitorNew mon(log, pSg.count());
     uint64_t n = 0;
     log(info, "storing graph links");
-    {
-        Sql::Transaction tn(pDb);
-        pDb.exec("DROP TABLE IF EXISTS " + linksTable + ";");
-        pDb.exec("CREATE TABLE IF NOT EXISTS " + linksTable + " (id_from INTEGER, id_to INTEGER, gap INTEGER, count INTEGER, type INTEGER);");
-        pDb.exec("CREATE INDEX IF NOT EXISTS index_from ON " + linksTable + " (id_from);");
-        pDb.exec("CREATE INDEX IF NOT EXISTS index_to ON " + linksTable + " (id_to);");
-    }
-    Sql::Transaction tn(pDb);
-    Sql::Statement write(pDb, "INSERT INTO " + linksTable + " VALUES (?, ?, ?, ?, ?);");
+    pTables.clearLinks();
 
     const EntryEdgeSet& entries(pSg.entries());
     SuperGraph::SuperPathIds succs;
@@ -688,13 +1165,7 @@ GossCmdBuildDb::storeGraphLinks(const GossCmdContext& pCxt, const Graph& pG, con
 	for (SuperGraph::SuperPathIds::const_iterator j = succs.begin(); j != succs.end(); ++j)
 	{
 	    const SuperPathId b(*j);
-	    write.bind(1, int64_t(a.value()));
-	    write.bind(2, int64_t(b.value()));
-	    write.bind(3, int64_t(0));
-	    write.bind(4, int64_t(1));
-	    write.bind(5, int64_t(PAIR_LINK));	    // FIX!
-	    write.step();
-	    write.reset();
+	    pTables.link(a.value(), b.value(), 0, 1, PAIR_LINK);	    // FIX!
 	}
     }
 }
@@ -712,8 +1183,25 @@ GossCmdFactoryBuildDb::create(App& pApp, const variables_map& pOpts)
     string db;
     chk.getMandatory("db-out", db);
 
-    bool reset;
-    chk.getOptional("reset", reset);
+    string fmtName = "sqlite";
+    chk.getOptional("db-format", fmtName);
+    GossCmdBuildDb::Format fmt = GossCmdBuildDb::SQLite;
+    if (fmtName == "csv")
+    {
+        fmt = GossCmdBuildDb::CSV;
+    }
+    else if (fmtName == "columns")
+    {
+        fmt = GossCmdBuildDb::Columns;
+    }
+    else if (fmtName != "sqlite")
+    {
+        BOOST_THROW_EXCEPTION(Gossamer::error()
+            << Gossamer::usage_info("db-format must be one of sqlite, csv or columns"));
+    }
+
+    bool reset = false;
+    chk.getOptional("reset-db", reset);
 
     bool incGraph;
     chk.getOptional("include-graph-links", incGraph);
@@ -787,7 +1275,7 @@ GossCmdFactoryBuildDb::create(App& pApp, const variables_map& pOpts)
 
     chk.throwIfNecessary(pApp);
 
-    return GossCmdPtr(new GossCmdBuildDb(in, db, reset, incGraph,
+    return GossCmdPtr(new GossCmdBuildDb(in, db, fmt, reset, incGraph,
 			    fastas, fastqs, lines,
 			    inferCoverage, expectedCoverage, expectedSize, stdDevFactor,
 			    tolerance, o, T, cr, estimateOnly));
@@ -813,6 +1301,8 @@ GossCmdFactoryBuildDb::GossCmdFactoryBuildDb()
 
     mSpecificOptions.addOpt<string>("db-out", "", 
             "name of the output database");
+    mSpecificOptions.addOpt<string>("db-format", "",
+            "sqlite (the default), csv for a CSV file per table with db-out as a prefix, or columns for a mappable file per column");
     mSpecificOptions.addOpt<bool>("reset-db", "",
             "clear the database before populating it, if it already exists");
     mSpecificOptions.addOpt<bool>("include-graph-links", "",
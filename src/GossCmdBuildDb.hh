@@ -29,16 +29,22 @@ public:
 
     typedef std::vector<std::string> strings;
 
+    // Where the rows go: an SQLite database, or flat files for tools
+    // that don't need SQL.
+    enum Format { SQLite, CSV, Columns };
+
+    class Tables;
+
     void operator()(const GossCmdContext& pCxt);
 
-    GossCmdBuildDb(const std::string& pIn, const std::string& pDb, 
+    GossCmdBuildDb(const std::string& pIn, const std::string& pDb, Format pFormat,
 		   bool pResetDb, bool pIncludeGraphLinks,
                    const strings& pFastas, const strings& pFastqs, const strings& pLines,
                    bool pInferCoverage, uint64_t pExpectedCoverage,
                    uint64_t pExpectedInsertSize, double pInsertStdDevFactor, double pInsertTolerance,
                    Orientation pOrientation, uint64_t pNumThreads, 
                    uint64_t pCacheRate, bool pEstimateOnly)
-        : mIn(pIn), mDb(pDb), mResetDb(pResetDb), mIncludeGraphLinks(pIncludeGraphLinks),
+        : mIn(pIn), mDb(pDb), mFormat(pFormat), mResetDb(pResetDb), mIncludeGraphLinks(pIncludeGraphLinks),
           mFastas(pFastas), mFastqs(pFastqs), mLines(pLines), 
           mInferCoverage(pInferCoverage), mExpectedCoverage(pExpectedCoverage),
           mExpectedInsertSize(pExpectedInsertSize), mInsertStdDevFactor(pInsertStdDevFactor),
@@ -49,12 +55,14 @@ public:
 
 private:
  
-    void storeContigs(const GossCmdContext& pCxt, const Graph& pG, const SuperGraph& pSg, Sql::Database& pDb);
-    void storeReadLinks(const GossCmdContext& pCxt, const Graph& pG, const SuperGraph& pSg, Sql::Database& pDb, bool pFresh);
-    void storeGraphLinks(const GossCmdContext& pCxt, const Graph& pG, const SuperGraph& pSg, Sql::Database& pDb);
+    void storeContigs(const GossCmdContext& pCxt, const Graph& pG, const SuperGraph& pSg, Tables& pTables);
+    void storeReadLinks(const GossCmdContext& pCxt, const Graph& pG, const SuperGraph& pSg,
+                        Tables& pTables, Sql::Database* pExisting);
+    void storeGraphLinks(const GossCmdContext& pCxt, const Graph& pG, const SuperGraph& pSg, Tables& pTables);
 
     const std::string mIn;
     const std::string mDb;
+    const Format mFormat;
     const bool mResetDb;
     const bool mIncludeGraphLinks;
     const strings mFastas;
@@ -30,6 +30,7 @@
 #include "RunLengthCodedBitVectorWord.hh"
 #include "RunLengthCodedSet.hh"
 #include "Timer.hh"
+#include "UnitigIndex.hh"
 #include "VByteCodec.hh"
 
 #include <iostream>
@@ -61,7 +62,8 @@ GossCmdBuildEntryEdgeSet::operator()(const GossCmdContext& pCxt)
             << Gossamer::general_error_info("Asymmetric graphs not yet handled")
             << Gossamer::open_graph_name_info(mIn));
     }
-    EntryEdgeSet::build(g, mIn + "-entries", fac, log, mThreads);
+    UnitigIndexPtr unitigs = UnitigIndex::open(mIn + "-unitigs", g, fac, log);
+    EntryEdgeSet::build(g, mIn + "-entries", fac, log, mThreads, unitigs.get());
     log(info, "total elapsed time: " + lexical_cast<string>(t.check()));
 }
 
@@ -220,6 +220,7 @@ namespace // anonymous
     }
 
     void flush(const BackyardHash& pHash, uint64_t pK, const std::string& pGraphName,
+               VariableByteArray::Format pCountsFormat,
                uint64_t pNumThreads, Logger& pLog, FileFactory& pFactory)
     {
         vector<uint32_t> perm;
@@ -230,7 +231,7 @@ namespace // anonymous
 
         try 
         {
-            Graph::Builder bld(pK, pGraphName, pFactory, perm.size());
+            Graph::Builder bld(pK, pGraphName, pFactory, perm.size(), false, pCountsFormat);
             if (perm.size() > 0)
             {
                 // Keep track of the previous edge/count pair,
@@ -312,10 +313,15 @@ GossCmdBuildGraph::operator()(const GossCmdContext& pCxt)
     log(info, "using " + lexical_cast<string>(mS) + " slot bits.");
     log(info, "using " + lexical_cast<string>(log2((double)mN)) + " table bits.");
 
+    MemoryBudget::Reservation hashMem(pCxt.mem.reserve(BackyardHash::estimatedSizeForSlots(mN),
+                                                       BackyardHash::estimatedSizeForSlots(mN)));
     BackyardHash h(mS, 2 * rho, mN);
     BackyardConsumer bc(h);
 
-    BackgroundMultiConsumer<KmerBlockPtr> bg(4096);
+    // The queue of blocks waiting to be hashed.
+    const uint64_t blkBytes = blkSz * sizeof(Gossamer::edge_type);
+    MemoryBudget::Reservation queueMem(pCxt.mem.reserve(4096 * blkBytes, 64 * blkBytes));
+    BackgroundMultiConsumer<KmerBlockPtr> bg(queueMem.size() / blkBytes);
     for (uint64_t i = 0; i < mT; ++i)
     {
         bg.add(bc);
@@ -388,7 +394,7 @@ GossCmdBuildGraph::operator()(const GossCmdContext& pCxt)
     if (parts.size() == 0)
     {
         log(info, "writing out graph (no merging necessary).");
-        flush(h, mK, mGraphName, mT, log, fac);
+        flush(h, mK, mGraphName, mCountsFormat, mT, log, fac);
     }
     else
     {
@@ -407,7 +413,7 @@ GossCmdBuildGraph::operator()(const GossCmdContext& pCxt)
         log(info, "merging temporary graphs");
         log(info, "estimated number of edges " + lexical_cast<string>(z));
 
-        AsyncMerge::merge<Graph>(parts, sizes, mGraphName, mK, z, mT, 65536, fac);
+        AsyncMerge::merge<Graph>(parts, sizes, mGraphName, mK, z, mT, 65536, fac, false, mCountsFormat);
 
         for (uint64_t i = 0; i < parts.size(); ++i)
         {
@@ -415,6 +421,12 @@ GossCmdBuildGraph::operator()(const GossCmdContext& pCxt)
         }
     }
 
+    if (mSaveStats)
+    {
+        log(info, "computing graph statistics");
+        Graph::saveStats(mGraphName, fac, mT);
+    }
+
     log(info, "finish graph build");
     log(info, "total build time: " + lexical_cast<string>(t.check()));
     if (lintAfterBuild.on())
@@ -434,7 +446,7 @@ GossCmdFactoryBuildGraph::create(App& pApp, const variables_map& pOpts)
     chk.getMandatory("kmer-size", K, GossOptionChecker::RangeCheck(Graph::MaxK));
 
     uint64_t B = 2;
-    chk.getOptional("buffer-size", B);
+    bool explicitB = chk.getOptional("buffer-size", B);
 
     if (B > 24)
     {
@@ -442,9 +454,16 @@ GossCmdFactoryBuildGraph::create(App& pApp, const variables_map& pOpts)
         B = 24;
     }
 
-    uint64_t S = BackyardHash::maxSlotBits(B << 30);
+    // Fit the hash table into the memory budget, if there is one.
+    uint64_t bytes = std::min<uint64_t>(pApp.memoryBudget().bufferSize(B << 30, explicitB, 1ULL << 26), 24ULL << 30);
+    if (bytes != (B << 30))
+    {
+        pApp.logger()(info, "using a " + lexical_cast<string>(bytes >> 20) + "MB buffer to fit --max-memory.");
+    }
+
+    uint64_t S = BackyardHash::maxSlotBits(bytes);
 
-    uint64_t N = (B << 30) / (1.5 * sizeof(uint32_t) + sizeof(BackyardHash::value_type));
+    uint64_t N = bytes / (1.5 * sizeof(uint32_t) + sizeof(BackyardHash::value_type));
 
     uint64_t T = 4;
     chk.getOptional("num-threads", T);
@@ -471,9 +490,14 @@ GossCmdFactoryBuildGraph::create(App& pApp, const variables_map& pOpts)
     strings lineNames;
     chk.getRepeating0("line-in", lineNames, readChk);
 
+    bool fusedCounts = false;
+    chk.getOptional("fused-counts", fusedCounts);
+
     chk.throwIfNecessary(pApp);
 
-    return GossCmdPtr(new GossCmdBuildGraph(K, S, N, T, graphName, fastaNames, fastqNames, lineNames));
+    return GossCmdPtr(new GossCmdBuildGraph(K, S, N, T, graphName, fastaNames, fastqNames, lineNames,
+                                            fusedCounts ? VariableByteArray::FusedFormat
+                                                        : VariableByteArray::LayeredFormat));
 }
 
 GossCmdFactoryBuildGraph::GossCmdFactoryBuildGraph()
@@ -487,4 +511,7 @@ GossCmdFactoryBuildGraph::GossCmdFactoryBuildGraph()
     mCommonOptions.insert("line-in");
     mCommonOptions.insert("fastas-in");
     mCommonOptions.insert("fastqs-in");
+
+    mSpecificOptions.addOpt<bool>("fused-counts", "",
+            "store edge counts in blocks for faster lookup, at the cost of slightly more space");
 }
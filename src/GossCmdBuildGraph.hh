@@ -13,6 +13,10 @@
 #include "GossCmd.hh"
 #endif
 
+#ifndef VARIABLEBYTEARRAY_HH
+#include "VariableByteArray.hh"
+#endif
+
 class GossCmdBuildGraph : public GossCmd
 {
 public:
@@ -20,11 +24,16 @@ public:
 
     void operator()(const GossCmdContext& pCxt);
 
+    // pSaveStats should be false when the graph is only an intermediate
+    // result, which doesn't need its statistics saved.
     GossCmdBuildGraph(const uint64_t& pK, const uint64_t& pS, const uint64_t& pN,
                       const uint64_t& pT, const std::string& pGraphName,
-                      const strings& pFastaNames, const strings& pFastqNames, const strings& pLineNames)
+                      const strings& pFastaNames, const strings& pFastqNames, const strings& pLineNames,
+                      VariableByteArray::Format pCountsFormat = VariableByteArray::LayeredFormat,
+                      bool pSaveStats = true)
         : mK(pK), mS(pS), mN(pN), mT(pT), mGraphName(pGraphName),
-          mFastaNames(pFastaNames), mFastqNames(pFastqNames), mLineNames(pLineNames)
+          mFastaNames(pFastaNames), mFastqNames(pFastqNames), mLineNames(pLineNames),
+          mCountsFormat(pCountsFormat), mSaveStats(pSaveStats)
     {
     }
 
@@ -37,6 +46,8 @@ private:
     const strings mFastaNames;
     const strings mFastqNames;
     const strings mLineNames;
+    const VariableByteArray::Format mCountsFormat;
+    const bool mSaveStats;
 };
 
 class GossCmdFactoryBuildGraph : public GossCmdFactory
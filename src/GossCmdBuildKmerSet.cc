@@ -158,12 +158,19 @@ GossCmdFactoryBuildKmerSet::create(App& pApp, const variables_map& pOpts)
     chk.getMandatory("kmer-size", K, GossOptionChecker::RangeCheck(KmerSet::MaxK));
 
     uint64_t B = 2;
-    chk.getOptional("buffer-size", B);
+    bool explicitB = chk.getOptional("buffer-size", B);
 
-    uint64_t S = BackyardHash::maxSlotBits(B << 30);
+    // Fit the hash table into the memory budget, if there is one.
+    uint64_t bytes = pApp.memoryBudget().bufferSize(B << 30, explicitB, 1ULL << 26);
+    if (bytes != (B << 30))
+    {
+        pApp.logger()(info, "using a " + lexical_cast<string>(bytes >> 20) + "MB buffer to fit --max-memory.");
+    }
+
+    uint64_t S = BackyardHash::maxSlotBits(bytes);
     chk.getOptional("log-hash-slots", S);
 
-    uint64_t N = (B << 30) / (1.5 * sizeof(uint32_t) + sizeof(BackyardHash::value_type));
+    uint64_t N = bytes / (1.5 * sizeof(uint32_t) + sizeof(BackyardHash::value_type));
 
     uint64_t T = 4;
     chk.getOptional("num-threads", T);
@@ -192,9 +199,13 @@ GossCmdFactoryBuildKmerSet::create(App& pApp, const variables_map& pOpts)
     strings lineNames;
     chk.getRepeating0("line-in", lineNames, readChk);
 
+    uint64_t prefilterBits = 0;
+    chk.getOptional("prefilter-bits", prefilterBits);
+
     chk.throwIfNecessary(pApp);
 
-    return GossCmdPtr(new GossCmdBuildKmerSet(K, S, N, T, graphName, fastaNames, fastqNames, lineNames));
+    return GossCmdPtr(new GossCmdBuildKmerSet(K, S, N, T, graphName, fastaNames, fastqNames, lineNames,
+                                              prefilterBits));
 }
 
 GossCmdFactoryBuildKmerSet::GossCmdFactoryBuildKmerSet()
@@ -209,6 +220,7 @@ GossCmdFactoryBuildKmerSet::GossCmdFactoryBuildKmerSet()
     mCommonOptions.insert("fastqs-in");
     mCommonOptions.insert("line-in");
     mCommonOptions.insert("log-hash-slots");
+    mCommonOptions.insert("prefilter-bits");
 
     mSpecificOptions.addOpt<uint64_t>("log-hash-slots", "S",
             "log2 of the number of hash slots to use (default 24)");
@@ -25,15 +25,17 @@ public:
     GossCmdBuildKmerSet(const uint64_t& pK, const uint64_t& pS, const uint64_t& pN,
                         const uint64_t& pT, const std::string& pKmerSetName)
         : mK(pK), mS(pS), mN(pN), mT(pT), mKmerSetName(pKmerSetName),
-          mFastaNames(), mFastqNames(), mLineNames()
+          mFastaNames(), mFastqNames(), mLineNames(), mPrefilterBits(0), mSketchSize(0)
     {
     }
 
     GossCmdBuildKmerSet(const uint64_t& pK, const uint64_t& pS, const uint64_t& pN,
                       const uint64_t& pT, const std::string& pKmerSetName,
-                      const strings& pFastaNames, const strings& pFastqNames, const strings& pLineNames)
+                      const strings& pFastaNames, const strings& pFastqNames, const strings& pLineNames,
+                      uint64_t pPrefilterBits = 0, uint64_t pSketchSize = 0)
         : mK(pK), mS(pS), mN(pN), mT(pT), mKmerSetName(pKmerSetName),
-          mFastaNames(pFastaNames), mFastqNames(pFastqNames), mLineNames(pLineNames)
+          mFastaNames(pFastaNames), mFastqNames(pFastqNames), mLineNames(pLineNames),
+          mPrefilterBits(pPrefilterBits), mSketchSize(pSketchSize)
     {
     }
 
@@ -46,6 +48,8 @@ private:
     const strings mFastaNames;
     const strings mFastqNames;
     const strings mLineNames;
+    const uint64_t mPrefilterBits;
+    const uint64_t mSketchSize;
 };
 
 class GossCmdFactoryBuildKmerSet : public GossCmdFactory
@@ -223,10 +223,15 @@ GossCmdBuildKmerSet::operator()(const GossCmdContext& pCxt, KmerSrc& pKmerSrc)
     log(info, "using " + boost::lexical_cast<std::string>(mS) + " slot bits.");
     log(info, "using " + boost::lexical_cast<std::string>(log2(mN)) + " table bits.");
 
+    MemoryBudget::Reservation hashMem(pCxt.mem.reserve(BackyardHash::estimatedSizeForSlots(mN),
+                                                       BackyardHash::estimatedSizeForSlots(mN)));
     BackyardHash h(mS, 2 * mK, mN);
     BackyardConsumer bc(h);
 
-    BackgroundMultiConsumer<KmerBlockPtr> bg(4096);
+    // The queue of blocks waiting to be hashed.
+    const uint64_t blkBytes = blkSz * sizeof(Gossamer::edge_type);
+    MemoryBudget::Reservation queueMem(pCxt.mem.reserve(4096 * blkBytes, 64 * blkBytes));
+    BackgroundMultiConsumer<KmerBlockPtr> bg(queueMem.size() / blkBytes);
     for (uint64_t i = 0; i < mT; ++i)
     {
         bg.add(bc);
@@ -327,6 +332,18 @@ GossCmdBuildKmerSet::operator()(const GossCmdContext& pCxt, KmerSrc& pKmerSrc)
         }
     }
 
+    if (mPrefilterBits)
+    {
+        log(info, "building prefilter");
+        KmerSet::buildPrefilter(mKmerSetName, fac, mPrefilterBits);
+    }
+
+    if (mSketchSize)
+    {
+        log(info, "building sketch");
+        KmerSet::buildSketch(mKmerSetName, fac, mSketchSize);
+    }
+
     log(info, "finish graph build");
     log(info, "total build time: " + boost::lexical_cast<std::string>(t.check()));
 }
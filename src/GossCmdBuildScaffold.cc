@@ -333,7 +333,8 @@ GossCmdBuildScaffold::operator()(const GossCmdContext& pCxt)
     const EntryEdgeSet& entries(sg.entries());
 
     map<int64_t,uint64_t> dist;
-    ExternalBufferSort sorter(1024ULL * 1024ULL * 1024ULL, fac);
+    MemoryBudget::Reservation sortMem(pCxt.mem.reserve(1024ULL * 1024ULL * 1024ULL, 64ULL * 1024ULL * 1024ULL));
+    ExternalBufferSort sorter(sortMem.size(), fac);
 
     log(info, "constructing edge index");
     GraphPtr gPtr = Graph::open(mIn, fac);
@@ -345,7 +346,7 @@ GossCmdBuildScaffold::operator()(const GossCmdContext& pCxt)
             << Gossamer::open_graph_name_info(mIn));
     }
 
-    auto idxPtr = EdgeIndex::create(g, entries, sg, mCacheRate, mNumThreads, log);
+    auto idxPtr = EdgeIndex::open(mIn, fac, g, entries, sg, mCacheRate, mNumThreads, log);
     EdgeIndex& idx(*idxPtr);
     const PairAligner alnr(g, entries, idx);
 
@@ -381,7 +382,8 @@ GossCmdBuildScaffold::operator()(const GossCmdContext& pCxt)
     log(info, "mapping pairs.");
 
     UniquenessCache ucache(sg, coverage);
-    BackgroundMultiConsumer<PairLinker::ReadPair> grp(128);
+    ReadPairBatch::Pool pool;
+    BackgroundMultiConsumer<ReadPairBatchPtr> grp(2 * mNumThreads);
     vector<PairLinkerPtr> linkers;
     mutex mut;
     for (uint64_t i = 0; i < mNumThreads; ++i)
@@ -390,11 +392,19 @@ GossCmdBuildScaffold::operator()(const GossCmdContext& pCxt)
         grp.add(*linkers.back());
     }
 
+    ReadPairBatchPtr batch(pool.get());
     while (reads.valid())
     {
-        grp.push_back(PairLinker::ReadPair(reads.lhs().clone(), reads.rhs().clone()));
+        batch->push_back(reads.lhs(), reads.rhs());
+        if (batch->full())
+        {
+            grp.push_back(batch);
+            batch = pool.get();
+        }
         ++reads;
     }
+    grp.push_back(batch);
+    batch.reset();
     grp.wait();
 
     log(info, "merging results.");
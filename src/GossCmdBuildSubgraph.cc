@@ -22,7 +22,15 @@
 #include "ReadSequenceFileSequence.hh"
 #include "ReverseComplementAdapter.hh"
 #include "Timer.hh"
-
+#include "WorkQueue.hh"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <boost/lexical_cast.hpp>
 
@@ -53,77 +61,190 @@ namespace // anonymous
         vector<EdgeAndRank>& mEdges;
     };
 
-    struct SingleFollower
+    void sortUnique(vector<uint64_t>& pRanks)
     {
-        static void follow(const Graph& pGraph,
-                           dynamic_bitset<>& pInteresting, dynamic_bitset<>& pFringe,
-                           const Graph::Edge& pEdge)
+        sort(pRanks.begin(), pRanks.end());
+        pRanks.erase(unique(pRanks.begin(), pRanks.end()), pRanks.end());
+    }
+
+    // Look up a batch of read k-mers.
+    class SeedBatch
+    {
+    public:
+        void operator()()
         {
-            pair<uint64_t,uint64_t> r = pGraph.beginEndRank(pGraph.to(pEdge));
-            for (uint64_t k = r.first; k < r.second; ++k)
+            for (uint64_t i = 0; i < mKmers.size(); ++i)
             {
-                pFringe[k] = !pInteresting[k];
-                Graph::Edge f = pGraph.select(k);
-                Graph::Edge f_rc = pGraph.reverseComplement(f);
-                uint64_t k_rc = pGraph.rank(f_rc);
-                pFringe[k_rc] = !pInteresting[k_rc];
+                uint64_t r = 0;
+                if (mGraph.accessAndRank(mKmers[i], r))
+                {
+                    mRanks.push_back(r);
+                }
+            }
+            vector<Graph::Edge>().swap(mKmers);
+
+            // Reads overlap, so most of the ranks are repeats.
+            sortUnique(mRanks);
+            mRanks.shrink_to_fit();
+
+            std::unique_lock<std::mutex> lock(mMutex);
+            mDone = true;
+            mCond.notify_all();
+        }
+
+        bool done()
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            return mDone;
+        }
+
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (!mDone)
+            {
+                mCond.wait(lock);
             }
         }
-    };
 
-    struct SegmentFollower
+        SeedBatch(const Graph& pGraph)
+            : mGraph(pGraph), mDone(false)
+        {
+        }
+
+        const Graph& mGraph;
+        vector<Graph::Edge> mKmers;
+        vector<uint64_t> mRanks;
+
+    private:
+        std::mutex mMutex;
+        std::condition_variable mCond;
+        bool mDone;
+    };
+    typedef std::shared_ptr<SeedBatch> SeedBatchPtr;
+
+    // Expand a run of the frontier by one step: the edges leaving the
+    // end of each edge (or, for linear paths, the end of the path it
+    // starts), in both orientations. The visited edges are a sorted
+    // vector of ranks, which is only read during a step, so the cost
+    // depends on the size of the subgraph and not of the graph.
+    class Expander
     {
-        static void follow(const Graph& pGraph,
-                           dynamic_bitset<>& pInteresting, dynamic_bitset<>& pFringe,
-                           const Graph::Edge& pEdge)
+    public:
+        void operator()()
         {
-            vector<EdgeAndRank> ers;
-            Vis v(ers);
-            Graph::Edge e = pGraph.linearPath(pEdge, v);
-            for (uint64_t i = 0; i < ers.size(); ++i)
+            for (uint64_t i = mBegin; i < mEnd; ++i)
             {
-                pInteresting[ers[i].second] = true;
-                Graph::Edge f = pGraph.reverseComplement(ers[i].first);
-                uint64_t r = pGraph.rank(f);
-                pInteresting[r] = true;
+                const Graph::Edge e = mGraph.select(mFrontier[i]);
+                follow(e);
+                follow(mGraph.reverseComplement(e));
             }
-            SingleFollower::follow(pGraph, pInteresting, pFringe, e);
+            sortUnique(mNext);
+            sortUnique(mPath);
+        }
+
+        Expander(const Graph& pGraph, bool pLinearPaths, const vector<uint64_t>& pVisited,
+                 const vector<uint64_t>& pFrontier, uint64_t pBegin, uint64_t pEnd)
+            : mGraph(pGraph), mLinearPaths(pLinearPaths), mVisited(pVisited),
+              mFrontier(pFrontier), mBegin(pBegin), mEnd(pEnd)
+        {
         }
+
+        vector<uint64_t> mNext;
+        vector<uint64_t> mPath;
+
+    private:
+        void follow(Graph::Edge pEdge)
+        {
+            if (mLinearPaths)
+            {
+                mEdges.clear();
+                Vis v(mEdges);
+                pEdge = mGraph.linearPath(pEdge, v);
+                for (uint64_t i = 0; i < mEdges.size(); ++i)
+                {
+                    add(mEdges[i].second, mPath);
+                    add(mGraph.rank(mGraph.reverseComplement(mEdges[i].first)), mPath);
+                }
+            }
+            pair<uint64_t,uint64_t> r = mGraph.beginEndRank(mGraph.to(pEdge));
+            for (uint64_t k = r.first; k < r.second; ++k)
+            {
+                add(k, mNext);
+                add(mGraph.rank(mGraph.reverseComplement(mGraph.select(k))), mNext);
+            }
+        }
+
+        void add(uint64_t pRank, vector<uint64_t>& pTo)
+        {
+            if (!binary_search(mVisited.begin(), mVisited.end(), pRank))
+            {
+                pTo.push_back(pRank);
+            }
+        }
+
+        const Graph& mGraph;
+        const bool mLinearPaths;
+        const vector<uint64_t>& mVisited;
+        const vector<uint64_t>& mFrontier;
+        const uint64_t mBegin;
+        const uint64_t mEnd;
+        vector<EdgeAndRank> mEdges;
     };
+    typedef std::shared_ptr<Expander> ExpanderPtr;
 
+    vector<uint64_t> sortedUnion(const vector<uint64_t>& pLhs, const vector<uint64_t>& pRhs)
+    {
+        vector<uint64_t> u;
+        u.reserve(pLhs.size() + pRhs.size());
+        set_union(pLhs.begin(), pLhs.end(), pRhs.begin(), pRhs.end(), back_inserter(u));
+        return u;
+    }
 
-    template <typename Scanner>
-    void scanGraph(const Graph& pGraph, uint64_t pRadius, dynamic_bitset<>& pInteresting, Logger& pLog)
+    vector<uint64_t> sortedDifference(const vector<uint64_t>& pLhs, const vector<uint64_t>& pRhs)
     {
-        dynamic_bitset<> prev(pInteresting);
-        dynamic_bitset<> fringe(pGraph.count());
+        vector<uint64_t> d;
+        set_difference(pLhs.begin(), pLhs.end(), pRhs.begin(), pRhs.end(), back_inserter(d));
+        return d;
+    }
+
+    // Expand the seeds pRadius steps, a level at a time. Edges on the
+    // linear paths walked in a step are visited but, like the seeds,
+    // only the edges beyond them are expanded in the next step.
+    void scanGraph(const Graph& pGraph, bool pLinearPaths, uint64_t pRadius, uint64_t pThreads,
+                   vector<uint64_t>& pVisited, Logger& pLog)
+    {
+        vector<uint64_t> frontier(pVisited);
         for (uint64_t i = 0; i < pRadius; ++i)
         {
-            uint64_t n = pInteresting.count();
-            fringe.clear();
-            fringe.resize(pGraph.count());
-            for (uint64_t j = 0; j < prev.size(); ++j)
+            vector<ExpanderPtr> batches;
             {
-                // What we really want is a select driven loop!
-                if (!prev[j])
+                const uint64_t numBatches = min<uint64_t>(frontier.size(), 16 * max<uint64_t>(pThreads, 1));
+                WorkQueue q(pThreads);
+                for (uint64_t j = 0; j < numBatches; ++j)
                 {
-                    continue;
+                    const uint64_t b = frontier.size() * j / numBatches;
+                    const uint64_t e = frontier.size() * (j + 1) / numBatches;
+                    batches.push_back(ExpanderPtr(new Expander(pGraph, pLinearPaths, pVisited, frontier, b, e)));
+                    q.push_back(std::bind<void>(std::ref(*batches.back())));
                 }
+                q.wait();
+            }
 
-                // Add the successor edges
-                //
-                Graph::Edge e = pGraph.select(j);
-                Scanner::follow(pGraph, pInteresting, fringe, e);
-
-                // Add the predecessor edges
-                //
-                Graph::Edge e_rc = pGraph.reverseComplement(e);
-                Scanner::follow(pGraph, pInteresting, fringe, e_rc);
+            vector<uint64_t> next;
+            vector<uint64_t> path;
+            for (uint64_t j = 0; j < batches.size(); ++j)
+            {
+                next.insert(next.end(), batches[j]->mNext.begin(), batches[j]->mNext.end());
+                path.insert(path.end(), batches[j]->mPath.begin(), batches[j]->mPath.end());
+                batches[j] = ExpanderPtr();
             }
-            pInteresting |= fringe;
-            n = pInteresting.count() - n;
-            prev.swap(fringe);
-            pLog(info, "pass " + lexical_cast<string>(i) + " identified " + lexical_cast<string>(n) + " additional edges.");
+            sortUnique(next);
+            sortUnique(path);
+            frontier = sortedDifference(next, path);
+            const vector<uint64_t> added = sortedUnion(path, frontier);
+            pVisited = sortedUnion(pVisited, added);
+            pLog(info, "pass " + lexical_cast<string>(i) + " identified " + lexical_cast<string>(added.size()) + " additional edges.");
         }
     }
 
@@ -177,34 +298,65 @@ GossCmdBuildSubgraph::operator()(const GossCmdContext& pCxt)
 
     ReverseComplementAdapter revs(reads, k + 1);
 
-    dynamic_bitset<> interesting(g.count());
-
-    while (revs.valid())
+    // Find the seed edges, looking them up in batches on the workers.
+    // Only a few batches per worker are kept in flight, so reading
+    // can't run ahead of the lookups, and each batch's ranks are merged
+    // as soon as it (and those before it) are done.
+    vector<uint64_t> interesting;
     {
-        Graph::Edge e(*revs);
-        uint64_t r = 0;
-        if (g.accessAndRank(e, r))
+        const uint64_t batchSize = 65536;
+        const uint64_t threads = std::max<uint64_t>(mNumThreads, 1);
+        const uint64_t maxPending = 4 * threads;
+        std::deque<SeedBatchPtr> pending;
+        uint64_t distinct = 0;
+
+        auto mergeFront = [&] () {
+            SeedBatchPtr b = pending.front();
+            pending.pop_front();
+            b->wait();
+            interesting.insert(interesting.end(), b->mRanks.begin(), b->mRanks.end());
+            if (interesting.size() > 2 * distinct + batchSize)
+            {
+                sortUnique(interesting);
+                distinct = interesting.size();
+            }
+        };
+
+        WorkQueue q(threads);
+        SeedBatchPtr batch(new SeedBatch(g));
+        while (revs.valid())
         {
-            interesting[r] = true;
+            batch->mKmers.push_back(Graph::Edge(*revs));
+            if (batch->mKmers.size() == batchSize)
+            {
+                pending.push_back(batch);
+                q.push_back(std::bind<void>(std::ref(*batch)));
+                batch = SeedBatchPtr(new SeedBatch(g));
+                while (!pending.empty()
+                       && (pending.size() > maxPending || pending.front()->done()))
+                {
+                    mergeFront();
+                }
+            }
+            ++revs;
+        }
+        pending.push_back(batch);
+        q.push_back(std::bind<void>(std::ref(*batch)));
+        q.wait();
+        while (!pending.empty())
+        {
+            mergeFront();
         }
-        ++revs;
-    }
-    if (mLinearPaths)
-    {
-        scanGraph<SegmentFollower>(g, mRadius, interesting, log);
-    }
-    else
-    {
-        scanGraph<SingleFollower>(g, mRadius, interesting, log);
     }
+    sortUnique(interesting);
 
-    Graph::Builder bld(g.K(), mOut, fac, interesting.count());
+    scanGraph(g, mLinearPaths, mRadius, mNumThreads, interesting, log);
+
+    Graph::Builder bld(g.K(), mOut, fac, interesting.size(), false, g.countsFormat());
     for (uint64_t i = 0; i < interesting.size(); ++i)
     {
-        if (interesting[i])
-        {
-            bld.push_back(g.select(i).value(), uint64_t(g.multiplicity(i)));
-        }
+        const uint64_t r = interesting[i];
+        bld.push_back(g.select(r).value(), uint64_t(g.multiplicity(r)));
     }
     bld.end();
 
@@ -243,12 +395,15 @@ GossCmdFactoryBuildSubgraph::create(App& pApp, const variables_map& pOpts)
     chk.getOptional("linear-paths", lp);
 
     uint64_t B = 2;
-    chk.getOptional("buffer-size", B);
-    B *= 1024ULL * 1024ULL * 1024ULL;
+    bool explicitB = chk.getOptional("buffer-size", B);
+    B = pApp.memoryBudget().bufferSize(B * 1024ULL * 1024ULL * 1024ULL, explicitB, 1ULL << 26);
+
+    uint64_t T = 4;
+    chk.getOptional("num-threads", T);
 
     chk.throwIfNecessary(pApp);
 
-    return GossCmdPtr(new GossCmdBuildSubgraph(in, out, fastaNames, fastqNames, lineNames, radius, lp, B));
+    return GossCmdPtr(new GossCmdBuildSubgraph(in, out, fastaNames, fastqNames, lineNames, radius, lp, B, T));
 }
 
 GossCmdFactoryBuildSubgraph::GossCmdFactoryBuildSubgraph()
@@ -22,10 +22,10 @@ public:
 
     GossCmdBuildSubgraph(const std::string& pIn, const std::string& pOut,
                          const strings& pFastaNames, const strings& pFastqNames, const strings& pLineNames,
-                         uint64_t pRadius, bool pLinearPaths, uint64_t pB)
+                         uint64_t pRadius, bool pLinearPaths, uint64_t pB, uint64_t pNumThreads)
         : mIn(pIn), mOut(pOut), 
           mFastaNames(pFastaNames), mFastqNames(pFastqNames), mLineNames(pLineNames),
-          mRadius(pRadius), mLinearPaths(pLinearPaths), mB(pB)
+          mRadius(pRadius), mLinearPaths(pLinearPaths), mB(pB), mNumThreads(pNumThreads)
     {
     }
 
@@ -38,6 +38,7 @@ private:
     const uint64_t mRadius;
     bool mLinearPaths;
     const uint64_t mB;
+    const uint64_t mNumThreads;
 };
 
 
@@ -0,0 +1,60 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "GossCmdBuildUnitigs.hh"
+
+#include "GossCmdReg.hh"
+#include "GossOptionChecker.hh"
+#include "Graph.hh"
+#include "Timer.hh"
+#include "UnitigIndex.hh"
+
+using namespace boost;
+using namespace std;
+
+void
+GossCmdBuildUnitigs::operator()(const GossCmdContext& pCxt)
+{
+    FileFactory& fac(pCxt.fac);
+    Logger& log(pCxt.log);
+    Timer t;
+
+    log(info, "Loading graph");
+    GraphPtr gPtr = Graph::open(mIn, fac);
+    Graph& g(*gPtr);
+    if (g.asymmetric())
+    {
+        BOOST_THROW_EXCEPTION(Gossamer::error()
+            << Gossamer::general_error_info("Asymmetric graphs not yet handled")
+            << Gossamer::open_graph_name_info(mIn));
+    }
+    UnitigIndex::build(g, mIn + "-unitigs", fac, log, pCxt.mem, mThreads);
+    log(info, "total elapsed time: " + lexical_cast<string>(t.check()));
+}
+
+GossCmdPtr
+GossCmdFactoryBuildUnitigs::create(App& pApp, const boost::program_options::variables_map& pOpts)
+{
+    GossOptionChecker chk(pOpts);
+
+    string in;
+    chk.getRepeatingOnce("graph-in", in);
+
+    uint64_t t = 4;
+    chk.getOptional("num-threads", t);
+
+    chk.throwIfNecessary(pApp);
+
+    return GossCmdPtr(new GossCmdBuildUnitigs(in, t));
+}
+
+GossCmdFactoryBuildUnitigs::GossCmdFactoryBuildUnitigs()
+    : GossCmdFactory("build an index of the unitigs (maximal linear paths) of a graph")
+{
+    mCommonOptions.insert("graph-in");
+}
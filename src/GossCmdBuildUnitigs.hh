@@ -0,0 +1,39 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef GOSSCMDBUILDUNITIGS_HH
+#define GOSSCMDBUILDUNITIGS_HH
+
+#ifndef GOSSCMD_HH
+#include "GossCmd.hh"
+#endif
+
+class GossCmdBuildUnitigs : public GossCmd
+{
+public:
+    void operator()(const GossCmdContext& pCxt);
+
+    GossCmdBuildUnitigs(const std::string& pIn, uint64_t pThreads)
+        : mIn(pIn), mThreads(pThreads)
+    {
+    }
+
+private:
+    const std::string mIn;
+    const uint64_t mThreads;
+};
+
+class GossCmdFactoryBuildUnitigs : public GossCmdFactory
+{
+public:
+    GossCmdPtr create(App& pApp, const boost::program_options::variables_map& pOpts);
+
+    GossCmdFactoryBuildUnitigs();
+};
+
+#endif // GOSSCMDBUILDUNITIGS_HH
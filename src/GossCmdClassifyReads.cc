@@ -531,8 +531,8 @@ GossCmdFactoryClassifyReads::create(App& pApp, const boost::program_options::var
     chk.getRepeating0("line-in", lines, readChk);
 
     uint64_t b = 2;
-    chk.getOptional("buffer-size", b);
-    b *= 1024ULL * 1024ULL * 1024ULL;
+    bool explicitB = chk.getOptional("buffer-size", b);
+    b = pApp.memoryBudget().bufferSize(b * 1024ULL * 1024ULL * 1024ULL, explicitB, 1ULL << 26);
 
     uint64_t T = 4;
     chk.getOptional("num-threads", T);
@@ -13,6 +13,7 @@
 #include "Graph.hh"
 #include "ProgressMonitor.hh"
 #include "Timer.hh"
+#include "UnitigIndex.hh"
 
 #include <string>
 #include <boost/lexical_cast.hpp>
@@ -82,6 +83,30 @@ Gossamer::rank_type rcRank(Graph& pG, Gossamer::rank_type pR)
     return pG.rank(e);
 }
 
+// Is the link whose edges have ranks pRanks, from node pFrom, short,
+// and a minor branch at both ends? If so, mark its edges and their
+// reverse complements in pZap.
+bool clip(Graph& pG, Graph::Node& pFrom, const vector<Gossamer::rank_type>& pRanks,
+          double pThresh, uint32_t pMinLen, dynamic_bitset<>& pZap)
+{
+    Graph::Node e_t = pG.to(pG.select((pRanks.back())));
+    uint32_t c_f = pG.multiplicity(pRanks.front());
+    uint32_t c_t = pG.multiplicity(pRanks.back());
+
+    if (   minorOut(pG, pFrom, c_f, pThresh)
+        && minorIn(pG, e_t, c_t, pThresh)
+        && pRanks.size() <= pMinLen)
+    {
+        for (uint64_t j = 0; j < pRanks.size(); ++j)
+        {
+            pZap[pRanks[j]] = true;
+            pZap[rcRank(pG, pRanks[j])] = true;
+        }
+        return true;
+    }
+    return false;
+}
+
 };
 
 void
@@ -115,41 +140,62 @@ GossCmdClipLinks::operator()(const GossCmdContext& pCxt)
     uint32_t linksZapped = 0;
     uint32_t edgesZapped = 0;
  
+    // A link starts at a node with more than one out edge, so it is a
+    // unitig. With a unitig index, the links are read from it rather
+    // than walked.
+    UnitigIndexPtr unitigs = UnitigIndex::open(mIn + "-unitigs", g, fac, log);
+
     Timer t;
-    ProgressMonitorNew mon1(log, z);
     log(info, "scanning for spurious links");
-    for (uint64_t i = 0; i < z; ++i)
+    if (unitigs)
     {
-        mon1.tick(i);
-        if (seen[i])
+        const uint64_t m = unitigs->count() - unitigs->cycles();
+        ProgressMonitorNew mon1(log, m);
+        for (uint64_t id = 0; id < m; ++id)
         {
-            continue;
-        }
+            mon1.tick(id);
+            Graph::Node e_f = g.from(g.select(unitigs->first(id)));
+            if (g.outDegree(e_f) == 1)
+            {
+                continue;
+            }
 
-        Graph::Edge e = g.select(i);
-        Graph::Node e_f = g.from(e);
-        if (g.outDegree(e_f) == 1)
-        {
-            continue;
+            ranks.clear();
+            for (uint64_t p = unitigs->begin(id); p < unitigs->end(id); ++p)
+            {
+                ranks.push_back(unitigs->edge(p));
+            }
+            if (clip(g, e_f, ranks, thresh, minLen, zap))
+            {
+                linksZapped += 1;
+                edgesZapped += ranks.size();
+            }
         }
+    }
+    else
+    {
+        ProgressMonitorNew mon1(log, z);
+        for (uint64_t i = 0; i < z; ++i)
+        {
+            mon1.tick(i);
+            if (seen[i])
+            {
+                continue;
+            }
 
-        ranks.clear();
-        g.linearPath(e, vis);
-        Graph::Node e_t = g.to(g.select((ranks.back())));
-        uint32_t c_f = g.multiplicity(i);
-        uint32_t c_t = g.multiplicity(ranks.back());
+            Graph::Edge e = g.select(i);
+            Graph::Node e_f = g.from(e);
+            if (g.outDegree(e_f) == 1)
+            {
+                continue;
+            }
 
-        if (   minorOut(g, e_f, c_f, thresh)
-            && minorIn(g, e_t, c_t, thresh)
-            && ranks.size() <= minLen)
-        {
-            // Remove e.
-            linksZapped += 1;
-            edgesZapped += ranks.size();
-            for (uint64_t j = 0; j < ranks.size(); ++j)
+            ranks.clear();
+            g.linearPath(e, vis);
+            if (clip(g, e_f, ranks, thresh, minLen, zap))
             {
-                zap[ranks[j]] = true;
-                zap[rcRank(g, ranks[j])] = true;
+                linksZapped += 1;
+                edgesZapped += ranks.size();
             }
         }
     }
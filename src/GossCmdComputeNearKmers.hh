@@ -18,13 +18,14 @@ class GossCmdComputeNearKmers : public GossCmd
 public:
     void operator()(const GossCmdContext& pCxt);
 
-    GossCmdComputeNearKmers(const std::string& pIn, uint64_t pNumThreads)
-        : mIn(pIn), mNumThreads(pNumThreads)
+    GossCmdComputeNearKmers(const std::string& pIn, uint64_t pDistance, uint64_t pNumThreads)
+        : mIn(pIn), mDistance(pDistance), mNumThreads(pNumThreads)
     {
     }
 
 private:
     const std::string mIn;
+    const uint64_t mDistance;
     const uint64_t mNumThreads;
 };
 
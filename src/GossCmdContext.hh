@@ -17,6 +17,10 @@
 #include "Logger.hh"
 #endif
 
+#ifndef MEMORYBUDGET_HH
+#include "MemoryBudget.hh"
+#endif
+
 #ifndef BOOST_PROGRAM_OPTIONS_HH
 #include <boost/program_options.hpp>
 #define BOOST_PROGRAM_OPTIONS_HH
@@ -28,12 +32,14 @@ struct GossCmdContext
     Logger& log;
     const std::string& cmdName;
     const boost::program_options::variables_map& opts;
+    MemoryBudget& mem;
 
     GossCmdContext(FileFactory& pFactory,
                    Logger& pLogger,
                    const std::string& pCmdName,
-                   const boost::program_options::variables_map& pOpts)
-        : fac(pFactory), log(pLogger), cmdName(pCmdName), opts(pOpts)
+                   const boost::program_options::variables_map& pOpts,
+                   MemoryBudget& pBudget = MemoryBudget::process())
+        : fac(pFactory), log(pLogger), cmdName(pCmdName), opts(pOpts), mem(pBudget)
     {
     }
 };
@@ -10,6 +10,7 @@
 
 #include "GossCmdReg.hh"
 #include "GossOptionChecker.hh"
+#include "GraphArchive.hh"
 #include "Graph.hh"
 #include "Timer.hh"
 
@@ -34,6 +35,13 @@ GossCmdDumpGraph::operator()(const GossCmdContext& pCxt)
     FileFactory& fac(pCxt.fac);
     // Logger& log(pCxt.log);
 
+    if (mBinary)
+    {
+        FileFactory::OutHolderPtr outPtr(fac.out(mOut));
+        GraphArchive::write(mIn, fac, **outPtr, mNumThreads);
+        return;
+    }
+
     GraphPtr gPtr = Graph::open(mIn, fac);
     Graph& g(*gPtr);
 
@@ -74,9 +82,15 @@ GossCmdFactoryDumpGraph::create(App& pApp, const variables_map& pOpts)
     string out = "-";
     chk.getOptional("output-file", out, GossOptionChecker::FileCreateCheck(fac, false));
 
+    bool binary = false;
+    chk.getOptional("binary", binary);
+
+    uint64_t T = 4;
+    chk.getOptional("num-threads", T);
+
     chk.throwIfNecessary(pApp);
 
-    return GossCmdPtr(new GossCmdDumpGraph(in, out));
+    return GossCmdPtr(new GossCmdDumpGraph(in, out, binary, T));
 }
 
 GossCmdFactoryDumpGraph::GossCmdFactoryDumpGraph()
@@ -84,4 +98,7 @@ GossCmdFactoryDumpGraph::GossCmdFactoryDumpGraph()
 {
     mCommonOptions.insert("graph-in");
     mCommonOptions.insert("output-file");
+
+    mSpecificOptions.addOpt<bool>("binary", "",
+            "write a compressed binary archive, which restore-graph also reads, rather than text");
 }
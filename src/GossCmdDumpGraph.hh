@@ -19,14 +19,17 @@ public:
     void operator()(const GossCmdContext& pCxt);
 
     GossCmdDumpGraph(const std::string& pIn,
-                     const std::string& pOut)
-        : mIn(pIn), mOut(pOut)
+                     const std::string& pOut,
+                     bool pBinary = false, uint64_t pNumThreads = 1)
+        : mIn(pIn), mOut(pOut), mBinary(pBinary), mNumThreads(pNumThreads)
     {
     }
 
 private:
     const std::string mIn;
     const std::string mOut;
+    const bool mBinary;
+    const uint64_t mNumThreads;
 };
 
 
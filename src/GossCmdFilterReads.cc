@@ -18,7 +18,9 @@
 #include "GossOptionChecker.hh"
 #include "GossReadSequenceBases.hh"
 #include "LineParser.hh"
+#include "OrderedWriter.hh"
 #include "ProgressMonitor.hh"
+#include "ReadBatch.hh"
 #include "ReadPairSequenceFileSequence.hh"
 #include "ReadSequenceFileSequence.hh"
 #include "Spinlock.hh"
@@ -27,6 +29,7 @@
 
 #include <iostream>
 #include <map>
+#include <sstream>
 
 using namespace boost;
 using namespace std;
@@ -40,92 +43,96 @@ typedef map<uint64_t, map<uint64_t, uint64_t> > Hist2;
 
 namespace // anonymous
 {
+    void write(OrderedWriter* pOut, const ReadBatch& pBatch, const ostringstream& pStr)
+    {
+        if (pOut)
+        {
+            string s(pStr.str());
+            pOut->write(pBatch.sequence(), s);
+        }
+    }
+
     class ReadAligner
     {
     public:
-        void push_back(const GossReadPtr& pRead)
+        void push_back(const ReadBatchPtr& pBatch)
         {
-            const uint64_t rho = mKmerSet.K() + 1;
+            const ReadBatch& b(*pBatch);
+            const uint64_t k = mKmerSet.K();
 
-            for(GossRead::Iterator itr(*pRead, rho); itr.valid(); ++itr)
+            // Write the batch's reads out together, in the order they
+            // were read.
+            ostringstream match;
+            ostringstream nonMatch;
+            for (uint64_t i = 0; i < b.size(); ++i)
             {
-                KmerSet::Edge e(itr.kmer());
-                uint64_t rnk;
-                if (mKmerSet.accessAndRank(e, rnk))
+                bool found = false;
+                b.kmers(i, k, [&] (uint64_t, const Gossamer::edge_type& pKmer) {
+                    Gossamer::edge_type rc(pKmer);
+                    rc.reverseComplement(k);
+                    uint64_t rnk;
+                    found = mKmerSet.accessAndRank(KmerSet::Edge(pKmer), rnk)
+                                || mKmerSet.accessAndRank(KmerSet::Edge(rc), rnk);
+                    return !found;
+                });
+                if (found ? mMatchOut : mNonMatchOut)
                 {
-                    if (mMatchOut)
-                    {
-                        std::unique_lock<std::mutex> lock(mMutex);
-                        pRead->print(*mMatchOut);
-                    }
-                    return;
+                    b.print(i, found ? match : nonMatch);
                 }
-                KmerSet::Edge e_rc = mKmerSet.reverseComplement(e);
-                if (mKmerSet.accessAndRank(e_rc, rnk))
-                {
-                    if (mMatchOut)
-                    {
-                        std::unique_lock<std::mutex> lock(mMutex);
-                        pRead->print(*mMatchOut);
-                    }
-                    return;
-                }
-            }
-            if (mNonMatchOut)
-            {
-                std::unique_lock<std::mutex> lock(mMutex);
-                pRead->print(*mNonMatchOut);
             }
+
+            write(mMatchOut, b, match);
+            write(mNonMatchOut, b, nonMatch);
         }
 
-        ReadAligner(const KmerSet& pKmerSet, mutex& pMutex, ostream* pMatchOut, ostream* pNonMatchOut)
-            : mKmerSet(pKmerSet), mMutex(pMutex), mMatchOut(pMatchOut), mNonMatchOut(pNonMatchOut)
+        ReadAligner(const KmerSet& pKmerSet, OrderedWriter* pMatchOut, OrderedWriter* pNonMatchOut)
+            : mKmerSet(pKmerSet), mMatchOut(pMatchOut), mNonMatchOut(pNonMatchOut)
         {
         }
 
     private:
         const KmerSet& mKmerSet;
-        mutex& mMutex;
-        ostream* mMatchOut;
-        ostream* mNonMatchOut;
+        OrderedWriter* mMatchOut;
+        OrderedWriter* mNonMatchOut;
     };
+
     typedef std::shared_ptr<ReadAligner> ReadAlignerPtr;
 
     class PairAligner
     {
     public:
-        void push_back(const pair<GossReadPtr, GossReadPtr>& pPair)
+        void push_back(const ReadBatchPtr& pBatch)
         {
-            if (match(*(pPair.first)) || match(*(pPair.second)))
-            {
-                std::unique_lock<std::mutex> lock(mMutex);
-                if (mMatchOut1)
-                {
-                    pPair.first->print(*mMatchOut1);
-                }
-                if (mMatchOut2)
-                {
-                    pPair.second->print(*mMatchOut2);
-                }
-            }
-            else 
+            const ReadBatch& b(*pBatch);
+
+            ostringstream match1;
+            ostringstream match2;
+            ostringstream nonMatch1;
+            ostringstream nonMatch2;
+            for (uint64_t i = 0; i + 1 < b.size(); i += 2)
             {
-                std::unique_lock<std::mutex> lock(mMutex);
-                if (mNonMatchOut1)
+                if (match(b, i) || match(b, i + 1))
                 {
-                    pPair.first->print(*mNonMatchOut1);
+                    b.print(i, match1);
+                    b.print(i + 1, match2);
                 }
-                if (mNonMatchOut2)
+                else
                 {
-                    pPair.second->print(*mNonMatchOut2);
+                    b.print(i, nonMatch1);
+                    b.print(i + 1, nonMatch2);
                 }
             }
+
+            write(mMatchOut1, b, match1);
+            write(mMatchOut2, b, match2);
+            write(mNonMatchOut1, b, nonMatch1);
+            write(mNonMatchOut2, b, nonMatch2);
         }
 
-        PairAligner(const KmerSet& pKmerSet, mutex& pMutex, 
-                    ostream* pMatchOut1, ostream* pMatchOut2,
-                    ostream* pNonMatchOut1, ostream* pNonMatchOut2)
-            : mKmerSet(pKmerSet), mMutex(pMutex),
+        PairAligner(const KmerSet& pKmerSet,
+                    OrderedWriter* pMatchOut1, OrderedWriter* pMatchOut2,
+                    OrderedWriter* pNonMatchOut1, OrderedWriter* pNonMatchOut2)
+            : mKmerSet(pKmerSet),
               mMatchOut1(pMatchOut1), mMatchOut2(pMatchOut2),
               mNonMatchOut1(pNonMatchOut1), mNonMatchOut2(pNonMatchOut2)
         {
@@ -133,32 +140,25 @@ namespace // anonymous
 
     private:
 
-        bool match(const GossRead& pRead) const
+        bool match(const ReadBatch& pBatch, uint64_t pIdx) const
         {
-            const uint64_t k = mKmerSet.K();
-
-            for(GossRead::Iterator itr(pRead, k); itr.valid(); ++itr)
-            {
-                Gossamer::position_type kmer(itr.kmer());
-                kmer.normalize(k);
-                KmerSet::Edge e(itr.kmer());
+            bool found = false;
+            pBatch.kmers(pIdx, mKmerSet.K(), [&] (uint64_t, const Gossamer::edge_type& pKmer) {
+                KmerSet::Edge e(pKmer);
                 uint64_t rnk;
-                if (mKmerSet.accessAndRank(e, rnk))
-                {
-                    return true;
-                }
-            }
-            
-            return false;
+                found = mKmerSet.accessAndRank(e, rnk);
+                return !found;
+            });
+            return found;
         }
 
         const KmerSet& mKmerSet;
-        mutex& mMutex;
-        ostream* mMatchOut1;
-        ostream* mMatchOut2;
-        ostream* mNonMatchOut1;
-        ostream* mNonMatchOut2;
+        OrderedWriter* mMatchOut1;
+        OrderedWriter* mMatchOut2;
+        OrderedWriter* mNonMatchOut1;
+        OrderedWriter* mNonMatchOut2;
     };
+
     typedef std::shared_ptr<PairAligner> PairAlignerPtr;
 
 void
@@ -182,6 +182,7 @@ GossCmdFilterReads::operator()(const GossCmdContext& pCxt)
     Timer t;
 
     KmerSet g(mIn, fac);
+    fac.waitForWarmUp();
 
     std::deque<GossReadSequence::Item> items;
 
@@ -211,8 +212,6 @@ GossCmdFilterReads::operator()(const GossCmdContext& pCxt)
         }
     }
 
-    mutex m;
-
     if (mPairs)
     {
         UnboundedProgressMonitor umon(log, 100000, " read pairs");
@@ -223,46 +222,49 @@ GossCmdFilterReads::operator()(const GossCmdContext& pCxt)
         FileFactory::OutHolderPtr match2P;
         FileFactory::OutHolderPtr nonMatch1P;
         FileFactory::OutHolderPtr nonMatch2P;
-        ostream* match1Str = NULL;
-        ostream* match2Str = NULL;
-        ostream* nonMatch1Str = NULL;
-        ostream* nonMatch2Str = NULL;
+        std::unique_ptr<OrderedWriter> match1;
+        std::unique_ptr<OrderedWriter> match2;
+        std::unique_ptr<OrderedWriter> nonMatch1;
+        std::unique_ptr<OrderedWriter> nonMatch2;
         if (mMatch.size())
         {
-            string match1;
-            string match2;
-            pairFiles(mMatch, match1, match2);
-            match1P = fac.out(match1);
-            match2P = fac.out(match2);
-            match1Str = &**match1P;
-            match2Str = &**match2P;
+            string match1Name;
+            string match2Name;
+            pairFiles(mMatch, match1Name, match2Name);
+            match1P = fac.out(match1Name);
+            match2P = fac.out(match2Name);
+            match1.reset(new OrderedWriter(**match1P, true));
+            match2.reset(new OrderedWriter(**match2P, true));
         }
         if (mNonMatch.size())
         {
-            string nonMatch1;
-            string nonMatch2;
-            pairFiles(mNonMatch, nonMatch1, nonMatch2);
-            nonMatch1P = fac.out(nonMatch1);
-            nonMatch2P = fac.out(nonMatch2);
-            nonMatch1Str = &**nonMatch1P;
-            nonMatch2Str = &**nonMatch2P;
+            string nonMatch1Name;
+            string nonMatch2Name;
+            pairFiles(mNonMatch, nonMatch1Name, nonMatch2Name);
+            nonMatch1P = fac.out(nonMatch1Name);
+            nonMatch2P = fac.out(nonMatch2Name);
+            nonMatch1.reset(new OrderedWriter(**nonMatch1P, true));
+            nonMatch2.reset(new OrderedWriter(**nonMatch2P, true));
         }
 
         vector<PairAlignerPtr> aligners;
-        BackgroundMultiConsumer<pair<GossReadPtr, GossReadPtr> > grp(128);
+        BackgroundMultiConsumer<ReadBatchPtr> grp(2 * mNumThreads);
         for (uint64_t i = 0; i < mNumThreads; ++i)
         {
-            aligners.push_back(PairAlignerPtr(new PairAligner(g, m, match1Str, match2Str, 
-                                                              nonMatch1Str, nonMatch2Str)));
+            aligners.push_back(PairAlignerPtr(new PairAligner(g, match1.get(), match2.get(),
+                                                              nonMatch1.get(), nonMatch2.get())));
             grp.add(*aligners.back());
         }
 
         log(info, "Filtering reads....");
-        uint64_t n = 0;
-        for (;reads.valid(); ++reads)
+        ReadBatch::Pool pool;
+        ReadBatchReader batches(pool, [&reads] (ReadBatch& pBatch) {
+            return pBatch.fillPairs(reads);
+        });
+        ReadBatchPtr batch;
+        while (batches.get(batch))
         {
-            grp.push_back(make_pair(reads.lhs().clone(), reads.rhs().clone()));
-            ++n;
+            grp.push_back(batch);
         }
         grp.wait();
     }
@@ -273,36 +275,38 @@ GossCmdFilterReads::operator()(const GossCmdContext& pCxt)
         ReadSequenceFileSequence reads(items, fac, lineSrcFac, &umon);
 
         FileFactory::OutHolderPtr matchP;
-        ostream* match = NULL;
+        std::unique_ptr<OrderedWriter> match;
         if (mMatch.size())
         {
             matchP = fac.out(mMatch);
-            match = &**matchP;
+            match.reset(new OrderedWriter(**matchP, true));
         }
 
         FileFactory::OutHolderPtr nonMatchP;
-        ostream* nonMatch = NULL;
+        std::unique_ptr<OrderedWriter> nonMatch;
         if (mNonMatch.size())
         {
             nonMatchP = fac.out(mNonMatch);
-            nonMatch = &**nonMatchP;
+            nonMatch.reset(new OrderedWriter(**nonMatchP, true));
         }
 
         vector<ReadAlignerPtr> aligners;
-        BackgroundMultiConsumer<GossReadPtr> grp(128);
+        BackgroundMultiConsumer<ReadBatchPtr> grp(2 * mNumThreads);
         for (uint64_t i = 0; i < mNumThreads; ++i)
         {
-            aligners.push_back(ReadAlignerPtr(new ReadAligner(g, m, match, nonMatch)));
+            aligners.push_back(ReadAlignerPtr(new ReadAligner(g, match.get(), nonMatch.get())));
             grp.add(*aligners.back());
         }
 
         log(info, "Filtering reads....");
-        uint64_t n = 0;
-        for (;reads.valid(); ++reads)
+        ReadBatch::Pool pool;
+        ReadBatchReader batches(pool, [&reads] (ReadBatch& pBatch) {
+            return pBatch.fill(reads);
+        });
+        ReadBatchPtr batch;
+        while (batches.get(batch))
         {
-            
-            grp.push_back((*reads).clone());
-            ++n;
+            grp.push_back(batch);
         }
         grp.wait();
     }
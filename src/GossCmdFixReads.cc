@@ -1202,7 +1202,7 @@ GossCmdFixReads::operator()(const GossCmdContext& pCxt)
     SuperGraph& sg = *sgPtr;
 
     log(info, "building edge index");
-    auto eixPtr = EdgeIndex::create(g, ee, sg, 1, mNumThreads, log);
+    auto eixPtr = EdgeIndex::open(mIn, fac, g, ee, sg, 1, mNumThreads, log);
     EdgeIndex& eix = *eixPtr;
     mutex mut;
 
@@ -0,0 +1,81 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "GossCmdGraphStats.hh"
+
+#include "GossCmdReg.hh"
+#include "GossOptionChecker.hh"
+#include "Graph.hh"
+#include "GraphStats.hh"
+#include "Timer.hh"
+
+#include <string>
+#include <boost/lexical_cast.hpp>
+
+using namespace boost;
+using namespace boost::program_options;
+using namespace std;
+
+typedef vector<string> strings;
+
+void
+GossCmdGraphStats::operator()(const GossCmdContext& pCxt)
+{
+    FileFactory& fac(pCxt.fac);
+    Logger& log(pCxt.log);
+
+    if (!GraphStats::exists(mIn, fac))
+    {
+        // Graphs built before the statistics were kept need a scan,
+        // whose results are saved for next time.
+        Timer t;
+        log(info, "computing graph statistics");
+        Graph::saveStats(mIn, fac, mNumThreads);
+        log(info, "total elapsed time: " + lexical_cast<string>(t.check()));
+    }
+    GraphStats s(GraphStats::read(mIn, fac));
+
+    FileFactory::OutHolderPtr outPtr(fac.out(mOut));
+    ostream& out(**outPtr);
+    s.stat().print(out);
+
+    out << "unitig-lengths" << endl;
+    for (map<uint64_t,uint64_t>::const_iterator i = s.unitigLengths.begin();
+            i != s.unitigLengths.end(); ++i)
+    {
+        out << ' ' << i->first << '\t' << i->second << endl;
+    }
+}
+
+
+GossCmdPtr
+GossCmdFactoryGraphStats::create(App& pApp, const variables_map& pOpts)
+{
+    GossOptionChecker chk(pOpts);
+    FileFactory& fac(pApp.fileFactory());
+
+    string in;
+    chk.getRepeatingOnce("graph-in", in);
+
+    string out = "-";
+    chk.getOptional("output-file", out, GossOptionChecker::FileCreateCheck(fac, false));
+
+    uint64_t T = 4;
+    chk.getOptional("num-threads", T);
+
+    chk.throwIfNecessary(pApp);
+
+    return GossCmdPtr(new GossCmdGraphStats(in, out, T));
+}
+
+GossCmdFactoryGraphStats::GossCmdFactoryGraphStats()
+    : GossCmdFactory("print the structural statistics of a graph")
+{
+    mCommonOptions.insert("graph-in");
+    mCommonOptions.insert("output-file");
+}
@@ -0,0 +1,41 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef GOSSCMDGRAPHSTATS_HH
+#define GOSSCMDGRAPHSTATS_HH
+
+#ifndef GOSSCMD_HH
+#include "GossCmd.hh"
+#endif
+
+class GossCmdGraphStats : public GossCmd
+{
+public:
+    void operator()(const GossCmdContext& pCxt);
+
+    GossCmdGraphStats(const std::string& pIn, const std::string& pOut, uint64_t pNumThreads)
+        : mIn(pIn), mOut(pOut), mNumThreads(pNumThreads)
+    {
+    }
+
+private:
+    const std::string mIn;
+    const std::string mOut;
+    const uint64_t mNumThreads;
+};
+
+
+class GossCmdFactoryGraphStats : public GossCmdFactory
+{
+public:
+    GossCmdPtr create(App& pApp, const boost::program_options::variables_map& pOpts);
+
+    GossCmdFactoryGraphStats();
+};
+
+#endif // GOSSCMDGRAPHSTATS_HH
@@ -52,6 +52,12 @@ GossCmdGraphToKmerSet::operator()(const GossCmdContext& pCxt)
         }
     }
     bld.end();
+
+    if (mPrefilterBits)
+    {
+        log(info, "building prefilter");
+        KmerSet::buildPrefilter(mOut, fac, mPrefilterBits);
+    }
     
     log(info, "total elapsed time: " + lexical_cast<string>(t.check()));
 }
@@ -68,9 +74,12 @@ GossCmdFactoryGraphToKmerSet::create(App& pApp, const variables_map& pOpts)
     string out;
     chk.getMandatory("graph-out", out);
 
+    uint64_t prefilterBits = 0;
+    chk.getOptional("prefilter-bits", prefilterBits);
+
     chk.throwIfNecessary(pApp);
 
-    return GossCmdPtr(new GossCmdGraphToKmerSet(in, out));
+    return GossCmdPtr(new GossCmdGraphToKmerSet(in, out, prefilterBits));
 }
 
 GossCmdFactoryGraphToKmerSet::GossCmdFactoryGraphToKmerSet()
@@ -78,4 +87,5 @@ GossCmdFactoryGraphToKmerSet::GossCmdFactoryGraphToKmerSet()
 {
     mCommonOptions.insert("graph-in");
     mCommonOptions.insert("graph-out");
+    mCommonOptions.insert("prefilter-bits");
 }
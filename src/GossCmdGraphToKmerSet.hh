@@ -20,14 +20,16 @@ public:
 
     void operator()(const GossCmdContext& pCxt);
 
-    GossCmdGraphToKmerSet(const std::string& pIn, const std::string& pOut)
-        : mIn(pIn), mOut(pOut)
+    GossCmdGraphToKmerSet(const std::string& pIn, const std::string& pOut,
+                          uint64_t pPrefilterBits = 0)
+        : mIn(pIn), mOut(pOut), mPrefilterBits(pPrefilterBits)
     {
     }
 
 private:
     const std::string mIn;
     const std::string mOut;
+    const uint64_t mPrefilterBits;
 };
 
 
@@ -624,6 +624,7 @@ namespace // anonymous
         {
             pLog(info, "pass " + lexical_cast<string>(p));
             KmerClassifier kmerClassr(pIn, pFac, pNumPasses, p);
+            pFac.waitForWarmUp();
             vector<ClassifierPtr> classrs;
             BackgroundMultiConsumer<KmerSrcPtr> grp(128);
             for (uint64_t i = 0; i < pNumThreads; ++i)
@@ -744,6 +745,7 @@ namespace // anonymous
         {
             pLog(info, "pass " + lexical_cast<string>(p));
             KmerClassifier kmerClassr(pIn, pFac, pNumPasses, p);
+            pFac.waitForWarmUp();
             vector<ClassifierPtr> classrs;
             BackgroundMultiConsumer<KmerSrcPtr> grp(128);
             for (uint64_t i = 0; i < pNumThreads; ++i)
@@ -1032,8 +1034,12 @@ GossCmdFactoryGroupReads::create(App& pApp, const boost::program_options::variab
     bool pairs;
     chk.getOptional("pairs", pairs);
 
+    // The global --max-memory sets the budget; without it, no limit.
     double M = 1.0e9;
-    chk.getOptional("max-memory", M);
+    if (pApp.memoryBudget().limited())
+    {
+        M = pApp.memoryBudget().limit() / (1024.0 * 1024.0 * 1024.0);
+    }
 
     uint64_t T = 4;
     chk.getOptional("num-threads", T);
@@ -1067,8 +1073,6 @@ GossCmdFactoryGroupReads::GossCmdFactoryGroupReads()
     mCommonOptions.insert("fastq-in");
     mCommonOptions.insert("line-in");
 
-    mSpecificOptions.addOpt<double>("max-memory", "M",
-            "maximum memory (in GB) to use (default: unlimited)");
     mSpecificOptions.addOpt<bool>("pairs", "",
             "treat reads as pairs");
     mSpecificOptions.addOpt<string>("lhs-name", "",
@@ -20,6 +20,7 @@
 #include "GossReadSequenceBases.hh"
 #include "Graph.hh"
 #include "KmerSet.hh"
+#include "KmerSketch.hh"
 #include "LineParser.hh"
 #include "RankSelect.hh"
 #include "Timer.hh"
@@ -108,6 +109,125 @@ namespace {
 
     typedef std::shared_ptr<SimilarityCalc>  SimilarityCalcPtr;
 
+    // Estimate the similarity of sample i to each later sample from
+    // their sketches, a row at a time.
+    class SketchCalc
+    {
+    public:
+        typedef std::pair<uint64_t, vector<double>*> Arg;
+
+        void push_back(Arg pArg)
+        {
+            const uint64_t i = pArg.first;
+            vector<double>& row(*pArg.second);
+            for (uint64_t j = i + 1; j < mSketches.size(); ++j)
+            {
+                row[j] = mSketches[i]->jaccard(*mSketches[j]);
+            }
+            std::unique_lock<std::mutex> l(mMutex);
+            mTicks += mSketches.size() - i - 1;
+            mMon.tick(mTicks);
+        }
+
+        SketchCalc(const vector<std::shared_ptr<KmerSketch> >& pSketches, ProgressMonitorNew& pMon)
+            : mSketches(pSketches), mMon(pMon), mTicks(0), mMutex()
+        {
+        }
+
+    private:
+        const vector<std::shared_ptr<KmerSketch> >& mSketches;
+        ProgressMonitorNew& mMon;
+        uint64_t mTicks;
+        std::mutex mMutex;
+    };
+
+    // Compute the exact Jaccard similarity of two samples by walking
+    // their k-mer sets side by side.
+    class ExactCalc
+    {
+    public:
+        typedef std::tuple<uint64_t, uint64_t, double*> Arg;
+
+        void push_back(Arg pArg)
+        {
+            KmerSet::LazyIterator lhs(mSamples[std::get<0>(pArg)], mFactory);
+            KmerSet::LazyIterator rhs(mSamples[std::get<1>(pArg)], mFactory);
+            uint64_t unionSz = 0;
+            uint64_t interSz = 0;
+            while (lhs.valid() && rhs.valid())
+            {
+                const position_type l = (*lhs).first.value();
+                const position_type r = (*rhs).first.value();
+                ++unionSz;
+                if (l == r)
+                {
+                    ++interSz;
+                    ++lhs;
+                    ++rhs;
+                }
+                else if (l < r)
+                {
+                    ++lhs;
+                }
+                else
+                {
+                    ++rhs;
+                }
+            }
+            for (; lhs.valid(); ++lhs)
+            {
+                ++unionSz;
+            }
+            for (; rhs.valid(); ++rhs)
+            {
+                ++unionSz;
+            }
+            *std::get<2>(pArg) = unionSz ? double(interSz) / double(unionSz) : 1.0;
+        }
+
+        ExactCalc(const vector<string>& pSamples, FileFactory& pFactory)
+            : mSamples(pSamples), mFactory(pFactory)
+        {
+        }
+
+    private:
+        const vector<string>& mSamples;
+        FileFactory& mFactory;
+    };
+
+    void writeSimilarities(const vector<vector<double> >& pSim, const string& pName, FileFactory& pFactory)
+    {
+        FileFactory::OutHolderPtr matP(pFactory.out(pName));
+        ostream& mat (**matP);
+        for (uint64_t i = 0; i < pSim.size(); ++i)
+        {
+            for (uint64_t j = i+1; j < pSim.size(); ++j)
+            {
+                mat << i << '\t' << j << '\t' << pSim[i][j] << '\n';
+            }
+        }
+    }
+
+    // Is there a sketch of the given size for the k-mer set as it is now?
+    bool sketchFits(const string& pSetName, uint64_t pSize, FileFactory& pFactory)
+    {
+        const string nm(pSetName + ".sketch");
+        if (!KmerSketch::exists(nm, pFactory))
+        {
+            return false;
+        }
+        try
+        {
+            KmerSketch s(nm, pFactory);
+            KmerSet x(pSetName, pFactory);
+            return s.size() == pSize && s.count() == x.count() && s.fingerprint() == x.fingerprint();
+        }
+        catch (const Gossamer::error&)
+        {
+            // Most likely a sketch from an older version.
+            return false;
+        }
+    }
 
 }   // namespace anonymous
 
@@ -136,14 +256,16 @@ GossCmdPoolSamples::operator()(const GossCmdContext& pCxt)
         log(info, "building k-mer set of " + mFastaNames[i]);
         string out = outPrefix + "-a" + lexical_cast<string>(i);
         samples.push_back(out);
-        GossCmdBuildKmerSet(mK, mS, mN, mT, out, strings(1, mFastaNames[i]), strings(), strings())(pCxt);
+        GossCmdBuildKmerSet(mK, mS, mN, mT, out, strings(1, mFastaNames[i]), strings(), strings(),
+                            0, mSketchSize)(pCxt);
     }
     for (uint64_t i = 0; i < mFastqNames.size(); ++i)
     {
         log(info, "building k-mer set of " + mFastqNames[i]);
         string out = outPrefix + "-q" + lexical_cast<string>(i);
         samples.push_back(out);
-        GossCmdBuildKmerSet(mK, mS, mN, mT, out, strings(), strings(1, mFastqNames[i]), strings())(pCxt);
+        GossCmdBuildKmerSet(mK, mS, mN, mT, out, strings(), strings(1, mFastqNames[i]), strings(),
+                            0, mSketchSize)(pCxt);
     }
 
     if (samples.empty())
@@ -151,6 +273,75 @@ GossCmdPoolSamples::operator()(const GossCmdContext& pCxt)
         log(info, "no samples");
         return;
     }
+
+    if (mSketchSize)
+    {
+        // Compare the samples by their sketches, making (or remaking)
+        // any which the given k-mer sets lack.
+        vector<std::shared_ptr<KmerSketch> > sketches;
+        vector<uint8_t> registers;
+        for (uint64_t i = 0; i < samples.size(); ++i)
+        {
+            const string nm(samples[i] + ".sketch");
+            if (!sketchFits(samples[i], mSketchSize, fac))
+            {
+                log(info, "building sketch of " + samples[i]);
+                KmerSet::buildSketch(samples[i], fac, mSketchSize);
+            }
+            sketches.push_back(std::make_shared<KmerSketch>(nm, fac));
+            sketches.back()->merge(registers);
+        }
+        log(info, "about " + lexical_cast<string>(uint64_t(KmerSketch::estimate(registers)))
+                    + " distinct k-mers in all samples");
+
+        log(info, "estimating similarity matrix");
+        vector<vector<double> > sim(samples.size(), vector<double>(samples.size(), 1.0));
+        {
+            BackgroundMultiConsumer<SketchCalc::Arg> grp(128);
+            ProgressMonitorNew mon(log, samples.size() * (samples.size() - 1) / 2);
+            SketchCalc calc(sketches, mon);
+            for (uint64_t i = 0; i < mT; ++i)
+            {
+                grp.add(calc);
+            }
+            for (uint64_t i = 0; i < samples.size(); ++i)
+            {
+                grp.push_back(SketchCalc::Arg(i, &sim[i]));
+            }
+            grp.wait();
+        }
+
+        // Replace the estimates for the most similar pairs with exact
+        // values.
+        {
+            BackgroundMultiConsumer<ExactCalc::Arg> grp(128);
+            ExactCalc calc(samples, fac);
+            for (uint64_t i = 0; i < mT; ++i)
+            {
+                grp.add(calc);
+            }
+            uint64_t n = 0;
+            for (uint64_t i = 0; i < samples.size(); ++i)
+            {
+                for (uint64_t j = i + 1; j < samples.size(); ++j)
+                {
+                    if (sim[i][j] >= mExactAbove)
+                    {
+                        grp.push_back(ExactCalc::Arg(i, j, &sim[i][j]));
+                        ++n;
+                    }
+                }
+            }
+            grp.wait();
+            if (n)
+            {
+                log(info, "computed exact similarity of " + lexical_cast<string>(n) + " pairs");
+            }
+        }
+
+        writeSimilarities(sim, mOutPrefix + ".sim", fac);
+        return;
+    }
     
     // Build the union.
     log(info, "merging sets");
@@ -228,15 +419,7 @@ GossCmdPoolSamples::operator()(const GossCmdContext& pCxt)
     }
     grp.wait();
 
-    FileFactory::OutHolderPtr matP(fac.out(mOutPrefix + ".sim"));
-    ostream& mat (**matP);
-    for (uint64_t i = 0; i < samples.size(); ++i)
-    {
-        for (uint64_t j = i+1; j < samples.size(); ++j)
-        {
-            mat << i << '\t' << j << '\t' << sim[i][j] << '\n';
-        }
-    }
+    writeSimilarities(sim, mOutPrefix + ".sim", fac);
 }
 
 
@@ -250,9 +433,10 @@ GossCmdFactoryPoolSamples::create(App& pApp, const variables_map& pOpts)
     chk.getOptional("kmer-size", K, GossOptionChecker::RangeCheck(KmerSet::MaxK));
 
     uint64_t B = 2;
-    chk.getOptional("buffer-size", B);
-    uint64_t N = (B << 30) / (1.5 * sizeof(uint32_t) + sizeof(BackyardHash::value_type));
-    uint64_t S = BackyardHash::maxSlotBits(B << 30);
+    bool explicitB = chk.getOptional("buffer-size", B);
+    uint64_t bytes = pApp.memoryBudget().bufferSize(B << 30, explicitB, 1ULL << 26);
+    uint64_t N = bytes / (1.5 * sizeof(uint32_t) + sizeof(BackyardHash::value_type));
+    uint64_t S = BackyardHash::maxSlotBits(bytes);
 
     uint64_t T = 4;
     chk.getOptional("num-threads", T);
@@ -283,9 +467,19 @@ GossCmdFactoryPoolSamples::create(App& pApp, const variables_map& pOpts)
     chk.getOptional("fastqs-in", fqsFiles);
     chk.expandFilenames(fqsFiles, fastqNames, fac);
 
+    uint64_t sketchSize = 0;
+    chk.getOptional("sketch-size", sketchSize);
+
+    double exactAbove = 2.0;
+    if (chk.getOptional("exact-above", exactAbove) && !sketchSize)
+    {
+        chk.addError("--exact-above requires --sketch-size.");
+    }
+
     chk.throwIfNecessary(pApp);
 
-    return GossCmdPtr(new GossCmdPoolSamples(K, S, N, T, out, fastaNames, fastqNames, kmerSetNames));
+    return GossCmdPtr(new GossCmdPoolSamples(K, S, N, T, out, fastaNames, fastqNames, kmerSetNames,
+                                             sketchSize, exactAbove));
 }
 
 GossCmdFactoryPoolSamples::GossCmdFactoryPoolSamples()
@@ -301,4 +495,8 @@ GossCmdFactoryPoolSamples::GossCmdFactoryPoolSamples()
 
     mSpecificOptions.addOpt<strings>("kmer-set-in", "", "input k-mer set");
     mSpecificOptions.addOpt<strings>("kmer-sets-in", "", "input file containing k-mer sets");
+    mSpecificOptions.addOpt<uint64_t>("sketch-size", "",
+            "estimate similarities from sketches of this many k-mers per sample, rather than exactly");
+    mSpecificOptions.addOpt<double>("exact-above", "",
+            "with --sketch-size, compute exact similarities for pairs estimated to be at least this similar");
 }
@@ -23,10 +23,11 @@ public:
     GossCmdPoolSamples(const uint64_t& pK, const uint64_t& pS, 
                        const uint64_t& pN, const uint64_t& pT, 
                        const std::string& pOutPrefix, const strings& pFastaNames, 
-                       const strings& pFastqNames, const strings& pKmerSets)
+                       const strings& pFastqNames, const strings& pKmerSets,
+                       uint64_t pSketchSize = 0, double pExactAbove = 2.0)
         : mK(pK), mS(pS), mN(pN), mT(pT), mOutPrefix(pOutPrefix),
           mFastaNames(pFastaNames), mFastqNames(pFastqNames),
-          mKmerSets(pKmerSets)
+          mKmerSets(pKmerSets), mSketchSize(pSketchSize), mExactAbove(pExactAbove)
     {
     }
 
@@ -39,6 +40,8 @@ private:
     const strings mFastaNames;
     const strings mFastqNames;
     const strings mKmerSets;
+    const uint64_t mSketchSize;
+    const double mExactAbove;
 };
 
 
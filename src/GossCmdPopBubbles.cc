@@ -77,7 +77,7 @@ GossCmdPopBubbles::operator()(const GossCmdContext& pCxt)
     tourBus.pass();
 
     Graph::Builder b(g.K(), mOut, fac,
-                     g.count() - tourBus.removedEdgesCount());
+                     g.count() - tourBus.removedEdgesCount(), false, g.countsFormat());
 
 
     log(info, "writing modified graph");
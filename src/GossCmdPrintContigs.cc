@@ -14,6 +14,7 @@
 #include "ProgressMonitor.hh"
 #include "SuperGraph.hh"
 #include "Timer.hh"
+#include "UnitigIndex.hh"
 
 #include <string>
 #include <boost/lexical_cast.hpp>
@@ -74,31 +75,53 @@ namespace // anonymous
             out << "Number\tLength\tMinCov\tMaxCov\tMeanCov\tStdDevCov" << endl;
         }
 
+        UnitigIndexPtr unitigs = UnitigIndex::open(pIn + "-unitigs", g, pFac, pLog);
+
+        // With a unitig index, the paths are read from it, in the same
+        // order as they're found by trying each edge in turn. Loops
+        // have no starting edge, so are skipped either way.
         const uint64_t cols = mNoLineBreaks ? -1 : 60;
         uint64_t conitNo = 1;
-        ProgressMonitorNew mon(pLog, g.count());
-        for (uint64_t i = 0; i < g.count(); ++i)
+        const uint64_t m = unitigs ? unitigs->count() - unitigs->cycles() : g.count();
+        ProgressMonitorNew mon(pLog, m);
+        for (uint64_t u = 0; u < m; ++u)
         {
-            mon.tick(i);
+            mon.tick(u);
 
-            Graph::Edge e = g.select(i);
-            Graph::Node e_f = g.from(e);
-            if (g.inDegree(e_f) == 1 && g.outDegree(e_f) == 1)
+            uint64_t i = u;
+            edges.clear();
+            if (unitigs)
             {
-                continue;
+                i = unitigs->first(u);
+                if (seen[i])
+                {
+                    continue;
+                }
+                for (uint64_t p = unitigs->begin(u); p < unitigs->end(u); ++p)
+                {
+                    const uint64_t r = unitigs->edge(p);
+                    edges.push_back(EdgeAndRank(g.select(r), r));
+                }
             }
-
-            if (seen[i])
+            else
             {
-                continue;
-            }
+                Graph::Edge e = g.select(i);
+                Graph::Node e_f = g.from(e);
+                if (g.inDegree(e_f) == 1 && g.outDegree(e_f) == 1)
+                {
+                    continue;
+                }
 
-            Graph::Edge beg = e;
+                if (seen[i])
+                {
+                    continue;
+                }
 
-            edges.clear();
-            Vis vis(edges);
-            Graph::Edge end = g.linearPath(beg, vis);
+                Vis vis(edges);
+                g.linearPath(e, vis);
+            }
 
+            Graph::Edge end = edges.back().first;
             Graph::Edge end_rc = g.reverseComplement(end);
             uint64_t end_rc_rnk = g.rank(end_rc);
             BOOST_ASSERT(!seen[i]);
@@ -106,6 +129,22 @@ namespace // anonymous
             seen[i] = true;
             seen[end_rc_rnk] = true;
 
+            // The reverse complement of a unitig is the unitig starting
+            // at the reverse complement of its last edge.
+            bool rcsSeen = false;
+            if (!pPrintRcs && unitigs)
+            {
+                const uint64_t twin = unitigs->unitig(end_rc_rnk).first;
+                if (unitigs->length(twin) == edges.size())
+                {
+                    for (uint64_t p = unitigs->begin(twin); p < unitigs->end(twin); ++p)
+                    {
+                        seen[unitigs->edge(p)] = true;
+                    }
+                    rcsSeen = true;
+                }
+            }
+
             uint64_t min_cov = numeric_limits<uint64_t>::max();
 
             for (uint64_t j = 0; j < edges.size(); ++j)
@@ -119,7 +158,7 @@ namespace // anonymous
                     min_cov = x_cov;
                 }
 
-                if (!pPrintRcs) 
+                if (!pPrintRcs && !rcsSeen)
                 {
                     Graph::Edge y = g.reverseComplement(x);
                     uint64_t y_rnk = g.rank(y);
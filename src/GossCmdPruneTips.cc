@@ -320,7 +320,7 @@ GossCmdPruneTips::operator()(const GossCmdContext& pCxt)
 
     log(info, "writing out graph.");
     ProgressMonitorNew writeMon(log, g.count());
-    Graph::Builder b(g.K(), mOut, fac, g.count());
+    Graph::Builder b(g.K(), mOut, fac, g.count(), false, g.countsFormat());
     uint64_t i = 0;
     for (Graph::Iterator itr(g); itr.valid(); ++itr)
     {
@@ -331,6 +331,7 @@ GossCmdPruneTips::operator()(const GossCmdContext& pCxt)
     }
     b.end();
     writeMon.end();
+    Graph::saveStats(mOut, fac, mThreads);
 
     if (dumpGraphBuildStats.on())
     {
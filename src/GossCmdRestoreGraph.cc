@@ -10,6 +10,7 @@
 
 #include "GossCmdReg.hh"
 #include "GossOptionChecker.hh"
+#include "GraphArchive.hh"
 #include "Graph.hh"
 #include "Timer.hh"
 
@@ -78,6 +79,12 @@ GossCmdRestoreGraph::operator()(const GossCmdContext& pCxt)
     FileFactory::InHolderPtr inPtr(fac.in(mIn));
     istream& in(**inPtr);
 
+    if (GraphArchive::isArchive(in))
+    {
+        GraphArchive::read(in, mIn, mOut, fac, mNumThreads);
+        return;
+    }
+
     string x;
     getline(in, x);
     if (!in.good())
@@ -139,13 +146,16 @@ GossCmdFactoryRestoreGraph::create(App& pApp, const variables_map& pOpts)
     FileFactory& fac(pApp.fileFactory());
     chk.getMandatory("graph-out", out, GossOptionChecker::FileCreateCheck(fac, true));
 
+    uint64_t T = 4;
+    chk.getOptional("num-threads", T);
+
     chk.throwIfNecessary(pApp);
 
-    return GossCmdPtr(new GossCmdRestoreGraph(in, out));
+    return GossCmdPtr(new GossCmdRestoreGraph(in, out, T));
 }
 
 GossCmdFactoryRestoreGraph::GossCmdFactoryRestoreGraph()
-    : GossCmdFactory("read in a graph from a robust text representation.")
+    : GossCmdFactory("read in a graph from a robust text representation, or a binary archive.")
 {
     mCommonOptions.insert("graph-out");
     mCommonOptions.insert("input-file");
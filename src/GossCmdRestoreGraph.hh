@@ -19,14 +19,16 @@ public:
     void operator()(const GossCmdContext& pCxt);
 
     GossCmdRestoreGraph(const std::string& pIn,
-                     const std::string& pOut)
-        : mIn(pIn), mOut(pOut)
+                     const std::string& pOut,
+                     uint64_t pNumThreads = 1)
+        : mIn(pIn), mOut(pOut), mNumThreads(pNumThreads)
     {
     }
 
 private:
     const std::string mIn;
     const std::string mOut;
+    const uint64_t mNumThreads;
 };
 
 
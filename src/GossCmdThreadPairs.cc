@@ -75,71 +75,6 @@ Debug extLinkMap("extend-link-map", "read the previous set of links, process rea
 Debug discardUpdates("discard-updated-supergraph", "after pair threading, don't save the resulting supergraph.");
 Debug showDistStats("show-dist-stats", "show the distribution of distances of pairs within a superpath.");
 
-template <typename Dest>
-class LinkMapCompiler
-{
-public:
-    void push_back(const vector<uint8_t>& pItem)
-    {
-        const uint8_t* hd(&pItem[0]);
-        PairLink::decode(hd, mLink);
-
-        if (mLink.lhs == mPrev.lhs && mLink.rhs == mPrev.rhs)
-        {
-            mCount++;
-            mLhsOffsetSum += mLink.lhsOffset;
-            mLhsOffsetSum2 += mLink.lhsOffset * mLink.lhsOffset;
-            mRhsOffsetSum += mLink.rhsOffset;
-            mRhsOffsetSum2 += mLink.rhsOffset * mLink.rhsOffset;
-            return;
-        }
-
-        if (mCount > 0)
-        {
-            mDest.push_back(mPrev.lhs, mPrev.rhs, mCount,
-                            mLhsOffsetSum, mLhsOffsetSum2,
-                            mRhsOffsetSum, mRhsOffsetSum2);
-        }
-        mCount = 1;
-        mLhsOffsetSum = mLink.lhsOffset;
-        mLhsOffsetSum2 = mLink.lhsOffset * mLink.lhsOffset;
-        mRhsOffsetSum = mLink.rhsOffset;
-        mRhsOffsetSum2 = mLink.rhsOffset * mLink.rhsOffset;
-        mPrev = mLink;
-    }
-
-    void end()
-    {
-        if (mCount > 0)
-        {
-            mDest.push_back(mPrev.lhs, mPrev.rhs, mCount,
-                            mLhsOffsetSum, mLhsOffsetSum2,
-                            mRhsOffsetSum, mRhsOffsetSum2);
-        }
-        mDest.end();
-    }
-
-    LinkMapCompiler(Dest& pDest)
-        : mDest(pDest),
-          mPrev(SuperPathId(-1LL), SuperPathId(-1LL), 0, 0),
-          mLink(SuperPathId(0), SuperPathId(0), 0, 0),
-          mCount(0),
-          mLhsOffsetSum(0), mLhsOffsetSum2(0),
-          mRhsOffsetSum(0), mRhsOffsetSum2(0)
-    {
-    }
-
-private:
-    Dest& mDest;
-    PairLink mPrev;
-    PairLink mLink;
-    uint64_t mCount;
-    int64_t mLhsOffsetSum;
-    uint64_t mLhsOffsetSum2;
-    int64_t mRhsOffsetSum;
-    uint64_t mRhsOffsetSum2;
-};
-
 class LinkMapWriter
 {
 public:
@@ -793,7 +728,14 @@ GossCmdThreadPairs::operator()(const GossCmdContext& pCxt)
 
     map<int64_t,uint64_t> dist;
     BiLinkMap biLinks;
-    ExternalBufferSort sorter(1024ULL * 1024ULL * 1024ULL, fac);
+    PairLinker::Links::Entries links;
+
+    // The linkers accumulate links in memory, but if they outgrow their
+    // share of the budget, they spill them to the sorter and all the
+    // links are merged through it instead.
+    MemoryBudget::Reservation linkMem(pCxt.mem.reserve(1024ULL * 1024ULL * 1024ULL, 64ULL * 1024ULL * 1024ULL));
+    ExternalBufferSort sorter(linkMem.size() / 2, fac);
+    bool spilled = false;
 
     if (loadLinkMap.on() || extLinkMap.on())
     {
@@ -814,7 +756,7 @@ GossCmdThreadPairs::operator()(const GossCmdContext& pCxt)
                 << Gossamer::open_graph_name_info(mIn));
         }
 
-        auto idxPtr = EdgeIndex::create(g, entries, sg, mCacheRate, mNumThreads, log);
+        auto idxPtr = EdgeIndex::open(mIn, fac, g, entries, sg, mCacheRate, mNumThreads, log);
         EdgeIndex& idx(*idxPtr);
         const PairAligner alnr(g, entries, idx);
 
@@ -853,23 +795,35 @@ GossCmdThreadPairs::operator()(const GossCmdContext& pCxt)
         log(info, "mapping pairs.");
 
         UniquenessCache ucache(sg, coverage);
-        BackgroundMultiConsumer<PairLinker::ReadPair> grp(128);
+        ReadPairBatch::Pool pool;
+        BackgroundMultiConsumer<ReadPairBatchPtr> grp(2 * mNumThreads);
         vector<PairLinkerPtr> linkers;
         mutex mut;
+        const uint64_t spillBytes = linkMem.size() / 2 / mNumThreads;
         for (uint64_t i = 0; i < mNumThreads; ++i)
         {
-            linkers.push_back(PairLinkerPtr(new PairLinker(sg, alnr, mOrientation, ucache, sorter, mut)));
+            linkers.push_back(PairLinkerPtr(new PairLinker(sg, alnr, mOrientation, ucache,
+                                                           spillBytes, sorter, mut)));
             grp.add(*linkers.back());
         }
 
+        ReadPairBatchPtr batch(pool.get());
         while (reads.valid())
         {
-            grp.push_back(PairLinker::ReadPair(reads.lhs().clone(), reads.rhs().clone()));
+            batch->push_back(reads.lhs(), reads.rhs());
+            if (batch->full())
+            {
+                grp.push_back(batch);
+                batch = pool.get();
+            }
             ++reads;
         }
+        grp.push_back(batch);
+        batch.reset();
         grp.wait();
 
         log(info, "merging results.");
+        vector<PairLinker::Links*> accs;
         for (vector<PairLinkerPtr>::const_iterator
              i = linkers.begin(); i != linkers.end(); ++i)
         {
@@ -879,6 +833,22 @@ GossCmdThreadPairs::operator()(const GossCmdContext& pCxt)
             {
                 dist[j->first] += j->second;
             }
+            accs.push_back(&(*i)->getLinks());
+            spilled = spilled || (*i)->spilled();
+        }
+        if (spilled)
+        {
+            log(info, "links exceeded memory; merging them on disk.");
+            for (vector<PairLinkerPtr>::const_iterator
+                 i = linkers.begin(); i != linkers.end(); ++i)
+            {
+                (*i)->spill();
+            }
+        }
+        else
+        {
+            PairLinker::Links::merge(accs, mNumThreads, links);
+            LOG(log, info) << "found " << links.size() << " distinct links";
         }
     }
 
@@ -908,8 +878,23 @@ GossCmdThreadPairs::operator()(const GossCmdContext& pCxt)
 
     FileFactory::OutHolderPtr outp(fac.out(mIn + ".links"));
     LinkFilter<BiLinkMap> f(biLinks, mMinLinkCount, maxInsertSize, sg, entries);
-    LinkMapCompiler<LinkFilter<BiLinkMap> > c(f);
-    sorter.sort(c);
+    if (spilled)
+    {
+        PairLinkStatsCompiler<LinkFilter<BiLinkMap> > c(f);
+        sorter.sort(c);
+    }
+    else
+    {
+        for (PairLinker::Links::Entries::const_iterator
+             i = links.begin(); i != links.end(); ++i)
+        {
+            const PairLinkStats& s(i->value);
+            f.push_back(SuperPathId(i->lhs), SuperPathId(i->rhs), s.count,
+                        s.lhsOffsetSum, s.lhsOffsetSum2, s.rhsOffsetSum, s.rhsOffsetSum2);
+        }
+        f.end();
+        PairLinker::Links::Entries().swap(links);
+    }
 
     // log(info, "found " + lexical_cast<string>(biLinks.size()) + " distinct links");
 
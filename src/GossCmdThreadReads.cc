@@ -21,6 +21,7 @@
 #include "GossReadSequenceBases.hh"
 #include "Graph.hh"
 #include "KmerAligner.hh"
+#include "LinkAccumulator.hh"
 #include "LineParser.hh"
 #include "PairLinker.hh"
 #include "ReadSequenceFileSequence.hh"
@@ -318,11 +319,33 @@ typedef vector<Path> Paths;
 
 typedef vector<Gossamer::position_type> Kmers;
 
+// The number of reads supporting a link, and the total gap between the
+// linked super paths.
+struct ReadLinkStats
+{
+    LinkCount count;
+    uint32_t gap;
+
+    ReadLinkStats& operator+=(const ReadLinkStats& pRhs)
+    {
+        count += pRhs.count;
+        gap += pRhs.gap;
+        return *this;
+    }
+
+    ReadLinkStats()
+        : count(0), gap(0)
+    {
+    }
+};
+
+typedef LinkAccumulator<ReadLinkStats> ReadLinks;
+
 class ReadLinker
 {
 public:
 
-    const BiLinkMap& getLinks() const
+    ReadLinks& getLinks()
     {
         return mLinks;
     }
@@ -362,7 +385,9 @@ public:
                         a = b;
                         b = id;
                         // ss << l << '\t' << a.value() << '\t' << b.value() << '\n';
-                        mLinks.add(a, b, gap);
+                        ReadLinkStats& s(mLinks[Link(a, b)]);
+                        s.count += 1;
+                        s.gap += gap;
                         gap = 0;
                         link = true;
                     }
@@ -398,7 +423,7 @@ private:
     const EdgeIndex& mIndex;
     UniquenessCache& mUCache;
     KmerAligner mAligner;
-    BiLinkMap mLinks;
+    ReadLinks mLinks;
 };
 
 typedef std::shared_ptr<ReadLinker> ReadLinkerPtr;
@@ -710,7 +735,7 @@ GossCmdThreadReads::operator()(const GossCmdContext& pCxt)
                 << Gossamer::general_error_info("Asymmetric graphs not yet handled")
                 << Gossamer::open_graph_name_info(mIn));
         }
-        auto idxPtr = EdgeIndex::create(g, entries, sg, mCacheRate, mNumThreads, log);
+        auto idxPtr = EdgeIndex::open(mIn, fac, g, entries, sg, mCacheRate, mNumThreads, log);
         EdgeIndex& idx(*idxPtr);
 
         std::deque<GossReadSequence::Item> items;
@@ -766,11 +791,18 @@ GossCmdThreadReads::operator()(const GossCmdContext& pCxt)
                 grp.wait();
 
                 log(info, "merging results.");
+                vector<ReadLinks*> accs;
                 for (vector<ReadLinkerPtr>::const_iterator
                      i = linkers.begin(); i != linkers.end(); ++i)
                 {
-                    const BiLinkMap& l((*i)->getLinks());
-                    links.add(l);
+                    accs.push_back(&(*i)->getLinks());
+                }
+                ReadLinks::Entries merged;
+                ReadLinks::merge(accs, mNumThreads, merged);
+                for (ReadLinks::Entries::const_iterator
+                     i = merged.begin(); i != merged.end(); ++i)
+                {
+                    links.add(i->link(), i->value.gap, i->value.count);
                 }
             }
 
@@ -14,7 +14,11 @@
 #include "EstimateGraphStatistics.hh"
 #include "ProgressMonitor.hh"
 #include "Timer.hh"
+#include "JobManager.hh"
 
+#include <functional>
+#include <limits>
+#include <memory>
 #include <string>
 #include <boost/lexical_cast.hpp>
 
@@ -24,6 +28,100 @@ using namespace std;
 
 typedef vector<string> strings;
 
+constexpr uint64_t GossCmdTrimGraph::minRangedEdges;
+
+namespace // anonymous
+{
+    // The edges of a range of ranks whose counts are above the cutoff.
+    // The counts are compared a block at a time, and only the edges
+    // which survive are decoded.
+    class TrimBatch
+    {
+    public:
+        void operator()()
+        {
+            const SparseArray& edges(mGraph.edges().array());
+            const VariableByteArray& counts(mGraph.counts());
+            const uint64_t B = VariableByteArray::BlockItems;
+            SparseArray::Iterator itr(edges.iterator(mBegin));
+            uint64_t r = mBegin;
+            for (uint64_t b = mBegin; b < mEnd; b += B)
+            {
+                uint64_t m = counts.greaterMask(b, mCutoff);
+                while (m)
+                {
+                    const uint64_t s = b + Gossamer::find_first_set(m) - 1;
+                    m &= m - 1;
+                    for (; r < s; ++r)
+                    {
+                        ++itr;
+                    }
+                    mEdges.push_back(*itr);
+                    mCounts.push_back(counts[s]);
+                }
+            }
+        }
+
+        TrimBatch(const Graph& pGraph, uint64_t pBegin, uint64_t pEnd, uint32_t pCutoff)
+            : mGraph(pGraph), mBegin(pBegin), mEnd(pEnd), mCutoff(pCutoff)
+        {
+        }
+
+        vector<Gossamer::position_type> mEdges;
+        vector<uint32_t> mCounts;
+
+    private:
+        const Graph& mGraph;
+        const uint64_t mBegin;
+        const uint64_t mEnd;
+        const uint32_t mCutoff;
+    };
+    typedef std::shared_ptr<TrimBatch> TrimBatchPtr;
+
+    // Filter the ranks a round of ranges at a time, writing each round
+    // while the next one is filtered. The ranges are whole blocks of
+    // counts. One pool of threads serves all the rounds.
+    void trimRanges(const Graph& pGraph, uint32_t pCutoff, uint64_t pThreads,
+                    Graph::Builder& pBuilder, ProgressMonitorNew& pMon)
+    {
+        const uint64_t z = pGraph.count();
+        const uint64_t rangeSize = 1ULL << 16;
+        const uint64_t roundSize = 4 * pThreads * rangeSize;
+        JobManager mgr(pThreads);
+        vector<TrimBatchPtr> batches;
+        auto startRound = [&](uint64_t pBegin)
+        {
+            const uint64_t end = min(z, pBegin + roundSize);
+            for (uint64_t r = pBegin; r < end; r += rangeSize)
+            {
+                batches.push_back(TrimBatchPtr(new TrimBatch(pGraph, r, min(end, r + rangeSize), pCutoff)));
+                mgr.enqueue(std::bind<void>(std::ref(*batches.back())));
+            }
+        };
+
+        startRound(0);
+        for (uint64_t r = 0; r < z; r += roundSize)
+        {
+            mgr.wait();
+            vector<TrimBatchPtr> done;
+            done.swap(batches);
+            if (r + roundSize < z)
+            {
+                startRound(r + roundSize);
+            }
+            for (uint64_t i = 0; i < done.size(); ++i)
+            {
+                const TrimBatch& batch(*done[i]);
+                for (uint64_t j = 0; j < batch.mEdges.size(); ++j)
+                {
+                    pBuilder.push_back(batch.mEdges[j], batch.mCounts[j]);
+                }
+            }
+            pMon.tick(min(z, r + roundSize));
+        }
+    }
+} // namespace anonymous
+
 
 void
 GossCmdTrimGraph::operator()(const GossCmdContext& pCxt)
@@ -36,6 +134,7 @@ GossCmdTrimGraph::operator()(const GossCmdContext& pCxt)
     uint64_t z = 0;
     uint64_t n = 0;
     uint64_t k = 0;
+    VariableByteArray::Format fmt = VariableByteArray::LayeredFormat;
     Timer t;
     {
         Graph::LazyIterator itr(mIn, fac);
@@ -47,6 +146,7 @@ GossCmdTrimGraph::operator()(const GossCmdContext& pCxt)
         }
         k = itr.K();
         z = itr.count();
+        fmt = itr.countsFormat();
         map<uint64_t,uint64_t> h = Graph::hist(mIn, fac);
 
         if (mScaleCutoffByK)
@@ -108,20 +208,29 @@ GossCmdTrimGraph::operator()(const GossCmdContext& pCxt)
     log(info, mIn + " had " + lexical_cast<string>(z));
     log(info, mOut + " will have " + lexical_cast<string>(n));
 
-    Graph::Builder b(k, mOut, fac, n);
+    Graph::Builder b(k, mOut, fac, n, false, fmt);
 
     ProgressMonitorNew mon(log, z);
-    uint64_t j = 0;
-
-    for (Graph::LazyIterator itr(mIn, fac); itr.valid(); ++itr)
+    if (mNumThreads > 1 && z >= mMinRangedEdges)
     {
-        mon.tick(++j);
-        if ((*itr).second > cutoff)
+        GraphPtr gPtr = Graph::open(mIn, fac);
+        const uint32_t c = static_cast<uint32_t>(min<uint64_t>(cutoff, numeric_limits<uint32_t>::max()));
+        trimRanges(*gPtr, c, mNumThreads, b, mon);
+    }
+    else
+    {
+        uint64_t j = 0;
+        for (Graph::LazyIterator itr(mIn, fac); itr.valid(); ++itr)
         {
-            b.push_back((*itr).first.value(), (*itr).second);
+            mon.tick(++j);
+            if ((*itr).second > cutoff)
+            {
+                b.push_back((*itr).first.value(), (*itr).second);
+            }
         }
     }
     b.end();
+    Graph::saveStats(mOut, fac, mNumThreads);
 
     log(info, "total elapsed time: " + lexical_cast<string>(t.check()));
 }
@@ -166,9 +275,12 @@ GossCmdFactoryTrimGraph::create(App& pApp, const variables_map& pOpts)
                 << Gossamer::usage_info("cannot scale an inferred cutoff"));
     }
 
+    uint64_t T = 4;
+    chk.getOptional("num-threads", T);
+
     chk.throwIfNecessary(pApp);
 
-    return GossCmdPtr(new GossCmdTrimGraph(in, out, c, inferCutoff, estimateOnly, scaleCutoffByK));
+    return GossCmdPtr(new GossCmdTrimGraph(in, out, c, inferCutoff, estimateOnly, scaleCutoffByK, T));
 }
 
 GossCmdFactoryTrimGraph::GossCmdFactoryTrimGraph()
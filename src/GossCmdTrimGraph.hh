@@ -16,14 +16,21 @@
 class GossCmdTrimGraph : public GossCmd
 {
 public:
+    // Graphs with fewer edges than this are trimmed by a single pass
+    // over the edges. Larger ones, given more than one thread, are cut
+    // into ranges of ranks which are filtered in parallel.
+    static constexpr uint64_t minRangedEdges = 1ULL << 24;
+
     void operator()(const GossCmdContext& pCxt);
 
     GossCmdTrimGraph(const std::string& pIn, const std::string& pOut,
                      uint64_t pC, bool pInferCutoff, bool pEstimateOnly,
-                     const boost::optional<uint64_t>& pScaleCutoffByK)
+                     const boost::optional<uint64_t>& pScaleCutoffByK,
+                     uint64_t pNumThreads, uint64_t pMinRangedEdges = minRangedEdges)
         : mIn(pIn), mOut(pOut), mC(pC),
           mInferCutoff(pInferCutoff), mEstimateOnly(pEstimateOnly),
-          mScaleCutoffByK(pScaleCutoffByK)
+          mScaleCutoffByK(pScaleCutoffByK), mNumThreads(pNumThreads),
+          mMinRangedEdges(pMinRangedEdges)
     {
     }
 
@@ -34,6 +41,8 @@ private:
     const bool mInferCutoff;
     const bool mEstimateOnly;
     const boost::optional<uint64_t> mScaleCutoffByK;
+    const uint64_t mNumThreads;
+    const uint64_t mMinRangedEdges;
 };
 
 
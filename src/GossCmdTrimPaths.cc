@@ -15,6 +15,7 @@
 #include "Timer.hh"
 #include "ProgressMonitor.hh"
 #include "ThreadGroup.hh"
+#include "UnitigIndex.hh"
 
 #include <string>
 #include <boost/lexical_cast.hpp>
@@ -75,11 +76,21 @@ namespace // anonymous
         pVis(e, pGraph.rank(e));
     }
 
+    // Find the short paths from edges with no edges coming in, and
+    // mark them and their reverse complements to be removed. The range
+    // [mBegin, mEnd) is of edge ranks, or of unitigs if there is a
+    // unitig index.
     class Block
     {
     public:
         void operator()()
         {
+            if (mUnitigs)
+            {
+                fromIndex();
+                return;
+            }
+
             vector<EdgeAndRank> edges;
             vector<EdgeAndRank> otherEdges;
             vector<uint64_t> zapRanks;
@@ -137,28 +148,61 @@ namespace // anonymous
                     zapRanks.push_back(x_rnk);
                     zapRanks.push_back(y_rnk);
                 }
-
-                std::unique_lock<std::mutex> lk(mMutex);
-                for (uint64_t j = 0; j < zapRanks.size(); ++j)
-                {
-                    mZapped[zapRanks[j]] = true;
-                }
-                ++mPathCount;
-                mZapCount += zapRanks.size();
+                zap(zapRanks);
             }
         }
 
-        Block(const Graph& pGraph, dynamic_bitset<>& pZapped, std::mutex& pMutex,
-              uint64_t& pTipCount, uint64_t& pZapCount, uint32_t pC,
+        Block(const Graph& pGraph, const UnitigIndex* pUnitigs, dynamic_bitset<>& pZapped,
+              std::mutex& pMutex, uint64_t& pTipCount, uint64_t& pZapCount, uint32_t pC,
               uint64_t pBegin, uint64_t pEnd)
-            : mGraph(pGraph), mZapped(pZapped), mMutex(pMutex),
+            : mGraph(pGraph), mUnitigs(pUnitigs), mZapped(pZapped), mMutex(pMutex),
               mPathCount(pTipCount), mZapCount(pZapCount), mC(pC),
               mBegin(pBegin), mEnd(pEnd)
         {
         }
 
     private:
+        // Every edge whose from-node has no edges coming in starts a
+        // unitig, which is the path walked from it.
+        void fromIndex()
+        {
+            vector<uint64_t> zapRanks;
+            for (uint64_t id = mBegin; id < mEnd; ++id)
+            {
+                const Graph::Edge beg = mGraph.select(mUnitigs->first(id));
+                if (mGraph.inDegree(mGraph.from(beg)) != 0)
+                {
+                    continue;
+                }
+                if (mUnitigs->length(id) > 2 * mGraph.K())
+                {
+                    continue;
+                }
+
+                zapRanks.clear();
+                for (uint64_t p = mUnitigs->begin(id); p < mUnitigs->end(id); ++p)
+                {
+                    const uint64_t x_rnk = mUnitigs->edge(p);
+                    zapRanks.push_back(x_rnk);
+                    zapRanks.push_back(mGraph.rank(mGraph.reverseComplement(mGraph.select(x_rnk))));
+                }
+                zap(zapRanks);
+            }
+        }
+
+        void zap(const vector<uint64_t>& pRanks)
+        {
+            std::unique_lock<std::mutex> lk(mMutex);
+            for (uint64_t j = 0; j < pRanks.size(); ++j)
+            {
+                mZapped[pRanks[j]] = true;
+            }
+            ++mPathCount;
+            mZapCount += pRanks.size();
+        }
+
         const Graph& mGraph;
+        const UnitigIndex* mUnitigs;
         dynamic_bitset<>& mZapped;
         std::mutex& mMutex;
         uint64_t& mPathCount;
@@ -194,10 +238,15 @@ GossCmdTrimPaths::operator()(const GossCmdContext& pCxt)
     uint64_t zapCount = 0;
     uint64_t pathCount = 0;
 
+    // The paths are unitigs, so with an index, the blocks are ranges
+    // of unitigs rather than of edges. Loops never start at a node with
+    // no edges coming in, so are left out.
+    UnitigIndexPtr unitigs = UnitigIndex::open(mIn + "-unitigs", g, fac, log);
+
     log(info, "locating low-coverage paths");
     Timer t;
 
-    uint64_t N = g.count();
+    uint64_t N = unitigs ? unitigs->count() - unitigs->cycles() : g.count();
     uint64_t J = mThreads;
     uint64_t S = N / J;
     vector<BlockPtr> blks;
@@ -207,19 +256,19 @@ GossCmdTrimPaths::operator()(const GossCmdContext& pCxt)
         uint64_t e = (i == J - 1 ? N : (i + 1) * S);
         if (b != e)
         {
-            blks.push_back(BlockPtr(new Block(g, zapped, mtx, pathCount, zapCount, mC, b, e)));
+            blks.push_back(BlockPtr(new Block(g, unitigs.get(), zapped, mtx, pathCount, zapCount, mC, b, e)));
         }
     }
     ThreadGroup grp;
-    for (uint64_t i = 0; i < J; ++i)
+    for (uint64_t i = 0; i < blks.size(); ++i)
     {
-        grp.create(*blks[i]);
+        grp.create(*blks[i], i, blks.size());
     }
     grp.join();
 
     log(info, "writing out graph.");
     ProgressMonitor writeMon(log, g.count(), 200);
-    Graph::Builder b(g.K(), mOut, fac, g.count() - zapCount);
+    Graph::Builder b(g.K(), mOut, fac, g.count() - zapCount, false, g.countsFormat());
     uint64_t i = 0;
     for (Graph::Iterator itr(g); itr.valid(); ++itr, ++i)
     {
@@ -241,6 +290,7 @@ GossCmdTrimPaths::operator()(const GossCmdContext& pCxt)
         b.push_back(e.value(), c);
     }
     b.end();
+    Graph::saveStats(mOut, fac, mThreads);
 
     log(info, "number of paths removed: " + lexical_cast<string>(pathCount));
     log(info, "number of edges removed: " + lexical_cast<string>(zapCount));
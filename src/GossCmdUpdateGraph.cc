@@ -0,0 +1,254 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "GossCmdUpdateGraph.hh"
+
+#include "BackyardHash.hh"
+#include "EntryEdgeSet.hh"
+#include "GossamerException.hh"
+#include "GossCmdBuildEntryEdgeSet.hh"
+#include "GossCmdBuildGraph.hh"
+#include "GossCmdBuildSupergraph.hh"
+#include "GossCmdBuildUnitigs.hh"
+#include "GossCmdReg.hh"
+#include "GossOptionChecker.hh"
+#include "Graph.hh"
+#include "Logger.hh"
+#include "ProgressMonitor.hh"
+#include "ScaffoldGraph.hh"
+#include "SuperGraph.hh"
+#include "Timer.hh"
+#include "UnitigIndex.hh"
+
+#include <algorithm>
+#include <limits>
+#include <boost/lexical_cast.hpp>
+
+using namespace boost;
+using namespace boost::program_options;
+using namespace std;
+
+typedef vector<string> strings;
+
+namespace // anonymous
+{
+    const uint64_t gMaxCount = numeric_limits<uint32_t>::max();
+
+    // Merge the edges of pDelta into those of pIn, writing pOut.
+    // Return the number of edges in pOut which were not in pIn.
+    //
+    // The edges are re-encoded rather than copied. Even with the number
+    // of low bits kept as it was, each inserted edge shifts the bit
+    // offsets of all the edges after it, in both the high and low bits,
+    // so the old blocks could only be reused by copying them at an
+    // offset, and the select directories would be rebuilt anyway.
+    //
+    uint64_t mergeDelta(const string& pIn, const string& pDelta, const string& pOut,
+                        Logger& pLog, FileFactory& pFactory)
+    {
+        Graph::LazyIterator lhs(pIn, pFactory);
+        Graph::LazyIterator rhs(pDelta, pFactory);
+        if (lhs.K() != rhs.K())
+        {
+            BOOST_THROW_EXCEPTION(
+                Gossamer::error()
+                    << Gossamer::general_error_info("the update has a different kmer-size to "
+                                                    + pIn + "."));
+        }
+
+        const uint64_t tot = lhs.count() + rhs.count();
+        Graph::Builder dest(lhs.K(), pOut, pFactory, tot, lhs.asymmetric(), lhs.countsFormat());
+
+        uint64_t added = 0;
+        uint64_t n = 0;
+        ProgressMonitorNew mon(pLog, tot);
+        while (lhs.valid() || rhs.valid())
+        {
+            pair<Graph::Edge,uint32_t> l(Graph::Edge(Gossamer::position_type(0)), 0);
+            pair<Graph::Edge,uint32_t> r(l);
+            if (lhs.valid())
+            {
+                l = *lhs;
+            }
+            if (rhs.valid())
+            {
+                r = *rhs;
+            }
+
+            if (rhs.valid() && (!lhs.valid() || r.first < l.first))
+            {
+                dest.push_back(r.first.value(), r.second);
+                ++added;
+                ++rhs;
+                ++n;
+            }
+            else if (!rhs.valid() || l.first < r.first)
+            {
+                dest.push_back(l.first.value(), l.second);
+                ++lhs;
+                ++n;
+            }
+            else
+            {
+                dest.push_back(l.first.value(),
+                               min<uint64_t>(uint64_t(l.second) + r.second, gMaxCount));
+                ++lhs;
+                ++rhs;
+                n += 2;
+            }
+            mon.tick(n);
+        }
+        dest.end();
+        return added;
+    }
+} // namespace anonymous
+
+void
+GossCmdUpdateGraph::operator()(const GossCmdContext& pCxt)
+{
+    FileFactory& fac(pCxt.fac);
+    Logger& log(pCxt.log);
+    Timer t;
+
+    uint64_t K = 0;
+    VariableByteArray::Format countsFormat = VariableByteArray::LayeredFormat;
+    {
+        Graph::LazyIterator itr(mIn, fac);
+        if (itr.asymmetric())
+        {
+            BOOST_THROW_EXCEPTION(Gossamer::error()
+                << Gossamer::general_error_info("Asymmetric graphs not yet handled")
+                << Gossamer::open_graph_name_info(mIn));
+        }
+        K = itr.K();
+        countsFormat = itr.countsFormat();
+    }
+
+    // Count the new reads into a graph of their own.
+    const string delta(fac.tmpName());
+    log(info, "counting new reads");
+    {
+        GossCmdBuildGraph build(K, mS, mN, mT, delta, mFastaNames, mFastqNames, mLineNames, countsFormat, false);
+        build(pCxt);
+    }
+
+    log(info, "merging new edges into " + mIn);
+    const uint64_t added = mergeDelta(mIn, delta, mOut, log, fac);
+    Graph::remove(delta, fac);
+    Graph::saveStats(mOut, fac, mT);
+    log(info, "new edges: " + lexical_cast<string>(added));
+
+    // Nothing that depends on the graph is updated in place. The unitig
+    // index and the entry edges are built afresh from the new graph:
+    // the entry edges carry the mean coverage of each contig, so they
+    // change with any count. The supergraph depends only on the shape
+    // of the graph, so if no edges were added it is copied, keeping any
+    // paths threaded through it, and otherwise it is built afresh.
+    const bool hasEntries = fac.exists(mIn + "-entries.header");
+    const bool hasSupergraph = fac.exists(mIn + "-supergraph.header");
+    if (UnitigIndex::exists(mIn + "-unitigs", fac))
+    {
+        log(info, "rebuilding unitigs");
+        GossCmdBuildUnitigs unitigs(mOut, mT);
+        unitigs(pCxt);
+    }
+    if (hasEntries || hasSupergraph)
+    {
+        log(info, "rebuilding entry edges");
+        GossCmdBuildEntryEdgeSet entries(mOut, mT);
+        entries(pCxt);
+    }
+    if (hasSupergraph)
+    {
+        if (added == 0)
+        {
+            log(info, "copying supergraph");
+            SuperGraph::read(mIn, fac)->write(mOut, fac);
+        }
+        else
+        {
+            log(info, "rebuilding supergraph");
+            GossCmdBuildSupergraph sg(mOut, false);
+            sg(pCxt);
+        }
+    }
+    if (ScaffoldGraph::existScafFiles(pCxt, mIn))
+    {
+        log(warning, "scaffold files for " + mIn + " have not been carried over.");
+    }
+
+    log(info, "total elapsed time: " + lexical_cast<string>(t.check()));
+}
+
+GossCmdPtr
+GossCmdFactoryUpdateGraph::create(App& pApp, const variables_map& pOpts)
+{
+    GossOptionChecker chk(pOpts);
+    FileFactory& fac(pApp.fileFactory());
+    GossOptionChecker::FileCreateCheck createChk(fac, true);
+    GossOptionChecker::FileReadCheck readChk(fac);
+
+    string in;
+    chk.getRepeatingOnce("graph-in", in);
+
+    string out;
+    chk.getMandatory("graph-out", out, createChk);
+
+    uint64_t B = 2;
+    bool explicitB = chk.getOptional("buffer-size", B);
+    if (B > 24)
+    {
+        pApp.logger()(warning, "Unsupported --buffer-size " + lexical_cast<string>(B) + ", truncating to 24.");
+        B = 24;
+    }
+
+    // As for build-graph, fit the hash table into the memory budget.
+    uint64_t bytes = std::min<uint64_t>(pApp.memoryBudget().bufferSize(B << 30, explicitB, 1ULL << 26), 24ULL << 30);
+    uint64_t S = BackyardHash::maxSlotBits(bytes);
+    uint64_t N = bytes / (1.5 * sizeof(uint32_t) + sizeof(BackyardHash::value_type));
+
+    uint64_t T = 4;
+    chk.getOptional("num-threads", T);
+
+    strings fastaNames;
+    chk.getRepeating0("fasta-in", fastaNames, readChk);
+    strings fastaNameFiles;
+    chk.getOptional("fastas-in", fastaNameFiles);
+    chk.expandFilenames(fastaNameFiles, fastaNames, fac);
+
+    strings fastqNames;
+    chk.getRepeating0("fastq-in", fastqNames, readChk);
+    strings fastqNameFiles;
+    chk.getOptional("fastqs-in", fastqNameFiles);
+    chk.expandFilenames(fastqNameFiles, fastqNames, fac);
+
+    strings lineNames;
+    chk.getRepeating0("line-in", lineNames, readChk);
+
+    if (in == out)
+    {
+        chk.addError("the updated graph must have a different name to the input graph.\n");
+    }
+
+    chk.throwIfNecessary(pApp);
+
+    return GossCmdPtr(new GossCmdUpdateGraph(in, out, S, N, T, fastaNames, fastqNames, lineNames));
+}
+
+GossCmdFactoryUpdateGraph::GossCmdFactoryUpdateGraph()
+    : GossCmdFactory("add the edges of more reads to an existing graph, rewriting the graph in full")
+{
+    mCommonOptions.insert("graph-in");
+    mCommonOptions.insert("graph-out");
+    mCommonOptions.insert("buffer-size");
+    mCommonOptions.insert("fasta-in");
+    mCommonOptions.insert("fastq-in");
+    mCommonOptions.insert("line-in");
+    mCommonOptions.insert("fastas-in");
+    mCommonOptions.insert("fastqs-in");
+}
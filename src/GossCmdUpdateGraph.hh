@@ -0,0 +1,53 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef GOSSCMDUPDATEGRAPH_HH
+#define GOSSCMDUPDATEGRAPH_HH
+
+#ifndef GOSSCMD_HH
+#include "GossCmd.hh"
+#endif
+
+// Add the edges of some new reads to an existing graph, without
+// recounting the reads the graph was built from.
+//
+class GossCmdUpdateGraph : public GossCmd
+{
+public:
+    typedef std::vector<std::string> strings;
+
+    void operator()(const GossCmdContext& pCxt);
+
+    GossCmdUpdateGraph(const std::string& pIn, const std::string& pOut,
+                       const uint64_t& pS, const uint64_t& pN, const uint64_t& pT,
+                       const strings& pFastaNames, const strings& pFastqNames, const strings& pLineNames)
+        : mIn(pIn), mOut(pOut), mS(pS), mN(pN), mT(pT),
+          mFastaNames(pFastaNames), mFastqNames(pFastqNames), mLineNames(pLineNames)
+    {
+    }
+
+private:
+    const std::string mIn;
+    const std::string mOut;
+    const uint64_t mS;
+    const uint64_t mN;
+    const uint64_t mT;
+    const strings mFastaNames;
+    const strings mFastqNames;
+    const strings mLineNames;
+};
+
+class GossCmdFactoryUpdateGraph : public GossCmdFactory
+{
+public:
+    GossCmdPtr create(App& pApp, const boost::program_options::variables_map& pOpts);
+
+    GossCmdFactoryUpdateGraph();
+};
+
+#endif // GOSSCMDUPDATEGRAPH_HH
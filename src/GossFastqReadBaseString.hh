@@ -31,6 +31,11 @@ public:
     
     GossReadPtr clone() const;
 
+    const std::string& qlabel() const
+    {
+        return mQLabel;
+    }
+
     GossFastqReadBaseString(const std::string& pLabel, const std::string& pRead, 
                             const std::string& pQLabel, const std::string& pQual)
         : GossReadBaseString(pLabel, pRead, pQual), mQLabel(pQLabel)
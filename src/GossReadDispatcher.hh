@@ -27,13 +27,24 @@
 #include <vector>
 #endif
 
+// Hand reads to a set of handlers running in background threads, a
+// batch at a time. Reads handed over singly are gathered into batches.
+//
 class GossReadDispatcher : public GossReadHandler
 {
 public:
 
     void operator()(const GossRead& pRead)
     {
-        mConsumer.push_back(pRead.clone());
+        if (!mPending)
+        {
+            mPending = mPool.get();
+        }
+        mPending->push_back(pRead);
+        if (mPending->full())
+        {
+            flush();
+        }
     }
 
     void operator()(const GossRead& pLhs, const GossRead& pRhs)
@@ -41,13 +52,25 @@ public:
         throw 2;
     }
 
+    bool batched() const
+    {
+        return true;
+    }
+
+    void operator()(const ReadBatchPtr& pBatch)
+    {
+        flush();
+        mConsumer.push_back(pBatch);
+    }
+
     void end()
     {
+        flush();
         mConsumer.wait();
     }
 
     GossReadDispatcher(const std::vector<GossReadHandlerPtr>& pHandlers)
-        : mHandlers(pHandlers), mConsumer(1024)
+        : mHandlers(pHandlers), mConsumer(2 * pHandlers.size())
     {
         for (uint64_t i = 0; i < mHandlers.size(); ++i)
         {
@@ -56,10 +79,23 @@ public:
     }
 
 private:
+    void flush()
+    {
+        if (mPending)
+        {
+            mConsumer.push_back(mPending);
+            mPending = ReadBatchPtr();
+        }
+    }
+
     const std::vector<GossReadHandlerPtr> mHandlers;
-    BackgroundMultiConsumer<GossReadPtr> mConsumer;
+    ReadBatch::Pool mPool;
+    ReadBatchPtr mPending;
+    BackgroundMultiConsumer<ReadBatchPtr> mConsumer;
 };
 
+// As above, for pairs of reads.
+//
 class GossPairDispatcher : public GossReadHandler
 {
 public:
@@ -71,16 +107,36 @@ public:
 
     void operator()(const GossRead& pLhs, const GossRead& pRhs)
     {
-        mConsumer.push_back(std::make_pair(pLhs.clone(), pRhs.clone()));
+        if (!mPending)
+        {
+            mPending = mPool.get();
+        }
+        mPending->push_back(pLhs, pRhs);
+        if (mPending->full())
+        {
+            flush();
+        }
+    }
+
+    bool batched() const
+    {
+        return true;
+    }
+
+    void operator()(const ReadBatchPtr& pBatch)
+    {
+        flush();
+        mConsumer.push_back(pBatch);
     }
 
     void end()
     {
+        flush();
         mConsumer.wait();
     }
 
     GossPairDispatcher(const std::vector<GossReadHandlerPtr>& pHandlers)
-        : mHandlers(pHandlers), mConsumer(1024)
+        : mHandlers(pHandlers), mConsumer(2 * pHandlers.size())
     {
         for (uint64_t i = 0; i < mHandlers.size(); ++i)
         {
@@ -89,8 +145,19 @@ public:
     }
 
 private:
+    void flush()
+    {
+        if (mPending)
+        {
+            mConsumer.push_back(mPending);
+            mPending = ReadBatchPtr();
+        }
+    }
+
     const std::vector<GossReadHandlerPtr> mHandlers;
-    BackgroundMultiConsumer<std::pair<GossReadPtr, GossReadPtr> > mConsumer;
+    ReadBatch::Pool mPool;
+    ReadBatchPtr mPending;
+    BackgroundMultiConsumer<ReadBatchPtr> mConsumer;
 };
 
 #endif // GOSSREADDISPATCHER_HH
@@ -13,6 +13,10 @@
 #include "GossRead.hh"
 #endif
 
+#ifndef READBATCH_HH
+#include "ReadBatch.hh"
+#endif
+
 class GossReadHandler
 {
 public:
@@ -31,6 +35,27 @@ public:
         (*this)(*pPair.first, *pPair.second);
     }
 
+    // True if the handler would rather have whole batches (see below).
+    // Otherwise GossReadProcessor hands it each read as it is parsed.
+    virtual bool batched() const
+    {
+        return false;
+    }
+
+    // Handle a batch of reads, or of pairs if the batch is paired.
+    // Unless overridden, the reads are handled one at a time.
+    virtual void operator()(const ReadBatchPtr& pBatch)
+    {
+        if (pBatch->paired())
+        {
+            pBatch->visitPairs([this] (const GossRead& pLhs, const GossRead& pRhs) { (*this)(pLhs, pRhs); });
+        }
+        else
+        {
+            pBatch->visit([this] (const GossRead& pRead) { (*this)(pRead); });
+        }
+    }
+
     virtual void startFile(const std::string& pFileName) {}
 
     virtual void endFile() {}
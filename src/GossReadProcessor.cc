@@ -13,6 +13,7 @@
 #include "FastqParser.hh"
 #include "GossReadSequenceBases.hh"
 #include "LineParser.hh"
+#include "ReadBatch.hh"
 #include <boost/foreach.hpp>
 
 using namespace std;
@@ -37,6 +38,61 @@ namespace {
         }
     }
 
+    // Hand the reads to the handler. Handlers which take batches get
+    // them from a background parser; others get each read as it is
+    // parsed, which saves copying it into a batch.
+    void processFile(GossReadParserPtr pParser, ReadBatch::Pool& pPool, GossReadHandler& pHandler,
+                     UnboundedProgressMonitor* pMonPtr, uint64_t& pNumReads)
+    {
+        GossReadSequenceBases seq(pParser);
+        if (!pHandler.batched())
+        {
+            for (; seq.valid(); ++seq)
+            {
+                logRead(pMonPtr, ++pNumReads);
+                pHandler(*seq);
+            }
+            return;
+        }
+        ReadBatchReader rdr(pPool, [&seq] (ReadBatch& pBatch) { return pBatch.fill(seq); });
+        ReadBatchPtr b;
+        while (rdr.get(b))
+        {
+            pNumReads += b->size();
+            logRead(pMonPtr, pNumReads);
+            pHandler(b);
+        }
+    }
+
+    // As above, for pairs of reads from two files. Returns false if
+    // one file has more reads than the other.
+    bool processFiles(GossReadParserPtr pLhs, GossReadParserPtr pRhs, ReadBatch::Pool& pPool,
+                      GossReadHandler& pHandler, UnboundedProgressMonitor* pMonPtr, uint64_t& pNumPairs)
+    {
+        GossReadSequenceBases lhs(pLhs);
+        GossReadSequenceBases rhs(pRhs);
+        if (!pHandler.batched())
+        {
+            for (; lhs.valid() && rhs.valid(); ++lhs, ++rhs)
+            {
+                logRead(pMonPtr, ++pNumPairs);
+                pHandler(*lhs, *rhs);
+            }
+        }
+        else
+        {
+            ReadBatchReader rdr(pPool, [&lhs, &rhs] (ReadBatch& pBatch) { return pBatch.fill(lhs, rhs); });
+            ReadBatchPtr b;
+            while (rdr.get(b))
+            {
+                pNumPairs += b->size() / 2;
+                logRead(pMonPtr, pNumPairs);
+                pHandler(b);
+            }
+        }
+        return lhs.valid() == rhs.valid();
+    }
+
 };
 
 void
@@ -49,18 +105,14 @@ GossReadProcessor::processSingle(const GossCmdContext& pCxt,
     uint64_t numReads = 0;
 
     LineSourceFactory lineSrcFac(BackgroundLineSource::create);
+    ReadBatch::Pool pool;
 
     BOOST_FOREACH(const std::string& fname, pLines)
     {
         FileThunkIn in(fac, fname);
         logFile(pLoggerPtr, fname);
         pHandler.startFile(fname);
-        GossReadParserPtr parser = LineParser::create(lineSrcFac(in));
-        for (GossReadSequenceBases seq(parser); seq.valid(); ++seq)
-        {
-            logRead(pMonPtr, ++numReads);
-            pHandler(*seq);
-        }
+        processFile(LineParser::create(lineSrcFac(in)), pool, pHandler, pMonPtr, numReads);
         pHandler.endFile();
     }
 
@@ -69,12 +121,7 @@ GossReadProcessor::processSingle(const GossCmdContext& pCxt,
         FileThunkIn in(fac, fname);
         logFile(pLoggerPtr, fname);
         pHandler.startFile(fname);
-        GossReadParserPtr parser = FastaParser::create(lineSrcFac(in));
-        for (GossReadSequenceBases seq(parser); seq.valid(); ++seq)
-        {
-            logRead(pMonPtr, ++numReads);
-            pHandler(*seq);
-        }
+        processFile(FastaParser::create(lineSrcFac(in)), pool, pHandler, pMonPtr, numReads);
         pHandler.endFile();
     }
 
@@ -83,12 +130,7 @@ GossReadProcessor::processSingle(const GossCmdContext& pCxt,
         FileThunkIn in(fac, fname);
         logFile(pLoggerPtr, fname);
         pHandler.startFile(fname);
-        GossReadParserPtr parser = FastqParser::create(lineSrcFac(in));
-        for (GossReadSequenceBases seq(parser); seq.valid(); ++seq)
-        {
-            logRead(pMonPtr, ++numReads);
-            pHandler(*seq);
-        }
+        processFile(FastqParser::create(lineSrcFac(in)), pool, pHandler, pMonPtr, numReads);
         pHandler.endFile();
     }
 
@@ -106,25 +148,17 @@ GossReadProcessor::processPairs(const GossCmdContext& pCxt,
     uint64_t numPairs = 0;
 
     LineSourceFactory lineSrcFac(BackgroundLineSource::create);
+    ReadBatch::Pool pool;
 
     for (uint64_t i = 0; i < pLines.size(); i += 2)
     {
         FileThunkIn inLhs(fac, pLines[i]);
         FileThunkIn inRhs(fac, pLines[i+1]);
 
-        GossReadSequenceBases lhs(LineParser::create(lineSrcFac(inLhs)));
-        GossReadSequenceBases rhs(LineParser::create(lineSrcFac(inRhs)));
-
         logFile(pLoggerPtr, inLhs.filename());
         logFile(pLoggerPtr, inRhs.filename());
-        while (lhs.valid() && rhs.valid())
-        {
-            logRead(pMonPtr, ++numPairs);
-            pHandler(*lhs, *rhs);
-            ++lhs;
-            ++rhs;
-        }
-        if (lhs.valid() != rhs.valid())
+        if (!processFiles(LineParser::create(lineSrcFac(inLhs)), LineParser::create(lineSrcFac(inRhs)),
+                          pool, pHandler, pMonPtr, numPairs))
         {
             log(warning, "The files '" + pLines[i] + "' and '" + pLines[i + 1] + "' have different numbers of reads!");
         }
@@ -135,20 +169,10 @@ GossReadProcessor::processPairs(const GossCmdContext& pCxt,
         FileThunkIn inLhs(fac, pFastas[i]);
         FileThunkIn inRhs(fac, pFastas[i+1]);
 
-        GossReadSequenceBases lhs(FastaParser::create(lineSrcFac(inLhs)));
-        GossReadSequenceBases rhs(FastaParser::create(lineSrcFac(inRhs)));
-
         logFile(pLoggerPtr, inLhs.filename());
         logFile(pLoggerPtr, inRhs.filename());
-
-        while (lhs.valid() && rhs.valid())
-        {
-            logRead(pMonPtr, ++numPairs);
-            pHandler(*lhs, *rhs);
-            ++lhs;
-            ++rhs;
-        }
-        if (lhs.valid() != rhs.valid())
+        if (!processFiles(FastaParser::create(lineSrcFac(inLhs)), FastaParser::create(lineSrcFac(inRhs)),
+                          pool, pHandler, pMonPtr, numPairs))
         {
             log(warning, "The files '" + pFastas[i] + "' and '" + pFastas[i + 1] + "' have different numbers of reads!");
         }
@@ -160,20 +184,10 @@ GossReadProcessor::processPairs(const GossCmdContext& pCxt,
         FileThunkIn inLhs(fac, pFastqs[i]);
         FileThunkIn inRhs(fac, pFastqs[i+1]);
 
-        GossReadSequenceBases lhs(FastqParser::create(lineSrcFac(inLhs)));
-        GossReadSequenceBases rhs(FastqParser::create(lineSrcFac(inRhs)));
-
         logFile(pLoggerPtr, inLhs.filename());
         logFile(pLoggerPtr, inRhs.filename());
-
-        while (lhs.valid() && rhs.valid())
-        {
-            logRead(pMonPtr, ++numPairs);
-            pHandler(*lhs, *rhs);
-            ++lhs;
-            ++rhs;
-        }
-        if (lhs.valid() != rhs.valid())
+        if (!processFiles(FastqParser::create(lineSrcFac(inLhs)), FastqParser::create(lineSrcFac(inRhs)),
+                          pool, pHandler, pMonPtr, numPairs))
         {
             log(warning, "The files '" + pFastqs[i] + "' and '" + pFastqs[i + 1] + "' have different numbers of reads!");
         }
@@ -102,6 +102,12 @@ namespace
             istream& i(**ip);
             i.read(reinterpret_cast<char*>(&pHeader), sizeof(pHeader));
         }
+        else if (version == Graph::unfingerprintedVersion)
+        {
+            istream& i(**ip);
+            i.read(reinterpret_cast<char*>(&pHeader), sizeof(pHeader) - sizeof(pHeader.fingerprint));
+            pHeader.fingerprint = 0;
+        }
         else
         {
             uint64_t v = Graph::version;
@@ -110,44 +116,94 @@ namespace
                     << Gossamer::version_mismatch_info(pair<uint64_t,uint64_t>(version, v)));
         }
     }
+
+    Graph::Header
+    getAndVerifyHeader(const string& pBaseName, FileFactory& pFactory)
+    {
+        Graph::Header h;
+        getAndVerifyHeader(pBaseName, pFactory, h);
+        return h;
+    }
+
+    // The layout of the counts is recorded in the graph's header.
+    VariableByteArray::Format
+    countsFormat(const Graph::Header& pHeader)
+    {
+        return pHeader.flags[Graph::Header::fFusedCounts]
+                ? VariableByteArray::FusedFormat : VariableByteArray::LayeredFormat;
+    }
 }
 
 void
 Graph::Builder::end()
 {
     uint64_t Rho = mK + 1;
-    mEdgesBuilderBackground.end();
-    mCountsBuilderBackground.end();
-    mEdgesBuilderBackground.wait();
-    mEdgesBuilder.end((position_type(1) << (2 * Rho)));
+    mEdgesBuilderBackground->end();
+    mCountsBuilderBackground->end();
+    mEdgesBuilderBackground->wait();
+    mEdgesBuilder->end((position_type(1) << (2 * Rho)));
 
-    mCountsBuilderBackground.wait();
-    mCountsBuilder.end();
+    mCountsBuilderBackground->wait();
+    mCountsBuilder->end();
 
-    FileFactory::OutHolderPtr op(mFactory.out(mBaseName + "-counts-hist.txt"));
-    ostream& o(**op);
-    for (map<uint64_t,uint64_t>::const_iterator i = mHist.begin();
-            i != mHist.end(); ++i)
+    mHeader.fingerprint = mFingerprint.value();
+    writeHeader();
+
+    mEdgesBuilderBackground.reset();
+    mEdgesBuilder.reset();
+    mCountsBuilderBackground.reset();
+    mCountsBuilder.reset();
+
+    if (mRetune)
     {
-        o << i->first << '\t' << i->second << endl;
+        SparseArray::retune(mBaseName + "-edges", mFactory, EdgesSpaceBudget);
     }
+
+    {
+        FileFactory::OutHolderPtr op(mFactory.out(mBaseName + "-counts-hist.txt"));
+        ostream& o(**op);
+        for (map<uint64_t,uint64_t>::const_iterator i = mHist.begin();
+                i != mHist.end(); ++i)
+        {
+            o << i->first << '\t' << i->second << endl;
+        }
+    }
+
+    if (GraphStats::exists(mBaseName, mFactory))
+    {
+        GraphStats::remove(mBaseName, mFactory);
+    }
+}
+
+void
+Graph::Builder::writeHeader()
+{
+    FileFactory::OutHolderPtr op(mFactory.out(mBaseName + ".header"));
+    ostream& o(**op);
+    o.write(reinterpret_cast<const char*>(&mHeader), sizeof(mHeader));
 }
 
 PropertyTree
 Graph::Builder::stat() const
 {
     PropertyTree t;
-    t.putSub("background-edge-builder", mEdgesBuilderBackground.stat());
-    t.putSub("background-counts-builder", mCountsBuilderBackground.stat());
+    if (mEdgesBuilderBackground)
+    {
+        t.putSub("background-edge-builder", mEdgesBuilderBackground->stat());
+        t.putSub("background-counts-builder", mCountsBuilderBackground->stat());
+    }
     return t;
 }
 
-Graph::Builder::Builder(uint64_t pK, const string& pBaseName, FileFactory& pFactory, rank_type pNumEdges, bool pAsymmetric)
-    : mBaseName(pBaseName), mFactory(pFactory), mK(pK),
-      mEdgesBuilder(pBaseName + "-edges", pFactory, position_type(1) << (2 * pK + 2), pNumEdges),
-      mEdgesBuilderBackground(mEdgesBuilder, 4096, 1024),
-      mCountsBuilder(pBaseName + "-counts", pFactory, pNumEdges, 1.0 / 1024.0),
-      mCountsBuilderBackground(mCountsBuilder, 4096, 1024)
+Graph::Builder::Builder(uint64_t pK, const string& pBaseName, FileFactory& pFactory, rank_type pNumEdges, bool pAsymmetric,
+                        VariableByteArray::Format pCountsFormat)
+    : mBaseName(pBaseName), mFactory(pFactory), mK(pK), mRetune(true),
+      mEdgesBuilder(new SparseArray::Builder(pBaseName + "-edges", pFactory,
+                                             position_type(1) << (2 * pK + 2), pNumEdges)),
+      mEdgesBuilderBackground(new BackgroundBlockConsumer<SparseArray::Builder>(*mEdgesBuilder, 4096, 1024)),
+      mCountsBuilder(new VariableByteArray::Builder(pBaseName + "-counts", pFactory, pNumEdges,
+                                                    1.0 / 1024.0, pCountsFormat)),
+      mCountsBuilderBackground(new BackgroundBlockConsumer<VariableByteArray::Builder>(*mCountsBuilder, 4096, 1024))
 {
     if (pK > MaxK)
     {
@@ -156,23 +212,24 @@ Graph::Builder::Builder(uint64_t pK, const string& pBaseName, FileFactory& pFact
                 << Gossamer::general_error_info("unable to build a graph with k="
                                                     + lexical_cast<string>(pK)));
     }
-    Header h;
-    h.version = version;
-    h.K = pK;
-    h.flags[Header::fAsymmetric] = pAsymmetric;
-
-    FileFactory::OutHolderPtr op(pFactory.out(pBaseName + ".header"));
-    ostream& o(**op);
-    o.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    mHeader.version = version;
+    mHeader.K = pK;
+    mHeader.flags[Header::fAsymmetric] = pAsymmetric;
+    mHeader.flags[Header::fFusedCounts] = (pCountsFormat == VariableByteArray::FusedFormat);
+    mHeader.fingerprint = 0;
+    writeHeader();
+    mFingerprint.push_back(pK);
 }
 
 
-Graph::Builder::Builder(uint64_t pK, const string& pBaseName, FileFactory& pFactory, D pD, bool pAsymmetric)
-    : mBaseName(pBaseName), mFactory(pFactory), mK(pK),
-      mEdgesBuilder(pBaseName + "-edges", pFactory, pD.value()),
-      mEdgesBuilderBackground(mEdgesBuilder, 4096, 1024),
-      mCountsBuilder(pBaseName + "-counts", pFactory, 1024ULL * 1024ULL * 1024ULL, 1.0 / 1024.0),
-      mCountsBuilderBackground(mCountsBuilder, 4096, 1024)
+Graph::Builder::Builder(uint64_t pK, const string& pBaseName, FileFactory& pFactory, D pD, bool pAsymmetric,
+                        VariableByteArray::Format pCountsFormat)
+    : mBaseName(pBaseName), mFactory(pFactory), mK(pK), mRetune(false),
+      mEdgesBuilder(new SparseArray::Builder(pBaseName + "-edges", pFactory, pD.value())),
+      mEdgesBuilderBackground(new BackgroundBlockConsumer<SparseArray::Builder>(*mEdgesBuilder, 4096, 1024)),
+      mCountsBuilder(new VariableByteArray::Builder(pBaseName + "-counts", pFactory, 1024ULL * 1024ULL * 1024ULL,
+                                                    1.0 / 1024.0, pCountsFormat)),
+      mCountsBuilderBackground(new BackgroundBlockConsumer<VariableByteArray::Builder>(*mCountsBuilder, 4096, 1024))
 {
     if (pK > MaxK)
     {
@@ -182,22 +239,21 @@ Graph::Builder::Builder(uint64_t pK, const string& pBaseName, FileFactory& pFact
                                                     + lexical_cast<string>(pK)));
     }
 
-    Header h;
-    h.version = version;
-    h.K = pK;
-    h.flags[Header::fAsymmetric] = pAsymmetric;
-
-    FileFactory::OutHolderPtr op(pFactory.out(pBaseName + ".header"));
-    ostream& o(**op);
-    o.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    mHeader.version = version;
+    mHeader.K = pK;
+    mHeader.flags[Header::fAsymmetric] = pAsymmetric;
+    mHeader.flags[Header::fFusedCounts] = (pCountsFormat == VariableByteArray::FusedFormat);
+    mHeader.fingerprint = 0;
+    writeHeader();
+    mFingerprint.push_back(pK);
 }
 
 Graph::LazyIterator::LazyIterator(const string& pBaseName, FileFactory& pFactory)
-    : mCount(0),
+    : mHeader(getAndVerifyHeader(pBaseName, pFactory)),
+      mCount(0),
       mEdgesItr(SparseArray::lazyIterator(pBaseName + "-edges", pFactory)),
-      mCountsItr(VariableByteArray::lazyIterator(pBaseName + "-counts", pFactory))
+      mCountsItr(VariableByteArray::lazyIterator(pBaseName + "-counts", pFactory, ::countsFormat(mHeader)))
 {
-    getAndVerifyHeader(pBaseName, pFactory, mHeader);
 
     // Parse X-counts-hist.txt to determine count.
     FileFactory::InHolderPtr ip(pFactory.in(pBaseName + "-counts-hist.txt"));
@@ -342,6 +398,25 @@ Graph::remove(const dynamic_bitset<>& pBitmap)
 }
 
 
+uint64_t
+Graph::fingerprint() const
+{
+    if (mHeader.version == version)
+    {
+        return mHeader.fingerprint;
+    }
+
+    // Older graphs have none saved, so take it as Builder would.
+    Fingerprint f;
+    f.push_back(K());
+    for (Iterator i(*this); i.valid(); ++i)
+    {
+        f.push_back((*i).first.value());
+        f.push_back((*i).second);
+    }
+    return f.value();
+}
+
 map<uint64_t,uint64_t>
 Graph::hist(const string& pBaseName, FileFactory& pFactory)
 {
@@ -363,6 +438,24 @@ Graph::hist(const string& pBaseName, FileFactory& pFactory)
     return r;
 }
 
+GraphStats
+Graph::stats(const string& pBaseName, FileFactory& pFactory, uint64_t pNumThreads)
+{
+    if (GraphStats::exists(pBaseName, pFactory))
+    {
+        return GraphStats::read(pBaseName, pFactory);
+    }
+    GraphPtr g(Graph::open(pBaseName, pFactory));
+    return GraphStats::compute(*g, pNumThreads);
+}
+
+void
+Graph::saveStats(const string& pBaseName, FileFactory& pFactory, uint64_t pNumThreads)
+{
+    GraphPtr g(Graph::open(pBaseName, pFactory));
+    GraphStats::compute(*g, pNumThreads).write(pBaseName, pFactory);
+}
+
 GraphPtr
 Graph::open(const string& pBaseName, FileFactory& pFactory)
 {
@@ -380,18 +473,20 @@ Graph::open(const string& pBaseName, FileFactory& pFactory)
 void
 Graph::remove(const string& pBaseName, FileFactory& pFactory)
 {
+    const Header h(getAndVerifyHeader(pBaseName, pFactory));
     pFactory.remove(pBaseName + ".header");
     pFactory.remove(pBaseName + "-counts-hist.txt");
+    GraphStats::remove(pBaseName, pFactory);
     SparseArray::remove(pBaseName + "-edges", pFactory);
-    VariableByteArray::remove(pBaseName + "-counts", pFactory);
+    VariableByteArray::remove(pBaseName + "-counts", pFactory, ::countsFormat(h));
 }
 
 Graph::Graph(const string& pBaseName, FileFactory& pFactory)
-    : mEdges(pBaseName + "-edges", pFactory),
+    : mHeader(getAndVerifyHeader(pBaseName, pFactory)),
+      mEdges(pBaseName + "-edges", pFactory),
       mEdgesView(mEdges),
-      mCounts(pBaseName + "-counts", pFactory)
+      mCounts(pBaseName + "-counts", pFactory, ::countsFormat(mHeader))
 {
-    getAndVerifyHeader(pBaseName, pFactory, mHeader);
     mM = (position_type(1) << (2 * K())) - 1;
 
     if (dumpOnOpen.on())
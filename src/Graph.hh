@@ -17,6 +17,10 @@
 #include "FileFactory.hh"
 #endif
 
+#ifndef FINGERPRINT_HH
+#include "Fingerprint.hh"
+#endif
+
 #ifndef SPARSEARRAY_HH
 #include "SparseArray.hh"
 #endif
@@ -41,6 +45,10 @@
 #include "Properties.hh"
 #endif
 
+#ifndef GRAPHSTATS_HH
+#include "GraphStats.hh"
+#endif
+
 #ifndef BOOST_DYNAMIC_BITSET_HPP
 #include <boost/dynamic_bitset.hpp>
 #define BOOST_DYNAMIC_BITSET_HPP
@@ -56,14 +64,25 @@
 #define STD_BITSET
 #endif
 
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
+#ifndef STD_MEMORY
+#include <memory>
+#define STD_MEMORY
+#endif
+
 class Graph;
 typedef boost::shared_ptr<Graph> GraphPtr;
 
 class Graph : public GraphEssentials<Graph>
 {
 public:
-    static const uint64_t version = 2011101014ULL; 
+    static const uint64_t version = 2016122101ULL; 
     // Version history
+    // 2016122101   - record a fingerprint of the edges and counts
     // 2011101014   - allow asymmetric graphs
     // 2011091601   - use SparseArrayView
     // 2011071101   - use SparseArray for VariableByteArray
@@ -77,11 +96,17 @@ public:
 
         enum {
             fAsymmetric = 0,
+            fFusedCounts = 1,
             fLastFlag = 64
         };
         std::bitset<fLastFlag> flags;
+        uint64_t fingerprint;
     };
 
+    // Graphs of this version, which have no fingerprint, can still be
+    // read.
+    static const uint64_t unfingerprintedVersion = 2011101014ULL;
+
     class Iterator;
 
     // Largest k-mer size that will work for 128-bit words.
@@ -100,29 +125,49 @@ public:
 
         void push_back(const Gossamer::position_type& pEdge, uint64_t pCount)
         {
-            mEdgesBuilderBackground.push_back(pEdge);
-            mCountsBuilderBackground.push_back(pCount);
+            mEdgesBuilderBackground->push_back(pEdge);
+            mCountsBuilderBackground->push_back(pCount);
+            mFingerprint.push_back(pEdge);
+            mFingerprint.push_back(pCount);
             ++mHist[pCount];
         }
 
+        // Finish writing the graph. If the graph was built for a number
+        // of edges, and has far more or fewer, its edges are rebuilt to
+        // suit (see SparseArray::retune), with a D which makes rank as
+        // fast as it can be for at most EdgesSpaceBudget more space.
+        // Any statistics saved for an earlier graph of the same name
+        // are removed.
+        //
         void end();
 
+        static constexpr double EdgesSpaceBudget = 0.05;
+
         /**
          * Retrieve information about the buidler.
          */
         PropertyTree stat() const;
 
-        Builder(uint64_t pK, const std::string& pBaseName, FileFactory& pFactory, Gossamer::rank_type pNumEdges, bool pAsymmetric = false);
-        Builder(uint64_t pK, const std::string& pBaseName, FileFactory& pFactory, D pD, bool pAsymmetric = false);
+        Builder(uint64_t pK, const std::string& pBaseName, FileFactory& pFactory, Gossamer::rank_type pNumEdges, bool pAsymmetric = false,
+                VariableByteArray::Format pCountsFormat = VariableByteArray::LayeredFormat);
+        Builder(uint64_t pK, const std::string& pBaseName, FileFactory& pFactory, D pD, bool pAsymmetric = false,
+                VariableByteArray::Format pCountsFormat = VariableByteArray::LayeredFormat);
 
     private:
+        void writeHeader();
+
         const std::string mBaseName;
         FileFactory& mFactory;
         uint64_t mK;
-        SparseArray::Builder mEdgesBuilder;
-        BackgroundBlockConsumer<SparseArray::Builder> mEdgesBuilderBackground;
-        VariableByteArray::Builder mCountsBuilder;
-        BackgroundBlockConsumer<VariableByteArray::Builder> mCountsBuilderBackground;
+        const bool mRetune;
+        Header mHeader;
+        Fingerprint mFingerprint;
+        // These are released by end(), so that the finished graph can
+        // be opened to compute its statistics.
+        std::unique_ptr<SparseArray::Builder> mEdgesBuilder;
+        std::unique_ptr<BackgroundBlockConsumer<SparseArray::Builder> > mEdgesBuilderBackground;
+        std::unique_ptr<VariableByteArray::Builder> mCountsBuilder;
+        std::unique_ptr<BackgroundBlockConsumer<VariableByteArray::Builder> > mCountsBuilderBackground;
         std::map<uint64_t,uint64_t> mHist;
     };
 
@@ -309,6 +354,15 @@ public:
             return mHeader.flags[Header::fAsymmetric];
         }
 
+        /**
+         * Return the layout used for the edge counts.
+         */
+        VariableByteArray::Format countsFormat() const
+        {
+            return mHeader.flags[Header::fFusedCounts]
+                    ? VariableByteArray::FusedFormat : VariableByteArray::LayeredFormat;
+        }
+
         /**
          * Return the k-mer size for the graph being iterated over.
          */
@@ -368,6 +422,13 @@ public:
         return mHeader.flags[Header::fAsymmetric];
     }
 
+    // The layout used for the edge counts.
+    //
+    VariableByteArray::Format countsFormat() const
+    {
+        return mCounts.format();
+    }
+
     // The number of edges in the graph.
     //
     Gossamer::rank_type count() const
@@ -375,6 +436,12 @@ public:
         return mEdgesView.count();
     }
 
+    // A fingerprint of all the graph's edges and their counts, taken
+    // as it was built, for checking that something derived from the
+    // graph is still up to date.
+    //
+    uint64_t fingerprint() const;
+
     // Return the number of edges that occur before the
     // given edge in the sorted list of edges.
     //
@@ -609,6 +676,21 @@ public:
      */
     static std::map<uint64_t,uint64_t> hist(const std::string& pBaseName, FileFactory& pFactory);
 
+    /**
+     * Return the structural statistics of the graph, as saved by
+     * saveStats(). For graphs without them, they are computed afresh.
+     */
+    static GraphStats stats(const std::string& pBaseName, FileFactory& pFactory,
+                            uint64_t pNumThreads = 1);
+
+    /**
+     * Compute the structural statistics of a finished graph using
+     * pNumThreads threads, and save them beside it. The commands that
+     * publish a graph do this; intermediate graphs go without.
+     */
+    static void saveStats(const std::string& pBaseName, FileFactory& pFactory,
+                          uint64_t pNumThreads = 1);
+
     static GraphPtr open(const std::string& pBaseName, FileFactory& pFactory);
 
     static void remove(const std::string& pBaseName, FileFactory& pFactory);
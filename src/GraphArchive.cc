@@ -0,0 +1,567 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "GraphArchive.hh"
+
+#include "BoundedQueue.hh"
+#include "EdgeAndCount.hh"
+#include "GossamerException.hh"
+#include "Graph.hh"
+#include "OrderedWriter.hh"
+#include "ThreadGroup.hh"
+
+#include <condition_variable>
+#include <exception>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include <string.h>
+#include <zlib.h>
+#include <boost/lexical_cast.hpp>
+
+using namespace boost;
+using namespace std;
+using namespace Gossamer;
+
+const uint64_t GraphArchive::version;
+const uint64_t GraphArchive::blockEdges;
+
+namespace // anonymous
+{
+    const char headerMagic[8] = { 'G', 'O', 'S', 'S', 'G', 'R', 'P', 'H' };
+    const char indexMagic[8] = { 'G', 'O', 'S', 'S', 'I', 'N', 'D', 'X' };
+
+    const uint64_t edgeWords = sizeof(position_type::value_type) / sizeof(uint64_t);
+
+    // The flags of a graph header which are kept in an archive.
+    const uint64_t archivedFlags = (1ULL << Graph::Header::fAsymmetric)
+                                 | (1ULL << Graph::Header::fFusedCounts);
+
+    void put64(string& pOut, uint64_t pVal)
+    {
+        for (uint64_t i = 0; i < 8; ++i)
+        {
+            pOut.push_back(static_cast<char>((pVal >> (8 * i)) & 0xff));
+        }
+    }
+
+    uint64_t get64(const char* pIn)
+    {
+        uint64_t x = 0;
+        for (uint64_t i = 0; i < 8; ++i)
+        {
+            x |= uint64_t(static_cast<uint8_t>(pIn[i])) << (8 * i);
+        }
+        return x;
+    }
+
+    void putEdge(string& pOut, const position_type& pEdge)
+    {
+        const position_type::value_type v(pEdge.value());
+        pair<const uint64_t*,const uint64_t*> ws(v.words());
+        for (const uint64_t* i = ws.first; i != ws.second; ++i)
+        {
+            put64(pOut, *i);
+        }
+    }
+
+    uint64_t checksum(const string& pBytes)
+    {
+        return crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(pBytes.data()), pBytes.size());
+    }
+
+    void corrupt(const string& pInName, const string& pMsg)
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << errinfo_file_name(pInName)
+                << Gossamer::general_error_info(pMsg));
+    }
+
+    // Read exactly pN bytes, or complain.
+    void readBytes(istream& pIn, const string& pInName, uint64_t pN, string& pBytes)
+    {
+        pBytes.resize(pN);
+        pIn.read(&pBytes[0], pN);
+        if (static_cast<uint64_t>(pIn.gcount()) != pN)
+        {
+            corrupt(pInName, "unexpected end of graph archive");
+        }
+    }
+
+    // The number of bytes left in pIn, or the largest uint64_t if the
+    // stream can't tell (e.g. if it is a pipe).
+    uint64_t remainingBytes(istream& pIn)
+    {
+        const uint64_t unknown = std::numeric_limits<uint64_t>::max();
+        try
+        {
+            const istream::pos_type p = pIn.tellg();
+            if (p == istream::pos_type(-1))
+            {
+                pIn.clear();
+                return unknown;
+            }
+            pIn.seekg(0, ios_base::end);
+            const istream::pos_type e = pIn.tellg();
+            pIn.seekg(p);
+            if (e == istream::pos_type(-1) || !pIn.good() || e < p)
+            {
+                pIn.clear();
+                pIn.seekg(p);
+                return unknown;
+            }
+            return static_cast<uint64_t>(e - p);
+        }
+        catch (const std::exception&)
+        {
+            pIn.clear();
+            return unknown;
+        }
+    }
+
+    // The most bytes EdgeAndCountCodec takes for one edge.
+    const uint64_t maxEdgeBytes = sizeof(EdgeAndCount) * 9 / 8 + 1;
+
+    // The largest number of edges per block that read() accepts.
+    const uint64_t maxBlockEdges = 1ULL << 24;
+
+    struct Block
+    {
+        uint64_t seq;
+        vector<EdgeAndCount> edges;
+        string bytes;
+        uint64_t rawSize;
+        uint64_t crc;
+    };
+    typedef std::shared_ptr<Block> BlockPtr;
+
+    const uint64_t blockHeaderSize = 4 * 8;
+
+    void encode(Block& pBlock)
+    {
+        ostringstream raw;
+        position_type prev(0);
+        for (uint64_t i = 0; i < pBlock.edges.size(); ++i)
+        {
+            EdgeAndCountCodec::encode(raw, prev, pBlock.edges[i]);
+            prev = pBlock.edges[i].first;
+        }
+        const string r(raw.str());
+        pBlock.rawSize = r.size();
+
+        uLongf len = compressBound(r.size());
+        pBlock.bytes.resize(len);
+        if (compress2(reinterpret_cast<Bytef*>(&pBlock.bytes[0]), &len,
+                      reinterpret_cast<const Bytef*>(r.data()), r.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+        {
+            BOOST_THROW_EXCEPTION(
+                Gossamer::error()
+                    << Gossamer::general_error_info("graph archive block compression failed"));
+        }
+        pBlock.bytes.resize(len);
+        pBlock.crc = checksum(pBlock.bytes);
+    }
+
+    void decode(Block& pBlock, uint64_t pNumEdges, const string& pInName)
+    {
+        const string where(" in block " + lexical_cast<string>(pBlock.seq) + " of graph archive");
+        if (checksum(pBlock.bytes) != pBlock.crc)
+        {
+            corrupt(pInName, "checksum mismatch" + where);
+        }
+        string r(pBlock.rawSize, '\0');
+        uLongf len = r.size();
+        if (uncompress(reinterpret_cast<Bytef*>(&r[0]), &len,
+                       reinterpret_cast<const Bytef*>(pBlock.bytes.data()), pBlock.bytes.size()) != Z_OK
+            || len != r.size())
+        {
+            corrupt(pInName, "bad compressed data" + where);
+        }
+        string().swap(pBlock.bytes);
+
+        istringstream raw(r);
+        EdgeAndCount e(position_type(0), 0);
+        pBlock.edges.resize(pNumEdges);
+        for (uint64_t i = 0; i < pNumEdges; ++i)
+        {
+            EdgeAndCountCodec::decode(raw, e);
+            pBlock.edges[i] = e;
+        }
+        if (raw.peek() != EOF)
+        {
+            corrupt(pInName, "bad edge data" + where);
+        }
+    }
+
+    // The first exception raised by any of a group of threads.
+    class FirstError
+    {
+    public:
+        void set()
+        {
+            unique_lock<mutex> lk(mMutex);
+            if (!mError)
+            {
+                mError = std::current_exception();
+            }
+        }
+
+        bool failed()
+        {
+            unique_lock<mutex> lk(mMutex);
+            return static_cast<bool>(mError);
+        }
+
+        void rethrow()
+        {
+            if (mError)
+            {
+                std::rethrow_exception(mError);
+            }
+        }
+
+    private:
+        mutex mMutex;
+        std::exception_ptr mError;
+    };
+} // namespace anonymous
+
+bool
+GraphArchive::isArchive(istream& pIn)
+{
+    return pIn.peek() == headerMagic[0];
+}
+
+void
+GraphArchive::write(const string& pGraphName, FileFactory& pFactory, ostream& pOut, uint64_t pNumThreads)
+{
+    Graph::LazyIterator itr(pGraphName, pFactory);
+    const uint64_t n = itr.count();
+    const uint64_t numBlocks = (n + blockEdges - 1) / blockEdges;
+
+    uint64_t flags = 0;
+    if (itr.asymmetric())
+    {
+        flags |= 1ULL << Graph::Header::fAsymmetric;
+    }
+    if (itr.countsFormat() == VariableByteArray::FusedFormat)
+    {
+        flags |= 1ULL << Graph::Header::fFusedCounts;
+    }
+
+    string hdr(headerMagic, sizeof(headerMagic));
+    put64(hdr, version);
+    put64(hdr, itr.K());
+    put64(hdr, flags);
+    put64(hdr, n);
+    put64(hdr, blockEdges);
+    put64(hdr, edgeWords);
+    put64(hdr, 0);
+    pOut.write(hdr.data(), hdr.size());
+
+    // Blocks are encoded on the worker threads, and written in order.
+    vector<uint64_t> sizes(numBlocks);
+    vector<uint64_t> crcs(numBlocks);
+    vector<position_type> firsts(numBlocks);
+    {
+        const uint64_t t = std::max<uint64_t>(1, pNumThreads);
+        BoundedQueue<BlockPtr> q(2 * t);
+        OrderedWriter w(pOut, true);
+        FirstError err;
+        ThreadGroup grp;
+        for (uint64_t i = 0; i < t; ++i)
+        {
+            grp.create([&] () {
+                BlockPtr b;
+                while (q.get(b))
+                {
+                    if (err.failed())
+                    {
+                        continue;
+                    }
+                    try
+                    {
+                        encode(*b);
+                        sizes[b->seq] = b->bytes.size();
+                        crcs[b->seq] = b->crc;
+                        string s;
+                        put64(s, b->edges.size());
+                        put64(s, b->rawSize);
+                        put64(s, b->bytes.size());
+                        put64(s, b->crc);
+                        s += b->bytes;
+                        w.write(b->seq, s);
+                    }
+                    catch (...)
+                    {
+                        err.set();
+                    }
+                }
+            });
+        }
+
+        try
+        {
+            for (uint64_t s = 0; s < numBlocks && !err.failed(); ++s)
+            {
+                BlockPtr b = std::make_shared<Block>();
+                b->seq = s;
+                b->edges.reserve(blockEdges);
+                for (; itr.valid() && b->edges.size() < blockEdges; ++itr)
+                {
+                    pair<Graph::Edge,uint32_t> e(*itr);
+                    b->edges.push_back(EdgeAndCount(e.first.value(), e.second));
+                }
+                firsts[s] = b->edges.front().first;
+                q.put(b);
+            }
+        }
+        catch (...)
+        {
+            err.set();
+        }
+        q.finish();
+        grp.join();
+        err.rethrow();
+    }
+
+    string idx(indexMagic, sizeof(indexMagic));
+    put64(idx, numBlocks);
+    uint64_t offset = hdr.size();
+    for (uint64_t s = 0; s < numBlocks; ++s)
+    {
+        put64(idx, offset);
+        put64(idx, std::min(blockEdges, n - s * blockEdges));
+        put64(idx, sizes[s]);
+        put64(idx, crcs[s]);
+        putEdge(idx, firsts[s]);
+        offset += blockHeaderSize + sizes[s];
+    }
+    put64(idx, checksum(idx));
+    pOut.write(idx.data(), idx.size());
+    pOut.flush();
+}
+
+void
+GraphArchive::read(istream& pIn, const string& pInName, const string& pGraphName,
+                   FileFactory& pFactory, uint64_t pNumThreads)
+{
+    string hdr;
+    readBytes(pIn, pInName, sizeof(headerMagic) + 7 * 8, hdr);
+    if (memcmp(hdr.data(), headerMagic, sizeof(headerMagic)) != 0)
+    {
+        corrupt(pInName, "not a graph archive");
+    }
+    const char* h = hdr.data() + sizeof(headerMagic);
+    const uint64_t v = get64(h);
+    if (v != version)
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << errinfo_file_name(pInName)
+                << Gossamer::version_mismatch_info(make_pair(version, v)));
+    }
+    const uint64_t k = get64(h + 8);
+    const uint64_t flags = get64(h + 16);
+    const uint64_t n = get64(h + 24);
+    const uint64_t be = get64(h + 32);
+    if (get64(h + 40) != edgeWords || (flags & ~archivedFlags) || be == 0 || be > maxBlockEdges
+        || k > Graph::MaxK)
+    {
+        corrupt(pInName, "unsupported graph archive");
+    }
+
+    // Every block takes at least a block header and an index entry, so
+    // if the stream knows its length, that bounds the number of blocks.
+    const uint64_t entrySize = (4 + edgeWords) * 8;
+    const uint64_t left = remainingBytes(pIn);
+    const uint64_t numBlocks = n / be + (n % be != 0);
+    if (left != std::numeric_limits<uint64_t>::max())
+    {
+        // The index magic, the number of blocks, and the index checksum.
+        const uint64_t fixed = sizeof(indexMagic) + 2 * 8;
+        if (left < fixed || numBlocks > (left - fixed) / (blockHeaderSize + entrySize))
+        {
+            corrupt(pInName, "graph archive is truncated");
+        }
+    }
+    const bool asymmetric = flags & (1ULL << Graph::Header::fAsymmetric);
+    const VariableByteArray::Format countsFormat = (flags & (1ULL << Graph::Header::fFusedCounts))
+                                                    ? VariableByteArray::FusedFormat
+                                                    : VariableByteArray::LayeredFormat;
+
+    Graph::Builder bld(k, pGraphName, pFactory, n, asymmetric, countsFormat);
+
+    // One thread reads the blocks and the workers decode them. Decoded
+    // blocks are passed to the builder in order, and the workers wait
+    // rather than get too far ahead of it.
+    const uint64_t t = std::max<uint64_t>(1, pNumThreads);
+    const uint64_t window = 4 * t;
+    BoundedQueue<BlockPtr> q(2 * t);
+    FirstError err;
+    mutex mtx;
+    condition_variable cond;
+    map<uint64_t,BlockPtr> done;
+    uint64_t next = 0;
+    vector<uint64_t> offsets(numBlocks);
+    vector<uint64_t> sizes(numBlocks);
+    vector<uint64_t> crcs(numBlocks);
+    vector<position_type> firsts(numBlocks, position_type(0));
+
+    ThreadGroup grp;
+    grp.create([&] () {
+        try
+        {
+            string bh;
+            uint64_t offset = hdr.size();
+            uint64_t rest = left;
+            for (uint64_t s = 0; s < numBlocks && !err.failed(); ++s)
+            {
+                readBytes(pIn, pInName, blockHeaderSize, bh);
+                rest -= std::min(rest, blockHeaderSize);
+                BlockPtr b = std::make_shared<Block>();
+                b->seq = s;
+                const uint64_t m = std::min(be, n - s * be);
+                const uint64_t z = get64(bh.data() + 16);
+                b->rawSize = get64(bh.data() + 8);
+                b->crc = get64(bh.data() + 24);
+                if (get64(bh.data()) != m || b->rawSize > m * maxEdgeBytes
+                    || z > compressBound(b->rawSize))
+                {
+                    corrupt(pInName, "bad block header in graph archive");
+                }
+                if (z > rest)
+                {
+                    corrupt(pInName, "unexpected end of graph archive");
+                }
+                readBytes(pIn, pInName, z, b->bytes);
+                rest -= std::min(rest, z);
+                offsets[s] = offset;
+                sizes[s] = z;
+                crcs[s] = b->crc;
+                offset += blockHeaderSize + z;
+                q.put(b);
+            }
+        }
+        catch (...)
+        {
+            err.set();
+        }
+        q.finish();
+    });
+    for (uint64_t i = 0; i < t; ++i)
+    {
+        grp.create([&] () {
+            BlockPtr b;
+            while (q.get(b))
+            {
+                if (err.failed())
+                {
+                    continue;
+                }
+                try
+                {
+                    decode(*b, std::min(be, n - b->seq * be), pInName);
+                }
+                catch (...)
+                {
+                    err.set();
+                }
+                unique_lock<mutex> lk(mtx);
+                while (b->seq >= next + window && !err.failed())
+                {
+                    cond.wait(lk);
+                }
+                done[b->seq] = b;
+                cond.notify_all();
+            }
+        });
+    }
+
+    position_type prev(0);
+    try
+    {
+        for (uint64_t s = 0; s < numBlocks; ++s)
+        {
+            BlockPtr b;
+            {
+                unique_lock<mutex> lk(mtx);
+                while (!err.failed() && done.find(s) == done.end())
+                {
+                    cond.wait_for(lk, std::chrono::milliseconds(100));
+                }
+                if (err.failed())
+                {
+                    break;
+                }
+                b = done[s];
+                done.erase(s);
+                next = s + 1;
+                cond.notify_all();
+            }
+            firsts[s] = b->edges.front().first;
+            for (uint64_t i = 0; i < b->edges.size(); ++i)
+            {
+                const EdgeAndCount& e(b->edges[i]);
+                if ((s || i) && !(prev < e.first))
+                {
+                    corrupt(pInName, "edges out of order in graph archive");
+                }
+                bld.push_back(e.first, e.second);
+                prev = e.first;
+            }
+        }
+    }
+    catch (...)
+    {
+        err.set();
+    }
+    {
+        unique_lock<mutex> lk(mtx);
+        cond.notify_all();
+    }
+    grp.join();
+    err.rethrow();
+
+    // Check the index against the blocks.
+    string idx;
+    readBytes(pIn, pInName, sizeof(indexMagic) + 8, idx);
+    if (memcmp(idx.data(), indexMagic, sizeof(indexMagic)) != 0
+        || get64(idx.data() + sizeof(indexMagic)) != numBlocks)
+    {
+        corrupt(pInName, "bad graph archive index");
+    }
+    string entries;
+    readBytes(pIn, pInName, numBlocks * entrySize, entries);
+    idx += entries;
+    string crc;
+    readBytes(pIn, pInName, 8, crc);
+    if (get64(crc.data()) != checksum(idx))
+    {
+        corrupt(pInName, "checksum mismatch in graph archive index");
+    }
+    const char* e = entries.data();
+    string first;
+    for (uint64_t s = 0; s < numBlocks; ++s, e += entrySize)
+    {
+        first.clear();
+        putEdge(first, firsts[s]);
+        if (get64(e) != offsets[s] || get64(e + 8) != std::min(be, n - s * be)
+            || get64(e + 16) != sizes[s] || get64(e + 24) != crcs[s]
+            || memcmp(e + 32, first.data(), first.size()) != 0)
+        {
+            corrupt(pInName, "graph archive index does not match block "
+                                + lexical_cast<string>(s));
+        }
+    }
+
+    bld.end();
+}
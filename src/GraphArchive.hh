@@ -0,0 +1,67 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef GRAPHARCHIVE_HH
+#define GRAPHARCHIVE_HH
+
+#ifndef FILEFACTORY_HH
+#include "FileFactory.hh"
+#endif
+
+#ifndef STD_ISTREAM
+#include <istream>
+#define STD_ISTREAM
+#endif
+
+#ifndef STD_OSTREAM
+#include <ostream>
+#define STD_OSTREAM
+#endif
+
+#ifndef STD_STRING
+#include <string>
+#define STD_STRING
+#endif
+
+// A portable binary container for a graph, for moving and archiving
+// graphs as a single file.
+//
+// The edges are cut into blocks of blockEdges edges, each of which is
+// delta coded with EdgeAndCountCodec and deflated on its own, so that
+// blocks are encoded and decoded in parallel. Each block carries a
+// CRC32 of its compressed bytes, and an index of the blocks, giving
+// their offsets, sizes, checksums and first edges, follows the last
+// block. All integers are little-endian.
+//
+// The archive is written and read front to back, so it may be piped.
+//
+class GraphArchive
+{
+public:
+    static const uint64_t version = 2016121201ULL;
+    // Version history
+    // 2016121201   - initial version
+
+    static const uint64_t blockEdges = 65536;
+
+    // True if the stream looks like it starts with an archive, rather
+    // than the text written by dump-graph.
+    static bool isArchive(std::istream& pIn);
+
+    // Write the graph pGraphName to pOut, using pNumThreads threads.
+    static void write(const std::string& pGraphName, FileFactory& pFactory,
+                      std::ostream& pOut, uint64_t pNumThreads);
+
+    // Build the graph pGraphName from the archive in pIn, using
+    // pNumThreads threads. pInName names pIn in errors.
+    static void read(std::istream& pIn, const std::string& pInName,
+                     const std::string& pGraphName, FileFactory& pFactory,
+                     uint64_t pNumThreads);
+};
+
+#endif // GRAPHARCHIVE_HH
@@ -0,0 +1,406 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "GraphStats.hh"
+
+#include "GossamerException.hh"
+#include "Graph.hh"
+#include "ThreadGroup.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using namespace Gossamer;
+using namespace std;
+
+constexpr uint64_t GraphStats::version;
+const uint64_t GraphStats::MaxDegree;
+
+namespace // anonymous
+{
+    // A bitmap which several threads may set bits in at once.
+    class SharedBitmap
+    {
+    public:
+        bool operator[](uint64_t pIdx) const
+        {
+            return (mWords[pIdx / 64].load(memory_order_relaxed) >> (pIdx % 64)) & 1;
+        }
+
+        void set(uint64_t pIdx)
+        {
+            mWords[pIdx / 64].fetch_or(1ULL << (pIdx % 64), memory_order_relaxed);
+        }
+
+        SharedBitmap(uint64_t pSize)
+            : mWords(new atomic<uint64_t>[pSize / 64 + 1])
+        {
+            for (uint64_t i = 0; i <= pSize / 64; ++i)
+            {
+                mWords[i] = 0;
+            }
+        }
+
+    private:
+        unique_ptr<atomic<uint64_t>[]> mWords;
+    };
+
+    bool simple(const Graph& pGraph, const Graph::Node& pNode, rank_type& pOut)
+    {
+        pair<rank_type,rank_type> r = pGraph.beginEndRank(pNode);
+        if (r.second - r.first != 1 || pGraph.inDegree(pNode) != 1)
+        {
+            return false;
+        }
+        pOut = r.first;
+        return true;
+    }
+
+    void writeWord(ostream& pOut, uint64_t pVal)
+    {
+        pOut.write(reinterpret_cast<const char*>(&pVal), sizeof(pVal));
+    }
+
+    uint64_t readWord(istream& pIn)
+    {
+        uint64_t x = 0;
+        pIn.read(reinterpret_cast<char*>(&x), sizeof(x));
+        return x;
+    }
+} // namespace anonymous
+
+uint64_t
+GraphStats::branchingNodes() const
+{
+    uint64_t n = 0;
+    for (uint64_t i = 0; i <= MaxDegree; ++i)
+    {
+        for (uint64_t j = 0; j <= MaxDegree; ++j)
+        {
+            if (i > 1 || j > 1)
+            {
+                n += degrees[i][j];
+            }
+        }
+    }
+    return n;
+}
+
+uint64_t
+GraphStats::tipNodes() const
+{
+    return degrees[0][1] + degrees[1][0];
+}
+
+map<uint64_t,uint64_t>
+GraphStats::inDegrees() const
+{
+    map<uint64_t,uint64_t> h;
+    for (uint64_t i = 0; i <= MaxDegree; ++i)
+    {
+        for (uint64_t j = 0; j <= MaxDegree; ++j)
+        {
+            h[i] += degrees[i][j];
+        }
+    }
+    return h;
+}
+
+map<uint64_t,uint64_t>
+GraphStats::outDegrees() const
+{
+    map<uint64_t,uint64_t> h;
+    for (uint64_t i = 0; i <= MaxDegree; ++i)
+    {
+        for (uint64_t j = 0; j <= MaxDegree; ++j)
+        {
+            h[j] += degrees[i][j];
+        }
+    }
+    return h;
+}
+
+GraphStats&
+GraphStats::operator+=(const GraphStats& pRhs)
+{
+    edges += pRhs.edges;
+    nodes += pRhs.nodes;
+    for (uint64_t i = 0; i <= MaxDegree; ++i)
+    {
+        for (uint64_t j = 0; j <= MaxDegree; ++j)
+        {
+            degrees[i][j] += pRhs.degrees[i][j];
+        }
+    }
+    rcEdges += pRhs.rcEdges;
+    palindromicEdges += pRhs.palindromicEdges;
+    unitigs += pRhs.unitigs;
+    cycles += pRhs.cycles;
+    for (map<uint64_t,uint64_t>::const_iterator i = pRhs.unitigLengths.begin();
+            i != pRhs.unitigLengths.end(); ++i)
+    {
+        unitigLengths[i->first] += i->second;
+    }
+    return *this;
+}
+
+PropertyTree
+GraphStats::stat() const
+{
+    PropertyTree t;
+    t.putProp("K", K);
+    t.putProp("edges", edges);
+    t.putProp("nodes", nodes);
+    t.putProp("branching-nodes", branchingNodes());
+    t.putProp("tip-nodes", tipNodes());
+    t.putProp("rc-edges", rcEdges);
+    t.putProp("palindromic-edges", palindromicEdges);
+    t.putProp("unitigs", unitigs);
+    t.putProp("cycles", cycles);
+
+    uint64_t longest = unitigLengths.empty() ? 0 : unitigLengths.rbegin()->first;
+    t.putProp("longest-unitig", longest);
+
+    // The N50 of the unitigs, in edges.
+    uint64_t n50 = 0;
+    uint64_t acc = 0;
+    for (map<uint64_t,uint64_t>::const_reverse_iterator i = unitigLengths.rbegin();
+            i != unitigLengths.rend(); ++i)
+    {
+        acc += i->first * i->second;
+        if (2 * acc >= edges)
+        {
+            n50 = i->first;
+            break;
+        }
+    }
+    t.putProp("unitig-n50", n50);
+
+    PropertyTree in;
+    PropertyTree out;
+    map<uint64_t,uint64_t> ins(inDegrees());
+    map<uint64_t,uint64_t> outs(outDegrees());
+    for (uint64_t i = 0; i <= MaxDegree; ++i)
+    {
+        in.putProp(to_string(i), ins[i]);
+        out.putProp(to_string(i), outs[i]);
+    }
+    t.putSub("in-degrees", in);
+    t.putSub("out-degrees", out);
+    return t;
+}
+
+GraphStats
+GraphStats::compute(const Graph& pGraph, uint64_t pNumThreads)
+{
+    const rank_type n = pGraph.count();
+    pNumThreads = max<uint64_t>(1, pNumThreads);
+
+    // Each unitig is walked from its first edge, which follows a node
+    // that is not simple. Edges left unvisited lie on cycles.
+    SharedBitmap seen(n);
+
+    static const uint64_t chunk = 1ULL << 14;
+    atomic<uint64_t> next(0);
+    vector<GraphStats> parts(pNumThreads);
+    auto work = [&] (uint64_t pThread) {
+        GraphStats& s(parts[pThread]);
+        for (uint64_t b = next.fetch_add(chunk); b < n; b = next.fetch_add(chunk))
+        {
+            const uint64_t e = min<uint64_t>(n, b + chunk);
+            uint64_t i = b;
+            while (i < e)
+            {
+                // Nodes are counted by the chunk holding their first edge.
+                const Graph::Node u(pGraph.from(pGraph.select(i)));
+                const pair<rank_type,rank_type> r(pGraph.beginEndRank(u));
+                if (r.first < b)
+                {
+                    i = r.second;
+                    continue;
+                }
+
+                const uint64_t outDeg = r.second - r.first;
+                const uint64_t inDeg = pGraph.inDegree(u);
+                ++s.nodes;
+                ++s.degrees[inDeg][outDeg];
+
+                // A node with no outgoing edges is counted along with its
+                // reverse complement, which has some.
+                if (inDeg == 0)
+                {
+                    ++s.nodes;
+                    ++s.degrees[outDeg][0];
+                }
+
+                const bool start = !(inDeg == 1 && outDeg == 1);
+                for (rank_type j = r.first; j < r.second; ++j)
+                {
+                    const Graph::Edge x(pGraph.select(j));
+                    const Graph::Edge y(pGraph.reverseComplement(x));
+                    ++s.edges;
+                    s.palindromicEdges += (x == y);
+                    s.rcEdges += pGraph.access(y);
+
+                    if (!start)
+                    {
+                        continue;
+                    }
+                    seen.set(j);
+                    uint64_t len = 1;
+                    rank_type k = 0;
+                    for (Graph::Node w(pGraph.to(x)); simple(pGraph, w, k); ++len)
+                    {
+                        seen.set(k);
+                        w = pGraph.to(pGraph.select(k));
+                    }
+                    ++s.unitigs;
+                    ++s.unitigLengths[len];
+                }
+                i = r.second;
+            }
+        }
+    };
+
+    ThreadGroup grp;
+    for (uint64_t t = 1; t < pNumThreads; ++t)
+    {
+        grp.create([&work, t] () { work(t); }, t, pNumThreads);
+    }
+    work(0);
+    grp.join();
+
+    GraphStats s;
+    s.K = pGraph.K();
+    for (uint64_t t = 0; t < pNumThreads; ++t)
+    {
+        s += parts[t];
+    }
+
+    for (rank_type i = 0; i < n; ++i)
+    {
+        if (seen[i])
+        {
+            continue;
+        }
+        uint64_t len = 0;
+        rank_type k = i;
+        do
+        {
+            seen.set(k);
+            ++len;
+            k = pGraph.beginRank(pGraph.to(pGraph.select(k)));
+        }
+        while (k != i);
+        ++s.unitigs;
+        ++s.cycles;
+        ++s.unitigLengths[len];
+    }
+
+    return s;
+}
+
+void
+GraphStats::write(const string& pBaseName, FileFactory& pFactory) const
+{
+    FileFactory::OutHolderPtr op(pFactory.out(pBaseName + "-stats"));
+    ostream& o(**op);
+    writeWord(o, version);
+    writeWord(o, K);
+    writeWord(o, edges);
+    writeWord(o, nodes);
+    for (uint64_t i = 0; i <= MaxDegree; ++i)
+    {
+        for (uint64_t j = 0; j <= MaxDegree; ++j)
+        {
+            writeWord(o, degrees[i][j]);
+        }
+    }
+    writeWord(o, rcEdges);
+    writeWord(o, palindromicEdges);
+    writeWord(o, unitigs);
+    writeWord(o, cycles);
+    writeWord(o, unitigLengths.size());
+    for (map<uint64_t,uint64_t>::const_iterator i = unitigLengths.begin();
+            i != unitigLengths.end(); ++i)
+    {
+        writeWord(o, i->first);
+        writeWord(o, i->second);
+    }
+}
+
+GraphStats
+GraphStats::read(const string& pBaseName, FileFactory& pFactory)
+{
+    const string name(pBaseName + "-stats");
+    FileFactory::InHolderPtr ip(pFactory.in(name));
+    istream& in(**ip);
+
+    const uint64_t v = readWord(in);
+    if (v != version)
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << boost::errinfo_file_name(name)
+                << Gossamer::version_mismatch_info(make_pair(version, v)));
+    }
+
+    GraphStats s;
+    s.K = readWord(in);
+    s.edges = readWord(in);
+    s.nodes = readWord(in);
+    for (uint64_t i = 0; i <= MaxDegree; ++i)
+    {
+        for (uint64_t j = 0; j <= MaxDegree; ++j)
+        {
+            s.degrees[i][j] = readWord(in);
+        }
+    }
+    s.rcEdges = readWord(in);
+    s.palindromicEdges = readWord(in);
+    s.unitigs = readWord(in);
+    s.cycles = readWord(in);
+    const uint64_t z = readWord(in);
+    for (uint64_t i = 0; i < z; ++i)
+    {
+        const uint64_t l = readWord(in);
+        s.unitigLengths[l] = readWord(in);
+    }
+    if (!in.good())
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << boost::errinfo_file_name(name)
+                << Gossamer::general_error_info("Graph statistics are truncated."));
+    }
+    return s;
+}
+
+void
+GraphStats::remove(const string& pBaseName, FileFactory& pFactory)
+{
+    if (exists(pBaseName, pFactory))
+    {
+        pFactory.remove(pBaseName + "-stats");
+    }
+}
+
+GraphStats::GraphStats()
+    : K(0), edges(0), nodes(0), rcEdges(0), palindromicEdges(0),
+      unitigs(0), cycles(0)
+{
+    for (uint64_t i = 0; i <= MaxDegree; ++i)
+    {
+        for (uint64_t j = 0; j <= MaxDegree; ++j)
+        {
+            degrees[i][j] = 0;
+        }
+    }
+}
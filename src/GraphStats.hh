@@ -0,0 +1,101 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef GRAPHSTATS_HH
+#define GRAPHSTATS_HH
+
+#ifndef FILEFACTORY_HH
+#include "FileFactory.hh"
+#endif
+
+#ifndef PROPERTIES_HH
+#include "Properties.hh"
+#endif
+
+#ifndef STD_MAP
+#include <map>
+#define STD_MAP
+#endif
+
+class Graph;
+
+// Structural statistics of a graph: the degree distribution of its
+// nodes, and the number and lengths of its unitigs (maximal paths whose
+// interior nodes have exactly one incoming and one outgoing edge).
+// They are computed when a graph is built, and kept beside it in
+// <graph>-stats so that they can be read back without a scan.
+//
+// As elsewhere, the in-degree of a node is taken to be the out-degree of
+// its reverse complement. Unitigs are directed, so in a symmetric graph
+// each one is counted along with its reverse complement.
+//
+class GraphStats
+{
+public:
+    static constexpr uint64_t version = 2016112101ULL;
+    // Version history
+    // 2016112101   - initial version
+
+    static const uint64_t MaxDegree = 4;
+
+    uint64_t K;
+    uint64_t edges;
+    uint64_t nodes;
+
+    // The number of nodes with each in-degree and out-degree.
+    uint64_t degrees[MaxDegree + 1][MaxDegree + 1];
+
+    // Edges whose reverse complement is also present, and edges
+    // which are their own reverse complement.
+    uint64_t rcEdges;
+    uint64_t palindromicEdges;
+
+    // Unitigs, including cycles, which have no branching node.
+    uint64_t unitigs;
+    uint64_t cycles;
+
+    // The number of unitigs of each length, in edges.
+    std::map<uint64_t,uint64_t> unitigLengths;
+
+    // Nodes with more than one incoming or outgoing edge.
+    uint64_t branchingNodes() const;
+
+    // Nodes with exactly one edge.
+    uint64_t tipNodes() const;
+
+    std::map<uint64_t,uint64_t> inDegrees() const;
+
+    std::map<uint64_t,uint64_t> outDegrees() const;
+
+    bool symmetric() const
+    {
+        return rcEdges == edges;
+    }
+
+    GraphStats& operator+=(const GraphStats& pRhs);
+
+    PropertyTree stat() const;
+
+    // Scan the graph, using pNumThreads threads.
+    static GraphStats compute(const Graph& pGraph, uint64_t pNumThreads = 1);
+
+    void write(const std::string& pBaseName, FileFactory& pFactory) const;
+
+    static GraphStats read(const std::string& pBaseName, FileFactory& pFactory);
+
+    static bool exists(const std::string& pBaseName, FileFactory& pFactory)
+    {
+        return pFactory.exists(pBaseName + "-stats");
+    }
+
+    static void remove(const std::string& pBaseName, FileFactory& pFactory);
+
+    GraphStats();
+};
+
+#endif // GRAPHSTATS_HH
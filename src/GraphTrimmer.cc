@@ -8,6 +8,23 @@
 //
 #include "GraphTrimmer.hh"
 
+void
+GraphTrimmer::apply(const Delta& pDelta)
+{
+    if (pDelta.empty())
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mModified = true;
+    for (auto r : pDelta.mDeletedEdges)
+    {
+        mDeletedEdges[r] = true;
+    }
+}
+
+
 void
 GraphTrimmer::writeTrimmedGraph(Graph::Builder& pBuilder) const
 {
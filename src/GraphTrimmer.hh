@@ -23,9 +23,71 @@
 #define STD_MAP
 #endif
 
+#ifndef STD_SET
+#include <set>
+#define STD_SET
+#endif
+
+#ifndef STD_MUTEX
+#include <mutex>
+#define STD_MUTEX
+#endif
+
 class GraphTrimmer
 {
 public:
+    // A set of deletions made by a single worker thread. A Delta may be
+    // built while other threads read the trimmer, and is folded into it
+    // with GraphTrimmer::apply().
+    class Delta
+    {
+    public:
+        bool empty() const
+        {
+            return mDeletedEdges.empty();
+        }
+
+        bool edgeDeleted(uint64_t pEdgeRank) const
+        {
+            return mDeletedEdges.count(pEdgeRank);
+        }
+
+        void deleteEdge(uint64_t pRank, uint64_t pRankRC)
+        {
+            mDeletedEdges.insert(pRank);
+            mDeletedEdges.insert(pRankRC);
+        }
+
+        void clear()
+        {
+            mDeletedEdges.clear();
+        }
+
+    private:
+        friend class GraphTrimmer;
+
+        std::set<uint64_t> mDeletedEdges;
+    };
+
+    class DeltaTrimVisitor
+    {
+    private:
+        const Graph& mGraph;
+        Delta& mDelta;
+
+    public:
+        DeltaTrimVisitor(const Graph& pGraph, Delta& pDelta)
+            : mGraph(pGraph), mDelta(pDelta)
+        {
+        }
+
+        void operator()(const Graph::Edge& pEdge, const Gossamer::rank_type& pRank)
+        {
+            mDelta.deleteEdge(mGraph.rank(pEdge),
+                              mGraph.rank(mGraph.reverseComplement(pEdge)));
+        }
+    };
+
     class EdgeTrimVisitor
     {
     private:
@@ -90,6 +152,11 @@ public:
         return mDeletedEdges.count();
     }
 
+    // Fold the edits recorded in pDelta into the trimmer.
+    // This may be called concurrently from several threads, but
+    // must not overlap with calls to edgeDeleted().
+    void apply(const Delta& pDelta);
+
     void writeTrimmedGraph(Graph::Builder& pBuilder) const;
 
     GraphTrimmer(const Graph& pGraph)
@@ -103,6 +170,7 @@ private:
     boost::dynamic_bitset<> mDeletedEdges;
     count_map_t mCounts;
     bool mModified;
+    std::mutex mMutex;
 };
 
 
@@ -0,0 +1,303 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "HammingJoin.hh"
+
+#include "BlendedSort.hh"
+#include "GossamerException.hh"
+#include "WorkQueue.hh"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <boost/lexical_cast.hpp>
+
+using namespace boost;
+using namespace std;
+using Gossamer::position_type;
+
+constexpr uint64_t HammingJoin::maxPartitions;
+
+namespace // anonymous
+{
+    // A k-mer's bases outside the masked blocks, and which k-mer it
+    // was: lhs items first, then rhs items, then their reverse
+    // complements.
+    struct Item
+    {
+        position_type key;
+        uint64_t ref;
+    };
+
+    class ItemCmp
+    {
+    public:
+        bool operator()(const Item& pLhs, const Item& pRhs) const
+        {
+            return pLhs.key < pRhs.key;
+        }
+
+        uint64_t radix(const Item& pItem) const
+        {
+            return (pItem.key >> mShift).asUInt64();
+        }
+
+        Item zero() const
+        {
+            return Item();
+        }
+
+        ItemCmp(uint64_t pShift)
+            : mShift(pShift)
+        {
+        }
+
+    private:
+        const uint64_t mShift;
+    };
+
+    // Compare the lhs and rhs items within each run of equal keys over
+    // a range of the sorted items, noting the ones that are near.
+    class ScanBatch
+    {
+    public:
+        void operator()()
+        {
+            vector<uint64_t> lhs;
+            vector<uint64_t> rhs;
+            for (uint64_t b = mBegin; b < mEnd; )
+            {
+                uint64_t e = b + 1;
+                while (e < mEnd && mItems[e].key == mItems[b].key)
+                {
+                    ++e;
+                }
+                if (e - b > 1)
+                {
+                    lhs.clear();
+                    rhs.clear();
+                    for (uint64_t i = b; i < e; ++i)
+                    {
+                        (mItems[i].ref < mLhs.size() ? lhs : rhs).push_back(mItems[i].ref);
+                    }
+                    scanRun(lhs, rhs);
+                }
+                b = e;
+            }
+        }
+
+        ScanBatch(const vector<Item>& pItems, uint64_t pBegin, uint64_t pEnd, uint64_t pDist,
+                  const HammingJoin::Kmers& pLhs, const HammingJoin::Kmers& pRhs, const HammingJoin::Kmers& pRcs,
+                  const dynamic_bitset<>& pLhsNear, const dynamic_bitset<>& pRhsNear)
+            : mItems(pItems), mBegin(pBegin), mEnd(pEnd), mDist(pDist),
+              mLhs(pLhs), mRhs(pRhs), mRcs(pRcs), mLhsNear(pLhsNear), mRhsNear(pRhsNear)
+        {
+        }
+
+        vector<uint64_t> mHits;
+
+    private:
+        void scanRun(const vector<uint64_t>& pLhsRefs, const vector<uint64_t>& pRhsRefs)
+        {
+            for (uint64_t i = 0; i < pLhsRefs.size(); ++i)
+            {
+                const uint64_t l = pLhsRefs[i];
+                for (uint64_t j = 0; j < pRhsRefs.size(); ++j)
+                {
+                    uint64_t r = pRhsRefs[j] - mLhs.size();
+                    const bool rc = r >= mRhs.size();
+                    if (rc)
+                    {
+                        r -= mRhs.size();
+                    }
+                    // Pairs found by an earlier mask needn't be looked at again.
+                    if (mLhsNear[l] && mRhsNear[r])
+                    {
+                        continue;
+                    }
+                    if (HammingJoin::distance(mLhs[l], rc ? mRcs[r] : mRhs[r]) <= mDist)
+                    {
+                        mHits.push_back(l);
+                        mHits.push_back(mLhs.size() + r);
+                    }
+                }
+            }
+        }
+
+        const vector<Item>& mItems;
+        const uint64_t mBegin;
+        const uint64_t mEnd;
+        const uint64_t mDist;
+        const HammingJoin::Kmers& mLhs;
+        const HammingJoin::Kmers& mRhs;
+        const HammingJoin::Kmers& mRcs;
+        const dynamic_bitset<>& mLhsNear;
+        const dynamic_bitset<>& mRhsNear;
+    };
+    typedef std::shared_ptr<ScanBatch> ScanBatchPtr;
+
+    position_type key(const position_type& pKmer, const vector<pair<uint64_t,uint64_t> >& pBlocks,
+                      const vector<position_type>& pMasks, uint64_t pKept)
+    {
+        position_type k;
+        for (uint64_t b = pBlocks.size(); b-- > 0; )
+        {
+            if (pKept & (1ULL << b))
+            {
+                k <<= 2 * pBlocks[b].second;
+                k |= (pKmer >> 2 * pBlocks[b].first) & pMasks[b];
+            }
+        }
+        return k;
+    }
+
+    // Compare the items within each run of equal keys, cut into batches
+    // on run boundaries, and note the near ones.
+    void scan(const vector<Item>& pItems, uint64_t pDist,
+              const HammingJoin::Kmers& pLhs, const HammingJoin::Kmers& pRhs, const HammingJoin::Kmers& pRcs,
+              dynamic_bitset<>& pLhsNear, dynamic_bitset<>& pRhsNear, uint64_t pThreads)
+    {
+        vector<ScanBatchPtr> batches;
+        {
+            const uint64_t numBatches = 16 * max<uint64_t>(pThreads, 1);
+            WorkQueue q(pThreads);
+            uint64_t b = 0;
+            for (uint64_t i = 1; i <= numBatches && b < pItems.size(); ++i)
+            {
+                uint64_t e = max(b, pItems.size() * i / numBatches);
+                while (e > b && e < pItems.size() && pItems[e].key == pItems[e - 1].key)
+                {
+                    ++e;
+                }
+                if (e == b)
+                {
+                    continue;
+                }
+                batches.push_back(ScanBatchPtr(new ScanBatch(pItems, b, e, pDist, pLhs, pRhs, pRcs, pLhsNear, pRhsNear)));
+                q.push_back(std::bind<void>(std::ref(*batches.back())));
+                b = e;
+            }
+            q.wait();
+        }
+
+        for (uint64_t i = 0; i < batches.size(); ++i)
+        {
+            const vector<uint64_t>& hits(batches[i]->mHits);
+            for (uint64_t j = 0; j < hits.size(); ++j)
+            {
+                if (hits[j] < pLhs.size())
+                {
+                    pLhsNear[hits[j]] = true;
+                }
+                else
+                {
+                    pRhsNear[hits[j] - pLhs.size()] = true;
+                }
+            }
+        }
+    }
+} // namespace anonymous
+
+uint64_t
+HammingJoin::join(uint64_t pK, uint64_t pDist, bool pRevComp,
+                  const Kmers& pLhs, const Kmers& pRhs,
+                  dynamic_bitset<>& pLhsNear, dynamic_bitset<>& pRhsNear,
+                  MemoryBudget& pBudget, uint64_t pThreads)
+{
+    if (pDist == 0 || 2 * pDist > pK)
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << Gossamer::general_error_info("distance " + lexical_cast<string>(pDist)
+                                                + " out of range for k=" + lexical_cast<string>(pK)));
+    }
+    pLhsNear.resize(pLhs.size());
+    pRhsNear.resize(pRhs.size());
+
+    Kmers rcs;
+    if (pRevComp)
+    {
+        rcs.reserve(pRhs.size());
+        for (uint64_t j = 0; j < pRhs.size(); ++j)
+        {
+            rcs.push_back(pRhs[j]);
+            rcs.back().reverseComplement(pK);
+        }
+    }
+
+    // Block b holds the bases [first, first + second).
+    const uint64_t numBlocks = 2 * pDist;
+    vector<pair<uint64_t,uint64_t> > blocks;
+    vector<position_type> masks;
+    for (uint64_t b = 0; b < numBlocks; ++b)
+    {
+        const uint64_t s = pK * b / numBlocks;
+        const uint64_t e = pK * (b + 1) / numBlocks;
+        blocks.push_back(make_pair(s, e - s));
+        masks.push_back((position_type(1) << 2 * (e - s)) - 1);
+    }
+
+    const uint64_t numItems = pLhs.size() + pRhs.size() + rcs.size();
+    const uint64_t want = numItems * sizeof(Item);
+    MemoryBudget::Reservation mem(pBudget.reserve(want, want / maxPartitions + 1));
+    const uint64_t numParts = mem.size() >= want ? 1
+                            : min<uint64_t>(maxPartitions, (want + mem.size() - 1) / mem.size());
+
+    vector<Item> items;
+    items.reserve(numParts > 1 ? mem.size() / sizeof(Item) : numItems);
+    for (uint64_t kept = 0; kept < (1ULL << numBlocks); ++kept)
+    {
+        if (Gossamer::popcnt(kept) != numBlocks - pDist)
+        {
+            continue;
+        }
+
+        uint64_t keyBases = 0;
+        for (uint64_t b = 0; b < numBlocks; ++b)
+        {
+            if (kept & (1ULL << b))
+            {
+                keyBases += blocks[b].second;
+            }
+        }
+        const uint64_t radixBits = min<uint64_t>(2 * keyBases, 24);
+
+        // Partition on the first kept block: k-mers with equal keys
+        // agree on it.
+        const uint64_t pb = Gossamer::find_first_set(kept) - 1;
+        for (uint64_t part = 0; part < numParts; ++part)
+        {
+            items.clear();
+            const Kmers* sets[] = {&pLhs, &pRhs, &rcs};
+            for (uint64_t s = 0, r = 0; s < 3; ++s)
+            {
+                const Kmers& xs(*sets[s]);
+                for (uint64_t i = 0; i < xs.size(); ++i, ++r)
+                {
+                    if (numParts > 1)
+                    {
+                        const uint64_t b = ((xs[i] >> 2 * blocks[pb].first) & masks[pb]).asUInt64();
+                        if (((b * 0x9E3779B97F4A7C15ULL) >> 32) % numParts != part)
+                        {
+                            continue;
+                        }
+                    }
+                    Item x;
+                    x.key = key(xs[i], blocks, masks, kept);
+                    x.ref = r;
+                    items.push_back(x);
+                }
+            }
+
+            ItemCmp cmp(2 * keyBases - radixBits);
+            BlendedSort<Item>::sort(pThreads, items, radixBits, cmp);
+            scan(items, pDist, pLhs, pRhs, rcs, pLhsNear, pRhsNear, pThreads);
+        }
+    }
+    return numParts;
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef HAMMINGJOIN_HH
+#define HAMMINGJOIN_HH
+
+#ifndef MEMORYBUDGET_HH
+#include "MemoryBudget.hh"
+#endif
+
+#ifndef RANKSELECT_HH
+#include "RankSelect.hh"
+#endif
+
+#ifndef UTILS_HH
+#include "Utils.hh"
+#endif
+
+#ifndef BOOST_DYNAMIC_BITSET_HPP
+#include <boost/dynamic_bitset.hpp>
+#define BOOST_DYNAMIC_BITSET_HPP
+#endif
+
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
+// Find the k-mers of one set which lie within a few substitutions of
+// some k-mer of another set, without probing for each variant.
+//
+// The k-mers are cut into 2d blocks of bases. Two k-mers within d
+// substitutions of each other must agree on at least d of the blocks,
+// so for each way of masking out d blocks, the k-mers are sorted on
+// the bases left over, and only k-mers in the same run of equal keys
+// are compared. That turns 3K lookups per k-mer (many more for d > 1)
+// into C(2d, d) sorts and sequential scans.
+//
+// The sort buffer, one item per k-mer (and per reverse complement),
+// is reserved from the memory budget. If the budget can't hold all of
+// it, the items for each mask are split on a hash of the bases of one
+// of the blocks it keeps, so that equal keys stay together, and the
+// partitions are sorted and scanned one at a time.
+//
+class HammingJoin
+{
+public:
+    typedef std::vector<Gossamer::position_type> Kmers;
+
+    // The number of bases by which two k-mers differ.
+    static uint64_t distance(const Gossamer::position_type& pLhs, const Gossamer::position_type& pRhs)
+    {
+        const Gossamer::position_type::value_type x = (pLhs ^ pRhs).value();
+        uint64_t d = 0;
+        for (const uint64_t* w = x.words().first; w != x.words().second; ++w)
+        {
+            d += Gossamer::popcnt((*w | (*w >> 1)) & 0x5555555555555555ULL);
+        }
+        return d;
+    }
+
+    // Set pLhsNear[i] if pLhs[i] lies within pDist substitutions of some
+    // item of pRhs, and pRhsNear[j] likewise. If pRevComp is set, the
+    // reverse complements of the items of pRhs count as well.
+    //
+    // pDist must be at least 1, and no more than half of pK. Returns
+    // the number of partitions the items were split into.
+    static uint64_t join(uint64_t pK, uint64_t pDist, bool pRevComp,
+                         const Kmers& pLhs, const Kmers& pRhs,
+                         boost::dynamic_bitset<>& pLhsNear, boost::dynamic_bitset<>& pRhsNear,
+                         MemoryBudget& pBudget, uint64_t pThreads);
+
+    // The most partitions a join will use, however little memory it is
+    // given: beyond this, the passes over the k-mers to pick out each
+    // partition cost more than the sorts.
+    static constexpr uint64_t maxPartitions = 64;
+};
+
+#endif // HAMMINGJOIN_HH
@@ -7,6 +7,7 @@
 // Please see the file LICENSE, included with this distribution.
 //
 #include "IntegerArray.hh"
+#include "BitKernels.hh"
 #include "StackedArray.hh"
 
 using namespace boost;
@@ -47,20 +48,58 @@ namespace {
             return;
         }
 
-        try
+        if (pFactory.exists(pBaseName))
         {
             pFactory.remove(pBaseName);
             return;
         }
-        catch (Gossamer::error& e)
+        tryRemove(pBaseName + ".lwr", pFactory, pDepthLeft - 1);
+        tryRemove(pBaseName + ".upr", pFactory, pDepthLeft - 1);
+    }
+
+    void tryCopy(const string& pFrom, const string& pTo, FileFactory& pFactory, uint64_t pDepthLeft)
+    {
+        if (!pDepthLeft)
         {
-            tryRemove(pBaseName + ".lwr", pFactory, pDepthLeft - 1);
-            tryRemove(pBaseName + ".upr", pFactory, pDepthLeft - 1);
+            return;
+        }
+
+        if (pFactory.exists(pFrom))
+        {
+            pFactory.copy(pFrom, pTo);
+            return;
         }
+        tryCopy(pFrom + ".lwr", pTo + ".lwr", pFactory, pDepthLeft - 1);
+        tryCopy(pFrom + ".upr", pTo + ".upr", pFactory, pDepthLeft - 1);
     }
 }
 
 
+namespace // anonymous
+{
+    template<typename T>
+    uint64_t countLess(const T* pItems, uint64_t pNumItems, T pValue)
+    {
+        uint64_t n = 0;
+        for (uint64_t i = 0; i < pNumItems; ++i)
+        {
+            n += pItems[i] < pValue;
+        }
+        return n;
+    }
+
+    uint64_t countLess(const uint32_t* pItems, uint64_t pNumItems, uint32_t pValue)
+    {
+        return BitKernels::countLess(pItems, pNumItems, pValue);
+    }
+
+    uint64_t countLess(const uint64_t* pItems, uint64_t pNumItems, uint64_t pValue)
+    {
+        return BitKernels::countLess(pItems, pNumItems, pValue);
+    }
+} // namespace anonymous
+
+
 template<typename StoreType>
 class IntegerArrayBasic : public IntegerArray
 {
@@ -80,17 +119,26 @@ public:
 
     uint64_t lower_bound(uint64_t pBegin, uint64_t pEnd, const value_type& pVal) const
     {
-        using namespace Gossamer;
+        // Bisect down to a short run, then count the items in it less
+        // than the value, which for sorted items is the same thing.
         store_type value = static_cast<store_type>(pVal.asUInt64());
         const store_type* arr = mArray.begin();
-        auto lb
-            = tuned_lower_bound<
-                    const store_type*,
-                    store_type,
-                    std::less<store_type>,
-                    BinarySearchCutoff>
-                (arr + pBegin, arr + pEnd, value, std::less<store_type>());
-        return lb - arr;
+        const store_type* s = arr + pBegin;
+        uint64_t len = pEnd - pBegin;
+        while (len > BinarySearchCutoff)
+        {
+            const uint64_t half = len >> 1;
+            if (s[half] < value)
+            {
+                s += half + 1;
+                len -= half + 1;
+            }
+            else
+            {
+                len = half;
+            }
+        }
+        return (s - arr) + countLess(s, len, value);
     }
 
     uint64_t upper_bound(uint64_t pBegin, uint64_t pEnd, const value_type& pVal) const
@@ -563,6 +611,12 @@ IntegerArray::remove(const std::string& pBaseName, FileFactory& pFactory)
     tryRemove(pBaseName, pFactory, 8);
 }
 
+void
+IntegerArray::copy(const std::string& pFrom, const std::string& pTo, FileFactory& pFactory)
+{
+    tryCopy(pFrom, pTo, pFactory, 8);
+}
+
 uint64_t
 IntegerArray::roundUpBits(uint64_t pBits)
 {
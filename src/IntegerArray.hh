@@ -116,6 +116,11 @@ public:
      */
     static void remove(const std::string& pBaseName, FileFactory& pFactory);
 
+    /**
+     * Copy the files for the named integer array to those for pTo.
+     */
+    static void copy(const std::string& pFrom, const std::string& pTo, FileFactory& pFactory);
+
     /**
      * Round up pBits to the nearest valid number of bits storable in an integer array.
      */
@@ -15,6 +15,7 @@
 #include <condition_variable>
 #include <map>
 #include <set>
+#include <utility>
 #include <vector>
 
 #include "WorkQueue.hh"
@@ -42,37 +43,38 @@ public:
 
     Token enqueue(const Job& pJob, const Tokens& pDeps)
     {
-        std::unique_lock<std::mutex> lk(mMutex);
-        std::vector<Token> toSchedule;
-        Token t = mNextTok++;
-        mJobs[t] = pJob;
-        mIncomplete.insert(t);
-        mUnmetDeps[t] = pDeps;
-        Tokens& deps = mUnmetDeps[t];
-        std::vector<Token> dels;
-        for (Tokens::iterator i = deps.begin(); i != deps.end(); ++i)
+        std::vector<Runnable> toRun;
+        Token t;
         {
-            if (mIncomplete.count(*i))
+            std::unique_lock<std::mutex> lk(mMutex);
+            t = mNextTok++;
+            mJobs[t] = pJob;
+            mIncomplete.insert(t);
+            mUnmetDeps[t] = pDeps;
+            Tokens& deps = mUnmetDeps[t];
+            std::vector<Token> dels;
+            for (Tokens::iterator i = deps.begin(); i != deps.end(); ++i)
             {
-                mDepsIndex[*i].insert(t);
+                if (mIncomplete.count(*i))
+                {
+                    mDepsIndex[*i].insert(t);
+                }
+                else
+                {
+                    dels.push_back(*i);
+                }
             }
-            else
+            for (std::vector<Token>::const_iterator i = dels.begin(); i != dels.end(); ++i)
             {
-                dels.push_back(*i);
+                deps.erase(*i);
+            }
+            if (deps.empty())
+            {
+                mUnmetDeps.erase(t);
+                toRun.push_back(schedule(t));
             }
         }
-        for (std::vector<Token>::const_iterator i = dels.begin(); i != dels.end(); ++i)
-        {
-            deps.erase(*i);
-        }
-        if (deps.empty())
-        {
-            toSchedule.push_back(t);
-        }
-        for (std::vector<Token>::const_iterator i = toSchedule.begin(); i != toSchedule.end(); ++i)
-        {
-            schedule(*i);
-        }
+        run(toRun);
         return t;
     }
 
@@ -94,54 +96,66 @@ public:
         }
     }
 
-    JobManager(uint64_t pNumThreads)
-        : mNextTok(0), mQueue(pNumThreads)
+    // pRing picks the kind of queue, as for WorkQueue.
+    JobManager(uint64_t pNumThreads, bool pRing = ThreadPlacement::process().ringQueues())
+        : mNextTok(0), mQueue(pNumThreads, pRing)
     {
     }
 
 private:
 
+    typedef std::pair<Token,Job> Runnable;
+
     static void runJob(JobManager* pMgr, Token pTok, Job pJob)
     {
         pJob();
         pMgr->finish(pTok);
     }
 
-    void schedule(const Token& pTok)
+    // Take the job of a token whose dependencies are met. The caller
+    // holds the lock; the job is queued by run(), after it is released.
+    Runnable schedule(const Token& pTok)
     {
-        Job j = mJobs[pTok];
+        Runnable r(pTok, mJobs[pTok]);
         mJobs.erase(pTok);
-        mQueue.push_back(std::bind(&runJob, this, pTok, j));
+        return r;
     }
 
-    void finish(Token pTok)
+    void run(const std::vector<Runnable>& pRunnables)
     {
-        std::unique_lock<std::mutex> lk(mMutex);
-        std::vector<Token> toSchedule;
-        mIncomplete.erase(pTok);
-        if (mIncomplete.empty())
+        for (std::vector<Runnable>::const_iterator i = pRunnables.begin(); i != pRunnables.end(); ++i)
         {
-            mCond.notify_all();
+            mQueue.push_back(std::bind(&runJob, this, i->first, i->second));
         }
-        std::map<Token,Tokens>::iterator x = mDepsIndex.find(pTok);
-        if (x != mDepsIndex.end())
+    }
+
+    void finish(Token pTok)
+    {
+        std::vector<Runnable> toRun;
         {
-            for (Tokens::const_iterator i = x->second.begin(); i != x->second.end(); ++i)
+            std::unique_lock<std::mutex> lk(mMutex);
+            mIncomplete.erase(pTok);
+            if (mIncomplete.empty())
+            {
+                mCond.notify_all();
+            }
+            std::map<Token,Tokens>::iterator x = mDepsIndex.find(pTok);
+            if (x != mDepsIndex.end())
             {
-                Tokens& deps = mUnmetDeps[*i];
-                deps.erase(pTok);
-                if (deps.empty())
+                for (Tokens::const_iterator i = x->second.begin(); i != x->second.end(); ++i)
                 {
-                    toSchedule.push_back(*i);
-                    mUnmetDeps.erase(*i);
+                    Tokens& deps = mUnmetDeps[*i];
+                    deps.erase(pTok);
+                    if (deps.empty())
+                    {
+                        toRun.push_back(schedule(*i));
+                        mUnmetDeps.erase(*i);
+                    }
                 }
+                mDepsIndex.erase(pTok);
             }
-            mDepsIndex.erase(pTok);
-        }
-        for (std::vector<Token>::const_iterator i = toSchedule.begin(); i != toSchedule.end(); ++i)
-        {
-            schedule(*i);
         }
+        run(toRun);
     }
 
     std::mutex mMutex;
@@ -8,6 +8,7 @@
 //
 #include "FileFactory.hh"
 #include "KmerSet.hh"
+#include "KmerSketch.hh"
 
 #include <string>
 
@@ -18,4 +19,69 @@ KmerSet::remove(const string& pBaseName, FileFactory& pFactory)
 {
     pFactory.remove(pBaseName + ".header");
     SparseArray::remove(pBaseName + ".kmers", pFactory);
+    removeDerived(pBaseName, pFactory);
+}
+
+void
+KmerSet::removeDerived(const string& pBaseName, FileFactory& pFactory)
+{
+    if (BlockedBloomFilter::exists(pBaseName + ".bloom", pFactory))
+    {
+        BlockedBloomFilter::remove(pBaseName + ".bloom", pFactory);
+    }
+    if (KmerSketch::exists(pBaseName + ".sketch", pFactory))
+    {
+        KmerSketch::remove(pBaseName + ".sketch", pFactory);
+    }
+}
+
+uint64_t
+KmerSet::fingerprint() const
+{
+    if (mHeader.version == version)
+    {
+        return mHeader.fingerprint;
+    }
+
+    // Older sets have none saved, so take it as Builder would.
+    Fingerprint f;
+    f.push_back(K());
+    for (Iterator i(*this); i.valid(); ++i)
+    {
+        f.push_back((*i).first.value());
+    }
+    return f.value();
+}
+
+void
+KmerSet::buildPrefilter(const string& pBaseName, FileFactory& pFactory, uint64_t pBitsPerKmer)
+{
+    // Don't let the set check the filter that is about to be replaced.
+    if (BlockedBloomFilter::exists(pBaseName + ".bloom", pFactory))
+    {
+        BlockedBloomFilter::remove(pBaseName + ".bloom", pFactory);
+    }
+    const uint64_t fp = KmerSet(pBaseName, pFactory).fingerprint();
+
+    LazyIterator itr(pBaseName, pFactory);
+    BlockedBloomFilter::Builder bld(pBaseName + ".bloom", pFactory, itr.count(), pBitsPerKmer, fp);
+    for (; itr.valid(); ++itr)
+    {
+        bld.push_back((*itr).first.value());
+    }
+    bld.end();
+}
+
+void
+KmerSet::buildSketch(const string& pBaseName, FileFactory& pFactory, uint64_t pSize)
+{
+    const uint64_t fp = KmerSet(pBaseName, pFactory).fingerprint();
+
+    LazyIterator itr(pBaseName, pFactory);
+    KmerSketch::Builder bld(pBaseName + ".sketch", pFactory, itr.K(), pSize, fp);
+    for (; itr.valid(); ++itr)
+    {
+        bld.push_back((*itr).first.value());
+    }
+    bld.end();
 }
@@ -9,6 +9,14 @@
 #ifndef KMERSET_HH
 #define KMERSET_HH
 
+#ifndef BLOCKEDBLOOMFILTER_HH
+#include "BlockedBloomFilter.hh"
+#endif
+
+#ifndef FINGERPRINT_HH
+#include "Fingerprint.hh"
+#endif
+
 #ifndef GRAPHESSENTIALS_HH
 #include "GraphEssentials.hh"
 #endif
@@ -23,9 +31,14 @@ public:
     class Iterator;
     friend class Iterator;
 
-    static constexpr uint64_t version = 2011101701ULL; 
+    static constexpr uint64_t version = 2016122101ULL; 
     // Version history
     // 2011101701 Initial Version.
+    // 2016122101 Record a fingerprint of the k-mers.
+
+    // Sets of this version, which have no fingerprint, can still be
+    // read.
+    static constexpr uint64_t unfingerprintedVersion = 2011101701ULL;
 
     static const uint64_t MaxK = sizeof(Gossamer::position_type) * 4 - 1;
 
@@ -34,20 +47,27 @@ public:
         uint64_t version;
         uint64_t K;
         uint64_t count;
+        uint64_t fingerprint;
 
         Header(const uint64_t& pK)
         {
             version = KmerSet::version;
             K = pK;
             count = 0;
+            fingerprint = 0;
         }
 
         Header(const std::string& pFileName, FileFactory& pFactory)
         {
             FileFactory::InHolderPtr headerFileHolder(pFactory.in(pFileName));
             std::istream& headerFile(**headerFileHolder);
-            headerFile.read(reinterpret_cast<char*>(this), sizeof(Header));
-            if (version != KmerSet::version)
+            headerFile.read(reinterpret_cast<char*>(this), sizeof(Header) - sizeof(fingerprint));
+            fingerprint = 0;
+            if (version == KmerSet::version)
+            {
+                headerFile.read(reinterpret_cast<char*>(&fingerprint), sizeof(fingerprint));
+            }
+            else if (version != unfingerprintedVersion)
             {
                 uint64_t v = KmerSet::version;
                 BOOST_THROW_EXCEPTION(
@@ -69,12 +89,14 @@ public:
         void push_back(const Gossamer::position_type& pKmer)
         {
             mKmerSetBuilder.push_back(pKmer);
+            mFingerprint.push_back(pKmer);
             mHeader.count++;
         }
 
         void end()
         {
             mKmerSetBuilder.end(Gossamer::position_type(1) << (2 * mHeader.K));
+            mHeader.fingerprint = mFingerprint.value();
 
             FileFactory::OutHolderPtr op(mFactory.out(mBaseName + ".header"));
             std::ostream& o(**op);
@@ -86,6 +108,7 @@ public:
               mHeader(pK),
               mKmerSetBuilder(pBaseName + ".kmers", pFactory, Gossamer::position_type(1) << (2 * pK), pM)
         {
+            mFingerprint.push_back(pK);
             if (pK > MaxK)
             {
                 BOOST_THROW_EXCEPTION(
@@ -93,6 +116,9 @@ public:
                         << Gossamer::general_error_info("unable to build a graph with k="
                                                             + boost::lexical_cast<std::string>(pK)));
             }
+            // A filter or sketch of an earlier set of the same name
+            // would not match this one.
+            removeDerived(pBaseName, pFactory);
         }
 
     private:
@@ -100,6 +126,7 @@ public:
         FileFactory& mFactory;
         Header mHeader;
         SparseArray::Builder mKmerSetBuilder;
+        Fingerprint mFingerprint;
     };
 
     class Iterator
@@ -205,6 +232,10 @@ public:
 
     bool access(const Edge& pEdge) const
     {
+        if (mPrefilter && !mPrefilter->mayContain(pEdge.value()))
+        {
+            return false;
+        }
         return mKmers.access(pEdge.value());
     }
 
@@ -213,11 +244,39 @@ public:
         return mKmers.rank(pEdge.value());
     }
 
+    // If the k-mer set has a prefilter, pRank is only set when
+    // pEdge is present.
     bool accessAndRank(const Edge& pEdge, Gossamer::rank_type& pRank) const
     {
+        if (mPrefilter && !mPrefilter->mayContain(pEdge.value()))
+        {
+            return false;
+        }
         return mKmers.accessAndRank(pEdge.value(), pRank);
     }
 
+    // A fingerprint of all the set's k-mers, taken as it was built,
+    // which identifies it to the files built beside it.
+    uint64_t fingerprint() const;
+
+    // True iff the k-mer set has a prefilter.
+    bool prefiltered() const
+    {
+        return mPrefilter.get();
+    }
+
+    // Build a Bloom filter for an existing k-mer set, using about
+    // pBitsPerKmer bits per k-mer. When the set is next opened, it will
+    // be consulted before the set itself, making lookups of absent
+    // k-mers much cheaper.
+    static void buildPrefilter(const std::string& pBaseName, FileFactory& pFactory,
+                               uint64_t pBitsPerKmer);
+
+    // Build a KmerSketch of an existing k-mer set, keeping pSize
+    // hashes, and save it beside the set as pBaseName + ".sketch".
+    static void buildSketch(const std::string& pBaseName, FileFactory& pFactory,
+                            uint64_t pSize);
+
     std::pair<Gossamer::rank_type,Gossamer::rank_type> rank(const Edge& pLhs, const Edge& pRhs) const
     {
         return mKmers.rank(pLhs.value(), pRhs.value());
@@ -238,6 +297,11 @@ public:
 
         uint64_t s = sizeof(Header);
         s += t("kmers").as<uint64_t>("storage");
+        if (mPrefilter)
+        {
+            t.putSub("prefilter", mPrefilter->stat());
+            s += t("prefilter").as<uint64_t>("storage");
+        }
         t.putProp("storage", s);
 
         return t;
@@ -249,11 +313,29 @@ public:
         : mHeader(pBaseName + ".header", pFactory),
           mKmers(pBaseName + ".kmers", pFactory)
     {
+        if (BlockedBloomFilter::exists(pBaseName + ".bloom", pFactory))
+        {
+            mPrefilter = std::unique_ptr<BlockedBloomFilter>(
+                            new BlockedBloomFilter(pBaseName + ".bloom", pFactory));
+            if (mPrefilter->count() != count() || mPrefilter->fingerprint() != fingerprint())
+            {
+                BOOST_THROW_EXCEPTION(
+                    Gossamer::error()
+                        << boost::errinfo_file_name(pBaseName + ".bloom")
+                        << Gossamer::general_error_info(
+                                "Bloom filter does not match the k-mer set; rebuild or remove it."));
+            }
+        }
     }
 
 private:
+
+    // Remove the Bloom filter and sketch built beside the set, if any.
+    static void removeDerived(const std::string& pBaseName, FileFactory& pFactory);
+
     const Header mHeader;
     SparseArray mKmers;
+    std::unique_ptr<BlockedBloomFilter> mPrefilter;
 };
 
 #endif // KMERSET_HH
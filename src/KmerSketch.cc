@@ -0,0 +1,165 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "KmerSketch.hh"
+
+#include <math.h>
+
+using namespace std;
+
+constexpr uint64_t KmerSketch::version;
+const uint64_t KmerSketch::RegisterBits;
+const uint64_t KmerSketch::NumRegisters;
+
+void
+KmerSketch::Builder::end()
+{
+    vector<uint64_t> hashes;
+    hashes.reserve(mHeap.size());
+    while (!mHeap.empty())
+    {
+        hashes.push_back(mHeap.top());
+        mHeap.pop();
+    }
+    reverse(hashes.begin(), hashes.end());
+    hashes.erase(unique(hashes.begin(), hashes.end()), hashes.end());
+    mHeader.numHashes = hashes.size();
+
+    {
+        FileFactory::OutHolderPtr op(mFactory.out(mBaseName + ".header"));
+        (**op).write(reinterpret_cast<const char*>(&mHeader), sizeof(mHeader));
+    }
+    {
+        FileFactory::OutHolderPtr op(mFactory.out(mBaseName));
+        ostream& o(**op);
+        o.write(reinterpret_cast<const char*>(hashes.data()), hashes.size() * sizeof(uint64_t));
+        o.write(reinterpret_cast<const char*>(mRegisters.data()), mRegisters.size());
+    }
+    vector<uint8_t>().swap(mRegisters);
+}
+
+KmerSketch::Builder::Builder(const string& pBaseName, FileFactory& pFactory, uint64_t pK, uint64_t pSize,
+                             uint64_t pFingerprint)
+    : mBaseName(pBaseName), mFactory(pFactory), mRegisters(NumRegisters, 0)
+{
+    mHeader.version = version;
+    mHeader.K = pK;
+    mHeader.size = max<uint64_t>(pSize, 1);
+    mHeader.numHashes = 0;
+    mHeader.count = 0;
+    mHeader.fingerprint = pFingerprint;
+}
+
+double
+KmerSketch::jaccard(const KmerSketch& pOther) const
+{
+    if (K() != pOther.K())
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << Gossamer::general_error_info("k-mer sketches with different k-mer sizes can't be compared."));
+    }
+
+    // The smallest s hashes of the union are the smallest s of the two
+    // sketches together; count how many of those are in both.
+    const uint64_t s = min(size(), pOther.size());
+    const uint64_t* i = mHashes.data();
+    const uint64_t* iEnd = i + mHashes.size();
+    const uint64_t* j = pOther.mHashes.data();
+    const uint64_t* jEnd = j + pOther.mHashes.size();
+    uint64_t n = 0;
+    uint64_t shared = 0;
+    for (; n < s && i != iEnd && j != jEnd; ++n)
+    {
+        if (*i == *j)
+        {
+            ++shared;
+            ++i;
+            ++j;
+        }
+        else if (*i < *j)
+        {
+            ++i;
+        }
+        else
+        {
+            ++j;
+        }
+    }
+    n = min<uint64_t>(s, n + (iEnd - i) + (jEnd - j));
+    return n ? double(shared) / double(n) : 1.0;
+}
+
+void
+KmerSketch::merge(vector<uint8_t>& pRegisters) const
+{
+    pRegisters.resize(NumRegisters, 0);
+    uint8_t* r = pRegisters.data();
+    const uint8_t* s = mRegisters.data();
+    for (uint64_t i = 0; i < NumRegisters; ++i)
+    {
+        r[i] = max(r[i], s[i]);
+    }
+}
+
+double
+KmerSketch::estimate(const vector<uint8_t>& pRegisters)
+{
+    const double m = pRegisters.size();
+    double sum = 0;
+    uint64_t zeroes = 0;
+    for (uint64_t i = 0; i < pRegisters.size(); ++i)
+    {
+        sum += ldexp(1.0, -int(pRegisters[i]));
+        zeroes += (pRegisters[i] == 0);
+    }
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+    const double e = alpha * m * m / sum;
+    if (e <= 2.5 * m && zeroes > 0)
+    {
+        // Small cardinalities are better estimated by linear counting.
+        return m * log(m / zeroes);
+    }
+    return e;
+}
+
+void
+KmerSketch::remove(const string& pBaseName, FileFactory& pFactory)
+{
+    pFactory.remove(pBaseName + ".header");
+    pFactory.remove(pBaseName);
+}
+
+KmerSketch::KmerSketch(const string& pBaseName, FileFactory& pFactory)
+{
+    {
+        FileFactory::InHolderPtr ip(pFactory.in(pBaseName + ".header"));
+        (**ip).read(reinterpret_cast<char*>(&mHeader), sizeof(mHeader));
+        if (mHeader.version != version)
+        {
+            BOOST_THROW_EXCEPTION(
+                Gossamer::error()
+                    << boost::errinfo_file_name(pBaseName + ".header")
+                    << Gossamer::version_mismatch_info(make_pair(version, mHeader.version)));
+        }
+    }
+
+    mHashes.resize(mHeader.numHashes);
+    mRegisters.resize(NumRegisters);
+    FileFactory::InHolderPtr ip(pFactory.in(pBaseName));
+    istream& i(**ip);
+    i.read(reinterpret_cast<char*>(mHashes.data()), mHashes.size() * sizeof(uint64_t));
+    i.read(reinterpret_cast<char*>(mRegisters.data()), mRegisters.size());
+    if (!i.good())
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << boost::errinfo_file_name(pBaseName)
+                << Gossamer::general_error_info("k-mer sketch is truncated."));
+    }
+}
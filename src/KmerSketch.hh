@@ -0,0 +1,185 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef KMERSKETCH_HH
+#define KMERSKETCH_HH
+
+#ifndef FILEFACTORY_HH
+#include "FileFactory.hh"
+#endif
+
+#ifndef GOSSAMEREXCEPTION_HH
+#include "GossamerException.hh"
+#endif
+
+#ifndef RANKSELECT_HH
+#include "RankSelect.hh"
+#endif
+
+#ifndef UTILS_HH
+#include "Utils.hh"
+#endif
+
+#ifndef STD_ALGORITHM
+#include <algorithm>
+#define STD_ALGORITHM
+#endif
+
+#ifndef STD_QUEUE
+#include <queue>
+#define STD_QUEUE
+#endif
+
+#ifndef STD_STRING
+#include <string>
+#define STD_STRING
+#endif
+
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
+// A small summary of a set of k-mers, from which the similarity of two
+// sets can be estimated without looking at the sets themselves.
+//
+// The sketch holds the smallest few hashes of the k-mers (a bottom-k
+// MinHash sketch), which estimates the Jaccard similarity of two sets,
+// and a HyperLogLog sketch, which estimates the number of distinct
+// k-mers in a set or a union of sets.
+//
+class KmerSketch
+{
+public:
+    static constexpr uint64_t version = 2016121901ULL;
+    // Version history
+    // 2016121901   - initial version
+
+    // The number of bits of the hash which select a HyperLogLog
+    // register.
+    static const uint64_t RegisterBits = 12;
+    static const uint64_t NumRegisters = 1ULL << RegisterBits;
+
+    struct Header
+    {
+        uint64_t version;
+        uint64_t K;
+        uint64_t size;
+        uint64_t numHashes;
+        uint64_t count;
+        uint64_t fingerprint;
+    };
+
+    class Builder
+    {
+    public:
+        void push_back(const Gossamer::position_type& pItem)
+        {
+            const uint64_t h = hash(pItem);
+            if (mHeap.size() < mHeader.size)
+            {
+                mHeap.push(h);
+            }
+            else if (h < mHeap.top())
+            {
+                mHeap.pop();
+                mHeap.push(h);
+            }
+
+            const uint64_t r = h >> (64 - RegisterBits);
+            const uint8_t z = Gossamer::count_leading_zeroes((h << RegisterBits) | (1ULL << (RegisterBits - 1))) + 1;
+            mRegisters[r] = std::max(mRegisters[r], z);
+            ++mHeader.count;
+        }
+
+        void end();
+
+        // Keep the pSize smallest hashes of the k-mers. pFingerprint
+        // identifies the set (see KmerSet::fingerprint()).
+        Builder(const std::string& pBaseName, FileFactory& pFactory, uint64_t pK, uint64_t pSize,
+                uint64_t pFingerprint = 0);
+
+    private:
+        const std::string mBaseName;
+        FileFactory& mFactory;
+        Header mHeader;
+        std::priority_queue<uint64_t> mHeap;
+        std::vector<uint8_t> mRegisters;
+    };
+
+    // The k-mer size.
+    uint64_t K() const
+    {
+        return mHeader.K;
+    }
+
+    // The number of hashes the sketch was built to keep.
+    uint64_t size() const
+    {
+        return mHeader.size;
+    }
+
+    // The number of k-mers in the set.
+    uint64_t count() const
+    {
+        return mHeader.count;
+    }
+
+    // The fingerprint of the set the sketch was built for.
+    uint64_t fingerprint() const
+    {
+        return mHeader.fingerprint;
+    }
+
+    // Estimate the Jaccard similarity of the two sets.
+    double jaccard(const KmerSketch& pOther) const;
+
+    // Estimate the number of distinct k-mers in the set.
+    double cardinality() const
+    {
+        return estimate(mRegisters);
+    }
+
+    // Fold the HyperLogLog sketch into pRegisters, which start out
+    // empty, so that after folding in several sketches, estimate()
+    // gives the size of the union of their sets.
+    void merge(std::vector<uint8_t>& pRegisters) const;
+
+    static double estimate(const std::vector<uint8_t>& pRegisters);
+
+    static bool exists(const std::string& pBaseName, FileFactory& pFactory)
+    {
+        return pFactory.exists(pBaseName + ".header");
+    }
+
+    static void remove(const std::string& pBaseName, FileFactory& pFactory);
+
+    KmerSketch(const std::string& pBaseName, FileFactory& pFactory);
+
+private:
+    static uint64_t hash(const Gossamer::position_type& pItem)
+    {
+        const Gossamer::position_type::value_type v(pItem.value());
+        std::pair<const uint64_t*,const uint64_t*> w(v.words());
+        uint64_t h = 0x2545f4914f6cdd1dULL;
+        for (const uint64_t* i = w.first; i != w.second; ++i)
+        {
+            h = (h ^ *i) * 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+        }
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    Header mHeader;
+    std::vector<uint64_t> mHashes;
+    std::vector<uint8_t> mRegisters;
+};
+
+#endif // KMERSKETCH_HH
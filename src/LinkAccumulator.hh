@@ -0,0 +1,295 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef LINKACCUMULATOR_HH
+#define LINKACCUMULATOR_HH
+
+#ifndef SUPERPATHID_HH
+#include "SuperPathId.hh"
+#endif
+
+#ifndef THREADGROUP_HH
+#include "ThreadGroup.hh"
+#endif
+
+#ifndef STD_ALGORITHM
+#include <algorithm>
+#define STD_ALGORITHM
+#endif
+
+#ifndef STD_ATOMIC
+#include <atomic>
+#define STD_ATOMIC
+#endif
+
+#ifndef STD_UTILITY
+#include <utility>
+#define STD_UTILITY
+#endif
+
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
+#ifndef BOOST_NONCOPYABLE_HPP
+#include <boost/noncopyable.hpp>
+#define BOOST_NONCOPYABLE_HPP
+#endif
+
+// Accumulates a value for each link (ordered pair of super paths)
+// seen by one thread. The links are kept in a flat open addressing
+// table keyed on the packed pair of ids, so adding a link touches one
+// or two cache lines and takes no locks.
+//
+// When all the threads are done, merge() combines their accumulators
+// by sorting and reducing ranges of links in parallel.
+//
+// Value must be default constructible (to zero), and combine with +=.
+//
+template <typename Value>
+class LinkAccumulator : private boost::noncopyable
+{
+public:
+    typedef std::pair<SuperPathId,SuperPathId> Link;
+
+    struct Entry
+    {
+        uint64_t lhs;
+        uint64_t rhs;
+        Value value;
+
+        Link link() const
+        {
+            return Link(SuperPathId(lhs), SuperPathId(rhs));
+        }
+
+        bool operator<(const Entry& pRhs) const
+        {
+            return lhs < pRhs.lhs || (lhs == pRhs.lhs && rhs < pRhs.rhs);
+        }
+
+        Entry()
+            : lhs(sEmpty), rhs(0), value()
+        {
+        }
+    };
+
+    typedef std::vector<Entry> Entries;
+
+    // The value for the given link, which is zero if the link
+    // has not been seen before.
+    Value& operator[](const Link& pLink)
+    {
+        const uint64_t l = pLink.first.value();
+        const uint64_t r = pLink.second.value();
+        if (mSize + 1 > mTable.size() - mTable.size() / 4)
+        {
+            grow();
+        }
+        uint64_t i = hash(l, r) & mMask;
+        while (true)
+        {
+            Entry& e(mTable[i]);
+            if (e.lhs == l && e.rhs == r)
+            {
+                return e.value;
+            }
+            if (e.lhs == sEmpty)
+            {
+                e.lhs = l;
+                e.rhs = r;
+                ++mSize;
+                mMaxLhs = std::max(mMaxLhs, l);
+                return e.value;
+            }
+            i = (i + 1) & mMask;
+        }
+    }
+
+    // The number of distinct links.
+    uint64_t size() const
+    {
+        return mSize;
+    }
+
+    // The number of bytes the table will occupy after the next link is
+    // added, if it is a new one.
+    uint64_t growthBytes() const
+    {
+        uint64_t n = mTable.size();
+        if (mSize + 1 > n - n / 4)
+        {
+            n *= 2;
+        }
+        return n * sizeof(Entry);
+    }
+
+    // Call pFunc(e) for each entry, in no particular order.
+    template <typename Func>
+    void visit(Func pFunc) const
+    {
+        for (uint64_t i = 0; i < mTable.size(); ++i)
+        {
+            if (mTable[i].lhs != sEmpty)
+            {
+                pFunc(mTable[i]);
+            }
+        }
+    }
+
+    // Merge the given accumulators, leaving them empty, into a vector of
+    // entries, one per distinct link, in order of link.
+    static void merge(const std::vector<LinkAccumulator*>& pAccs,
+                      uint64_t pNumThreads, Entries& pResult)
+    {
+        const uint64_t P = std::max<uint64_t>(pNumThreads, 1);
+
+        // Split the links into P ranges of lhs.
+        uint64_t maxLhs = 0;
+        for (uint64_t i = 0; i < pAccs.size(); ++i)
+        {
+            maxLhs = std::max(maxLhs, pAccs[i]->mMaxLhs);
+        }
+        const uint64_t span = maxLhs / P + 1;
+
+        // Scatter each accumulator's links into its per-range buckets.
+        std::vector<std::vector<Entries> > buckets(pAccs.size(), std::vector<Entries>(P));
+        parallel(pAccs.size(), P, [&] (uint64_t a) {
+            LinkAccumulator& acc(*pAccs[a]);
+            for (uint64_t i = 0; i < acc.mTable.size(); ++i)
+            {
+                const Entry& e(acc.mTable[i]);
+                if (e.lhs != sEmpty)
+                {
+                    buckets[a][e.lhs / span].push_back(e);
+                }
+            }
+            acc.clear();
+        });
+
+        // Sort and reduce each range.
+        std::vector<Entries> parts(P);
+        parallel(P, P, [&] (uint64_t p) {
+            Entries& part(parts[p]);
+            uint64_t n = 0;
+            for (uint64_t a = 0; a < buckets.size(); ++a)
+            {
+                n += buckets[a][p].size();
+            }
+            part.reserve(n);
+            for (uint64_t a = 0; a < buckets.size(); ++a)
+            {
+                part.insert(part.end(), buckets[a][p].begin(), buckets[a][p].end());
+                Entries().swap(buckets[a][p]);
+            }
+            std::sort(part.begin(), part.end());
+
+            uint64_t j = 0;
+            for (uint64_t i = 0; i < part.size(); ++i)
+            {
+                if (j > 0 && part[j - 1].lhs == part[i].lhs && part[j - 1].rhs == part[i].rhs)
+                {
+                    part[j - 1].value += part[i].value;
+                    continue;
+                }
+                part[j++] = part[i];
+            }
+            part.resize(j);
+        });
+
+        uint64_t n = 0;
+        for (uint64_t p = 0; p < P; ++p)
+        {
+            n += parts[p].size();
+        }
+        pResult.clear();
+        pResult.reserve(n);
+        for (uint64_t p = 0; p < P; ++p)
+        {
+            pResult.insert(pResult.end(), parts[p].begin(), parts[p].end());
+            Entries().swap(parts[p]);
+        }
+    }
+
+    void clear()
+    {
+        Entries().swap(mTable);
+        mTable.resize(sInitialSize);
+        mMask = sInitialSize - 1;
+        mSize = 0;
+        mMaxLhs = 0;
+    }
+
+    LinkAccumulator()
+        : mTable(sInitialSize), mMask(sInitialSize - 1), mSize(0), mMaxLhs(0)
+    {
+    }
+
+private:
+    static const uint64_t sEmpty = ~uint64_t(0);
+    static const uint64_t sInitialSize = 1024;
+
+    static uint64_t hash(uint64_t pLhs, uint64_t pRhs)
+    {
+        uint64_t h = pLhs * 0x9e3779b97f4a7c13ULL ^ pRhs;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    void grow()
+    {
+        Entries old(mTable.size() * 2);
+        old.swap(mTable);
+        mMask = mTable.size() - 1;
+        for (uint64_t j = 0; j < old.size(); ++j)
+        {
+            const Entry& e(old[j]);
+            if (e.lhs == sEmpty)
+            {
+                continue;
+            }
+            uint64_t i = hash(e.lhs, e.rhs) & mMask;
+            while (mTable[i].lhs != sEmpty)
+            {
+                i = (i + 1) & mMask;
+            }
+            mTable[i] = e;
+        }
+    }
+
+    // Call pFunc(i) for i in [0, pN) on up to pNumThreads threads.
+    template <typename Func>
+    static void parallel(uint64_t pN, uint64_t pNumThreads, Func pFunc)
+    {
+        std::atomic<uint64_t> next(0);
+        auto worker = [&] () {
+            uint64_t i;
+            while ((i = next++) < pN)
+            {
+                pFunc(i);
+            }
+        };
+        ThreadGroup threads;
+        for (uint64_t t = 1; t < std::min(pN, pNumThreads); ++t)
+        {
+            threads.create(worker);
+        }
+        worker();
+        threads.join();
+    }
+
+    Entries mTable;
+    uint64_t mMask;
+    uint64_t mSize;
+    uint64_t mMaxLhs;
+};
+
+#endif // LINKACCUMULATOR_HH
@@ -8,10 +8,16 @@
 //
 #include "Utils.hh"
 #include <unistd.h>
+#include <dirent.h>
 #include <execinfo.h>
+#include <sched.h>
+#include <stdio.h>
+#include <algorithm>
 #include <bitset>
+#include <fstream>
 #include <time.h>
 #include <sys/signal.h>
+#include <sys/syscall.h>
 
 namespace Gossamer {
     
@@ -22,6 +28,140 @@ namespace Gossamer {
         return tmpdir ? tmpdir : fallback;
     }
 
+    namespace // anonymous
+    {
+        std::string readLine(const std::string& pFileName)
+        {
+            std::ifstream f(pFileName.c_str());
+            std::string l;
+            std::getline(f, l);
+            return l;
+        }
+
+        // The processors in the calling thread's affinity mask, or if
+        // that can't be had, those which are online.
+        std::vector<uint32_t> allowedProcessors()
+        {
+            std::vector<uint32_t> ps;
+            cpu_set_t s;
+            CPU_ZERO(&s);
+            if (sched_getaffinity(0, sizeof(s), &s) == 0)
+            {
+                for (uint32_t i = 0; i < CPU_SETSIZE; ++i)
+                {
+                    if (CPU_ISSET(i, &s))
+                    {
+                        ps.push_back(i);
+                    }
+                }
+            }
+            if (ps.empty())
+            {
+                ps = parseProcessorList(readLine("/sys/devices/system/cpu/online"));
+            }
+            if (ps.empty())
+            {
+                const long n = sysconf(_SC_NPROCESSORS_ONLN);
+                for (long i = 0; i < std::max(1L, n); ++i)
+                {
+                    ps.push_back(i);
+                }
+            }
+            return ps;
+        }
+
+        // The memory nodes, named by their directories in sysfs.
+        std::vector<uint32_t> nodes()
+        {
+            std::vector<uint32_t> ns;
+            if (DIR* d = opendir("/sys/devices/system/node"))
+            {
+                while (const dirent* e = readdir(d))
+                {
+                    uint32_t n = 0;
+                    if (sscanf(e->d_name, "node%u", &n) == 1)
+                    {
+                        ns.push_back(n);
+                    }
+                }
+                closedir(d);
+            }
+            sortAndUnique(ns);
+            return ns;
+        }
+    } // namespace anonymous
+
+    bool interleaveMemory(bool pInterleave)
+    {
+        // From <numaif.h>, which we avoid to save a dependency on libnuma.
+        static const int mpolDefault = 0;
+        static const int mpolInterleave = 3;
+        if (!pInterleave)
+        {
+            return syscall(SYS_set_mempolicy, mpolDefault, NULL, 0) == 0;
+        }
+
+        // Only nodes with memory of their own can take pages, and the
+        // kernel refuses a mask naming any it doesn't know about.
+        std::vector<uint32_t> ns(parseProcessorList(
+            readLine("/sys/devices/system/node/has_memory")));
+        if (ns.empty())
+        {
+            ns = nodes();
+        }
+        if (ns.empty())
+        {
+            ns.push_back(0);
+        }
+        static const uint64_t wordBits = 8 * sizeof(unsigned long);
+        std::vector<unsigned long> mask(ns.back() / wordBits + 1, 0);
+        for (uint64_t i = 0; i < ns.size(); ++i)
+        {
+            mask[ns[i] / wordBits] |= 1ul << (ns[i] % wordBits);
+        }
+        // The kernel takes one less than maxnode bits.
+        return syscall(SYS_set_mempolicy, mpolInterleave, &mask[0],
+                       wordBits * mask.size() + 1) == 0;
+    }
+
+    std::vector<std::vector<uint32_t> > processorsByNode()
+    {
+        const std::vector<uint32_t> allowed(allowedProcessors());
+        const std::vector<uint32_t> nodes(Gossamer::nodes());
+
+        std::vector<std::vector<uint32_t> > ps;
+        for (uint64_t i = 0; i < nodes.size(); ++i)
+        {
+            const std::vector<uint32_t> cpus(parseProcessorList(
+                readLine("/sys/devices/system/node/node" + std::to_string(nodes[i]) + "/cpulist")));
+            std::vector<uint32_t> here;
+            std::set_intersection(cpus.begin(), cpus.end(), allowed.begin(), allowed.end(),
+                                  std::back_inserter(here));
+            if (!here.empty())
+            {
+                ps.resize(std::max<uint64_t>(ps.size(), nodes[i] + 1));
+                ps[nodes[i]] = here;
+            }
+        }
+        if (ps.empty())
+        {
+            ps.push_back(allowed);
+        }
+        return ps;
+    }
+
+    bool pinThread(uint32_t pProcessor)
+    {
+        if (pProcessor >= CPU_SETSIZE)
+        {
+            return false;
+        }
+        cpu_set_t s;
+        CPU_ZERO(&s);
+        CPU_SET(pProcessor, &s);
+        return sched_setaffinity(0, sizeof(s), &s) == 0;
+    }
+
 }
 
 namespace Gossamer { namespace Linux {
@@ -151,38 +291,42 @@ namespace Gossamer { namespace Linux {
         } 
     }
 
-    enum {
-        kCpuCapPopcnt = 0,
-        kCpuCapLast
-    };
-
-    std::bitset<kCpuCapLast> sCpuCaps;
+    std::bitset<kCpuFeatureCount> sCpuCaps;
 
     uint32_t sLogicalProcessorCount;
 
     inline void
-    cpuid(uint32_t pInfoType, uint32_t pInfo[4])
+    cpuid(uint32_t pInfoType, uint32_t pInfo[4], uint32_t pSubType = 0)
     {
         pInfo[0] = pInfoType;
+        pInfo[2] = pSubType;
         __asm__ __volatile__(
             // ebx is used for PIC on 32-bit. We officially
             // don't support 32-bit, but it's just as easy to
             // avoid clobbering it.
-            "mov %%ebx,%%edi;"
+            "mov %%rbx, %%rsi;"
             "cpuid;"
-            "mov %%ebx, %%esi;"
-            "mov %%edi, %%edx;"
+            "xchg %%rbx, %%rsi;"
             : "+a" (pInfo[0]),
               "=S" (pInfo[1]),
-              "=c" (pInfo[2]),
-              "=d" (pInfo[3])
-            : : "edi");
+              "+c" (pInfo[2]),
+              "=d" (pInfo[3]));
+    }
+
+    // The state components the operating system saves on a context
+    // switch. Only valid if cpuid says OSXSAVE.
+    inline uint64_t
+    xgetbv()
+    {
+        uint32_t lo, hi;
+        __asm__ __volatile__("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+        return (uint64_t(hi) << 32) | lo;
     }
 
     void probeCpu()
     {
         sLogicalProcessorCount = 1;
-        sCpuCaps[kCpuCapPopcnt] = false;
+        sCpuCaps.reset();
 
         uint32_t cpuInfo[4];
         cpuid(0, cpuInfo);
@@ -190,13 +334,46 @@ namespace Gossamer { namespace Linux {
         uint32_t cpuInfoExt[4];
         cpuid(0x80000000, cpuInfoExt);
 
+        bool avxState = false;
+        bool avx512State = false;
+        uint32_t family = 0;
         if (cpuInfo[0] >= 1)
         {
             uint32_t cpuInfo1[4];
             cpuid(1, cpuInfo1);
+            family = (cpuInfo1[0] >> 8) & 0xF;
+            if (family == 0xF)
+            {
+                family += (cpuInfo1[0] >> 20) & 0xFF;
+            }
             sLogicalProcessorCount = (cpuInfo1[1] >> 16) & 0xFF;
-            sCpuCaps[kCpuCapPopcnt] = cpuInfo1[2] & (1 << 23);
+            sCpuCaps[kCpuPopcnt] = cpuInfo1[2] & (1 << 23);
+            if (cpuInfo1[2] & (1 << 27))
+            {
+                // The YMM (and for AVX-512, the opmask and ZMM) registers
+                // are only usable if the operating system saves them.
+                const uint64_t xcr0 = xgetbv();
+                avxState = (xcr0 & 0x6) == 0x6;
+                avx512State = (xcr0 & 0xe6) == 0xe6;
+            }
         }
+
+        if (cpuInfo[0] >= 7)
+        {
+            uint32_t cpuInfo7[4];
+            cpuid(7, cpuInfo7, 0);
+            sCpuCaps[kCpuBmi1] = cpuInfo7[1] & (1 << 3);
+            sCpuCaps[kCpuBmi2] = cpuInfo7[1] & (1 << 8);
+            sCpuCaps[kCpuAvx2] = avxState && (cpuInfo7[1] & (1 << 5));
+            sCpuCaps[kCpuAvx512f] = avx512State && (cpuInfo7[1] & (1 << 16));
+            sCpuCaps[kCpuAvx512Vpopcntdq] = avx512State && (cpuInfo7[2] & (1 << 14));
+        }
+
+        // AMD processors before Zen 3 (family 19h), and Hygon's, which
+        // are Zen 1, run PDEP in microcode, taking hundreds of cycles.
+        const bool amd = (cpuInfo[1] == 0x68747541 && cpuInfo[3] == 0x69746e65 && cpuInfo[2] == 0x444d4163)
+                      || (cpuInfo[1] == 0x6f677948 && cpuInfo[3] == 0x6e65476e && cpuInfo[2] == 0x656e6975);
+        sCpuCaps[kCpuFastPdep] = sCpuCaps[kCpuBmi2] && !(amd && family < 0x19);
     }
 } }
 
@@ -205,6 +382,10 @@ void
 MachineAutoSetup::setupMachineSpecific()
 {
     Gossamer::Linux::probeCpu();
+
+    // The count cpuid gives is of the package, not of the processors
+    // this process may use, and is often wrong on large machines.
+    Gossamer::Linux::sLogicalProcessorCount = Gossamer::allowedProcessors().size();
     Gossamer::Linux::installSignalHandlers();
 }
 
@@ -216,3 +397,10 @@ Gossamer::logicalProcessorCount()
 }
 
 
+bool
+Gossamer::cpuHas(CpuFeature pFeature)
+{
+    return Gossamer::Linux::sCpuCaps[pFeature];
+}
+
+
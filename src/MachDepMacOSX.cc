@@ -9,6 +9,7 @@
 #include "Utils.hh"
 #include <unistd.h>
 #include <execinfo.h>
+#include <algorithm>
 #include <bitset>
 #include <mach/mach.h>
 #include <mach/mach_time.h>
@@ -71,19 +72,14 @@ namespace MacOSX {
         } 
     }
 
-    enum {
-        kCpuCapPopcnt = 0,
-        kCpuCapLast
-    };
-
-    std::bitset<kCpuCapLast> sCpuCaps;
+    std::bitset<kCpuFeatureCount> sCpuCaps;
 
     uint32_t sLogicalProcessorCount;
 
     void probeCpu()
     {
         sLogicalProcessorCount = 1;
-        sCpuCaps[kCpuCapPopcnt] = false;
+        sCpuCaps.reset();
 
         uint32_t logicalcpu;
         size_t logicalcpuLen = sizeof(logicalcpu);
@@ -94,7 +90,20 @@ namespace MacOSX {
         uint32_t features[2];
         size_t featuresLen = sizeof(features);
         if (!sysctlbyname("machdep.cpu.feature_bits", &features, &featuresLen, NULL, 0)) {
-            sCpuCaps[kCpuCapPopcnt] = features[1] & (1 << 23);
+            sCpuCaps[kCpuPopcnt] = features[1] & (1 << 23);
+        }
+
+        // Leaf 7 ebx. The kernel only reports AVX2 here if it saves
+        // the YMM state. AVX-512 state is enabled lazily, and
+        // VPOPCNTDQ isn't reported, so we don't claim either.
+        uint32_t leaf7;
+        size_t leaf7Len = sizeof(leaf7);
+        if (!sysctlbyname("machdep.cpu.leaf7_feature_bits", &leaf7, &leaf7Len, NULL, 0)) {
+            sCpuCaps[kCpuBmi1] = leaf7 & (1 << 3);
+            sCpuCaps[kCpuBmi2] = leaf7 & (1 << 8);
+            sCpuCaps[kCpuAvx2] = leaf7 & (1 << 5);
+            // Only Intel processors have shipped in Macs.
+            sCpuCaps[kCpuFastPdep] = sCpuCaps[kCpuBmi2];
         }
     }
 
@@ -107,11 +116,37 @@ namespace MacOSX {
         return tmpdir ? tmpdir : fallback;
     }
 
+    bool interleaveMemory(bool pInterleave)
+    {
+        return false;
+    }
+
+    std::vector<std::vector<uint32_t> > processorsByNode()
+    {
+        std::vector<uint32_t> ps;
+        for (uint32_t i = 0; i < std::max<uint32_t>(1, logicalProcessorCount()); ++i)
+        {
+            ps.push_back(i);
+        }
+        return std::vector<std::vector<uint32_t> >(1, ps);
+    }
+
+    bool pinThread(uint32_t pProcessor)
+    {
+        return false;
+    }
+
     uint32_t
     logicalProcessorCount()
     {
         return MacOSX::sLogicalProcessorCount;
     }
+
+    bool
+    cpuHas(CpuFeature pFeature)
+    {
+        return MacOSX::sCpuCaps[pFeature];
+    }
 }
 
 void
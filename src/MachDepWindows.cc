@@ -9,13 +9,16 @@
 //#include "Utils.hh"
 
 #include "Utils.hh"
+#include <algorithm>
 #include <bitset>
 #include <signal.h>
 #include <DbgHelp.h>
+#include <immintrin.h>
 
 #pragma intrinsic(__popcnt64)
 #pragma intrinsic(__cpuid)
 #pragma intrinsic(__cpuidex)
+#pragma intrinsic(_xgetbv)
 
 namespace Gossamer {
     
@@ -26,6 +29,26 @@ namespace Gossamer {
         return val ? val : fallBack;
     }
 
+    bool interleaveMemory(bool pInterleave)
+    {
+        return false;
+    }
+
+    std::vector<std::vector<uint32_t> > processorsByNode()
+    {
+        std::vector<uint32_t> ps;
+        for (uint32_t i = 0; i < std::max<uint32_t>(1, logicalProcessorCount()); ++i)
+        {
+            ps.push_back(i);
+        }
+        return std::vector<std::vector<uint32_t> >(1, ps);
+    }
+
+    bool pinThread(uint32_t pProcessor)
+    {
+        return false;
+    }
+
 }
 
 
@@ -96,19 +119,14 @@ namespace Gossamer { namespace Windows {
         }
     }
 
-    enum {
-        kCpuCapPopcnt = 0,
-        kCpuCapLast
-    };
-
-    std::bitset<kCpuCapLast> sCpuCaps;
+    std::bitset<kCpuFeatureCount> sCpuCaps;
 
     uint32_t sLogicalProcessorCount;
 
     void probeCpu()
     {
         sLogicalProcessorCount = 1;
-        sCpuCaps[kCpuCapPopcnt] = false;
+        sCpuCaps.reset();
 
         int cpuInfo[4];
         __cpuid(cpuInfo, 0);
@@ -116,13 +134,46 @@ namespace Gossamer { namespace Windows {
         int cpuInfoExt[4];
         __cpuid(cpuInfoExt, 0x80000000);
 
+        bool avxState = false;
+        bool avx512State = false;
+        uint32_t family = 0;
         if (cpuInfo[0] >= 1)
         {
             int cpuInfo1[4];
             __cpuid(cpuInfo1, 1);
+            family = (cpuInfo1[0] >> 8) & 0xF;
+            if (family == 0xF)
+            {
+                family += (cpuInfo1[0] >> 20) & 0xFF;
+            }
             sLogicalProcessorCount = (cpuInfo1[1] >> 16) & 0xFF;
-            sCpuCaps[kCpuCapPopcnt] = cpuInfo1[2] & (1 << 23);
+            sCpuCaps[kCpuPopcnt] = cpuInfo1[2] & (1 << 23);
+            if (cpuInfo1[2] & (1 << 27))
+            {
+                // The YMM (and for AVX-512, the opmask and ZMM) registers
+                // are only usable if the operating system saves them.
+                const uint64_t xcr0 = _xgetbv(0);
+                avxState = (xcr0 & 0x6) == 0x6;
+                avx512State = (xcr0 & 0xe6) == 0xe6;
+            }
+        }
+
+        if (cpuInfo[0] >= 7)
+        {
+            int cpuInfo7[4];
+            __cpuidex(cpuInfo7, 7, 0);
+            sCpuCaps[kCpuBmi1] = cpuInfo7[1] & (1 << 3);
+            sCpuCaps[kCpuBmi2] = cpuInfo7[1] & (1 << 8);
+            sCpuCaps[kCpuAvx2] = avxState && (cpuInfo7[1] & (1 << 5));
+            sCpuCaps[kCpuAvx512f] = avx512State && (cpuInfo7[1] & (1 << 16));
+            sCpuCaps[kCpuAvx512Vpopcntdq] = avx512State && (cpuInfo7[2] & (1 << 14));
         }
+
+        // AMD processors before Zen 3 (family 19h), and Hygon's, which
+        // are Zen 1, run PDEP in microcode, taking hundreds of cycles.
+        const bool amd = (cpuInfo[1] == 0x68747541 && cpuInfo[3] == 0x69746e65 && cpuInfo[2] == 0x444d4163)
+                      || (cpuInfo[1] == 0x6f677948 && cpuInfo[3] == 0x6e65476e && cpuInfo[2] == 0x656e6975);
+        sCpuCaps[kCpuFastPdep] = sCpuCaps[kCpuBmi2] && !(amd && family < 0x19);
     }
 
     static uint8_t sPopcntLut[256];
@@ -165,7 +216,7 @@ namespace Gossamer { namespace Windows {
             sPopcntLut[i] = val;
         }
 
-        sPopcnt64 = sCpuCaps[kCpuCapPopcnt] ? &popcntByIntrinsic : &popcntByLut;
+        sPopcnt64 = sCpuCaps[kCpuPopcnt] ? &popcntByIntrinsic : &popcntByLut;
     }
 
 } }
@@ -187,6 +238,13 @@ Gossamer::logicalProcessorCount()
 }
 
 
+bool
+Gossamer::cpuHas(CpuFeature pFeature)
+{
+    return Gossamer::Windows::sCpuCaps[pFeature];
+}
+
+
 void gettimeofday(timeval* t, void *)
 {
     using namespace boost::posix_time;
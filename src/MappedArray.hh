@@ -116,8 +116,8 @@ public:
             return mArray->size();
         }
 
-        Iterator(const MappedArray<T>* pArray)
-            : mArray(pArray), mPos(0)
+        Iterator(const MappedArray<T>* pArray, uint64_t pPos = 0)
+            : mArray(pArray), mPos(pPos)
         {
         }
 
@@ -195,9 +195,9 @@ public:
         uint64_t mPos;
     };
 
-    Iterator iterator() const
+    Iterator iterator(uint64_t pBegin = 0) const
     {
-        return Iterator(this);
+        return Iterator(this, pBegin);
     }
 
     static LazyIterator lazyIterator(const std::string& pBaseName, FileFactory& pFactory)
@@ -29,6 +29,7 @@ class MappedFile
 public:
     enum Permissions { ReadOnly, ReadWrite };
     enum Mode { Shared, Private };
+    enum Advice { NormalAdvice, SequentialAdvice, RandomAdvice, WillNeedAdvice, HugePageAdvice };
 
     uint64_t size() const
     {
@@ -68,23 +69,29 @@ public:
     // Extend/Shrink the file and remap it.
     void resize(uint64_t pSize);
 
+    // Tell the OS how the mapping is going to be used.
+    // This is only a hint, so failures are ignored.
+    void advise(Advice pAdvice) const;
+
     // Constructor
-    explicit MappedFile(const std::string& pFileName, bool pPopulate, Permissions pPerms = ReadOnly, Mode pMode = Shared)
+    explicit MappedFile(const std::string& pFileName, bool pPopulate, Permissions pPerms = ReadOnly, Mode pMode = Shared,
+                        bool pHugeTlb = true)
     {
-        open(pFileName.c_str(), pPopulate, pPerms, pMode);
+        open(pFileName.c_str(), pPopulate, pPerms, pMode, pHugeTlb);
     }
 
     // Constructor
-    explicit MappedFile(const char* pFileName, bool pPopulate, Permissions pPerms = ReadOnly, Mode pMode = Shared)
+    explicit MappedFile(const char* pFileName, bool pPopulate, Permissions pPerms = ReadOnly, Mode pMode = Shared,
+                        bool pHugeTlb = true)
     {
-        open(pFileName, pPopulate, pPerms, pMode);
+        open(pFileName, pPopulate, pPerms, pMode, pHugeTlb);
     }
 
     // Destructor
     ~MappedFile();
 
 private:
-    void open(const char* pFileName, bool pPopulate, Permissions pPerms, Mode pMode);
+    void open(const char* pFileName, bool pPopulate, Permissions pPerms, Mode pMode, bool pHugeTlb);
 
     T* mBase;
     uint64_t mSize;
@@ -41,7 +41,7 @@ private:
 //
 template <typename T>
 void
-MappedFile<T>::open(const char* pFileName, bool pPopulate, Permissions pPerms, Mode pMode)
+MappedFile<T>::open(const char* pFileName, bool pPopulate, Permissions pPerms, Mode pMode, bool pHugeTlb)
 {
     using namespace boost;
 
@@ -67,7 +67,10 @@ MappedFile<T>::open(const char* pFileName, bool pPopulate, Permissions pPerms, M
         pflags = MAP_SHARED;
     }
 #ifdef MAP_HUGETLB
-    pflags |= MAP_HUGETLB;
+    if (pHugeTlb)
+    {
+        pflags |= MAP_HUGETLB;
+    }
 #endif
 #ifdef MAP_POPULATE
     if (pPopulate)
@@ -122,6 +125,43 @@ MappedFile<T>::open(const char* pFileName, bool pPopulate, Permissions pPerms, M
 }
 
 
+// Pass the advice on to madvise(), where there is an equivalent.
+//
+template <typename T>
+void
+MappedFile<T>::advise(Advice pAdvice) const
+{
+    if (!mBase)
+    {
+        return;
+    }
+    int adv;
+    switch (pAdvice)
+    {
+        case SequentialAdvice:
+            adv = MADV_SEQUENTIAL;
+            break;
+        case RandomAdvice:
+            adv = MADV_RANDOM;
+            break;
+        case WillNeedAdvice:
+            adv = MADV_WILLNEED;
+            break;
+        case HugePageAdvice:
+#ifdef MADV_HUGEPAGE
+            adv = MADV_HUGEPAGE;
+            break;
+#else
+            return;
+#endif
+        default:
+            adv = MADV_NORMAL;
+            break;
+    }
+    madvise(mBase, mSize * sizeof(T), adv);
+}
+
+
 // Destructor
 //
 template <typename T>
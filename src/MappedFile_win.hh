@@ -28,7 +28,7 @@
 //TODO: use windows native memory mapping to get pre-population of buffer
 template <typename T>
 void
-MappedFile<T>::open(const char* pFileName, bool pPopulate, Permissions pPerms, Mode pMode)
+MappedFile<T>::open(const char* pFileName, bool pPopulate, Permissions pPerms, Mode pMode, bool pHugeTlb)
 {
     using namespace boost;
     using namespace boost::iostreams;
@@ -85,6 +85,16 @@ MappedFile<T>::open(const char* pFileName, bool pPopulate, Permissions pPerms, M
 }
 
 
+// Hint how the mapping will be used.
+//
+template <typename T>
+void
+MappedFile<T>::advise(Advice pAdvice) const
+{
+    // No equivalent of madvise() is available through boost::iostreams.
+}
+
+
 // Destructor
 //
 template <typename T>
@@ -0,0 +1,105 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "MemoryBudget.hh"
+
+#include "FileFactory.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+void
+MemoryBudget::Reservation::release()
+{
+    if (mBudget)
+    {
+        mBudget->release(mSize);
+        mBudget = 0;
+        mSize = 0;
+    }
+}
+
+MemoryBudget::Reservation&
+MemoryBudget::Reservation::operator=(Reservation&& pOther)
+{
+    if (this != &pOther)
+    {
+        release();
+        mBudget = pOther.mBudget;
+        mSize = pOther.mSize;
+        pOther.mBudget = 0;
+        pOther.mSize = 0;
+    }
+    return *this;
+}
+
+uint64_t
+MemoryBudget::reserved() const
+{
+    unique_lock<mutex> lk(mMutex);
+    return mReserved;
+}
+
+uint64_t
+MemoryBudget::available(uint64_t pDefault) const
+{
+    if (!limited())
+    {
+        return pDefault;
+    }
+    uint64_t used = reserved() + FileFactory::mappedBytes();
+    return used < mLimit ? mLimit - used : 0;
+}
+
+MemoryBudget::Reservation
+MemoryBudget::reserve(uint64_t pWanted, uint64_t pMinimum)
+{
+    uint64_t z = pWanted;
+    if (limited())
+    {
+        uint64_t mapped = FileFactory::mappedBytes();
+        unique_lock<mutex> lk(mMutex);
+        uint64_t used = mReserved + mapped;
+        uint64_t avail = used < mLimit ? mLimit - used : 0;
+        z = max(min(pWanted, avail), pMinimum);
+        mReserved += z;
+    }
+    else
+    {
+        unique_lock<mutex> lk(mMutex);
+        mReserved += z;
+    }
+    return Reservation(this, z);
+}
+
+uint64_t
+MemoryBudget::bufferSize(uint64_t pRequested, bool pExplicit, uint64_t pMinimum) const
+{
+    if (!limited())
+    {
+        return pRequested;
+    }
+    uint64_t avail = available();
+    uint64_t z = pExplicit ? min(pRequested, avail) : avail - avail / 8;
+    return max(z, pMinimum);
+}
+
+MemoryBudget&
+MemoryBudget::process()
+{
+    static MemoryBudget budget;
+    return budget;
+}
+
+void
+MemoryBudget::release(uint64_t pSize)
+{
+    unique_lock<mutex> lk(mMutex);
+    mReserved -= pSize;
+}
@@ -0,0 +1,131 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef MEMORYBUDGET_HH
+#define MEMORYBUDGET_HH
+
+#ifndef STDINT_H
+#include <stdint.h>
+#define STDINT_H
+#endif
+
+#ifndef STD_MUTEX
+#include <mutex>
+#define STD_MUTEX
+#endif
+
+// A budget for the large allocations made by a process: hash tables,
+// sort buffers, batch queues and so on. Mapped files count against the
+// budget for as long as they are mapped (see FileFactory::mappedBytes()).
+//
+// Consumers ask for a Reservation of some size between a minimum they
+// can't do without and the amount they'd like, and size their buffers
+// to what they were given, spilling to disk if necessary.
+//
+// A budget with no limit grants every request in full, so commands
+// behave as they always have unless a limit is set (--max-memory).
+//
+class MemoryBudget
+{
+public:
+    class Reservation
+    {
+    public:
+        // The number of bytes reserved.
+        uint64_t size() const
+        {
+            return mSize;
+        }
+
+        // Give back the reserved memory before the reservation goes away.
+        void release();
+
+        Reservation(Reservation&& pOther)
+            : mBudget(pOther.mBudget), mSize(pOther.mSize)
+        {
+            pOther.mBudget = 0;
+            pOther.mSize = 0;
+        }
+
+        Reservation& operator=(Reservation&& pOther);
+
+        ~Reservation()
+        {
+            release();
+        }
+
+    private:
+        friend class MemoryBudget;
+
+        Reservation(MemoryBudget* pBudget, uint64_t pSize)
+            : mBudget(pBudget), mSize(pSize)
+        {
+        }
+
+        Reservation(const Reservation&) = delete;
+        Reservation& operator=(const Reservation&) = delete;
+
+        MemoryBudget* mBudget;
+        uint64_t mSize;
+    };
+
+    // True iff a limit has been set.
+    bool limited() const
+    {
+        return mLimit > 0;
+    }
+
+    // The limit in bytes, or 0 if there is none.
+    uint64_t limit() const
+    {
+        return mLimit;
+    }
+
+    // Set the limit in bytes. 0 means no limit.
+    void limit(uint64_t pLimit)
+    {
+        mLimit = pLimit;
+    }
+
+    // The number of bytes currently held by reservations.
+    uint64_t reserved() const;
+
+    // The number of bytes which could be reserved without going over
+    // the limit, allowing for the files currently mapped. Returns
+    // the given default if there is no limit.
+    uint64_t available(uint64_t pDefault = ~uint64_t(0)) const;
+
+    // Reserve as much as possible, up to pWanted bytes. If less than
+    // pMinimum bytes are available, pMinimum bytes are reserved anyway,
+    // since there is nothing better the caller could do.
+    Reservation reserve(uint64_t pWanted, uint64_t pMinimum = 0);
+
+    // The size to use for a command's main in-memory buffer. With no
+    // limit, this is pRequested. If the size was given explicitly
+    // (e.g. with --buffer-size) it is trimmed to what is available;
+    // otherwise it is most of what is available, leaving some headroom
+    // for smaller allocations. It is never less than pMinimum.
+    uint64_t bufferSize(uint64_t pRequested, bool pExplicit, uint64_t pMinimum = 0) const;
+
+    // The budget shared by the whole process.
+    static MemoryBudget& process();
+
+    explicit MemoryBudget(uint64_t pLimit = 0)
+        : mLimit(pLimit), mReserved(0)
+    {
+    }
+
+private:
+    void release(uint64_t pSize);
+
+    uint64_t mLimit;
+    uint64_t mReserved;
+    mutable std::mutex mMutex;
+};
+
+#endif // MEMORYBUDGET_HH
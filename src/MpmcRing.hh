@@ -0,0 +1,196 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef MPMCRING_HH
+#define MPMCRING_HH
+
+#ifndef STD_ATOMIC
+#include <atomic>
+#define STD_ATOMIC
+#endif
+
+#ifndef STD_MEMORY
+#include <memory>
+#define STD_MEMORY
+#endif
+
+#ifndef STD_UTILITY
+#include <utility>
+#define STD_UTILITY
+#endif
+
+#ifndef BOOST_NONCOPYABLE_HPP
+#include <boost/noncopyable.hpp>
+#define BOOST_NONCOPYABLE_HPP
+#endif
+
+// A bounded queue for any number of producers and consumers which
+// takes no locks, after Dmitry Vyukov's design.
+//
+// Each cell carries a sequence number saying whose turn it is: the
+// producer which claims position p may fill the cell when its sequence
+// is p, and the consumer which claims position p may empty it when its
+// sequence is p + 1. Producers and consumers each claim positions from
+// their own counter by compare and swap, so they contend only among
+// themselves, and only for as long as the swap takes.
+//
+// A run of positions can be claimed with a single swap, when all of
+// the cells are ready, so items can be moved in batches.
+//
+// The capacity is rounded up to a power of two.
+//
+template <typename T>
+class MpmcRing : private boost::noncopyable
+{
+public:
+    // Add pItem if there is room.
+    bool tryPush(const T& pItem)
+    {
+        return tryPush(&pItem, &pItem + 1) == 1;
+    }
+
+    // Add as many of the items [pBegin, pEnd) as there are free cells
+    // for, in order, returning how many.
+    uint64_t tryPush(const T* pBegin, const T* pEnd)
+    {
+        uint64_t p = 0;
+        const uint64_t n = claim(mEnqueuePos, 0, pEnd - pBegin, p);
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            Cell& c(mCells[(p + i) & mMask]);
+            c.item = pBegin[i];
+            c.seq.store(p + i + 1, std::memory_order_release);
+        }
+        return n;
+    }
+
+    // Remove the oldest item, if there is one.
+    bool tryPop(T& pItem)
+    {
+        return tryPop(&pItem, 1) == 1;
+    }
+
+    // Remove up to pMax of the oldest items, in order, into pItems,
+    // returning how many.
+    uint64_t tryPop(T* pItems, uint64_t pMax)
+    {
+        uint64_t p = 0;
+        const uint64_t n = claim(mDequeuePos, 1, pMax, p);
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            Cell& c(mCells[(p + i) & mMask]);
+            pItems[i] = std::move(c.item);
+            c.item = T();
+            c.seq.store(p + i + mMask + 1, std::memory_order_release);
+        }
+        return n;
+    }
+
+    // The number of items, which may be out of date as soon as it is
+    // returned. Items still being added or removed are counted.
+    uint64_t size() const
+    {
+        const uint64_t d = mDequeuePos.load(std::memory_order_seq_cst);
+        const uint64_t e = mEnqueuePos.load(std::memory_order_seq_cst);
+        return e > d ? e - d : 0;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    uint64_t capacity() const
+    {
+        return mMask + 1;
+    }
+
+    MpmcRing(uint64_t pCapacity)
+        : mMask(roundUp(pCapacity) - 1), mCells(new Cell[mMask + 1]),
+          mEnqueuePos(0), mDequeuePos(0)
+    {
+        for (uint64_t i = 0; i <= mMask; ++i)
+        {
+            mCells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<uint64_t> seq;
+        T item;
+    };
+
+    static uint64_t roundUp(uint64_t pN)
+    {
+        uint64_t c = 2;
+        while (c < pN)
+        {
+            c <<= 1;
+        }
+        return c;
+    }
+
+    // Claim up to pMax positions from pPos whose cells have the
+    // sequence numbers position + pLag, setting pBegin to the first.
+    // Returns how many were claimed, which is 0 if the first cell
+    // isn't ready.
+    uint64_t claim(std::atomic<uint64_t>& pPos, uint64_t pLag, uint64_t pMax, uint64_t& pBegin)
+    {
+        if (pMax == 0)
+        {
+            return 0;
+        }
+        uint64_t p = pPos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            uint64_t n = 0;
+            while (n < pMax && n <= mMask
+                   && mCells[(p + n) & mMask].seq.load(std::memory_order_acquire) == p + n + pLag)
+            {
+                ++n;
+            }
+            if (n == 0)
+            {
+                // Either the ring is full (or empty), or another thread
+                // has claimed p; only in the latter case is it worth
+                // trying again.
+                const uint64_t s = mCells[p & mMask].seq.load(std::memory_order_acquire);
+                const uint64_t q = pPos.load(std::memory_order_relaxed);
+                if (q == p && s < p + pLag)
+                {
+                    return 0;
+                }
+                p = q;
+                continue;
+            }
+            if (pPos.compare_exchange_weak(p, p + n, std::memory_order_relaxed))
+            {
+                pBegin = p;
+                return n;
+            }
+        }
+    }
+
+    // The counters are padded out to cache lines of their own, so that
+    // producers and consumers don't invalidate each other's. (Padding,
+    // rather than alignas, keeps the ring and whatever holds it at the
+    // usual alignment, for operator new.)
+    static const uint64_t CacheLine = 64;
+
+    const uint64_t mMask;
+    const std::unique_ptr<Cell[]> mCells;
+    char mPad0[CacheLine];
+    std::atomic<uint64_t> mEnqueuePos;
+    char mPad1[CacheLine - sizeof(std::atomic<uint64_t>)];
+    std::atomic<uint64_t> mDequeuePos;
+    char mPad2[CacheLine - sizeof(std::atomic<uint64_t>)];
+};
+
+#endif // MPMCRING_HH
@@ -36,7 +36,7 @@ MultithreadedBatchTask::MonitorThread::operator()()
     for (uint64_t i = 0; i < mThreads.size(); ++i)
     {
         WorkThread* thr = mThreads[i].get();
-        grp.create(std::bind(&WorkThread::run, thr));
+        grp.create(std::bind(&WorkThread::run, thr), i, mThreads.size());
     }
 
     bool everyoneFinished;
@@ -0,0 +1,89 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef ORDEREDWRITER_HH
+#define ORDEREDWRITER_HH
+
+#ifndef STD_MAP
+#include <map>
+#define STD_MAP
+#endif
+
+#ifndef STD_MUTEX
+#include <mutex>
+#define STD_MUTEX
+#endif
+
+#ifndef STD_OSTREAM
+#include <ostream>
+#define STD_OSTREAM
+#endif
+
+#ifndef STD_STRING
+#include <string>
+#define STD_STRING
+#endif
+
+#ifndef BOOST_NONCOPYABLE_HPP
+#include <boost/noncopyable.hpp>
+#define BOOST_NONCOPYABLE_HPP
+#endif
+
+// Writes chunks of output which worker threads have formatted into
+// their own buffers, so that the stream is only locked to copy each
+// chunk in. If the writer is ordered, chunks are written in the order
+// of their sequence numbers, which must run from 0 without gaps;
+// chunks which arrive early are held until their turn.
+//
+class OrderedWriter : private boost::noncopyable
+{
+public:
+    // Write (or hold) the chunk numbered pSeq. The chunk is taken
+    // from pChunk, which is left empty.
+    void write(uint64_t pSeq, std::string& pChunk)
+    {
+        std::unique_lock<std::mutex> lk(mMutex);
+        if (!mOrdered || pSeq == mNext)
+        {
+            put(pChunk);
+            if (!mOrdered)
+            {
+                return;
+            }
+            ++mNext;
+            for (auto i = mHeld.begin(); i != mHeld.end() && i->first == mNext; i = mHeld.erase(i))
+            {
+                put(i->second);
+                ++mNext;
+            }
+            return;
+        }
+        mHeld[pSeq].swap(pChunk);
+        pChunk.clear();
+    }
+
+    OrderedWriter(std::ostream& pOut, bool pOrdered)
+        : mOut(pOut), mOrdered(pOrdered), mNext(0)
+    {
+    }
+
+private:
+    void put(std::string& pChunk)
+    {
+        mOut.write(pChunk.data(), pChunk.size());
+        pChunk.clear();
+    }
+
+    std::ostream& mOut;
+    const bool mOrdered;
+    std::mutex mMutex;
+    uint64_t mNext;
+    std::map<uint64_t,std::string> mHeld;
+};
+
+#endif // ORDEREDWRITER_HH
@@ -21,6 +21,10 @@
 #include "KmerAligner.hh"
 #endif
 
+#ifndef LINKACCUMULATOR_HH
+#include "LinkAccumulator.hh"
+#endif
+
 #ifndef PAIRALIGNER_HH
 #include "PairAligner.hh"
 #endif
@@ -29,6 +33,10 @@
 #include "PairLink.hh"
 #endif
 
+#ifndef READPAIRBATCH_HH
+#include "ReadPairBatch.hh"
+#endif
+
 #ifndef SUPERPATH_HH
 #include "SuperPath.hh"
 #endif
@@ -37,6 +45,11 @@
 #include "TrivialVector.hh"
 #endif
 
+#ifndef STD_ATOMIC
+#include <atomic>
+#define STD_ATOMIC
+#endif
+
 #ifndef STD_MAP
 #include <map>
 #define STD_MAP
@@ -53,6 +66,10 @@
 #endif
 
 
+// Caches SuperGraph::unique() for each super path. The cache is shared
+// by all the linking threads, so it is kept in an array of atomic
+// states rather than behind a lock. Two threads may occasionally both
+// compute the answer for the same path, but they will agree on it.
 class UniquenessCache
 {
 public:
@@ -60,34 +77,166 @@ public:
     bool unique(SuperPathId pId)
     {
         uint64_t id = pId.value();
+        uint8_t s = mStates[id].load(std::memory_order_relaxed);
+        if (s != Unknown)
         {
-            std::unique_lock<std::mutex> l(mMutex);
-            if (mKnown[id])
-            {
-                return mUnique[id];
-            }
+            return s == Unique;
         }
 
         bool u = mSG.unique(mSG[pId], mExpectedCoverage);
-        std::unique_lock<std::mutex> l(mMutex);
-        mUnique[id] = u;
-        mKnown[id] = true;
+        mStates[id].store(u ? Unique : NotUnique, std::memory_order_relaxed);
         return u;
     }
 
     UniquenessCache(const SuperGraph& pSG, double pExpectedCoverage)
         : mSG(pSG), mExpectedCoverage(pExpectedCoverage),
-        mKnown(pSG.size()), mUnique(pSG.size())
+          mStates(new std::atomic<uint8_t>[pSG.size()])
     {
+        for (uint64_t i = 0; i < pSG.size(); ++i)
+        {
+            mStates[i].store(Unknown, std::memory_order_relaxed);
+        }
     }
 
 private:
     
-    std::mutex mMutex;
+    enum State { Unknown, NotUnique, Unique };
+
     const SuperGraph& mSG;
     const double mExpectedCoverage;
-    boost::dynamic_bitset<> mKnown;
-    boost::dynamic_bitset<> mUnique;
+    std::unique_ptr<std::atomic<uint8_t>[]> mStates;
+};
+
+// The offsets of all the pairs which link one super path to another.
+struct PairLinkStats
+{
+    uint64_t count;
+    int64_t lhsOffsetSum;
+    uint64_t lhsOffsetSum2;
+    int64_t rhsOffsetSum;
+    uint64_t rhsOffsetSum2;
+
+    void add(int64_t pLhsOffset, int64_t pRhsOffset)
+    {
+        ++count;
+        lhsOffsetSum += pLhsOffset;
+        lhsOffsetSum2 += pLhsOffset * pLhsOffset;
+        rhsOffsetSum += pRhsOffset;
+        rhsOffsetSum2 += pRhsOffset * pRhsOffset;
+    }
+
+    PairLinkStats& operator+=(const PairLinkStats& pRhs)
+    {
+        count += pRhs.count;
+        lhsOffsetSum += pRhs.lhsOffsetSum;
+        lhsOffsetSum2 += pRhs.lhsOffsetSum2;
+        rhsOffsetSum += pRhs.rhsOffsetSum;
+        rhsOffsetSum2 += pRhs.rhsOffsetSum2;
+        return *this;
+    }
+
+    PairLinkStats()
+        : count(0), lhsOffsetSum(0), lhsOffsetSum2(0), rhsOffsetSum(0), rhsOffsetSum2(0)
+    {
+    }
+
+    static const uint64_t maxBytes = 7 * 9;
+
+    // Encode the link and its stats for an ExternalBufferSort. VByte
+    // codes preserve order, so the records for a link sort together,
+    // and in order of link.
+    template <typename Vec>
+    static void encode(uint64_t pLhs, uint64_t pRhs, const PairLinkStats& pStats, Vec& pVec)
+    {
+        VByteCodec::encode(pLhs, pVec);
+        VByteCodec::encode(pRhs, pVec);
+        VByteCodec::encode(pStats.count, pVec);
+        VByteCodec::encode(zigzag(pStats.lhsOffsetSum), pVec);
+        VByteCodec::encode(pStats.lhsOffsetSum2, pVec);
+        VByteCodec::encode(zigzag(pStats.rhsOffsetSum), pVec);
+        VByteCodec::encode(pStats.rhsOffsetSum2, pVec);
+    }
+
+    template <typename Itr>
+    static void decode(Itr& pItr, uint64_t& pLhs, uint64_t& pRhs, PairLinkStats& pStats)
+    {
+        pLhs = VByteCodec::decode(pItr);
+        pRhs = VByteCodec::decode(pItr);
+        pStats.count = VByteCodec::decode(pItr);
+        pStats.lhsOffsetSum = unzigzag(VByteCodec::decode(pItr));
+        pStats.lhsOffsetSum2 = VByteCodec::decode(pItr);
+        pStats.rhsOffsetSum = unzigzag(VByteCodec::decode(pItr));
+        pStats.rhsOffsetSum2 = VByteCodec::decode(pItr);
+    }
+
+private:
+
+    static uint64_t zigzag(int64_t pX)
+    {
+        return (static_cast<uint64_t>(pX) << 1) ^ static_cast<uint64_t>(pX >> 63);
+    }
+
+    static int64_t unzigzag(uint64_t pX)
+    {
+        return static_cast<int64_t>(pX >> 1) ^ -static_cast<int64_t>(pX & 1);
+    }
+};
+
+// Reduces the sorted records of PairLinkStats::encode, passing the
+// total stats for each link to pDest.
+template <typename Dest>
+class PairLinkStatsCompiler
+{
+public:
+    void push_back(const std::vector<uint8_t>& pItem)
+    {
+        const uint8_t* p(&pItem[0]);
+        uint64_t lhs;
+        uint64_t rhs;
+        PairLinkStats s;
+        PairLinkStats::decode(p, lhs, rhs, s);
+
+        if (mCount > 0 && lhs == mLhs && rhs == mRhs)
+        {
+            mStats += s;
+            return;
+        }
+        flush();
+        mLhs = lhs;
+        mRhs = rhs;
+        mStats = s;
+        mCount = 1;
+    }
+
+    void end()
+    {
+        flush();
+        mDest.end();
+    }
+
+    PairLinkStatsCompiler(Dest& pDest)
+        : mDest(pDest), mLhs(0), mRhs(0), mCount(0)
+    {
+    }
+
+private:
+
+    void flush()
+    {
+        if (mCount > 0)
+        {
+            mDest.push_back(SuperPathId(mLhs), SuperPathId(mRhs), mStats.count,
+                            mStats.lhsOffsetSum, mStats.lhsOffsetSum2,
+                            mStats.rhsOffsetSum, mStats.rhsOffsetSum2);
+        }
+        mCount = 0;
+    }
+
+    Dest& mDest;
+    uint64_t mLhs;
+    uint64_t mRhs;
+    PairLinkStats mStats;
+    uint64_t mCount;
 };
 
 class PairLinker
@@ -95,6 +244,7 @@ class PairLinker
 public:
     typedef std::pair<GossReadPtr, GossReadPtr> ReadPair;
     typedef std::map<int64_t, uint64_t> Hist;
+    typedef LinkAccumulator<PairLinkStats> Links;
 
     enum Orientation { PairedEnds, MatePairs, Innies, Outies };
 
@@ -103,6 +253,35 @@ public:
         return mDist;
     }
 
+    // The links found by this linker, if it was constructed without
+    // a sorter, or those not yet spilled to it.
+    Links& getLinks()
+    {
+        return mLinks;
+    }
+
+    // True if this linker has spilled any of its links to the sorter.
+    bool spilled() const
+    {
+        return mSpilled;
+    }
+
+    // Pass the links accumulated so far to the sorter, encoded with
+    // PairLinkStats::encode, and clear them.
+    void spill()
+    {
+        {
+            std::unique_lock<std::mutex> lk(*mMutex);
+            mLinks.visit([this] (const Links::Entry& pEntry) {
+                TrivialVector<uint8_t,PairLinkStats::maxBytes> v;
+                PairLinkStats::encode(pEntry.lhs, pEntry.rhs, pEntry.value, v);
+                mSorter->push_back(v);
+            });
+        }
+        mLinks.clear();
+        mSpilled = true;
+    }
+
     void printAlign(std::ostream& pOut, const GossRead& pRead, SuperPathId pId, int64_t pOffs, std::string pTag="")
     {
         std::string r = pRead.print();
@@ -114,10 +293,20 @@ public:
         pOut << h << "\t" << pId.value() << "\t" << pOffs << "\t" << pTag << "\n";
     }
 
-    void push_back(ReadPair pPair)
+    void push_back(const ReadPair& pPair)
+    {
+        push_back(*pPair.first, *pPair.second);
+    }
+
+    void push_back(const ReadPairBatchPtr& pBatch)
+    {
+        pBatch->visit([this] (const GossRead& pLhs, const GossRead& pRhs) {
+            push_back(pLhs, pRhs);
+        });
+    }
+
+    void push_back(const GossRead& lhsRead, const GossRead& rhsRead)
     {
-        const GossRead& lhsRead(*pPair.first);
-        const GossRead& rhsRead(*pPair.second);
 
         SuperPathId lhsId(0);
         SuperPathId lhsRcId(0);
@@ -220,27 +409,11 @@ public:
             }
             if (lhsId != rhsId)
             {
-                PairLink lnk(lhsId, rhsId, lhsStartOff, rhsEndOff);
-                TrivialVector<uint8_t,PairLink::maxBytes> v;
-                PairLink::encode(lnk, v);
-                {
-                    std::unique_lock<std::mutex> lk(mMutex);
-                    //cerr << "p\t" << lhsId.value() << '\t' << rhsId.value() << '\t'
-                    //              << lhsStartOff << '\t' << rhsEndOff << '\n';
-                    mSorter.push_back(v);
-                }
+                add(PairLink(lhsId, rhsId, lhsStartOff, rhsEndOff));
                 // printAlign(std::cout, lhsRead, lhsId, lhsStartOff);
                 // printAlign(std::cout, rhsRead, rhsId, rhsEndOff);
 
-                PairLink lnk_rc(rhsRcId, lhsRcId, rhsRcStartOff, lhsRcEndOff);
-                v.clear();
-                PairLink::encode(lnk_rc, v);
-                {
-                    std::unique_lock<std::mutex> lk(mMutex);
-                    //cerr << "r\t" << rhsRcId.value() << '\t' << lhsRcId.value() << '\t'
-                    //              << rhsRcStartOff << '\t' << lhsRcEndOff << '\n';
-                    mSorter.push_back(v);
-                }
+                add(PairLink(rhsRcId, lhsRcId, rhsRcStartOff, lhsRcEndOff));
             }
         }
         else
@@ -250,24 +423,66 @@ public:
         }
     }
 
+    // Send the encoded links to a shared sorter.
     PairLinker(const SuperGraph& pSuperGraph, const PairAligner& pAligner,
                Orientation pOrient, UniquenessCache& pUCache,
                ExternalBufferSort& pSorter, std::mutex& pMutex)
         : mSuperGraph(pSuperGraph), mAligner(pAligner), 
           mOrient(pOrient), mUCache(pUCache),
-          mSorter(pSorter), mMutex(pMutex)
+          mSorter(&pSorter), mMutex(&pMutex), mSpillBytes(0), mSpilled(false)
+    {
+    }
+
+    // Accumulate the links locally; see getLinks().
+    PairLinker(const SuperGraph& pSuperGraph, const PairAligner& pAligner,
+               Orientation pOrient, UniquenessCache& pUCache)
+        : mSuperGraph(pSuperGraph), mAligner(pAligner), 
+          mOrient(pOrient), mUCache(pUCache),
+          mSorter(0), mMutex(0), mSpillBytes(0), mSpilled(false)
+    {
+    }
+
+    // Accumulate the links locally, but spill them to the shared
+    // sorter whenever the accumulator would grow past pSpillBytes.
+    PairLinker(const SuperGraph& pSuperGraph, const PairAligner& pAligner,
+               Orientation pOrient, UniquenessCache& pUCache, uint64_t pSpillBytes,
+               ExternalBufferSort& pSorter, std::mutex& pMutex)
+        : mSuperGraph(pSuperGraph), mAligner(pAligner), 
+          mOrient(pOrient), mUCache(pUCache),
+          mSorter(&pSorter), mMutex(&pMutex), mSpillBytes(pSpillBytes), mSpilled(false)
     {
     }
 
 private:
 
+    void add(const PairLink& pLink)
+    {
+        if (!mSorter || mSpillBytes)
+        {
+            if (mSpillBytes && mLinks.growthBytes() > mSpillBytes)
+            {
+                spill();
+            }
+            mLinks[Links::Link(pLink.lhs, pLink.rhs)].add(pLink.lhsOffset, pLink.rhsOffset);
+            return;
+        }
+
+        TrivialVector<uint8_t,PairLink::maxBytes> v;
+        PairLink::encode(pLink, v);
+        std::unique_lock<std::mutex> lk(*mMutex);
+        mSorter->push_back(v);
+    }
+
     const SuperGraph& mSuperGraph;
     PairAligner mAligner;
     const Orientation mOrient;
     Hist mDist;
     UniquenessCache& mUCache;
-    ExternalBufferSort& mSorter;
-    std::mutex& mMutex;
+    ExternalBufferSort* mSorter;
+    std::mutex* mMutex;
+    const uint64_t mSpillBytes;
+    bool mSpilled;
+    Links mLinks;
 };
 
 typedef std::shared_ptr<PairLinker> PairLinkerPtr;
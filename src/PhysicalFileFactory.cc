@@ -8,6 +8,7 @@
 //
 #include "PhysicalFileFactory.hh"
 
+#include "BlockWriter.hh"
 #include "GossamerException.hh"
 #include "MappedFile.hh"
 
@@ -21,6 +22,10 @@
 #include <boost/iostreams/filter/bzip2.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/filesystem.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 using namespace std;
 using namespace boost;
@@ -29,6 +34,44 @@ using namespace boost::iostreams;
 using namespace boost::filesystem;
 using namespace Gossamer;
 
+class WarmUpTracker
+{
+public:
+    void begin()
+    {
+        unique_lock<mutex> lock(mMutex);
+        ++mPending;
+    }
+
+    void end()
+    {
+        unique_lock<mutex> lock(mMutex);
+        if (--mPending == 0)
+        {
+            mCond.notify_all();
+        }
+    }
+
+    void wait()
+    {
+        unique_lock<mutex> lock(mMutex);
+        while (mPending > 0)
+        {
+            mCond.wait(lock);
+        }
+    }
+
+    WarmUpTracker()
+        : mPending(0)
+    {
+    }
+
+private:
+    mutex mMutex;
+    condition_variable mCond;
+    uint64_t mPending;
+};
+
 namespace // anonymous
 {
 
@@ -170,89 +213,132 @@ private:
     std::ofstream mFile;
 };
 
-class PlainMappedHolder : public FileFactory::MappedHolder
+// Interleave pages allocated by this thread for the life of the scope,
+// or until release() is called.
+class InterleaveScope
 {
 public:
-    virtual uint64_t size() const
+    void release()
     {
-        return mMapped.size();
+        if (mActive)
+        {
+            Gossamer::interleaveMemory(false);
+            mActive = false;
+        }
     }
 
-    virtual const void* data() const
+    InterleaveScope(bool pInterleave)
+        : mActive(pInterleave && Gossamer::interleaveMemory(true))
     {
-        return reinterpret_cast<const void*>(mMapped.begin());
     }
 
-    PlainMappedHolder(const string& pFileName, bool pPopulate)
-        : mFileName(pFileName), mMapped(mFileName.c_str(), pPopulate)
+    ~InterleaveScope()
     {
+        release();
     }
 
 private:
-    string mFileName;
-    MappedFile<uint8_t> mMapped;
+    bool mActive;
 };
 
-class GzippedOutHolder : public FileFactory::OutHolder
+class PlainMappedHolder : public FileFactory::MappedHolder
 {
 public:
-    virtual ostream& operator*()
+    virtual uint64_t size() const
     {
-        return mFilter;
+        return mMapped.size();
     }
 
-    GzippedOutHolder(const string& pFileName, FileFactory::FileMode pMode)
-        : mFileName(pFileName), mFile(mFileName.c_str(), (pMode == FileFactory::TruncMode ? ios::trunc : ios::app) | ios::binary )
+    virtual const void* data() const
     {
-        if (!mFile.good())
+        return reinterpret_cast<const void*>(mMapped.begin());
+    }
+
+    virtual void advise(FileFactory::MapAccess pAccess) const
+    {
+        switch (pAccess)
         {
-            BOOST_THROW_EXCEPTION(
-                Gossamer::error()
-                    << errinfo_errno(errno)
-                    << errinfo_file_name(mFileName));
+            case FileFactory::SequentialAccess:
+                mMapped.advise(MappedFile<uint8_t>::SequentialAdvice);
+                break;
+            case FileFactory::RandomAccess:
+                mMapped.advise(MappedFile<uint8_t>::RandomAdvice);
+                break;
+            default:
+                mMapped.advise(MappedFile<uint8_t>::NormalAdvice);
+                break;
         }
-        mFile.exceptions(std::ofstream::badbit);
-        mFilter.push(gzip_compressor());
-        mFilter.push(mFile);
     }
 
-private:
-    string mFileName;
-    std::ofstream mFile;
-    filtering_stream<output> mFilter;
-};
-
-
-class BzippedOutHolder : public FileFactory::OutHolder
-{
-public:
-    virtual ostream& operator*()
+    PlainMappedHolder(const string& pFileName,
+                      const FileFactory::MappingPolicy& pPolicy,
+                      const std::shared_ptr<WarmUpTracker>& pWarmUps)
+        : mFileName(pFileName),
+          mInterleave(pPolicy.placement == FileFactory::InterleavedPlacement),
+          mPopulate(pPolicy.populate || (mInterleave && !pPolicy.warmUp)),
+          mScope(mInterleave && mPopulate),
+          mMapped(mFileName.c_str(), mPopulate,
+                  MappedFile<uint8_t>::ReadOnly, MappedFile<uint8_t>::Shared,
+                  pPolicy.hugePages),
+          mAccess(pPolicy.access), mWarmUps(pWarmUps), mStop(false)
     {
-        return mFilter;
+        mScope.release();
+        account(mMapped.size());
+        if (pPolicy.hugePages)
+        {
+            mMapped.advise(MappedFile<uint8_t>::HugePageAdvice);
+        }
+        if (pPolicy.warmUp && !mPopulate && mMapped.size() > 0)
+        {
+            mMapped.advise(MappedFile<uint8_t>::WillNeedAdvice);
+            mWarmUps->begin();
+            mWarmer = std::thread(&PlainMappedHolder::warmUp, this);
+        }
+        else
+        {
+            advise(pPolicy.access);
+        }
     }
 
-    BzippedOutHolder(const string& pFileName, FileFactory::FileMode pMode)
-        : mFileName(pFileName), mFile(mFileName.c_str(), (pMode == FileFactory::TruncMode ? ios::trunc : ios::app) | ios::binary )
+    ~PlainMappedHolder()
     {
-        if (!mFile.good())
+        if (mWarmer.joinable())
         {
-            BOOST_THROW_EXCEPTION(
-                Gossamer::error()
-                    << errinfo_errno(errno)
-                    << errinfo_file_name(mFileName));
+            mStop = true;
+            mWarmer.join();
         }
-        mFile.exceptions(std::ofstream::badbit);
-        mFilter.push(bzip2_compressor());
-        mFilter.push(mFile);
     }
 
 private:
+    static const uint64_t sPageSize = 4096;
+
+    // Touch one byte in every page.
+    void warmUp()
+    {
+        InterleaveScope scope(mInterleave);
+        const volatile uint8_t* p = mMapped.begin();
+        uint8_t x = 0;
+        for (uint64_t i = 0; i < mMapped.size() && !mStop; i += sPageSize)
+        {
+            x += p[i];
+        }
+        mSink = x;
+        advise(mAccess);
+        mWarmUps->end();
+    }
+
     string mFileName;
-    std::ofstream mFile;
-    filtering_stream<output> mFilter;
+    bool mInterleave;
+    bool mPopulate;
+    InterleaveScope mScope;
+    MappedFile<uint8_t> mMapped;
+    FileFactory::MapAccess mAccess;
+    std::shared_ptr<WarmUpTracker> mWarmUps;
+    std::atomic<bool> mStop;
+    std::thread mWarmer;
+    uint8_t mSink;
 };
 
-
 } // namespace anonymous
 
 
@@ -288,11 +374,11 @@ PhysicalFileFactory::out(const string& pFileName, FileMode pMode) const
     }
     if (mSpecialFileHandling && ends_with(pFileName, ".gz"))
     {
-        return OutHolderPtr(new GzippedOutHolder(pFileName, pMode));
+        return OutHolderPtr(new BlockWriter(pFileName, pMode, BlockWriter::Gzip, mOutputThreads));
     }
     if (mSpecialFileHandling && ends_with(pFileName, ".bz2"))
     {
-        return OutHolderPtr(new BzippedOutHolder(pFileName, pMode));
+        return OutHolderPtr(new BlockWriter(pFileName, pMode, BlockWriter::Bzip2, mOutputThreads));
     }
     return OutHolderPtr(new PlainOutHolder(pFileName, pMode));
 }
@@ -303,7 +389,37 @@ PhysicalFileFactory::out(const string& pFileName, FileMode pMode) const
 FileFactory::MappedHolderPtr
 PhysicalFileFactory::map(const string& pFileName) const
 {
-    return MappedHolderPtr(new PlainMappedHolder(pFileName, mPopulate));
+    return map(pFileName, mPolicies[DataMap]);
+}
+
+
+FileFactory::MappedHolderPtr
+PhysicalFileFactory::mapIndex(const string& pFileName) const
+{
+    return map(pFileName, mPolicies[IndexMap]);
+}
+
+
+FileFactory::MappedHolderPtr
+PhysicalFileFactory::map(const string& pFileName, const MappingPolicy& pPolicy) const
+{
+    return MappedHolderPtr(new PlainMappedHolder(pFileName, pPolicy, mWarmUps));
+}
+
+
+void
+PhysicalFileFactory::waitForWarmUp() const
+{
+    mWarmUps->wait();
+}
+
+
+PhysicalFileFactory::PhysicalFileFactory(const std::string& pTmpDir,
+                                         bool pSpecialFileHandling)
+    : mSpecialFileHandling(pSpecialFileHandling),
+      mOutputThreads(std::max<uint64_t>(1, std::min<uint64_t>(4, std::thread::hardware_concurrency()))),
+      mTmpDir(pTmpDir), mWarmUps(std::make_shared<WarmUpTracker>())
+{
 }
 
 // Remove a file
@@ -336,6 +452,21 @@ PhysicalFileFactory::copy(const string& pFrom, const string& pTo) const
     }
 }
 
+// Rename a file, replacing the target if it exists.
+//
+void
+PhysicalFileFactory::rename(const string& pFrom, const string& pTo) const
+{
+    int err = ::rename(pFrom.c_str(), pTo.c_str());
+    if (err)
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << errinfo_errno(errno)
+                << errinfo_file_name(pFrom));
+    }
+}
+
 // True iff the file exists.
 //
 bool
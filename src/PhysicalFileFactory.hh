@@ -18,6 +18,8 @@
 #define STD_IOSTREAM
 #endif
 
+class WarmUpTracker;
+
 class PhysicalFileFactory : public FileFactory
 {
 public:
@@ -30,12 +32,18 @@ public:
     // Open a file for mapping
     virtual MappedHolderPtr map(const std::string& pFileName) const;
 
+    // Open an index file for mapping
+    virtual MappedHolderPtr mapIndex(const std::string& pFileName) const;
+
     // Remove a file.
     virtual void remove(const std::string& pFileName) const;
 
     // Copy a file.
     virtual void copy(const std::string& pFrom, const std::string& pTo) const;
 
+    // Rename a file, replacing the target if it exists.
+    virtual void rename(const std::string& pFrom, const std::string& pTo) const;
+
     // Return true iff a file exists.
     virtual bool exists(const std::string& pFileName) const;
 
@@ -47,9 +55,22 @@ public:
 
     virtual void populate(bool pPopulate)
     {
-        mPopulate = pPopulate;
+        mPolicies[DataMap].populate = pPopulate;
+        mPolicies[IndexMap].populate = pPopulate;
     }
 
+    virtual void mappingPolicy(MapKind pKind, const MappingPolicy& pPolicy)
+    {
+        mPolicies[pKind] = pPolicy;
+    }
+
+    virtual void outputThreads(uint64_t pNumThreads)
+    {
+        mOutputThreads = pNumThreads;
+    }
+
+    virtual void waitForWarmUp() const;
+
     void turnOffSpecialFileHandling()
     {
         mSpecialFileHandling = false;
@@ -61,16 +82,16 @@ public:
     }
 
     explicit PhysicalFileFactory(const std::string& pTmpDir = "/tmp",
-                                 bool pSpecialFileHandling = true)
-        : mSpecialFileHandling(pSpecialFileHandling), mPopulate(true),
-          mTmpDir(pTmpDir)
-    {
-    }
+                                 bool pSpecialFileHandling = true);
 
 private:
+    MappedHolderPtr map(const std::string& pFileName, const MappingPolicy& pPolicy) const;
+
     bool mSpecialFileHandling;
-    bool mPopulate;
+    MappingPolicy mPolicies[2];
+    uint64_t mOutputThreads;
     std::string mTmpDir;
+    std::shared_ptr<WarmUpTracker> mWarmUps;
 };
 
 #endif // PHYSICALFILEFACTORY_HH
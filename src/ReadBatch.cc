@@ -0,0 +1,132 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "ReadBatch.hh"
+
+using namespace std;
+
+const uint64_t ReadBatch::defaultCapacity;
+
+const uint8_t ReadBatch::sCodes[256] = {
+#define X4 4, 4, 4, 4
+#define X16 X4, X4, X4, X4
+    X16, X16, X16, X16,
+    // 'A' is 65, 'C' 67, 'G' 71, 'T' 84.
+    4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    X16, X16, X16, X16, X16, X16, X16, X16
+#undef X16
+#undef X4
+};
+
+void
+ReadBatch::print(uint64_t pIdx, ostream& pOut) const
+{
+    const uint64_t lb = begin(mLabelEnds, pIdx);
+    const uint64_t bb = begin(mBaseEnds, pIdx);
+    switch (mFormats[pIdx])
+    {
+        case Fasta:
+        {
+            pOut << '>';
+            pOut.write(mLabels.data() + lb, mLabelEnds[pIdx] - lb);
+            pOut << endl;
+            pOut.write(mBases.data() + bb, mBaseEnds[pIdx] - bb);
+            pOut << endl;
+            break;
+        }
+        case Fastq:
+        {
+            const uint64_t qlb = begin(mQLabelEnds, pIdx);
+            const uint64_t qb = begin(mQualEnds, pIdx);
+            pOut << '@';
+            pOut.write(mLabels.data() + lb, mLabelEnds[pIdx] - lb);
+            pOut << endl;
+            pOut.write(mBases.data() + bb, mBaseEnds[pIdx] - bb);
+            pOut << endl << '+';
+            pOut.write(mQLabels.data() + qlb, mQLabelEnds[pIdx] - qlb);
+            pOut << endl;
+            pOut.write(mQuals.data() + qb, mQualEnds[pIdx] - qb);
+            pOut << endl;
+            break;
+        }
+        default:
+        {
+            pOut.write(mBases.data() + bb, mBaseEnds[pIdx] - bb);
+            pOut << endl;
+            break;
+        }
+    }
+}
+
+bool
+ReadBatchReader::get(ReadBatchPtr& pBatch)
+{
+    if (mQueue.get(pBatch))
+    {
+        return true;
+    }
+    if (mError)
+    {
+        rethrow_exception(mError);
+    }
+    return false;
+}
+
+void
+ReadBatchReader::fill()
+{
+    try
+    {
+        uint64_t n = 0;
+        bool more = true;
+        while (more)
+        {
+            {
+                unique_lock<mutex> lk(mMutex);
+                if (mStop)
+                {
+                    break;
+                }
+            }
+            ReadBatchPtr b(mPool.get());
+            more = mFiller(*b);
+            if (!b->empty())
+            {
+                b->sequence(n++);
+                mQueue.put(b);
+            }
+        }
+    }
+    catch (...)
+    {
+        mError = current_exception();
+    }
+    mQueue.finish();
+}
+
+ReadBatchReader::ReadBatchReader(ReadBatch::Pool& pPool, const Filler& pFiller, uint64_t pQueueSize)
+    : mPool(pPool), mFiller(pFiller), mQueue(pQueueSize), mStop(false)
+{
+    mThread = thread([this] () { fill(); });
+}
+
+ReadBatchReader::~ReadBatchReader()
+{
+    {
+        unique_lock<mutex> lk(mMutex);
+        mStop = true;
+    }
+    ReadBatchPtr b;
+    while (mQueue.get(b))
+    {
+    }
+    mThread.join();
+}
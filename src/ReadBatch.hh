@@ -0,0 +1,383 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef READBATCH_HH
+#define READBATCH_HH
+
+#ifndef BATCHPOOL_HH
+#include "BatchPool.hh"
+#endif
+
+#ifndef BOUNDEDQUEUE_HH
+#include "BoundedQueue.hh"
+#endif
+
+#ifndef GOSSFASTAREADBASESTRING_HH
+#include "GossFastaReadBaseString.hh"
+#endif
+
+#ifndef GOSSFASTQREADBASESTRING_HH
+#include "GossFastqReadBaseString.hh"
+#endif
+
+#ifndef STD_EXCEPTION
+#include <exception>
+#define STD_EXCEPTION
+#endif
+
+#ifndef STD_FUNCTIONAL
+#include <functional>
+#define STD_FUNCTIONAL
+#endif
+
+#ifndef STD_STRING
+#include <string>
+#define STD_STRING
+#endif
+
+#ifndef STD_THREAD
+#include <thread>
+#define STD_THREAD
+#endif
+
+// A batch of reads stored column-wise: the bases, qualities and labels
+// of all the reads are each held in one contiguous buffer, with the end
+// of each read's part recorded alongside. Handing a batch of a few
+// thousand reads to a worker replaces cloning each read, and k-mers can
+// be pulled out of the bases without going through the GossRead virtual
+// interface.
+//
+// A paired batch holds read pairs as consecutive reads, left first.
+//
+class ReadBatch : private boost::noncopyable
+{
+public:
+    static const uint64_t defaultCapacity = 4096;
+
+    typedef BatchPool<ReadBatch> Pool;
+
+    // The kind of read each read was parsed as, so it can be printed
+    // back out the same way.
+    enum Format { Plain, Fasta, Fastq };
+
+    uint64_t size() const
+    {
+        return mFormats.size();
+    }
+
+    bool empty() const
+    {
+        return mFormats.empty();
+    }
+
+    bool full() const
+    {
+        return size() >= mCapacity;
+    }
+
+    bool paired() const
+    {
+        return mPaired;
+    }
+
+    // The position of the batch in the order it was read in,
+    // if it came from a ReadBatchReader.
+    uint64_t sequence() const
+    {
+        return mSequence;
+    }
+
+    void sequence(uint64_t pSequence)
+    {
+        mSequence = pSequence;
+    }
+
+    void clear()
+    {
+        mLabels.clear();
+        mQLabels.clear();
+        mBases.clear();
+        mQuals.clear();
+        mLabelEnds.clear();
+        mQLabelEnds.clear();
+        mBaseEnds.clear();
+        mQualEnds.clear();
+        mFormats.clear();
+        mPaired = false;
+        mSequence = 0;
+    }
+
+    void push_back(const GossRead& pRead)
+    {
+        Format f = Plain;
+        if (const GossFastqReadBaseString* q = dynamic_cast<const GossFastqReadBaseString*>(&pRead))
+        {
+            f = Fastq;
+            mQLabels.append(q->qlabel());
+        }
+        else if (dynamic_cast<const GossFastaReadBaseString*>(&pRead))
+        {
+            f = Fasta;
+        }
+        mLabels.append(pRead.label());
+        mBases.append(pRead.read());
+        mQuals.append(pRead.qual());
+        mLabelEnds.push_back(mLabels.size());
+        mQLabelEnds.push_back(mQLabels.size());
+        mBaseEnds.push_back(mBases.size());
+        mQualEnds.push_back(mQuals.size());
+        mFormats.push_back(f);
+    }
+
+    void push_back(const GossRead& pLhs, const GossRead& pRhs)
+    {
+        mPaired = true;
+        push_back(pLhs);
+        push_back(pRhs);
+    }
+
+    // Fill the batch from a read sequence. Returns false once the
+    // sequence is exhausted.
+    template <typename Seq>
+    bool fill(Seq& pSeq)
+    {
+        while (!full() && pSeq.valid())
+        {
+            push_back(*pSeq);
+            ++pSeq;
+        }
+        return pSeq.valid();
+    }
+
+    // Fill the batch with pairs from two read sequences in step.
+    template <typename Seq>
+    bool fill(Seq& pLhs, Seq& pRhs)
+    {
+        mPaired = true;
+        while (!full() && pLhs.valid() && pRhs.valid())
+        {
+            push_back(*pLhs, *pRhs);
+            ++pLhs;
+            ++pRhs;
+        }
+        return pLhs.valid() && pRhs.valid();
+    }
+
+    // Fill the batch from a sequence of read pairs.
+    template <typename PairSeq>
+    bool fillPairs(PairSeq& pSeq)
+    {
+        mPaired = true;
+        while (!full() && pSeq.valid())
+        {
+            push_back(pSeq.lhs(), pSeq.rhs());
+            ++pSeq;
+        }
+        return pSeq.valid();
+    }
+
+    uint64_t length(uint64_t pIdx) const
+    {
+        return mBaseEnds[pIdx] - begin(mBaseEnds, pIdx);
+    }
+
+    const char* bases(uint64_t pIdx) const
+    {
+        return mBases.data() + begin(mBaseEnds, pIdx);
+    }
+
+    // Apply pFunc(offset, kmer) to each k-mer of the pIdx'th read that
+    // contains only ACGT, in order, stopping early if pFunc returns
+    // false. The k-mers are those GossRead::Iterator would yield.
+    template <typename Func>
+    void kmers(uint64_t pIdx, uint64_t pK, Func pFunc) const
+    {
+        const char* s = bases(pIdx);
+        const uint64_t n = length(pIdx);
+        if (pK <= 32)
+        {
+            // Small k-mers are assembled in a machine word.
+            const uint64_t m = pK == 32 ? ~0ULL : (1ULL << (2 * pK)) - 1;
+            uint64_t x = 0;
+            uint64_t run = 0;
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                const uint8_t c = sCodes[static_cast<uint8_t>(s[i])];
+                if (c > 3)
+                {
+                    run = 0;
+                    continue;
+                }
+                x = ((x << 2) | c) & m;
+                if (++run >= pK && !pFunc(i + 1 - pK, Gossamer::edge_type(x)))
+                {
+                    return;
+                }
+            }
+            return;
+        }
+
+        const Gossamer::edge_type m((Gossamer::edge_type(1) << (2 * pK)) - 1);
+        Gossamer::edge_type x(0);
+        uint64_t run = 0;
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            const uint8_t c = sCodes[static_cast<uint8_t>(s[i])];
+            if (c > 3)
+            {
+                run = 0;
+                continue;
+            }
+            x = ((x << 2) | Gossamer::edge_type(c)) & m;
+            if (++run >= pK && !pFunc(i + 1 - pK, x))
+            {
+                return;
+            }
+        }
+    }
+
+    // Apply pFunc to each read as a GossRead. The reads refer to
+    // storage local to the call, and are only valid while pFunc runs.
+    template <typename Func>
+    void visit(Func pFunc) const
+    {
+        Scratch lhs;
+        for (uint64_t i = 0; i < size(); ++i)
+        {
+            lhs.assign(*this, i);
+            pFunc(lhs.read(mFormats[i]));
+        }
+    }
+
+    // Apply pFunc(lhs, rhs) to each pair of reads in a paired batch.
+    template <typename Func>
+    void visitPairs(Func pFunc) const
+    {
+        Scratch lhs;
+        Scratch rhs;
+        for (uint64_t i = 0; i + 1 < size(); i += 2)
+        {
+            lhs.assign(*this, i);
+            rhs.assign(*this, i + 1);
+            pFunc(lhs.read(mFormats[i]), rhs.read(mFormats[i + 1]));
+        }
+    }
+
+    // Write the pIdx'th read as it was read in.
+    void print(uint64_t pIdx, std::ostream& pOut) const;
+
+    explicit ReadBatch(uint64_t pCapacity = defaultCapacity)
+        : mCapacity(pCapacity), mPaired(false), mSequence(0)
+    {
+    }
+
+private:
+    // String storage for presenting one read at a time as a GossRead.
+    class Scratch
+    {
+    public:
+        void assign(const ReadBatch& pBatch, uint64_t pIdx)
+        {
+            pBatch.get(pBatch.mLabels, pBatch.mLabelEnds, pIdx, mLabel);
+            pBatch.get(pBatch.mQLabels, pBatch.mQLabelEnds, pIdx, mQLabel);
+            pBatch.get(pBatch.mBases, pBatch.mBaseEnds, pIdx, mRead);
+            pBatch.get(pBatch.mQuals, pBatch.mQualEnds, pIdx, mQual);
+        }
+
+        const GossRead& read(uint8_t pFormat)
+        {
+            switch (pFormat)
+            {
+                case Fasta:
+                    return mFasta;
+                case Fastq:
+                    return mFastq;
+                default:
+                    return mPlain;
+            }
+        }
+
+        Scratch()
+            : mPlain(mLabel, mRead, mQual),
+              mFasta(mLabel, mRead),
+              mFastq(mLabel, mRead, mQLabel, mQual)
+        {
+        }
+
+    private:
+        std::string mLabel;
+        std::string mQLabel;
+        std::string mRead;
+        std::string mQual;
+        GossReadBaseString mPlain;
+        GossFastaReadBaseString mFasta;
+        GossFastqReadBaseString mFastq;
+    };
+
+    static uint64_t begin(const std::vector<uint64_t>& pEnds, uint64_t pIdx)
+    {
+        return pIdx ? pEnds[pIdx - 1] : 0;
+    }
+
+    void get(const std::string& pBuf, const std::vector<uint64_t>& pEnds, uint64_t pIdx,
+             std::string& pStr) const
+    {
+        const uint64_t b = begin(pEnds, pIdx);
+        pStr.assign(pBuf, b, pEnds[pIdx] - b);
+    }
+
+    // 0-3 for ACGT in either case, and 4 for anything else.
+    static const uint8_t sCodes[256];
+
+    const uint64_t mCapacity;
+    bool mPaired;
+    uint64_t mSequence;
+    std::string mLabels;
+    std::string mQLabels;
+    std::string mBases;
+    std::string mQuals;
+    std::vector<uint64_t> mLabelEnds;
+    std::vector<uint64_t> mQLabelEnds;
+    std::vector<uint64_t> mBaseEnds;
+    std::vector<uint64_t> mQualEnds;
+    std::vector<uint8_t> mFormats;
+};
+
+typedef std::shared_ptr<ReadBatch> ReadBatchPtr;
+
+
+// Fills batches in a background thread, using a function which fills
+// a batch and returns false once there are no more reads to come.
+// Batches are numbered in order from 0. Exceptions thrown while
+// filling are passed on to the reader.
+//
+class ReadBatchReader : private boost::noncopyable
+{
+public:
+    typedef std::function<bool (ReadBatch&)> Filler;
+
+    // Get the next batch, returning false if there are no more.
+    bool get(ReadBatchPtr& pBatch);
+
+    ReadBatchReader(ReadBatch::Pool& pPool, const Filler& pFiller, uint64_t pQueueSize = 4);
+
+    ~ReadBatchReader();
+
+private:
+    void fill();
+
+    ReadBatch::Pool& mPool;
+    Filler mFiller;
+    BoundedQueue<ReadBatchPtr> mQueue;
+    std::exception_ptr mError;
+    bool mStop;
+    std::mutex mMutex;
+    std::thread mThread;
+};
+
+#endif // READBATCH_HH
@@ -0,0 +1,119 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef READPAIRBATCH_HH
+#define READPAIRBATCH_HH
+
+#ifndef BATCHPOOL_HH
+#include "BatchPool.hh"
+#endif
+
+#ifndef GOSSREADBASESTRING_HH
+#include "GossReadBaseString.hh"
+#endif
+
+#ifndef STD_MEMORY
+#include <memory>
+#define STD_MEMORY
+#endif
+
+#ifndef STD_STRING
+#include <string>
+#define STD_STRING
+#endif
+
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
+#ifndef BOOST_NONCOPYABLE_HPP
+#include <boost/noncopyable.hpp>
+#define BOOST_NONCOPYABLE_HPP
+#endif
+
+// A batch of read pairs copied out of a read pair sequence, so they can
+// be handed to worker threads a batch at a time rather than one cloned
+// pair at a time.
+//
+// Batches come from a ReadPairBatch::Pool, so their string storage is
+// reused.
+//
+class ReadPairBatch : private boost::noncopyable
+{
+public:
+    static const uint64_t defaultCapacity = 1024;
+
+    typedef BatchPool<ReadPairBatch> Pool;
+
+    struct Read
+    {
+        std::string label;
+        std::string read;
+        std::string qual;
+
+        void assign(const GossRead& pRead)
+        {
+            label.assign(pRead.label());
+            read.assign(pRead.read());
+            qual.assign(pRead.qual());
+        }
+    };
+
+    uint64_t size() const
+    {
+        return mSize;
+    }
+
+    bool full() const
+    {
+        return mSize == mLhs.size();
+    }
+
+    void clear()
+    {
+        mSize = 0;
+    }
+
+    void push_back(const GossRead& pLhs, const GossRead& pRhs)
+    {
+        mLhs[mSize].assign(pLhs);
+        mRhs[mSize].assign(pRhs);
+        ++mSize;
+    }
+
+    // Apply pFunc(lhs, rhs) to each pair of reads in the batch. The
+    // reads refer to the batch's storage, and are only valid for the
+    // duration of the call.
+    template <typename Func>
+    void visit(Func pFunc) const
+    {
+        for (uint64_t i = 0; i < mSize; ++i)
+        {
+            const Read& l(mLhs[i]);
+            const Read& r(mRhs[i]);
+            GossReadBaseString lhs(l.label, l.read, l.qual);
+            GossReadBaseString rhs(r.label, r.read, r.qual);
+            pFunc(static_cast<const GossRead&>(lhs), static_cast<const GossRead&>(rhs));
+        }
+    }
+
+    explicit ReadPairBatch(uint64_t pCapacity = defaultCapacity)
+        : mLhs(pCapacity), mRhs(pCapacity), mSize(0)
+    {
+    }
+
+private:
+    std::vector<Read> mLhs;
+    std::vector<Read> mRhs;
+    uint64_t mSize;
+};
+
+typedef std::shared_ptr<ReadPairBatch> ReadPairBatchPtr;
+
+#endif // READPAIRBATCH_HH
@@ -271,16 +271,24 @@ namespace std {
 
 struct ResolveTranscripts::Impl
 {
+    // The edges of the component are the keys of mReadCoverage, and
+    // those of its contigs are the keys of mContigEdges, with the number
+    // of times each occurs. Both are sized by the component, and are
+    // cleared in time proportional to it.
     struct Build
     {
-        dynamic_bitset<uint64_t> mContigEdges;
-        dynamic_bitset<uint64_t> mGraphEdges;
+        SimpleHashMap<uint64_t,uint64_t> mContigEdges;
         SimpleHashMap<uint64_t,uint64_t> mReadCoverage;
 
-        Build(uint64_t pEdgesInGraph)
-            : mContigEdges(pEdgesInGraph),
-              mGraphEdges(pEdgesInGraph)
+        void addContigEdge(uint64_t pRank)
         {
+            ++mContigEdges[pRank];
+        }
+
+        void clear()
+        {
+            mContigEdges.clear();
+            mReadCoverage.clear();
         }
     };
 
@@ -750,7 +758,7 @@ struct ResolveTranscripts::Impl
 
         typedef std::unordered_map<node_t,distance_type> distance_map_t;
 
-        boost::mt19937 mRng;
+        std::mt19937 mRng;
         typedef std::unordered_map<node_t,distance_map_t> cache_map_t;
         cache_map_t mCache;
 
@@ -758,7 +766,7 @@ struct ResolveTranscripts::Impl
 
         void ejectElementFromCache()
         {
-            boost::uniform_int<> dist(0, mCache.size() - 1);
+            std::uniform_int_distribution<> dist(0, mCache.size() - 1);
             cache_map_t::iterator it = mCache.begin();
             std::advance(it, dist(mRng));
             mCache.erase(it);
@@ -1021,13 +1029,22 @@ struct ResolveTranscripts::Impl
     ptr_vector<Transcript> mTranscripts;
 
     Impl(const string& pName, Graph& pGraph, Logger& pLog, ostream& pOut,
-         uint64_t pMinLength, uint64_t pMappableReads)
-        : mName(pName), mStringFac(), mGraph(pGraph), mLog(pLog), mOut(pOut),
-          mMinLength(pMinLength), mMappableReads(pMappableReads)
+         uint64_t pMinLength, uint64_t pMappableReads,
+         const ArenaPtr& pArena);
+
+    ~Impl()
     {
-        const uint64_t K = mGraph.K();
-        mMinRhomers = mMinLength < K ? 0 : mMinLength - K + 1;
-        mBuild = std::make_shared<Build>(mGraph.count());
+        releaseBuild();
+    }
+
+    // Leave the build state clean for the next user of the arena.
+    void releaseBuild()
+    {
+        if (mBuild)
+        {
+            mBuild->clear();
+            mBuild = std::shared_ptr<Build>();
+        }
     }
 
     uint64_t readMaps(const SmallBaseVector& pRead) const
@@ -1041,14 +1058,14 @@ struct ResolveTranscripts::Impl
         size -= rho;
 
         uint64_t hits = 0;
-        dynamic_bitset<uint64_t>& contigEdges = mBuild->mContigEdges;
+        const SimpleHashMap<uint64_t,uint64_t>& contigEdges = mBuild->mContigEdges;
 
         for (uint64_t i = 0; i < size; ++i)
         {
             Graph::Edge e(pRead.kmer(rho, i));
             uint64_t rnk = 0;
             bool maps = mGraph.accessAndRank(e, rnk);
-            if (maps && contigEdges[rnk])
+            if (maps && contigEdges.find(rnk))
             {
                 ++hits;
             }
@@ -1086,7 +1103,6 @@ struct ResolveTranscripts::Impl
             }
             uint64_t rnk = edgeRank[i];
             ++build.mReadCoverage[rnk];
-            build.mGraphEdges[rnk] = true;
         }
 
         Gossamer::ensureCapacity(mReads);
@@ -3642,7 +3658,7 @@ void
 ResolveTranscripts::Impl::addContig(const SmallBaseVector& pVec)
 {
     mContigs.push_back(pVec);
-    dynamic_bitset<uint64_t>& contigEdges = mBuild->mContigEdges;
+    Build& build = *mBuild;
 
     uint64_t rho = mGraph.K() + 1;
     uint64_t upper = pVec.size() - rho;
@@ -3650,7 +3666,7 @@ ResolveTranscripts::Impl::addContig(const SmallBaseVector& pVec)
     {
         Graph::Edge e(pVec.kmer(rho, i));
         uint64_t rnk = mGraph.rank(e);
-        contigEdges[rnk] = true;
+        build.addContigEdge(rnk);
     }
 }
 
@@ -3658,7 +3674,7 @@ ResolveTranscripts::Impl::addContig(const SmallBaseVector& pVec)
 void
 ResolveTranscripts::Impl::constructGraph()
 {
-    uint64_t numEdges = mBuild->mGraphEdges.count();
+    uint64_t numEdges = mBuild->mReadCoverage.size();
 #ifdef DEBUG
     mLog(info, " graph edges = " + lexical_cast<string>(numEdges));
     mLog(info, " numContigs = " + lexical_cast<string>(mContigs.size()));
@@ -3672,23 +3688,24 @@ ResolveTranscripts::Impl::constructGraph()
         Build& build = *mBuild;
         subset_t::Builder builder(sComponentKmersName, mStringFac);
 
-        // cerr << "Edges to add: " << edges.size() << '\n';
-        for (rank_type i = 0; i < mGraph.count(); ++i)
+        vector<uint64_t> edges;
+        edges.reserve(numEdges);
+        for (SimpleHashMap<uint64_t,uint64_t>::Iterator i(build.mReadCoverage);
+             i.valid(); ++i)
         {
-            if (build.mGraphEdges[i])
-            {
-                const uint64_t* cov = build.mReadCoverage.find(i);
-                if (cov)
-                {
-                    builder.push_back(i);
-                    coverage.push_back(*cov);
-                }
-            }
+            edges.push_back(i.key());
+        }
+        std::sort(edges.begin(), edges.end());
+
+        for (auto rnk: edges)
+        {
+            builder.push_back(rnk);
+            coverage.push_back(*build.mReadCoverage.find(rnk));
         }
         builder.end(mGraph.count());
     }
 
-    mBuild = std::shared_ptr<Build>();
+    releaseBuild();
     mComponent = std::make_shared<Component>(std::ref(mGraph), std::ref(mStringFac), coverage.begin(), coverage.end());
 }
 
@@ -3698,7 +3715,7 @@ ResolveTranscripts::Impl::processComponent()
 {
     mLog(info, "Processing component " + mName);
 
-    if (mReads.size() < sMinReads || mBuild->mGraphEdges.count() < mMinRhomers)
+    if (mReads.size() < sMinReads || mBuild->mReadCoverage.size() < mMinRhomers)
     {
         return;
     }
@@ -3783,10 +3800,46 @@ ResolveTranscripts::Impl::processComponent()
 }
 
 
+class ResolveTranscripts::Arena
+{
+public:
+    Impl::Build mBuild;
+};
+
+
+ResolveTranscripts::Impl::Impl(const string& pName, Graph& pGraph,
+                               Logger& pLog, ostream& pOut,
+                               uint64_t pMinLength, uint64_t pMappableReads,
+                               const ArenaPtr& pArena)
+    : mName(pName), mStringFac(), mGraph(pGraph), mLog(pLog), mOut(pOut),
+      mMinLength(pMinLength), mMappableReads(pMappableReads)
+{
+    const uint64_t K = mGraph.K();
+    mMinRhomers = mMinLength < K ? 0 : mMinLength - K + 1;
+    if (pArena)
+    {
+        mBuild = std::shared_ptr<Build>(pArena, &pArena->mBuild);
+    }
+    else
+    {
+        mBuild = std::make_shared<Build>();
+    }
+}
+
+
+ResolveTranscripts::ArenaPtr
+ResolveTranscripts::makeArena()
+{
+    return std::make_shared<Arena>();
+}
+
+
 ResolveTranscripts::ResolveTranscripts(const string& pName,
             Graph& pGraph, Logger& pLog, std::ostream& pOut,
-            uint64_t pMinLength, uint64_t pBasesInReads)
-    : mPImpl(new Impl(pName, pGraph, pLog, pOut, pMinLength, pBasesInReads))
+            uint64_t pMinLength, uint64_t pBasesInReads,
+            const ArenaPtr& pArena)
+    : mPImpl(new Impl(pName, pGraph, pLog, pOut, pMinLength, pBasesInReads,
+                      pArena))
 {
 }
 
@@ -39,9 +39,19 @@ class ResolveTranscripts
 public:
     enum { sMinReads = 4 };
 
+    // Scratch state, which grows to fit the largest component seen. A
+    // thread resolving one component after another can keep an Arena
+    // and pass it to each resolver, rather than allocating the scratch
+    // state afresh.
+    class Arena;
+    typedef std::shared_ptr<Arena> ArenaPtr;
+
+    static ArenaPtr makeArena();
+
     ResolveTranscripts(const std::string& pName, Graph& pGraph,
                         Logger& pLog, std::ostream& pOut,
-                        uint64_t pMinLength, uint64_t pMappableReads);
+                        uint64_t pMinLength, uint64_t pMappableReads,
+                        const ArenaPtr& pArena = ArenaPtr());
 
     ~ResolveTranscripts();
 
@@ -0,0 +1,266 @@
+// Copyright (c) 2008-1016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef RINGQUEUE_HH
+#define RINGQUEUE_HH
+
+#ifndef STD_THREAD
+#include <thread>
+#define STD_THREAD
+#endif
+
+#ifndef STD_MUTEX
+#include <mutex>
+#define STD_MUTEX
+#endif
+
+#ifndef STD_CONDITION_VARIABLE
+#include <condition_variable>
+#define STD_CONDITION_VARIABLE
+#endif
+
+#ifndef STD_ATOMIC
+#include <atomic>
+#define STD_ATOMIC
+#endif
+
+#ifndef STD_MEMORY
+#include <memory>
+#define STD_MEMORY
+#endif
+
+#ifndef STD_ALGORITHM
+#include <algorithm>
+#define STD_ALGORITHM
+#endif
+
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
+#ifndef EVENTCOUNT_HH
+#include "EventCount.hh"
+#endif
+
+#ifndef MPMCRING_HH
+#include "MpmcRing.hh"
+#endif
+
+#ifndef PROPERTIES_HH
+#include "Properties.hh"
+#endif
+
+#ifndef PROFILE_HH
+#include "Profile.hh"
+#endif
+
+// A queue of at most a fixed number of items (rounded up to a power
+// of two) between any number of producers and consumers, with the
+// same interface as BoundedQueue. The items are held in a lock-free
+// ring, and threads which find the ring full or empty spin and then
+// park (see EventCount).
+//
+// It is meant for queues shared by many threads on many cores, where
+// a mutex would be contended. BoundedQueue uses one when the process
+// asks for rings (see ThreadPlacement::ringQueues); benchBoundedQueue
+// compares the two.
+//
+// If W is set, the consumers waiting for items are counted, so that
+// sync() can wait for all the items put so far to be taken and dealt
+// with.
+//
+template <typename T, bool W = false>
+class RingQueue
+{
+public:
+    /**
+     * Put an item on to the shared queue.
+     * If the queue is at it maximum size, then wait until a place becomes available.
+     */
+    void put(const T& pItem)
+    {
+        Profile::Context pc("RingQueue::put");
+        if (!mRing.tryPush(pItem))
+        {
+            Profile::Context pc("RingQueue::put::wait");
+            mFullWaits.fetch_add(1, std::memory_order_relaxed);
+            mNotFull.await([&]() { return mRing.tryPush(pItem); });
+        }
+        mNotEmpty.notifyOne();
+    }
+
+    /**
+     * Put the items [pBegin, pEnd) on to the shared queue, in order,
+     * as many at a time as there is room for.
+     */
+    void put(const T* pBegin, const T* pEnd)
+    {
+        Profile::Context pc("RingQueue::put");
+        while (pBegin < pEnd)
+        {
+            uint64_t n = mRing.tryPush(pBegin, pEnd);
+            if (!n)
+            {
+                Profile::Context pc("RingQueue::put::wait");
+                mFullWaits.fetch_add(1, std::memory_order_relaxed);
+                mNotFull.await([&]() { return (n = mRing.tryPush(pBegin, pEnd)) > 0; });
+            }
+            pBegin += n;
+            if (n == 1)
+            {
+                mNotEmpty.notifyOne();
+            }
+            else
+            {
+                mNotEmpty.notifyAll();
+            }
+        }
+    }
+
+    /**
+     * Get an item from the shared queue.
+     * If there are no items, then wait for an item to arrive.
+     * If finish() is called, then don't retrieve an item, and
+     * return false, otherwise return true.
+     */
+    bool get(T& pItem)
+    {
+        Profile::Context pc("RingQueue::get");
+        if (mRing.tryPop(pItem))
+        {
+            mNotFull.notifyOne();
+            return true;
+        }
+        Profile::Context pcw("RingQueue::get::wait");
+        return wait(&pItem, 1) > 0;
+    }
+
+    /**
+     * Get some items from the shared queue: no more than a pShare'th
+     * of those waiting, but at least one. Otherwise as get().
+     */
+    bool get(std::vector<T>& pItems, uint64_t pShare)
+    {
+        Profile::Context pc("RingQueue::get");
+        const uint64_t n = std::max<uint64_t>(1, mRing.size() / std::max<uint64_t>(1, pShare));
+        pItems.resize(n);
+        uint64_t m = mRing.tryPop(pItems.data(), n);
+        if (m)
+        {
+            notifyNotFull(m);
+        }
+        else
+        {
+            Profile::Context pcw("RingQueue::get::wait");
+            m = wait(pItems.data(), 1);
+        }
+        pItems.resize(m);
+        return m > 0;
+    }
+
+    /**
+     * Indicate there are no more items coming.
+     */
+    void finish()
+    {
+        mFinished.store(true, std::memory_order_seq_cst);
+        mNotEmpty.notifyAll();
+    }
+
+    /**
+     * Block until pNumConsumers are blocked waiting for input.
+     */
+    void sync(uint64_t pNumConsumers)
+    {
+        BOOST_ASSERT(W);
+        mIdleChanged.await([&]() {
+            return mRing.empty() && mIdle.load(std::memory_order_seq_cst) >= pNumConsumers;
+        });
+    }
+
+    /**
+     * Retrieve information about the behaviour of the queue.
+     */
+    PropertyTree stat() const
+    {
+        PropertyTree t;
+        t.putProp("empty-waits", mEmptyWaits.load());
+        t.putProp("full-waits", mFullWaits.load());
+        return t;
+    }
+
+    RingQueue(uint64_t pMaxItems)
+        : mRing(pMaxItems), mFinished(false), mFullWaits(0), mEmptyWaits(0), mIdle(0)
+    {
+    }
+
+private:
+    void notifyNotFull(uint64_t pN)
+    {
+        if (pN == 1)
+        {
+            mNotFull.notifyOne();
+        }
+        else
+        {
+            mNotFull.notifyAll();
+        }
+    }
+
+    // Wait for up to pMax items, or for finish(). While it waits, the
+    // consumer counts as idle, except when it is trying to take an
+    // item: an item is never out of the ring and in no one's hands
+    // while the consumer is still counted.
+    uint64_t wait(T* pItems, uint64_t pMax)
+    {
+        mEmptyWaits.fetch_add(1, std::memory_order_relaxed);
+        setIdle(1);
+        uint64_t n = 0;
+        mNotEmpty.await([&]() {
+            const bool finished = mFinished.load(std::memory_order_seq_cst);
+            if (mRing.empty() && !finished)
+            {
+                return false;
+            }
+            setIdle(-1);
+            n = mRing.tryPop(pItems, pMax);
+            if (n || finished)
+            {
+                return true;
+            }
+            setIdle(1);
+            return false;
+        });
+        if (n)
+        {
+            notifyNotFull(n);
+        }
+        return n;
+    }
+
+    void setIdle(int64_t pDelta)
+    {
+        if (W)
+        {
+            mIdle.fetch_add(pDelta, std::memory_order_seq_cst);
+            mIdleChanged.notifyAll();
+        }
+    }
+
+    MpmcRing<T> mRing;
+    std::atomic<bool> mFinished;
+    EventCount mNotFull;
+    EventCount mNotEmpty;
+    EventCount mIdleChanged;
+    std::atomic<uint64_t> mFullWaits;
+    std::atomic<uint64_t> mEmptyWaits;
+    std::atomic<uint64_t> mIdle;
+};
+
+#endif // RINGQUEUE_HH
@@ -47,6 +47,11 @@
 #define STD_UNORDERED_MAP
 #endif
 
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
 template <typename T, typename V>
 class SimpleHashMap : public boost::noncopyable
 {
@@ -144,6 +149,8 @@ public:
         return insert(pItem, V());
     }
 
+    // Empty the map, in time proportional to the number of items
+    // inserted since it was last cleared.
     void clear();
 
     void swap(SimpleHashMap& pRhs)
@@ -154,6 +161,7 @@ public:
         std::swap(mGone, pRhs.mGone);
         std::swap(mItems, pRhs.mItems);
         std::swap(mValues, pRhs.mValues);
+        mUsedWords.swap(pRhs.mUsedWords);
     }
 
     uint64_t width() const
@@ -191,6 +199,9 @@ private:
     T* mItems;
     V* mValues;
     uint64_t mSize;
+
+    // The indexes of the words of mInUse with any bits set.
+    std::vector<uint64_t> mUsedWords;
 };
 
 
@@ -259,6 +270,10 @@ SimpleHashMap<T,V>::insert(const T& pItem, const V& pValue)
         }
     }
     ++mSize;
+    if (!mInUse[w])
+    {
+        mUsedWords.push_back(w);
+    }
     mInUse[w] |= 1ULL << b;
     mItems[i] = pItem;
     mValues[i] = pValue;
@@ -270,12 +285,14 @@ template <typename T, typename V>
 void
 SimpleHashMap<T,V>::clear()
 {
-    const uint64_t z = (width() + (sWordBits - 1)) / sWordBits;
-    for (uint64_t i = 0; i < z; ++i)
+    for (uint64_t i = 0; i < mUsedWords.size(); ++i)
     {
-        mInUse[i] = 0;
-        mGone[i] = 0;
+        const uint64_t w = mUsedWords[i];
+        mInUse[w] = 0;
+        mGone[w] = 0;
     }
+    mUsedWords.clear();
+    mSize = 0;
 }
 
 
@@ -8,6 +8,44 @@
 //
 #include "SparseArray.hh"
 
+#include "Debug.hh"
+
+#include <algorithm>
+
+namespace // anonymous
+{
+    Debug noLowBitsSamples("no-low-bits-samples",
+                           "build sparse arrays without samples of large low-order groups");
+
+    // Add the names of the files of the integer array pBaseName + pSuffix
+    // (one, or for a stacked array, those of its parts), as suffixes of
+    // pBaseName, to pFiles.
+    void integerArrayFiles(const std::string& pBaseName, const std::string& pSuffix,
+                           FileFactory& pFactory, uint64_t pDepthLeft, std::vector<std::string>& pFiles)
+    {
+        if (!pDepthLeft)
+        {
+            return;
+        }
+        if (pFactory.exists(pBaseName + pSuffix))
+        {
+            pFiles.push_back(pSuffix);
+            return;
+        }
+        integerArrayFiles(pBaseName, pSuffix + ".lwr", pFactory, pDepthLeft - 1, pFiles);
+        integerArrayFiles(pBaseName, pSuffix + ".upr", pFactory, pDepthLeft - 1, pFiles);
+    }
+
+    // The approximate size in bits of a sparse array of pM positions
+    // less than pN: the low bits at the width they are stored at, and
+    // in the high bits, a one for each position and a zero for each
+    // low-order group.
+    double arrayBits(const Gossamer::position_type& pN, uint64_t pM, uint64_t pD)
+    {
+        return double(pM) * (8 * ((pD + 7) / 8) + 1) + ldexp(pN.asDouble(), -int(pD));
+    }
+} // namespace anonymous
+
 SparseArray::Header::Header(uint64_t pD)
     : version(SparseArray::version), D(pD), quantizedD(8 * ((pD + 7) / 8)), DMask((position_type(1) << D) - 1),
       size(0), count(0)
@@ -21,7 +59,7 @@ SparseArray::Header::Header(const std::string& pFileName, FileFactory& pFactory)
     FileFactory::InHolderPtr headerFileHolder(pFactory.in(pFileName));
     std::istream& headerFile(**headerFileHolder);
     headerFile.read(reinterpret_cast<char*>(this), sizeof(Header));
-    if (version != SparseArray::version)
+    if (version != SparseArray::version && version != SparseArray::sampledVersion)
     {
         uint64_t v = SparseArray::version;
         BOOST_THROW_EXCEPTION(
@@ -44,6 +82,15 @@ SparseArray::Iterator::Iterator(const SparseArray& pArray)
 }
 
 
+SparseArray::Iterator::Iterator(const SparseArray& pArray, rank_type pBegin)
+    : mArray(&pArray),
+      mHiItr(pBegin < pArray.count() ? mArray->mHighBits.iterator1(mArray->mD1.select(pBegin))
+                                     : mArray->mHighBits.iterator1()),
+      mI(pBegin), mValid(pBegin < pArray.count())
+{
+}
+
+
 uint64_t
 SparseArray::Builder::d(const position_type& pN, rank_type pM)
 {
@@ -72,6 +119,23 @@ SparseArray::Builder::d(const position_type& pN, rank_type pM)
 }
 
 
+uint64_t
+SparseArray::Builder::fastD(const position_type& pN, rank_type pM, double pSpaceBudget)
+{
+    double least = arrayBits(pN, pM, 8);
+    for (uint64_t d = 9; d <= 128; ++d)
+    {
+        least = std::min(least, arrayBits(pN, pM, d));
+    }
+    uint64_t d = 8;
+    while (arrayBits(pN, pM, d) > least * (1 + pSpaceBudget))
+    {
+        ++d;
+    }
+    return d;
+}
+
+
 void
 SparseArray::Builder::end(const position_type& pN)
 {
@@ -96,21 +160,42 @@ SparseArray::Builder::end(const position_type& pN)
     mHighBitsFile.pad(mLastHighBit);
 
     mHighBitsFile.end();
-    mLowBitsFile.end();
+    mLowBitsFileHolder->end();
+    // Close the low bits, so they can be read back for the samples.
+    mLowBitsFileHolder = IntegerArray::BuilderPtr();
     mD0File.end();
     mD1File.end();
+
+    // The samples are only worth having if large groups are common,
+    // so they are written, from the low bits, only then.
+    if (!noLowBitsSamples.on() && mLargeGroupCount > 0
+        && (mLargeGroupCount * MinSampledShare >= mHeader.count
+            || mHeader.D >= d(pN, mHeader.count) + SampledDExcess))
+    {
+        IntegerArray::BuilderPtr samples(IntegerArray::builder(mHeader.quantizedD, samplesName(mBaseName), mFactory));
+        IntegerArray::LazyIteratorPtr i(IntegerArray::lazyIterator(mHeader.quantizedD, mBaseName + ".low-bits", mFactory));
+        for (uint64_t r = 0; i->valid(); ++r, ++(*i))
+        {
+            if ((r & (SampleRate - 1)) == 0)
+            {
+                samples->push_back(**i);
+            }
+        }
+        samples->end();
+        mHeader.version = sampledVersion;
+    }
     mHeaderFile.write(reinterpret_cast<const char*>(&mHeader), sizeof(mHeader));
 }
 
 
 SparseArray::Builder::Builder(const std::string& pBaseName,
                               FileFactory& pFactory, const position_type& pN, rank_type pM)
-    : mHeader(d(pN, pM)), mBitNum(0), mLastHighBit(0),
+    : mBaseName(pBaseName), mFactory(pFactory),
+      mHeader(d(pN, pM)), mGroup(0), mGroupSize(0), mLargeGroupCount(0), mBitNum(0), mLastHighBit(0),
       mHighBitsFile(pBaseName + ".high-bits", pFactory),
       mD0File(pBaseName + "-d0", pFactory, true),
       mD1File(pBaseName + "-d1", pFactory, false),
       mLowBitsFileHolder(IntegerArray::builder(mHeader.quantizedD, pBaseName + ".low-bits", pFactory)),
-      mLowBitsFile(*mLowBitsFileHolder),
       mHeaderFileHolder(pFactory.out(pBaseName + ".header")),
       mHeaderFile(**mHeaderFileHolder)
 {
@@ -119,12 +204,12 @@ SparseArray::Builder::Builder(const std::string& pBaseName,
 
 SparseArray::Builder::Builder(const std::string& pBaseName, FileFactory& pFactory,
                               uint64_t pD)
-    : mHeader(pD), mBitNum(0), mLastHighBit(0),
+    : mBaseName(pBaseName), mFactory(pFactory),
+      mHeader(pD), mGroup(0), mGroupSize(0), mLargeGroupCount(0), mBitNum(0), mLastHighBit(0),
       mHighBitsFile(pBaseName + ".high-bits", pFactory),
       mD0File(pBaseName + "-d0", pFactory, true),
       mD1File(pBaseName + "-d1", pFactory, false),
       mLowBitsFileHolder(IntegerArray::builder(mHeader.quantizedD, pBaseName + ".low-bits", pFactory)),
-      mLowBitsFile(*mLowBitsFileHolder),
       mHeaderFileHolder(pFactory.out(pBaseName + ".header")),
       mHeaderFile(**mHeaderFileHolder)
 {
@@ -139,6 +224,27 @@ SparseArray::LazyIterator::LazyIterator(const std::string& pBaseName, FileFactor
 {
 }
 
+uint64_t
+SparseArray::searchSamples(uint64_t pBegin, uint64_t pEnd, const position_type& pValue) const
+{
+    // Samples lo..hi are those of ranks in [pBegin, pEnd). The answer
+    // lies after the last sample less than the value, and no later
+    // than the first one which isn't.
+    const uint64_t lo = (pBegin + SampleRate - 1) / SampleRate;
+    const uint64_t hi = (pEnd + SampleRate - 1) / SampleRate;
+    const uint64_t c = mSamples->lower_bound(lo, hi, pValue.value());
+    if (c > lo)
+    {
+        pBegin = (c - 1) * SampleRate + 1;
+    }
+    if (c < hi)
+    {
+        pEnd = c * SampleRate;
+    }
+    return mLowBits.lower_bound(pBegin, pEnd, pValue.value());
+}
+
+
 PropertyTree
 SparseArray::stat() const
 {
@@ -147,8 +253,13 @@ SparseArray::stat() const
     t.putSub("low-bits", mLowBits.stat());
     t.putSub("D0", mD0.stat());
     t.putSub("D1", mD1.stat());
+    if (mSamples)
+    {
+        t.putSub("low-bits-samples", mSamples->stat());
+    }
 
     t.putProp("size", size());
+    t.putProp("D", mHeader.D);
     t.putProp("count", count());
 
     uint64_t s = sizeof(Header);
@@ -156,6 +267,10 @@ SparseArray::stat() const
     s += t("low-bits").as<uint64_t>("storage");
     s += t("D0").as<uint64_t>("storage");
     s += t("D1").as<uint64_t>("storage");
+    if (mSamples)
+    {
+        s += t("low-bits-samples").as<uint64_t>("storage");
+    }
     t.putProp("storage", s);
 
     return t;
@@ -169,6 +284,68 @@ SparseArray::remove(const std::string& pBaseName, FileFactory& pFactory)
     pFactory.remove(pBaseName + "-d0");
     pFactory.remove(pBaseName + "-d1");
     IntegerArray::remove(pBaseName + ".low-bits", pFactory);
+    IntegerArray::remove(samplesName(pBaseName), pFactory);
+}
+
+
+uint64_t
+SparseArray::retune(const std::string& pBaseName, FileFactory& pFactory, double pSpaceBudget)
+{
+    const Header h(pBaseName + ".header", pFactory);
+    const uint64_t best = Builder::d(h.size, h.count);
+    if (best + RetuneSlack >= h.D && best <= h.D + RetuneSlack)
+    {
+        return h.D;
+    }
+    const uint64_t d = Builder::fastD(h.size, h.count, pSpaceBudget);
+    if (d == h.D)
+    {
+        return h.D;
+    }
+
+    const std::string tmp = pBaseName + "-retune";
+    {
+        Builder b(tmp, pFactory, d);
+        for (LazyIterator i(pBaseName, pFactory); i.valid(); ++i)
+        {
+            b.push_back(*i);
+        }
+        b.end(h.size);
+    }
+
+    // Rename the new array over the old one, the header last, so the old
+    // one is never missing, then remove the files of the old one which
+    // the new one doesn't have (its samples, or low bits of another
+    // width).
+    const std::vector<std::string> olds(files(pBaseName, pFactory));
+    const std::vector<std::string> news(files(tmp, pFactory));
+    for (uint64_t i = 0; i < news.size(); ++i)
+    {
+        pFactory.rename(tmp + news[i], pBaseName + news[i]);
+    }
+    for (uint64_t i = 0; i < olds.size(); ++i)
+    {
+        if (std::find(news.begin(), news.end(), olds[i]) == news.end())
+        {
+            pFactory.remove(pBaseName + olds[i]);
+        }
+    }
+
+    return d;
+}
+
+
+std::vector<std::string>
+SparseArray::files(const std::string& pBaseName, FileFactory& pFactory)
+{
+    std::vector<std::string> fs;
+    fs.push_back(".high-bits");
+    fs.push_back("-d0");
+    fs.push_back("-d1");
+    integerArrayFiles(pBaseName, ".low-bits", pFactory, 8, fs);
+    integerArrayFiles(pBaseName, samplesName(""), pFactory, 8, fs);
+    fs.push_back(".header");
+    return fs;
 }
 
 
@@ -183,7 +360,7 @@ SparseArray::SparseArray(const std::string& pBaseName, FileFactory& pFactory)
     FileFactory::InHolderPtr headerFileHolder(pFactory.in(pBaseName + ".header"));
     std::istream& headerFile(**headerFileHolder);
     headerFile.read(reinterpret_cast<char*>(&mHeader), sizeof(Header));
-    if (mHeader.version != version)
+    if (mHeader.version != version && mHeader.version != sampledVersion)
     {
         uint64_t v = version;
         BOOST_THROW_EXCEPTION(
@@ -191,6 +368,10 @@ SparseArray::SparseArray(const std::string& pBaseName, FileFactory& pFactory)
                 << boost::errinfo_file_name(pBaseName)
                 << Gossamer::version_mismatch_info(std::pair<uint64_t,uint64_t>(mHeader.version, v)));
     }
+    if (mHeader.version == sampledVersion)
+    {
+        mSamples = IntegerArray::create(mHeader.quantizedD, samplesName(pBaseName), pFactory);
+    }
 }
 
 
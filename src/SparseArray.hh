@@ -39,6 +39,11 @@
 #define BOOST_NUMERIC_CONVERSION_CAST_HPP
 #endif
 
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
 class SparseArray
 {
 public:
@@ -57,6 +62,28 @@ private:
     // 2010090801   - introduce version tracking.
     // 2012030501   - don't quantize d.
 
+    // Arrays in which large low-order groups (more than MinSampledGroup
+    // positions sharing their high bits) are common, as when D is well
+    // above the best D for the number of positions, or the positions
+    // are clumped, also keep every SampleRate'th low bits, in an
+    // integer array as wide as the low bits, and carry this version.
+    // Searching a large group bisects the samples, which are a
+    // sixteenth the size of the low bits and so mostly stay in cache,
+    // then the run of SampleRate low bits between two of them, rather
+    // than bisecting the group's low bits directly, which touches a new
+    // cache line (and on a large array, a new page) at every step. The
+    // low bits themselves stay in rank order, so select is unchanged.
+    // The samples cost quantizedD / SampleRate bits per position, so
+    // they are kept only if at least one position in MinSampledShare
+    // lies in a large group, or D is at least SampledDExcess above
+    // Builder::d. The builder decides at the end, and only then
+    // writes the samples, from the low bits.
+    static const uint64_t sampledVersion = 2016122201ULL;
+    static const uint64_t SampleRate = 16;
+    static const uint64_t MinSampledGroup = 256;
+    static const uint64_t MinSampledShare = 8;
+    static const uint64_t SampledDExcess = 8;
+
     struct Header
     {
         uint64_t version;
@@ -94,7 +121,18 @@ public:
                 throw "SparseArray::end()";
             }
 
-            rank_type h(nd.asUInt64());
+            const uint64_t g = nd.asUInt64();
+            if (g != mGroup || !mHeader.count)
+            {
+                mGroup = g;
+                mGroupSize = 0;
+            }
+            if (++mGroupSize > MinSampledGroup)
+            {
+                mLargeGroupCount += mGroupSize == MinSampledGroup + 1 ? mGroupSize : 1;
+            }
+
+            rank_type h(g);
             h += mBitNum;
             ++mBitNum;
 
@@ -110,7 +148,7 @@ public:
             mLastHighBit = ++h;
 
             IntegerArray::value_type l = (pBitPos & mHeader.DMask).value();
-            mLowBitsFile.push_back(l);
+            mLowBitsFileHolder->push_back(l);
 
             BOOST_ASSERT(pBitPos >= mHeader.size);
             mHeader.size = pBitPos + 1;
@@ -123,17 +161,31 @@ public:
 
         Builder(const std::string& pBaseName, FileFactory& pFactory, uint64_t pD);
 
-    private:
+        // The D which makes an array of pM positions less than pN
+        // smallest.
         static uint64_t d(const position_type& pN, rank_type pM);
 
+        // The D which makes rank over an array of pM positions less
+        // than pN fastest (the smallest D, so the smallest low-order
+        // groups) while the array is at most pSpaceBudget (a fraction)
+        // larger than at its smallest. Unlike d, this counts the low
+        // bits at the width they are stored at, so with no budget it
+        // may still be below d.
+        static uint64_t fastD(const position_type& pN, rank_type pM, double pSpaceBudget);
+
+    private:
+        const std::string mBaseName;
+        FileFactory& mFactory;
         Header mHeader;
+        uint64_t mGroup;
+        uint64_t mGroupSize;
+        uint64_t mLargeGroupCount;
         rank_type mBitNum;
         rank_type mLastHighBit;
         WordyBitVector::Builder mHighBitsFile;
         DenseSelect::Builder mD0File;
         DenseSelect::Builder mD1File;
         IntegerArray::BuilderPtr mLowBitsFileHolder;
-        IntegerArray::Builder& mLowBitsFile;
         FileFactory::OutHolderPtr mHeaderFileHolder;
         std::ostream& mHeaderFile;
     };
@@ -179,6 +231,8 @@ public:
         bool mValid;
 
         Iterator(const SparseArray& pArray);
+
+        Iterator(const SparseArray& pArray, rank_type pBegin);
     };
 
     // TODO: Consolidate with Iterator
@@ -228,6 +282,12 @@ public:
         return Iterator(*this);
     }
 
+    // Iterate over the positions from the one of rank pBegin on.
+    Iterator iterator(rank_type pBegin) const
+    {
+        return Iterator(*this, pBegin);
+    }
+
     static LazyIterator lazyIterator(const std::string& pBaseName, FileFactory& pFactory)
     {
         return LazyIterator(pBaseName, pFactory);
@@ -337,6 +397,23 @@ public:
 
     static void remove(const std::string& pBaseName, FileFactory& pFactory);
 
+    // The second pass of a two pass build. Builders which take a count
+    // of positions choose D for it, so when that is only an estimate,
+    // as when a graph is built from one with edges yet to be trimmed,
+    // D may be far from the D (Builder::d) of the array's real count:
+    // too large, and the low-order groups grow, slowing rank; too small,
+    // and the high bits grow, slowing select. Either way the array is
+    // larger than need be. If the two differ by more than RetuneSlack,
+    // rebuild the array with the D from Builder::fastD for the real
+    // count and pSpaceBudget (recorded in its header, like any other).
+    // Returns the array's D.
+    static uint64_t retune(const std::string& pBaseName, FileFactory& pFactory,
+                           double pSpaceBudget = 0);
+
+    // Within a bit either way of its best D, an array is at most about
+    // half a bit per position larger, which isn't worth a second pass.
+    static const uint64_t RetuneSlack = 1;
+
     SparseArray(const std::string& pBaseName, FileFactory& pFactory);
 
     ~SparseArray();
@@ -365,15 +442,31 @@ private:
 
     uint64_t searchLowBits(uint64_t pBegin, uint64_t pEnd, const position_type& pValue) const
     {
+        if (pEnd - pBegin > MinSampledGroup && mSamples)
+        {
+            return searchSamples(pBegin, pEnd, pValue);
+        }
         return mLowBitsHolder->lower_bound(pBegin, pEnd, pValue.value());
     }
 
+    uint64_t searchSamples(uint64_t pBegin, uint64_t pEnd, const position_type& pValue) const;
+
+    static std::string samplesName(const std::string& pBaseName)
+    {
+        return pBaseName + ".low-bits-samples";
+    }
+
+    // The names of the files of an array, as suffixes of its base name,
+    // with the header last.
+    static std::vector<std::string> files(const std::string& pBaseName, FileFactory& pFactory);
+
     Header mHeader;
     const WordyBitVector mHighBits;
     const DenseSelect mD0;
     const DenseSelect mD1;
     IntegerArrayPtr mLowBitsHolder;
     const IntegerArray& mLowBits;
+    IntegerArrayPtr mSamples;
 };
 
 #endif // SPARSEARRAY_HH
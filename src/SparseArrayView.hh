@@ -129,6 +129,12 @@ public:
     {
         return mArray.size();
     }
+
+    // The underlying array, including any removed positions.
+    const SparseArray& array() const
+    {
+        return mArray;
+    }
     
     rank_type count() const
     {
@@ -106,6 +106,7 @@ public:
     StringMappedHolder(const string& pFileName, const string& pContent)
         : mFileName(pFileName), mContent(pContent)
     {
+        account(mContent.size());
     }
 
 private:
@@ -182,6 +183,23 @@ StringFileFactory::copy(const std::string& pFrom, const std::string& pTo) const
     mFiles[pTo] = i->second;
 }
 
+// Rename a file, replacing the target if it exists.
+//
+void
+StringFileFactory::rename(const std::string& pFrom, const std::string& pTo) const
+{
+    std::map<string,string>::iterator i;
+    i = mFiles.find(pFrom);
+    if (i == mFiles.end())
+    {
+        BOOST_THROW_EXCEPTION(
+            Gossamer::error()
+                << errinfo_file_name(pFrom));
+    }
+    mFiles[pTo] = i->second;
+    mFiles.erase(i);
+}
+
 
 // True iff the file exists.
 //
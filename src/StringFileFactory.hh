@@ -40,6 +40,9 @@ public:
     // Copy a file.
     virtual void copy(const std::string& pFrom, const std::string& pTo) const;
 
+    // Rename a file, replacing the target if it exists.
+    virtual void rename(const std::string& pFrom, const std::string& pTo) const;
+
     // Return true iff a file exists.
     virtual bool exists(const std::string& pFileName) const;
 
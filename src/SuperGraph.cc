@@ -10,6 +10,7 @@
 #include "IndexedBinaryHeap.hh"
 #include "ProgressMonitor.hh"
 #include "SuperGraph.hh"
+#include "UnitigIndex.hh"
 
 using namespace std;
 using namespace boost;
@@ -172,6 +173,25 @@ namespace // anonymous
         uint64_t mNumEdges;
     };
 
+    // Visit the edges of the linear segment starting at pBegin, reading
+    // them from the unitig index if there is one.
+    template <typename Visitor>
+    void linearPath(const Graph& pG, const UnitigIndex* pUnitigs,
+                    const Graph::Edge& pBegin, Visitor& pVis)
+    {
+        if (!pUnitigs)
+        {
+            pG.linearPath(pBegin, pVis);
+            return;
+        }
+        const uint64_t u = pUnitigs->unitig(pG.rank(pBegin)).first;
+        for (uint64_t p = pUnitigs->begin(u); p < pUnitigs->end(u); ++p)
+        {
+            const uint64_t r = pUnitigs->edge(p);
+            pVis(pG.select(r), r);
+        }
+    }
+
     class ContigPrinter
     {
     public:
@@ -199,7 +219,7 @@ namespace // anonymous
                 else
                 {
                     EntryEdgeSet::Edge e(entries.select(s.linearPath()));
-                    mG.linearPath(Graph::Edge(e.value()), vis);
+                    linearPath(mG, mUnitigs, Graph::Edge(e.value()), vis);
                 }
 
                 // Header info
@@ -250,9 +270,10 @@ namespace // anonymous
             }
         }
 
-        ContigPrinter(const Graph& pG, const SuperGraph& pSg, mutex& pMut, ostream& pOut, 
-                      uint64_t pMinLength, uint64_t pCols, bool pOmitSequence, bool pVerboseHeaders)
-            : mG(pG), mSg(pSg), mMut(pMut), mOut(pOut), mMinLength(pMinLength), mCols(pCols),
+        ContigPrinter(const Graph& pG, const UnitigIndex* pUnitigs, const SuperGraph& pSg,
+                      mutex& pMut, ostream& pOut, uint64_t pMinLength, uint64_t pCols,
+                      bool pOmitSequence, bool pVerboseHeaders)
+            : mG(pG), mUnitigs(pUnitigs), mSg(pSg), mMut(pMut), mOut(pOut), mMinLength(pMinLength), mCols(pCols),
               mOmitSequence(pOmitSequence), mVerboseHeaders(pVerboseHeaders)
         {
         }
@@ -260,6 +281,7 @@ namespace // anonymous
     private:
 
         const Graph& mG;
+        const UnitigIndex* mUnitigs;
         const SuperGraph& mSg;
         mutex& mMut;
         ostream& mOut;
@@ -736,6 +758,8 @@ SuperGraph::printContigs(const std::string& pBaseName, FileFactory& pFactory,
     GraphPtr gPtr = Graph::open(pBaseName, pFactory);
     Graph& g(*gPtr);
 
+    UnitigIndexPtr unitigs = UnitigIndex::open(pBaseName + "-unitigs", g, pFactory, pLogger);
+
     unordered_set<SuperPathId> entailed;
 
     // Calculate entailed SuperPaths.
@@ -827,7 +851,7 @@ SuperGraph::printContigs(const std::string& pBaseName, FileFactory& pFactory,
     for (uint64_t i = 0; i < pNumThreads; ++i)
     {
         // printers.push_back();
-        printers.push_back(ContigPrinterPtr(new ContigPrinter(g, *this, mut, pOut, pMinLength, cols, pOmitSequence, pVerboseHeaders)));
+        printers.push_back(ContigPrinterPtr(new ContigPrinter(g, unitigs.get(), *this, mut, pOut, pMinLength, cols, pOmitSequence, pVerboseHeaders)));
         grp.add(*printers.back());
     }
 
@@ -14,6 +14,11 @@
 #define STD_THREAD
 #endif
 
+#ifndef STD_MEMORY
+#include <memory>
+#define STD_MEMORY
+#endif
+
 #ifndef STD_MUTEX
 #include <mutex>
 #define STD_MUTEX
@@ -29,6 +34,10 @@
 #define BOOST_NONCOPYABLE_HPP
 #endif
 
+#ifndef THREADPLACEMENT_HH
+#include "ThreadPlacement.hh"
+#endif
+
 class ThreadGroup : private boost::noncopyable
 {
 public:
@@ -55,6 +64,18 @@ public:
         return t;
     }
 
+    // Create worker pWorker of a pool of pWorkers (0 if the size isn't
+    // known), placed according to ThreadPlacement::process().
+    template<typename F>
+    std::thread*
+    create(F pFunc, uint64_t pWorker, uint64_t pWorkers)
+    {
+        return create([pFunc, pWorker, pWorkers] () mutable {
+            ThreadPlacement::process().place(pWorker, pWorkers);
+            pFunc();
+        });
+    }
+
     void
     join()
     {
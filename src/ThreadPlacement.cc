@@ -0,0 +1,131 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "ThreadPlacement.hh"
+
+#include "Utils.hh"
+
+using namespace std;
+
+namespace // anonymous
+{
+    // Render an ascending list of processors as ranges, e.g. "0-3,8".
+    string ranges(const vector<uint32_t>& pXs)
+    {
+        string s;
+        for (uint64_t i = 0; i < pXs.size(); )
+        {
+            uint64_t j = i + 1;
+            while (j < pXs.size() && pXs[j] == pXs[j - 1] + 1)
+            {
+                ++j;
+            }
+            s += (s.empty() ? "" : ",") + to_string(pXs[i]);
+            if (j - i > 1)
+            {
+                s += "-" + to_string(pXs[j - 1]);
+            }
+            i = j;
+        }
+        return s;
+    }
+} // namespace anonymous
+
+uint64_t
+ThreadPlacement::node(uint64_t pWorker, uint64_t pWorkers) const
+{
+    if (pWorkers == 0)
+    {
+        return pWorker % mNodes.size();
+    }
+    return (pWorker % pWorkers) * mNodes.size() / pWorkers;
+}
+
+uint32_t
+ThreadPlacement::claim(uint64_t pWorker, uint64_t pWorkers)
+{
+    const uint64_t n = node(pWorker, pWorkers);
+    const vector<uint32_t>& ps(mNodes[n]);
+    return ps[mNext[n].fetch_add(1, std::memory_order_relaxed) % ps.size()];
+}
+
+bool
+ThreadPlacement::place(uint64_t pWorker, uint64_t pWorkers)
+{
+    return mPinning && Gossamer::pinThread(claim(pWorker, pWorkers));
+}
+
+string
+ThreadPlacement::describe() const
+{
+    string s = to_string(mProcessors) + (mProcessors == 1 ? " processor" : " processors")
+             + " on " + to_string(mNodes.size()) + (mNodes.size() == 1 ? " memory node" : " memory nodes");
+    for (uint64_t i = 0; i < mNodes.size(); ++i)
+    {
+        s += (i ? "; " : ": ") + ranges(mNodes[i]);
+    }
+    return s;
+}
+
+string
+ThreadPlacement::describe(uint64_t pWorkers) const
+{
+    string s;
+    for (uint64_t n = 0; n < mNodes.size(); ++n)
+    {
+        vector<uint32_t> ws;
+        for (uint64_t w = 0; w < pWorkers; ++w)
+        {
+            if (node(w, pWorkers) == n)
+            {
+                ws.push_back(w);
+            }
+        }
+        if (ws.empty())
+        {
+            continue;
+        }
+        s += (s.empty() ? "" : "; ") + string("workers ") + ranges(ws)
+           + " on node " + to_string(mNodeNumbers[n]) + " (processors " + ranges(mNodes[n]) + ")";
+    }
+    return s;
+}
+
+ThreadPlacement&
+ThreadPlacement::process()
+{
+    static ThreadPlacement placement(Gossamer::processorsByNode());
+    return placement;
+}
+
+ThreadPlacement::ThreadPlacement(const Nodes& pNodes)
+    : mNodes(), mProcessors(0), mPinning(false), mRingQueues(false)
+{
+    // Workers are spread over the nodes with processors, but logged
+    // with the node's own number.
+    for (uint64_t i = 0; i < pNodes.size(); ++i)
+    {
+        if (!pNodes[i].empty())
+        {
+            mNodes.push_back(pNodes[i]);
+            mNodeNumbers.push_back(i);
+        }
+    }
+    if (mNodes.empty())
+    {
+        mNodes.push_back(vector<uint32_t>(1, 0));
+        mNodeNumbers.push_back(0);
+    }
+    mNext.reset(new std::atomic<uint64_t>[mNodes.size()]);
+    for (uint64_t i = 0; i < mNodes.size(); ++i)
+    {
+        mProcessors += mNodes[i].size();
+        mNext[i].store(0, std::memory_order_relaxed);
+    }
+    mRingQueues = mProcessors > ringProcessors;
+}
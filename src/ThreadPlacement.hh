@@ -0,0 +1,141 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef THREADPLACEMENT_HH
+#define THREADPLACEMENT_HH
+
+#ifndef STDINT_H
+#include <stdint.h>
+#define STDINT_H
+#endif
+
+#ifndef STD_ATOMIC
+#include <atomic>
+#define STD_ATOMIC
+#endif
+
+#ifndef STD_MEMORY
+#include <memory>
+#define STD_MEMORY
+#endif
+
+#ifndef STD_STRING
+#include <string>
+#define STD_STRING
+#endif
+
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
+// Where the worker threads of a process run: which processors it may
+// use, which memory node each belongs to, and whether workers should
+// be pinned to them (--pin-threads).
+//
+// The workers of a pool are dealt out to the nodes in blocks, so that
+// workers 0..n/2 of a pool of n run on the first of two nodes and the
+// rest on the second. Pools whose workers take consecutive ranges of
+// a graph or k-mer set (see MultithreadedBatchTask) thus keep
+// neighbouring ranges on one node, and pages of lazily mapped files
+// land on the node of the worker which first reads them. Workers of
+// pools of unknown size are dealt out round robin.
+//
+// Within a node, processors are handed out in turn to the workers of
+// all pools, so pools running at the same time don't pile onto the
+// node's first few processors.
+//
+// Without pinning, placement changes nothing; the operating system
+// schedules threads as it always has.
+//
+// It also says how threads pass work to each other: through queues
+// guarded by a mutex, or through lock-free rings (--queues). Rings are
+// the default on machines with more than ringProcessors processors,
+// where many threads contend for a queue's mutex.
+//
+class ThreadPlacement
+{
+public:
+    // The processors of each memory node, indexed by node number.
+    typedef std::vector<std::vector<uint32_t> > Nodes;
+
+    // The number of processors the process may run on, which is the
+    // number of threads --num-threads auto asks for.
+    uint64_t processors() const
+    {
+        return mProcessors;
+    }
+
+    // The number of memory nodes with processors the process may use.
+    uint64_t nodes() const
+    {
+        return mNodes.size();
+    }
+
+    // True iff workers are to be pinned to processors.
+    bool pinning() const
+    {
+        return mPinning;
+    }
+
+    void pinning(bool pPinning)
+    {
+        mPinning = pPinning;
+    }
+
+    // True iff BoundedQueue and WorkQueue are to use lock-free rings.
+    bool ringQueues() const
+    {
+        return mRingQueues;
+    }
+
+    void ringQueues(bool pRingQueues)
+    {
+        mRingQueues = pRingQueues;
+    }
+
+    // Above this many processors, queues use rings by default.
+    static const uint64_t ringProcessors = 16;
+
+    // The node for worker pWorker of a pool of pWorkers, or of a pool
+    // of unknown size if pWorkers is 0.
+    uint64_t node(uint64_t pWorker, uint64_t pWorkers) const;
+
+    // Take the next processor of the node for worker pWorker of a
+    // pool of pWorkers.
+    uint32_t claim(uint64_t pWorker, uint64_t pWorkers);
+
+    // Pin the calling thread, worker pWorker of a pool of pWorkers, to
+    // a processor of its node, if pinning is on. Returns true if it was
+    // pinned.
+    bool place(uint64_t pWorker, uint64_t pWorkers);
+
+    // A description of the nodes and their processors, for the log.
+    std::string describe() const;
+
+    // A description of which nodes the workers of a pool of pWorkers
+    // go to.
+    std::string describe(uint64_t pWorkers) const;
+
+    // The placement for the whole process, from the machine's topology.
+    static ThreadPlacement& process();
+
+    explicit ThreadPlacement(const Nodes& pNodes);
+
+private:
+    Nodes mNodes;
+    std::vector<uint64_t> mNodeNumbers;
+    uint64_t mProcessors;
+    bool mPinning;
+    bool mRingQueues;
+
+    // The next processor to hand out on each node.
+    std::unique_ptr<std::atomic<uint64_t>[]> mNext;
+};
+
+#endif // THREADPLACEMENT_HH
@@ -11,12 +11,13 @@
 #include "ProgressMonitor.hh"
 #include "SimpleHashSet.hh"
 #include "MultithreadedBatchTask.hh"
+#include "ThreadGroup.hh"
+#include <atomic>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
 #include <iostream>
 #include <boost/lexical_cast.hpp>
-#include <boost/function_output_iterator.hpp>
 #include <boost/tuple/tuple_io.hpp>
 
 #undef VERBOSE_DEBUG
@@ -64,7 +65,6 @@ struct TourBus::Impl
     void doSingleNode(const Graph::Node& pBegin);
 
     typedef map<uint64_t,Graph::Edge> path_predecessor_t;
-    path_predecessor_t mPredecessors;
 
     struct LinearPathInfo
     {
@@ -95,14 +95,6 @@ struct TourBus::Impl
 
     void doWholeGraph();
 
-    void doNode(float pTime, uint32_t pDistance, uint64_t pNodeRnk);
-
-    void doPath(float pOriginTime, uint32_t pOriginDistance, const LinearPathInfo& pPath);
-
-    void analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin);
-
-    bool isOnPredecessorChain(const Graph::Edge& pEnd, const Graph::Edge& pBegin) const;
-
     uint64_t rank(const Graph::Node& pNode) const
     {
         vector<Graph::Node>::const_iterator i = lower_bound(mNodes.begin(), mNodes.end(), pNode);
@@ -197,6 +189,62 @@ struct TourBus::Impl
         }
     };
 
+    // A single tour: the Dijkstra-like search from one start node.
+    // Tours never write to the shared trimmer directly. Their deletions
+    // are recorded in mEdits and folded in by commit(), so several tours
+    // may run concurrently against the same trimmer.
+    struct Tour
+    {
+        Impl& mBus;
+        const Graph& mGraph;
+        uint64_t mStartRank;
+        path_predecessor_t mPredecessors;
+        dist_map_t mDistance;
+        WorkQueue mWorkQueue;
+        GraphTrimmer::Delta mEdits;
+        vector<uint64_t> mClaims;
+        uint64_t mPasses;
+        uint64_t mPending;
+        bool mAbandoned;
+        bool mRetry;
+        uint64_t mPotentialBubblesConsidered;
+        uint64_t mBubblesRemoved;
+        uint64_t mPathsRemoved;
+
+        bool edgeDeleted(uint64_t pEdgeRank) const
+        {
+            return mBus.mTrimmer.edgeDeleted(pEdgeRank)
+                || mEdits.edgeDeleted(pEdgeRank);
+        }
+
+        void run(uint64_t pMaxPasses);
+
+        void doNode(float pTime, uint32_t pDistance, uint64_t pNodeRnk);
+
+        void doPath(float pOriginTime, uint32_t pOriginDistance, const LinearPathInfo& pPath);
+
+        void analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin);
+
+        bool isOnPredecessorChain(const Graph::Edge& pEnd, const Graph::Edge& pBegin) const;
+
+        Tour(Impl& pBus, uint64_t pStartRank)
+            : mBus(pBus), mGraph(pBus.mGraph), mStartRank(pStartRank),
+              mPasses(0), mPending(0), mAbandoned(false), mRetry(false),
+              mPotentialBubblesConsidered(0), mBubblesRemoved(0),
+              mPathsRemoved(0)
+        {
+        }
+    };
+    typedef std::shared_ptr<Tour> TourPtr;
+
+    void commit(Tour& pTour);
+
+    void runBatch(vector<TourPtr>& pBatch, uint64_t pMaxPasses,
+                  deque<TourPtr>& pRetries);
+
+    static const uint64_t kToursPerThread = 64;
+    static const uint64_t kUnowned = ~uint64_t(0);
+
     const Graph& mGraph;
     Logger& mLog;
     GraphTrimmer mTrimmer;
@@ -208,13 +256,13 @@ struct TourBus::Impl
     bool mDoRelCutoffCheck;
     double mRelCutoff;
     uint64_t mNumThreads;
-    WorkQueue mWorkQueue;
     vector<Graph::Node> mNodes;
-    dist_map_t mDistance;
+    std::unique_ptr<std::atomic<uint64_t>[]> mOwners;
     uint64_t mPotentialBubblesConsidered;
     uint64_t mBubblesRemoved;
     uint64_t mPathsRemoved;
     uint64_t mEdgesRemoved;
+    uint64_t mToursRetried;
 
     Impl(const Graph& pGraph, Logger& pLog);
 
@@ -359,14 +407,13 @@ TourBus::Impl::Impl(const Graph& pGraph, Logger& pLog)
     mBubblesRemoved = 0;
     mPathsRemoved = 0;
     mEdgesRemoved = 0;
+    mToursRetried = 0;
 }
 
 
 void
 TourBus::Impl::findStartNodes(deque<StartNodeItem>& pStartNodeQueue)
 {
-    using namespace std::placeholders;
-
     uint64_t N = mGraph.count();
     uint64_t J = mNumThreads;
     uint64_t S = N / J;
@@ -426,17 +473,8 @@ TourBus::Impl::findStartNodes(deque<StartNodeItem>& pStartNodeQueue)
         b.swap(nodeRuns.front());
         nodeRuns.pop_front();
 
-        // cast to a specific overload function of push_back
-        // this is mainly due to:
-        //   deque<T>::push_back(const T&)
-        //   deque<T>::push_back(T&&) // C++11 move semantic
-        // being unresolvable.
-        void (deque<Graph::Node>:: *dequePushBaskConstRef)(const Graph::Node&) = &deque<Graph::Node>::push_back;
-
         deque<Graph::Node> c;
-        merge(a.begin(), a.end(), b.begin(), b.end(),
-              make_function_output_iterator(
-                  std::bind(dequePushBaskConstRef, std::ref(c), _1)));
+        merge(a.begin(), a.end(), b.begin(), b.end(), back_inserter(c));
 
         nodeRuns.push_back(deque<Graph::Node>());
         nodeRuns.back().swap(c);
@@ -471,17 +509,8 @@ TourBus::Impl::findStartNodes(deque<StartNodeItem>& pStartNodeQueue)
             b.swap(nodeRuns.front());
             nodeRuns.pop_front();
 
-            // cast to a specific overload function of push_back
-            // this is mainly due to:
-            //   vector<T>::push_back(const T&)
-            //   vector<T>::push_back(T&&) // C++11 move semantic
-            // being unresolvable.
-            void (vector<Graph::Node>:: *vectorPushBaskConstRef)(const Graph::Node&) = &vector<Graph::Node>::push_back;
-
             mNodes.reserve(a.size() + b.size());
-            merge(a.begin(), a.end(), b.begin(), b.end(),
-                  make_function_output_iterator(
-                      std::bind(vectorPushBaskConstRef, std::ref(mNodes), _1)));
+            merge(a.begin(), a.end(), b.begin(), b.end(), back_inserter(mNodes));
             break;
         }
 
@@ -496,6 +525,15 @@ TourBus::Impl::findStartNodes(deque<StartNodeItem>& pStartNodeQueue)
 
     mNodes.erase(unique(mNodes.begin(), mNodes.end()), mNodes.end());
 
+    if (mNumThreads > 1)
+    {
+        mOwners.reset(new std::atomic<uint64_t>[mNodes.size()]);
+        for (uint64_t i = 0; i < mNodes.size(); ++i)
+        {
+            mOwners[i] = kUnowned;
+        }
+    }
+
     while (startNodeRuns.size() > 1)
     {
         deque<StartNodeItem> a;
@@ -505,17 +543,8 @@ TourBus::Impl::findStartNodes(deque<StartNodeItem>& pStartNodeQueue)
         b.swap(startNodeRuns.front());
         startNodeRuns.pop_front();
 
-        // cast to a specific overload function of push_back
-        // this is mainly due to:
-        //   vector<T>::push_back(const T&)
-        //   vector<T>::push_back(T&&) // C++11 move semantic
-        // being unresolvable.
-        void (deque<StartNodeItem>:: *dequePushBaskConstRef)(const StartNodeItem&) = &deque<StartNodeItem>::push_back;
-
         deque<StartNodeItem> c;
-        merge(a.begin(), a.end(), b.begin(), b.end(),
-              make_function_output_iterator(
-                  std::bind(dequePushBaskConstRef, std::ref(c), _1)));
+        merge(a.begin(), a.end(), b.begin(), b.end(), back_inserter(c));
 
         startNodeRuns.push_back(deque<StartNodeItem>());
         startNodeRuns.back().swap(c);
@@ -571,54 +600,69 @@ TourBus::Impl::doWholeGraph()
     uint64_t j = 0;
     const uint64_t maxPasses = 10000ull;
 
+    // Tours are run in batches. With a single thread a batch holds one
+    // tour, which reproduces the classic serial algorithm. Otherwise the
+    // tours in a batch run concurrently against the trimmer as it stood
+    // at the start of the batch, and each claims the nodes it touched.
+    // A tour which touched a node also claimed by an earlier tour in the
+    // same batch is discarded, with those after it, and they are retried
+    // at the head of the next batch, so the result is that of the serial
+    // algorithm.
+    const uint64_t batchSize
+        = mNumThreads > 1 ? mNumThreads * kToursPerThread : 1;
+
     mLog(info, "Pass 2: Popping bubbles.");
     ProgressMonitorNew examineMon(mLog, startNodeQueue.size());
     std::map<uint64_t,uint64_t> passCountMap;
-    while (!startNodeQueue.empty())
+    deque<TourPtr> retries;
+    vector<TourPtr> batch;
+    batch.reserve(batchSize);
+    while (!startNodeQueue.empty() || !retries.empty())
     {
-        examineMon.tick(j++);
-        Graph::Node n = startNodeQueue.back().second;
-        uint64_t nRank = rank(n);
-        mPredecessors.clear();
-        mDistance.clear();
-        mWorkQueue.clear();
-        mDistance[nRank] = 0;
-        startNodeQueue.pop_back();
-#ifdef VERBOSE_DEBUG
-        cerr << "Inserting initial work queue node " << nRank << "\n";
-#endif
-        mWorkQueue.insert(0, nRank, 0);
-        uint64_t passes = 0ull;
-        while (!mWorkQueue.empty())
+        batch.clear();
+        while (batch.size() < batchSize && !retries.empty())
+        {
+            batch.push_back(retries.front());
+            retries.pop_front();
+        }
+        while (batch.size() < batchSize && !startNodeQueue.empty())
         {
-            WorkItem item = mWorkQueue.get();
-            uint64_t nn = item.get<0>();
+            Graph::Node n = startNodeQueue.back().second;
+            startNodeQueue.pop_back();
 #ifdef VERBOSE_DEBUG
-            cerr << "Getting minimum work queue node " << nn << "\n";
+            cerr << "Inserting initial work queue node " << rank(n) << "\n";
 #endif
-            float time = item.get<1>();
-            float distance = item.get<2>();
-#ifdef VERBOSE_DEBUG
+            batch.push_back(TourPtr(new Tour(*this, rank(n))));
+        }
+
+        if (batch.size() == 1)
+        {
+            batch.front()->run(maxPasses);
+        }
+        else
+        {
+            runBatch(batch, maxPasses, retries);
+        }
+
+        for (uint64_t i = 0; i < batch.size(); ++i)
+        {
+            Tour& tour(*batch[i]);
+            if (tour.mRetry)
             {
-                SmallBaseVector v_n;
-                mGraph.seq(mNodes[nn], v_n);
-                cerr << "Examining node " << v_n << " with time " << time << " and distance " << distance << "\n";
+                continue;
             }
-            cerr << "Removing minimum work queue node " << nn << "\n";
-#endif
-            mWorkQueue.removeMinimum();
-            doNode(time, distance, nn);
-            if (++passes > maxPasses)
+            examineMon.tick(j++);
+            if (tour.mAbandoned)
             {
                 SmallBaseVector v_n;
-                mGraph.seq(n, v_n);
-                mLog(warning, "Potential problem with node " + lexical_cast<string>(v_n) + " (rank " + lexical_cast<string>(nRank) + ")");
-                mLog(warning, "Processing will take at least " + lexical_cast<string>(passes + mWorkQueue.size()) + " passes.");
+                mGraph.seq(mNodes[tour.mStartRank], v_n);
+                mLog(warning, "Potential problem with node " + lexical_cast<string>(v_n) + " (rank " + lexical_cast<string>(tour.mStartRank) + ")");
+                mLog(warning, "Processing will take at least " + lexical_cast<string>(tour.mPasses + tour.mPending) + " passes.");
                 mLog(warning, "Abandoning this node just in case.");
-                break;
             }
+            ++passCountMap[tour.mPasses];
+            commit(tour);
         }
-        ++passCountMap[passes];
     }
 #if 0
     mLog(info, "Pass count histogram: ");
@@ -629,8 +673,6 @@ TourBus::Impl::doWholeGraph()
                    + "\t" + lexical_cast<string>(ii->second));
     }
 #endif
-    mDistance.clear();
-    mPredecessors.clear();
 
     mEdgesRemoved = mTrimmer.removedEdgesCount();
 
@@ -638,6 +680,10 @@ TourBus::Impl::doWholeGraph()
     mLog(info, "  bubbles popped: " + lexical_cast<string>(mBubblesRemoved));
     mLog(info, "  paths removed: " + lexical_cast<string>(mPathsRemoved));
     mLog(info, "  edges removed: " + lexical_cast<string>(mEdgesRemoved));
+    if (batchSize > 1)
+    {
+        mLog(info, "  tours retried: " + lexical_cast<string>(mToursRetried));
+    }
     mLog(info, "Done.");
 }
 
@@ -649,44 +695,148 @@ TourBus::Impl::doSingleNode(const Graph::Node& pBegin)
     findStartNodes(startNodeQueue);
     startNodeQueue.clear();
 
-    uint64_t nn = rank(pBegin);
+    Tour tour(*this, rank(pBegin));
+    tour.run(0);
+    commit(tour);
+}
+
+
+void
+TourBus::Impl::commit(Tour& pTour)
+{
+    mTrimmer.apply(pTour.mEdits);
+    pTour.mEdits.clear();
+    mPotentialBubblesConsidered += pTour.mPotentialBubblesConsidered;
+    mBubblesRemoved += pTour.mBubblesRemoved;
+    mPathsRemoved += pTour.mPathsRemoved;
+}
+
+
+void
+TourBus::Impl::runBatch(vector<TourPtr>& pBatch, uint64_t pMaxPasses,
+                        deque<TourPtr>& pRetries)
+{
+    std::atomic<uint64_t> next(0);
+    auto worker = [&]()
+    {
+        while (true)
+        {
+            uint64_t i = next++;
+            if (i >= pBatch.size())
+            {
+                return;
+            }
+            Tour& tour(*pBatch[i]);
+            tour.run(pMaxPasses);
+
+            // Claim every node the tour touched, along with its reverse
+            // complement, since deleting a path also deletes its
+            // reverse complement. The earliest tour in the batch wins.
+            tour.mClaims.reserve(2 * tour.mDistance.size());
+            for (auto& d : tour.mDistance)
+            {
+                tour.mClaims.push_back(d.first);
+                tour.mClaims.push_back(rank(mGraph.reverseComplement(mNodes[d.first])));
+            }
+            tour.mDistance.clear();
+            tour.mPredecessors.clear();
+            for (uint64_t n : tour.mClaims)
+            {
+                uint64_t cur = mOwners[n].load();
+                while (i < cur && !mOwners[n].compare_exchange_weak(cur, i))
+                {
+                }
+            }
+        }
+    };
+
+    ThreadGroup grp;
+    for (uint64_t t = 0; t < mNumThreads; ++t)
+    {
+        grp.create(worker);
+    }
+    grp.join();
+
+    // The tours before the first one to touch a node claimed by an
+    // earlier tour touched only their own nodes, so they did just what
+    // they would have done one after another. That tour and all those
+    // after it start again from scratch, in order, once the earlier
+    // ones have been committed.
+    bool retry = false;
+    for (uint64_t i = 0; i < pBatch.size(); ++i)
+    {
+        Tour& tour(*pBatch[i]);
+        for (uint64_t j = 0; !retry && j < tour.mClaims.size(); ++j)
+        {
+            retry = mOwners[tour.mClaims[j]].load() != i;
+        }
+        if (retry)
+        {
+            tour.mRetry = true;
+            pRetries.push_back(TourPtr(new Tour(*this, tour.mStartRank)));
+            ++mToursRetried;
+        }
+    }
+
+    for (uint64_t i = 0; i < pBatch.size(); ++i)
+    {
+        Tour& tour(*pBatch[i]);
+        for (uint64_t n : tour.mClaims)
+        {
+            mOwners[n] = kUnowned;
+        }
+        tour.mClaims.clear();
+    }
+}
+
+
+void
+TourBus::Impl::Tour::run(uint64_t pMaxPasses)
+{
     mPredecessors.clear();
     mDistance.clear();
-    mDistance[nn] = 0;
-    mWorkQueue.insert(0, nn, 0);
-
+    mWorkQueue.clear();
+    mDistance[mStartRank] = 0;
+    mWorkQueue.insert(0, mStartRank, 0);
     while (!mWorkQueue.empty())
     {
         WorkItem item = mWorkQueue.get();
         uint64_t nn = item.get<0>();
+#ifdef VERBOSE_DEBUG
+        cerr << "Getting minimum work queue node " << nn << "\n";
+#endif
         float time = item.get<1>();
         uint32_t distance = item.get<2>();
 #ifdef VERBOSE_DEBUG
         {
-            Graph::Node n = mNodes[nn];
             SmallBaseVector v_n;
-            mGraph.seq(n, v_n);
+            mGraph.seq(mBus.mNodes[nn], v_n);
             cerr << "Examining node " << v_n << " with time " << time << " and distance " << distance << "\n";
         }
-#endif // VERBOSE_DEBUG
+        cerr << "Removing minimum work queue node " << nn << "\n";
+#endif
         mWorkQueue.removeMinimum();
         doNode(time, distance, nn);
+        if (++mPasses > pMaxPasses && pMaxPasses > 0)
+        {
+            mAbandoned = true;
+            mPending = mWorkQueue.size();
+            break;
+        }
     }
-
-    mDistance.clear();
-    mPredecessors.clear();
+    mWorkQueue.clear();
 }
 
 
 void
-TourBus::Impl::doNode(float pTime, uint32_t pDistance, uint64_t pNodeRnk)
+TourBus::Impl::Tour::doNode(float pTime, uint32_t pDistance, uint64_t pNodeRnk)
 {
-    pair<uint64_t,uint64_t> r = mGraph.beginEndRank(mNodes[pNodeRnk]);
+    pair<uint64_t,uint64_t> r = mGraph.beginEndRank(mBus.mNodes[pNodeRnk]);
     uint64_t r0 = r.first;
     uint64_t r1 = r.second;
     for (uint64_t i = r0; i < r1; ++i)
     {
-        if (mTrimmer.edgeDeleted(i))
+        if (edgeDeleted(i))
         {
             continue;
         }
@@ -701,7 +851,7 @@ TourBus::Impl::doNode(float pTime, uint32_t pDistance, uint64_t pNodeRnk)
 
 
 void
-TourBus::Impl::doPath(float pOriginTime, uint32_t pOriginDistance,
+TourBus::Impl::Tour::doPath(float pOriginTime, uint32_t pOriginDistance,
                       const LinearPathInfo& pPath)
 {
 #ifdef VERBOSE_DEBUG
@@ -714,7 +864,7 @@ TourBus::Impl::doPath(float pOriginTime, uint32_t pOriginDistance,
     }
 #endif // VERBOSE_DEBUG
     Graph::Node endNode = mGraph.to(pPath.mEnd);
-    uint64_t endNodeRank = rank(endNode);
+    uint64_t endNodeRank = mBus.rank(endNode);
     path_predecessor_t::iterator predecessor = mPredecessors.find(endNodeRank);
     if (predecessor != mPredecessors.end() && predecessor->second == pPath.mBegin)
     {
@@ -731,7 +881,7 @@ TourBus::Impl::doPath(float pOriginTime, uint32_t pOriginDistance,
     cerr << "Non-loop with edge time " << edgeTime << " (total time " << totalTime << ") and distance " << edgeDistance << " (total distance " << totalDistance << ")\n";
 #endif // VERBOSE_DEBUG
 
-    if (totalDistance > mMaxSequenceLength * 2)
+    if (totalDistance > mBus.mMaxSequenceLength * 2)
     {
 #ifdef VERBOSE_DEBUG
         cerr << "Maximum sequence length bound exceeded.\n";
@@ -785,7 +935,7 @@ TourBus::Impl::doPath(float pOriginTime, uint32_t pOriginDistance,
 
 
 bool
-TourBus::Impl::isOnPredecessorChain(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
+TourBus::Impl::Tour::isOnPredecessorChain(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
     const
 {
     // TODO This is obviously incorrect, but a conservative approximation.
@@ -794,13 +944,13 @@ TourBus::Impl::isOnPredecessorChain(const Graph::Edge& pEnd, const Graph::Edge&
 
 
 void
-TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
+TourBus::Impl::Tour::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
 {
     const Graph& g = mGraph;
     Graph::Node f = g.from(pBegin);
-    uint64_t fRank = rank(f);
+    uint64_t fRank = mBus.rank(f);
     Graph::Node t = g.to(pEnd);
-    uint64_t tRank = rank(t);
+    uint64_t tRank = mBus.rank(t);
 
 #ifdef VERBOSE_DEBUG
     SmallBaseVector sbv;
@@ -875,7 +1025,7 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
     while (x != mPredecessors.end())
     {
         n = g.from(x->second);
-        nRank = rank(n);
+        nRank = mBus.rank(n);
         if (minority.count(nRank))
         {
 #ifdef VERBOSE_DEBUG
@@ -898,7 +1048,7 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
 
     // Now let's scan back up the majority path looking for a common element.
     n = g.from(majEdge);
-    nRank = rank(n);
+    nRank = mBus.rank(n);
     do
     {
 #ifdef VERBOSE_DEBUG
@@ -913,7 +1063,7 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
         x = mPredecessors.find(nRank);
         BOOST_ASSERT(x != mPredecessors.end());
         n = g.from(x->second);
-        nRank = rank(n);
+        nRank = mBus.rank(n);
     } while (x != mPredecessors.end());
 
 #ifdef VERBOSE_DEBUG
@@ -936,8 +1086,8 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
     min.push_front(e);
     while (g.from(e) != n)
     {
-        BOOST_ASSERT(mPredecessors.find(rank(g.from(e))) != mPredecessors.end());
-        e = mPredecessors.find(rank(g.from(e)))->second;
+        BOOST_ASSERT(mPredecessors.find(mBus.rank(g.from(e))) != mPredecessors.end());
+        e = mPredecessors.find(mBus.rank(g.from(e)))->second;
 #ifdef VERBOSE_DEBUG
         sbv.clear();
         g.seq(e, sbv);
@@ -945,12 +1095,12 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
 #endif // VERBOSE_DEBUG
         min.push_front(e);
     }
-    composeSequence(min, minSeq);
+    mBus.composeSequence(min, minSeq);
 #ifdef VERBOSE_DEBUG
     cerr << "Minority sequence: " << minSeq << "\n";
 #endif // VERBOSE_DEBUG
 
-    if (minSeq.size() > mMaxSequenceLength)
+    if (minSeq.size() > mBus.mMaxSequenceLength)
     {
 #ifdef VERBOSE_DEBUG
         cerr << "Sequence too long.\n";
@@ -970,8 +1120,8 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
         max.push_front(e);
         while (g.from(e) != n)
         {
-            BOOST_ASSERT(mPredecessors.find(rank(g.from(e))) != mPredecessors.end());
-            e = mPredecessors.find(rank(g.from(e)))->second;
+            BOOST_ASSERT(mPredecessors.find(mBus.rank(g.from(e))) != mPredecessors.end());
+            e = mPredecessors.find(mBus.rank(g.from(e)))->second;
 #ifdef VERBOSE_DEBUG
             sbv.clear();
             g.seq(e, sbv);
@@ -980,12 +1130,12 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
             max.push_front(e);
         }
     }
-    composeSequence(max, maxSeq);
+    mBus.composeSequence(max, maxSeq);
 #ifdef VERBOSE_DEBUG
     cerr << "Majority sequence: " << maxSeq << "\n";
 #endif // VERBOSE_DEBUG
 
-    if (maxSeq.size() > mMaxSequenceLength)
+    if (maxSeq.size() > mBus.mMaxSequenceLength)
     {
 #ifdef VERBOSE_DEBUG
         cerr << "Sequence too long.\n";
@@ -993,7 +1143,7 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
         return;
     }
 
-    if (static_cast<size_t>(std::abs((int64_t)maxSeq.size() - (int64_t)minSeq.size())) > mMaxEditDistance)
+    if (static_cast<size_t>(std::abs((int64_t)maxSeq.size() - (int64_t)minSeq.size())) > mBus.mMaxEditDistance)
     {
 #ifdef VERBOSE_DEBUG
         cerr << "Length difference too high.\n";
@@ -1002,7 +1152,7 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
     }
 
     size_t editDistance = maxSeq.editDistance(minSeq);
-    if (editDistance > mMaxEditDistance)
+    if (editDistance > mBus.mMaxEditDistance)
     {
 #ifdef VERBOSE_DEBUG
         cerr << "Edit distance too high.\n";
@@ -1011,7 +1161,7 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
     }
 
     double relErrors = (double)editDistance / std::max(minSeq.size(), maxSeq.size());
-    if (relErrors > mMaxRelativeErrors)
+    if (relErrors > mBus.mMaxRelativeErrors)
     {
 #ifdef VERBOSE_DEBUG
         cerr << "Relative error rate too high.\n";
@@ -1020,7 +1170,7 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
     }
 
     // Perform cutoff checks
-    if (mDoCutoffCheck || mDoRelCutoffCheck)
+    if (mBus.mDoCutoffCheck || mBus.mDoRelCutoffCheck)
     {
         CoverageVisitor covVisitor(g);
 
@@ -1031,12 +1181,12 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
         }
         double minCoverage = (double)covVisitor.mCoverage / covVisitor.mLength;
 
-        if (mDoCutoffCheck && minCoverage < mCutoff)
+        if (mBus.mDoCutoffCheck && minCoverage < mBus.mCutoff)
         {
             return;
         }
 
-        if (mDoRelCutoffCheck)
+        if (mBus.mDoRelCutoffCheck)
         {
             covVisitor.reset();
 
@@ -1048,7 +1198,7 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
             double maxCoverage
                 = (double)covVisitor.mCoverage / covVisitor.mLength;
 
-            if (minCoverage < maxCoverage * mRelCutoff)
+            if (minCoverage < maxCoverage * mBus.mRelCutoff)
             {
                 return;
             }
@@ -1056,7 +1206,7 @@ TourBus::Impl::analyseEdge(const Graph::Edge& pEnd, const Graph::Edge& pBegin)
     }
 
     ++mBubblesRemoved;
-    GraphTrimmer::EdgeTrimVisitor trimVisitor(mTrimmer);
+    GraphTrimmer::DeltaTrimVisitor trimVisitor(g, mEdits);
     uint64_t r = g.rank(min.front());
     trimVisitor(min.front(), r);
 #ifdef VERBOSE_DEBUG
@@ -1099,12 +1249,8 @@ TourBus::Impl::composeSequence(const deque<Graph::Edge>& pSegStarts,
 void
 TourBus::Impl::pass()
 {
-    mPredecessors.clear();
-    mDistance.clear();
     mNodes.clear();
     doWholeGraph();
-    mPredecessors.clear();
-    mDistance.clear();
 }
 
 
@@ -1119,12 +1265,8 @@ TourBus::pass()
 bool
 TourBus::singleNode(const Graph::Node& pNode)
 {
-    mPImpl->mPredecessors.clear();
-    mPImpl->mDistance.clear();
     mPImpl->mNodes.clear();
     mPImpl->doSingleNode(pNode);
-    mPImpl->mPredecessors.clear();
-    mPImpl->mDistance.clear();
     return mPImpl->mTrimmer.modified();
 }
 
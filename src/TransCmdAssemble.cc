@@ -623,6 +623,165 @@ SortThread::get(vector<uint8_t>& pData)
 }
 
 
+// The contigs and read pairs of one non-empty component.
+struct ComponentJob
+{
+    typedef pair<ResolveTranscripts::ReadInfo,
+                 ResolveTranscripts::ReadInfo> read_pair_info;
+
+    uint32_t mId;
+    uint32_t mCompId;
+    vector<SmallBaseVector> mContigs;
+    vector<read_pair_info> mReadPairs;
+};
+
+typedef std::shared_ptr<ComponentJob> ComponentJobPtr;
+
+
+// Components are resolved concurrently and finish in any order. This
+// holds on to the transcripts and log messages of each component until
+// all of the components before it have been written, so the output is
+// the same whatever the number of threads.
+class ComponentOutput
+{
+public:
+    void put(uint32_t pId, string& pOut, string& pLog);
+
+    ComponentOutput(ostream& pOut, Logger& pLog)
+        : mOut(pOut), mLog(pLog), mNext(0)
+    {
+    }
+
+private:
+    void write(const string& pOut, const string& pLog);
+
+    mutex mMutex;
+    ostream& mOut;
+    Logger& mLog;
+    uint32_t mNext;
+    map<uint32_t, pair<string,string> > mPending;
+};
+
+
+void
+ComponentOutput::put(uint32_t pId, string& pOut, string& pLog)
+{
+    unique_lock<mutex> lk(mMutex);
+    if (pId != mNext)
+    {
+        pair<string,string>& p(mPending[pId]);
+        p.first.swap(pOut);
+        p.second.swap(pLog);
+        return;
+    }
+
+    write(pOut, pLog);
+    ++mNext;
+    map<uint32_t, pair<string,string> >::iterator i = mPending.begin();
+    while (i != mPending.end() && i->first == mNext)
+    {
+        write(i->second.first, i->second.second);
+        ++mNext;
+        mPending.erase(i++);
+    }
+}
+
+
+void
+ComponentOutput::write(const string& pOut, const string& pLog)
+{
+    if (!pLog.empty())
+    {
+        // The Stream supplies the final newline.
+        mLog.stream(info, false)() << pLog.substr(0, pLog.size() - 1);
+    }
+    mOut << pOut;
+    mOut.flush();
+}
+
+
+// Resolves components into transcripts, one after another, reusing the
+// same scratch state for each.
+class ComponentResolver
+{
+public:
+    void push_back(const ComponentJobPtr& pJob);
+
+    void end()
+    {
+    }
+
+    ComponentResolver(Graph& pGraph, Severity pSev, uint64_t pMinLength,
+                      uint64_t pMappableReads, ComponentOutput& pOutput)
+        : mGraph(pGraph), mSev(pSev), mMinLength(pMinLength),
+          mMappableReads(pMappableReads), mOutput(pOutput),
+          mArena(ResolveTranscripts::makeArena())
+    {
+    }
+
+private:
+    Graph& mGraph;
+    const Severity mSev;
+    const uint64_t mMinLength;
+    const uint64_t mMappableReads;
+    ComponentOutput& mOutput;
+    ResolveTranscripts::ArenaPtr mArena;
+};
+
+typedef std::shared_ptr<ComponentResolver> ComponentResolverPtr;
+
+
+void
+ComponentResolver::push_back(const ComponentJobPtr& pJob)
+{
+    const ComponentJob& job(*pJob);
+    ostringstream out;
+    ostringstream logStr;
+    {
+        Logger log(logStr, mSev);
+        ResolveTranscripts resolver(lexical_cast<string>(job.mId),
+                    mGraph, log, out, mMinLength, mMappableReads, mArena);
+
+#ifdef DUMP_COMPONENT_INTERMEDIATES
+        out << "# BEGIN Contents of component " << job.mId << " (" << job.mCompId << ")\n";
+        out << "# Contigs:\n";
+        unsigned ctgId = 0;
+#endif
+        for (auto& seq: job.mContigs)
+        {
+#ifdef DUMP_COMPONENT_INTERMEDIATES
+            out << ">component" << job.mCompId << "--" << "contig" << ctgId++ << "\n";
+            seq.print(out);
+#endif
+            resolver.addContig(seq);
+        }
+#ifdef DUMP_COMPONENT_INTERMEDIATES
+        unsigned readId = 0;
+        out << "# Reads:\n";
+#endif
+        for (auto& readPair: job.mReadPairs)
+        {
+#ifdef DUMP_COMPONENT_INTERMEDIATES
+            out << ">component" << job.mCompId << "--" << "read" << readId << "/1\n";
+            readPair.first.mRead.print(out);
+            out << ">component" << job.mCompId << "--" << "read" << readId << "/2\n";
+            readPair.second.mRead.print(out);
+            ++readId;
+#endif
+            resolver.addReadPair(readPair.first, readPair.second);
+        }
+#ifdef DUMP_COMPONENT_INTERMEDIATES
+        out << "# END Contents of component " << job.mId << " (" << job.mCompId << ")\n";
+#endif
+        resolver.processComponent();
+    }
+
+    string outStr(out.str());
+    string logOut(logStr.str());
+    mOutput.put(job.mId, outStr, logOut);
+}
+
+
 struct TransCmdAssemble : public GossCmd
 {
     TransCmdAssemble(
@@ -1575,7 +1734,7 @@ TransCmdAssemble::operator()(const GossCmdContext& pCxt)
 
     vector<bool> kmerPresent;
     uint64_t numComponents;
-    kmerPresent.reserve(kmerToContigMap.size());
+    kmerPresent.resize(kmerToContigMap.size());
     {
         log(info, "Extracting components");
         linkGraph.trimAndAssembleComponents(log);
@@ -1611,7 +1770,8 @@ TransCmdAssemble::operator()(const GossCmdContext& pCxt)
                 + " components");
     }
 
-    ExternalBufferSort sorter(1024ULL * 1024ULL * 1024ULL, fac);
+    MemoryBudget::Reservation sortMem(pCxt.mem.reserve(1024ULL * 1024ULL * 1024ULL, 64ULL * 1024ULL * 1024ULL));
+    ExternalBufferSort sorter(sortMem.size(), fac);
     uint64_t numNonEmptyComponents = 0;
     dynamic_bitset<uint64_t> nonEmptyComponents(numComponents);
     uint64_t totalMappableReads = 0;
@@ -1685,16 +1845,23 @@ TransCmdAssemble::operator()(const GossCmdContext& pCxt)
             rhsRead.mRead.decode(i);
         }
 
+        ComponentOutput output(out, log);
+        vector<ComponentResolverPtr> resolvers;
+        BackgroundMultiConsumer<ComponentJobPtr> grp(2 * mNumThreads);
+        for (uint64_t i = 0; i < mNumThreads; ++i)
+        {
+            resolvers.push_back(std::make_shared<ComponentResolver>(
+                g, log.sev(), mMinLength, totalMappableReads, output));
+            grp.add(*resolvers.back());
+        }
+
         uint32_t nonEmptyCompId = 0;
         uint32_t compId = 0;
         for (auto& component: linkGraph.mComponents)
         {
-            ResolveTranscripts resolver(lexical_cast<string>(nonEmptyCompId),
-                        g, log, out, mMinLength, totalMappableReads);
-
-            typedef pair<ResolveTranscripts::ReadInfo,
-                        ResolveTranscripts::ReadInfo> read_pair_info;
-            vector<read_pair_info> readPairs;
+            ComponentJobPtr job = std::make_shared<ComponentJob>();
+            job->mId = nonEmptyCompId;
+            job->mCompId = compId;
 
             while (moreInQueue && alignedComponent < compId)
             {
@@ -1716,7 +1883,8 @@ TransCmdAssemble::operator()(const GossCmdContext& pCxt)
                 {
                     break;
                 }
-                readPairs.push_back(read_pair_info(lhsRead, rhsRead));
+                job->mReadPairs.push_back(
+                    ComponentJob::read_pair_info(lhsRead, rhsRead));
                 vector<uint8_t>::iterator i = read.begin();
                 alignedComponent = VByteCodec::decode(i);
                 lhsRead.mRead.decode(i);
@@ -1725,46 +1893,18 @@ TransCmdAssemble::operator()(const GossCmdContext& pCxt)
 
             if (nonEmptyComponents[compId])
             {
-#ifdef DUMP_COMPONENT_INTERMEDIATES
-                out << "# BEGIN Contents of component " << nonEmptyCompId << " (" << compId << ")\n";
-                out << "# Contigs:\n";
-#endif
-
                 for (auto ctg: component)
                 {
                     const ContigInfo& info = linkGraph.mContigInfo[ctg];
-                    SmallBaseVector seq;
-                    info.decompressContig(g, seq);
-#ifdef DUMP_COMPONENT_INTERMEDIATES
-                    out << ">component" << compId << "--" << "contig" << ctg << "\n";
-                    seq.print(out);
-#endif
-                    resolver.addContig(seq);
+                    job->mContigs.push_back(SmallBaseVector());
+                    info.decompressContig(g, job->mContigs.back());
                 }
-#ifdef DUMP_COMPONENT_INTERMEDIATES
-                unsigned readId = 0;
-                out << "# Reads:\n";
-#endif
-                for (auto& readPair: readPairs)
-                {
-#ifdef DUMP_COMPONENT_INTERMEDIATES
-                    out << ">component" << compId << "--" << "read" << readId << "/1\n";
-                    readPair.first.mRead.print(out);
-                    out << ">component" << compId << "--" << "read" << readId << "/2\n";
-                    readPair.second.mRead.print(out);
-                    ++readId;
-#endif
-                    resolver.addReadPair(readPair.first, readPair.second);
-                }
-#ifdef DUMP_COMPONENT_INTERMEDIATES
-                out << "# END Contents of component " << nonEmptyCompId << " (" << compId << ")\n";
-                out.flush();
-#endif
-                resolver.processComponent();
+                grp.push_back(job);
                 ++nonEmptyCompId;
             }
             ++compId;
         }
+        grp.wait();
 
         while (moreInQueue)
         {
@@ -258,7 +258,7 @@ TransCmdTrimRelative::operator()(const GossCmdContext& pCxt)
     log(info, "writing out graph.");
 
     ProgressMonitorNew writeMon(log, g.count());
-    Graph::Builder b(g.K(), mOut, fac, newCount, g.asymmetric());
+    Graph::Builder b(g.K(), mOut, fac, newCount, g.asymmetric(), g.countsFormat());
 
     uint64_t i = 0;
     for (Graph::Iterator itr(g); itr.valid(); ++itr, ++i)
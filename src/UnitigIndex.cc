@@ -0,0 +1,391 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "UnitigIndex.hh"
+
+#include "ExternalBufferSort.hh"
+#include "GossamerException.hh"
+#include "WorkQueue.hh"
+
+#include <functional>
+#include <memory>
+#include <boost/dynamic_bitset.hpp>
+
+using namespace boost;
+using namespace std;
+
+constexpr uint64_t UnitigIndex::version;
+constexpr uint64_t UnitigIndex::step;
+
+namespace // anonymous
+{
+    class PathVisitor
+    {
+    public:
+        bool operator()(const Graph::Edge& pEdge, const Gossamer::rank_type& pRank)
+        {
+            mPath.push_back(pRank);
+            return true;
+        }
+
+        PathVisitor(vector<uint64_t>& pPath)
+            : mPath(pPath)
+        {
+        }
+
+    private:
+        vector<uint64_t>& mPath;
+    };
+
+    // The paths are spilled as the ranks of their edges, with the first
+    // edge of each unitig flagged.
+    const uint64_t startFlag = 1ULL << 63;
+
+    // Walk the unitigs starting in a range of edge ranks, spilling them
+    // to a temporary file whenever the buffer fills.
+    class Batch
+    {
+    public:
+        bool operator()(const Graph::Edge& pEdge, const Gossamer::rank_type& pRank)
+        {
+            if (mPath.size() == mBufferWords)
+            {
+                flush();
+            }
+            mPath.push_back(mStart ? (uint64_t(pRank) | startFlag) : uint64_t(pRank));
+            mStart = false;
+            return true;
+        }
+
+        void operator()()
+        {
+            mPath.reserve(min(mBufferWords, mEnd - mBegin));
+            for (uint64_t r = mBegin; r < mEnd; ++r)
+            {
+                const Graph::Edge e = mGraph.select(r);
+                const Graph::Node f = mGraph.from(e);
+                if (mGraph.inDegree(f) == 1 && mGraph.outDegree(f) == 1)
+                {
+                    continue;
+                }
+                ++mUnitigs;
+                mStart = true;
+                mGraph.linearPath(e, *this);
+            }
+            flush();
+            vector<uint64_t>().swap(mPath);
+        }
+
+        Batch(const Graph& pGraph, uint64_t pBegin, uint64_t pEnd, uint64_t pBufferWords,
+              FileFactory& pFactory)
+            : mGraph(pGraph), mBegin(pBegin), mEnd(pEnd), mBufferWords(pBufferWords),
+              mFactory(pFactory), mFileName(pFactory.tmpName()), mUnitigs(0), mStart(false)
+        {
+        }
+
+        const Graph& mGraph;
+        const uint64_t mBegin;
+        const uint64_t mEnd;
+        const uint64_t mBufferWords;
+        FileFactory& mFactory;
+        const string mFileName;
+        uint64_t mUnitigs;
+
+    private:
+        void flush()
+        {
+            if (mPath.empty())
+            {
+                return;
+            }
+            FileFactory::OutHolderPtr op(mFactory.out(mFileName, FileFactory::AppendMode));
+            (**op).write(reinterpret_cast<const char*>(mPath.data()), mPath.size() * sizeof(uint64_t));
+            mPath.clear();
+        }
+
+        bool mStart;
+        vector<uint64_t> mPath;
+    };
+    typedef std::shared_ptr<Batch> BatchPtr;
+
+    // The samples of the inverse are found in the order of the cycles
+    // of the path, and are sorted as (mark, back pointer) pairs, each
+    // written as two big-endian numbers of a fixed number of bytes, so
+    // that they sort by mark.
+    void encodePair(uint64_t pMark, uint64_t pBack, uint64_t pBytes, vector<uint8_t>& pItem)
+    {
+        pItem.resize(2 * pBytes);
+        for (uint64_t i = 0; i < pBytes; ++i)
+        {
+            const uint64_t s = 8 * (pBytes - 1 - i);
+            pItem[i] = uint8_t(pMark >> s);
+            pItem[pBytes + i] = uint8_t(pBack >> s);
+        }
+    }
+
+    class SampleWriter
+    {
+    public:
+        void push_back(const vector<uint8_t>& pItem)
+        {
+            uint64_t m = 0;
+            uint64_t b = 0;
+            for (uint64_t i = 0; i < mBytes; ++i)
+            {
+                m = (m << 8) | pItem[i];
+                b = (b << 8) | pItem[mBytes + i];
+            }
+            mMarks.push_back(Gossamer::position_type(m));
+            mBack.push_back(IntegerArray::value_type(b));
+        }
+
+        void end()
+        {
+        }
+
+        SampleWriter(SparseArray::Builder& pMarks, IntegerArray::Builder& pBack, uint64_t pBytes)
+            : mMarks(pMarks), mBack(pBack), mBytes(pBytes)
+        {
+        }
+
+    private:
+        SparseArray::Builder& mMarks;
+        IntegerArray::Builder& mBack;
+        const uint64_t mBytes;
+    };
+
+    UnitigIndex::Header readHeader(const string& pBaseName, FileFactory& pFactory)
+    {
+        UnitigIndex::Header h;
+        FileFactory::InHolderPtr ip(pFactory.in(pBaseName + ".header"));
+        (**ip).read(reinterpret_cast<char*>(&h), sizeof(h));
+        if (h.version != UnitigIndex::version)
+        {
+            BOOST_THROW_EXCEPTION(
+                Gossamer::error()
+                    << boost::errinfo_file_name(pBaseName + ".header")
+                    << Gossamer::version_mismatch_info(make_pair(UnitigIndex::version, h.version)));
+        }
+        return h;
+    }
+} // namespace anonymous
+
+void
+UnitigIndex::build(const Graph& pGraph, const string& pBaseName,
+                   FileFactory& pFactory, Logger& pLog, MemoryBudget& pBudget,
+                   uint64_t pThreads)
+{
+    const uint64_t n = pGraph.count();
+    const uint64_t t = max<uint64_t>(pThreads, 1);
+
+    // Ask for enough to do everything in memory. The bitmap of edges
+    // laid out is needed whatever we get; the rest is shared between
+    // the walkers' buffers and the sort of the samples of the path's
+    // inverse.
+    const uint64_t bitmapBytes = n / 8 + 8;
+    MemoryBudget::Reservation mem(pBudget.reserve(bitmapBytes + 2 * n * sizeof(uint64_t) + (1ULL << 20),
+                                                  bitmapBytes + (256ULL << 10)));
+    const uint64_t rest = mem.size() - min(mem.size(), bitmapBytes);
+    const uint64_t bufferWords = max<uint64_t>(4096, rest / 2 / sizeof(uint64_t) / t);
+    // The sort maps a buffer's worth of pairs, and a pointer to each.
+    const uint64_t sortBytes = max<uint64_t>(1ULL << 16, rest / 2);
+
+    LOG(pLog, info) << "Walking unitigs";
+    vector<BatchPtr> batches;
+    {
+        const uint64_t numBatches = 64 * t;
+        WorkQueue q(pThreads);
+        for (uint64_t i = 0; i < numBatches; ++i)
+        {
+            const uint64_t b = n * i / numBatches;
+            const uint64_t e = n * (i + 1) / numBatches;
+            batches.push_back(BatchPtr(new Batch(pGraph, b, e, bufferWords, pFactory)));
+            q.push_back(std::bind<void>(std::ref(*batches.back())));
+        }
+        q.wait();
+    }
+
+    Header h;
+    h.version = version;
+    h.K = pGraph.K();
+    h.edges = n;
+    h.unitigs = 0;
+    h.cycles = 0;
+    h.bits = IntegerArray::roundUpBits(max<uint64_t>(1, Gossamer::log2(n + 1)));
+    h.fingerprint = pGraph.fingerprint();
+
+    // Lay the paths out in order, noting which edges have been placed.
+    LOG(pLog, info) << "Writing unitigs";
+    {
+        // Loops are rare, so leave them out of the estimate.
+        uint64_t m = 0;
+        for (uint64_t i = 0; i < batches.size(); ++i)
+        {
+            m += batches[i]->mUnitigs;
+        }
+        SparseArray::Builder starts(pBaseName + ".starts", pFactory, Gossamer::position_type(n + 1), max<uint64_t>(m, 1));
+        IntegerArray::BuilderPtr path = IntegerArray::builder(h.bits, pBaseName + ".path", pFactory);
+        dynamic_bitset<> placed(n);
+        uint64_t p = 0;
+        vector<uint64_t> buf(min(bufferWords, max<uint64_t>(n, 1)));
+        for (uint64_t i = 0; i < batches.size(); ++i)
+        {
+            const string& nm(batches[i]->mFileName);
+            if (pFactory.exists(nm))
+            {
+                FileFactory::InHolderPtr ip(pFactory.in(nm));
+                istream& in(**ip);
+                while (in.good())
+                {
+                    in.read(reinterpret_cast<char*>(buf.data()), buf.size() * sizeof(uint64_t));
+                    const uint64_t z = in.gcount() / sizeof(uint64_t);
+                    for (uint64_t j = 0; j < z; ++j, ++p)
+                    {
+                        const uint64_t r = buf[j] & ~startFlag;
+                        if (buf[j] & startFlag)
+                        {
+                            starts.push_back(Gossamer::position_type(p));
+                            ++h.unitigs;
+                        }
+                        path->push_back(IntegerArray::value_type(r));
+                        placed[r] = true;
+                    }
+                }
+            }
+            pFactory.remove(nm);
+            batches[i] = BatchPtr();
+        }
+        vector<uint64_t>().swap(buf);
+
+        // Whatever is left lies on closed loops.
+        vector<uint64_t> loop;
+        PathVisitor vis(loop);
+        for (uint64_t r = 0; r < n; ++r)
+        {
+            if (placed[r])
+            {
+                continue;
+            }
+            loop.clear();
+            pGraph.linearPath(pGraph.select(r), vis);
+            starts.push_back(Gossamer::position_type(p));
+            ++h.unitigs;
+            ++h.cycles;
+            for (uint64_t l = 0; l < loop.size(); ++l, ++p)
+            {
+                path->push_back(IntegerArray::value_type(loop[l]));
+                placed[loop[l]] = true;
+            }
+        }
+        BOOST_ASSERT(p == n);
+
+        starts.end(Gossamer::position_type(n + 1));
+        path->end();
+    }
+
+    // Sample the inverse of the path. Each cycle of at least step
+    // positions is followed from its lowest position, marking every
+    // step'th one, and each mark points back to the one before it,
+    // the first to the last.
+    {
+        const uint64_t bytes = h.bits / 8;
+        ExternalBufferSort sorter(sortBytes, pFactory);
+        uint64_t marks = 0;
+        {
+            IntegerArrayPtr pathHolder = IntegerArray::create(h.bits, pBaseName + ".path", pFactory);
+            const IntegerArray& path(*pathHolder);
+            dynamic_bitset<> seen(n);
+            vector<uint8_t> item;
+            for (uint64_t s = 0; s < n; ++s)
+            {
+                if (seen[s])
+                {
+                    continue;
+                }
+                uint64_t len = 0;
+                uint64_t prev = s;
+                for (uint64_t p = s; !seen[p]; p = path[p].asUInt64(), ++len)
+                {
+                    seen[p] = true;
+                    if (len % step == 0 && len > 0)
+                    {
+                        encodePair(p, prev, bytes, item);
+                        sorter.push_back(item);
+                        ++marks;
+                        prev = p;
+                    }
+                }
+                if (len >= step)
+                {
+                    encodePair(s, prev, bytes, item);
+                    sorter.push_back(item);
+                    ++marks;
+                }
+            }
+        }
+        SparseArray::Builder marksBuilder(pBaseName + ".marks", pFactory, Gossamer::position_type(n + 1),
+                                          max<uint64_t>(marks, 1));
+        IntegerArray::BuilderPtr back = IntegerArray::builder(h.bits, pBaseName + ".back", pFactory);
+        SampleWriter w(marksBuilder, *back, bytes);
+        sorter.sort(w);
+        marksBuilder.end(Gossamer::position_type(n + 1));
+        back->end();
+    }
+
+    FileFactory::OutHolderPtr op(pFactory.out(pBaseName + ".header"));
+    (**op).write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+    LOG(pLog, info) << "Found " << h.unitigs << " unitigs, of which " << h.cycles << " are loops";
+}
+
+void
+UnitigIndex::remove(const string& pBaseName, FileFactory& pFactory)
+{
+    pFactory.remove(pBaseName + ".header");
+    SparseArray::remove(pBaseName + ".starts", pFactory);
+    IntegerArray::remove(pBaseName + ".path", pFactory);
+    SparseArray::remove(pBaseName + ".marks", pFactory);
+    IntegerArray::remove(pBaseName + ".back", pFactory);
+}
+
+UnitigIndexPtr
+UnitigIndex::open(const string& pBaseName, const Graph& pGraph, FileFactory& pFactory, Logger& pLog)
+{
+    if (!exists(pBaseName, pFactory))
+    {
+        return UnitigIndexPtr();
+    }
+    uint64_t v = 0;
+    {
+        FileFactory::InHolderPtr ip(pFactory.in(pBaseName + ".header"));
+        (**ip).read(reinterpret_cast<char*>(&v), sizeof(v));
+    }
+    if (v != version)
+    {
+        pLog(warning, "the unitig index is of an old version, so it won't be used; run build-unitigs to update it.");
+        return UnitigIndexPtr();
+    }
+    UnitigIndexPtr u(new UnitigIndex(pBaseName, pFactory));
+    if (!u->matches(pGraph))
+    {
+        pLog(warning, "the unitig index doesn't match the graph, so it won't be used.");
+        return UnitigIndexPtr();
+    }
+    return u;
+}
+
+UnitigIndex::UnitigIndex(const string& pBaseName, FileFactory& pFactory)
+    : mHeader(readHeader(pBaseName, pFactory)),
+      mStarts(pBaseName + ".starts", pFactory),
+      mPathHolder(IntegerArray::create(mHeader.bits, pBaseName + ".path", pFactory)),
+      mPath(*mPathHolder),
+      mMarks(pBaseName + ".marks", pFactory),
+      mBackHolder(IntegerArray::create(mHeader.bits, pBaseName + ".back", pFactory)),
+      mBack(*mBackHolder)
+{
+}
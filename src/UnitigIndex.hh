@@ -0,0 +1,229 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef UNITIGINDEX_HH
+#define UNITIGINDEX_HH
+
+#ifndef GRAPH_HH
+#include "Graph.hh"
+#endif
+
+#ifndef INTEGERARRAY_HH
+#include "IntegerArray.hh"
+#endif
+
+#ifndef LOGGER_HH
+#include "Logger.hh"
+#endif
+
+#ifndef MEMORYBUDGET_HH
+#include "MemoryBudget.hh"
+#endif
+
+#ifndef SPARSEARRAY_HH
+#include "SparseArray.hh"
+#endif
+
+#ifndef STD_UTILITY
+#include <utility>
+#define STD_UTILITY
+#endif
+
+class UnitigIndex;
+typedef boost::shared_ptr<UnitigIndex> UnitigIndexPtr;
+
+// The maximal linear paths (unitigs) of a graph, as found by
+// Graph::linearPath, computed once so that commands can walk them
+// without stepping from edge to edge.
+//
+// The edges are laid out unitig by unitig in path order, and each edge
+// is identified by its position in that layout. The unitigs start at
+// edges whose from-node doesn't have exactly one in and one out edge,
+// and are numbered in the order of the ranks of their first edges.
+// Edges on closed loops, which have no such start, follow as unitigs
+// of their own, starting at their lowest ranked edge.
+//
+// The unitig starts are held in a SparseArray (i.e. Elias-Fano coded),
+// alongside the rank of the edge at each position, which takes log2(n)
+// bits per edge, rounded up to a whole byte. The path is a permutation
+// of the ranks, and rather than storing its inverse, which would cost
+// as much again, the index samples it: on each cycle of the
+// permutation, every step'th position is marked (in another
+// SparseArray) and given a pointer step places back. The position of
+// a rank is found by following the path from the rank until it leads
+// back to it, taking the first shortcut on the way, in at most about
+// 2 step lookups. With step = 16, the index costs a little over
+// (1 + 1/16) log2(n) bits per edge: about 35 bits for 100 million
+// edges, against about 40 for the graph (its edges and counts) with
+// k = 27.
+//
+// print-contigs (both of linear segments and of a supergraph's paths),
+// build-entry-edge-set, trim-paths and clip-links read the index when
+// there is one which matches the graph. build-supergraph needs only
+// the entry edges, and doesn't walk the graph. prune-tips still walks
+// the graph an edge at a time, since it trims the graph repeatedly and
+// the index only describes the graph it started with.
+//
+// Building the index holds one bit per edge in memory; the paths are
+// spilled to disk as they are walked, and the samples of the inverse
+// are put in order by an external sort within the memory budget.
+//
+class UnitigIndex
+{
+public:
+    static constexpr uint64_t version = 2016122101ULL;
+    // Version history
+    // 2016122001   - initial version
+    // 2016122101   - sample the inverse of the path
+
+    // Every step'th position on a cycle of the path is sampled.
+    static constexpr uint64_t step = 16;
+
+    struct Header
+    {
+        uint64_t version;
+        uint64_t K;
+        uint64_t edges;
+        uint64_t unitigs;
+        uint64_t cycles;
+        uint64_t bits;      // per rank or position
+        uint64_t fingerprint;
+    };
+
+    // Build the index for pGraph, using pThreads threads, and memory
+    // from pBudget.
+    static void build(const Graph& pGraph, const std::string& pBaseName,
+                      FileFactory& pFactory, Logger& pLog, MemoryBudget& pBudget,
+                      uint64_t pThreads);
+
+    // The number of unitigs, including cycles.
+    uint64_t count() const
+    {
+        return mHeader.unitigs;
+    }
+
+    // The number of unitigs which are closed loops. These are the
+    // last cycles() unitigs.
+    uint64_t cycles() const
+    {
+        return mHeader.cycles;
+    }
+
+    bool cycle(uint64_t pId) const
+    {
+        return pId >= mHeader.unitigs - mHeader.cycles;
+    }
+
+    // The number of edges in the graph.
+    uint64_t edges() const
+    {
+        return mHeader.edges;
+    }
+
+    // The position of the first edge of unitig pId.
+    uint64_t begin(uint64_t pId) const
+    {
+        return mStarts.select(pId).asUInt64();
+    }
+
+    // The position after the last edge of unitig pId.
+    uint64_t end(uint64_t pId) const
+    {
+        return pId + 1 < mHeader.unitigs ? begin(pId + 1) : mHeader.edges;
+    }
+
+    // The number of edges in unitig pId.
+    uint64_t length(uint64_t pId) const
+    {
+        return end(pId) - begin(pId);
+    }
+
+    // The rank of the edge at position pPos.
+    uint64_t edge(uint64_t pPos) const
+    {
+        return mPath[pPos].asUInt64();
+    }
+
+    // The ranks of the first and last edges of unitig pId.
+    uint64_t first(uint64_t pId) const
+    {
+        return edge(begin(pId));
+    }
+
+    uint64_t last(uint64_t pId) const
+    {
+        return edge(end(pId) - 1);
+    }
+
+    // The position of the edge with rank pRank.
+    uint64_t position(uint64_t pRank) const
+    {
+        uint64_t p = pRank;
+        bool back = false;
+        while (true)
+        {
+            const uint64_t r = edge(p);
+            if (r == pRank)
+            {
+                return p;
+            }
+            Gossamer::rank_type m = 0;
+            if (!back && mMarks.accessAndRank(Gossamer::position_type(p), m))
+            {
+                p = mBack[m].asUInt64();
+                back = true;
+            }
+            else
+            {
+                p = r;
+            }
+        }
+    }
+
+    // The unitig containing the edge with rank pRank, and the offset
+    // of the edge within it.
+    std::pair<uint64_t,uint64_t> unitig(uint64_t pRank) const
+    {
+        const uint64_t p = position(pRank);
+        const uint64_t id = mStarts.rank(Gossamer::position_type(p + 1)) - 1;
+        return std::make_pair(id, p - begin(id));
+    }
+
+    // True if the index was built from pGraph (see Graph::fingerprint()).
+    bool matches(const Graph& pGraph) const
+    {
+        return mHeader.K == pGraph.K() && mHeader.edges == pGraph.count()
+            && mHeader.fingerprint == pGraph.fingerprint();
+    }
+
+    static bool exists(const std::string& pBaseName, FileFactory& pFactory)
+    {
+        return pFactory.exists(pBaseName + ".header");
+    }
+
+    // Open the index pBaseName if there is one, and it is of the
+    // current version, and it was built from pGraph. Otherwise return
+    // null, warning if there is an index which can't be used.
+    static UnitigIndexPtr open(const std::string& pBaseName, const Graph& pGraph,
+                               FileFactory& pFactory, Logger& pLog);
+
+    static void remove(const std::string& pBaseName, FileFactory& pFactory);
+
+    UnitigIndex(const std::string& pBaseName, FileFactory& pFactory);
+
+private:
+    Header mHeader;
+    SparseArray mStarts;
+    IntegerArrayPtr mPathHolder;
+    const IntegerArray& mPath;
+    SparseArray mMarks;
+    IntegerArrayPtr mBackHolder;
+    const IntegerArray& mBack;
+};
+
+#endif // UNITIGINDEX_HH
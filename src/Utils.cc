@@ -8,6 +8,7 @@
 //
 #include "Utils.hh"
 #include "GossamerException.hh"
+#include "BitKernels.hh"
 
 #ifdef __GNUC__
 #include <dirent.h>
@@ -18,7 +19,9 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
 #include <atomic>
+#include <stdlib.h>
 
 
 namespace Gossamer {
@@ -188,6 +191,31 @@ namespace Gossamer {
     };
 #endif
 
+    std::vector<uint32_t> parseProcessorList(const std::string& pList)
+    {
+        std::vector<uint32_t> xs;
+        uint64_t i = 0;
+        while (i < pList.size())
+        {
+            const uint64_t e = std::min(pList.find(',', i), pList.size());
+            const std::string item(pList.substr(i, e - i));
+            i = e + 1;
+            if (item.find_first_of("0123456789") == std::string::npos)
+            {
+                continue;
+            }
+            const uint64_t dash = item.find('-');
+            const uint32_t b = strtoul(item.c_str(), NULL, 10);
+            const uint32_t l = dash == std::string::npos ? b : strtoul(item.c_str() + dash + 1, NULL, 10);
+            for (uint64_t x = b; x <= l; ++x)
+            {
+                xs.push_back(x);
+            }
+        }
+        sortAndUnique(xs);
+        return xs;
+    }
+
 }
 
 namespace {
@@ -309,6 +337,7 @@ MachineAutoSetup::setup()
     }
     setupMachineSpecific();
     testInstructions();
+    BitKernels::setup();
     sInitialised = true;
 }
 
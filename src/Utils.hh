@@ -44,6 +44,11 @@
 #define STD_ITERATOR
 #endif
 
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
 #ifndef STD_IOSTREAM
 #include <iostream>
 #define STD_IOSTREAM
@@ -151,6 +156,24 @@ namespace Gossamer
 uint32_t logicalProcessorCount();
 
 
+/// Instruction set extensions that kernels may be specialised for.
+enum CpuFeature
+{
+    kCpuPopcnt = 0,
+    kCpuBmi1,
+    kCpuBmi2,
+    kCpuAvx2,
+    kCpuAvx512f,
+    kCpuAvx512Vpopcntdq,
+    kCpuFastPdep,           // BMI2's PDEP/PEXT in hardware, not microcode
+    kCpuFeatureCount
+};
+
+
+/// True if both the processor and the operating system support pFeature.
+bool cpuHas(CpuFeature pFeature);
+
+
 inline uint32_t popcnt(uint64_t pWord)
 {
     BOOST_STATIC_ASSERT(sizeof(long) == 8 || sizeof(unsigned long long) == 8);
@@ -500,6 +523,30 @@ sortAndUnique(Container& pContainer)
 std::string defaultTmpDir(); // OS dependent
 
 
+// Spread pages subsequently allocated by the calling thread across
+// all memory nodes (pInterleave = true), or revert to the default
+// node-local allocation. Returns false if the platform doesn't
+// support it or the kernel refuses, in which case nothing is changed.
+bool interleaveMemory(bool pInterleave); // OS dependent
+
+
+// The processors the calling process may run on, grouped by the
+// memory node they belong to and indexed by node number. Nodes with
+// none of them have an empty group. Platforms which don't say, and
+// machines with only one node, have a single group.
+std::vector<std::vector<uint32_t> > processorsByNode(); // OS dependent
+
+
+// Restrict the calling thread to the processor pProcessor. Returns
+// false if that isn't possible, in which case nothing is changed.
+bool pinThread(uint32_t pProcessor); // OS dependent
+
+
+// Parse a list of processors or nodes in the form Linux uses in /sys,
+// e.g. "0-3,8,10-11", into ascending order.
+std::vector<uint32_t> parseProcessorList(const std::string& pList);
+
+
 // Helper class to implement the empty member optimisation.
 // See http://www.cantrip.org/emptyopt.html for details.
 //
@@ -8,8 +8,10 @@
 //
 #include "VariableByteArray.hh"
 
+#include "BitKernels.hh"
 #include "Debug.hh"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace Gossamer;
@@ -18,34 +20,228 @@ using namespace std;
 static Debug showBitmapSizeAndCount("variable-byte-array-size-and-count",
                 "when opening a variable-byte-array, show the size and count of the continuation bitmaps.");
 
+const uint64_t VariableByteArray::fusedVersion;
+const uint64_t VariableByteArray::BlockItems;
+const uint8_t VariableByteArray::Escape;
+
+namespace // anonymous
+{
+    string fusedHeaderName(const string& pBaseName)
+    {
+        return pBaseName + ".fused";
+    }
+
+    VariableByteArray::FusedHeader readFusedHeader(const string& pBaseName, FileFactory& pFactory)
+    {
+        VariableByteArray::FusedHeader h;
+        FileFactory::InHolderPtr ip(pFactory.in(fusedHeaderName(pBaseName)));
+        istream& i(**ip);
+        i.read(reinterpret_cast<char*>(&h), sizeof(h));
+        if (h.version != VariableByteArray::fusedVersion)
+        {
+            BOOST_THROW_EXCEPTION(
+                Gossamer::error()
+                    << boost::errinfo_file_name(fusedHeaderName(pBaseName))
+                    << Gossamer::version_mismatch_info(
+                            pair<uint64_t,uint64_t>(h.version, VariableByteArray::fusedVersion)));
+        }
+        return h;
+    }
+}
+// namespace anonymous
+
 void
 VariableByteArray::Builder::end()
 {
-    mOrder0.end();
-    mOrder1Present.end(bitmap_traits::init(mPosition0));
-    mOrder1.end();
-    mOrder2Present.end(bitmap_traits::init(mPosition1));
-    mOrder2.end();
+    if (mFused)
+    {
+        if (mPosition0 % BlockItems)
+        {
+            flushBlock();
+        }
+        mBlocks->end();
+        mExceptions->end();
+
+        FusedHeader h;
+        h.version = fusedVersion;
+        h.size = mPosition0;
+        h.exceptions = mPosition1;
+        FileFactory::OutHolderPtr op(mFactory.out(fusedHeaderName(mBaseName)));
+        ostream& o(**op);
+        o.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        return;
+    }
+
+    mOrder0->end();
+    mOrder1Present->end(bitmap_traits::init(mPosition0));
+    mOrder1->end();
+    mOrder2Present->end(bitmap_traits::init(mPosition1));
+    mOrder2->end();
+}
+
+
+void
+VariableByteArray::Builder::flushBlock()
+{
+    mBlocks->push_back(mBlock);
+    mBlock.base = mPosition1;
+    mBlock.escapes = 0;
+    std::fill(mBlock.low, mBlock.low + BlockItems, 0);
 }
 
 
 VariableByteArray::Builder::Builder(const std::string& pBaseName, FileFactory& pFactory,
-                                    uint64_t pNumItems, double pFrac)
-    : mPosition0(0), mPosition1(0),
-      mOrder0(pBaseName + ".ord0", pFactory),
-      mOrder1Present(pBaseName + ".ord1p", pFactory, bitmap_traits::init(pNumItems), pNumItems * 0.001),
-      //mOrder1Present(pBaseName + ".ord1p", pFactory, bitmap_traits::init(pNumItems)),
-      mOrder1(pBaseName + ".ord1", pFactory),
-      mOrder2Present(pBaseName + ".ord2p", pFactory, bitmap_traits::init(pNumItems), pNumItems * 0.001),
-      //mOrder2Present(pBaseName + ".ord2p", pFactory, bitmap_traits::init(pNumItems)),
-      mOrder2(pBaseName + ".ord2", pFactory)
+                                    uint64_t pNumItems, double pFrac, Format pFormat)
+    : mBaseName(pBaseName), mFactory(pFactory), mFused(pFormat == FusedFormat),
+      mPosition0(0), mPosition1(0)
+{
+    if (mFused)
+    {
+        mBlock.base = 0;
+        mBlock.escapes = 0;
+        std::fill(mBlock.low, mBlock.low + BlockItems, 0);
+        mBlocks.reset(new MappedArray<Block>::Builder(pBaseName + ".blk", pFactory));
+        mExceptions.reset(new MappedArray<value_type>::Builder(pBaseName + ".exc", pFactory));
+        return;
+    }
+
+    mOrder0.reset(new MappedArray<uint8_t>::Builder(pBaseName + ".ord0", pFactory));
+    mOrder1Present.reset(new bitmap_type::Builder(pBaseName + ".ord1p", pFactory,
+                                                  bitmap_traits::init(pNumItems), pNumItems * 0.001));
+    mOrder1.reset(new MappedArray<uint8_t>::Builder(pBaseName + ".ord1", pFactory));
+    mOrder2Present.reset(new bitmap_type::Builder(pBaseName + ".ord2p", pFactory,
+                                                  bitmap_traits::init(pNumItems), pNumItems * 0.001));
+    mOrder2.reset(new MappedArray<uint16_t>::Builder(pBaseName + ".ord2", pFactory));
+}
+
+
+VariableByteArray::Iterator
+VariableByteArray::iterator() const
+{
+    if (mFused)
+    {
+        return Iterator(Iterator::fused_type(mSize, mFused->blocks.iterator(), mFused->exceptions.iterator()));
+    }
+    const Layered& l(*mLayered);
+    return Iterator(Iterator::layered_type(l.order0.iterator(),
+                                           l.order1Present.iterator(), l.order1.iterator(),
+                                           l.order2Present.iterator(), l.order2.iterator()));
+}
+
+
+VariableByteArray::LazyIterator
+VariableByteArray::lazyIterator(const std::string& pBaseName, FileFactory& pFactory,
+                                Format pFormat)
+{
+    if (pFormat == FusedFormat)
+    {
+        FusedHeader h = readFusedHeader(pBaseName, pFactory);
+        return LazyIterator(LazyIterator::fused_type(h.size,
+                                MappedArray<Block>::lazyIterator(pBaseName + ".blk", pFactory),
+                                MappedArray<value_type>::lazyIterator(pBaseName + ".exc", pFactory)));
+    }
+    return LazyIterator(LazyIterator::layered_type(
+                            MappedArray<uint8_t>::lazyIterator(pBaseName + ".ord0", pFactory),
+                            bitmap_type::lazyIterator(pBaseName + ".ord1p", pFactory),
+                            MappedArray<uint8_t>::lazyIterator(pBaseName + ".ord1", pFactory),
+                            bitmap_type::lazyIterator(pBaseName + ".ord2p", pFactory),
+                            MappedArray<uint16_t>::lazyIterator(pBaseName + ".ord2", pFactory)));
+}
+
+
+uint64_t
+VariableByteArray::greaterMask(uint64_t pBegin, value_type pValue) const
 {
+    BOOST_ASSERT(pBegin % BlockItems == 0);
+    BOOST_ASSERT(pBegin < mSize);
+    const uint64_t n = std::min(BlockItems, mSize - pBegin);
+
+    if (mFused)
+    {
+        // Escaped items are at least Escape.
+        const Block& b(mFused->blocks[pBegin / BlockItems]);
+        if (pValue < Escape)
+        {
+            return BitKernels::greaterMask(b.low, n, static_cast<uint8_t>(pValue));
+        }
+        uint64_t m = 0;
+        uint64_t r = b.base;
+        for (uint64_t e = b.escapes; e; e &= e - 1, ++r)
+        {
+            if (mFused->exceptions[r] > pValue)
+            {
+                m |= e & -e;
+            }
+        }
+        return m;
+    }
+
+    // Items with an order 1 byte are at least 256.
+    const Layered& l(*mLayered);
+    uint64_t m = 0;
+    if (pValue < 256)
+    {
+        m = BitKernels::greaterMask(&l.order0[pBegin], n, static_cast<uint8_t>(pValue));
+    }
+    const uint64_t r0 = l.order1Present.rank(bitmap_traits::init(pBegin));
+    const uint64_t r1 = l.order1Present.rank(bitmap_traits::init(pBegin + n));
+    for (uint64_t r = r0; r < r1; ++r)
+    {
+        const uint64_t i = bitmap_traits::asUInt64(l.order1Present.select(r)) - pBegin;
+        if (pValue < 256 || (*this)[pBegin + i] > pValue)
+        {
+            m |= one << i;
+        }
+    }
+    return m;
+}
+
+
+PropertyTree
+VariableByteArray::stat() const
+{
+    PropertyTree t;
+    t.putProp("size", size());
+
+    uint64_t s = 0;
+    if (mFused)
+    {
+        t.putProp("format", "fused");
+        t.putSub("blocks", mFused->blocks.stat());
+        t.putSub("exceptions", mFused->exceptions.stat());
+        s += t("blocks").as<uint64_t>("storage");
+        s += t("exceptions").as<uint64_t>("storage");
+    }
+    else
+    {
+        const Layered& l(*mLayered);
+        t.putProp("format", "layered");
+        t.putSub("ord1-pred", l.order1Present.stat());
+        t.putSub("ord2-pred", l.order2Present.stat());
+
+        s += 1 * l.order0.size();
+        s += t("ord1-pred").as<uint64_t>("storage");
+        s += 1 * l.order1.size();
+        s += t("ord2-pred").as<uint64_t>("storage");
+        s += 2 * l.order2.size();
+    }
+    t.putProp("storage", s);
+
+    return t;
 }
 
 
 void
-VariableByteArray::remove(const std::string& pBaseName, FileFactory& pFactory)
+VariableByteArray::remove(const std::string& pBaseName, FileFactory& pFactory,
+                          Format pFormat)
 {
+    if (pFormat == FusedFormat)
+    {
+        pFactory.remove(fusedHeaderName(pBaseName));
+        pFactory.remove(pBaseName + ".blk");
+        pFactory.remove(pBaseName + ".exc");
+        return;
+    }
     pFactory.remove(pBaseName + ".ord0");
     pFactory.remove(pBaseName + ".ord1");
     pFactory.remove(pBaseName + ".ord2");
@@ -53,18 +249,47 @@ VariableByteArray::remove(const std::string& pBaseName, FileFactory& pFactory)
     SparseArray::remove(pBaseName + ".ord2p", pFactory);
 }
 
+
+VariableByteArray::Layered::Layered(const std::string& pBaseName, FileFactory& pFactory)
+    : order0(pBaseName + ".ord0", pFactory),
+      order1Present(pBaseName + ".ord1p", pFactory),
+      order1(pBaseName + ".ord1", pFactory),
+      order2Present(pBaseName + ".ord2p", pFactory),
+      order2(pBaseName + ".ord2", pFactory)
+{
+}
+
+
+VariableByteArray::Fused::Fused(const std::string& pBaseName, FileFactory& pFactory)
+    : blocks(pBaseName + ".blk", pFactory),
+      exceptions(pBaseName + ".exc", pFactory)
+{
+}
+
+
 VariableByteArray::VariableByteArray(const std::string& pBaseName,
-                                     FileFactory& pFactory)
-    : mOrder0(pBaseName + ".ord0", pFactory),
-      mOrder1Present(pBaseName + ".ord1p", pFactory),
-      mOrder1(pBaseName + ".ord1", pFactory),
-      mOrder2Present(pBaseName + ".ord2p", pFactory),
-      mOrder2(pBaseName + ".ord2", pFactory)
+                                     FileFactory& pFactory, Format pFormat)
+    : mSize(0)
 {
+    if (pFormat == FusedFormat)
+    {
+        FusedHeader h = readFusedHeader(pBaseName, pFactory);
+        mFused.reset(new Fused(pBaseName, pFactory));
+        mSize = h.size;
+        if (showBitmapSizeAndCount.on())
+        {
+            cerr << "Opening: " << pBaseName << endl;
+            cerr << "\tblocks\t" << mFused->blocks.size() << '\t' << mFused->exceptions.size() << endl;
+        }
+        return;
+    }
+
+    mLayered.reset(new Layered(pBaseName, pFactory));
+    mSize = mLayered->order0.size();
     if (showBitmapSizeAndCount.on())
     {
         cerr << "Opening: " << pBaseName << endl;
-        cerr << "\tord1p\t" << mOrder1Present.size() << '\t' << mOrder1Present.count() << endl;
-        cerr << "\tord2p\t" << mOrder2Present.size() << '\t' << mOrder2Present.count() << endl;
+        cerr << "\tord1p\t" << mLayered->order1Present.size() << '\t' << mLayered->order1Present.count() << endl;
+        cerr << "\tord2p\t" << mLayered->order2Present.size() << '\t' << mLayered->order2Present.count() << endl;
     }
 }
@@ -64,6 +64,16 @@ struct VariableByteArrayTraits<SparseArray>
     }
 };
 
+#ifndef BOOST_OPTIONAL_HPP
+#include <boost/optional.hpp>
+#define BOOST_OPTIONAL_HPP
+#endif
+
+#ifndef STD_MEMORY
+#include <memory>
+#define STD_MEMORY
+#endif
+
 class VariableByteArray
 {
 public:
@@ -73,6 +83,38 @@ public:
 
     static const uint64_t one = 1;
 
+    // The on-disk layout of the array.
+    //
+    // LayeredFormat stores the low byte of every item, and the higher
+    // order bytes in separate arrays indexed by rank over a pair of
+    // continuation bitmaps. It is compact, but a large value costs
+    // two accessAndRank calls on sparse arrays.
+    //
+    // FusedFormat stores items in blocks of 64, each holding the low
+    // bytes, a bitmap of the items that didn't fit in a byte, and the
+    // position of the block's first exception. Small values need a
+    // single memory access, and exceptions need one popcount within
+    // the same block. It costs about 1.25 bytes per item.
+    enum Format { LayeredFormat, FusedFormat };
+
+    static const uint64_t fusedVersion = 2016110101ULL;
+    static const uint64_t BlockItems = 64;
+    static const uint8_t Escape = 0xff;
+
+    struct Block
+    {
+        uint64_t base;
+        uint64_t escapes;
+        uint8_t low[BlockItems];
+    };
+
+    struct FusedHeader
+    {
+        uint64_t version;
+        uint64_t size;
+        uint64_t exceptions;
+    };
+
     class Builder
     {
     public:
@@ -80,41 +122,78 @@ public:
         
         void push_back(value_type pNumber)
         {
+            if (mFused)
+            {
+                pushFused(pNumber);
+                return;
+            }
+
             uint64_t pos = mPosition0++;
-            mOrder0.push_back(static_cast<uint8_t>(pNumber & 0xff));
+            mOrder0->push_back(static_cast<uint8_t>(pNumber & 0xff));
 
             if (!(pNumber >>= 8))
             {
                 return;
             }
 
-            mOrder1Present.push_back(bitmap_type::position_type(pos));
+            mOrder1Present->push_back(bitmap_type::position_type(pos));
 
             pos = mPosition1++;
-            mOrder1.push_back(static_cast<uint8_t>(pNumber & 0xff));
+            mOrder1->push_back(static_cast<uint8_t>(pNumber & 0xff));
 
             if (!(pNumber >>= 8))
             {
                 return;
             }
 
-            mOrder2Present.push_back(bitmap_traits::init(pos));
-            mOrder2.push_back(static_cast<uint16_t>(pNumber & 0xffff));
+            mOrder2Present->push_back(bitmap_traits::init(pos));
+            mOrder2->push_back(static_cast<uint16_t>(pNumber & 0xffff));
         }
 
         void end();
 
-        Builder(const std::string& pBaseName, FileFactory& pFactory, uint64_t pNumItems, double pFrac);
+        Builder(const std::string& pBaseName, FileFactory& pFactory, uint64_t pNumItems, double pFrac,
+                Format pFormat = LayeredFormat);
 
     private:
+
+        void pushFused(value_type pNumber)
+        {
+            uint64_t j = mPosition0++ % BlockItems;
+            if (pNumber < Escape)
+            {
+                mBlock.low[j] = static_cast<uint8_t>(pNumber);
+            }
+            else
+            {
+                mBlock.low[j] = Escape;
+                mBlock.escapes |= one << j;
+                mExceptions->push_back(pNumber);
+                ++mPosition1;
+            }
+            if (j == BlockItems - 1)
+            {
+                flushBlock();
+            }
+        }
+
+        void flushBlock();
+
+        const std::string mBaseName;
+        FileFactory& mFactory;
+        const bool mFused;
         uint64_t mPosition0;
         uint64_t mPosition1;
 
-        MappedArray<uint8_t>::Builder mOrder0;
-        bitmap_type::Builder mOrder1Present;
-        MappedArray<uint8_t>::Builder mOrder1;
-        bitmap_type::Builder mOrder2Present;
-        MappedArray<uint16_t>::Builder mOrder2;
+        std::unique_ptr<MappedArray<uint8_t>::Builder> mOrder0;
+        std::unique_ptr<bitmap_type::Builder> mOrder1Present;
+        std::unique_ptr<MappedArray<uint8_t>::Builder> mOrder1;
+        std::unique_ptr<bitmap_type::Builder> mOrder2Present;
+        std::unique_ptr<MappedArray<uint16_t>::Builder> mOrder2;
+
+        Block mBlock;
+        std::unique_ptr<MappedArray<Block>::Builder> mBlocks;
+        std::unique_ptr<MappedArray<value_type>::Builder> mExceptions;
     };
 
     template <typename MItr8, typename MItr16, typename BItr>
@@ -194,91 +273,205 @@ public:
         bool mValid;
     };
 
-    typedef GeneralIterator<MappedArray<uint8_t>::Iterator,
-                            MappedArray<uint16_t>::Iterator,
-                            bitmap_type::Iterator>
+    template <typename BlkItr, typename ExcItr>
+    class FusedIterator
+    {
+    public:
+        bool valid() const
+        {
+            return mPos < mSize;
+        }
+
+        value_type operator*() const
+        {
+            return mCurr;
+        }
+
+        void operator++()
+        {
+            if (++mPos % BlockItems == 0)
+            {
+                ++mBlkItr;
+            }
+            get();
+        }
+
+        FusedIterator(uint64_t pSize, const BlkItr& pBlkItr, const ExcItr& pExcItr)
+            : mSize(pSize), mPos(0), mBlkItr(pBlkItr), mExcItr(pExcItr), mCurr(0)
+        {
+            get();
+        }
+
+    private:
+
+        void get()
+        {
+            if (!valid())
+            {
+                return;
+            }
+            mCurr = (*mBlkItr).low[mPos % BlockItems];
+            if (mCurr == Escape)
+            {
+                mCurr = *mExcItr;
+                ++mExcItr;
+            }
+        }
+
+        uint64_t mSize;
+        uint64_t mPos;
+        BlkItr mBlkItr;
+        ExcItr mExcItr;
+        value_type mCurr;
+    };
+
+    // An iterator over either layout.
+    template <typename LItr, typename FItr>
+    class DualIterator
+    {
+    public:
+        typedef LItr layered_type;
+        typedef FItr fused_type;
+
+        bool valid() const
+        {
+            return mLayered ? mLayered->valid() : mFused->valid();
+        }
+
+        value_type operator*() const
+        {
+            return mLayered ? **mLayered : **mFused;
+        }
+
+        void operator++()
+        {
+            if (mLayered)
+            {
+                ++*mLayered;
+            }
+            else
+            {
+                ++*mFused;
+            }
+        }
+
+        explicit DualIterator(const LItr& pItr)
+            : mLayered(pItr)
+        {
+        }
+
+        explicit DualIterator(const FItr& pItr)
+            : mFused(pItr)
+        {
+        }
+
+    private:
+        boost::optional<LItr> mLayered;
+        boost::optional<FItr> mFused;
+    };
+
+    typedef DualIterator<
+                GeneralIterator<MappedArray<uint8_t>::Iterator,
+                                MappedArray<uint16_t>::Iterator,
+                                bitmap_type::Iterator>,
+                FusedIterator<MappedArray<Block>::Iterator,
+                              MappedArray<value_type>::Iterator> >
                                                                 Iterator;
-    typedef GeneralIterator<MappedArray<uint8_t>::LazyIterator,
-                            MappedArray<uint16_t>::LazyIterator,
-                            bitmap_type::LazyIterator>
+    typedef DualIterator<
+                GeneralIterator<MappedArray<uint8_t>::LazyIterator,
+                                MappedArray<uint16_t>::LazyIterator,
+                                bitmap_type::LazyIterator>,
+                FusedIterator<MappedArray<Block>::LazyIterator,
+                              MappedArray<value_type>::LazyIterator> >
                                                                 LazyIterator;
 
-    Iterator iterator() const
-    {
-        return Iterator(mOrder0.iterator(),
-                        mOrder1Present.iterator(), mOrder1.iterator(),
-                        mOrder2Present.iterator(), mOrder2.iterator());
-    }
+    Iterator iterator() const;
+
+    // The layout of an array isn't recorded with it, so it must be
+    // given when the array is opened, iterated over, or removed.
+    static LazyIterator lazyIterator(const std::string& pBaseName, FileFactory& pFactory,
+                                     Format pFormat = LayeredFormat);
 
-    static LazyIterator lazyIterator(const std::string& pBaseName, FileFactory& pFactory)
+    Format format() const
     {
-        return LazyIterator(MappedArray<uint8_t>::lazyIterator(pBaseName + ".ord0", pFactory),
-                            bitmap_type::lazyIterator(pBaseName + ".ord1p", pFactory),
-                            MappedArray<uint8_t>::lazyIterator(pBaseName + ".ord1", pFactory),
-                            bitmap_type::lazyIterator(pBaseName + ".ord2p", pFactory),
-                            MappedArray<uint16_t>::lazyIterator(pBaseName + ".ord2", pFactory));
+        return mFused ? FusedFormat : LayeredFormat;
     }
 
     uint64_t size() const
     {
-        return mOrder0.size();
+        return mSize;
     }
 
     value_type operator[](uint64_t pIndex) const
     {
-        using namespace std;
+        if (mFused)
+        {
+            const Block& b(mFused->blocks[pIndex / BlockItems]);
+            const uint64_t j = pIndex % BlockItems;
+            if (b.low[j] != Escape)
+            {
+                return b.low[j];
+            }
+            return mFused->exceptions[b.base + Gossamer::popcnt(b.escapes & ((one << j) - 1))];
+        }
 
-        value_type result = static_cast<value_type>(mOrder0[pIndex]);
+        const Layered& l(*mLayered);
+        value_type result = static_cast<value_type>(l.order0[pIndex]);
         uint64_t r1;
-        if (!mOrder1Present.accessAndRank(bitmap_traits::init(pIndex), r1))
+        if (!l.order1Present.accessAndRank(bitmap_traits::init(pIndex), r1))
         {
             return result;
         }
-        result |= static_cast<value_type>(mOrder1[r1]) << 8;
+        result |= static_cast<value_type>(l.order1[r1]) << 8;
 
         uint64_t r2;
-        if (!mOrder2Present.accessAndRank(bitmap_traits::init(r1), r2))
+        if (!l.order2Present.accessAndRank(bitmap_traits::init(r1), r2))
         {
             return result;
         }
 
-        result |= static_cast<value_type>(mOrder2[r2]) << 16;
+        result |= static_cast<value_type>(l.order2[r2]) << 16;
         return result;
     }
 
-    PropertyTree stat() const
-    {
-        PropertyTree t;
-        t.putSub("ord1-pred", mOrder1Present.stat());
-        t.putSub("ord2-pred", mOrder2Present.stat());
+    // Bit i is set if the item at pBegin + i is greater than pValue,
+    // for the items [pBegin, min(pBegin + BlockItems, size())). pBegin
+    // must be a multiple of BlockItems. The low bytes are compared all
+    // at once, and only the items with more bytes are looked at singly.
+    uint64_t greaterMask(uint64_t pBegin, value_type pValue) const;
 
-        t.putProp("size", size());
+    PropertyTree stat() const;
 
-        uint64_t s = 0;
-        s += 1 * mOrder0.size();
-        s += t("ord1-pred").as<uint64_t>("storage");
-        s += 1 * mOrder1.size();
-        s += t("ord2-pred").as<uint64_t>("storage");
-        s += 2 * mOrder2.size();
-        t.putProp("storage", s);
+    static void remove(const std::string& pBaseName, FileFactory& pFactory,
+                       Format pFormat = LayeredFormat);
 
-        return t;
-    }
+    VariableByteArray(const std::string& pBaseName, FileFactory& pFactory,
+                      Format pFormat = LayeredFormat);
 
-    static void remove(const std::string& pBaseName, FileFactory& pFactory);
+private:
 
-    VariableByteArray(const std::string& pBaseName, FileFactory& pFactory);
+    struct Layered
+    {
+        MappedArray<uint8_t> order0;
+        bitmap_type order1Present;
+        MappedArray<uint8_t> order1;
+        bitmap_type order2Present;
+        MappedArray<uint16_t> order2;
 
-private:
+        Layered(const std::string& pBaseName, FileFactory& pFactory);
+    };
 
-    friend class VariableByteArray::Builder;
-    // friend class VariableByteArray::Iterator;
+    struct Fused
+    {
+        MappedArray<Block> blocks;
+        MappedArray<value_type> exceptions;
+
+        Fused(const std::string& pBaseName, FileFactory& pFactory);
+    };
 
-    MappedArray<uint8_t> mOrder0;
-    bitmap_type mOrder1Present;
-    MappedArray<uint8_t> mOrder1;
-    bitmap_type mOrder2Present;
-    MappedArray<uint16_t> mOrder2;
+    std::unique_ptr<Layered> mLayered;
+    std::unique_ptr<Fused> mFused;
+    uint64_t mSize;
 };
 
 #endif // VARIABLEBYTEARRAY_HH
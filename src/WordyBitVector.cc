@@ -65,10 +65,7 @@ WordyBitVector::popcountRange(uint64_t pBegin, uint64_t pEnd) const
     }
 
     uint64_t rank = Gossamer::popcnt(mWords[wb] & beginMask);
-    for (uint64_t i = wb + 1; i < we; ++i)
-    {
-        rank += Gossamer::popcnt(mWords[i]);
-    }
+    rank += BitKernels::popcount(mWords.begin() + wb + 1, we - wb - 1);
     if (be > 0)
     {
         rank += Gossamer::popcnt(mWords[we] & endMask);
@@ -19,6 +19,10 @@
 #define STD_OSTREAM
 #endif
 
+#ifndef BITKERNELS_HH
+#include "BitKernels.hh"
+#endif
+
 #ifndef MAPPEDARRAY_HH
 #include "MappedArray.hh"
 #endif
@@ -168,6 +172,24 @@ public:
             seek1();
         }
 
+        // Start at the first 1 at or after pBegin, with pItr at the
+        // word holding pBegin.
+        GeneralIterator(const Itr& pItr, uint64_t pBegin)
+            : mWordItr(pItr), mValid(true),
+              mCurrWordNum(pBegin / wordBits), mCurrBitPos(0), mCurrWord(0)
+        {
+            if (mWordItr.valid())
+            {
+                mCurrWord = *mWordItr & (~uint64_t(0) << (pBegin % wordBits));
+            }
+            else
+            {
+                mValid = false;
+                return;
+            }
+            seek1();
+        }
+
     private:
         void next()
         {
@@ -231,6 +253,13 @@ public:
         return Iterator1(mWords.iterator());
     }
 
+    // The same, from position pBegin on.
+    //
+    Iterator1 iterator1(uint64_t pBegin) const
+    {
+        return Iterator1(mWords.iterator(pBegin / wordBits), pBegin);
+    }
+
     static LazyIterator1 lazyIterator1(const std::string& pName, FileFactory& pFactory)
     {
         return LazyIterator1(MappedArray<uint64_t>::lazyIterator(pName, pFactory));
@@ -33,24 +33,24 @@ WordyBitVector::select(uint64_t pFrom, uint64_t pCount) const
     uint64_t c = pCount;
     uint64_t x = (Sense::sInvert ? ~mWords[w] : mWords[w]) >> b;
     uint64_t p = Gossamer::popcnt(x);
-    while (c >= p)
+    if (c >= p)
     {
         c -= p;
         ++w;
         b = 0;
-#ifndef NDEBUG
-        if (w >= words())
+        const uint64_t n = words() - w;
+        const uint64_t i = BitKernels::selectWord(mWords.begin() + w, n, Sense::sInvert, c);
+        if (i == n)
         {
             BOOST_THROW_EXCEPTION(
                 Gossamer::error()
-                    << Gossamer::range_error("WordyBitVector::select", words(), w));
+                    << Gossamer::range_error("WordyBitVector::select", words(), words()));
         }
-#endif
+        w += i;
         x = (Sense::sInvert ? ~mWords[w] : mWords[w]);
-        p = Gossamer::popcnt(x);
     }
 
-    return (w * wordBits) + b + Gossamer::select1(x, c);
+    return (w * wordBits) + b + BitKernels::select(x, c);
 }
 
 
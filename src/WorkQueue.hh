@@ -11,12 +11,26 @@
 
 #include <boost/noncopyable.hpp>
 #include <boost/function.hpp>
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
 #include <deque>
+#include "EventCount.hh"
+#include "MpmcRing.hh"
 #include "ThreadGroup.hh"
+#include "ThreadPlacement.hh"
 
+// Run items on a pool of threads.
+//
+// The items wait in a deque guarded by a mutex or, if the queue is
+// made with pRing set (by default, on machines with many processors;
+// see ThreadPlacement::ringQueues), in a lock-free ring. Items may be
+// pushed by the items themselves (see JobManager), so push_back()
+// mustn't wait for room: when the ring is full, items go to the deque
+// instead, which is drained once the ring is empty, so that items
+// pushed by a single thread are still started in order.
+//
 class WorkQueue
 {
 public:
@@ -28,19 +42,69 @@ private:
     friend class Worker;
     typedef std::shared_ptr<Worker> WorkerPtr;
 
+    static const uint64_t sRingItems = 1024;
+
     std::mutex mMutex;
     std::condition_variable mCond;
     Items mItems;
     uint64_t mWaiters;
-    bool mFinished;
+    std::atomic<bool> mFinished;
     bool mJoined;
+    const std::unique_ptr<MpmcRing<Item> > mRing;
+    std::atomic<uint64_t> mOverflowItems;
+    EventCount mNotEmpty;
     std::vector<WorkerPtr> mWorkers;
     ThreadGroup mThreads;
 
+    // Take an item from the ring, or failing that, from the overflow.
+    bool tryTake(Item& pItem)
+    {
+        if (mRing->tryPop(pItem))
+        {
+            return true;
+        }
+        if (mOverflowItems.load(std::memory_order_seq_cst) == 0)
+        {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (mItems.empty())
+        {
+            return false;
+        }
+        pItem = mItems.front();
+        mItems.pop_front();
+        mOverflowItems.store(mItems.size(), std::memory_order_seq_cst);
+        return true;
+    }
+
+    bool ringEmpty() const
+    {
+        return mRing->empty() && mOverflowItems.load(std::memory_order_seq_cst) == 0;
+    }
+
     class Worker
     {
     public:
         void operator()()
+        {
+            if (mQueue.mRing)
+            {
+                runRing();
+            }
+            else
+            {
+                runLocked();
+            }
+        }
+
+        Worker(WorkQueue& pQueue)
+            : mQueue(pQueue)
+        {
+        }
+
+    private:
+        void runLocked()
         {
             while (true)
             {
@@ -66,12 +130,32 @@ private:
             }
         }
 
-        Worker(WorkQueue& pQueue)
-            : mQueue(pQueue)
+        void runRing()
         {
+            while (true)
+            {
+                Item itm;
+                if (!mQueue.tryTake(itm))
+                {
+                    bool got = false;
+                    mQueue.mNotEmpty.await([&]() {
+                        const bool finished = mQueue.mFinished.load(std::memory_order_seq_cst);
+                        if (mQueue.ringEmpty() && !finished)
+                        {
+                            return false;
+                        }
+                        got = mQueue.tryTake(itm);
+                        return got || finished;
+                    });
+                    if (!got)
+                    {
+                        return;
+                    }
+                }
+                itm();
+            }
         }
 
-    private:
         WorkQueue& mQueue;
     };
 
@@ -79,6 +163,17 @@ public:
 
     void push_back(const Item& pItem)
     {
+        if (mRing)
+        {
+            if (mOverflowItems.load(std::memory_order_seq_cst) > 0 || !mRing->tryPush(pItem))
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mItems.push_back(pItem);
+                mOverflowItems.store(mItems.size(), std::memory_order_seq_cst);
+            }
+            mNotEmpty.notifyOne();
+            return;
+        }
         std::unique_lock<std::mutex> lock(mMutex);
         mItems.push_back(pItem);
         if (mWaiters > 0)
@@ -94,12 +189,20 @@ public:
             mFinished = true;
             mCond.notify_all();
         }
+        mNotEmpty.notifyAll();
         mThreads.join();
         mJoined = true;
     }
 
-    WorkQueue(uint64_t pNumThreads)
-        : mWaiters(0), mFinished(false), mJoined(false)
+    // True iff the items go through a lock-free ring.
+    bool ring() const
+    {
+        return mRing != nullptr;
+    }
+
+    WorkQueue(uint64_t pNumThreads, bool pRing = ThreadPlacement::process().ringQueues())
+        : mWaiters(0), mFinished(false), mJoined(false),
+          mRing(pRing ? new MpmcRing<Item>(sRingItems) : 0), mOverflowItems(0)
     {
         //std::cerr << "creating WorkQueue with " << pNumThreads << " threads." << std::endl;
         mWorkers.reserve(pNumThreads);
@@ -107,7 +210,7 @@ public:
         {
             auto w = std::shared_ptr<Worker>(new Worker(*this));
             mWorkers.push_back(w);
-            mThreads.create(*w);
+            mThreads.create(*w, i, pNumThreads);
         }
     }
 
@@ -15,6 +15,7 @@
 #include "GossCmdReg.hh"
 #include "GossOption.hh"
 #include "GossOptionChecker.hh"
+#include "KmerSet.hh"
 #include "Logger.hh"
 #include "PhysicalFileFactory.hh"
 #include "Timer.hh"
@@ -72,15 +73,23 @@ namespace // anonymous
             log(info, "merging host and graft reference kmer sets");
             GossCmdMergeAndAnnotateKmerSets(g, h, b)(pCxt);
 
+            if (mPrefilterBits)
+            {
+                log(info, "building prefilter");
+                KmerSet::buildPrefilter(b, pCxt.fac, mPrefilterBits);
+            }
+
             log(info, "computing marginal kmers");
-            GossCmdComputeNearKmers(b, mT)(pCxt);
+            GossCmdComputeNearKmers(b, 1, mT)(pCxt);
 
             log(info, "total elapsed time: " + lexical_cast<string>(t.check()));
         }
 
         XenoCmdIndex(const std::string& pGraft, const std::string& pHost,
-                     const std::string& pOut, uint64_t pK, double pM, uint64_t pT)
-            : mGraft(pGraft), mHost(pHost), mOut(pOut), mK(pK), mM(pM), mT(pT)
+                     const std::string& pOut, uint64_t pK, double pM, uint64_t pT,
+                     uint64_t pPrefilterBits)
+            : mGraft(pGraft), mHost(pHost), mOut(pOut), mK(pK), mM(pM), mT(pT),
+              mPrefilterBits(pPrefilterBits)
         {
         }
 
@@ -91,6 +100,7 @@ namespace // anonymous
         const uint64_t mK;
         const double mM;
         const uint64_t mT;
+        const uint64_t mPrefilterBits;
     };
 
     class XenoCmdFactoryIndex : public GossCmdFactory
@@ -118,9 +128,12 @@ namespace // anonymous
             uint64_t T = 4;
             chk.getOptional("num-threads", T);
 
+            uint64_t prefilterBits = 0;
+            chk.getOptional("prefilter-bits", prefilterBits);
+
             chk.throwIfNecessary(pApp);
 
-            return GossCmdPtr(new XenoCmdIndex(graft, host, out, K, M, T));
+            return GossCmdPtr(new XenoCmdIndex(graft, host, out, K, M, T, prefilterBits));
         }
 
         XenoCmdFactoryIndex()
@@ -128,6 +141,7 @@ namespace // anonymous
         {
             mCommonOptions.insert("prefix");
             mCommonOptions.insert("max-memory");
+            mCommonOptions.insert("prefilter-bits");
             mSpecificOptions.addOpt<uint64_t>("kmer-size", "K", "kmer size to use (default 25)");
             mSpecificOptions.addOpt<string>("graft", "G", "graft reference in FASTA format");
             mSpecificOptions.addOpt<string>("host", "H", "host reference in FASTA format");
@@ -280,7 +294,12 @@ XenoApp::XenoApp()
     globalOpts.addOpt<bool>("help", "h", "show a help message");
     globalOpts.addOpt<string>("log-file", "l", "place to write messages");
     globalOpts.addOpt<strings>("tmp-dir", "", "a directory to use for temporary files (default /tmp)");
-    globalOpts.addOpt<uint64_t>("num-threads", "T", "maximum number of worker threads to use, where possible");
+    globalOpts.addOpt<uint64_t>("num-threads", "T", "maximum number of worker threads to use, where possible, or 'auto' for one per processor");
+    globalOpts.addOpt<string>("map-access", "", "expected access pattern for mapped files: normal, sequential or random");
+    globalOpts.addOpt<bool>("map-interleave", "", "interleave mapped files across memory nodes");
+    globalOpts.addOpt<bool>("map-warm-up", "", "map files lazily, pre-faulting rank/select indexes in the background");
+    globalOpts.addOpt<bool>("no-huge-pages", "", "don't ask for huge pages for mapped files");
+    globalOpts.addOpt<bool>("pin-threads", "", "pin worker threads to processors, spreading them across memory nodes");
     globalOpts.addOpt<bool>("verbose", "v", "show progress messages");
     globalOpts.addOpt<bool>("version", "V", "show the software version");
 
@@ -289,4 +308,6 @@ XenoApp::XenoApp()
     commonOpts.addOpt<strings>("line-in", "", "input file with one sequence per line");
     commonOpts.addOpt<string>("prefix", "P", "filename prefix for index");
     commonOpts.addOpt<double>("max-memory", "M", "maximum memory (in GB) to use");
+    commonOpts.addOpt<uint64_t>("prefilter-bits", "",
+            "also build a Bloom filter using this many bits per k-mer, to speed up lookups of absent k-mers");
 }
@@ -0,0 +1,97 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "BitKernels.hh"
+#include "Logger.hh"
+#include "Timer.hh"
+#include "Utils.hh"
+#include "testHelpers.hh"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Gossamer;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE BenchBitKernels
+#include "testBegin.hh"
+
+// Report the speed of each kernel at each level this machine supports.
+BOOST_AUTO_TEST_CASE(benchmarkKernels)
+{
+    vector<uint64_t> ws(randomWords(1ULL << 16, 37));
+    vector<uint32_t> xs(sortedItems<uint32_t>(1ULL << 16, 41));
+    vector<uint64_t> ys(sortedItems<uint64_t>(1ULL << 16, 43));
+    std::mt19937_64 rng(47);
+    vector<uint64_t> ranks;
+    for (uint64_t i = 0; i < 1000000; ++i)
+    {
+        ranks.push_back(rng());
+    }
+
+    for (uint64_t l = 0; l < BitKernels::NumLevels; ++l)
+    {
+        const BitKernels::Level level = BitKernels::Level(l);
+        if (!BitKernels::supported(level))
+        {
+            continue;
+        }
+        BitKernels::use(level);
+        uint64_t sink = 0;
+
+        // Popcounts over 512KB.
+        const uint64_t popReps = 200;
+        Timer t0;
+        for (uint64_t i = 0; i < popReps; ++i)
+        {
+            sink += BitKernels::popcount(ws.data() + (i & 1), ws.size() - 1);
+        }
+        const double popSecs = t0.check();
+
+        // In-word selects.
+        Timer t1;
+        for (uint64_t i = 0; i < ranks.size(); ++i)
+        {
+            const uint64_t w = ranks[i] | 1;
+            sink += BitKernels::select(w, (ranks[i] >> 58) % popcnt(w));
+        }
+        const double selSecs = t1.check();
+
+        // Word scans over 64 words.
+        Timer t2;
+        for (uint64_t i = 0; i < ranks.size(); ++i)
+        {
+            uint64_t r = ranks[i] % 1024;
+            sink += BitKernels::selectWord(ws.data() + (ranks[i] >> 48) % (ws.size() - 64), 64, false, r);
+        }
+        const double scanSecs = t2.check();
+
+        // The final linear step of a sparse array search: 32 items.
+        Timer t3;
+        for (uint64_t i = 0; i < ranks.size(); ++i)
+        {
+            const uint64_t b = (ranks[i] >> 48) % (xs.size() - 32);
+            sink += BitKernels::countLess(xs.data() + b, 32, xs[b + 17]);
+            sink += BitKernels::countLess(ys.data() + b, 32, ys[b + 17]);
+        }
+        const double searchSecs = t3.check();
+
+        BOOST_CHECK(sink > 0);
+        const double mb = popReps * ws.size() * sizeof(uint64_t) / 1048576.0;
+        BOOST_TEST_MESSAGE(string(BitKernels::name(level)) + ":"
+                           + " popcount " + to_string(uint64_t(mb / popSecs)) + " MB/s,"
+                           + " select " + to_string(uint64_t(ranks.size() / selSecs)) + "/s,"
+                           + " select word " + to_string(uint64_t(ranks.size() / scanSecs)) + "/s,"
+                           + " search " + to_string(uint64_t(2 * ranks.size() / searchSecs)) + "/s");
+    }
+    BitKernels::setup();
+}
+
+#include "testEnd.hh"
@@ -0,0 +1,71 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "BlockWriter.hh"
+#include "Logger.hh"
+#include "PhysicalFileFactory.hh"
+#include "Timer.hh"
+#include "testHelpers.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+
+using namespace std;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE BenchBlockWriter
+#include "testBegin.hh"
+
+// Write reads to a gzipped file, compressing inline as the stream is
+// written, and in blocks on background threads.
+BOOST_AUTO_TEST_CASE(benchmarkGzipOutput)
+{
+    std::mt19937 rng(23);
+    const string text(randomReads(randomGenome(1ULL << 20, rng), 200000, 100, rng));
+    PhysicalFileFactory fac;
+    const string nm(fac.tmpName() + ".gz");
+
+    Timer t0;
+    {
+        std::ofstream f(nm.c_str(), ios::binary);
+        boost::iostreams::filtering_stream<boost::iostreams::output> s;
+        s.push(boost::iostreams::gzip_compressor());
+        s.push(f);
+        for (uint64_t i = 0; i < text.size(); i += 4096)
+        {
+            s << text.substr(i, 4096);
+        }
+    }
+    const double inlineSecs = t0.check();
+
+    const uint64_t threads = std::max<uint64_t>(1, std::thread::hardware_concurrency());
+    fac.outputThreads(threads);
+    Timer t1;
+    {
+        FileFactory::OutHolderPtr op(fac.out(nm));
+        for (uint64_t i = 0; i < text.size(); i += 4096)
+        {
+            **op << text.substr(i, 4096);
+        }
+    }
+    const double blockSecs = t1.check();
+    BOOST_CHECK(contents(fac, nm) == text);
+    fac.remove(nm);
+
+    const double mb = text.size() / 1048576.0;
+    BOOST_TEST_MESSAGE("inline gzip: " + to_string(mb / inlineSecs) + " MB/s");
+    BOOST_TEST_MESSAGE("block gzip, " + to_string(threads) + " threads: "
+                        + to_string(mb / blockSecs) + " MB/s");
+}
+
+#include "testEnd.hh"
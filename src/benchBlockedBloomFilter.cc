@@ -0,0 +1,111 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "BlockedBloomFilter.hh"
+#include "GossReadBaseString.hh"
+#include "KmerSet.hh"
+#include "StringFileFactory.hh"
+#include "Timer.hh"
+#include "testHelpers.hh"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Gossamer;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE BenchBlockedBloomFilter
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    void buildKmerSet(const string& pSeq, uint64_t pRho, FileFactory& pFac)
+    {
+        vector<position_type> xs;
+        string label;
+        string qual;
+        GossReadBaseString r(label, pSeq, qual);
+        for (GossRead::Iterator i(r, pRho); i.valid(); ++i)
+        {
+            xs.push_back(i.kmer());
+        }
+        sort(xs.begin(), xs.end());
+        xs.erase(unique(xs.begin(), xs.end()), xs.end());
+
+        KmerSet::Builder b(pRho, "x", pFac, xs.size());
+        for (uint64_t i = 0; i < xs.size(); ++i)
+        {
+            b.push_back(xs[i]);
+        }
+        b.end();
+    }
+}
+
+// Screen reads against a k-mer set, as filter-reads does, where most
+// reads do not come from the set's reference.
+BOOST_AUTO_TEST_CASE(benchmarkScreenReads)
+{
+    const uint64_t rho = 26;
+    const uint64_t numReads = 100000;
+    const uint64_t readLen = 100;
+
+    std::mt19937 rng(17);
+    const string ref(randomGenome(1ULL << 21, rng));
+    const string other(randomGenome(1ULL << 21, rng));
+    vector<string> reads;
+    for (uint64_t i = 0; i < numReads; ++i)
+    {
+        const string& src(i % 10 ? other : ref);
+        reads.push_back(src.substr(rng() % (src.size() - readLen), readLen));
+    }
+
+    const char* names[] = { "plain", "prefiltered" };
+    vector<uint64_t> hits;
+    for (uint64_t f = 0; f < 2; ++f)
+    {
+        StringFileFactory fac;
+        buildKmerSet(ref, rho, fac);
+        if (f)
+        {
+            KmerSet::buildPrefilter("x", fac, 10);
+        }
+        KmerSet s("x", fac);
+
+        Timer t;
+        uint64_t n = 0;
+        const string label;
+        const string qual;
+        for (uint64_t i = 0; i < reads.size(); ++i)
+        {
+            GossReadBaseString r(label, reads[i], qual);
+            for (GossRead::Iterator j(r, rho); j.valid(); ++j)
+            {
+                position_type x(j.kmer());
+                position_type y(x);
+                y.reverseComplement(rho);
+                if (s.access(KmerSet::Edge(x)) || s.access(KmerSet::Edge(y)))
+                {
+                    ++n;
+                    break;
+                }
+            }
+        }
+        double secs = t.check();
+        hits.push_back(n);
+
+        BOOST_TEST_MESSAGE(string(names[f]) + ": " + to_string(uint64_t(reads.size() / secs))
+                            + " reads/sec");
+    }
+    BOOST_CHECK_EQUAL(hits[0], hits[1]);
+    BOOST_CHECK(hits[0] >= numReads / 10);
+}
+
+#include "testEnd.hh"
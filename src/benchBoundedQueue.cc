@@ -0,0 +1,146 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "BoundedQueue.hh"
+#include "Logger.hh"
+#include "ThreadGroup.hh"
+#include "ThreadPlacement.hh"
+#include "Timer.hh"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define GOSS_TEST_MODULE BenchBoundedQueue
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    typedef BoundedQueue<uint64_t> Queue;
+
+    class Producer
+    {
+    public:
+        void operator()()
+        {
+            for (uint64_t i = 0; i < mItems; ++i)
+            {
+                mQueue.put(i);
+            }
+        }
+
+        Producer(Queue& pQueue, uint64_t pItems)
+            : mQueue(pQueue), mItems(pItems)
+        {
+        }
+
+    private:
+        Queue& mQueue;
+        const uint64_t mItems;
+    };
+
+    // Take items one at a time, or if pShare is non-zero, a pShare'th
+    // of those waiting at a time, as BackgroundMultiConsumer does.
+    class Consumer
+    {
+    public:
+        void operator()()
+        {
+            if (mShare)
+            {
+                vector<uint64_t> xs;
+                while (mQueue.get(xs, mShare))
+                {
+                    for (uint64_t i = 0; i < xs.size(); ++i)
+                    {
+                        mSum += xs[i];
+                    }
+                }
+                return;
+            }
+            uint64_t x = 0;
+            while (mQueue.get(x))
+            {
+                mSum += x;
+            }
+        }
+
+        Consumer(Queue& pQueue, uint64_t pShare)
+            : mQueue(pQueue), mShare(pShare), mSum(0)
+        {
+        }
+
+    private:
+        Queue& mQueue;
+        const uint64_t mShare;
+        uint64_t mSum;
+    };
+
+    // Items per second from pThreads producers to pThreads consumers.
+    double run(bool pRing, bool pBatched, uint64_t pThreads, uint64_t pItems)
+    {
+        Queue q(1024, pRing);
+        vector<std::shared_ptr<Producer> > ps;
+        vector<std::shared_ptr<Consumer> > cs;
+        for (uint64_t i = 0; i < pThreads; ++i)
+        {
+            ps.push_back(std::make_shared<Producer>(q, pItems / pThreads));
+            cs.push_back(std::make_shared<Consumer>(q, pBatched ? pThreads : 0));
+        }
+        Timer t;
+        ThreadGroup consumers;
+        for (uint64_t i = 0; i < pThreads; ++i)
+        {
+            consumers.create(std::ref(*cs[i]));
+        }
+        {
+            ThreadGroup producers;
+            for (uint64_t i = 0; i < pThreads; ++i)
+            {
+                producers.create(std::ref(*ps[i]));
+            }
+            producers.join();
+        }
+        q.finish();
+        consumers.join();
+        return pThreads * (pItems / pThreads) / t.check();
+    }
+
+    string rate(double pItemsPerSec)
+    {
+        return to_string(uint64_t(pItemsPerSec)) + "/s";
+    }
+}
+
+// Items per second through a locked queue and a ring, for 1 x 1 up to
+// at least 8 x 8 producer and consumer threads, taking items one at a
+// time and a share at a time. Where there are more threads than
+// processors, the threads take turns, and the numbers say more about
+// the scheduler than about the queues.
+BOOST_AUTO_TEST_CASE(benchmarkQueues)
+{
+    const uint64_t procs = ThreadPlacement::process().processors();
+    const uint64_t n = 2000000;
+    BOOST_TEST_MESSAGE(to_string(procs) + " processors");
+    BOOST_TEST_MESSAGE("threads\tlocked\tlocked, batched\tring\tring, batched");
+    for (uint64_t t = 1; t <= std::max<uint64_t>(8, procs / 2); t *= 2)
+    {
+        const double locked = run(false, false, t, n);
+        const double lockedBatched = run(false, true, t, n);
+        const double ring = run(true, false, t, n);
+        const double ringBatched = run(true, true, t, n);
+        BOOST_TEST_MESSAGE(to_string(t) + " x " + to_string(t)
+                           + "\t" + rate(locked) + "\t" + rate(lockedBatched)
+                           + "\t" + rate(ring) + "\t" + rate(ringBatched));
+    }
+}
+
+#include "testEnd.hh"
@@ -0,0 +1,55 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "GossCmdDumpGraph.hh"
+#include "GossCmdRestoreGraph.hh"
+#include "Graph.hh"
+#include "Logger.hh"
+#include "StringFileFactory.hh"
+#include "Timer.hh"
+#include "testHelpers.hh"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE BenchGraphArchive
+#include "testBegin.hh"
+
+// Dump and restore a graph as text and as an archive.
+BOOST_AUTO_TEST_CASE(benchmarkDumpRestore)
+{
+    StringFileFactory fac;
+    buildGraph("g", 27, randomEdges(27, 1000000, 29), fac);
+    Logger log("log.txt", fac);
+    boost::program_options::variables_map opts;
+    GossCmdContext cxt(fac, log, "dump-graph", opts);
+
+    Timer t0;
+    GossCmdDumpGraph("g", "g.txt")(cxt);
+    GossCmdRestoreGraph("g.txt", "t", 1)(cxt);
+    const double textSecs = t0.check();
+
+    const uint64_t threads = std::max<uint64_t>(1, std::thread::hardware_concurrency());
+    Timer t1;
+    GossCmdDumpGraph("g", "g.bin", true, threads)(cxt);
+    GossCmdRestoreGraph("g.bin", "b", threads)(cxt);
+    const double binSecs = t1.check();
+    BOOST_CHECK(graphEdges("g", fac) == graphEdges("b", fac));
+
+    const uint64_t textSize = contents(fac, "g.txt").size();
+    const uint64_t binSize = contents(fac, "g.bin").size();
+    BOOST_TEST_MESSAGE("text: " + to_string(textSecs) + "s, " + to_string(textSize) + " bytes");
+    BOOST_TEST_MESSAGE("archive, " + to_string(threads) + " threads: "
+                        + to_string(binSecs) + "s, " + to_string(binSize) + " bytes");
+}
+
+#include "testEnd.hh"
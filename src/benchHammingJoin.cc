@@ -0,0 +1,130 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "HammingJoin.hh"
+#include "Logger.hh"
+#include "Timer.hh"
+#include "testHelpers.hh"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace boost;
+using namespace std;
+using Gossamer::position_type;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE BenchHammingJoin
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    // Random k-mers on the left, and on the right some random ones and
+    // some a substitution or two away from ones on the left, half of
+    // them reverse complemented.
+    void makeSets(uint64_t pK, uint64_t pN, uint64_t pSeed,
+                  HammingJoin::Kmers& pLhs, HammingJoin::Kmers& pRhs)
+    {
+        std::mt19937_64 rng(pSeed);
+        for (uint64_t i = 0; i < pN; ++i)
+        {
+            pLhs.push_back(randomKmer(pK, rng));
+        }
+        for (uint64_t i = 0; i < pN; ++i)
+        {
+            if (rng() % 2)
+            {
+                pRhs.push_back(randomKmer(pK, rng));
+                continue;
+            }
+            pRhs.push_back(substitute(pLhs[rng() % pN], pK, rng() % 3, rng));
+            if (rng() % 2)
+            {
+                pRhs.back().reverseComplement(pK);
+            }
+        }
+    }
+
+    // Look up each single substitution of each k-mer, forwards and
+    // reverse complemented, in the other set.
+    void probe(uint64_t pK, const HammingJoin::Kmers& pFrom, const HammingJoin::Kmers& pTo,
+               dynamic_bitset<>& pNear)
+    {
+        HammingJoin::Kmers sorted(pTo);
+        for (uint64_t j = 0; j < pTo.size(); ++j)
+        {
+            sorted.push_back(pTo[j]);
+            sorted.back().reverseComplement(pK);
+        }
+        sort(sorted.begin(), sorted.end());
+
+        pNear.resize(pFrom.size());
+        for (uint64_t i = 0; i < pFrom.size(); ++i)
+        {
+            for (uint64_t p = 0; !pNear[i] && p < pK; ++p)
+            {
+                for (uint64_t b = 1; b < 4; ++b)
+                {
+                    const position_type y = pFrom[i] ^ (position_type(b) << 2 * p);
+                    if (binary_search(sorted.begin(), sorted.end(), y))
+                    {
+                        pNear[i] = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Find the near k-mers of two sets of 200000 by probing for each
+// substitution, by joining, and by joining with next to no memory.
+BOOST_AUTO_TEST_CASE(benchmarkJoin)
+{
+    const uint64_t K = 27;
+    HammingJoin::Kmers lhs;
+    HammingJoin::Kmers rhs;
+    makeSets(K, 200000, 19, lhs, rhs);
+
+    Timer t0;
+    dynamic_bitset<> lhsProbed;
+    dynamic_bitset<> rhsProbed;
+    probe(K, lhs, rhs, lhsProbed);
+    probe(K, rhs, lhs, rhsProbed);
+    const double probeSecs = t0.check();
+
+    Timer t1;
+    MemoryBudget mem;
+    dynamic_bitset<> lhsNear;
+    dynamic_bitset<> rhsNear;
+    HammingJoin::join(K, 1, true, lhs, rhs, lhsNear, rhsNear, mem, 1);
+    const double joinSecs = t1.check();
+
+    Timer t2;
+    MemoryBudget tight(1);
+    dynamic_bitset<> lhsParted;
+    dynamic_bitset<> rhsParted;
+    const uint64_t parts = HammingJoin::join(K, 1, true, lhs, rhs, lhsParted, rhsParted, tight, 1);
+    const double partSecs = t2.check();
+
+    BOOST_CHECK(lhsProbed.is_subset_of(lhsNear));
+    BOOST_CHECK(rhsProbed.is_subset_of(rhsNear));
+    BOOST_CHECK(lhsParted == lhsNear);
+    BOOST_CHECK(rhsParted == rhsNear);
+
+    BOOST_TEST_MESSAGE(lexical_cast<string>(lhsNear.count()) + " + " + lexical_cast<string>(rhsNear.count())
+                       + " near k-mers");
+    BOOST_TEST_MESSAGE("probing: " + lexical_cast<string>(probeSecs) + "s");
+    BOOST_TEST_MESSAGE("joining: " + lexical_cast<string>(joinSecs) + "s");
+    BOOST_TEST_MESSAGE("joining in " + lexical_cast<string>(parts) + " partitions: "
+                       + lexical_cast<string>(partSecs) + "s");
+}
+
+#include "testEnd.hh"
@@ -0,0 +1,75 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "KmerSketch.hh"
+#include "Logger.hh"
+#include "StringFileFactory.hh"
+#include "Timer.hh"
+#include "testHelpers.hh"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Gossamer;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE BenchKmerSketch
+#include "testBegin.hh"
+
+// Compare all pairs of samples, exactly and by their sketches.
+BOOST_AUTO_TEST_CASE(benchmarkAllPairs)
+{
+    const uint64_t numSamples = 40;
+    StringFileFactory fac;
+    vector<vector<position_type> > samples;
+    for (uint64_t i = 0; i < numSamples; ++i)
+    {
+        samples.push_back(randomKmers(20000, 12, 37 + i));
+        KmerSketch::Builder b("s" + to_string(i), fac, 25, 1024);
+        for (uint64_t j = 0; j < samples.back().size(); ++j)
+        {
+            b.push_back(samples.back()[j]);
+        }
+        b.end();
+    }
+
+    double exact = 0;
+    Timer t0;
+    for (uint64_t i = 0; i < numSamples; ++i)
+    {
+        for (uint64_t j = i + 1; j < numSamples; ++j)
+        {
+            exact += jaccard(samples[i], samples[j]);
+        }
+    }
+    const double exactSecs = t0.check();
+
+    vector<KmerSketch> sketches;
+    for (uint64_t i = 0; i < numSamples; ++i)
+    {
+        sketches.push_back(KmerSketch("s" + to_string(i), fac));
+    }
+    double est = 0;
+    Timer t1;
+    for (uint64_t i = 0; i < numSamples; ++i)
+    {
+        for (uint64_t j = i + 1; j < numSamples; ++j)
+        {
+            est += sketches[i].jaccard(sketches[j]);
+        }
+    }
+    const double sketchSecs = t1.check();
+
+    const uint64_t pairs = numSamples * (numSamples - 1) / 2;
+    BOOST_CHECK_SMALL(est / pairs - exact / pairs, 0.02);
+    BOOST_TEST_MESSAGE("exact: " + to_string(uint64_t(pairs / exactSecs)) + " pairs/sec");
+    BOOST_TEST_MESSAGE("sketch: " + to_string(uint64_t(pairs / sketchSecs)) + " pairs/sec");
+}
+
+#include "testEnd.hh"
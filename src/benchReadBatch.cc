@@ -0,0 +1,73 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "ReadBatch.hh"
+#include "GossReadBaseString.hh"
+#include "Logger.hh"
+#include "Timer.hh"
+#include "testHelpers.hh"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Gossamer;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE BenchReadBatch
+#include "testBegin.hh"
+
+// Pull k-mers out of reads through GossRead::Iterator, and from a batch.
+BOOST_AUTO_TEST_CASE(benchmarkKmers)
+{
+    const uint64_t k = 25;
+    const uint64_t numReads = 20000;
+    std::mt19937 rng(19);
+    vector<string> reads;
+    for (uint64_t i = 0; i < numReads; ++i)
+    {
+        reads.push_back(randomReadBases(100, rng));
+    }
+
+    const string label;
+    const string qual;
+    uint64_t x = 0;
+    Timer t0;
+    for (uint64_t i = 0; i < reads.size(); ++i)
+    {
+        GossReadBaseString r(label, reads[i], qual);
+        for (GossRead::Iterator j(r, k); j.valid(); ++j)
+        {
+            x += j.kmer().asUInt64();
+        }
+    }
+    const double iterSecs = t0.check();
+
+    ReadBatch b(numReads);
+    for (uint64_t i = 0; i < reads.size(); ++i)
+    {
+        b.push_back(GossReadBaseString(label, reads[i], qual));
+    }
+    uint64_t y = 0;
+    Timer t1;
+    for (uint64_t i = 0; i < b.size(); ++i)
+    {
+        b.kmers(i, k, [&y] (uint64_t, const edge_type& pKmer) {
+            y += pKmer.asUInt64();
+            return true;
+        });
+    }
+    const double batchSecs = t1.check();
+
+    BOOST_CHECK_EQUAL(x, y);
+    BOOST_TEST_MESSAGE("GossRead::Iterator: " + to_string(uint64_t(numReads / iterSecs)) + " reads/sec");
+    BOOST_TEST_MESSAGE("ReadBatch::kmers: " + to_string(uint64_t(numReads / batchSecs)) + " reads/sec");
+}
+
+#include "testEnd.hh"
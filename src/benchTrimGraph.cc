@@ -0,0 +1,60 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "GossCmdTrimGraph.hh"
+
+#include "Graph.hh"
+#include "Logger.hh"
+#include "StringFileFactory.hh"
+#include "Timer.hh"
+#include "testHelpers.hh"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace boost;
+using namespace std;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE BenchTrimGraph
+#include "testBegin.hh"
+
+// Trim a graph of 4M edges with a single pass, and in ranges with
+// more threads than one.
+BOOST_AUTO_TEST_CASE(benchmarkTrim)
+{
+    const uint64_t K = 25;
+    StringFileFactory fac;
+    Logger log("log.txt", fac);
+    boost::program_options::variables_map opts;
+    GossCmdContext cxt(fac, log, "trim-graph", opts);
+    const Edges es = randomEdges(K, 4000000, 19);
+    buildGraph("g", K, es, fac, VariableByteArray::FusedFormat);
+
+    BOOST_TEST_MESSAGE(lexical_cast<string>(std::thread::hardware_concurrency()) + " cpus");
+    Edges single;
+    for (uint64_t t = 1; t <= 8; t *= 2)
+    {
+        Timer tm;
+        GossCmdTrimGraph("g", "t", 1, false, false, boost::optional<uint64_t>(), t, 0)(cxt);
+        const double secs = tm.check();
+        if (t == 1)
+        {
+            single = graphEdges("t", fac);
+        }
+        else
+        {
+            BOOST_CHECK(graphEdges("t", fac) == single);
+        }
+        BOOST_TEST_MESSAGE((t == 1 ? string("single pass") : lexical_cast<string>(t) + " threads, ranges")
+                           + ": " + lexical_cast<string>(secs) + "s");
+    }
+}
+
+#include "testEnd.hh"
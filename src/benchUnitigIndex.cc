@@ -0,0 +1,97 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "UnitigIndex.hh"
+
+#include "GossCmdBuildEntryEdgeSet.hh"
+#include "GossCmdBuildGraph.hh"
+#include "GossCmdBuildUnitigs.hh"
+#include "GossCmdPrintContigs.hh"
+#include "Logger.hh"
+#include "StringFileFactory.hh"
+#include "Timer.hh"
+#include "testHelpers.hh"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace boost;
+using namespace std;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE BenchUnitigIndex
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    // Reads from a genome with some repeats, to make branches.
+    string reads(uint64_t pN, uint64_t pSeed)
+    {
+        std::mt19937 rng(pSeed);
+        string genome = randomGenome(pN, rng);
+        const string rep = genome.substr(0, 200);
+        for (uint64_t i = 1; i < 4; ++i)
+        {
+            genome.replace(i * pN / 4, rep.size(), rep);
+        }
+        return randomReads(genome, pN / 5, 50, rng);
+    }
+
+    struct Fixture
+    {
+        Fixture(uint64_t pN, uint64_t pSeed)
+            : log("log.txt", fac), cxt(fac, log, "build-unitigs", opts)
+        {
+            fac.addFile("r.fa", reads(pN, pSeed));
+            vector<string> fastas(1, "r.fa");
+            vector<string> none;
+            GossCmdBuildGraph(21, 16, (1ULL << 20), 2, "g", fastas, none, none)(cxt);
+        }
+
+        void walk()
+        {
+            GossCmdPrintContigs("g", 0, 0, false, false, true, true, false, false, 1, "c.fa")(cxt);
+            GossCmdBuildEntryEdgeSet("g", 1)(cxt);
+        }
+
+        StringFileFactory fac;
+        Logger log;
+        boost::program_options::variables_map opts;
+        GossCmdContext cxt;
+    };
+}
+
+// Print contigs and build entry edges by walking the graph, and from
+// a unitig index.
+BOOST_AUTO_TEST_CASE(benchmarkUnitigs)
+{
+    Fixture f(400000, 23);
+
+    Timer t0;
+    f.walk();
+    const double walkSecs = t0.check();
+
+    Timer t1;
+    GossCmdBuildUnitigs("g", 1)(f.cxt);
+    const double buildSecs = t1.check();
+
+    Timer t2;
+    f.walk();
+    const double indexSecs = t2.check();
+
+    UnitigIndex u("g-unitigs", f.fac);
+    BOOST_CHECK(u.count() > u.cycles());
+    BOOST_TEST_MESSAGE(lexical_cast<string>(u.edges()) + " edges, "
+                       + lexical_cast<string>(u.count()) + " unitigs");
+    BOOST_TEST_MESSAGE("walking: " + lexical_cast<string>(walkSecs) + "s");
+    BOOST_TEST_MESSAGE("building the index: " + lexical_cast<string>(buildSecs) + "s");
+    BOOST_TEST_MESSAGE("with the index: " + lexical_cast<string>(indexSecs) + "s");
+}
+
+#include "testEnd.hh"
@@ -0,0 +1,67 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+
+#include "VariableByteArray.hh"
+#include "StringFileFactory.hh"
+#include "Timer.hh"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define GOSS_TEST_MODULE BenchVariableByteArray
+#include "testBegin.hh"
+
+// Compare random lookups on the two layouts, using a count
+// distribution with a long tail, as seen in graph multiplicities.
+BOOST_AUTO_TEST_CASE(benchmarkLookup)
+{
+    const uint64_t N = 1ull << 20;
+    const uint64_t L = 1ull << 22;
+    const VariableByteArray::Format formats[] = {
+        VariableByteArray::LayeredFormat, VariableByteArray::FusedFormat };
+    const char* names[] = { "layered", "fused" };
+
+    vector<uint64_t> sums;
+    for (uint64_t f = 0; f < 2; ++f)
+    {
+        StringFileFactory fac;
+        {
+            VariableByteArray::Builder b("x", fac, N, 1.0 / 1024.0, formats[f]);
+            std::mt19937 rng(17);
+            std::geometric_distribution<> dist(0.02);
+            for (uint64_t i = 0; i < N; ++i)
+            {
+                b.push_back(1 + dist(rng) * (i % 64 ? 1 : 1000));
+            }
+            b.end();
+        }
+
+        VariableByteArray a("x", fac, formats[f]);
+        std::mt19937 rng(19);
+        std::uniform_int_distribution<uint64_t> pos(0, N - 1);
+        uint64_t sum = 0;
+        Timer t;
+        for (uint64_t i = 0; i < L; ++i)
+        {
+            sum += a[pos(rng)];
+        }
+        double secs = t.check();
+        sums.push_back(sum);
+
+        BOOST_TEST_MESSAGE(string(names[f]) + ": "
+                            + to_string(1e9 * secs / L) + " ns/lookup, "
+                            + to_string(8.0 * a.stat().as<uint64_t>("storage") / N) + " bits/item");
+    }
+    BOOST_CHECK_EQUAL(sums[0], sums[1]);
+}
+
+#include "testEnd.hh"
@@ -0,0 +1,190 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "BitKernels.hh"
+#include "Utils.hh"
+#include "testHelpers.hh"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Gossamer;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE TestBitKernels
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    vector<BitKernels::Level> supportedLevels()
+    {
+        vector<BitKernels::Level> ls;
+        for (uint64_t l = 0; l < BitKernels::NumLevels; ++l)
+        {
+            if (BitKernels::supported(BitKernels::Level(l)))
+            {
+                ls.push_back(BitKernels::Level(l));
+            }
+        }
+        return ls;
+    }
+
+    template <typename T>
+    void checkCountLess(uint64_t pSeed)
+    {
+        vector<T> xs(sortedItems<T>(100, pSeed));
+        for (uint64_t b = 0; b < 8; ++b)
+        {
+            for (uint64_t n = 0; b + n <= xs.size(); ++n)
+            {
+                for (uint64_t i = 0; i < xs.size(); ++i)
+                {
+                    const T v = xs[i] + T(i % 2);
+                    const uint64_t expected = lower_bound(xs.begin() + b, xs.begin() + b + n, v) - (xs.begin() + b);
+                    BOOST_REQUIRE_EQUAL(BitKernels::countLess(xs.data() + b, n, v), expected);
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testLevels)
+{
+    BOOST_CHECK(BitKernels::supported(BitKernels::Portable));
+    BOOST_CHECK(BitKernels::supported(BitKernels::best()));
+    BOOST_CHECK_EQUAL(BitKernels::level(), BitKernels::best());
+    BOOST_TEST_MESSAGE(string("best bit kernels: ") + BitKernels::name(BitKernels::best()));
+}
+
+BOOST_AUTO_TEST_CASE(testPopcount)
+{
+    vector<uint64_t> ws(randomWords(200, 17));
+    const vector<BitKernels::Level> ls(supportedLevels());
+    for (uint64_t b = 0; b < 9; ++b)
+    {
+        for (uint64_t n = 0; b + n <= ws.size(); ++n)
+        {
+            uint64_t expected = 0;
+            for (uint64_t i = b; i < b + n; ++i)
+            {
+                expected += popcnt(ws[i]);
+            }
+            for (uint64_t l = 0; l < ls.size(); ++l)
+            {
+                BitKernels::use(ls[l]);
+                BOOST_REQUIRE_EQUAL(BitKernels::popcount(ws.data() + b, n), expected);
+            }
+        }
+    }
+    BitKernels::setup();
+}
+
+BOOST_AUTO_TEST_CASE(testSelect)
+{
+    vector<uint64_t> ws(randomWords(2000, 19));
+    const vector<BitKernels::Level> ls(supportedLevels());
+    for (uint64_t l = 0; l < ls.size(); ++l)
+    {
+        BitKernels::use(ls[l]);
+        for (uint64_t i = 0; i < ws.size(); ++i)
+        {
+            const uint64_t w = ws[i];
+            for (uint64_t r = 0; r < popcnt(w); ++r)
+            {
+                BOOST_REQUIRE_EQUAL(BitKernels::select(w, r), select_by_ffs(w, r));
+            }
+        }
+    }
+    BitKernels::setup();
+}
+
+BOOST_AUTO_TEST_CASE(testSelectWord)
+{
+    vector<uint64_t> ws(randomWords(100, 23));
+    const vector<BitKernels::Level> ls(supportedLevels());
+    for (uint64_t inv = 0; inv < 2; ++inv)
+    {
+        const uint64_t m = inv ? ~uint64_t(0) : uint64_t(0);
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < ws.size(); ++i)
+        {
+            total += popcnt(ws[i] ^ m);
+        }
+        for (uint64_t r = 0; r <= total; r += 7)
+        {
+            uint64_t expectedRank = r;
+            uint64_t expected = 0;
+            while (expected < ws.size() && expectedRank >= popcnt(ws[expected] ^ m))
+            {
+                expectedRank -= popcnt(ws[expected] ^ m);
+                ++expected;
+            }
+            for (uint64_t l = 0; l < ls.size(); ++l)
+            {
+                BitKernels::use(ls[l]);
+                uint64_t rank = r;
+                const uint64_t w = BitKernels::selectWord(ws.data(), ws.size(), inv, rank);
+                BOOST_REQUIRE_EQUAL(w, expected);
+                if (w < ws.size())
+                {
+                    BOOST_REQUIRE_EQUAL(rank, expectedRank);
+                }
+            }
+        }
+    }
+    BitKernels::setup();
+}
+
+BOOST_AUTO_TEST_CASE(testCountLess)
+{
+    const vector<BitKernels::Level> ls(supportedLevels());
+    for (uint64_t l = 0; l < ls.size(); ++l)
+    {
+        BitKernels::use(ls[l]);
+        checkCountLess<uint32_t>(29 + l);
+        checkCountLess<uint64_t>(31 + l);
+    }
+    BitKernels::setup();
+}
+
+BOOST_AUTO_TEST_CASE(testGreaterMask)
+{
+    std::mt19937_64 rng(53);
+    vector<uint8_t> xs;
+    for (uint64_t i = 0; i < 200; ++i)
+    {
+        // Mostly small values, as counts are, and either side of the sign bit.
+        xs.push_back(rng() % 2 ? rng() % 4 : rng());
+    }
+    const vector<BitKernels::Level> ls(supportedLevels());
+    for (uint64_t l = 0; l < ls.size(); ++l)
+    {
+        BitKernels::use(ls[l]);
+        for (uint64_t b = 0; b < 9; ++b)
+        {
+            for (uint64_t n = 0; n <= 64; ++n)
+            {
+                for (uint64_t v = 0; v < 256; v += 1 + v / 8)
+                {
+                    uint64_t expected = 0;
+                    for (uint64_t i = 0; i < n; ++i)
+                    {
+                        expected |= uint64_t(xs[b + i] > v) << i;
+                    }
+                    BOOST_REQUIRE_EQUAL(BitKernels::greaterMask(xs.data() + b, n, uint8_t(v)), expected);
+                }
+            }
+        }
+    }
+    BitKernels::setup();
+}
+
+#include "testEnd.hh"
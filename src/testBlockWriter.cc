@@ -0,0 +1,171 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "BlockWriter.hh"
+#include "GossamerException.hh"
+#include "OrderedWriter.hh"
+#include "PhysicalFileFactory.hh"
+#include "Utils.hh"
+#include "testHelpers.hh"
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE TestBlockWriter
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    string rawContents(const string& pName)
+    {
+        PhysicalFileFactory fac(Gossamer::defaultTmpDir(), false);
+        return contents(fac, pName);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testGzipRoundTrip)
+{
+    PhysicalFileFactory fac;
+    fac.outputThreads(3);
+    const string nm(fac.tmpName() + ".gz");
+    std::mt19937 rng(17);
+    const string text(randomReads(randomGenome(1ULL << 20, rng), 20000, 100, rng));
+    {
+        FileFactory::OutHolderPtr op(fac.out(nm));
+        ostream& o(**op);
+        // Write in odd sized pieces, flushing as we go.
+        for (uint64_t i = 0; i < text.size(); i += 997)
+        {
+            o << text.substr(i, 997) << flush;
+        }
+    }
+    BOOST_CHECK(contents(fac, nm) == text);
+
+    // The file is a series of BGZF blocks, ending with the EOF marker.
+    const string raw(rawContents(nm));
+    BOOST_REQUIRE(raw.size() > 28);
+    BOOST_CHECK_EQUAL(raw.substr(12, 2), "BC");
+    BOOST_CHECK(raw.substr(raw.size() - 28) == BlockWriter::gzipEof());
+    uint64_t blocks = 0;
+    for (uint64_t i = 0; i < raw.size(); ++blocks)
+    {
+        BOOST_REQUIRE_EQUAL(static_cast<uint8_t>(raw[i]), 0x1f);
+        BOOST_REQUIRE_EQUAL(raw.substr(i + 12, 2), "BC");
+        uint64_t bsize = static_cast<uint8_t>(raw[i + 16]) | (static_cast<uint8_t>(raw[i + 17]) << 8);
+        i += bsize + 1;
+    }
+    BOOST_CHECK_EQUAL(blocks, (text.size() + BlockWriter::gzipBlockSize - 1) / BlockWriter::gzipBlockSize + 1);
+
+    // Appending adds more members.
+    {
+        FileFactory::OutHolderPtr op(fac.out(nm, FileFactory::AppendMode));
+        **op << "tail" << endl;
+    }
+    BOOST_CHECK(contents(fac, nm) == text + "tail\n");
+    fac.remove(nm);
+}
+
+BOOST_AUTO_TEST_CASE(testBzip2RoundTrip)
+{
+    PhysicalFileFactory fac;
+    fac.outputThreads(2);
+    const string nm(fac.tmpName() + ".bz2");
+    std::mt19937 rng(19);
+    const string text(randomReads(randomGenome(1ULL << 20, rng), 20000, 100, rng));
+    {
+        FileFactory::OutHolderPtr op(fac.out(nm));
+        **op << text;
+    }
+    BOOST_CHECK(contents(fac, nm) == text);
+    fac.remove(nm);
+}
+
+BOOST_AUTO_TEST_CASE(testEmpty)
+{
+    PhysicalFileFactory fac;
+    const string nm(fac.tmpName() + ".gz");
+    {
+        FileFactory::OutHolderPtr op(fac.out(nm));
+    }
+    BOOST_CHECK(rawContents(nm) == BlockWriter::gzipEof());
+    BOOST_CHECK_EQUAL(contents(fac, nm), "");
+    fac.remove(nm);
+}
+
+BOOST_AUTO_TEST_CASE(testOpenBadly)
+{
+    PhysicalFileFactory fac;
+    BOOST_CHECK_THROW(fac.out("snark/snark/snark.gz"), Gossamer::error);
+}
+
+BOOST_AUTO_TEST_CASE(testOrderedWriter)
+{
+    const uint64_t numThreads = 4;
+    const uint64_t numChunks = 1000;
+    for (uint64_t ordered = 0; ordered < 2; ++ordered)
+    {
+        ostringstream out;
+        {
+            OrderedWriter w(out, ordered);
+            vector<std::thread> ts;
+            for (uint64_t t = 0; t < numThreads; ++t)
+            {
+                ts.push_back(std::thread([&w, t] () {
+                    // Each thread writes every numThreads'th chunk, backwards
+                    // within groups of 8, so chunks arrive out of order.
+                    for (uint64_t i = t; i < numChunks; i += numThreads)
+                    {
+                        uint64_t g = i / (8 * numThreads) * (8 * numThreads);
+                        uint64_t j = g + (8 * numThreads - 1 - (i - g));
+                        if (j >= numChunks)
+                        {
+                            j = i;
+                        }
+                        string s(to_string(j) + "\n");
+                        w.write(j, s);
+                        BOOST_CHECK(s.empty());
+                    }
+                }));
+            }
+            for (auto& t : ts)
+            {
+                t.join();
+            }
+        }
+
+        istringstream in(out.str());
+        vector<uint64_t> xs;
+        uint64_t x;
+        while (in >> x)
+        {
+            xs.push_back(x);
+        }
+        BOOST_REQUIRE_EQUAL(xs.size(), numChunks);
+        if (ordered)
+        {
+            for (uint64_t i = 0; i < numChunks; ++i)
+            {
+                BOOST_CHECK_EQUAL(xs[i], i);
+            }
+        }
+        else
+        {
+            sort(xs.begin(), xs.end());
+            BOOST_CHECK_EQUAL(xs.back(), numChunks - 1);
+        }
+    }
+}
+
+#include "testEnd.hh"
@@ -0,0 +1,138 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "BlockedBloomFilter.hh"
+#include "KmerSet.hh"
+#include "StringFileFactory.hh"
+#include "testHelpers.hh"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Gossamer;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE TestBlockedBloomFilter
+#include "testBegin.hh"
+
+BOOST_AUTO_TEST_CASE(testNoFalseNegatives)
+{
+    StringFileFactory fac;
+    vector<position_type> xs(randomKmers(100000, 25, 17));
+    {
+        BlockedBloomFilter::Builder b("x.bloom", fac, xs.size(), 10, 0);
+        for (uint64_t i = 0; i < xs.size(); ++i)
+        {
+            b.push_back(xs[i]);
+        }
+        b.end();
+    }
+
+    BlockedBloomFilter f("x.bloom", fac);
+    BOOST_CHECK_EQUAL(f.count(), xs.size());
+    for (uint64_t i = 0; i < xs.size(); ++i)
+    {
+        BOOST_CHECK(f.mayContain(xs[i]));
+    }
+
+    vector<position_type> ys(randomKmers(100000, 25, 19));
+    uint64_t fp = 0;
+    uint64_t n = 0;
+    for (uint64_t i = 0; i < ys.size(); ++i)
+    {
+        if (binary_search(xs.begin(), xs.end(), ys[i]))
+        {
+            continue;
+        }
+        ++n;
+        fp += f.mayContain(ys[i]);
+    }
+    BOOST_TEST_MESSAGE("false positive rate at 10 bits/item: " + to_string(double(fp) / n));
+    BOOST_CHECK(fp < n / 50);
+}
+
+BOOST_AUTO_TEST_CASE(testKmerSetPrefilter)
+{
+    StringFileFactory fac;
+    vector<position_type> xs(randomKmers(20000, 20, 23));
+    {
+        KmerSet::Builder b(20, "x", fac, xs.size());
+        for (uint64_t i = 0; i < xs.size(); ++i)
+        {
+            b.push_back(xs[i]);
+        }
+        b.end();
+    }
+    {
+        KmerSet s("x", fac);
+        BOOST_CHECK(!s.prefiltered());
+    }
+
+    KmerSet::buildPrefilter("x", fac, 8);
+    KmerSet s("x", fac);
+    BOOST_CHECK(s.prefiltered());
+    for (uint64_t i = 0; i < xs.size(); ++i)
+    {
+        rank_type r = 0;
+        BOOST_CHECK(s.accessAndRank(KmerSet::Edge(xs[i]), r));
+        BOOST_CHECK_EQUAL(r, i);
+    }
+
+    vector<position_type> ys(randomKmers(20000, 20, 29));
+    for (uint64_t i = 0; i < ys.size(); ++i)
+    {
+        bool present = binary_search(xs.begin(), xs.end(), ys[i]);
+        BOOST_CHECK_EQUAL(s.access(KmerSet::Edge(ys[i])), present);
+    }
+
+    KmerSet::remove("x", fac);
+    BOOST_CHECK(!BlockedBloomFilter::exists("x.bloom", fac));
+}
+
+BOOST_AUTO_TEST_CASE(testStalePrefilter)
+{
+    StringFileFactory fac;
+    vector<position_type> xs(randomKmers(20000, 20, 23));
+    auto build = [&] (const string& pName, uint64_t pN, uint64_t pBegin = 0) {
+        KmerSet::Builder b(20, pName, fac, pN);
+        for (uint64_t i = pBegin; i < pBegin + pN; ++i)
+        {
+            b.push_back(xs[i]);
+        }
+        b.end();
+    };
+    build("x", xs.size());
+    KmerSet::buildPrefilter("x", fac, 8);
+
+    // Rebuilding a set discards its old filter.
+    build("x", xs.size() - 1);
+    BOOST_CHECK(!BlockedBloomFilter::exists("x.bloom", fac));
+
+    // A filter built for a different set is rejected.
+    build("y", xs.size());
+    KmerSet::buildPrefilter("y", fac, 8);
+    fac.copy("y.bloom", "x.bloom");
+    fac.copy("y.bloom.header", "x.bloom.header");
+    BOOST_CHECK_THROW(KmerSet("x", fac), Gossamer::error);
+
+    // So is one built for a set of the same size.
+    build("z", xs.size() - 1, 1);
+    KmerSet::buildPrefilter("z", fac, 8);
+    fac.copy("z.bloom", "x.bloom");
+    fac.copy("z.bloom.header", "x.bloom.header");
+    BOOST_CHECK_THROW(KmerSet("x", fac), Gossamer::error);
+
+    KmerSet::buildPrefilter("x", fac, 8);
+    KmerSet s("x", fac);
+    BOOST_CHECK(s.prefiltered());
+}
+
+#include "testEnd.hh"
@@ -12,10 +12,16 @@
  */
 
 #include "BoundedQueue.hh"
+#include "BackgroundMultiConsumer.hh"
 #include "ThreadGroup.hh"
+#include "WorkQueue.hh"
 #include <vector>
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <memory>
 #include <random>
+#include <string>
 
 
 using namespace boost;
@@ -91,4 +97,253 @@ BOOST_AUTO_TEST_CASE(testEmpty)
     g.join();
 }
 
+namespace // anonymous
+{
+    // Put the items [pBegin, pEnd) on a queue.
+    template <typename Queue>
+    class Producer
+    {
+    public:
+        void operator()()
+        {
+            for (uint64_t i = mBegin; i < mEnd; ++i)
+            {
+                mQueue.put(i);
+            }
+        }
+
+        Producer(Queue& pQueue, uint64_t pBegin, uint64_t pEnd)
+            : mQueue(pQueue), mBegin(pBegin), mEnd(pEnd)
+        {
+        }
+
+    private:
+        Queue& mQueue;
+        const uint64_t mBegin;
+        const uint64_t mEnd;
+    };
+
+    // Take items off a queue, adding them up and noting the order
+    // they came in from each producer.
+    template <typename Queue>
+    class Consumer
+    {
+    public:
+        void operator()()
+        {
+            uint64_t x = 0;
+            while (mQueue.get(x))
+            {
+                mSum += x;
+                ++mCount;
+                uint64_t& last(mLast[x / mPerProducer]);
+                mInOrder = mInOrder && (last == 0 || last < x + 1);
+                last = x + 1;
+            }
+        }
+
+        Consumer(Queue& pQueue, uint64_t pProducers, uint64_t pPerProducer)
+            : mQueue(pQueue), mPerProducer(pPerProducer), mLast(pProducers, 0),
+              mSum(0), mCount(0), mInOrder(true)
+        {
+        }
+
+        Queue& mQueue;
+        const uint64_t mPerProducer;
+        vector<uint64_t> mLast;
+        uint64_t mSum;
+        uint64_t mCount;
+        bool mInOrder;
+    };
+
+    // As Consumer, but taking a share of the waiting items at a time,
+    // as BackgroundMultiConsumer does.
+    template <typename Queue>
+    class BatchConsumer : public Consumer<Queue>
+    {
+    public:
+        void operator()()
+        {
+            vector<uint64_t> xs;
+            while (this->mQueue.get(xs, mShare))
+            {
+                for (uint64_t i = 0; i < xs.size(); ++i)
+                {
+                    const uint64_t x = xs[i];
+                    this->mSum += x;
+                    ++this->mCount;
+                    uint64_t& last(this->mLast[x / this->mPerProducer]);
+                    this->mInOrder = this->mInOrder && (last == 0 || last < x + 1);
+                    last = x + 1;
+                }
+            }
+        }
+
+        BatchConsumer(Queue& pQueue, uint64_t pProducers, uint64_t pPerProducer)
+            : Consumer<Queue>(pQueue, pProducers, pPerProducer), mShare(pProducers)
+        {
+        }
+
+    private:
+        const uint64_t mShare;
+    };
+
+    // Pass pPerProducer items from each of pThreads producers to
+    // pThreads consumers (of type C).
+    template <typename Queue, typename C = Consumer<Queue> >
+    void run(Queue& pQueue, uint64_t pThreads, uint64_t pPerProducer)
+    {
+        typedef Producer<Queue> P;
+        vector<std::shared_ptr<P> > ps;
+        vector<std::shared_ptr<C> > cs;
+        for (uint64_t i = 0; i < pThreads; ++i)
+        {
+            ps.push_back(std::shared_ptr<P>(new P(pQueue, i * pPerProducer, (i + 1) * pPerProducer)));
+            cs.push_back(std::shared_ptr<C>(new C(pQueue, pThreads, pPerProducer)));
+        }
+        ThreadGroup consumers;
+        for (uint64_t i = 0; i < pThreads; ++i)
+        {
+            consumers.create(std::ref(*cs[i]));
+        }
+        {
+            ThreadGroup producers;
+            for (uint64_t i = 0; i < pThreads; ++i)
+            {
+                producers.create(*ps[i]);
+            }
+            producers.join();
+        }
+        pQueue.finish();
+        consumers.join();
+
+        // Each item arrives exactly once, and a consumer sees the items
+        // of any one producer in the order they were put.
+        const uint64_t n = pThreads * pPerProducer;
+        uint64_t sum = 0;
+        uint64_t count = 0;
+        for (uint64_t i = 0; i < pThreads; ++i)
+        {
+            sum += cs[i]->mSum;
+            count += cs[i]->mCount;
+            BOOST_CHECK(cs[i]->mInOrder);
+        }
+        BOOST_CHECK_EQUAL(count, n);
+        BOOST_CHECK_EQUAL(sum, n * (n - 1) / 2);
+    }
+
+    class Summer
+    {
+    public:
+        void operator()(const uint64_t& pItem)
+        {
+            mSum += pItem;
+        }
+
+        Summer(std::atomic<uint64_t>& pSum)
+            : mSum(pSum)
+        {
+        }
+
+    private:
+        std::atomic<uint64_t>& mSum;
+    };
+
+    void add(std::atomic<uint64_t>& pSum, uint64_t pX)
+    {
+        pSum += pX;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testManyProducers)
+{
+    for (uint64_t t = 1; t <= 4; t *= 2)
+    {
+        BoundedQueue<uint64_t> q(16, false);
+        run(q, t, 20000);
+        BoundedQueue<uint64_t> r(16, false);
+        run<BoundedQueue<uint64_t>, BatchConsumer<BoundedQueue<uint64_t> > >(r, t, 20000);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testManyProducersRing)
+{
+    for (uint64_t t = 1; t <= 4; t *= 2)
+    {
+        BoundedQueue<uint64_t> q(16, true);
+        BOOST_CHECK(q.ring());
+        run(q, t, 20000);
+        BoundedQueue<uint64_t> r(16, true);
+        run<BoundedQueue<uint64_t>, BatchConsumer<BoundedQueue<uint64_t> > >(r, t, 20000);
+    }
+}
+
+namespace // anonymous
+{
+    void multiConsumerSync(bool pRing)
+    {
+        std::atomic<uint64_t> sum(0);
+        Summer s(sum);
+        BackgroundMultiConsumer<uint64_t> grp(64, pRing);
+        for (uint64_t i = 0; i < 3; ++i)
+        {
+            grp.addApply(s);
+        }
+        uint64_t expected = 0;
+        for (uint64_t r = 0; r < 10; ++r)
+        {
+            vector<uint64_t> xs;
+            for (uint64_t i = 0; i < 1000; ++i)
+            {
+                xs.push_back(r * 1000 + i);
+                expected += xs.back();
+            }
+            grp.push_back(xs.data(), xs.data() + 500);
+            for (uint64_t i = 500; i < xs.size(); ++i)
+            {
+                grp.push_back(xs[i]);
+            }
+            grp.sync(3);
+            BOOST_CHECK_EQUAL(sum.load(), expected);
+        }
+        grp.wait();
+    }
+
+    void workQueueOverflow(bool pRing)
+    {
+        // Many items, some of them pushing more.
+        std::atomic<uint64_t> sum(0);
+        uint64_t expected = 0;
+        {
+            WorkQueue q(3, pRing);
+            BOOST_CHECK_EQUAL(q.ring(), pRing);
+            for (uint64_t i = 0; i < 5000; ++i)
+            {
+                q.push_back(std::bind(&add, std::ref(sum), i));
+                expected += i;
+                if (i % 100 == 0)
+                {
+                    q.push_back([&q, &sum, i]() { q.push_back(std::bind(&add, std::ref(sum), i)); });
+                    expected += i;
+                }
+            }
+            q.wait();
+        }
+        BOOST_CHECK_EQUAL(sum.load(), expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testMultiConsumerSync)
+{
+    multiConsumerSync(false);
+    multiConsumerSync(true);
+}
+
+BOOST_AUTO_TEST_CASE(testWorkQueueOverflow)
+{
+    // More items than the ring holds.
+    workQueueOverflow(false);
+    workQueueOverflow(true);
+}
+
 #include "testEnd.hh"
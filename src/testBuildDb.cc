@@ -0,0 +1,206 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "GossCmdBuildDb.hh"
+
+#include "GossCmdBuildEntryEdgeSet.hh"
+#include "GossCmdBuildGraph.hh"
+#include "GossCmdBuildSupergraph.hh"
+#include "StringFileFactory.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <sqlite3.h>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace boost;
+using namespace std;
+
+#define GOSS_TEST_MODULE TestBuildDb
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    string reads(uint64_t pN, uint64_t pSeed)
+    {
+        std::mt19937 rng(pSeed);
+        const uint64_t L = 50;
+        string genome;
+        for (uint64_t i = 0; i < pN; ++i)
+        {
+            genome += "ACGT"[rng() & 3];
+        }
+        const string rep = genome.substr(0, 100);
+        genome.replace(pN / 2, rep.size(), rep);
+
+        string r;
+        for (uint64_t i = 0; i < pN / 5; ++i)
+        {
+            const uint64_t x = rng() % (genome.size() - L + 1);
+            r += ">r" + lexical_cast<string>(i) + "\n" + genome.substr(x, L) + "\n";
+        }
+        return r;
+    }
+
+    // The lines of pText, sorted.
+    string sorted(const string& pText)
+    {
+        istringstream in(pText);
+        vector<string> lines;
+        string l;
+        while (getline(in, l))
+        {
+            lines.push_back(l);
+        }
+        sort(lines.begin(), lines.end());
+        string r;
+        for (uint64_t i = 0; i < lines.size(); ++i)
+        {
+            r += lines[i] + '\n';
+        }
+        return r;
+    }
+
+    struct Fixture
+    {
+        Fixture()
+            : log("log.txt", fac), cxt(fac, log, "build-db", opts),
+              dbFile("/tmp/testBuildDb-" + lexical_cast<string>(getpid()) + ".db")
+        {
+            fac.addFile("r.fa", reads(20000, 13));
+            vector<string> fastas(1, "r.fa");
+            vector<string> none;
+            GossCmdBuildGraph(21, 16, (1ULL << 20), 2, "g", fastas, none, none)(cxt);
+            GossCmdBuildEntryEdgeSet("g", 2)(cxt);
+            GossCmdBuildSupergraph("g", false)(cxt);
+        }
+
+        ~Fixture()
+        {
+            std::remove(dbFile.c_str());
+        }
+
+        void buildDb(const string& pOut, GossCmdBuildDb::Format pFormat)
+        {
+            vector<string> none;
+            GossCmdBuildDb("g", pOut, pFormat, true, true, none, none, none,
+                           false, 0, 0, 0.1, 2.0, PairLinker::PairedEnds, 3, 4, false)(cxt);
+        }
+
+        string contents(const string& pName)
+        {
+            FileFactory::InHolderPtr ip(fac.in(pName));
+            ostringstream s;
+            s << (**ip).rdbuf();
+            return s.str();
+        }
+
+        // The rows of a query, as lines of comma separated values.
+        string query(const string& pSql)
+        {
+            sqlite3* db = 0;
+            BOOST_REQUIRE(sqlite3_open(dbFile.c_str(), &db) == SQLITE_OK);
+            sqlite3_stmt* stmt = 0;
+            BOOST_REQUIRE(sqlite3_prepare_v2(db, pSql.c_str(), -1, &stmt, 0) == SQLITE_OK);
+            ostringstream s;
+            s.precision(std::numeric_limits<double>::max_digits10);
+            while (sqlite3_step(stmt) == SQLITE_ROW)
+            {
+                for (int c = 0; c < sqlite3_column_count(stmt); ++c)
+                {
+                    s << (c ? "," : "");
+                    if (sqlite3_column_type(stmt, c) == SQLITE_FLOAT)
+                    {
+                        s << sqlite3_column_double(stmt, c);
+                    }
+                    else
+                    {
+                        s << reinterpret_cast<const char*>(sqlite3_column_text(stmt, c));
+                    }
+                }
+                s << '\n';
+            }
+            sqlite3_finalize(stmt);
+            sqlite3_close(db);
+            return s.str();
+        }
+
+        template <typename T>
+        vector<T> column(const string& pName)
+        {
+            const string s = contents(pName);
+            BOOST_REQUIRE(s.size() % sizeof(T) == 0);
+            vector<T> xs(s.size() / sizeof(T));
+            std::copy(s.begin(), s.end(), reinterpret_cast<char*>(xs.data()));
+            return xs;
+        }
+
+        StringFileFactory fac;
+        Logger log;
+        boost::program_options::variables_map opts;
+        GossCmdContext cxt;
+        const string dbFile;
+    };
+}
+
+BOOST_AUTO_TEST_CASE(testFormatsAgree)
+{
+    Fixture f;
+    f.buildDb(f.dbFile, GossCmdBuildDb::SQLite);
+    f.buildDb("t", GossCmdBuildDb::CSV);
+    f.buildDb("c", GossCmdBuildDb::Columns);
+
+    // The CSV files hold the same rows as the database. The nodes and
+    // sequences come out of the database in id order.
+    const string nodes = sorted(f.query("SELECT * FROM nodes;"));
+    const string seqs = sorted(f.query("SELECT * FROM sequences;"));
+    const string links = f.query("SELECT * FROM links;");
+    BOOST_CHECK(nodes.size() > 0);
+    BOOST_CHECK(links.size() > 0);
+    BOOST_CHECK(sorted(f.contents("t-nodes.csv")) == sorted("id,rc,cov_mean,length\n" + nodes));
+    BOOST_CHECK(sorted(f.contents("t-sequences.csv")) == sorted("id,sequence\n" + seqs));
+    BOOST_CHECK(f.contents("t-links.csv") == "id_from,id_to,gap,count,type\n" + links);
+
+    // The indexes are built after the load.
+    BOOST_CHECK_EQUAL(f.query("SELECT name FROM sqlite_master WHERE type='index' ORDER BY name;"),
+                      "index_from\nindex_to\n");
+
+    // And so do the columns.
+    const vector<int64_t> ids(f.column<int64_t>("c-nodes.id"));
+    const vector<int64_t> lens(f.column<int64_t>("c-nodes.length"));
+    const vector<int64_t> seqIds(f.column<int64_t>("c-sequences.id"));
+    const vector<int64_t> offsets(f.column<int64_t>("c-sequences.offset"));
+    const string text = f.contents("c-sequences.sequence");
+    const vector<int64_t> froms(f.column<int64_t>("c-links.id_from"));
+    const vector<int64_t> tos(f.column<int64_t>("c-links.id_to"));
+    BOOST_REQUIRE_EQUAL(offsets.size(), ids.size() + 1);
+    BOOST_CHECK_EQUAL(offsets.back(), int64_t(text.size()));
+    ostringstream s;
+    for (uint64_t i = 0; i < ids.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(seqIds[i], ids[i]);
+        BOOST_CHECK_EQUAL(offsets[i + 1] - offsets[i], lens[i]);
+        s << ids[i] << ',' << text.substr(offsets[i], offsets[i + 1] - offsets[i]) << '\n';
+    }
+    BOOST_CHECK(sorted(s.str()) == seqs);
+    ostringstream l;
+    for (uint64_t i = 0; i < froms.size(); ++i)
+    {
+        l << froms[i] << ',' << tos[i] << ",0,1,1\n";
+    }
+    BOOST_CHECK(l.str() == links);
+
+    BOOST_CHECK(f.contents("c.schema").find("links\tid_from\tint64\t" + lexical_cast<string>(froms.size()) + "\n")
+                != string::npos);
+}
+
+#include "testEnd.hh"
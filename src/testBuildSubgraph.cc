@@ -0,0 +1,276 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "GossCmdBuildSubgraph.hh"
+
+#include "GossCmdBuildGraph.hh"
+#include "Graph.hh"
+#include "StringFileFactory.hh"
+#include "testHelpers.hh"
+
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace boost;
+using namespace std;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE TestBuildSubgraph
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    class Vis
+    {
+    public:
+        bool operator()(const Graph::Edge& pEdge, const Gossamer::rank_type& pRank)
+        {
+            mRanks.push_back(pRank);
+            return true;
+        }
+
+        Vis(vector<uint64_t>& pRanks)
+            : mRanks(pRanks)
+        {
+        }
+
+    private:
+        vector<uint64_t>& mRanks;
+    };
+
+    struct Fixture
+    {
+        Fixture()
+            : log("log.txt", fac), cxt(fac, log, "build-subgraph", opts)
+        {
+            // A genome with repeats, so there are branches, and seeds
+            // from a few places in it.
+            std::mt19937 rng(31);
+            string genome = randomGenome(30000, rng);
+            const string rep = genome.substr(0, 80);
+            for (uint64_t i = 1; i < 10; ++i)
+            {
+                genome.replace(i * 3000, rep.size(), rep);
+            }
+            fac.addFile("r.fa", randomReads(genome, 10000, 50, rng));
+            fac.addFile("s.fa", ">s0\n" + genome.substr(1000, 30) + "\n>s1\n" + genome.substr(7100, 40) + "\n");
+
+            vector<string> fastas(1, "r.fa");
+            vector<string> none;
+            GossCmdBuildGraph(21, 16, (1ULL << 20), 2, "g", fastas, none, none)(cxt);
+            gPtr = Graph::open("g", fac);
+        }
+
+        set<uint64_t> seeds()
+        {
+            const Graph& g(*gPtr);
+            set<uint64_t> s;
+            for (uint64_t i = 0; i < g.count(); ++i)
+            {
+                SmallBaseVector v;
+                g.seq(g.select(i), v);
+                string x;
+                for (uint64_t j = 0; j < v.size(); ++j)
+                {
+                    x += "ACGT"[v[j]];
+                }
+                const string seeds = contents(fac, "s.fa");
+                if (seeds.find(x) != string::npos)
+                {
+                    s.insert(i);
+                    s.insert(g.rank(g.reverseComplement(g.select(i))));
+                }
+            }
+            return s;
+        }
+
+        set<uint64_t> subgraph(uint64_t pRadius, bool pLinearPaths, uint64_t pThreads,
+                               const string& pSeeds = "s.fa")
+        {
+            vector<string> fastas(1, pSeeds);
+            vector<string> none;
+            GossCmdBuildSubgraph("g", "h", fastas, none, none, pRadius, pLinearPaths, 1ULL << 26, pThreads)(cxt);
+            const Graph& g(*gPtr);
+            GraphPtr hPtr = Graph::open("h", fac);
+            const Graph& h(*hPtr);
+            set<uint64_t> s;
+            for (uint64_t i = 0; i < h.count(); ++i)
+            {
+                uint64_t r = 0;
+                BOOST_REQUIRE(g.accessAndRank(h.select(i), r));
+                BOOST_REQUIRE_EQUAL(h.multiplicity(i), g.multiplicity(r));
+                s.insert(r);
+            }
+            return s;
+        }
+
+        StringFileFactory fac;
+        Logger log;
+        boost::program_options::variables_map opts;
+        GossCmdContext cxt;
+        GraphPtr gPtr;
+    };
+
+    // The edges within pRadius steps of the seeds, as build-subgraph
+    // used to find them, with a graph sized bitmap.
+    set<uint64_t> denseSingle(const Graph& pGraph, const set<uint64_t>& pSeeds, uint64_t pRadius)
+    {
+        dynamic_bitset<> interesting(pGraph.count());
+        for (set<uint64_t>::const_iterator i = pSeeds.begin(); i != pSeeds.end(); ++i)
+        {
+            interesting[*i] = true;
+        }
+        dynamic_bitset<> prev(interesting);
+        dynamic_bitset<> fringe(pGraph.count());
+        for (uint64_t i = 0; i < pRadius; ++i)
+        {
+            fringe.reset();
+            for (uint64_t j = 0; j < prev.size(); ++j)
+            {
+                if (!prev[j])
+                {
+                    continue;
+                }
+                const Graph::Edge e = pGraph.select(j);
+                const Graph::Edge es[2] = {e, pGraph.reverseComplement(e)};
+                for (uint64_t l = 0; l < 2; ++l)
+                {
+                    pair<uint64_t,uint64_t> r = pGraph.beginEndRank(pGraph.to(es[l]));
+                    for (uint64_t k = r.first; k < r.second; ++k)
+                    {
+                        fringe[k] = !interesting[k];
+                        const uint64_t k_rc = pGraph.rank(pGraph.reverseComplement(pGraph.select(k)));
+                        fringe[k_rc] = !interesting[k_rc];
+                    }
+                }
+            }
+            interesting |= fringe;
+            prev.swap(fringe);
+        }
+        set<uint64_t> s;
+        for (uint64_t i = 0; i < interesting.size(); ++i)
+        {
+            if (interesting[i])
+            {
+                s.insert(i);
+            }
+        }
+        return s;
+    }
+
+    // The same, walking linear paths: the edges on the paths are
+    // visited, and the edges beyond them are the next frontier.
+    set<uint64_t> serialLinear(const Graph& pGraph, const set<uint64_t>& pSeeds, uint64_t pRadius)
+    {
+        set<uint64_t> visited(pSeeds);
+        set<uint64_t> frontier(pSeeds);
+        for (uint64_t i = 0; i < pRadius; ++i)
+        {
+            set<uint64_t> next;
+            set<uint64_t> path;
+            for (set<uint64_t>::const_iterator j = frontier.begin(); j != frontier.end(); ++j)
+            {
+                const Graph::Edge e = pGraph.select(*j);
+                const Graph::Edge es[2] = {e, pGraph.reverseComplement(e)};
+                for (uint64_t l = 0; l < 2; ++l)
+                {
+                    vector<uint64_t> ranks;
+                    Vis vis(ranks);
+                    const Graph::Edge end = pGraph.linearPath(es[l], vis);
+                    for (uint64_t m = 0; m < ranks.size(); ++m)
+                    {
+                        path.insert(ranks[m]);
+                        path.insert(pGraph.rank(pGraph.reverseComplement(pGraph.select(ranks[m]))));
+                    }
+                    pair<uint64_t,uint64_t> r = pGraph.beginEndRank(pGraph.to(end));
+                    for (uint64_t k = r.first; k < r.second; ++k)
+                    {
+                        next.insert(k);
+                        next.insert(pGraph.rank(pGraph.reverseComplement(pGraph.select(k))));
+                    }
+                }
+            }
+            frontier.clear();
+            for (set<uint64_t>::const_iterator j = next.begin(); j != next.end(); ++j)
+            {
+                if (!visited.count(*j) && !path.count(*j))
+                {
+                    frontier.insert(*j);
+                }
+            }
+            visited.insert(path.begin(), path.end());
+            visited.insert(frontier.begin(), frontier.end());
+        }
+        return visited;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testSingleSteps)
+{
+    Fixture f;
+    const set<uint64_t> seeds = f.seeds();
+    BOOST_REQUIRE(seeds.size() > 0);
+    for (uint64_t radius = 0; radius < 40; radius += 13)
+    {
+        const set<uint64_t> expected = denseSingle(*f.gPtr, seeds, radius);
+        BOOST_CHECK(f.subgraph(radius, false, 1) == expected);
+        BOOST_CHECK(f.subgraph(radius, false, 3) == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testLinearPaths)
+{
+    Fixture f;
+    const set<uint64_t> seeds = f.seeds();
+    for (uint64_t radius = 0; radius < 4; ++radius)
+    {
+        const set<uint64_t> expected = serialLinear(*f.gPtr, seeds, radius);
+        BOOST_CHECK(radius == 0 || expected.size() > seeds.size());
+        BOOST_CHECK(f.subgraph(radius, true, 1) == expected);
+        BOOST_CHECK(f.subgraph(radius, true, 3) == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testManySeedBatches)
+{
+    // Seeding from all the reads gives more batches of k-mers than are
+    // let in flight at once.
+    Fixture f;
+    const Graph& g(*f.gPtr);
+    set<uint64_t> expected;
+    istringstream in(contents(f.fac, "r.fa"));
+    string l;
+    while (getline(in, l))
+    {
+        SmallBaseVector v;
+        if (l.empty() || l[0] == '>' || !SmallBaseVector::make(l, v))
+        {
+            continue;
+        }
+        for (uint64_t i = 0; i + g.K() + 1 <= v.size(); ++i)
+        {
+            const Graph::Edge e(v.kmer(g.K() + 1, i));
+            uint64_t r = 0;
+            if (g.accessAndRank(e, r))
+            {
+                expected.insert(r);
+            }
+            if (g.accessAndRank(g.reverseComplement(e), r))
+            {
+                expected.insert(r);
+            }
+        }
+    }
+    BOOST_REQUIRE(expected.size() > 0);
+    BOOST_CHECK(f.subgraph(0, false, 1, "r.fa") == expected);
+    BOOST_CHECK(f.subgraph(0, false, 3, "r.fa") == expected);
+}
+
+#include "testEnd.hh"
@@ -0,0 +1,208 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "GossCmdUpdateGraph.hh"
+
+#include "EntryEdgeSet.hh"
+#include "GossCmdBuildEntryEdgeSet.hh"
+#include "GossCmdBuildGraph.hh"
+#include "GossCmdBuildSupergraph.hh"
+#include "GossCmdBuildUnitigs.hh"
+#include "Graph.hh"
+#include "StringFileFactory.hh"
+#include "SuperGraph.hh"
+#include "UnitigIndex.hh"
+#include "testHelpers.hh"
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace boost;
+using namespace std;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE TestGossCmdUpdateGraph
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    void buildGraph(const vector<string>& pFastas, const string& pName, StringFileFactory& pFac)
+    {
+        Logger log("log.txt", pFac);
+        std::vector<string> fastqs;
+        std::vector<string> lines;
+        GossCmdBuildGraph cmd(21, 16, (1ULL << 16), 2, pName, pFastas, fastqs, lines);
+        boost::program_options::variables_map opts;
+        GossCmdContext cxt(pFac, log, "build-graph", opts);
+        cmd(cxt);
+    }
+
+    void updateGraph(const string& pIn, const string& pFasta, const string& pOut, StringFileFactory& pFac)
+    {
+        Logger log("log.txt", pFac);
+        std::vector<string> fastqs;
+        std::vector<string> lines;
+        GossCmdUpdateGraph cmd(pIn, pOut, 16, (1ULL << 16), 2, vector<string>(1, pFasta), fastqs, lines);
+        boost::program_options::variables_map opts;
+        GossCmdContext cxt(pFac, log, "update-graph", opts);
+        cmd(cxt);
+    }
+
+    // Build the unitig index, entry edges and supergraph of pName.
+    void buildIndexes(const string& pName, StringFileFactory& pFac)
+    {
+        Logger log("log.txt", pFac);
+        boost::program_options::variables_map opts;
+        GossCmdContext cxt(pFac, log, "build-supergraph", opts);
+        GossCmdBuildUnitigs(pName, 2)(cxt);
+        GossCmdBuildEntryEdgeSet(pName, 2)(cxt);
+        GossCmdBuildSupergraph(pName, false)(cxt);
+    }
+
+    // The lines of the supergraph's dump, sorted, since the successors
+    // come out in hash table order.
+    vector<string> dumpSupergraph(const string& pName, StringFileFactory& pFac)
+    {
+        stringstream out;
+        SuperGraph::read(pName, pFac)->dump(out);
+        vector<string> lines;
+        string l;
+        while (getline(out, l))
+        {
+            lines.push_back(l);
+        }
+        sort(lines.begin(), lines.end());
+        return lines;
+    }
+
+    void checkSameUnitigs(const string& pLhs, const string& pRhs, StringFileFactory& pFac)
+    {
+        UnitigIndex l(pLhs + "-unitigs", pFac);
+        UnitigIndex r(pRhs + "-unitigs", pFac);
+        BOOST_REQUIRE_EQUAL(l.count(), r.count());
+        BOOST_REQUIRE_EQUAL(l.edges(), r.edges());
+        BOOST_CHECK_EQUAL(l.cycles(), r.cycles());
+        for (uint64_t i = 0; i < l.count(); ++i)
+        {
+            BOOST_REQUIRE_EQUAL(l.begin(i), r.begin(i));
+        }
+        for (uint64_t p = 0; p < l.edges(); ++p)
+        {
+            BOOST_REQUIRE_EQUAL(l.edge(p), r.edge(p));
+        }
+    }
+
+    void checkSameEntries(const string& pLhs, const string& pRhs, StringFileFactory& pFac)
+    {
+        EntryEdgeSet l(pLhs + "-entries", pFac);
+        EntryEdgeSet r(pRhs + "-entries", pFac);
+        BOOST_CHECK_EQUAL(l.fingerprint(), r.fingerprint());
+        BOOST_REQUIRE_EQUAL(l.count(), r.count());
+        for (uint64_t i = 0; i < l.count(); ++i)
+        {
+            BOOST_REQUIRE(l.select(i) == r.select(i));
+            BOOST_REQUIRE_EQUAL(l.multiplicity(i), r.multiplicity(i));
+            BOOST_REQUIRE_EQUAL(l.length(i), r.length(i));
+            BOOST_REQUIRE_EQUAL(l.endRank(i), r.endRank(i));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testUpdateMatchesRebuild)
+{
+    std::mt19937 rng(17);
+    const string genome(randomGenome(2000, rng));
+
+    StringFileFactory fac;
+    fac.addFile("a.fa", randomReads(genome.substr(0, 1200), 200, 50, rng));
+    fac.addFile("b.fa", randomReads(genome.substr(800), 200, 50, rng));
+
+    buildGraph(vector<string>(1, "a.fa"), "a", fac);
+    vector<string> both;
+    both.push_back("a.fa");
+    both.push_back("b.fa");
+    buildGraph(both, "ab", fac);
+    updateGraph("a", "b.fa", "u", fac);
+
+    BOOST_CHECK(fac.fileExists("u-counts-hist.txt"));
+    Graph::LazyIterator u("u", fac);
+    Graph::LazyIterator ab("ab", fac);
+    BOOST_CHECK_EQUAL(u.K(), ab.K());
+    BOOST_CHECK_EQUAL(u.count(), ab.count());
+    for (; u.valid() && ab.valid(); ++u, ++ab)
+    {
+        BOOST_CHECK((*u).first == (*ab).first);
+        BOOST_CHECK_EQUAL((*u).second, (*ab).second);
+    }
+    BOOST_CHECK(!u.valid());
+    BOOST_CHECK(!ab.valid());
+}
+
+BOOST_AUTO_TEST_CASE(testUpdateRebuildsIndexes)
+{
+    // New edges: the unitig index, entry edges and supergraph are the
+    // same as those built afresh from all the reads.
+    std::mt19937 rng(19);
+    const string genome(randomGenome(2000, rng));
+
+    StringFileFactory fac;
+    fac.addFile("a.fa", randomReads(genome.substr(0, 1200), 200, 50, rng));
+    fac.addFile("b.fa", randomReads(genome.substr(800), 200, 50, rng));
+
+    buildGraph(vector<string>(1, "a.fa"), "a", fac);
+    buildIndexes("a", fac);
+    vector<string> both;
+    both.push_back("a.fa");
+    both.push_back("b.fa");
+    buildGraph(both, "ab", fac);
+    buildIndexes("ab", fac);
+
+    updateGraph("a", "b.fa", "u", fac);
+    BOOST_REQUIRE(Graph::open("u", fac)->count() > Graph::open("a", fac)->count());
+
+    checkSameUnitigs("u", "ab", fac);
+    checkSameEntries("u", "ab", fac);
+    BOOST_CHECK(dumpSupergraph("u", fac) == dumpSupergraph("ab", fac));
+}
+
+BOOST_AUTO_TEST_CASE(testUpdateCopiesSupergraph)
+{
+    // No new edges: the entry edges are built afresh, since the counts
+    // have changed, but the supergraph is copied, along with a path
+    // threaded through it that a fresh one wouldn't have.
+    std::mt19937 rng(23);
+    const string genome(randomGenome(2000, rng));
+
+    StringFileFactory fac;
+    fac.addFile("a.fa", randomReads(genome, 300, 50, rng));
+
+    buildGraph(vector<string>(1, "a.fa"), "a", fac);
+    buildIndexes("a", fac);
+    {
+        std::unique_ptr<SuperGraph> sg(SuperGraph::read("a", fac));
+        sg->link(vector<SuperPathId>(1, SuperPathId(0)));
+        sg->write("a", fac);
+    }
+    vector<string> twice(2, "a.fa");
+    buildGraph(twice, "aa", fac);
+    buildIndexes("aa", fac);
+
+    updateGraph("a", "a.fa", "u", fac);
+    BOOST_REQUIRE_EQUAL(Graph::open("u", fac)->count(), Graph::open("a", fac)->count());
+
+    checkSameUnitigs("u", "aa", fac);
+    checkSameEntries("u", "aa", fac);
+    const vector<string> sg(dumpSupergraph("u", fac));
+    BOOST_CHECK(sg == dumpSupergraph("a", fac));
+    BOOST_CHECK(sg != dumpSupergraph("aa", fac));
+}
+
+#include "testEnd.hh"
@@ -15,6 +15,7 @@
 #include <string>
 #include <vector>
 #include <random>
+#include <algorithm>
 
 using namespace boost;
 using namespace std;
@@ -123,6 +124,320 @@ BOOST_AUTO_TEST_CASE(test1)
     BOOST_CHECK_EQUAL(h[4], 4);
 }
 
+BOOST_AUTO_TEST_CASE(testFusedCounts)
+{
+    const uint64_t K = 15;
+    const uint64_t K1 = K + 1;
+
+    StringFileFactory fac;
+    map<Gossamer::position_type,uint64_t> k1mers;
+    SmallBaseVector vec;
+    for (uint64_t i = 0; outs[i]; ++i)
+    {
+        seqToVec(outs[i], vec);
+        for (uint64_t j = 0; j < vec.size() - K1 + 1; ++j)
+        {
+            k1mers[vec.kmer(K1, j)] += 1 + 100 * j;
+        }
+    }
+    for (uint64_t f = 0; f < 2; ++f)
+    {
+        VariableByteArray::Format fmt = f ? VariableByteArray::FusedFormat : VariableByteArray::LayeredFormat;
+        if (!f)
+        {
+            // The layout comes from the graph's header, so a file left
+            // over from a fused graph of the same name changes nothing.
+            FileFactory::OutHolderPtr op(fac.out("x-counts.fused"));
+            **op << "stale";
+        }
+        {
+            Graph::Builder b(K, "x", fac, k1mers.size(), false, fmt);
+            for (map<Gossamer::position_type,uint64_t>::const_iterator i = k1mers.begin();
+                    i != k1mers.end(); ++i)
+            {
+                b.push_back(i->first, i->second);
+            }
+            b.end();
+        }
+
+        GraphPtr gPtr = Graph::open("x", fac);
+        Graph& g(*gPtr);
+        BOOST_CHECK_EQUAL(g.countsFormat(), fmt);
+
+        Graph::LazyIterator itr("x", fac);
+        BOOST_CHECK_EQUAL(itr.countsFormat(), fmt);
+        for (map<Gossamer::position_type,uint64_t>::const_iterator i = k1mers.begin();
+                i != k1mers.end(); ++i, ++itr)
+        {
+            Graph::Edge e(i->first);
+            BOOST_CHECK_EQUAL(g.multiplicity(e), i->second);
+            BOOST_CHECK(itr.valid());
+            BOOST_CHECK_EQUAL((*itr).second, i->second);
+        }
+        BOOST_CHECK(!itr.valid());
+
+        gPtr = GraphPtr();
+        Graph::remove("x", fac);
+    }
+}
+
+namespace // anonymous
+{
+    // Build a graph over the rho-mers of a random sequence and their
+    // reverse complements, returning them in sorted order.
+    vector<uint64_t> buildSymmetricGraph(uint64_t pK, uint64_t pLength, FileFactory& pFac)
+    {
+        const uint64_t rho = pK + 1;
+        const uint64_t m = (1ULL << (2 * rho)) - 1;
+        std::mt19937 rng(17);
+        vector<uint64_t> xs;
+        uint64_t x = 0;
+        for (uint64_t i = 0; i < pLength; ++i)
+        {
+            x = ((x << 2) | (rng() & 3)) & m;
+            if (i + 1 >= rho)
+            {
+                Gossamer::position_type y(x);
+                y.reverseComplement(rho);
+                xs.push_back(x);
+                xs.push_back(y.asUInt64());
+            }
+        }
+        sort(xs.begin(), xs.end());
+        xs.erase(unique(xs.begin(), xs.end()), xs.end());
+
+        Graph::Builder b(pK, "x", pFac, xs.size());
+        for (uint64_t i = 0; i < xs.size(); ++i)
+        {
+            b.push_back(Gossamer::position_type(xs[i]), 1);
+        }
+        b.end();
+        return xs;
+    }
+
+    void checkSameStats(const GraphStats& pLhs, const GraphStats& pRhs)
+    {
+        BOOST_CHECK_EQUAL(pLhs.K, pRhs.K);
+        BOOST_CHECK_EQUAL(pLhs.edges, pRhs.edges);
+        BOOST_CHECK_EQUAL(pLhs.nodes, pRhs.nodes);
+        for (uint64_t i = 0; i <= GraphStats::MaxDegree; ++i)
+        {
+            for (uint64_t j = 0; j <= GraphStats::MaxDegree; ++j)
+            {
+                BOOST_CHECK_EQUAL(pLhs.degrees[i][j], pRhs.degrees[i][j]);
+            }
+        }
+        BOOST_CHECK_EQUAL(pLhs.rcEdges, pRhs.rcEdges);
+        BOOST_CHECK_EQUAL(pLhs.palindromicEdges, pRhs.palindromicEdges);
+        BOOST_CHECK_EQUAL(pLhs.unitigs, pRhs.unitigs);
+        BOOST_CHECK_EQUAL(pLhs.cycles, pRhs.cycles);
+        BOOST_CHECK(pLhs.unitigLengths == pRhs.unitigLengths);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testRetunedEdges)
+{
+    // A graph built for far more edges than it gets ends up with
+    // the edges' D for the number it has, and the space budget.
+    const uint64_t K = 19;
+    const uint64_t rho = K + 1;
+    const Gossamer::position_type N(Gossamer::position_type(1) << (2 * rho));
+    StringFileFactory fac;
+    std::mt19937 rng(23);
+    vector<Gossamer::position_type> xs;
+    for (uint64_t i = 0; i < 20000; ++i)
+    {
+        Gossamer::position_type x(rng());
+        x <<= 32;
+        x |= Gossamer::position_type(rng());
+        x &= (Gossamer::position_type(1) << (2 * rho)) - 1;
+        xs.push_back(x);
+    }
+    sort(xs.begin(), xs.end());
+    xs.erase(unique(xs.begin(), xs.end()), xs.end());
+    {
+        Graph::Builder b(K, "x", fac, 1000 * xs.size());
+        for (uint64_t i = 0; i < xs.size(); ++i)
+        {
+            b.push_back(xs[i], 1 + i % 3);
+        }
+        b.end();
+    }
+    BOOST_CHECK_EQUAL(SparseArray("x-edges", fac).stat().as<uint64_t>("D"),
+                      SparseArray::Builder::fastD(N, xs.size(), Graph::Builder::EdgesSpaceBudget));
+
+    GraphPtr gPtr = Graph::open("x", fac);
+    Graph& g(*gPtr);
+    BOOST_CHECK_EQUAL(g.count(), xs.size());
+    for (uint64_t i = 0; i < xs.size(); ++i)
+    {
+        Gossamer::rank_type r = 0;
+        BOOST_REQUIRE(g.accessAndRank(Graph::Edge(xs[i]), r));
+        BOOST_REQUIRE_EQUAL(r, i);
+        BOOST_REQUIRE_EQUAL(g.multiplicity(r), 1 + i % 3);
+    }
+}
+
+namespace // anonymous
+{
+    uint64_t buildAndFingerprint(const vector<Gossamer::position_type>& pEdges,
+                                 const vector<uint64_t>& pCounts, FileFactory& pFac)
+    {
+        {
+            Graph::Builder b(19, "x", pFac, pEdges.size());
+            for (uint64_t i = 0; i < pEdges.size(); ++i)
+            {
+                b.push_back(pEdges[i], pCounts[i]);
+            }
+            b.end();
+        }
+        return Graph::open("x", pFac)->fingerprint();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testFingerprint)
+{
+    // A rebuilt graph of the same size only keeps its fingerprint if
+    // every edge and count is the same.
+    StringFileFactory fac;
+    std::mt19937 rng(29);
+    vector<Gossamer::position_type> xs;
+    for (uint64_t i = 0; i < 20000; ++i)
+    {
+        xs.push_back(Gossamer::position_type(rng()));
+    }
+    sort(xs.begin(), xs.end());
+    xs.erase(unique(xs.begin(), xs.end()), xs.end());
+    vector<uint64_t> cs;
+    for (uint64_t i = 0; i < xs.size(); ++i)
+    {
+        cs.push_back(1 + i % 5);
+    }
+
+    const uint64_t fp = buildAndFingerprint(xs, cs, fac);
+    BOOST_CHECK_EQUAL(buildAndFingerprint(xs, cs, fac), fp);
+
+    vector<uint64_t> cs1(cs);
+    cs1[12345] += 1;
+    BOOST_CHECK(buildAndFingerprint(xs, cs1, fac) != fp);
+
+    vector<Gossamer::position_type> xs1(xs);
+    xs1[12345] = xs1[12345] + 1;
+    BOOST_REQUIRE(xs1[12345] < xs1[12346]);
+    BOOST_CHECK(buildAndFingerprint(xs1, cs, fac) != fp);
+
+    // A graph from before fingerprints were saved gets the same one,
+    // taken as it is opened.
+    buildAndFingerprint(xs, cs, fac);
+    Graph::Header h;
+    {
+        FileFactory::InHolderPtr ip(fac.in("x.header"));
+        (**ip).read(reinterpret_cast<char*>(&h), sizeof(h));
+    }
+    h.version = Graph::unfingerprintedVersion;
+    {
+        FileFactory::OutHolderPtr op(fac.out("x.header"));
+        (**op).write(reinterpret_cast<const char*>(&h), sizeof(h) - sizeof(h.fingerprint));
+    }
+    BOOST_CHECK_EQUAL(Graph::open("x", fac)->fingerprint(), fp);
+}
+
+BOOST_AUTO_TEST_CASE(testStatsLinear)
+{
+    // A sequence without repeats gives a single unitig and its
+    // reverse complement.
+    const uint64_t K = 25;
+    const uint64_t len = 1000;
+    StringFileFactory fac;
+    buildSymmetricGraph(K, len, fac);
+
+    // Only published graphs have their statistics saved.
+    BOOST_CHECK(!GraphStats::exists("x", fac));
+    Graph::saveStats("x", fac);
+    BOOST_REQUIRE(GraphStats::exists("x", fac));
+    GraphStats s(Graph::stats("x", fac));
+    BOOST_CHECK_EQUAL(s.K, K);
+    BOOST_CHECK_EQUAL(s.edges, 2 * (len - K));
+    BOOST_CHECK_EQUAL(s.nodes, 2 * (len - K + 1));
+    BOOST_CHECK_EQUAL(s.degrees[1][1], 2 * (len - K - 1));
+    BOOST_CHECK_EQUAL(s.tipNodes(), 4);
+    BOOST_CHECK_EQUAL(s.branchingNodes(), 0);
+    BOOST_CHECK(s.symmetric());
+    BOOST_CHECK_EQUAL(s.unitigs, 2);
+    BOOST_CHECK_EQUAL(s.cycles, 0);
+    BOOST_CHECK_EQUAL(s.unitigLengths[len - K], 2);
+
+    // Rebuilding the graph discards the saved statistics.
+    buildSymmetricGraph(K, len, fac);
+    BOOST_CHECK(!GraphStats::exists("x", fac));
+
+    Graph::saveStats("x", fac);
+    Graph::remove("x", fac);
+    BOOST_CHECK(!GraphStats::exists("x", fac));
+}
+
+BOOST_AUTO_TEST_CASE(testStatsBranching)
+{
+    // A small K makes for plenty of branches, and several chunks of
+    // edges for the threads to share.
+    const uint64_t K = 7;
+    StringFileFactory fac;
+    const vector<uint64_t> xs(buildSymmetricGraph(K, 20000, fac));
+    Graph::saveStats("x", fac, 4);
+    GraphStats saved(Graph::stats("x", fac));
+
+    map<uint64_t,uint64_t> ins;
+    map<uint64_t,uint64_t> outs;
+    const uint64_t m = (1ULL << (2 * K)) - 1;
+    for (uint64_t x: xs)
+    {
+        ++outs[x >> 2];
+        ++ins[x & m];
+        ins[x >> 2];
+        outs[x & m];
+    }
+    uint64_t degrees[5][5] = {};
+    for (auto& i: ins)
+    {
+        ++degrees[i.second][outs[i.first]];
+    }
+
+    BOOST_CHECK_EQUAL(saved.edges, xs.size());
+    BOOST_CHECK_EQUAL(saved.nodes, ins.size());
+    BOOST_CHECK(saved.symmetric());
+    BOOST_CHECK(saved.branchingNodes() > 0);
+    for (uint64_t i = 0; i <= GraphStats::MaxDegree; ++i)
+    {
+        for (uint64_t j = 0; j <= GraphStats::MaxDegree; ++j)
+        {
+            BOOST_CHECK_EQUAL(saved.degrees[i][j], degrees[i][j]);
+        }
+    }
+
+    uint64_t total = 0;
+    for (auto& i: saved.unitigLengths)
+    {
+        total += i.first * i.second;
+    }
+    BOOST_CHECK_EQUAL(total, xs.size());
+
+    GraphPtr gPtr = Graph::open("x", fac);
+    uint64_t starts = 0;
+    for (uint64_t x: xs)
+    {
+        Graph::Node n(gPtr->from(Graph::Edge(Gossamer::position_type(x))));
+        starts += !(gPtr->inDegree(n) == 1 && gPtr->outDegree(n) == 1);
+    }
+    BOOST_CHECK_EQUAL(saved.unitigs, starts + saved.cycles);
+
+    checkSameStats(GraphStats::compute(*gPtr, 1), saved);
+    checkSameStats(GraphStats::compute(*gPtr, 3), saved);
+
+    // Without the sidecar, the statistics are computed afresh.
+    GraphStats::remove("x", fac);
+    checkSameStats(Graph::stats("x", fac, 2), saved);
+}
+
 BOOST_AUTO_TEST_CASE(test111BetterErrorMessage)
 {
     StringFileFactory fac;
@@ -0,0 +1,149 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "GraphArchive.hh"
+#include "GossamerException.hh"
+#include "GossCmdDumpGraph.hh"
+#include "GossCmdRestoreGraph.hh"
+#include "Graph.hh"
+#include "Logger.hh"
+#include "StringFileFactory.hh"
+#include "testHelpers.hh"
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+using namespace std;
+using namespace Gossamer;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE TestGraphArchive
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    void checkSame(const string& pLhs, const string& pRhs, FileFactory& pFac)
+    {
+        Graph::LazyIterator l(pLhs, pFac);
+        Graph::LazyIterator r(pRhs, pFac);
+        BOOST_CHECK_EQUAL(l.K(), r.K());
+        BOOST_CHECK_EQUAL(l.count(), r.count());
+        BOOST_CHECK_EQUAL(l.asymmetric(), r.asymmetric());
+        BOOST_CHECK(graphEdges(pLhs, pFac) == graphEdges(pRhs, pFac));
+    }
+
+    void set64(string& pBytes, uint64_t pPos, uint64_t pVal)
+    {
+        for (uint64_t i = 0; i < 8; ++i)
+        {
+            pBytes[pPos + i] = static_cast<char>((pVal >> (8 * i)) & 0xff);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testRoundTrip)
+{
+    const uint64_t ns[] = { 0, 1, GraphArchive::blockEdges, 3 * GraphArchive::blockEdges + 17 };
+    for (uint64_t i = 0; i < sizeof(ns) / sizeof(ns[0]); ++i)
+    {
+        StringFileFactory fac;
+        buildGraph("g", 27, randomEdges(27, ns[i], 17 + i), fac);
+
+        stringstream s;
+        GraphArchive::write("g", fac, s, 3);
+        BOOST_CHECK(GraphArchive::isArchive(s));
+        GraphArchive::read(s, "s", "h", fac, 2);
+        checkSame("g", "h", fac);
+        BOOST_CHECK(fac.fileExists("h-counts-hist.txt"));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testCorruption)
+{
+    StringFileFactory fac;
+    buildGraph("g", 25, randomEdges(25, 2 * GraphArchive::blockEdges, 19), fac);
+    stringstream s;
+    GraphArchive::write("g", fac, s, 2);
+    const string a(s.str());
+
+    // Flip a bit in a block.
+    {
+        string b(a);
+        b[a.size() / 2] ^= 0x10;
+        istringstream in(b);
+        BOOST_CHECK_THROW(GraphArchive::read(in, "in", "h", fac, 2), Gossamer::error);
+    }
+
+    // Lose the end of the index.
+    {
+        istringstream in(a.substr(0, a.size() - 4));
+        BOOST_CHECK_THROW(GraphArchive::read(in, "in", "h", fac, 2), Gossamer::error);
+    }
+
+    // Lose the end of a block.
+    {
+        istringstream in(a.substr(0, a.size() / 2));
+        BOOST_CHECK_THROW(GraphArchive::read(in, "in", "h", fac, 2), Gossamer::error);
+    }
+
+    // Claim far more edges than the archive could hold.
+    const uint64_t headerSize = 8 + 7 * 8;
+    {
+        string b(a);
+        set64(b, 8 + 24, 1ULL << 50);
+        istringstream in(b);
+        BOOST_CHECK_THROW(GraphArchive::read(in, "in", "h", fac, 2), Gossamer::error);
+    }
+
+    // Claim a huge block.
+    for (uint64_t f = 1; f < 3; ++f)
+    {
+        string b(a);
+        set64(b, headerSize + 8 * f, 1ULL << 60);
+        istringstream in(b);
+        BOOST_CHECK_THROW(GraphArchive::read(in, "in", "h", fac, 2), Gossamer::error);
+    }
+
+    // Give the index a wrong offset, count or first edge, but a good
+    // checksum.
+    const uint64_t entrySize = (4 + sizeof(position_type::value_type) / 8) * 8;
+    const uint64_t idxBegin = a.size() - 8 - (8 + 8 + 2 * entrySize);
+    for (uint64_t f : { 0, 1, 4 })
+    {
+        string b(a);
+        b[idxBegin + 16 + entrySize + 8 * f] ^= 0x01;
+        set64(b, a.size() - 8, crc32(crc32(0, Z_NULL, 0),
+                                     reinterpret_cast<const Bytef*>(b.data() + idxBegin),
+                                     a.size() - 8 - idxBegin));
+        istringstream in(b);
+        BOOST_CHECK_THROW(GraphArchive::read(in, "in", "h", fac, 2), Gossamer::error);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testCommands)
+{
+    StringFileFactory fac;
+    buildGraph("g", 25, randomEdges(25, 100000, 23), fac);
+    Logger log("log.txt", fac);
+    boost::program_options::variables_map opts;
+    GossCmdContext cxt(fac, log, "dump-graph", opts);
+
+    // restore-graph reads either form.
+    GossCmdDumpGraph("g", "g.txt")(cxt);
+    GossCmdDumpGraph("g", "g.bin", true, 2)(cxt);
+    GossCmdRestoreGraph("g.txt", "t", 2)(cxt);
+    GossCmdRestoreGraph("g.bin", "b", 2)(cxt);
+    checkSame("g", "t", fac);
+    checkSame("g", "b", fac);
+}
+
+#include "testEnd.hh"
@@ -0,0 +1,152 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "HammingJoin.hh"
+#include "GossamerException.hh"
+#include "testHelpers.hh"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace boost;
+using namespace std;
+using Gossamer::position_type;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE TestHammingJoin
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    // Random k-mers on the left, and on the right some random ones and
+    // some a few substitutions away from ones on the left, half of them
+    // reverse complemented.
+    void makeSets(uint64_t pK, uint64_t pN, uint64_t pMaxDist, uint64_t pSeed,
+                  HammingJoin::Kmers& pLhs, HammingJoin::Kmers& pRhs)
+    {
+        std::mt19937_64 rng(pSeed);
+        for (uint64_t i = 0; i < pN; ++i)
+        {
+            pLhs.push_back(randomKmer(pK, rng));
+        }
+        for (uint64_t i = 0; i < pN; ++i)
+        {
+            if (rng() % 2)
+            {
+                pRhs.push_back(randomKmer(pK, rng));
+                continue;
+            }
+            pRhs.push_back(substitute(pLhs[rng() % pN], pK, rng() % (pMaxDist + 2), rng));
+            if (rng() % 2)
+            {
+                pRhs.back().reverseComplement(pK);
+            }
+        }
+    }
+
+    void bruteForce(uint64_t pK, uint64_t pDist, const HammingJoin::Kmers& pLhs, const HammingJoin::Kmers& pRhs,
+                    dynamic_bitset<>& pLhsNear, dynamic_bitset<>& pRhsNear)
+    {
+        pLhsNear.resize(pLhs.size());
+        pRhsNear.resize(pRhs.size());
+        for (uint64_t i = 0; i < pLhs.size(); ++i)
+        {
+            for (uint64_t j = 0; j < pRhs.size(); ++j)
+            {
+                position_type rc(pRhs[j]);
+                rc.reverseComplement(pK);
+                if (HammingJoin::distance(pLhs[i], pRhs[j]) <= pDist
+                    || HammingJoin::distance(pLhs[i], rc) <= pDist)
+                {
+                    pLhsNear[i] = true;
+                    pRhsNear[j] = true;
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testDistance)
+{
+    std::mt19937_64 rng(11);
+    for (uint64_t d = 0; d < 10; ++d)
+    {
+        for (uint64_t i = 0; i < 100; ++i)
+        {
+            const position_type x = randomKmer(60, rng);
+            BOOST_REQUIRE_EQUAL(HammingJoin::distance(x, substitute(x, 60, d, rng)), d);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testJoin)
+{
+    static const uint64_t ks[] = {4, 21, 27, 32, 33, 55};
+    for (uint64_t k = 0; k < sizeof(ks) / sizeof(ks[0]); ++k)
+    {
+        const uint64_t K = ks[k];
+        for (uint64_t d = 1; d <= 3 && 2 * d <= K; ++d)
+        {
+            HammingJoin::Kmers lhs;
+            HammingJoin::Kmers rhs;
+            makeSets(K, 300, d, K * 10 + d, lhs, rhs);
+
+            dynamic_bitset<> lhsExpected;
+            dynamic_bitset<> rhsExpected;
+            bruteForce(K, d, lhs, rhs, lhsExpected, rhsExpected);
+            BOOST_CHECK(K == 4 || lhsExpected.count() > 0);
+
+            MemoryBudget mem;
+            dynamic_bitset<> lhsNear;
+            dynamic_bitset<> rhsNear;
+            BOOST_CHECK_EQUAL(HammingJoin::join(K, d, true, lhs, rhs, lhsNear, rhsNear, mem, 3), 1);
+            BOOST_CHECK(lhsNear == lhsExpected);
+            BOOST_CHECK(rhsNear == rhsExpected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testPartitionedJoin)
+{
+    const uint64_t K = 25;
+    for (uint64_t d = 1; d <= 2; ++d)
+    {
+        HammingJoin::Kmers lhs;
+        HammingJoin::Kmers rhs;
+        makeSets(K, 2000, d, 100 + d, lhs, rhs);
+
+        dynamic_bitset<> lhsExpected;
+        dynamic_bitset<> rhsExpected;
+        bruteForce(K, d, lhs, rhs, lhsExpected, rhsExpected);
+
+        // A budget with (next to) no room.
+        MemoryBudget mem(1);
+        dynamic_bitset<> lhsNear;
+        dynamic_bitset<> rhsNear;
+        BOOST_CHECK_EQUAL(HammingJoin::join(K, d, true, lhs, rhs, lhsNear, rhsNear, mem, 2),
+                          HammingJoin::maxPartitions);
+        BOOST_CHECK(lhsNear == lhsExpected);
+        BOOST_CHECK(rhsNear == rhsExpected);
+        BOOST_CHECK_EQUAL(mem.reserved(), 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testDistanceRange)
+{
+    MemoryBudget mem;
+    HammingJoin::Kmers lhs;
+    HammingJoin::Kmers rhs;
+    dynamic_bitset<> lhsNear;
+    dynamic_bitset<> rhsNear;
+    BOOST_CHECK_THROW(HammingJoin::join(25, 0, true, lhs, rhs, lhsNear, rhsNear, mem, 1), Gossamer::error);
+    BOOST_CHECK_THROW(HammingJoin::join(25, 13, true, lhs, rhs, lhsNear, rhsNear, mem, 1), Gossamer::error);
+}
+
+#include "testEnd.hh"
@@ -0,0 +1,255 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#ifndef TESTHELPERS_HH
+#define TESTHELPERS_HH
+
+#ifndef GRAPH_HH
+#include "Graph.hh"
+#endif
+
+#ifndef STD_ALGORITHM
+#include <algorithm>
+#define STD_ALGORITHM
+#endif
+
+#ifndef STD_RANDOM
+#include <random>
+#define STD_RANDOM
+#endif
+
+#ifndef STD_SSTREAM
+#include <sstream>
+#define STD_SSTREAM
+#endif
+
+#ifndef STD_STRING
+#include <string>
+#define STD_STRING
+#endif
+
+#ifndef STD_UTILITY
+#include <utility>
+#define STD_UTILITY
+#endif
+
+#ifndef STD_VECTOR
+#include <vector>
+#define STD_VECTOR
+#endif
+
+// Random data, and ways of building and reading back graphs, shared
+// by the unit tests and the benchmarks.
+namespace TestHelpers
+{
+    typedef std::vector<std::pair<Gossamer::position_type,uint32_t> > Edges;
+
+    // Up to pN random pK-mers (pK at most 32), sorted and distinct.
+    inline std::vector<Gossamer::position_type> randomKmers(uint64_t pN, uint64_t pK, uint64_t pSeed)
+    {
+        std::mt19937_64 rng(pSeed);
+        const uint64_t m = pK < 32 ? (1ULL << (2 * pK)) - 1 : ~0ULL;
+        std::vector<Gossamer::position_type> xs;
+        for (uint64_t i = 0; i < pN; ++i)
+        {
+            xs.push_back(Gossamer::position_type(rng() & m));
+        }
+        std::sort(xs.begin(), xs.end());
+        xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+        return xs;
+    }
+
+    // The Jaccard similarity of two sorted sets of k-mers.
+    inline double jaccard(const std::vector<Gossamer::position_type>& pLhs,
+                          const std::vector<Gossamer::position_type>& pRhs)
+    {
+        std::vector<Gossamer::position_type> i;
+        std::set_intersection(pLhs.begin(), pLhs.end(), pRhs.begin(), pRhs.end(), std::back_inserter(i));
+        return double(i.size()) / double(pLhs.size() + pRhs.size() - i.size());
+    }
+
+    // A random pK-mer, of any length.
+    inline Gossamer::position_type randomKmer(uint64_t pK, std::mt19937_64& pRng)
+    {
+        Gossamer::position_type x;
+        for (uint64_t i = 0; i < pK; ++i)
+        {
+            x <<= 2;
+            x |= pRng() & 3;
+        }
+        return x;
+    }
+
+    // Substitute pD distinct bases of the pK-mer pX.
+    inline Gossamer::position_type substitute(Gossamer::position_type pX, uint64_t pK, uint64_t pD,
+                                              std::mt19937_64& pRng)
+    {
+        std::vector<uint64_t> ps;
+        while (ps.size() < pD)
+        {
+            const uint64_t p = pRng() % pK;
+            if (std::find(ps.begin(), ps.end(), p) == ps.end())
+            {
+                ps.push_back(p);
+                pX ^= Gossamer::position_type(1 + pRng() % 3) << 2 * p;
+            }
+        }
+        return pX;
+    }
+
+    inline std::string randomGenome(uint64_t pN, std::mt19937& pRng)
+    {
+        std::string g(pN, 'A');
+        for (uint64_t i = 0; i < pN; ++i)
+        {
+            g[i] = "ACGT"[pRng() & 3];
+        }
+        return g;
+    }
+
+    // Bases as they come off a sequencer: mostly ACGT, with the odd N
+    // and lower case base.
+    inline std::string randomReadBases(uint64_t pN, std::mt19937& pRng)
+    {
+        static const char bases[] = "ACGTNacgt";
+        std::string s(pN, 'A');
+        for (uint64_t i = 0; i < pN; ++i)
+        {
+            uint64_t x = pRng() % 64;
+            s[i] = bases[x < 60 ? x & 3 : 4 + (x & 3)];
+        }
+        return s;
+    }
+
+    // pN reads of pLength bases from random places in pGenome, as FASTA.
+    inline std::string randomReads(const std::string& pGenome, uint64_t pN, uint64_t pLength,
+                                   std::mt19937& pRng)
+    {
+        std::string r;
+        for (uint64_t i = 0; i < pN; ++i)
+        {
+            const uint64_t x = pRng() % (pGenome.size() - pLength + 1);
+            r += ">r" + std::to_string(i) + "\n" + pGenome.substr(x, pLength) + "\n";
+        }
+        return r;
+    }
+
+    // Words of varying density, so that selects cross many words.
+    inline std::vector<uint64_t> randomWords(uint64_t pN, uint64_t pSeed)
+    {
+        std::mt19937_64 rng(pSeed);
+        std::vector<uint64_t> ws;
+        for (uint64_t i = 0; i < pN; ++i)
+        {
+            switch (rng() % 4)
+            {
+                case 0:
+                    ws.push_back(0);
+                    break;
+                case 1:
+                    ws.push_back(rng() & rng() & rng());
+                    break;
+                case 2:
+                    ws.push_back(~uint64_t(0));
+                    break;
+                default:
+                    ws.push_back(rng());
+                    break;
+            }
+        }
+        return ws;
+    }
+
+    // Sorted items, including the extremes, and items either side of
+    // the sign bit.
+    template <typename T>
+    std::vector<T> sortedItems(uint64_t pN, uint64_t pSeed)
+    {
+        std::mt19937_64 rng(pSeed);
+        std::vector<T> xs;
+        for (uint64_t i = 0; i < pN; ++i)
+        {
+            switch (rng() % 4)
+            {
+                case 0:
+                    xs.push_back(T(rng() % 4));
+                    break;
+                case 1:
+                    xs.push_back(T(~T(0) - rng() % 4));
+                    break;
+                case 2:
+                    xs.push_back(T(T(1) << (sizeof(T) * 8 - 1)) + T(rng() % 4) - 2);
+                    break;
+                default:
+                    xs.push_back(T(rng()));
+                    break;
+            }
+        }
+        std::sort(xs.begin(), xs.end());
+        return xs;
+    }
+
+    // Random edges, with counts mostly small, as they are after
+    // sequencing errors, and some either side of the byte boundaries.
+    inline Edges randomEdges(uint64_t pK, uint64_t pN, uint64_t pSeed)
+    {
+        std::mt19937_64 rng(pSeed);
+        const std::vector<Gossamer::position_type> xs(randomKmers(pN, pK + 1, pSeed));
+
+        static const uint32_t big[] = {253, 254, 255, 256, 257, 300, 65535, 65536, 70000};
+        Edges es;
+        for (uint64_t i = 0; i < xs.size(); ++i)
+        {
+            uint32_t c = 1 + rng() % 4;
+            switch (rng() % 16)
+            {
+                case 0:
+                    c = big[rng() % (sizeof(big) / sizeof(big[0]))];
+                    break;
+                case 1:
+                    c = 5 + rng() % 100;
+                    break;
+                default:
+                    break;
+            }
+            es.push_back(std::make_pair(xs[i], c));
+        }
+        return es;
+    }
+
+    inline void buildGraph(const std::string& pName, uint64_t pK, const Edges& pEdges, FileFactory& pFac,
+                           VariableByteArray::Format pFmt = VariableByteArray::LayeredFormat)
+    {
+        Graph::Builder b(pK, pName, pFac, pEdges.size(), false, pFmt);
+        for (uint64_t i = 0; i < pEdges.size(); ++i)
+        {
+            b.push_back(pEdges[i].first, pEdges[i].second);
+        }
+        b.end();
+    }
+
+    inline Edges graphEdges(const std::string& pName, FileFactory& pFac)
+    {
+        Edges es;
+        for (Graph::LazyIterator itr(pName, pFac); itr.valid(); ++itr)
+        {
+            es.push_back(std::make_pair((*itr).first.value(), (*itr).second));
+        }
+        return es;
+    }
+
+    inline std::string contents(FileFactory& pFac, const std::string& pName)
+    {
+        FileFactory::InHolderPtr ip(pFac.in(pName));
+        std::ostringstream s;
+        s << (**ip).rdbuf();
+        return s.str();
+    }
+} // namespace TestHelpers
+
+#endif // TESTHELPERS_HH
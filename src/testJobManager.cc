@@ -81,4 +81,17 @@ BOOST_AUTO_TEST_CASE(test4)
     BOOST_CHECK_EQUAL(x, 3);
 }
 
+BOOST_AUTO_TEST_CASE(testRing)
+{
+    JobManager m(4, true);
+
+    x = 0;
+    JobManager::Token t = m.enqueue(foo);
+    JobManager::Token u = m.enqueue(baz, t);
+    m.enqueue(baz, t);
+    m.enqueue(baz, u);
+    m.wait();
+    BOOST_CHECK_EQUAL(x, 4);
+}
+
 #include "testEnd.hh"
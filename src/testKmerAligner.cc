@@ -165,6 +165,42 @@ BOOST_AUTO_TEST_CASE(testAlignKmers)
             BOOST_ASSERT(90 - ofs == i);
         }
 
+        // A saved index maps back the same, and is reused by open().
+        ix.write("graph", fac);
+        auto rdPtr = EdgeIndex::read("graph", fac, g);
+        auto opPtr = EdgeIndex::open("graph", fac, g, ee, sg, 4, 2, log);
+        auto newPtr = EdgeIndex::open("graph", fac, g, ee, sg, 2, 2, log);
+        BOOST_CHECK_EQUAL(EdgeIndex::fingerprint(sg), EdgeIndex::fingerprint(sg));
+        for (uint64_t r = 0; r < g.count(); ++r)
+        {
+            EdgeIndex::SegmentRank s0 = 0, s1 = 0, s2 = 0;
+            EdgeIndex::EdgeOffset o0 = 0, o1 = 0, o2 = 0;
+            bool b0 = ix.segment(r, s0, o0);
+            BOOST_CHECK_EQUAL(rdPtr->segment(r, s1, o1), b0);
+            BOOST_CHECK_EQUAL(opPtr->segment(r, s2, o2), b0);
+            if (b0)
+            {
+                BOOST_CHECK_EQUAL(s1, s0);
+                BOOST_CHECK_EQUAL(o1, o0);
+                BOOST_CHECK_EQUAL(s2, s0);
+                BOOST_CHECK_EQUAL(o2, o0);
+            }
+
+            EdgeIndex::SegmentRank s3 = 0;
+            EdgeIndex::EdgeOffset o3 = 0;
+            BOOST_CHECK_EQUAL(newPtr->segment(r, s3, o3), !(r & 3));
+        }
+        for (uint64_t s = 0; s < ee.count(); ++s)
+        {
+            EdgeIndex::SuperPathIdAndOffset p0, p1;
+            bool b0 = ix.superpath(s, p0);
+            BOOST_CHECK_EQUAL(opPtr->superpath(s, p1), b0);
+            if (b0)
+            {
+                BOOST_CHECK_EQUAL(p1.first.value(), p0.first.value());
+                BOOST_CHECK_EQUAL(p1.second, p0.second);
+            }
+        }
     }
 }
 
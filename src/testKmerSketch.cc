@@ -0,0 +1,140 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "KmerSketch.hh"
+#include "KmerSet.hh"
+#include "StringFileFactory.hh"
+#include "testHelpers.hh"
+
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Gossamer;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE TestKmerSketch
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    void buildSketch(const vector<position_type>& pXs, const string& pName, uint64_t pSize, FileFactory& pFac)
+    {
+        KmerSketch::Builder b(pName, pFac, 25, pSize);
+        for (uint64_t i = 0; i < pXs.size(); ++i)
+        {
+            b.push_back(pXs[i]);
+        }
+        b.end();
+    }
+
+    // Two sets sharing a proportion of their k-mers.
+    void overlapping(uint64_t pN, double pShared, uint64_t pSeed,
+                     vector<position_type>& pLhs, vector<position_type>& pRhs)
+    {
+        vector<position_type> xs(randomKmers(3 * pN, 25, pSeed));
+        std::shuffle(xs.begin(), xs.end(), std::mt19937(pSeed));
+        const uint64_t s = pN * pShared;
+        pLhs.assign(xs.begin(), xs.begin() + pN);
+        pRhs.assign(xs.begin(), xs.begin() + s);
+        pRhs.insert(pRhs.end(), xs.begin() + pN, xs.begin() + 2 * pN - s);
+        sort(pLhs.begin(), pLhs.end());
+        sort(pRhs.begin(), pRhs.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testJaccard)
+{
+    const double shared[] = { 0.0, 0.1, 0.5, 0.9, 1.0 };
+    for (uint64_t i = 0; i < sizeof(shared) / sizeof(shared[0]); ++i)
+    {
+        StringFileFactory fac;
+        vector<position_type> xs;
+        vector<position_type> ys;
+        overlapping(50000, shared[i], 17 + i, xs, ys);
+        buildSketch(xs, "x.sketch", 2048, fac);
+        buildSketch(ys, "y.sketch", 2048, fac);
+        KmerSketch x("x.sketch", fac);
+        KmerSketch y("y.sketch", fac);
+        BOOST_CHECK_EQUAL(x.count(), xs.size());
+
+        // The standard error is at most 1/(2 sqrt(2048)), about 0.011.
+        const double j = jaccard(xs, ys);
+        BOOST_CHECK_SMALL(x.jaccard(y) - j, 0.05);
+        BOOST_CHECK_EQUAL(x.jaccard(y), y.jaccard(x));
+        BOOST_CHECK_EQUAL(x.jaccard(x), 1.0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testSmallSetsAreExact)
+{
+    // When the sketch holds every hash, the estimate is exact.
+    StringFileFactory fac;
+    vector<position_type> xs;
+    vector<position_type> ys;
+    overlapping(500, 0.3, 19, xs, ys);
+    buildSketch(xs, "x.sketch", 2048, fac);
+    buildSketch(ys, "y.sketch", 2048, fac);
+    BOOST_CHECK_CLOSE(KmerSketch("x.sketch", fac).jaccard(KmerSketch("y.sketch", fac)),
+                      jaccard(xs, ys), 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(testCardinality)
+{
+    const uint64_t ns[] = { 0, 100, 5000, 200000 };
+    for (uint64_t i = 0; i < sizeof(ns) / sizeof(ns[0]); ++i)
+    {
+        StringFileFactory fac;
+        vector<position_type> xs(randomKmers(ns[i], 25, 23 + i));
+        buildSketch(xs, "x.sketch", 64, fac);
+        KmerSketch x("x.sketch", fac);
+        // With 4096 registers the standard error is about 1.6%.
+        BOOST_CHECK(fabs(x.cardinality() - xs.size()) <= 0.06 * xs.size() + 1);
+    }
+
+    // The union of two overlapping sets.
+    StringFileFactory fac;
+    vector<position_type> xs;
+    vector<position_type> ys;
+    overlapping(100000, 0.5, 29, xs, ys);
+    buildSketch(xs, "x.sketch", 64, fac);
+    buildSketch(ys, "y.sketch", 64, fac);
+    vector<uint8_t> rs;
+    KmerSketch("x.sketch", fac).merge(rs);
+    KmerSketch("y.sketch", fac).merge(rs);
+    BOOST_CHECK(fabs(KmerSketch::estimate(rs) - 150000) <= 0.06 * 150000);
+}
+
+BOOST_AUTO_TEST_CASE(testKmerSetSketch)
+{
+    StringFileFactory fac;
+    vector<position_type> xs(randomKmers(20000, 20, 31));
+    {
+        KmerSet::Builder b(20, "x", fac, xs.size());
+        for (uint64_t i = 0; i < xs.size(); ++i)
+        {
+            b.push_back(xs[i]);
+        }
+        b.end();
+    }
+    KmerSet::buildSketch("x", fac, 100);
+    {
+        KmerSketch s("x.sketch", fac);
+        BOOST_CHECK_EQUAL(s.K(), 20);
+        BOOST_CHECK_EQUAL(s.size(), 100);
+        BOOST_CHECK_EQUAL(s.count(), xs.size());
+        BOOST_CHECK_EQUAL(s.fingerprint(), KmerSet("x", fac).fingerprint());
+    }
+    KmerSet::remove("x", fac);
+    BOOST_CHECK(!KmerSketch::exists("x.sketch", fac));
+}
+
+#include "testEnd.hh"
@@ -0,0 +1,218 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "LinkAccumulator.hh"
+#include "PairLinker.hh"
+#include "StringFileFactory.hh"
+
+#include <map>
+#include <memory>
+#include <random>
+
+using namespace std;
+
+#define GOSS_TEST_MODULE TestLinkAccumulator
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    struct Stats
+    {
+        uint64_t count;
+        uint64_t sum;
+
+        Stats& operator+=(const Stats& pRhs)
+        {
+            count += pRhs.count;
+            sum += pRhs.sum;
+            return *this;
+        }
+
+        Stats()
+            : count(0), sum(0)
+        {
+        }
+    };
+
+    typedef LinkAccumulator<Stats> Acc;
+    typedef map<pair<uint64_t,uint64_t>, Stats> Ref;
+
+    void fill(vector<unique_ptr<Acc> >& pAccs, Ref& pRef, uint64_t pN, uint64_t pMaxId)
+    {
+        std::mt19937 rng(17);
+        std::uniform_int_distribution<uint64_t> id(0, pMaxId);
+        for (uint64_t i = 0; i < pN; ++i)
+        {
+            uint64_t l = id(rng);
+            uint64_t r = id(rng);
+            Acc& acc(*pAccs[i % pAccs.size()]);
+            Stats& s(acc[Acc::Link(SuperPathId(l), SuperPathId(r))]);
+            s.count += 1;
+            s.sum += i;
+            Stats& t(pRef[make_pair(l, r)]);
+            t.count += 1;
+            t.sum += i;
+        }
+    }
+
+    typedef LinkAccumulator<PairLinkStats> PairAcc;
+
+    // Collects the links passed on by a PairLinkStatsCompiler.
+    struct Collect
+    {
+        void push_back(const SuperPathId& pLhs, const SuperPathId& pRhs, const uint64_t& pCount,
+                       const int64_t& pLhsOffsetSum, const uint64_t& pLhsOffsetSum2,
+                       const int64_t& pRhsOffsetSum, const uint64_t& pRhsOffsetSum2)
+        {
+            PairAcc::Entry e;
+            e.lhs = pLhs.value();
+            e.rhs = pRhs.value();
+            e.value.count = pCount;
+            e.value.lhsOffsetSum = pLhsOffsetSum;
+            e.value.lhsOffsetSum2 = pLhsOffsetSum2;
+            e.value.rhsOffsetSum = pRhsOffsetSum;
+            e.value.rhsOffsetSum2 = pRhsOffsetSum2;
+            entries.push_back(e);
+        }
+
+        void end()
+        {
+            ended = true;
+        }
+
+        Collect()
+            : ended(false)
+        {
+        }
+
+        PairAcc::Entries entries;
+        bool ended;
+    };
+
+    void check(const Acc::Entries& pEntries, const Ref& pRef)
+    {
+        BOOST_REQUIRE_EQUAL(pEntries.size(), pRef.size());
+        Ref::const_iterator j = pRef.begin();
+        for (uint64_t i = 0; i < pEntries.size(); ++i, ++j)
+        {
+            BOOST_CHECK_EQUAL(pEntries[i].lhs, j->first.first);
+            BOOST_CHECK_EQUAL(pEntries[i].rhs, j->first.second);
+            BOOST_CHECK_EQUAL(pEntries[i].value.count, j->second.count);
+            BOOST_CHECK_EQUAL(pEntries[i].value.sum, j->second.sum);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testEmpty)
+{
+    Acc a;
+    BOOST_CHECK_EQUAL(a.size(), 0);
+
+    vector<Acc*> accs(1, &a);
+    Acc::Entries es;
+    Acc::merge(accs, 4, es);
+    BOOST_CHECK_EQUAL(es.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testSingle)
+{
+    Acc a;
+    a[Acc::Link(SuperPathId(3), SuperPathId(1))].count += 2;
+    a[Acc::Link(SuperPathId(1), SuperPathId(3))].count += 1;
+    a[Acc::Link(SuperPathId(3), SuperPathId(1))].count += 5;
+    BOOST_CHECK_EQUAL(a.size(), 2);
+
+    vector<Acc*> accs(1, &a);
+    Acc::Entries es;
+    Acc::merge(accs, 1, es);
+    BOOST_REQUIRE_EQUAL(es.size(), 2);
+    BOOST_CHECK_EQUAL(es[0].lhs, 1);
+    BOOST_CHECK_EQUAL(es[0].rhs, 3);
+    BOOST_CHECK_EQUAL(es[0].value.count, 1);
+    BOOST_CHECK_EQUAL(es[1].lhs, 3);
+    BOOST_CHECK_EQUAL(es[1].rhs, 1);
+    BOOST_CHECK_EQUAL(es[1].value.count, 7);
+
+    // Merging leaves the accumulators empty.
+    BOOST_CHECK_EQUAL(a.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testMerge)
+{
+    static const uint64_t N = 200000;
+    for (uint64_t t = 1; t <= 8; t *= 2)
+    {
+        vector<unique_ptr<Acc> > accs;
+        vector<Acc*> ptrs;
+        for (uint64_t i = 0; i < t; ++i)
+        {
+            accs.push_back(unique_ptr<Acc>(new Acc));
+            ptrs.push_back(accs.back().get());
+        }
+        Ref ref;
+        fill(accs, ref, N, 1000);
+
+        Acc::Entries es;
+        Acc::merge(ptrs, t, es);
+        check(es, ref);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testSpill)
+{
+    static const uint64_t N = 100000;
+    StringFileFactory fac;
+    ExternalBufferSort sorter(4096, fac);
+
+    // Spill one accumulator to the sorter every so often, and compare
+    // the reduced result with accumulating everything in memory.
+    std::mt19937 rng(19);
+    std::uniform_int_distribution<uint64_t> id(0, 300);
+    std::uniform_int_distribution<int64_t> off(-1000, 1000);
+    PairAcc spill;
+    PairAcc whole;
+    for (uint64_t i = 0; i < N; ++i)
+    {
+        PairAcc::Link l(SuperPathId(id(rng)), SuperPathId(id(rng)));
+        int64_t lo = off(rng);
+        int64_t ro = off(rng);
+        spill[l].add(lo, ro);
+        whole[l].add(lo, ro);
+        if (i % 7919 == 0 || i + 1 == N)
+        {
+            spill.visit([&] (const PairAcc::Entry& pEntry) {
+                TrivialVector<uint8_t,PairLinkStats::maxBytes> v;
+                PairLinkStats::encode(pEntry.lhs, pEntry.rhs, pEntry.value, v);
+                sorter.push_back(v);
+            });
+            spill.clear();
+        }
+    }
+
+    Collect c;
+    PairLinkStatsCompiler<Collect> comp(c);
+    sorter.sort(comp);
+    BOOST_CHECK(c.ended);
+
+    vector<PairAcc*> accs(1, &whole);
+    PairAcc::Entries es;
+    PairAcc::merge(accs, 1, es);
+    BOOST_REQUIRE_EQUAL(c.entries.size(), es.size());
+    for (uint64_t i = 0; i < es.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(c.entries[i].lhs, es[i].lhs);
+        BOOST_CHECK_EQUAL(c.entries[i].rhs, es[i].rhs);
+        BOOST_CHECK_EQUAL(c.entries[i].value.count, es[i].value.count);
+        BOOST_CHECK_EQUAL(c.entries[i].value.lhsOffsetSum, es[i].value.lhsOffsetSum);
+        BOOST_CHECK_EQUAL(c.entries[i].value.lhsOffsetSum2, es[i].value.lhsOffsetSum2);
+        BOOST_CHECK_EQUAL(c.entries[i].value.rhsOffsetSum, es[i].value.rhsOffsetSum);
+        BOOST_CHECK_EQUAL(c.entries[i].value.rhsOffsetSum2, es[i].value.rhsOffsetSum2);
+    }
+}
+
+#include "testEnd.hh"
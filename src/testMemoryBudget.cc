@@ -0,0 +1,94 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "MemoryBudget.hh"
+#include "MappedArray.hh"
+#include "StringFileFactory.hh"
+
+#include <string>
+
+using namespace std;
+
+#define GOSS_TEST_MODULE TestMemoryBudget
+#include "testBegin.hh"
+
+BOOST_AUTO_TEST_CASE(testUnlimited)
+{
+    MemoryBudget b;
+    BOOST_CHECK(!b.limited());
+    {
+        MemoryBudget::Reservation r(b.reserve(1ULL << 40, 1));
+        BOOST_CHECK_EQUAL(r.size(), 1ULL << 40);
+        BOOST_CHECK_EQUAL(b.reserved(), 1ULL << 40);
+        BOOST_CHECK_EQUAL(b.bufferSize(1000, false, 10), 1000);
+    }
+    BOOST_CHECK_EQUAL(b.reserved(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testLimited)
+{
+    MemoryBudget b(1000);
+    BOOST_CHECK(b.limited());
+
+    MemoryBudget::Reservation r1(b.reserve(600));
+    BOOST_CHECK_EQUAL(r1.size(), 600);
+    BOOST_CHECK_EQUAL(b.available(), 400);
+
+    // Only part of the request is available.
+    MemoryBudget::Reservation r2(b.reserve(600, 100));
+    BOOST_CHECK_EQUAL(r2.size(), 400);
+    BOOST_CHECK_EQUAL(b.available(), 0);
+
+    // The minimum is granted even when nothing is available.
+    MemoryBudget::Reservation r3(b.reserve(600, 100));
+    BOOST_CHECK_EQUAL(r3.size(), 100);
+    BOOST_CHECK_EQUAL(b.reserved(), 1100);
+    BOOST_CHECK_EQUAL(b.available(), 0);
+
+    r1.release();
+    BOOST_CHECK_EQUAL(b.reserved(), 500);
+    BOOST_CHECK_EQUAL(b.available(), 500);
+
+    MemoryBudget::Reservation r4(std::move(r2));
+    BOOST_CHECK_EQUAL(r2.size(), 0);
+    BOOST_CHECK_EQUAL(r4.size(), 400);
+    BOOST_CHECK_EQUAL(b.reserved(), 500);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferSize)
+{
+    MemoryBudget b(800);
+    BOOST_CHECK_EQUAL(b.bufferSize(100, true), 100);
+    BOOST_CHECK_EQUAL(b.bufferSize(2000, true), 800);
+    BOOST_CHECK_EQUAL(b.bufferSize(100, false), 700);
+
+    MemoryBudget::Reservation r(b.reserve(780));
+    BOOST_CHECK_EQUAL(b.bufferSize(100, true, 50), 50);
+}
+
+BOOST_AUTO_TEST_CASE(testMappedFiles)
+{
+    StringFileFactory fac;
+    fac.addFile("x", string(300, 'x'));
+
+    uint64_t before = FileFactory::mappedBytes();
+    MemoryBudget b(before + 1000);
+    BOOST_CHECK_EQUAL(b.available(), 1000);
+    {
+        MappedArray<uint8_t> a("x", fac);
+        BOOST_CHECK_EQUAL(FileFactory::mappedBytes(), before + 300);
+        BOOST_CHECK_EQUAL(b.available(), 700);
+
+        MemoryBudget::Reservation r(b.reserve(1000));
+        BOOST_CHECK_EQUAL(r.size(), 700);
+    }
+    BOOST_CHECK_EQUAL(FileFactory::mappedBytes(), before);
+    BOOST_CHECK_EQUAL(b.available(), 1000);
+}
+
+#include "testEnd.hh"
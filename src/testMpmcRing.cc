@@ -0,0 +1,175 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+/**  \file
+ * Testing MpmcRing.
+ *
+ */
+
+#include "MpmcRing.hh"
+#include "ThreadGroup.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace boost;
+using namespace std;
+
+#define GOSS_TEST_MODULE TestMpmcRing
+#include "testBegin.hh"
+
+BOOST_AUTO_TEST_CASE(testRing)
+{
+    MpmcRing<uint64_t> r(5);
+    BOOST_CHECK_EQUAL(r.capacity(), 8);
+    BOOST_CHECK(r.empty());
+    uint64_t x = 0;
+    BOOST_CHECK(!r.tryPop(x));
+
+    const uint64_t xs[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    BOOST_CHECK_EQUAL(r.tryPush(xs, xs + 3), 3);
+    BOOST_CHECK_EQUAL(r.tryPush(xs + 3, xs + 10), 5);
+    BOOST_CHECK_EQUAL(r.size(), 8);
+    BOOST_CHECK(!r.tryPush(xs[8]));
+
+    uint64_t ys[10];
+    BOOST_CHECK_EQUAL(r.tryPop(ys, 2), 2);
+    BOOST_CHECK_EQUAL(ys[0], 1);
+    BOOST_CHECK_EQUAL(ys[1], 2);
+    BOOST_CHECK(r.tryPush(xs[8]));
+    BOOST_CHECK(r.tryPush(xs[9]));
+    BOOST_CHECK_EQUAL(r.tryPop(ys, 10), 8);
+    for (uint64_t i = 0; i < 8; ++i)
+    {
+        BOOST_CHECK_EQUAL(ys[i], xs[i + 2]);
+    }
+    BOOST_CHECK(r.empty());
+}
+
+namespace // anonymous
+{
+    // Push [pBegin, pEnd) into the ring, a few at a time, retrying
+    // while it is full. (Pushers and poppers yield rather than spin,
+    // in case they share a processor.)
+    class Pusher
+    {
+    public:
+        void operator()()
+        {
+            uint64_t i = mBegin;
+            while (i < mEnd)
+            {
+                uint64_t xs[3];
+                const uint64_t n = std::min<uint64_t>(3, mEnd - i);
+                for (uint64_t j = 0; j < n; ++j)
+                {
+                    xs[j] = i + j;
+                }
+                const uint64_t m = mRing.tryPush(xs, xs + n);
+                if (m == 0)
+                {
+                    std::this_thread::yield();
+                }
+                i += m;
+            }
+        }
+
+        Pusher(MpmcRing<uint64_t>& pRing, uint64_t pBegin, uint64_t pEnd)
+            : mRing(pRing), mBegin(pBegin), mEnd(pEnd)
+        {
+        }
+
+    private:
+        MpmcRing<uint64_t>& mRing;
+        const uint64_t mBegin;
+        const uint64_t mEnd;
+    };
+
+    // Pop items until pTotal have been taken by all the poppers,
+    // noting whether each pusher's items came in order.
+    class Popper
+    {
+    public:
+        void operator()()
+        {
+            vector<uint64_t> last(mPushers, 0);
+            uint64_t xs[4];
+            while (mTaken.load() < mTotal)
+            {
+                const uint64_t n = mRing.tryPop(xs, 4);
+                if (n == 0)
+                {
+                    std::this_thread::yield();
+                }
+                for (uint64_t i = 0; i < n; ++i)
+                {
+                    mSum += xs[i];
+                    uint64_t& l(last[xs[i] / mPerPusher]);
+                    mInOrder = mInOrder && (l == 0 || l < xs[i] + 1);
+                    l = xs[i] + 1;
+                }
+                mTaken += n;
+            }
+        }
+
+        Popper(MpmcRing<uint64_t>& pRing, std::atomic<uint64_t>& pTaken, uint64_t pTotal,
+               uint64_t pPushers, uint64_t pPerPusher)
+            : mRing(pRing), mTaken(pTaken), mTotal(pTotal), mPushers(pPushers),
+              mPerPusher(pPerPusher), mSum(0), mInOrder(true)
+        {
+        }
+
+        MpmcRing<uint64_t>& mRing;
+        std::atomic<uint64_t>& mTaken;
+        const uint64_t mTotal;
+        const uint64_t mPushers;
+        const uint64_t mPerPusher;
+        uint64_t mSum;
+        bool mInOrder;
+    };
+}
+
+BOOST_AUTO_TEST_CASE(testRingThreads)
+{
+    // Each item is taken exactly once, and in the order it was pushed
+    // relative to the other items of its pusher.
+    const uint64_t t = 3;
+    const uint64_t n = 20000;
+    MpmcRing<uint64_t> r(16);
+    std::atomic<uint64_t> taken(0);
+    vector<std::shared_ptr<Pusher> > ps;
+    vector<std::shared_ptr<Popper> > qs;
+    for (uint64_t i = 0; i < t; ++i)
+    {
+        ps.push_back(std::make_shared<Pusher>(r, i * n, (i + 1) * n));
+        qs.push_back(std::make_shared<Popper>(r, taken, t * n, t, n));
+    }
+    {
+        ThreadGroup g;
+        for (uint64_t i = 0; i < t; ++i)
+        {
+            g.create(std::ref(*ps[i]));
+            g.create(std::ref(*qs[i]));
+        }
+        g.join();
+    }
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < t; ++i)
+    {
+        sum += qs[i]->mSum;
+        BOOST_CHECK(qs[i]->mInOrder);
+    }
+    BOOST_CHECK_EQUAL(taken.load(), t * n);
+    BOOST_CHECK_EQUAL(sum, t * n * (t * n - 1) / 2);
+    BOOST_CHECK(r.empty());
+}
+
+#include "testEnd.hh"
@@ -12,6 +12,7 @@
 #include "GossamerException.hh"
 
 #include <vector>
+#include <fstream>
 #include <sstream>
 #include <string>
 #include <iostream>
@@ -50,7 +51,7 @@ BOOST_AUTO_TEST_CASE(testMoreInputDetail)
 
         int const* li = get_error_info<throw_line>(exc);
         BOOST_CHECK(li != NULL);
-        BOOST_CHECK_EQUAL(*li, 64);
+        BOOST_CHECK_EQUAL(*li, 104);
 
         const char* const* fi = get_error_info<throw_file>(exc);
         BOOST_CHECK(fi != NULL);
@@ -80,7 +81,7 @@ BOOST_AUTO_TEST_CASE(testMoreOutputDetail)
 
         int const* li = get_error_info<throw_line>(exc);
         BOOST_CHECK(li != NULL);
-        BOOST_CHECK_EQUAL(*li, 163);
+        BOOST_CHECK_EQUAL(*li, 203);
 
         const char* const* fi = get_error_info<throw_file>(exc);
         BOOST_CHECK(fi != NULL);
@@ -91,4 +92,137 @@ BOOST_AUTO_TEST_CASE(testMoreOutputDetail)
     }
 }
 
+BOOST_AUTO_TEST_CASE(testMappingPolicy)
+{
+    PhysicalFileFactory fac;
+    string nm = fac.tmpName();
+    const uint64_t N = 1024 * 1024;
+    {
+        FileFactory::OutHolderPtr outp(fac.out(nm));
+        ostream& out(**outp);
+        for (uint64_t i = 0; i < N; ++i)
+        {
+            out.write(reinterpret_cast<const char*>(&i), sizeof(i));
+        }
+    }
+
+    FileFactory::MappingPolicy pol;
+    pol.populate = false;
+    pol.access = FileFactory::RandomAccess;
+    pol.placement = FileFactory::InterleavedPlacement;
+    pol.warmUp = true;
+    fac.mappingPolicy(FileFactory::IndexMap, pol);
+    {
+        FileFactory::MappedHolderPtr m(fac.mapIndex(nm));
+        fac.waitForWarmUp();
+        BOOST_CHECK_EQUAL(m->size(), N * sizeof(uint64_t));
+        const uint64_t* xs = reinterpret_cast<const uint64_t*>(m->data());
+        for (uint64_t i = 0; i < N; i += 4099)
+        {
+            BOOST_CHECK_EQUAL(xs[i], i);
+        }
+        m->advise(FileFactory::SequentialAccess);
+    }
+    {
+        // Drop the mapping while it may still be warming up.
+        FileFactory::MappedHolderPtr m(fac.mapIndex(nm));
+    }
+    fac.waitForWarmUp();
+    fac.remove(nm);
+}
+
+namespace // anonymous
+{
+    // The number of bytes of the mapping at pAddr which are in the
+    // process's page tables, or -1 if /proc/self/smaps can't say.
+    int64_t residentBytes(const void* pAddr)
+    {
+        const uint64_t a = reinterpret_cast<uint64_t>(pAddr);
+        ifstream smaps("/proc/self/smaps");
+        string line;
+        bool here = false;
+        while (getline(smaps, line))
+        {
+            uint64_t b = 0;
+            uint64_t e = 0;
+            char dash = 0;
+            istringstream l(line);
+            if (l >> std::hex >> b >> dash >> e && dash == '-')
+            {
+                here = b <= a && a < e;
+                continue;
+            }
+            if (here && line.compare(0, 4, "Rss:") == 0)
+            {
+                istringstream r(line.substr(4));
+                int64_t kb = 0;
+                r >> kb;
+                return kb * 1024;
+            }
+        }
+        return -1;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testInterleaveWithWarmUp)
+{
+    // The policies set by --map-interleave --map-warm-up.
+    FileFactory::MappingPolicy data;
+    data.placement = FileFactory::InterleavedPlacement;
+    data.hugePages = false;
+    data.populate = false;
+    FileFactory::MappingPolicy index(data);
+    index.warmUp = true;
+    FileFactory::MappingPolicy lazy;
+    lazy.hugePages = false;
+    lazy.populate = false;
+
+    PhysicalFileFactory fac;
+    string nm = fac.tmpName();
+    const uint64_t N = 1024 * 1024;
+    {
+        FileFactory::OutHolderPtr outp(fac.out(nm));
+        ostream& out(**outp);
+        for (uint64_t i = 0; i < N; ++i)
+        {
+            out.write(reinterpret_cast<const char*>(&i), sizeof(i));
+        }
+    }
+
+    // The data can only be interleaved if it is faulted in while
+    // interleaving is on, so it is populated rather than left to the
+    // first thread to read it.
+    fac.mappingPolicy(FileFactory::DataMap, data);
+    fac.mappingPolicy(FileFactory::IndexMap, index);
+    {
+        FileFactory::MappedHolderPtr d(fac.map(nm));
+        FileFactory::MappedHolderPtr i(fac.mapIndex(nm));
+        fac.waitForWarmUp();
+        const int64_t r = residentBytes(d->data());
+        if (r >= 0)
+        {
+            BOOST_CHECK_EQUAL(r, int64_t(d->size()));
+        }
+        const uint64_t* xs = reinterpret_cast<const uint64_t*>(d->data());
+        const uint64_t* ys = reinterpret_cast<const uint64_t*>(i->data());
+        for (uint64_t j = 0; j < N; j += 4099)
+        {
+            BOOST_CHECK_EQUAL(xs[j], j);
+            BOOST_CHECK_EQUAL(ys[j], j);
+        }
+    }
+
+    // Without interleaving, the data is mapped lazily.
+    fac.mappingPolicy(FileFactory::DataMap, lazy);
+    {
+        FileFactory::MappedHolderPtr d(fac.map(nm));
+        const int64_t r = residentBytes(d->data());
+        if (r >= 0)
+        {
+            BOOST_CHECK(r < int64_t(d->size()));
+        }
+    }
+    fac.remove(nm);
+}
+
 #include "testEnd.hh"
@@ -0,0 +1,310 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "ReadBatch.hh"
+#include "GossReadBaseString.hh"
+#include "GossReadProcessor.hh"
+#include "Logger.hh"
+#include "StringFileFactory.hh"
+#include "testHelpers.hh"
+
+#include <deque>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Gossamer;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE TestReadBatch
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    // A read sequence over a vector of fasta reads. The reads refer to
+    // their strings, so those are kept here too.
+    class VectorSeq
+    {
+    public:
+        bool valid() const
+        {
+            return mCurr < mReads.size();
+        }
+
+        const GossRead& operator*() const
+        {
+            return *mReads[mCurr];
+        }
+
+        void operator++()
+        {
+            ++mCurr;
+        }
+
+        void push_back(const string& pLabel, const string& pRead)
+        {
+            mStrings.push_back(pLabel);
+            const string& l(mStrings.back());
+            mStrings.push_back(pRead);
+            mReads.push_back(GossReadPtr(new GossFastaReadBaseString(l, mStrings.back())));
+        }
+
+        VectorSeq()
+            : mCurr(0)
+        {
+        }
+
+    private:
+        deque<string> mStrings;
+        vector<GossReadPtr> mReads;
+        uint64_t mCurr;
+    };
+
+    void checkKmers(const string& pSeq, uint64_t pK)
+    {
+        ReadBatch b;
+        const string label("x");
+        const string qual;
+        GossReadBaseString r(label, pSeq, qual);
+        b.push_back(r);
+
+        vector<pair<uint64_t,edge_type> > xs;
+        b.kmers(0, pK, [&] (uint64_t pOffset, const edge_type& pKmer) {
+            xs.push_back(make_pair(pOffset, pKmer));
+            return true;
+        });
+
+        uint64_t n = 0;
+        for (GossRead::Iterator i(r, pK); i.valid(); ++i, ++n)
+        {
+            BOOST_REQUIRE(n < xs.size());
+            BOOST_CHECK_EQUAL(xs[n].first, i.offset());
+            BOOST_CHECK(xs[n].second == i.kmer());
+        }
+        BOOST_CHECK_EQUAL(n, xs.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testKmers)
+{
+    std::mt19937 rng(17);
+    const uint64_t ks[] = { 1, 15, 25, 31, 32, 33, 55, 63 };
+    for (uint64_t i = 0; i < 20; ++i)
+    {
+        const string s(randomReadBases(150, rng));
+        for (auto k : ks)
+        {
+            checkKmers(s, k);
+        }
+    }
+    checkKmers("", 25);
+    checkKmers("ACGTNACGT", 5);
+}
+
+BOOST_AUTO_TEST_CASE(testKmersStop)
+{
+    ReadBatch b;
+    const string label;
+    const string read("ACGTACGTACGT");
+    const string qual;
+    b.push_back(GossReadBaseString(label, read, qual));
+    uint64_t n = 0;
+    b.kmers(0, 4, [&] (uint64_t, const edge_type&) {
+        return ++n < 3;
+    });
+    BOOST_CHECK_EQUAL(n, 3);
+}
+
+BOOST_AUTO_TEST_CASE(testPrintAndVisit)
+{
+    const string fa(">r1\nACGT\n");
+    const string fq("@r2\nGGCCA\n+r2\nIIIII\n");
+
+    ReadBatch b;
+    const string l1("r1");
+    const string s1("ACGT");
+    const string l2("r2");
+    const string s2("GGCCA");
+    const string q2("IIIII");
+    GossFastaReadBaseString r1(l1, s1);
+    GossFastqReadBaseString r2(l2, s2, l2, q2);
+    b.push_back(r1);
+    b.push_back(r2);
+    BOOST_CHECK_EQUAL(b.size(), 2);
+    BOOST_CHECK(!b.paired());
+
+    stringstream out;
+    b.print(0, out);
+    b.print(1, out);
+    BOOST_CHECK_EQUAL(out.str(), fa + fq);
+
+    stringstream viaRead;
+    b.visit([&] (const GossRead& pRead) { pRead.print(viaRead); });
+    BOOST_CHECK_EQUAL(viaRead.str(), fa + fq);
+
+    BOOST_CHECK_EQUAL(b.length(1), 5);
+    BOOST_CHECK_EQUAL(string(b.bases(1), b.length(1)), "GGCCA");
+
+    b.clear();
+    BOOST_CHECK(b.empty());
+}
+
+BOOST_AUTO_TEST_CASE(testFillPairs)
+{
+    VectorSeq lhs;
+    VectorSeq rhs;
+    for (uint64_t i = 0; i < 5; ++i)
+    {
+        const string n(to_string(i));
+        lhs.push_back(n + "/1", "ACGT");
+        rhs.push_back(n + "/2", "TTGCA");
+    }
+
+    ReadBatch b(6);
+    BOOST_CHECK(b.fill(lhs, rhs));
+    BOOST_CHECK(b.paired());
+    BOOST_CHECK_EQUAL(b.size(), 6);
+
+    vector<string> labels;
+    b.visitPairs([&] (const GossRead& pLhs, const GossRead& pRhs) {
+        labels.push_back(pLhs.label() + " " + pRhs.label());
+    });
+    BOOST_REQUIRE_EQUAL(labels.size(), 3);
+    BOOST_CHECK_EQUAL(labels[2], "2/1 2/2");
+
+    b.clear();
+    BOOST_CHECK(!b.fill(lhs, rhs));
+    BOOST_CHECK_EQUAL(b.size(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(testReader)
+{
+    VectorSeq reads;
+    for (uint64_t i = 0; i < 1000; ++i)
+    {
+        reads.push_back(to_string(i), "ACGTACGT");
+    }
+
+    ReadBatch::Pool pool(64);
+    uint64_t n = 0;
+    {
+        ReadBatchReader r(pool, [&reads] (ReadBatch& pBatch) { return pBatch.fill(reads); });
+        ReadBatchPtr b;
+        while (r.get(b))
+        {
+            stringstream s;
+            b->print(0, s);
+            BOOST_CHECK_EQUAL(s.str(), ">" + to_string(n) + "\nACGTACGT\n");
+            n += b->size();
+        }
+    }
+    BOOST_CHECK_EQUAL(n, 1000);
+}
+
+namespace // anonymous
+{
+    class CountingHandler : public GossReadHandler
+    {
+    public:
+        void operator()(const GossRead& pRead)
+        {
+            BOOST_CHECK_EQUAL(pRead.label(), to_string(reads++));
+        }
+
+        void operator()(const GossRead& pLhs, const GossRead& pRhs)
+        {
+        }
+
+        bool batched() const
+        {
+            return mBatched;
+        }
+
+        void operator()(const ReadBatchPtr& pBatch)
+        {
+            ++batches;
+            GossReadHandler::operator()(pBatch);
+        }
+
+        CountingHandler(bool pBatched)
+            : reads(0), batches(0), mBatched(pBatched)
+        {
+        }
+
+        uint64_t reads;
+        uint64_t batches;
+
+    private:
+        const bool mBatched;
+    };
+}
+
+BOOST_AUTO_TEST_CASE(testProcessor)
+{
+    // Only handlers which ask for batches get them.
+    StringFileFactory fac;
+    {
+        FileFactory::OutHolderPtr op(fac.out("r.fa"));
+        for (uint64_t i = 0; i < 10000; ++i)
+        {
+            **op << '>' << i << "\nACGTACGT\n";
+        }
+    }
+    Logger log(cerr, warning);
+    boost::program_options::variables_map opts;
+    GossCmdContext cxt(fac, log, "test", opts);
+    const vector<string> fastas(1, "r.fa");
+
+    CountingHandler single(false);
+    GossReadProcessor::processSingle(cxt, fastas, vector<string>(), vector<string>(), single);
+    BOOST_CHECK_EQUAL(single.reads, 10000);
+    BOOST_CHECK_EQUAL(single.batches, 0);
+
+    CountingHandler batched(true);
+    GossReadProcessor::processSingle(cxt, fastas, vector<string>(), vector<string>(), batched);
+    BOOST_CHECK_EQUAL(batched.reads, 10000);
+    BOOST_CHECK(batched.batches > 0);
+}
+
+BOOST_AUTO_TEST_CASE(testReaderError)
+{
+    ReadBatch::Pool pool;
+    uint64_t calls = 0;
+    ReadBatchReader r(pool, [&calls] (ReadBatch& pBatch) -> bool {
+        if (++calls > 2)
+        {
+            throw std::runtime_error("bad read");
+        }
+        pBatch.push_back(GossFastaReadBaseString("x", "ACGT"));
+        return true;
+    });
+
+    ReadBatchPtr b;
+    BOOST_CHECK(r.get(b));
+    BOOST_CHECK(r.get(b));
+    BOOST_CHECK_THROW(r.get(b), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(testPoolReuse)
+{
+    ReadBatch::Pool pool(16);
+    const ReadBatch* p = 0;
+    {
+        ReadBatchPtr b(pool.get());
+        b->push_back(GossFastaReadBaseString("x", "ACGT"));
+        p = b.get();
+    }
+    ReadBatchPtr b(pool.get());
+    BOOST_CHECK_EQUAL(b.get(), p);
+    BOOST_CHECK(b->empty());
+}
+
+#include "testEnd.hh"
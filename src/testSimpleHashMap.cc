@@ -73,4 +73,51 @@ BOOST_AUTO_TEST_CASE(testBigger)
     }
 }
 
+BOOST_AUTO_TEST_CASE(testClear)
+{
+    SimpleHashMap<uint64_t,uint64_t> x;
+    for (uint64_t i = 0; i < 100; ++i)
+    {
+        ++x[i * 7];
+    }
+    BOOST_CHECK_EQUAL(x.size(), 100);
+
+    x.clear();
+    BOOST_CHECK_EQUAL(x.size(), 0);
+    BOOST_CHECK_EQUAL(x.find(7), (uint64_t*)0);
+    typedef SimpleHashMap<uint64_t,uint64_t>::Iterator Iterator;
+    BOOST_CHECK(!Iterator(x).valid());
+
+    ++x[3];
+    BOOST_CHECK_EQUAL(x.size(), 1);
+    BOOST_CHECK_EQUAL(*x.find(3), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testReuse)
+{
+    // Clear a map that has grown, and refill it with other keys, as the
+    // per-component maps in translucent are.
+    SimpleHashMap<uint64_t,uint64_t> x;
+    typedef SimpleHashMap<uint64_t,uint64_t>::Iterator Iterator;
+    for (uint64_t r = 1; r <= 4; ++r)
+    {
+        const uint64_t n = 10000 / (r * r);
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            x[i * 13 + r] += r;
+        }
+        BOOST_CHECK_EQUAL(x.size(), n);
+        uint64_t m = 0;
+        for (Iterator it(x); it.valid(); ++it)
+        {
+            BOOST_CHECK_EQUAL((*it).first % 13, r);
+            BOOST_CHECK_EQUAL((*it).second, r);
+            ++m;
+        }
+        BOOST_CHECK_EQUAL(m, n);
+        x.clear();
+        BOOST_CHECK(!Iterator(x).valid());
+    }
+}
+
 #include "testEnd.hh"
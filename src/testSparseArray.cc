@@ -8,8 +8,11 @@
 //
 
 #include "SparseArray.hh"
+#include "Debug.hh"
+#include "PhysicalFileFactory.hh"
 #include "StringFileFactory.hh"
 
+#include <algorithm>
 #include <vector>
 #include <sstream>
 #include <string>
@@ -306,4 +309,314 @@ BOOST_AUTO_TEST_CASE(test5)
 }
 #endif
 
+BOOST_AUTO_TEST_CASE(testIteratorFrom)
+{
+    uint64_t M = 5000;
+    SparseArray::position_type N(1);
+    N <<= 40;
+
+    StringFileFactory fac;
+    std::vector<SparseArray::position_type> v;
+    {
+        SparseArray::Builder b("x", fac, position_type(N), rank_type(M));
+        mt19937 rng(23);
+        uint64_t x = 0;
+        for (uint64_t i = 0; i < M; ++i)
+        {
+            // Runs of adjacent positions as well as gaps.
+            x += (rng() % 2) ? 1 : 1 + (rng() % (1ULL << 28));
+            v.push_back(position_type(x));
+            b.push_back(position_type(x));
+        }
+        b.end(position_type(N));
+    }
+
+    SparseArray a("x", fac);
+    for (uint64_t i = 0; i <= M; i += (i < 200 ? 1 : 97))
+    {
+        SparseArray::Iterator it = a.iterator(rank_type(i));
+        for (uint64_t j = i; j < M; ++j)
+        {
+            BOOST_REQUIRE(it.valid());
+            BOOST_REQUIRE_EQUAL(*it, v[j]);
+            ++it;
+        }
+        BOOST_CHECK(!it.valid());
+    }
+}
+
+namespace // anonymous
+{
+    typedef vector<SparseArray::position_type> Positions;
+
+    // Clumps of positions sharing their high bits, with sparse positions
+    // around them.
+    Positions clumpedPositions(uint64_t pD, uint64_t pN, uint64_t pSeed)
+    {
+        mt19937_64 rng(pSeed);
+        vector<uint64_t> xs;
+        static const uint64_t clumps[] = {100, 300, 1000, 3000};
+        for (uint64_t c = 0; c < sizeof(clumps) / sizeof(clumps[0]); ++c)
+        {
+            const uint64_t w = uint64_t(1) << pD;
+            const uint64_t base = (rng() % (pN >> pD)) << pD;
+            for (uint64_t i = 0; i < min(clumps[c], w / 2); ++i)
+            {
+                xs.push_back(base + rng() % w);
+            }
+        }
+        for (uint64_t i = 0; i < 2000; ++i)
+        {
+            xs.push_back(rng() % pN);
+        }
+        sort(xs.begin(), xs.end());
+        xs.erase(unique(xs.begin(), xs.end()), xs.end());
+        return Positions(xs.begin(), xs.end());
+    }
+
+    // Whether the named array kept samples of its low bits, which are
+    // stored in one file or, as a stacked integer array, several.
+    bool sampled(FileFactory& pFac, const string& pName)
+    {
+        const string s = pName + ".low-bits-samples";
+        return pFac.exists(s) || pFac.exists(s + ".lwr");
+    }
+
+    void buildArray(const string& pName, StringFileFactory& pFac, uint64_t pD,
+                    const Positions& pPositions, const SparseArray::position_type& pN)
+    {
+        SparseArray::Builder b(pName, pFac, pD);
+        for (uint64_t i = 0; i < pPositions.size(); ++i)
+        {
+            b.push_back(pPositions[i]);
+        }
+        b.end(pN);
+    }
+} // namespace anonymous
+
+BOOST_AUTO_TEST_CASE(testLowBitsSamples)
+{
+    // Low bits stored in plain and in stacked integer arrays.
+    static const uint64_t ds[] = {12, 20, 36};
+    for (uint64_t k = 0; k < sizeof(ds) / sizeof(ds[0]); ++k)
+    {
+        const position_type N(uint64_t(1) << (ds[k] + 20));
+        const Positions v(clumpedPositions(ds[k], N.asUInt64(), 29 + k));
+        StringFileFactory fac;
+        buildArray("x", fac, ds[k], v, N);
+        Debug::enable("no-low-bits-samples");
+        buildArray("y", fac, ds[k], v, N);
+        Debug::disable("no-low-bits-samples");
+
+        SparseArray a("x", fac);
+        SparseArray b("y", fac);
+        BOOST_CHECK(sampled(fac, "x"));
+        BOOST_CHECK(!sampled(fac, "y"));
+        BOOST_CHECK(a.stat().as<uint64_t>("storage") > b.stat().as<uint64_t>("storage"));
+
+        // The samples are no wider than the low bits.
+        const uint64_t bits = 8 * ((ds[k] + 7) / 8);
+        BOOST_CHECK(a.stat()("low-bits-samples").as<uint64_t>("storage") <= (v.size() / 16 + 1) * bits / 8 + 64);
+        BOOST_CHECK_EQUAL(a.count(), v.size());
+
+        mt19937_64 rng(31 + k);
+        for (uint64_t i = 0; i < v.size(); i += 1 + i % 7)
+        {
+            BOOST_REQUIRE_EQUAL(a.select(i), v[i]);
+            const uint64_t x = v[i].asUInt64();
+            const position_type qs[] = {position_type(x), position_type(x + 1),
+                                        position_type(x - (x > 0)),
+                                        position_type(rng() % N.asUInt64())};
+            for (uint64_t j = 0; j < 4; ++j)
+            {
+                const position_type& q(qs[j]);
+                const uint64_t r = lower_bound(v.begin(), v.end(), q) - v.begin();
+                const bool present = r < v.size() && v[r] == q;
+                BOOST_REQUIRE_EQUAL(a.rank(q), r);
+                BOOST_REQUIRE_EQUAL(a.access(q), present);
+                rank_type ar = 0;
+                BOOST_REQUIRE_EQUAL(a.accessAndRank(q, ar), present);
+                BOOST_REQUIRE_EQUAL(ar, b.rank(q));
+                const position_type q1(q.asUInt64() + rng() % 64);
+                const pair<rank_type,rank_type> rr = a.rank(q, q1);
+                BOOST_REQUIRE_EQUAL(rr.first, r);
+                BOOST_REQUIRE_EQUAL(rr.second, uint64_t(lower_bound(v.begin(), v.end(), q1) - v.begin()));
+            }
+        }
+
+        SparseArray::remove("x", fac);
+        BOOST_CHECK(!fac.exists("x.header"));
+        BOOST_CHECK(!sampled(fac, "x"));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testLowBitsSamplesSmallGroups)
+{
+    // Uniform positions in arrays sized as usual have small groups,
+    // and no samples. (The k-mers of real sequence may not: those which
+    // begin with a long run of one base all share their high bits.)
+    // Nor are there samples for one large group among many small ones.
+    StringFileFactory fac;
+    const position_type N(uint64_t(1) << 50);
+    mt19937_64 rng(37);
+    vector<uint64_t> xs;
+    for (uint64_t i = 0; i < 200000; ++i)
+    {
+        xs.push_back(rng() % N.asUInt64());
+    }
+    const uint64_t base = rng() % N.asUInt64() & ~uint64_t(0xffffff);
+    for (uint64_t i = 0; i < 1000; ++i)
+    {
+        xs.push_back(base + rng() % 0x1000000);
+    }
+    sort(xs.begin(), xs.end());
+    xs.erase(unique(xs.begin(), xs.end()), xs.end());
+    const Positions v(xs.begin(), xs.end());
+    {
+        SparseArray::Builder b("x", fac, N, v.size());
+        for (uint64_t i = 0; i < v.size(); ++i)
+        {
+            b.push_back(v[i]);
+        }
+        b.end(N);
+    }
+    SparseArray a("x", fac);
+    BOOST_CHECK(!sampled(fac, "x"));
+    for (uint64_t i = 0; i < v.size(); i += 13)
+    {
+        BOOST_REQUIRE_EQUAL(a.rank(v[i]), i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testRetune)
+{
+    const position_type N(uint64_t(1) << 40);
+    mt19937_64 rng(47);
+    vector<uint64_t> xs;
+    for (uint64_t i = 0; i < 50000; ++i)
+    {
+        xs.push_back(rng() % N.asUInt64());
+    }
+    sort(xs.begin(), xs.end());
+    xs.erase(unique(xs.begin(), xs.end()), xs.end());
+    const Positions v(xs.begin(), xs.end());
+    const uint64_t best = SparseArray::Builder::fastD(N, v.size(), 0);
+
+    // Estimates far out either way are corrected; those close enough
+    // are left alone. (The first is so far out that its array has
+    // large groups, and samples, and the retuned one doesn't.)
+    const uint64_t estimates[] = {v.size() / 10000, v.size() / 100, v.size() * 100, v.size(), v.size() * 2};
+    for (uint64_t k = 0; k < sizeof(estimates) / sizeof(estimates[0]); ++k)
+    {
+        StringFileFactory fac;
+        {
+            SparseArray::Builder b("x", fac, N, estimates[k]);
+            for (uint64_t i = 0; i < v.size(); ++i)
+            {
+                b.push_back(v[i]);
+            }
+            b.end(N);
+        }
+        BOOST_CHECK_EQUAL(sampled(fac, "x"), k == 0);
+        const uint64_t built = SparseArray::Builder::d(N, estimates[k]);
+        const uint64_t d = SparseArray::retune("x", fac);
+        BOOST_CHECK_EQUAL(d, k < 3 ? best : built);
+        BOOST_CHECK(!fac.exists("x-retune.header"));
+        BOOST_CHECK(!sampled(fac, "x"));
+
+        SparseArray a("x", fac);
+        BOOST_CHECK_EQUAL(a.stat().as<uint64_t>("D"), d);
+        BOOST_CHECK_EQUAL(a.count(), v.size());
+        BOOST_CHECK_EQUAL(a.size(), N);
+        for (uint64_t i = 0; i < v.size(); i += 1 + i % 5)
+        {
+            BOOST_REQUIRE_EQUAL(a.select(i), v[i]);
+            BOOST_REQUIRE_EQUAL(a.rank(v[i]), i);
+            BOOST_REQUIRE(a.access(v[i]));
+        }
+        uint64_t n = 0;
+        for (SparseArray::Iterator i(a.iterator()); i.valid(); ++i, ++n)
+        {
+            BOOST_REQUIRE_EQUAL(*i, v[n]);
+        }
+        BOOST_CHECK_EQUAL(n, v.size());
+    }
+}
+
+// Retuning replaces files which exist, which a PhysicalFileFactory,
+// unlike a StringFileFactory, won't do by copying.
+BOOST_AUTO_TEST_CASE(testRetunePhysical)
+{
+    const position_type N(uint64_t(1) << 40);
+    mt19937_64 rng(19);
+    vector<uint64_t> xs;
+    for (uint64_t i = 0; i < 20000; ++i)
+    {
+        xs.push_back(rng() % N.asUInt64());
+    }
+    sort(xs.begin(), xs.end());
+    xs.erase(unique(xs.begin(), xs.end()), xs.end());
+    const Positions v(xs.begin(), xs.end());
+
+    PhysicalFileFactory fac;
+    const string x = fac.tmpName();
+    {
+        SparseArray::Builder b(x, fac, N, v.size() / 10000);
+        for (uint64_t i = 0; i < v.size(); ++i)
+        {
+            b.push_back(v[i]);
+        }
+        b.end(N);
+    }
+    BOOST_CHECK(sampled(fac, x));
+    const uint64_t d = SparseArray::retune(x, fac);
+    BOOST_CHECK_EQUAL(d, SparseArray::Builder::fastD(N, v.size(), 0));
+    BOOST_CHECK(!fac.exists(x + "-retune.header"));
+    BOOST_CHECK(!sampled(fac, x));
+    {
+        SparseArray a(x, fac);
+        BOOST_CHECK_EQUAL(a.stat().as<uint64_t>("D"), d);
+        BOOST_CHECK_EQUAL(a.count(), v.size());
+        for (uint64_t i = 0; i < v.size(); i += 1 + i % 7)
+        {
+            BOOST_REQUIRE_EQUAL(a.select(i), v[i]);
+            BOOST_REQUIRE_EQUAL(a.rank(v[i]), i);
+        }
+    }
+    SparseArray::remove(x, fac);
+    BOOST_CHECK(!fac.exists(x + ".header"));
+}
+
+namespace // anonymous
+{
+    // The size in bits of an array's low bits, at their stored width,
+    // and high bits.
+    double bits(const position_type& pN, uint64_t pM, uint64_t pD)
+    {
+        return pM * (8 * ((pD + 7) / 8) + 1) + pN.asDouble() / double(uint64_t(1) << pD);
+    }
+} // namespace anonymous
+
+BOOST_AUTO_TEST_CASE(testFastD)
+{
+    // With no budget, D is that of the smallest array, counting the low
+    // bits at their stored width; a budget only ever lowers it, keeping
+    // the array within the budget.
+    const position_type N(uint64_t(1) << 40);
+    const uint64_t ms[] = {1000, 20000, 50000, 3000000};
+    for (uint64_t k = 0; k < sizeof(ms) / sizeof(ms[0]); ++k)
+    {
+        const uint64_t d0 = SparseArray::Builder::fastD(N, ms[k], 0);
+        const uint64_t d1 = SparseArray::Builder::fastD(N, ms[k], 0.2);
+        const uint64_t d = SparseArray::Builder::d(N, ms[k]);
+        BOOST_CHECK(d1 <= d0);
+        BOOST_CHECK(bits(N, ms[k], d0) <= bits(N, ms[k], d));
+        BOOST_CHECK(bits(N, ms[k], d1) <= 1.2 * bits(N, ms[k], d0));
+    }
+    // 20000 positions call for D = 26 by d, but low bits of 26 bits are
+    // stored in 32; D = 24 makes a smaller array.
+    BOOST_CHECK_EQUAL(SparseArray::Builder::d(N, 20000), 26);
+    BOOST_CHECK_EQUAL(SparseArray::Builder::fastD(N, 20000, 0), 24);
+}
+
 #include "testEnd.hh"
@@ -0,0 +1,173 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "ThreadPlacement.hh"
+#include "ThreadGroup.hh"
+#include "Utils.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#if defined(GOSS_LINUX_X64)
+#include <sched.h>
+#endif
+
+using namespace boost;
+using namespace std;
+
+#define GOSS_TEST_MODULE TestThreadPlacement
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    // Two nodes of four processors, the second numbered with a gap,
+    // as when some processors are not allowed.
+    ThreadPlacement::Nodes twoNodes()
+    {
+        const uint32_t n0[] = {0, 1, 2, 3};
+        const uint32_t n1[] = {4, 5, 7, 8};
+        ThreadPlacement::Nodes ns;
+        ns.push_back(vector<uint32_t>(n0, n0 + 4));
+        ns.push_back(vector<uint32_t>(n1, n1 + 4));
+        return ns;
+    }
+} // namespace anonymous
+
+BOOST_AUTO_TEST_CASE(testBlocks)
+{
+    {
+        ThreadPlacement p(twoNodes());
+        BOOST_CHECK_EQUAL(p.processors(), 8);
+        BOOST_CHECK_EQUAL(p.nodes(), 2);
+        BOOST_CHECK(!p.pinning());
+
+        // Eight workers fill both nodes, the first half on node 0.
+        const uint32_t eight[] = {0, 1, 2, 3, 4, 5, 7, 8};
+        for (uint64_t w = 0; w < 8; ++w)
+        {
+            BOOST_CHECK_EQUAL(p.node(w, 8), w / 4);
+            BOOST_CHECK_EQUAL(p.claim(w, 8), eight[w]);
+        }
+    }
+
+    // Three workers: two on node 0 and one on node 1.
+    {
+        ThreadPlacement p(twoNodes());
+        BOOST_CHECK_EQUAL(p.claim(0, 3), 0);
+        BOOST_CHECK_EQUAL(p.claim(1, 3), 1);
+        BOOST_CHECK_EQUAL(p.claim(2, 3), 4);
+    }
+
+    // Sixteen workers double up, still in blocks.
+    {
+        ThreadPlacement p(twoNodes());
+        const uint32_t eight[] = {0, 1, 2, 3, 4, 5, 7, 8};
+        for (uint64_t w = 0; w < 16; ++w)
+        {
+            BOOST_CHECK_EQUAL(p.node(w, 16), w / 8);
+            BOOST_CHECK_EQUAL(p.claim(w, 16), eight[(w / 8) * 4 + w % 4]);
+        }
+    }
+
+    // A single worker goes on the first processor.
+    {
+        ThreadPlacement p(twoNodes());
+        BOOST_CHECK_EQUAL(p.claim(0, 1), 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testRoundRobin)
+{
+    // Pools of unknown size alternate between the nodes.
+    ThreadPlacement p(twoNodes());
+    const uint32_t expected[] = {0, 4, 1, 5, 2, 7, 3, 8, 0, 4};
+    for (uint64_t w = 0; w < 10; ++w)
+    {
+        BOOST_CHECK_EQUAL(p.node(w, 0), w % 2);
+        BOOST_CHECK_EQUAL(p.claim(w, 0), expected[w]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testConcurrentPools)
+{
+    // Two pools of four share the processors of each node, rather than
+    // both taking the first two.
+    ThreadPlacement p(twoNodes());
+    vector<uint32_t> ps;
+    for (uint64_t i = 0; i < 2; ++i)
+    {
+        for (uint64_t w = 0; w < 4; ++w)
+        {
+            ps.push_back(p.claim(w, 4));
+        }
+    }
+    const uint32_t expected[] = {0, 1, 4, 5, 2, 3, 7, 8};
+    BOOST_CHECK_EQUAL_COLLECTIONS(ps.begin(), ps.end(), expected, expected + 8);
+
+    // A third goes round again.
+    BOOST_CHECK_EQUAL(p.claim(0, 4), 0);
+    BOOST_CHECK_EQUAL(p.claim(2, 4), 4);
+}
+
+BOOST_AUTO_TEST_CASE(testDescribe)
+{
+    ThreadPlacement p(twoNodes());
+    BOOST_CHECK_EQUAL(p.describe(), "8 processors on 2 memory nodes: 0-3; 4-5,7-8");
+    BOOST_CHECK_EQUAL(p.describe(3), "workers 0-1 on node 0 (processors 0-3); workers 2 on node 1 (processors 4-5,7-8)");
+
+    // Empty nodes are dropped, and there is always somewhere to go.
+    ThreadPlacement q(ThreadPlacement::Nodes(2));
+    BOOST_CHECK_EQUAL(q.nodes(), 1);
+    BOOST_CHECK_EQUAL(q.claim(5, 8), 0);
+    BOOST_CHECK_EQUAL(q.describe(), "1 processor on 1 memory node: 0");
+
+    // Workers are logged with the number of their node, not its place
+    // among the nodes with processors.
+    ThreadPlacement::Nodes ns(twoNodes());
+    ns.insert(ns.begin(), vector<uint32_t>());
+    ThreadPlacement r(ns);
+    BOOST_CHECK_EQUAL(r.nodes(), 2);
+    BOOST_CHECK_EQUAL(r.describe(3), "workers 0-1 on node 1 (processors 0-3); workers 2 on node 2 (processors 4-5,7-8)");
+}
+
+BOOST_AUTO_TEST_CASE(testProcess)
+{
+    ThreadPlacement& p(ThreadPlacement::process());
+    BOOST_CHECK(p.processors() >= 1);
+    BOOST_CHECK_EQUAL(p.processors(), Gossamer::logicalProcessorCount());
+    BOOST_TEST_MESSAGE(p.describe());
+
+    // Without pinning nothing is placed.
+    BOOST_CHECK(!p.place(0, 1));
+
+#if defined(GOSS_LINUX_X64)
+    // Pinned workers run where they were put.
+    p.pinning(true);
+    const uint64_t n = p.processors();
+    vector<int> cpus(n, -1);
+    {
+        ThreadGroup grp;
+        for (uint64_t w = 0; w < n; ++w)
+        {
+            grp.create([&cpus, w] () { cpus[w] = sched_getcpu(); }, w, n);
+        }
+        grp.join();
+    }
+    p.pinning(false);
+
+    // A pool as big as the machine covers it, whatever order its
+    // workers started in.
+    sort(cpus.begin(), cpus.end());
+    BOOST_CHECK(unique(cpus.begin(), cpus.end()) == cpus.end());
+    BOOST_CHECK(cpus.front() >= 0);
+#endif
+}
+
+#include "testEnd.hh"
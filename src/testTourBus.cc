@@ -144,8 +144,9 @@ void writeKmer(ostream& pOut, uint64_t pK, uint64_t pKmer)
     }
 }
 
-void
-doTest(uint64_t pK, const char* pGenome, const char* pReads[])
+uint64_t
+doTest(uint64_t pK, const char* pGenome, const char* pReads[], uint64_t pThreads = 1,
+       vector<Gossamer::position_type>* pEdges = NULL)
 {
     const uint64_t K1 = pK + 1;
 
@@ -186,6 +187,7 @@ doTest(uint64_t pK, const char* pGenome, const char* pReads[])
     }
 #endif // DUMP_GRAPHS
     TourBus tourBus(g, log);
+    tourBus.setNumThreads(pThreads);
     tourBus.pass();
 
     {
@@ -194,7 +196,7 @@ doTest(uint64_t pK, const char* pGenome, const char* pReads[])
     }
 
     GraphPtr goutPtr = Graph::open("y", fac);
-    Graph& gout(*gPtr);
+    Graph& gout(*goutPtr);
 #ifdef DUMP_GRAPHS
     {
         std::ofstream out("graph.after.dot");
@@ -210,6 +212,14 @@ doTest(uint64_t pK, const char* pGenome, const char* pReads[])
         Gossamer::position_type x = vec.kmer(K1, j);
         BOOST_CHECK(gout.access(Graph::Edge(x)));
     }
+    if (pEdges)
+    {
+        for (Graph::Iterator i(gout); i.valid(); ++i)
+        {
+            pEdges->push_back((*i).first.value());
+        }
+    }
+    return tourBus.removedEdgesCount();
 }
 
 BOOST_AUTO_TEST_CASE(test_reads2)
@@ -237,6 +247,28 @@ BOOST_AUTO_TEST_CASE(test_reads6)
     doTest(11, genome6, reads6);
 }
 
+// Tours run concurrently remove just what they remove one at a time.
+BOOST_AUTO_TEST_CASE(test_concurrent)
+{
+    static const char* genomes[] = { genome2, genome3, genome4, genome5 };
+    static const char** reads[] = { reads2, reads3, reads4, reads5 };
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        vector<Gossamer::position_type> e1;
+        vector<Gossamer::position_type> e4;
+        uint64_t r1 = doTest(7, genomes[i], reads[i], 1, &e1);
+        uint64_t r4 = doTest(7, genomes[i], reads[i], 4, &e4);
+        BOOST_CHECK_EQUAL(r1, r4);
+        BOOST_CHECK(e1 == e4);
+    }
+    vector<Gossamer::position_type> e1;
+    vector<Gossamer::position_type> e3;
+    uint64_t r1 = doTest(11, genome6, reads6, 1, &e1);
+    uint64_t r3 = doTest(11, genome6, reads6, 3, &e3);
+    BOOST_CHECK_EQUAL(r1, r3);
+    BOOST_CHECK(e1 == e3);
+}
+
 #include "testEnd.hh"
 
 
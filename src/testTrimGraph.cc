@@ -0,0 +1,94 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "GossCmdTrimGraph.hh"
+
+#include "Graph.hh"
+#include "Logger.hh"
+#include "StringFileFactory.hh"
+#include "testHelpers.hh"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace boost;
+using namespace std;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE TestTrimGraph
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    struct Fixture
+    {
+        Fixture()
+            : log("log.txt", fac), cxt(fac, log, "trim-graph", opts)
+        {
+        }
+
+        void trim(uint64_t pCutoff, uint64_t pThreads, uint64_t pMinRangedEdges)
+        {
+            GossCmdTrimGraph("g", "t", pCutoff, false, false, boost::optional<uint64_t>(), pThreads,
+                             pMinRangedEdges)(cxt);
+        }
+
+        static const uint64_t K = 25;
+        StringFileFactory fac;
+        Logger log;
+        boost::program_options::variables_map opts;
+        GossCmdContext cxt;
+    };
+
+    Edges expected(const Edges& pEdges, uint64_t pCutoff)
+    {
+        Edges es;
+        for (uint64_t i = 0; i < pEdges.size(); ++i)
+        {
+            if (pEdges[i].second > pCutoff)
+            {
+                es.push_back(pEdges[i]);
+            }
+        }
+        return es;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testTrim)
+{
+    // Several ranges of ranks, the last one short. The ranges are
+    // used for any size of graph given more than one thread, and the
+    // single pass otherwise.
+    const Edges es = randomEdges(Fixture::K, 300000, 17);
+    static const uint64_t minRanged[] = {0, GossCmdTrimGraph::minRangedEdges};
+    static const uint64_t cutoffs[] = {0, 1, 4, 254, 255, 256, 65535, 65536, 100000};
+    for (uint64_t f = 0; f < 2; ++f)
+    {
+        Fixture x;
+        buildGraph("g", Fixture::K, es, x.fac, f ? VariableByteArray::FusedFormat : VariableByteArray::LayeredFormat);
+        for (uint64_t i = 0; i < sizeof(cutoffs) / sizeof(cutoffs[0]); ++i)
+        {
+            const Edges ex = expected(es, cutoffs[i]);
+            for (uint64_t t = 1; t <= 3; t += 2)
+            {
+                for (uint64_t m = 0; m < 2; ++m)
+                {
+                    x.trim(cutoffs[i], t, minRanged[m]);
+                    BOOST_CHECK(graphEdges("t", x.fac) == ex);
+                    BOOST_CHECK_EQUAL(Graph::open("t", x.fac)->countsFormat(),
+                                      f ? VariableByteArray::FusedFormat : VariableByteArray::LayeredFormat);
+                }
+            }
+        }
+    }
+}
+
+#include "testEnd.hh"
@@ -0,0 +1,333 @@
+// Copyright (c) 2008-2016, NICTA (National ICT Australia).
+// Copyright (c) 2016, Commonwealth Scientific and Industrial Research
+// Organisation (CSIRO) ABN 41 687 119 230.
+//
+// Licensed under the CSIRO Open Source Software License Agreement;
+// you may not use this file except in compliance with the License.
+// Please see the file LICENSE, included with this distribution.
+//
+#include "UnitigIndex.hh"
+
+#include "EntryEdgeSet.hh"
+#include "GossCmdBuildEntryEdgeSet.hh"
+#include "GossCmdBuildGraph.hh"
+#include "GossCmdBuildSupergraph.hh"
+#include "GossCmdBuildUnitigs.hh"
+#include "GossCmdClipLinks.hh"
+#include "GossCmdPrintContigs.hh"
+#include "GossCmdTrimPaths.hh"
+#include "Graph.hh"
+#include "StringFileFactory.hh"
+#include "SuperGraph.hh"
+#include "testHelpers.hh"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace boost;
+using namespace std;
+using namespace TestHelpers;
+
+#define GOSS_TEST_MODULE TestUnitigIndex
+#include "testBegin.hh"
+
+namespace // anonymous
+{
+    // Reads from a genome with some repeats, to make branches, and
+    // from a circular one, to make loops. pErrors more reads have a
+    // wrong base, near the start to make a tip, or in the middle to
+    // make a bubble.
+    string reads(uint64_t pN, uint64_t pSeed, uint64_t pErrors = 0)
+    {
+        std::mt19937 rng(pSeed);
+        const uint64_t L = 50;
+        string genome = randomGenome(pN, rng);
+        const string rep = genome.substr(0, 200);
+        for (uint64_t i = 1; i < 4; ++i)
+        {
+            genome.replace(i * pN / 4, rep.size(), rep);
+        }
+        const string circle = randomGenome(300, rng);
+        const string wrapped = circle + circle.substr(0, L);
+
+        string r = randomReads(genome, pN / 5, L, rng);
+        for (uint64_t i = 0; i < circle.size(); i += 5)
+        {
+            r += ">c" + lexical_cast<string>(i) + "\n" + wrapped.substr(i, L) + "\n";
+        }
+        for (uint64_t i = 0; i < pErrors; ++i)
+        {
+            string x = genome.substr(rng() % (pN - L), L);
+            const uint64_t j = (i & 1) ? 2 : L / 2;
+            x[j] = x[j] == 'A' ? 'C' : 'A';
+            r += ">e" + lexical_cast<string>(i) + "\n" + x + "\n";
+        }
+        return r;
+    }
+
+    struct Fixture
+    {
+        Fixture(uint64_t pN, uint64_t pSeed, uint64_t pErrors = 0)
+            : log("log.txt", fac), cxt(fac, log, "build-unitigs", opts)
+        {
+            fac.addFile("r.fa", reads(pN, pSeed, pErrors));
+            vector<string> fastas(1, "r.fa");
+            vector<string> none;
+            GossCmdBuildGraph(21, 16, (1ULL << 20), 2, "g", fastas, none, none)(cxt);
+        }
+
+        string printContigs(bool pRcs, bool pOmitSequence)
+        {
+            GossCmdPrintContigs("g", 0, 0, pRcs, pOmitSequence, true, true, false, false, 1, "c.fa")(cxt);
+            return contents(fac, "c.fa");
+        }
+
+        // The contigs of the supergraph's paths.
+        string printSuperContigs(bool pEntailed)
+        {
+            GossCmdPrintContigs("g", 0, 0, true, false, false, true, false, pEntailed, 1, "c.fa")(cxt);
+            return contents(fac, "c.fa");
+        }
+
+        // The edges and counts of the graph pName.
+        vector<uint64_t> edges(const string& pName)
+        {
+            vector<uint64_t> xs;
+            GraphPtr gPtr = Graph::open(pName, fac);
+            for (Graph::Iterator i(*gPtr); i.valid(); ++i)
+            {
+                xs.push_back((*i).first.value().asUInt64());
+                xs.push_back((*i).second);
+            }
+            return xs;
+        }
+
+        StringFileFactory fac;
+        Logger log;
+        boost::program_options::variables_map opts;
+        GossCmdContext cxt;
+    };
+
+    class Vis
+    {
+    public:
+        bool operator()(const Graph::Edge& pEdge, const Gossamer::rank_type& pRank)
+        {
+            mRanks.push_back(pRank);
+            return true;
+        }
+
+        Vis(vector<uint64_t>& pRanks)
+            : mRanks(pRanks)
+        {
+        }
+
+    private:
+        vector<uint64_t>& mRanks;
+    };
+}
+
+BOOST_AUTO_TEST_CASE(testPartition)
+{
+    Fixture f(20000, 17);
+    GossCmdBuildUnitigs("g", 3)(f.cxt);
+
+    GraphPtr gPtr = Graph::open("g", f.fac);
+    const Graph& g(*gPtr);
+    UnitigIndex u("g-unitigs", f.fac);
+    BOOST_REQUIRE(u.matches(g));
+    BOOST_CHECK_EQUAL(u.edges(), g.count());
+    BOOST_CHECK(u.cycles() >= 2);
+    BOOST_CHECK(u.count() - u.cycles() > 2);
+
+    // Every edge is in exactly one unitig, at the position recorded for it.
+    vector<uint64_t> seen(g.count(), 0);
+    for (uint64_t p = 0; p < u.edges(); ++p)
+    {
+        seen[u.edge(p)]++;
+        BOOST_REQUIRE_EQUAL(u.position(u.edge(p)), p);
+    }
+    BOOST_CHECK(std::count(seen.begin(), seen.end(), 1) == int64_t(g.count()));
+
+    // The unitigs are the paths walked from each start edge, in order.
+    uint64_t id = 0;
+    vector<uint64_t> path;
+    for (uint64_t r = 0; r < g.count(); ++r)
+    {
+        const Graph::Edge e = g.select(r);
+        const Graph::Node n = g.from(e);
+        if (g.inDegree(n) == 1 && g.outDegree(n) == 1)
+        {
+            continue;
+        }
+        BOOST_REQUIRE(!u.cycle(id));
+        BOOST_REQUIRE_EQUAL(u.first(id), r);
+        path.clear();
+        Vis vis(path);
+        g.linearPath(e, vis);
+        BOOST_REQUIRE_EQUAL(u.length(id), path.size());
+        for (uint64_t i = 0; i < path.size(); ++i)
+        {
+            BOOST_REQUIRE_EQUAL(u.edge(u.begin(id) + i), path[i]);
+            BOOST_REQUIRE(u.unitig(path[i]) == make_pair(id, i));
+        }
+        ++id;
+    }
+    BOOST_CHECK_EQUAL(id, u.count() - u.cycles());
+    for (; id < u.count(); ++id)
+    {
+        BOOST_CHECK(u.cycle(id));
+        const Graph::Node n = g.from(g.select(u.first(id)));
+        BOOST_CHECK_EQUAL(g.inDegree(n), 1);
+        BOOST_CHECK_EQUAL(g.outDegree(n), 1);
+    }
+
+    UnitigIndex::remove("g-unitigs", f.fac);
+    BOOST_CHECK(!UnitigIndex::exists("g-unitigs", f.fac));
+}
+
+// With little memory, the paths are spilled in small pieces and the
+// inverse is sorted on disk, and the index comes out the same.
+BOOST_AUTO_TEST_CASE(testSmallBudget)
+{
+    Fixture f(20000, 23);
+    GossCmdBuildUnitigs("g", 2)(f.cxt);
+
+    GraphPtr gPtr = Graph::open("g", f.fac);
+    const Graph& g(*gPtr);
+    MemoryBudget budget(1);
+    UnitigIndex::build(g, "h-unitigs", f.fac, f.log, budget, 3);
+    BOOST_CHECK_EQUAL(budget.reserved(), 0);
+
+    UnitigIndex u("g-unitigs", f.fac);
+    UnitigIndex v("h-unitigs", f.fac);
+    BOOST_REQUIRE(v.matches(g));
+    BOOST_REQUIRE_EQUAL(u.count(), v.count());
+    BOOST_CHECK_EQUAL(u.cycles(), v.cycles());
+    for (uint64_t i = 0; i < u.count(); ++i)
+    {
+        BOOST_REQUIRE_EQUAL(u.begin(i), v.begin(i));
+    }
+    for (uint64_t p = 0; p < u.edges(); ++p)
+    {
+        BOOST_REQUIRE_EQUAL(u.edge(p), v.edge(p));
+        BOOST_REQUIRE_EQUAL(u.position(p), v.position(p));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testCommandsMatch)
+{
+    Fixture f(20000, 19);
+
+    vector<string> contigs;
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        contigs.push_back(f.printContigs(i & 1, i & 2));
+    }
+    GossCmdBuildEntryEdgeSet("g", 2)(f.cxt);
+    vector<uint64_t> entries;
+    uint64_t fp = 0;
+    {
+        EntryEdgeSet es("g-entries", f.fac);
+        fp = es.fingerprint();
+        for (uint64_t i = 0; i < es.count(); ++i)
+        {
+            entries.push_back(es.select(i).value().asUInt64());
+            entries.push_back(es.multiplicity(i));
+            entries.push_back(es.length(i));
+            entries.push_back(es.endRank(i));
+        }
+    }
+
+    // With an index, print-contigs and the entry edges are the same.
+    GossCmdBuildUnitigs("g", 2)(f.cxt);
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        BOOST_CHECK(f.printContigs(i & 1, i & 2) == contigs[i]);
+    }
+    EntryEdgeSet::remove("g-entries", f.fac);
+    GossCmdBuildEntryEdgeSet("g", 2)(f.cxt);
+    {
+        EntryEdgeSet es("g-entries", f.fac);
+        BOOST_REQUIRE_EQUAL(4 * es.count(), entries.size());
+        BOOST_CHECK_EQUAL(es.fingerprint(), fp);
+        for (uint64_t i = 0; i < es.count(); ++i)
+        {
+            BOOST_CHECK_EQUAL(es.select(i).value().asUInt64(), entries[4 * i]);
+            BOOST_CHECK_EQUAL(es.multiplicity(i), entries[4 * i + 1]);
+            BOOST_CHECK_EQUAL(es.length(i), entries[4 * i + 2]);
+            BOOST_CHECK_EQUAL(es.endRank(i), entries[4 * i + 3]);
+        }
+    }
+
+    // A set from before fingerprints were saved gets the same one,
+    // taken as it is opened.
+    EntryEdgeSet::Header h("g-entries.header", f.fac);
+    h.version = EntryEdgeSet::unfingerprintedVersion;
+    {
+        FileFactory::OutHolderPtr op(f.fac.out("g-entries.header"));
+        (**op).write(reinterpret_cast<const char*>(&h), sizeof(h) - sizeof(h.fingerprint));
+    }
+    BOOST_CHECK_EQUAL(EntryEdgeSet("g-entries", f.fac).fingerprint(), fp);
+}
+
+BOOST_AUTO_TEST_CASE(testSuperContigsMatch)
+{
+    // The supergraph's contigs are the same whether its segments are
+    // walked or read from the index.
+    Fixture f(20000, 23);
+    GossCmdBuildEntryEdgeSet("g", 2)(f.cxt);
+    GossCmdBuildSupergraph("g", false)(f.cxt);
+    BOOST_REQUIRE(SuperGraph::read("g", f.fac));
+
+    vector<string> contigs;
+    for (uint64_t i = 0; i < 2; ++i)
+    {
+        contigs.push_back(f.printSuperContigs(i));
+        BOOST_CHECK(!contigs.back().empty());
+    }
+    GossCmdBuildUnitigs("g", 2)(f.cxt);
+    for (uint64_t i = 0; i < 2; ++i)
+    {
+        BOOST_CHECK(f.printSuperContigs(i) == contigs[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testEditsMatch)
+{
+    // trim-paths and clip-links remove the same edges whether the
+    // paths are walked or read from the index.
+    Fixture f(20000, 29, 40);
+    const vector<uint64_t> g = f.edges("g");
+    GossCmdTrimPaths("g", "t", 2, 2)(f.cxt);
+    GossCmdClipLinks("g", "c")(f.cxt);
+    const vector<uint64_t> trimmed = f.edges("t");
+    const vector<uint64_t> clipped = f.edges("c");
+    BOOST_CHECK(trimmed.size() < g.size());
+    BOOST_CHECK(clipped.size() < g.size());
+
+    GossCmdBuildUnitigs("g", 2)(f.cxt);
+    GossCmdTrimPaths("g", "t", 2, 2)(f.cxt);
+    GossCmdClipLinks("g", "c")(f.cxt);
+    BOOST_CHECK(f.edges("t") == trimmed);
+    BOOST_CHECK(f.edges("c") == clipped);
+
+    // An index of an older version is passed over.
+    GraphPtr gPtr = Graph::open("g", f.fac);
+    BOOST_CHECK(UnitigIndex::open("g-unitigs", *gPtr, f.fac, f.log));
+    UnitigIndex::Header h;
+    {
+        FileFactory::InHolderPtr ip(f.fac.in("g-unitigs.header"));
+        (**ip).read(reinterpret_cast<char*>(&h), sizeof(h));
+    }
+    h.version = 2016122001ULL;
+    {
+        FileFactory::OutHolderPtr op(f.fac.out("g-unitigs.header"));
+        (**op).write(reinterpret_cast<const char*>(&h), sizeof(h));
+    }
+    BOOST_CHECK(!UnitigIndex::open("g-unitigs", *gPtr, f.fac, f.log));
+}
+
+#include "testEnd.hh"
@@ -11,6 +11,7 @@
 
 #include <boost/dynamic_bitset.hpp>
 #include <random>
+#include <vector>
 
 
 using namespace boost;
@@ -127,4 +128,14 @@ BOOST_AUTO_TEST_CASE(testUpperLowerBound)
     check_bounds(&c[0], &c[100], 52);
 }
 
+BOOST_AUTO_TEST_CASE(testParseProcessorList)
+{
+    const uint32_t xs[] = {0, 1, 2, 3, 8, 10, 11};
+    BOOST_CHECK(Gossamer::parseProcessorList("0-3,8,10-11\n") == vector<uint32_t>(xs, xs + 7));
+    BOOST_CHECK(Gossamer::parseProcessorList("10-11,0-3,8") == vector<uint32_t>(xs, xs + 7));
+    BOOST_CHECK(Gossamer::parseProcessorList("5") == vector<uint32_t>(1, 5));
+    BOOST_CHECK(Gossamer::parseProcessorList("").empty());
+    BOOST_CHECK(Gossamer::parseProcessorList("\n").empty());
+}
+
 #include "testEnd.hh"
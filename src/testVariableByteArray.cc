@@ -169,4 +169,67 @@ BOOST_AUTO_TEST_CASE(test4)
     BOOST_CHECK(!itr.valid());
 }
 
+BOOST_AUTO_TEST_CASE(testFused)
+{
+    // Straddle several blocks, with a partial block at the end.
+    const uint64_t N = 1000ull;
+    StringFileFactory fac;
+    std::vector<VariableByteArray::value_type> values;
+    values.reserve(N);
+    {
+        VariableByteArray::Builder b("x", fac, N, 0.01, VariableByteArray::FusedFormat);
+
+        std::mt19937 rng(209);
+        std::uniform_int_distribution<> dist(0,700);
+
+        for (uint64_t i = 0; i < N; ++i)
+        {
+            VariableByteArray::value_type v = dist(rng);
+            if (i % 97 == 0)
+            {
+                v = 0xffffffffu - i;
+            }
+            values.push_back(v);
+            b.push_back(v);
+        }
+        b.end();
+    }
+
+    VariableByteArray a("x", fac, VariableByteArray::FusedFormat);
+    BOOST_CHECK_EQUAL(a.format(), VariableByteArray::FusedFormat);
+    BOOST_CHECK_EQUAL(a.size(), N);
+
+    VariableByteArray::Iterator itr(a.iterator());
+    VariableByteArray::LazyIterator lazy(VariableByteArray::lazyIterator("x", fac, VariableByteArray::FusedFormat));
+    for (uint64_t i = 0; i < N; ++i, ++itr, ++lazy)
+    {
+        BOOST_CHECK_EQUAL(values[i], a[i]);
+        BOOST_CHECK(itr.valid());
+        BOOST_CHECK_EQUAL(values[i], *itr);
+        BOOST_CHECK(lazy.valid());
+        BOOST_CHECK_EQUAL(values[i], *lazy);
+    }
+    BOOST_CHECK(!itr.valid());
+    BOOST_CHECK(!lazy.valid());
+
+    VariableByteArray::remove("x", fac, VariableByteArray::FusedFormat);
+    BOOST_CHECK(!fac.exists("x.blk"));
+    BOOST_CHECK(!fac.exists("x.exc"));
+    BOOST_CHECK(!fac.exists("x.fused"));
+}
+
+BOOST_AUTO_TEST_CASE(testFusedEmpty)
+{
+    StringFileFactory fac;
+    {
+        VariableByteArray::Builder b("x", fac, 0, 0.01, VariableByteArray::FusedFormat);
+        b.end();
+    }
+
+    VariableByteArray a("x", fac, VariableByteArray::FusedFormat);
+    BOOST_CHECK_EQUAL(a.size(), 0);
+    BOOST_CHECK(!a.iterator().valid());
+    BOOST_CHECK(!VariableByteArray::lazyIterator("x", fac, VariableByteArray::FusedFormat).valid());
+}
+
 #include "testEnd.hh"